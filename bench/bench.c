@@ -0,0 +1,1206 @@
+/**
+ * @file bench.c
+ * @brief Pruebas de rendimiento de cada fase del compilador.
+ *
+ * Genera corpus sintéticos (o usa los archivos indicados), ejecuta cada fase
+ * con calentamiento y repeticiones, y reporta en JSON el tiempo mediano y
+ * mínimo, MB/s, tokens/s, las reservas de memoria por ejecución y el pico de
+ * memoria residente. Cada corpus se mide en un proceso hijo para que el pico
+ * de memoria de uno no contamine al siguiente.
+ *
+ * Las reservas se cuentan enlazando con -Wl,--wrap=malloc (ver Makefile),
+ * por lo que solo se cuentan las del propio compilador. Si el sistema ofrece
+ * contadores de hardware, cada fase reporta además IPC, porcentaje de saltos
+ * mal predichos e instrucciones por byte (ver counters.h). La fase lex se
+ * repite además con cada variante especializada del lexer que admite el
+ * corpus, para medir la ganancia de cada una frente a la completa.
+ *
+ * Aparte, sobre un programa generado con miles de funciones, se mide la
+ * traducción a bytecode con la expansión en línea con 1, 2, 4 y 8 hilos,
+ * comprobando que el bytecode sea idéntico en todos los casos, y la latencia
+ * del análisis incremental (reparse.h) por cada tecla sobre un archivo de
+ * 100k líneas frente a volver a analizarlo completo. Por último, cada
+ * programa de bench/programs/ se ejecuta con la máquina virtual con y sin
+ * superinstrucciones, y se reportan las instrucciones despachadas y la
+ * ganancia de tiempo, y el programa generado de la traducción se carga desde
+ * el fuente y desde su módulo precompilado (image.h).
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/arena.h"
+#include "../include/bytecode.h"
+#include "../include/cache.h"
+#include "../include/driver.h"
+#include "../include/image.h"
+#include "../include/inline.h"
+#include "../include/lexer.h"
+#include "../include/parser.h"
+#include "../include/reparse.h"
+#include "../include/sema.h"
+#include "../include/vm.h"
+#include "corpus.h"
+#include "counters.h"
+
+#define BENCH_DEFAULT_SIZE_KB 1024
+#define BENCH_DEFAULT_REPS 5
+#define BENCH_DEFAULT_WARMUP 1
+#define BENCH_DEFAULT_SEED 42UL
+#define BENCH_DEFAULT_FUNCTIONS 4000
+#define BENCH_DEFAULT_REPARSE_LINES 100000
+#define BENCH_DEFAULT_PROGRAMS "bench/programs"
+
+/** Teclas simuladas (cada una se inserta y se borra) al medir el análisis incremental. */
+#define BENCH_REPARSE_KEYS 200
+
+/** Variante de compilación (BUILD del Makefile), para comparar los JSON. */
+#ifndef BENCH_VARIANT
+#define BENCH_VARIANT "desconocida"
+#endif
+
+/* ---- Conteo de reservas ---- */
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+static size_t alloc_count = 0;
+static size_t alloc_bytes = 0;
+
+void *__wrap_malloc(size_t size) {
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+    alloc_count++;
+    alloc_bytes += count * size;
+    return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+    alloc_count++;
+    alloc_bytes += size;
+    return __real_realloc(ptr, size);
+}
+
+/* ---- Fases ---- */
+
+/**
+ * @brief Entrada común a todas las fases.
+ */
+typedef struct BenchInput {
+    const char *path;     /**< Archivo con el fuente (para la fase de lectura) */
+    const char *source;   /**< Fuente en memoria */
+    size_t length;        /**< Bytes del fuente */
+    FILE *sink;           /**< Destino descartable para la salida */
+} BenchInput;
+
+/**
+ * @brief Fase medible; devuelve los tokens procesados (0 si no aplica).
+ */
+typedef struct Phase {
+    const char *name;
+    size_t (*run)(const BenchInput *input);
+} Phase;
+
+/**
+ * @brief Lectura del archivo fuente a memoria.
+ */
+static size_t phase_read(const BenchInput *input) {
+    free(read_file(input->path, NULL, NULL));
+    return 0;
+}
+
+/**
+ * @brief Análisis léxico completo con tokens compactos (sin reservar memoria).
+ */
+static size_t phase_lex(const BenchInput *input) {
+    Lexer lxr;
+    lexer_init(&lxr, input->source);
+    size_t count = 0;
+    LexToken token;
+    while (lexer_next_compact(&lxr, &token)) {
+        count++;
+        if (token.type == TOKEN_EOF) {
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Generación del archivo de tokens (-t) hacia un destino descartable.
+ */
+static size_t phase_write(const BenchInput *input) {
+    int count = write_tokens_to_stream(input->path, input->source, 0, input->sink);
+    return count > 0 ? (size_t)count : 0;
+}
+
+/**
+ * @brief Análisis sintáctico completo (incluye el léxico), solo contando errores.
+ */
+static size_t phase_parse(const BenchInput *input) {
+    ParseResult result;
+    parse_source(input->source, 0, NULL, &result);
+    return result.tokens;
+}
+
+/**
+ * @brief Igual que parse, con el lexer en su propio hilo (--lexer-thread).
+ */
+static size_t phase_parse_thread(const BenchInput *input) {
+    ParseResult result;
+    parse_source(input->source, LEXER_THREADED, NULL, &result);
+    return result.tokens;
+}
+
+/** Hilos de la fase parse-par (--parse-threads); 0 usa los núcleos disponibles. */
+static int parse_threads = 0;
+
+/**
+ * @brief Igual que parse, repartiendo las funciones entre hilos.
+ */
+static size_t phase_parse_parallel(const BenchInput *input) {
+    ParseResult result;
+    parse_source_parallel(input->source, 0, parse_threads, NULL, &result);
+    return result.tokens;
+}
+
+/** Fases en el orden del pipeline; las siguientes se añaden aquí. */
+static const Phase PHASES[] = {
+    { "read", phase_read },
+    { "lex", phase_lex },
+    { "write", phase_write },
+    { "parse", phase_parse },
+    { "parse-thread", phase_parse_thread },
+    { "parse-par", phase_parse_parallel },
+};
+
+#define PHASE_COUNT (sizeof(PHASES) / sizeof(PHASES[0]))
+
+/* ---- Medición ---- */
+
+/**
+ * @brief Opciones de la ejecución.
+ */
+typedef struct BenchOptions {
+    size_t size_bytes;
+    int reps;
+    int warmup;
+    unsigned long seed;
+    const char *only;
+    size_t functions;       /**< Funciones del programa de la traducción (0 para no medirla) */
+    size_t reparse_lines;   /**< Líneas del archivo del análisis incremental (0 para no medirlo) */
+    const char *programs;   /**< Carpeta de los programas de la máquina virtual, o NULL */
+} BenchOptions;
+
+/**
+ * @brief Medición aparte de los corpus, ejecutada en su propio proceso.
+ */
+typedef int (*BenchTask)(const BenchOptions *options, FILE *out);
+
+/**
+ * @brief Devuelve el tiempo monótono en milisegundos.
+ */
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+/**
+ * @brief Comparador para ordenar tiempos.
+ */
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Cuenta los tokens no reconocidos (valida que el corpus es limpio).
+ */
+static size_t count_unknown(const char *source) {
+    Lexer lxr;
+    lexer_init(&lxr, source);
+    size_t unknown = 0;
+    LexToken token;
+    while (lexer_next_compact(&lxr, &token) && token.type != TOKEN_EOF) {
+        unknown += token.type == TOKEN_UNKNOWN;
+    }
+    return unknown;
+}
+
+/**
+ * @brief Escribe en el JSON y en el resumen los contadores de una fase.
+ *
+ * Las cuentas abarcan todas las repeticiones, así que los cocientes no
+ * dependen de su número.
+ */
+static void report_counters(const PerfCounters *counters, int available, size_t bytes, FILE *out) {
+    if (!available) {
+        fprintf(out, ", \"ipc\": null, \"branch_miss_pct\": null, \"instructions_per_byte\": null");
+        return;
+    }
+    const uint64_t *v = counters->values;
+    double ipc = v[COUNTER_CYCLES] > 0 ? (double)v[COUNTER_INSTRUCTIONS] / (double)v[COUNTER_CYCLES] : 0.0;
+    double misses = v[COUNTER_BRANCHES] > 0
+        ? 100.0 * (double)v[COUNTER_BRANCH_MISSES] / (double)v[COUNTER_BRANCHES] : 0.0;
+    double per_byte = bytes > 0 ? (double)v[COUNTER_INSTRUCTIONS] / (double)bytes : 0.0;
+    fprintf(stderr, "         IPC %5.2f  %6.3f%% saltos mal predichos  %7.2f instr/byte\n",
+            ipc, misses, per_byte);
+    fprintf(out, ", \"ipc\": %.3f, \"branch_miss_pct\": %.3f, \"instructions_per_byte\": %.2f",
+            ipc, misses, per_byte);
+}
+
+/**
+ * @brief Análisis léxico completo con la variante indicada.
+ *
+ * @return Tokens producidos, o 0 si la variante no admite el corpus.
+ */
+static size_t lex_with_variant(const BenchInput *input, const char *variant) {
+    Lexer lxr;
+    lexer_init(&lxr, input->source);
+    // Las variantes sin posiciones solo se aceptan con LEXER_NO_POSITIONS.
+    if (lexer_set_variant(&lxr, variant) != 0) {
+        lexer_set_flags(&lxr, LEXER_NO_POSITIONS);
+        if (lexer_set_variant(&lxr, variant) != 0) {
+            return 0;
+        }
+    }
+    size_t count = 0;
+    LexToken token;
+    while (lexer_next_compact(&lxr, &token)) {
+        count++;
+        if (token.type == TOKEN_EOF) {
+            break;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Mide la fase lex con cada variante del lexer que admite el corpus.
+ *
+ * La referencia es la variante completa ("full"); la elegida automáticamente
+ * es la que usa la fase lex.
+ */
+static void measure_variants(const BenchInput *input, const BenchOptions *options,
+                             double *times, FILE *out) {
+    Lexer probe;
+    lexer_init(&probe, input->source);
+    double mb = (double)input->length / (1024.0 * 1024.0);
+    double full_ms = 0.0;
+    fprintf(stderr, "  variante elegida: %s\n", lexer_variant_name(&probe));
+    fprintf(out, "      \"selected_variant\": \"%s\",\n      \"variants\": [", lexer_variant_name(&probe));
+
+    // "full" va la última en la tabla; se mide primero para comparar con ella.
+    size_t count = 0;
+    while (lexer_variant_at(count) != NULL) {
+        count++;
+    }
+    int first = 1;
+    for (size_t n = 0; n < count; n++) {
+        const char *name = lexer_variant_at(n == 0 ? count - 1 : n - 1);
+        if (lex_with_variant(input, name) == 0) {
+            continue;
+        }
+        for (int i = 0; i < options->warmup; i++) {
+            lex_with_variant(input, name);
+        }
+        for (int i = 0; i < options->reps; i++) {
+            double start = now_ms();
+            lex_with_variant(input, name);
+            times[i] = now_ms() - start;
+        }
+        qsort(times, (size_t)options->reps, sizeof(double), compare_double);
+        double median = times[options->reps / 2];
+        double seconds = median > 0.0 ? median / 1e3 : 1e-9;
+        if (n == 0) {
+            full_ms = median;
+        }
+        double speedup = median > 0.0 ? full_ms / median : 0.0;
+        fprintf(stderr, "  lex[%s]%*s %10.3f ms %10.2f MB/s %8.2fx\n",
+                name, (int)(12 - strlen(name)), "", median, mb / seconds, speedup);
+        fprintf(out, "%s\n        { \"name\": \"%s\", \"median_ms\": %.4f, \"mb_per_s\": %.2f, "
+                     "\"speedup_vs_full\": %.3f }",
+                first ? "" : ",", name, median, mb / seconds, speedup);
+        first = 0;
+    }
+    fprintf(out, "\n      ],\n");
+}
+
+/**
+ * @brief Mide todas las fases sobre un corpus y escribe su objeto JSON.
+ *
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+static int measure_corpus(const char *name, const BenchInput *input,
+                          const BenchOptions *options, FILE *out) {
+    double *times = (double *)malloc((size_t)options->reps * sizeof(double));
+    if (times == NULL) {
+        return 1;
+    }
+    PerfCounters counters;
+    int available = counters_open(&counters) == 0;
+    size_t tokens = phase_lex(input);
+    double mb = (double)input->length / (1024.0 * 1024.0);
+
+    fprintf(stderr, "=== %s (%zu bytes, %zu tokens) ===\n", name, input->length, tokens);
+    fprintf(out, "    {\n      \"name\": \"%s\",\n      \"bytes\": %zu,\n"
+                 "      \"tokens\": %zu,\n      \"unknown_tokens\": %zu,\n      \"phases\": [\n",
+            name, input->length, tokens, count_unknown(input->source));
+
+    for (size_t p = 0; p < PHASE_COUNT; p++) {
+        const Phase *phase = &PHASES[p];
+        for (int i = 0; i < options->warmup; i++) {
+            phase->run(input);
+        }
+        alloc_count = 0;
+        alloc_bytes = 0;
+        size_t produced = 0;
+        counters_start(&counters);
+        for (int i = 0; i < options->reps; i++) {
+            double start = now_ms();
+            produced = phase->run(input);
+            times[i] = now_ms() - start;
+        }
+        counters_stop(&counters);
+        size_t allocations = alloc_count / (size_t)options->reps;
+        size_t allocated = alloc_bytes / (size_t)options->reps;
+        qsort(times, (size_t)options->reps, sizeof(double), compare_double);
+        double median = times[options->reps / 2];
+        double seconds = median > 0.0 ? median / 1e3 : 1e-9;
+
+        fprintf(stderr, "  %-6s %10.3f ms %10.2f MB/s %12.0f tokens/s %10zu reservas\n",
+                phase->name, median, mb / seconds, (double)produced / seconds, allocations);
+        fprintf(out, "        { \"name\": \"%s\", \"median_ms\": %.4f, \"min_ms\": %.4f, "
+                     "\"mb_per_s\": %.2f, \"tokens_per_s\": %.0f, "
+                     "\"allocations\": %zu, \"allocated_bytes\": %zu",
+                phase->name, median, times[0], mb / seconds, (double)produced / seconds,
+                allocations, allocated);
+        report_counters(&counters, available, input->length * (size_t)options->reps, out);
+        fprintf(out, " }%s\n", p + 1 < PHASE_COUNT ? "," : "");
+    }
+    if (!available) {
+        fprintf(stderr, "  (contadores de hardware no disponibles en este sistema)\n");
+    }
+    counters_close(&counters);
+    fprintf(out, "      ],\n");
+    measure_variants(input, options, times, out);
+
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    fprintf(stderr, "  pico RSS: %ld KB\n", usage.ru_maxrss);
+    fprintf(out, "      \"peak_rss_kb\": %ld\n    }", usage.ru_maxrss);
+    free(times);
+    return 0;
+}
+
+/**
+ * @brief Mide un corpus sintético; se ejecuta en el proceso hijo.
+ */
+static int run_synthetic(const CorpusMix *mix, const BenchOptions *options, FILE *out, FILE *sink) {
+    size_t length = 0;
+    char *source = corpus_generate(mix, options->size_bytes, options->seed, &length);
+    if (source == NULL) {
+        fprintf(stderr, "Error: Memoria insuficiente para el corpus '%s'\n", mix->name);
+        return 1;
+    }
+
+    char path[] = "/tmp/compilador-bench-XXXXXX";
+    int fd = mkstemp(path);
+    FILE *file = fd >= 0 ? fdopen(fd, "w") : NULL;
+    int failed = file == NULL || fwrite(source, 1, length, file) != length;
+    if (file != NULL) {
+        failed |= fclose(file) != 0;
+    }
+    if (!failed) {
+        BenchInput input = { path, source, length, sink };
+        failed = measure_corpus(mix->name, &input, options, out);
+    } else {
+        fprintf(stderr, "Error: No se pudo escribir el corpus temporal\n");
+    }
+    if (fd >= 0) {
+        unlink(path);
+    }
+    free(source);
+    return failed;
+}
+
+/**
+ * @brief Mide un archivo real; se ejecuta en el proceso hijo.
+ */
+static int run_file(const char *path, const BenchOptions *options, FILE *out, FILE *sink) {
+    char *source = read_file(path, lexer_error_to_stream, stderr);
+    if (source == NULL) {
+        return 1;
+    }
+    BenchInput input = { path, source, strlen(source), sink };
+    int failed = measure_corpus(path, &input, options, out);
+    free(source);
+    return failed;
+}
+
+/* ---- Escalabilidad de la traducción ---- */
+
+/** Hilos con que se mide la traducción; el primero es la referencia. */
+static const int CODEGEN_THREADS[] = { 1, 2, 4, 8 };
+
+#define CODEGEN_THREAD_COUNT (sizeof(CODEGEN_THREADS) / sizeof(CODEGEN_THREADS[0]))
+
+/**
+ * @brief Traduce y expande en línea un programa analizado.
+ *
+ * @param dump Destino del bytecode y sus literales, o NULL.
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+static int codegen_once(const SemaProgram *sema, int threads, FILE *dump) {
+    DiagEngine counter;
+    memset(&counter, 0, sizeof(counter));
+    BcModule module;
+    InlineOptions options;
+    InlineReport report;
+    memset(&report, 0, sizeof(report));
+    inline_options_default(&options);
+    int failed = bc_compile_parallel(sema, BC_VECTORIZE, threads, &counter, &module) != 0
+              || inline_module_parallel(&module, &options, threads, &report) != 0;
+    if (!failed && dump != NULL) {
+        inline_report_print(&report, &module, "bench", dump);
+        bc_disassemble(&module, dump);
+        fwrite(module.strings, 1, module.strings_length, dump);
+    }
+    inline_report_free(&report);
+    bc_free(&module);
+    return failed;
+}
+
+/**
+ * @brief Bytecode de codegen_once() como texto.
+ *
+ * @return El texto (liberar con free()), o NULL si hay error.
+ */
+static char *codegen_dump(const SemaProgram *sema, int threads, size_t *length) {
+    char *text = NULL;
+    FILE *dump = open_memstream(&text, length);
+    if (dump == NULL) {
+        return NULL;
+    }
+    int failed = codegen_once(sema, threads, dump);
+    if (fclose(dump) != 0 || failed) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Mide la traducción con cada número de hilos y escribe su objeto JSON.
+ *
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+static int measure_codegen(const SemaProgram *sema, size_t bytes, const BenchOptions *options, FILE *out) {
+    double *times = (double *)malloc((size_t)options->reps * sizeof(double));
+    size_t expected_length = 0;
+    char *expected = codegen_dump(sema, 1, &expected_length);
+    if (times == NULL || expected == NULL) {
+        free(times);
+        free(expected);
+        return 1;
+    }
+    fprintf(stderr, "=== traducción (%zu funciones, %zu bytes, %ld núcleos) ===\n", sema->function_count,
+            bytes, sysconf(_SC_NPROCESSORS_ONLN));
+    fprintf(out, "  \"codegen\": {\n    \"functions\": %zu,\n    \"bytes\": %zu,\n    \"cores\": %ld,\n"
+                 "    \"threads\": [\n", sema->function_count, bytes, sysconf(_SC_NPROCESSORS_ONLN));
+    int failed = 0;
+    double serial_ms = 0.0;
+    for (size_t t = 0; t < CODEGEN_THREAD_COUNT && !failed; t++) {
+        int threads = CODEGEN_THREADS[t];
+        size_t length = 0;
+        char *actual = codegen_dump(sema, threads, &length);
+        int identical = actual != NULL && length == expected_length && memcmp(actual, expected, length) == 0;
+        free(actual);
+        for (int i = 0; i < options->warmup; i++) {
+            failed |= codegen_once(sema, threads, NULL);
+        }
+        for (int i = 0; i < options->reps && !failed; i++) {
+            double start = now_ms();
+            failed = codegen_once(sema, threads, NULL);
+            times[i] = now_ms() - start;
+        }
+        qsort(times, (size_t)options->reps, sizeof(double), compare_double);
+        double median = times[options->reps / 2];
+        if (t == 0) {
+            serial_ms = median;
+        }
+        double speedup = median > 0.0 ? serial_ms / median : 0.0;
+        fprintf(stderr, "  %d hilo%s %10.3f ms %8.2fx%s\n", threads, threads == 1 ? " " : "s", median, speedup,
+                identical ? "" : "  (¡bytecode distinto!)");
+        fprintf(out, "      { \"threads\": %d, \"median_ms\": %.4f, \"min_ms\": %.4f, \"speedup\": %.3f, "
+                     "\"identical\": %s }%s\n", threads, median, times[0], speedup, identical ? "true" : "false",
+                t + 1 < CODEGEN_THREAD_COUNT ? "," : "");
+        failed |= !identical;
+    }
+    fprintf(out, "    ]\n  }");
+    free(times);
+    free(expected);
+    return failed;
+}
+
+/**
+ * @brief Genera el programa de la traducción, lo analiza y lo mide; se ejecuta en el proceso hijo.
+ */
+static int run_codegen(const BenchOptions *options, FILE *out) {
+    size_t length = 0;
+    char *source = corpus_generate_program(options->functions, options->seed, &length);
+    DiagEngine diag;
+    if (source == NULL || diag_init(&diag, 0) != 0) {
+        fprintf(stderr, "Error: Memoria insuficiente para el programa de la traducción\n");
+        free(source);
+        return 1;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    AstNode *program = NULL;
+    SemaProgram sema;
+    memset(&sema, 0, sizeof(sema));
+    int failed = parse_source_ast(source, 0, &diag, &arena, &program, NULL) != 0
+              || sema_analyze(program, source, &diag, &sema) != 0;
+    if (failed) {
+        diag_print(&diag, "programa generado", stderr);
+    } else {
+        failed = measure_codegen(&sema, length, options, out);
+    }
+    sema_free(&sema);
+    arena_free(&arena);
+    diag_free(&diag);
+    free(source);
+    return failed;
+}
+
+/* ---- Análisis incremental ---- */
+
+/**
+ * @brief Árbol de un análisis como texto.
+ *
+ * @return El texto (liberar con free()), o NULL si falta memoria.
+ */
+static char *ast_dump(const AstNode *program, const char *source) {
+    char *text = NULL;
+    size_t length = 0;
+    FILE *dump = open_memstream(&text, &length);
+    if (dump == NULL) {
+        return NULL;
+    }
+    if (program != NULL) {
+        ast_print(program, source, dump);
+    }
+    if (fclose(dump) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Mide la latencia de edición a AST sobre un programa generado; se ejecuta en el proceso hijo.
+ *
+ * Cada tecla se inserta al principio de una línea al azar y luego se borra,
+ * y ambas ediciones se miden por separado. Al terminar, el texto vuelve a
+ * ser el original y su AST debe coincidir con el de parse_source_ast().
+ */
+static int run_reparse(const BenchOptions *options, FILE *out) {
+    size_t length = 0;
+    char *source = corpus_generate_program(options->reparse_lines / 12 + 1, options->seed, &length);
+    double *times = (double *)malloc((size_t)(options->reps > 2 * BENCH_REPARSE_KEYS
+                                              ? options->reps : 2 * BENCH_REPARSE_KEYS) * sizeof(double));
+    if (source == NULL || times == NULL) {
+        fprintf(stderr, "Error: Memoria insuficiente para el archivo del análisis incremental\n");
+        free(source);
+        free(times);
+        return 1;
+    }
+    size_t lines = 0;
+    for (size_t i = 0; i < length; i++) {
+        lines += source[i] == '\n';
+    }
+
+    Arena arena;
+    arena_init(&arena, 0);
+    AstNode *program = NULL;
+    for (int i = 0; i < options->warmup + options->reps; i++) {
+        arena_reset(&arena);
+        double start = now_ms();
+        parse_source_ast(source, 0, NULL, &arena, &program, NULL);
+        if (i >= options->warmup) {
+            times[i - options->warmup] = now_ms() - start;
+        }
+    }
+    qsort(times, (size_t)options->reps, sizeof(double), compare_double);
+    double full_ms = times[options->reps / 2];
+    char *expected = ast_dump(program, source);
+
+    ReparseDocument doc;
+    double start = now_ms();
+    int failed = reparse_open(&doc, source, length, 0);
+    double open_ms = now_ms() - start;
+    size_t items = doc.item_count;
+    size_t parsed = 0;
+    size_t full = 0;
+    unsigned long long rng = options->seed * 2654435761ULL + 1;
+    for (size_t k = 0; k < BENCH_REPARSE_KEYS && !failed; k++) {
+        rng = rng * 6364136223846793005ULL + 1442695040888963407ULL;
+        size_t at = (size_t)(rng >> 24) % length;
+        while (at > 0 && doc.source[at - 1] != '\n') {
+            at--;
+        }
+        ReparseEdit edits[2] = { { at, 0, "x", 1 }, { at, 1, "", 0 } };
+        for (size_t e = 0; e < 2 && !failed; e++) {
+            ReparseReport report;
+            start = now_ms();
+            failed = reparse_edit(&doc, &edits[e], &report);
+            times[2 * k + e] = now_ms() - start;
+            parsed += report.parsed;
+            full += (size_t)report.full;
+        }
+    }
+    char *actual = failed ? NULL : ast_dump(&doc.program, doc.source);
+    int identical = expected != NULL && actual != NULL && strcmp(expected, actual) == 0;
+    size_t edits = 2 * BENCH_REPARSE_KEYS;
+    qsort(times, edits, sizeof(double), compare_double);
+    double median = times[edits / 2];
+    double p99 = times[edits * 99 / 100];
+
+    fprintf(stderr, "=== análisis incremental (%zu líneas, %zu bytes, %zu items) ===\n", lines, length, items);
+    fprintf(stderr, "  completo %10.3f ms\n  por edición %7.3f ms (p99 %.3f ms, máx %.3f ms, %.1f items)%s\n",
+            full_ms, median, p99, times[edits - 1], (double)parsed / (double)edits,
+            identical ? "" : "  (¡AST distinto!)");
+    fprintf(out, "  \"reparse\": {\n    \"lines\": %zu,\n    \"bytes\": %zu,\n    \"items\": %zu,\n"
+                 "    \"full_parse_ms\": %.4f,\n    \"open_ms\": %.4f,\n    \"edits\": %zu,\n"
+                 "    \"edit_median_ms\": %.4f,\n    \"edit_p99_ms\": %.4f,\n    \"edit_max_ms\": %.4f,\n"
+                 "    \"items_parsed_avg\": %.2f,\n    \"full_reparses\": %zu,\n    \"identical\": %s\n  }",
+            lines, length, items, full_ms, open_ms, edits, median, p99, times[edits - 1],
+            (double)parsed / (double)edits, full, identical ? "true" : "false");
+    reparse_close(&doc);
+    arena_free(&arena);
+    free(expected);
+    free(actual);
+    free(times);
+    free(source);
+    return failed || !identical;
+}
+
+/* ---- Despacho de la máquina virtual ---- */
+
+/** Opciones de la máquina virtual comparadas; la primera es la referencia. */
+static const unsigned DISPATCH_VM_FLAGS[] = { VM_NO_SUPERINSTRUCTIONS, 0 };
+
+#define DISPATCH_VARIANT_COUNT (sizeof(DISPATCH_VM_FLAGS) / sizeof(DISPATCH_VM_FLAGS[0]))
+
+/**
+ * @brief Traduce un programa como --run: con vectorización y expansión en línea.
+ *
+ * @return 0 si es exitoso, 1 si el programa tiene errores o falta memoria.
+ */
+static int compile_program(const char *source, Arena *arena, SemaProgram *sema, BcModule *module) {
+    DiagEngine diag;
+    if (diag_init(&diag, 0) != 0) {
+        return 1;
+    }
+    AstNode *program = NULL;
+    InlineOptions options;
+    InlineReport report;
+    memset(&report, 0, sizeof(report));
+    inline_options_default(&options);
+    int failed = parse_source_ast(source, 0, &diag, arena, &program, NULL) != 0
+              || sema_analyze(program, source, &diag, sema) != 0
+              || bc_compile(sema, BC_VECTORIZE, &diag, module) != 0
+              || inline_module(module, &options, &report) != 0;
+    inline_report_free(&report);
+    diag_free(&diag);
+    return failed;
+}
+
+/**
+ * @brief Ejecuta main con la máquina virtual.
+ *
+ * @param text Si no es NULL, recibe la salida de print() y el resultado
+ *             (liberar con free()); si no, la salida se descarta.
+ * @return Milisegundos de la ejecución, o -1 si falta memoria.
+ */
+static double execute_program(const BcModule *module, unsigned flags, RunResult *result, char **text) {
+    size_t length = 0;
+    FILE *out = text != NULL ? open_memstream(text, &length) : fopen("/dev/null", "w");
+    if (out == NULL) {
+        return -1.0;
+    }
+    double start = now_ms();
+    int status = vm_execute(module, flags, NULL, out, result);
+    double elapsed = now_ms() - start;
+    fprintf(out, "=> %d %d %d\n", status, (int)result->status, result->value);
+    return fclose(out) == 0 ? elapsed : -1.0;
+}
+
+/**
+ * @brief Mide un programa con cada variante de la máquina virtual y escribe su objeto JSON.
+ *
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+static int measure_dispatch(const char *dir, const char *name, const BenchOptions *options, double *times,
+                            FILE *out) {
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    char *source = driver_read_source(path, NULL, NULL);
+    if (source == NULL) {
+        fprintf(stderr, "Error: No se pudo leer el archivo '%s'\n", path);
+        return 1;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    SemaProgram sema;
+    BcModule module;
+    memset(&sema, 0, sizeof(sema));
+    memset(&module, 0, sizeof(module));
+    int failed = compile_program(source, &arena, &sema, &module);
+    uint64_t dispatches[DISPATCH_VARIANT_COUNT] = { 0 };
+    double medians[DISPATCH_VARIANT_COUNT] = { 0.0 };
+    char *expected = NULL;
+    int identical = 1;
+    for (size_t v = 0; v < DISPATCH_VARIANT_COUNT && !failed; v++) {
+        RunResult result;
+        char *text = NULL;
+        failed = execute_program(&module, DISPATCH_VM_FLAGS[v] | VM_COUNT_DISPATCHES, &result, &text) < 0.0;
+        dispatches[v] = result.dispatches;
+        if (v == 0) {
+            expected = text;
+        } else {
+            identical &= text != NULL && expected != NULL && strcmp(text, expected) == 0;
+            free(text);
+        }
+        for (int i = 0; i < options->warmup + options->reps && !failed; i++) {
+            double elapsed = execute_program(&module, DISPATCH_VM_FLAGS[v], &result, NULL);
+            failed = elapsed < 0.0;
+            if (i >= options->warmup) {
+                times[i - options->warmup] = elapsed;
+            }
+        }
+        if (!failed) {
+            qsort(times, (size_t)options->reps, sizeof(double), compare_double);
+            medians[v] = times[options->reps / 2];
+        }
+    }
+    if (!failed) {
+        double speedup = medians[1] > 0.0 ? medians[0] / medians[1] : 0.0;
+        double ratio = dispatches[0] > 0 ? (double)dispatches[1] / (double)dispatches[0] : 0.0;
+        fprintf(stderr, "  %-20s %12llu -> %12llu despachos (%5.1f %%) %10.3f -> %10.3f ms %6.2fx%s\n", name,
+                (unsigned long long)dispatches[0], (unsigned long long)dispatches[1], 100.0 * ratio, medians[0],
+                medians[1], speedup, identical ? "" : "  (¡salida distinta!)");
+        fprintf(out, "      { \"name\": \"%s\", \"dispatches_plain\": %llu, \"dispatches\": %llu, "
+                     "\"dispatch_ratio\": %.4f, \"plain_median_ms\": %.4f, \"median_ms\": %.4f, "
+                     "\"speedup\": %.3f, \"identical\": %s }", name, (unsigned long long)dispatches[0],
+                (unsigned long long)dispatches[1], ratio, medians[0], medians[1], speedup,
+                identical ? "true" : "false");
+    } else {
+        fprintf(stderr, "Error: No se pudo ejecutar '%s'\n", path);
+    }
+    free(expected);
+    bc_free(&module);
+    sema_free(&sema);
+    arena_free(&arena);
+    driver_release_source(source, NULL);
+    return failed || !identical;
+}
+
+/**
+ * @brief Compara strings para qsort() sobre un arreglo de char *.
+ */
+static int compare_name(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/**
+ * @brief Ejecuta cada programa .txt de la carpeta con y sin superinstrucciones; se ejecuta en el proceso hijo.
+ */
+static int run_dispatch(const BenchOptions *options, FILE *out) {
+    DIR *dir = opendir(options->programs);
+    if (dir == NULL) {
+        fprintf(stderr, "Error: No se pudo abrir la carpeta '%s'\n", options->programs);
+        return 1;
+    }
+    char **names = NULL;
+    size_t count = 0;
+    int failed = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && !failed) {
+        size_t length = strlen(entry->d_name);
+        if (length < 5 || strcmp(entry->d_name + length - 4, ".txt") != 0) {
+            continue;
+        }
+        char **grown = (char **)realloc(names, (count + 1) * sizeof(char *));
+        failed = grown == NULL || (grown[count] = strdup(entry->d_name)) == NULL;
+        names = grown != NULL ? grown : names;
+        count += !failed;
+    }
+    closedir(dir);
+    double *times = (double *)malloc((size_t)options->reps * sizeof(double));
+    failed |= times == NULL;
+    if (!failed) {
+        qsort(names, count, sizeof(char *), compare_name);
+        fprintf(stderr, "=== máquina virtual: sin y con superinstrucciones (%s) ===\n", options->programs);
+        fprintf(out, "  \"dispatch\": {\n    \"programs\": [\n");
+        for (size_t i = 0; i < count; i++) {
+            failed |= measure_dispatch(options->programs, names[i], options, times, out);
+            fprintf(out, "%s\n", i + 1 < count ? "," : "");
+        }
+        fprintf(out, "    ]\n  }");
+    }
+    for (size_t i = 0; i < count; i++) {
+        free(names[i]);
+    }
+    free(names);
+    free(times);
+    return failed;
+}
+
+/* ---- Módulos precompilados ---- */
+
+/**
+ * @brief Bytecode y literales de un módulo como texto.
+ *
+ * @return El texto (liberar con free()), o NULL si falta memoria.
+ */
+static char *module_dump(const BcModule *module) {
+    char *text = NULL;
+    size_t length = 0;
+    FILE *dump = open_memstream(&text, &length);
+    if (dump == NULL) {
+        return NULL;
+    }
+    bc_disassemble(module, dump);
+    fwrite(module->strings, 1, module->strings_length, dump);
+    if (fclose(dump) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Lee y traduce el fuente como --run; devuelve los milisegundos o -1 si hay error.
+ */
+static double load_from_source(const char *path) {
+    double start = now_ms();
+    char *source = driver_read_source(path, NULL, NULL);
+    Arena arena;
+    arena_init(&arena, 0);
+    SemaProgram sema;
+    BcModule module;
+    memset(&sema, 0, sizeof(sema));
+    memset(&module, 0, sizeof(module));
+    int failed = source == NULL || compile_program(source, &arena, &sema, &module) != 0;
+    double elapsed = now_ms() - start;
+    bc_free(&module);
+    sema_free(&sema);
+    arena_free(&arena);
+    driver_release_source(source, NULL);
+    return failed ? -1.0 : elapsed;
+}
+
+/**
+ * @brief Proyecta la imagen; devuelve los milisegundos o -1 si hay error.
+ */
+static double load_from_image(const char *path) {
+    double start = now_ms();
+    BcImage image;
+    BcModule module;
+    int failed = image_open(path, &image, &module) != IMAGE_OK;
+    double elapsed = now_ms() - start;
+    if (!failed) {
+        image_close(&image, &module);
+    }
+    return failed ? -1.0 : elapsed;
+}
+
+/**
+ * @brief Mediana de @p reps cargas (tras el calentamiento), o -1 si alguna falla.
+ */
+static double median_load(double (*load)(const char *), const char *path, const BenchOptions *options,
+                          double *times) {
+    for (int i = 0; i < options->warmup + options->reps; i++) {
+        double elapsed = load(path);
+        if (elapsed < 0.0) {
+            return -1.0;
+        }
+        if (i >= options->warmup) {
+            times[i - options->warmup] = elapsed;
+        }
+    }
+    qsort(times, (size_t)options->reps, sizeof(double), compare_double);
+    return times[options->reps / 2];
+}
+
+/**
+ * @brief Compara el arranque desde el fuente con el de su módulo precompilado; se ejecuta en el proceso hijo.
+ *
+ * Sobre el programa generado de la traducción, mide leer y traducir el
+ * fuente (con vectorización y expansión en línea, como --run) frente a
+ * image_open() de la imagen escrita con image_write(), y comprueba que el
+ * módulo cargado sea idéntico al traducido.
+ */
+static int run_module(const BenchOptions *options, FILE *out) {
+    size_t length = 0;
+    char *source = corpus_generate_program(options->functions, options->seed, &length);
+    char source_path[] = "/tmp/bench-source-XXXXXX";
+    char image_path[] = "/tmp/bench-module-XXXXXX";
+    int source_fd = mkstemp(source_path);
+    int image_fd = mkstemp(image_path);
+    FILE *source_file = source_fd >= 0 ? fdopen(source_fd, "w") : NULL;
+    FILE *image_file = image_fd >= 0 ? fdopen(image_fd, "wb") : NULL;
+    double *times = (double *)malloc((size_t)options->reps * sizeof(double));
+    Arena arena;
+    arena_init(&arena, 0);
+    SemaProgram sema;
+    BcModule module;
+    memset(&sema, 0, sizeof(sema));
+    memset(&module, 0, sizeof(module));
+    int failed = source == NULL || source_file == NULL || image_file == NULL || times == NULL
+              || fwrite(source, 1, length, source_file) != length
+              || compile_program(source, &arena, &sema, &module) != 0
+              || image_write(&module, image_file) != 0;
+    long image_bytes = image_file != NULL ? ftell(image_file) : -1;
+    failed |= source_file == NULL || fclose(source_file) != 0;
+    failed |= image_file == NULL || fclose(image_file) != 0;
+
+    int identical = 0;
+    if (!failed) {
+        BcImage image;
+        BcModule loaded;
+        char *expected = module_dump(&module);
+        if (image_open(image_path, &image, &loaded) == IMAGE_OK) {
+            char *actual = module_dump(&loaded);
+            identical = expected != NULL && actual != NULL && strcmp(expected, actual) == 0;
+            free(actual);
+            image_close(&image, &loaded);
+        }
+        free(expected);
+    }
+    double source_ms = failed ? -1.0 : median_load(load_from_source, source_path, options, times);
+    double image_ms = failed ? -1.0 : median_load(load_from_image, image_path, options, times);
+    failed |= source_ms < 0.0 || image_ms < 0.0;
+    if (!failed) {
+        double speedup = image_ms > 0.0 ? source_ms / image_ms : 0.0;
+        fprintf(stderr, "=== módulo precompilado (%zu funciones, %zu bytes de fuente, %ld de módulo) ===\n",
+                module.function_count, length, image_bytes);
+        fprintf(stderr, "  fuente %10.3f ms  módulo %10.3f ms %8.2fx%s\n", source_ms, image_ms, speedup,
+                identical ? "" : "  (¡módulo distinto!)");
+        fprintf(out, "  \"module\": {\n    \"functions\": %zu,\n    \"source_bytes\": %zu,\n"
+                     "    \"module_bytes\": %ld,\n    \"source_median_ms\": %.4f,\n"
+                     "    \"module_median_ms\": %.4f,\n    \"speedup\": %.3f,\n    \"identical\": %s\n  }",
+                module.function_count, length, image_bytes, source_ms, image_ms, speedup,
+                identical ? "true" : "false");
+    }
+    if (source_fd >= 0) {
+        remove(source_path);
+    }
+    if (image_fd >= 0) {
+        remove(image_path);
+    }
+    bc_free(&module);
+    sema_free(&sema);
+    arena_free(&arena);
+    free(times);
+    free(source);
+    return failed || !identical;
+}
+
+/**
+ * @brief Ejecuta una medición en un proceso hijo y espera su resultado.
+ *
+ * Con @p mix y @p path en NULL ejecuta @p task.
+ *
+ * @return 0 si el hijo terminó correctamente, 1 en caso contrario.
+ */
+static int run_isolated(const CorpusMix *mix, const char *path, BenchTask task, const BenchOptions *options,
+                        FILE *out, FILE *sink) {
+    fflush(out);
+    fflush(stderr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        return 1;
+    }
+    if (pid == 0) {
+        int failed = mix != NULL ? run_synthetic(mix, options, out, sink)
+                   : path != NULL ? run_file(path, options, out, sink)
+                   : task(options, out);
+        fflush(out);
+        fflush(stderr);
+        _exit(failed);
+    }
+    int status = 0;
+    if (waitpid(pid, &status, 0) < 0) {
+        return 1;
+    }
+    return !WIFEXITED(status) || WEXITSTATUS(status) != 0;
+}
+
+/**
+ * @brief Imprime la ayuda de uso.
+ */
+static void print_usage(const char *program_name) {
+    printf("Uso: %s [opciones] [archivo]...\n", program_name);
+    printf("Opciones:\n");
+    printf("  --size <KB>      Tamaño de cada corpus sintético (por defecto %d KB)\n", BENCH_DEFAULT_SIZE_KB);
+    printf("  --reps <n>       Repeticiones medidas por fase (por defecto %d)\n", BENCH_DEFAULT_REPS);
+    printf("  --warmup <n>     Repeticiones de calentamiento (por defecto %d)\n", BENCH_DEFAULT_WARMUP);
+    printf("  --seed <n>       Semilla de los corpus (por defecto %lu)\n", BENCH_DEFAULT_SEED);
+    printf("  --corpus <name>  Medir solo un corpus sintético (o 'ninguno')\n");
+    printf("  --parse-threads <n>  Hilos de la fase parse-par (por defecto, núcleos disponibles)\n");
+    printf("  --functions <n>  Funciones del programa con que se mide la traducción con 1 a 8 hilos\n"
+           "                   y la carga de su módulo precompilado (por defecto %d; 0 para no medirlas)\n",
+           BENCH_DEFAULT_FUNCTIONS);
+    printf("  --reparse-lines <n>  Líneas del archivo con que se mide el análisis incremental\n"
+           "                   (por defecto %d; 0 para no medirlo)\n", BENCH_DEFAULT_REPARSE_LINES);
+    printf("  --programs <dir> Programas que se ejecutan con la máquina virtual con y sin superinstrucciones\n"
+           "                   (por defecto %s; 'ninguno' para no medirlos)\n", BENCH_DEFAULT_PROGRAMS);
+    printf("  --out <archivo>  Escribir el JSON en un archivo en lugar de stdout\n");
+    printf("Corpus sintéticos:");
+    for (size_t i = 0; i < CORPUS_MIX_COUNT; i++) {
+        printf(" %s", CORPUS_MIXES[i].name);
+    }
+    printf("\nLos archivos indicados se miden además de los corpus sintéticos.\n");
+}
+
+/**
+ * @brief Función principal de las pruebas de rendimiento.
+ */
+int main(int argc, char *argv[]) {
+    BenchOptions options = {
+        (size_t)BENCH_DEFAULT_SIZE_KB * 1024, BENCH_DEFAULT_REPS, BENCH_DEFAULT_WARMUP,
+        BENCH_DEFAULT_SEED, NULL, BENCH_DEFAULT_FUNCTIONS, BENCH_DEFAULT_REPARSE_LINES, BENCH_DEFAULT_PROGRAMS
+    };
+    const char *out_path = NULL;
+    char **files = (char **)malloc((size_t)argc * sizeof(char *));
+    size_t file_count = 0;
+    if (files == NULL) {
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--size") == 0 && has_value && atol(argv[i + 1]) > 0) {
+            options.size_bytes = (size_t)atol(argv[++i]) * 1024;
+        } else if (strcmp(argv[i], "--reps") == 0 && has_value && atoi(argv[i + 1]) > 0) {
+            options.reps = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--warmup") == 0 && has_value && atoi(argv[i + 1]) >= 0) {
+            options.warmup = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            options.seed = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--corpus") == 0 && has_value) {
+            options.only = argv[++i];
+        } else if (strcmp(argv[i], "--parse-threads") == 0 && has_value && atoi(argv[i + 1]) >= 0) {
+            parse_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--functions") == 0 && has_value && atol(argv[i + 1]) >= 0) {
+            options.functions = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--reparse-lines") == 0 && has_value && atol(argv[i + 1]) >= 0) {
+            options.reparse_lines = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--programs") == 0 && has_value) {
+            options.programs = strcmp(argv[i + 1], "ninguno") == 0 ? NULL : argv[i + 1];
+            i++;
+        } else if (strcmp(argv[i], "--out") == 0 && has_value) {
+            out_path = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            free(files);
+            return 0;
+        } else if (argv[i][0] != '-') {
+            files[file_count++] = argv[i];
+        } else {
+            fprintf(stderr, "Error: Opción desconocida o sin valor '%s'\n\n", argv[i]);
+            print_usage(argv[0]);
+            free(files);
+            return 1;
+        }
+    }
+
+    FILE *out = out_path != NULL ? fopen(out_path, "w") : stdout;
+    FILE *sink = fopen("/dev/null", "w");
+    if (out == NULL || sink == NULL) {
+        fprintf(stderr, "Error: No se pudo abrir la salida\n");
+        free(files);
+        return 1;
+    }
+
+    fprintf(out, "{\n  \"version\": \"%s\",\n  \"variant\": \"%s\",\n  \"size_bytes\": %zu,\n  \"seed\": %lu,\n"
+                 "  \"warmup\": %d,\n  \"reps\": %d,\n  \"corpora\": [\n",
+            COMPILADOR_VERSION, BENCH_VARIANT, options.size_bytes, options.seed, options.warmup, options.reps);
+
+    int failed = 0;
+    int first = 1;
+    for (size_t i = 0; i < CORPUS_MIX_COUNT + file_count; i++) {
+        const CorpusMix *mix = i < CORPUS_MIX_COUNT ? &CORPUS_MIXES[i] : NULL;
+        if (mix != NULL && options.only != NULL && strcmp(options.only, mix->name) != 0) {
+            continue;
+        }
+        if (!first) {
+            fprintf(out, ",\n");
+        }
+        first = 0;
+        const char *path = mix == NULL ? files[i - CORPUS_MIX_COUNT] : NULL;
+        if (run_isolated(mix, path, NULL, &options, out, sink) != 0) {
+            fprintf(stderr, "Error: Falló la medición de '%s'\n", mix ? mix->name : path);
+            fprintf(out, "    { \"name\": \"%s\", \"error\": true }", mix ? mix->name : path);
+            failed = 1;
+        }
+    }
+    fprintf(out, "\n  ]");
+    if (options.functions > 0) {
+        fprintf(out, ",\n");
+        if (run_isolated(NULL, NULL, run_codegen, &options, out, sink) != 0) {
+            fprintf(stderr, "Error: Falló la medición de la traducción\n");
+            fprintf(out, "  \"codegen\": { \"error\": true }");
+            failed = 1;
+        }
+    }
+    if (options.reparse_lines > 0) {
+        fprintf(out, ",\n");
+        if (run_isolated(NULL, NULL, run_reparse, &options, out, sink) != 0) {
+            fprintf(stderr, "Error: Falló la medición del análisis incremental\n");
+            fprintf(out, "  \"reparse\": { \"error\": true }");
+            failed = 1;
+        }
+    }
+    if (options.programs != NULL) {
+        fprintf(out, ",\n");
+        if (run_isolated(NULL, NULL, run_dispatch, &options, out, sink) != 0) {
+            fprintf(stderr, "Error: Falló la medición de la máquina virtual\n");
+            fprintf(out, "  \"dispatch\": { \"error\": true }");
+            failed = 1;
+        }
+    }
+    if (options.functions > 0) {
+        fprintf(out, ",\n");
+        if (run_isolated(NULL, NULL, run_module, &options, out, sink) != 0) {
+            fprintf(stderr, "Error: Falló la medición del módulo precompilado\n");
+            fprintf(out, "  \"module\": { \"error\": true }");
+            failed = 1;
+        }
+    }
+    fprintf(out, "\n}\n");
+
+    fclose(sink);
+    if (out != stdout) {
+        fclose(out);
+        fprintf(stderr, "✓ Resultados en: %s\n", out_path);
+    }
+    free(files);
+    return failed;
+}
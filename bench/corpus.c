@@ -0,0 +1,232 @@
+/**
+ * @file corpus.c
+ * @brief Implementación del generador de corpus sintéticos.
+ */
+#include "corpus.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Sentencias por función generada. */
+#define STATEMENTS_PER_FUNCTION 24
+
+/**
+ * @brief Mezclas predefinidas: una dominante por cada clase de token, una
+ * equilibrada y dos que permiten las variantes especializadas del lexer.
+ */
+const CorpusMix CORPUS_MIXES[] = {
+    { "identificadores", 8, 1, 1, 0 },
+    { "comentarios",     1, 8, 1, 0 },
+    { "numeros",         1, 1, 8, 0 },
+    { "cadenas",         1, 1, 0, 8 },
+    { "mixto",           3, 2, 3, 2 },
+    // Sin comentarios ni texto no ASCII; "basico" tampoco tiene bases 16/2 ni caracteres.
+    { "sin-comentarios", 4, 0, 3, 2 },
+    { "basico",          1, 0, 0, 0 },
+};
+
+const size_t CORPUS_MIX_COUNT = sizeof(CORPUS_MIXES) / sizeof(CORPUS_MIXES[0]);
+
+/**
+ * @brief Búfer de texto que crece según se necesita.
+ */
+typedef struct TextBuffer {
+    char *data;
+    size_t length;
+    size_t capacity;
+} TextBuffer;
+
+/**
+ * @brief Añade texto con formato al búfer.
+ *
+ * @return 0 si es exitoso, 1 si no hay memoria.
+ */
+static int append(TextBuffer *buf, const char *format, ...) {
+    for (;;) {
+        va_list args;
+        va_start(args, format);
+        size_t room = buf->capacity - buf->length;
+        int n = vsnprintf(buf->data + buf->length, room, format, args);
+        va_end(args);
+        if (n < 0) {
+            return 1;
+        }
+        if ((size_t)n < room) {
+            buf->length += (size_t)n;
+            return 0;
+        }
+        size_t capacity = buf->capacity * 2 + (size_t)n;
+        char *data = (char *)realloc(buf->data, capacity);
+        if (data == NULL) {
+            return 1;
+        }
+        buf->data = data;
+        buf->capacity = capacity;
+    }
+}
+
+/**
+ * @brief Generador pseudoaleatorio xorshift64 (determinista y portable).
+ */
+static unsigned long next_random(unsigned long long *state) {
+    unsigned long long x = *state;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    *state = x;
+    return (unsigned long)(x >> 11);
+}
+
+/** Raíces de identificadores; se combinan con sufijos para variar longitudes. */
+static const char *const NAMES[] = {
+    "contador", "indice", "total", "valor_actual", "x", "y", "_tmp", "resultado",
+    "acumulador_parcial", "limite", "n", "paso", "suma_total", "buffer_entrada",
+};
+
+#define NAME_COUNT (sizeof(NAMES) / sizeof(NAMES[0]))
+
+/**
+ * @brief Escribe una sentencia con predominio de identificadores y operadores.
+ */
+static int emit_identifiers(TextBuffer *buf, unsigned long long *rng) {
+    unsigned long a = next_random(rng);
+    unsigned long b = next_random(rng);
+    return append(buf, "    let mut %s%lu = %s%lu + %s * (%s%lu - %s) / %s%lu;\n",
+                  NAMES[a % NAME_COUNT], a % 97, NAMES[b % NAME_COUNT], b % 13,
+                  NAMES[(a >> 8) % NAME_COUNT], NAMES[(b >> 8) % NAME_COUNT], a % 7,
+                  NAMES[(a >> 16) % NAME_COUNT], NAMES[(b >> 16) % NAME_COUNT], b % 31);
+}
+
+/**
+ * @brief Escribe un comentario de línea o de bloque.
+ */
+static int emit_comment(TextBuffer *buf, unsigned long long *rng) {
+    unsigned long r = next_random(rng);
+    if (r % 3 == 0) {
+        return append(buf,
+                      "    /* Comentario de bloque %lu: describe el propósito del\n"
+                      "       siguiente tramo y las invariantes que se mantienen. */\n", r % 1000);
+    }
+    return append(buf, "    // Comentario de línea %lu sobre %s y %s, sin efecto en los tokens\n",
+                  r % 1000, NAMES[r % NAME_COUNT], NAMES[(r >> 8) % NAME_COUNT]);
+}
+
+/**
+ * @brief Escribe una sentencia con literales numéricos de todas las bases.
+ */
+static int emit_numbers(TextBuffer *buf, unsigned long long *rng) {
+    unsigned long a = next_random(rng);
+    unsigned long b = next_random(rng);
+    return append(buf, "    let n%lu = %lu + 0x%lX * %lu.%02lu - 0b%s + %lu.%lue-%lu;\n",
+                  a % 50, a % 100000, b % 0xFFFFF, b % 1000, a % 100,
+                  (a & 1) ? "101101" : "1110", b % 10, a % 1000, b % 9 + 1);
+}
+
+/**
+ * @brief Escribe una sentencia con literales de cadena y de carácter.
+ */
+static int emit_strings(TextBuffer *buf, unsigned long long *rng) {
+    unsigned long r = next_random(rng);
+    return append(buf, "    let s%lu = \"Mensaje %lu con texto \\\"escapado\\\" y %s\"; let c = '%c';\n",
+                  r % 50, r % 10000, NAMES[r % NAME_COUNT], 'a' + (int)(r % 26));
+}
+
+/**
+ * @brief Genera un corpus de aproximadamente @p target_bytes bytes.
+ *
+ * @param mix Mezcla de sentencias.
+ * @param target_bytes Tamaño mínimo del corpus.
+ * @param seed Semilla del generador (distinta de cero).
+ * @param length Destino de la longitud generada.
+ * @return El texto terminado en '\0', reservado con malloc, o NULL si no hay memoria.
+ */
+char *corpus_generate(const CorpusMix *mix, size_t target_bytes, unsigned long seed, size_t *length) {
+    TextBuffer buf = { NULL, 0, 0 };
+    buf.capacity = target_bytes + 4096;
+    buf.data = (char *)malloc(buf.capacity);
+    if (buf.data == NULL) {
+        return NULL;
+    }
+    buf.data[0] = '\0';
+
+    unsigned long long rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+    int total = mix->identifiers + mix->comments + mix->numbers + mix->strings;
+    int failed = total <= 0;
+    for (unsigned long fn = 0; !failed && buf.length < target_bytes; fn++) {
+        failed = append(&buf, "fn funcion_%lu(a: i32, b: f64) {\n", fn);
+        for (int i = 0; !failed && i < STATEMENTS_PER_FUNCTION; i++) {
+            int pick = (int)(next_random(&rng) % (unsigned long)total);
+            if ((pick -= mix->identifiers) < 0) {
+                failed = emit_identifiers(&buf, &rng);
+            } else if ((pick -= mix->comments) < 0) {
+                failed = emit_comment(&buf, &rng);
+            } else if ((pick -= mix->numbers) < 0) {
+                failed = emit_numbers(&buf, &rng);
+            } else {
+                failed = emit_strings(&buf, &rng);
+            }
+        }
+        failed = failed || append(&buf, "    return a;\n}\n\n");
+    }
+    if (failed) {
+        free(buf.data);
+        return NULL;
+    }
+    *length = buf.length;
+    return buf.data;
+}
+
+/**
+ * @brief Genera un programa que pasa el análisis semántico con @p functions funciones y main.
+ *
+ * Cada función suma en un ciclo vectorizable, usa literales de cadena (que
+ * se repiten entre funciones) y llama a funciones anteriores, pequeñas o no,
+ * de modo que la expansión en línea tiene trabajo; una de cada 16 es
+ * recursiva. main llama a las últimas.
+ *
+ * @param functions Funciones además de main (al menos 1).
+ * @param seed Semilla del generador (distinta de cero).
+ * @param length Destino de la longitud generada.
+ * @return El texto terminado en '\0', reservado con malloc, o NULL si no hay memoria.
+ */
+char *corpus_generate_program(size_t functions, unsigned long seed, size_t *length) {
+    TextBuffer buf = { NULL, 0, 0 };
+    buf.capacity = functions * 320 + 4096;
+    buf.data = (char *)malloc(buf.capacity);
+    if (buf.data == NULL) {
+        return NULL;
+    }
+    buf.data[0] = '\0';
+
+    unsigned long long rng = seed ? seed : 0x9E3779B97F4A7C15ULL;
+    int failed = functions == 0;
+    for (size_t fn = 0; !failed && fn < functions; fn++) {
+        unsigned long step = next_random(&rng) % 9 + 1;
+        failed = append(&buf, "fn f_%zu(a: i32, b: i32) -> i32 {\n    let mut t = a;\n", fn)
+              || append(&buf, "    for k in 0..b {\n        t += k * %lu;\n    }\n", step);
+        if (!failed && fn % 16 == 15) {
+            failed = append(&buf, "    if b > 0 {\n        return f_%zu(a, b - 1) + 1;\n    }\n", fn);
+        }
+        if (!failed && fn > 0) {
+            size_t callee = fn - 1 - next_random(&rng) % (fn < 8 ? fn : 8);
+            failed = append(&buf, "    if t > %lu {\n        t = t %% %lu + f_%zu(t, 2);\n    }\n",
+                            next_random(&rng) % 1000, next_random(&rng) % 97 + 1, callee);
+        }
+        if (!failed) {
+            failed = append(&buf, "    let s = \"cadena %lu\" + \"x\";\n    return t + len(s);\n}\n\n",
+                            next_random(&rng) % 64);
+        }
+    }
+    failed = failed || append(&buf, "fn main() -> i32 {\n    let mut r = 0;\n");
+    for (size_t fn = functions > 4 ? functions - 4 : 0; !failed && fn < functions; fn++) {
+        failed = append(&buf, "    r += f_%zu(%zu, 10);\n", fn, fn % 7);
+    }
+    failed = failed || append(&buf, "    print(r);\n    return 0;\n}\n");
+    if (failed) {
+        free(buf.data);
+        return NULL;
+    }
+    *length = buf.length;
+    return buf.data;
+}
@@ -0,0 +1,34 @@
+/**
+ * @file corpus.h
+ * @brief Generación de corpus sintéticos para las pruebas de rendimiento.
+ *
+ * Cada corpus es un programa válido del lenguaje cuya mezcla de tokens se
+ * controla con pesos por tipo de sentencia; corpus_generate_program() genera
+ * además programas que pasan el análisis semántico, para medir la
+ * traducción a bytecode. La generación es determinista:
+ * la misma semilla y el mismo tamaño producen siempre el mismo texto.
+ */
+
+#ifndef BENCH_CORPUS_H
+#define BENCH_CORPUS_H
+
+#include <stddef.h>
+
+/**
+ * @brief Mezcla de sentencias de un corpus (pesos relativos).
+ */
+typedef struct CorpusMix {
+    const char *name;   /**< Nombre del corpus en el informe */
+    int identifiers;    /**< Expresiones con muchos identificadores */
+    int comments;       /**< Comentarios de línea y de bloque */
+    int numbers;        /**< Literales enteros, hexadecimales, binarios y reales */
+    int strings;        /**< Literales de cadena y de carácter */
+} CorpusMix;
+
+extern const CorpusMix CORPUS_MIXES[];
+extern const size_t CORPUS_MIX_COUNT;
+
+char *corpus_generate(const CorpusMix *mix, size_t target_bytes, unsigned long seed, size_t *length);
+char *corpus_generate_program(size_t functions, unsigned long seed, size_t *length);
+
+#endif // BENCH_CORPUS_H
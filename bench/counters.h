@@ -0,0 +1,40 @@
+/**
+ * @file counters.h
+ * @brief Contadores de hardware (perf_event_open) para las pruebas de rendimiento.
+ *
+ * Se cuentan ciclos, instrucciones, saltos y saltos mal predichos del propio
+ * proceso en modo usuario. En máquinas virtuales o con
+ * kernel.perf_event_paranoid alto los contadores no existen; entonces
+ * counters_open() devuelve 1 y las mediciones siguen solo con tiempos.
+ */
+
+#ifndef BENCH_COUNTERS_H
+#define BENCH_COUNTERS_H
+
+#include <stdint.h>
+
+/**
+ * @brief Eventos medidos, en el orden de PerfCounters.values.
+ */
+typedef enum CounterEvent {
+    COUNTER_CYCLES,
+    COUNTER_INSTRUCTIONS,
+    COUNTER_BRANCHES,
+    COUNTER_BRANCH_MISSES,
+    COUNTER_COUNT
+} CounterEvent;
+
+/**
+ * @brief Grupo de contadores abiertos y sus últimas lecturas.
+ */
+typedef struct PerfCounters {
+    int fds[COUNTER_COUNT];           /**< Descriptor de cada evento (-1 si no está) */
+    uint64_t values[COUNTER_COUNT];   /**< Cuentas entre counters_start() y counters_stop() */
+} PerfCounters;
+
+int counters_open(PerfCounters *counters);
+void counters_start(PerfCounters *counters);
+void counters_stop(PerfCounters *counters);
+void counters_close(PerfCounters *counters);
+
+#endif // BENCH_COUNTERS_H
@@ -0,0 +1,63 @@
+#!/bin/sh
+# Latencia de inicio a resultado de un programa: --run (máquina virtual),
+# --jit, ambos sin expansión en línea (--no-inline) y sin vectorización
+# (--no-vectorize), la máquina virtual sin superinstrucciones
+# (--no-superinstructions), el JIT con SSE2 en lugar de AVX2
+# (--vectorize=sse2), ambos con cada String y Array pedido a malloc
+# (--malloc-heap), ambos desde un módulo precompilado con --emit-module
+# (--module) y una compilación AOT de su equivalente en C con gcc (compilar y
+# ejecutar, y solo ejecutar). Cada medida es el promedio de REPS procesos
+# tras uno de calentamiento.
+#
+# Uso: bench/latency.sh <compilador> <reps> <programa.txt>...
+# (el equivalente en C de cada programa está junto a él con extensión .c)
+set -e
+COMPILER=$1
+REPS=$2
+shift 2
+WORK=${TMPDIR:-/tmp}/compilador-latency-$$
+mkdir -p "$WORK"
+trap 'rm -rf "$WORK"' EXIT
+
+now() { date +%s%N; }
+
+# measure <etiqueta> <comando>...: promedio en ms de REPS ejecuciones
+measure() {
+    label=$1
+    shift
+    "$@" > /dev/null 2>&1 || true
+    start=$(now)
+    i=0
+    while [ "$i" -lt "$REPS" ]; do
+        "$@" > /dev/null 2>&1 || true
+        i=$((i + 1))
+    done
+    end=$(now)
+    awk -v l="$label" -v s="$start" -v e="$end" -v r="$REPS" \
+        'BEGIN { printf "  %-30s %9.3f ms\n", l, (e - s) / r / 1e6 }'
+}
+
+aot() {
+    gcc -O2 -o "$WORK/aot" "$1" && "$WORK/aot"
+}
+
+for program in "$@"; do
+    c_source=${program%.txt}.c
+    echo "$program ($REPS repeticiones)"
+    measure "--run (máquina virtual)" "$COMPILER" --run "$program"
+    measure "--run --no-inline" "$COMPILER" --run --no-inline "$program"
+    measure "--run --no-superinstructions" "$COMPILER" --run --no-superinstructions "$program"
+    measure "--run --no-vectorize" "$COMPILER" --run --no-vectorize "$program"
+    measure "--jit" "$COMPILER" --jit "$program"
+    measure "--jit --no-inline" "$COMPILER" --jit --no-inline "$program"
+    measure "--jit --vectorize=sse2" "$COMPILER" --jit --vectorize=sse2 "$program"
+    measure "--jit --no-vectorize" "$COMPILER" --jit --no-vectorize "$program"
+    measure "--run --malloc-heap" "$COMPILER" --run --malloc-heap "$program"
+    measure "--jit --malloc-heap" "$COMPILER" --jit --malloc-heap "$program"
+    "$COMPILER" --emit-module "$WORK/module.cbc" "$program" > /dev/null
+    measure "--run --module" "$COMPILER" --run --module "$WORK/module.cbc"
+    measure "--jit --module" "$COMPILER" --jit --module "$WORK/module.cbc"
+    measure "AOT: gcc -O2 + ejecución" aot "$c_source"
+    gcc -O2 -o "$WORK/aot" "$c_source"
+    measure "AOT: solo ejecución" "$WORK/aot"
+done
@@ -0,0 +1,28 @@
+/* Equivalente en C de ayudantes.txt para la línea base AOT */
+#include <stdint.h>
+#include <stdio.h>
+
+static int32_t minimo(int32_t a, int32_t b) {
+    return a < b ? a : b;
+}
+
+static int32_t absoluto(int32_t x) {
+    return x < 0 ? -x : x;
+}
+
+static int32_t mezclar(int32_t h, int32_t x) {
+    return (int32_t)((uint32_t)h * 31u + (uint32_t)x);
+}
+
+static int32_t paso(int32_t i) {
+    return minimo(absoluto(i % 1000 - 500), 300);
+}
+
+int main(void) {
+    int32_t h = 0;
+    for (int32_t i = 0; i < 3000000; i++) {
+        h = mezclar(h, paso(i));
+    }
+    printf("%d\n", h);
+    return 0;
+}
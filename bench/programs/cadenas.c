@@ -0,0 +1,37 @@
+/* Equivalente en C de cadenas.txt para la línea base AOT (cada objeto con malloc) */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int32_t *par(int32_t a, int32_t b) {
+    int32_t *p = malloc(2 * sizeof(int32_t));
+    p[0] = a;
+    p[1] = b;
+    return p;
+}
+
+static int32_t paso(int32_t i) {
+    int32_t *p = par(i, i + 1);
+    int32_t *t = malloc(3 * sizeof(int32_t));
+    memcpy(t, p, 2 * sizeof(int32_t));
+    t[2] = (int32_t)((uint32_t)i * 3u);
+    size_t s_length = strlen("clave-") + strlen("valor");
+    char *s = malloc(s_length);
+    memcpy(s, "clave-", 6);
+    memcpy(s + 6, "valor", 5);
+    int32_t result = (int32_t)((uint32_t)t[2] + 3u + (uint32_t)s_length);
+    free(s);
+    free(t);
+    free(p);
+    return result;
+}
+
+int main(void) {
+    uint32_t total = 0;
+    for (int32_t i = 0; i < 1000000; i++) {
+        total += (uint32_t)paso(i);
+    }
+    printf("%d\n", (int32_t)total);
+    return 0;
+}
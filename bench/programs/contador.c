@@ -0,0 +1,15 @@
+// Equivalente en C de contador.txt
+#include <stdio.h>
+
+int main(void) {
+    int contador = 0;
+    int pares = 0;
+    while (contador < 10000000) {
+        if (contador % 2 == 0) {
+            pares = pares + 1;
+        }
+        contador = contador + 1;
+    }
+    printf("%d\n", pares);
+    return 0;
+}
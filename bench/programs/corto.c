@@ -0,0 +1,15 @@
+/* Equivalente en C de corto.txt para la línea base AOT */
+#include <stdio.h>
+
+static int cuadrado(int x) {
+    return x * x;
+}
+
+int main(void) {
+    int suma = 0;
+    for (int i = 0; i < 100; i++) {
+        suma += cuadrado(i);
+    }
+    printf("%d\n", suma);
+    return 0;
+}
@@ -0,0 +1,14 @@
+/* Equivalente en C de fib.txt para la línea base AOT */
+#include <stdio.h>
+
+static int fib(int n) {
+    if (n < 2) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+
+int main(void) {
+    printf("%d\n", fib(27));
+    return 0;
+}
@@ -0,0 +1,22 @@
+/* Equivalente en C de reducciones.txt para la línea base AOT */
+#include <stdint.h>
+#include <stdio.h>
+
+int main(void) {
+    uint32_t suma = 0;
+    int32_t menor = 2147483647;
+    int32_t mayor = -2147483647;
+    for (uint32_t i = 0; i < 20000000u; i++) {
+        suma += i * i - 3u * i + 7u;
+        int32_t producto = (int32_t)((i * 7919u) * (i + 13u));
+        if (producto < menor) {
+            menor = producto;
+        }
+        int32_t parabola = (int32_t)(i * 31u - i * i);
+        if (mayor < parabola) {
+            mayor = parabola;
+        }
+    }
+    printf("%d\n%d\n%d\n", (int32_t)suma, menor, mayor);
+    return 0;
+}
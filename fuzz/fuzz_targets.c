@@ -0,0 +1,295 @@
+/**
+ * @file fuzz_targets.c
+ * @brief Puntos de entrada de fuzzing para el lexer y el parser.
+ *
+ * Define LLVMFuzzerTestOneInput() para libFuzzer; el mismo archivo se enlaza
+ * con standalone.c para AFL++ o para reproducir un corpus sin clang. El
+ * objetivo se elige al compilar con -DFUZZ_TARGET=<n> (ver Makefile):
+ *
+ *  - FUZZ_TARGET_LEXER: lexer_next_token() frente a lexer_next_compact(),
+ *    TokenStream con anticipación variable y cada variante especializada
+ *    del lexer que admite la entrada.
+ *  - FUZZ_TARGET_TOKENIZE: tokenize_all() frente a lexer_next_compact().
+ *  - FUZZ_TARGET_PARSER: parse_source() con y sin motor de diagnósticos.
+ *
+ * La entrada se copia a un búfer propio terminado en '\0', que es la
+ * invariante de la que dependen lxr_peek_next() y los saltos SIMD; los bytes
+ * a partir del primer '\0' no forman parte del fuente. Cualquier diferencia
+ * entre la ruta rápida y la de referencia llama a abort() para que el fuzzer
+ * la registre como fallo, igual que un error de ASan o UBSan.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../include/diag.h"
+#include "../include/lexer.h"
+#include "../include/parser.h"
+#include "../include/token_stream.h"
+
+#define FUZZ_TARGET_LEXER 1
+#define FUZZ_TARGET_TOKENIZE 2
+#define FUZZ_TARGET_PARSER 3
+
+#ifndef FUZZ_TARGET
+#define FUZZ_TARGET FUZZ_TARGET_LEXER
+#endif
+
+/** Entradas más grandes se recortan: el coste es lineal y no aporta cobertura. */
+#define FUZZ_MAX_INPUT (64 * 1024)
+
+/**
+ * @brief Reporta una diferencia y aborta.
+ */
+static void fuzz_fail(const char *what, size_t index, TokenType type, size_t line, size_t column) {
+    fprintf(stderr, "fuzz: %s en el token %zu (%s, %zu:%zu)\n",
+            what, index, token_type_name(type), line, column);
+    abort();
+}
+
+#if FUZZ_TARGET == FUZZ_TARGET_LEXER
+/**
+ * @brief Comprueba que un token compacto es coherente con el fuente.
+ */
+static void check_compact(const LexToken *token, size_t index, size_t length,
+                          size_t *last_line, size_t *last_column) {
+    if ((size_t)token->offset + token->length > length) {
+        fuzz_fail("lexema fuera del fuente", index, token->type, token->line, token->column);
+    }
+    if (token->type != TOKEN_EOF && token->length == 0) {
+        fuzz_fail("lexema vacío", index, token->type, token->line, token->column);
+    }
+    if (token->line < *last_line || (token->line == *last_line && token->column < *last_column)) {
+        fuzz_fail("posición decreciente", index, token->type, token->line, token->column);
+    }
+    *last_line = token->line;
+    *last_column = token->column;
+}
+
+/**
+ * @brief Cada variante que admite el fuente debe dar los tokens de referencia.
+ *
+ * Sin diagnósticos y con y sin LEXER_NO_POSITIONS (entonces no se comparan
+ * las posiciones).
+ */
+static void check_variants(const char *source, unsigned flags, const LexToken *tokens, size_t count) {
+    static const unsigned EXTRA_FLAGS[] = { 0, LEXER_NO_POSITIONS };
+    for (size_t e = 0; e < sizeof(EXTRA_FLAGS) / sizeof(EXTRA_FLAGS[0]); e++) {
+        for (size_t v = 0; lexer_variant_at(v) != NULL; v++) {
+            Lexer variant;
+            lexer_init(&variant, source);
+            lexer_set_flags(&variant, flags | EXTRA_FLAGS[e]);
+            if (lexer_set_variant(&variant, lexer_variant_at(v)) != 0) {
+                continue;
+            }
+            for (size_t i = 0; i < count; i++) {
+                LexToken actual;
+                LexToken expected = tokens[i];
+                lexer_next_compact(&variant, &actual);
+                if (EXTRA_FLAGS[e] & LEXER_NO_POSITIONS) {
+                    expected.line = actual.line = 0;
+                    expected.column = actual.column = 0;
+                }
+                if (memcmp(&expected, &actual, sizeof(expected)) != 0) {
+                    fprintf(stderr, "fuzz: variante '%s'\n", lexer_variant_at(v));
+                    fuzz_fail("una variante del lexer difiere", i, actual.type, tokens[i].line, tokens[i].column);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief Oráculo diferencial entre las rutas del lexer.
+ *
+ * Los tokens compactos se toman como referencia del flujo; @p lookahead
+ * varía la anticipación de token_stream_peek() para cubrir los bordes de los
+ * lotes y del búfer circular.
+ */
+static void fuzz_lexer(const char *source, size_t length, unsigned flags, size_t lookahead) {
+    DiagEngine diag_ref;
+    DiagEngine diag_fast;
+    if (diag_init(&diag_ref, 64) != 0 || diag_init(&diag_fast, 64) != 0) {
+        abort();
+    }
+
+    // Ruta rápida: todos los tokens compactos.
+    Lexer fast;
+    lexer_init(&fast, source);
+    lexer_set_flags(&fast, flags);
+    lexer_set_diagnostics(&fast, &diag_fast);
+    LexToken *tokens = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t last_line = 1;
+    size_t last_column = 1;
+    for (;;) {
+        if (count == capacity) {
+            capacity = capacity > 0 ? capacity * 2 : 256;
+            tokens = (LexToken *)realloc(tokens, capacity * sizeof(LexToken));
+            if (tokens == NULL) {
+                abort();
+            }
+        }
+        LexToken *token = &tokens[count];
+        if (!lexer_next_compact(&fast, token)) {
+            abort();
+        }
+        check_compact(token, count, length, &last_line, &last_column);
+        count++;
+        if (token->type == TOKEN_EOF) {
+            break;
+        }
+    }
+
+    // Referencia: un token_t por token, con la variante completa.
+    Lexer ref;
+    lexer_init(&ref, source);
+    lexer_set_flags(&ref, flags | LEXER_GENERIC);
+    lexer_set_diagnostics(&ref, &diag_ref);
+    for (size_t i = 0; i < count; i++) {
+        token_t *expected = lexer_next_token(&ref);
+        const LexToken *token = &tokens[i];
+        if (expected == NULL) {
+            abort();
+        }
+        const char *lexeme = token->type == TOKEN_EOF ? "EOF" : source + token->offset;
+        size_t lexeme_length = token->type == TOKEN_EOF ? 3 : token->length;
+        if (expected->type != token->type || expected->line != token->line
+                || expected->column != token->column || strlen(expected->lexeme) != lexeme_length
+                || memcmp(expected->lexeme, lexeme, lexeme_length) != 0) {
+            fuzz_fail("lexer_next_compact difiere de lexer_next_token",
+                      i, expected->type, expected->line, expected->column);
+        }
+        free_token(expected);
+    }
+    if (diag_ref.errors != diag_fast.errors || diag_ref.warnings != diag_fast.warnings) {
+        fuzz_fail("los diagnósticos difieren", 0, TOKEN_EOF, 0, 0);
+    }
+
+    // TokenStream: el token k posiciones adelante es el que se verá al llegar a él.
+    Lexer streamed;
+    lexer_init(&streamed, source);
+    lexer_set_flags(&streamed, flags);
+    TokenStream *stream = (TokenStream *)malloc(sizeof(TokenStream));
+    if (stream == NULL) {
+        abort();
+    }
+    token_stream_init(stream, &streamed);
+    size_t k = lookahead < TOKEN_STREAM_MAX_PEEK ? lookahead : TOKEN_STREAM_MAX_PEEK - 1;
+    for (size_t i = 0; i < count; i++) {
+        const LexToken *ahead = token_stream_peek(stream, k);
+        const LexToken *expected_ahead = &tokens[i + k < count ? i + k : count - 1];
+        if (memcmp(ahead, expected_ahead, sizeof(LexToken)) != 0) {
+            fuzz_fail("token_stream_peek(k) difiere", i + k, ahead->type, ahead->line, ahead->column);
+        }
+        const LexToken *current = token_stream_peek(stream, 0);
+        if (memcmp(current, &tokens[i], sizeof(LexToken)) != 0) {
+            fuzz_fail("TokenStream difiere de lexer_next_compact",
+                      i, current->type, current->line, current->column);
+        }
+        token_stream_advance(stream);
+    }
+    if (token_stream_peek(stream, 0)->type != TOKEN_EOF) {
+        fuzz_fail("TokenStream no se quedó en EOF", count, TOKEN_EOF, 0, 0);
+    }
+    token_stream_destroy(stream);
+    free(stream);
+    check_variants(source, flags, tokens, count);
+    free(tokens);
+    diag_free(&diag_ref);
+    diag_free(&diag_fast);
+}
+#endif
+
+#if FUZZ_TARGET == FUZZ_TARGET_TOKENIZE
+/**
+ * @brief Oráculo entre la lista de tokenize_all() y los tokens compactos.
+ */
+static void fuzz_tokenize(const char *source) {
+    token_t *head = tokenize_all(source);
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    size_t index = 0;
+    for (token_t *token = head; token != NULL; token = token->next, index++) {
+        LexToken compact;
+        if (!lexer_next_compact(&lexer, &compact) || compact.type != token->type
+                || compact.line != token->line || compact.column != token->column) {
+            fuzz_fail("tokenize_all difiere de lexer_next_compact",
+                      index, token->type, token->line, token->column);
+        }
+        if (token->next == NULL && token->type != TOKEN_EOF) {
+            fuzz_fail("la lista no termina en EOF", index, token->type, token->line, token->column);
+        }
+    }
+    free_token_list(head);
+}
+#endif
+
+#if FUZZ_TARGET == FUZZ_TARGET_PARSER
+/**
+ * @brief Oráculo entre el análisis con y sin motor de diagnósticos.
+ *
+ * Además, los diagnósticos registrados deben estar ordenados por posición.
+ */
+static void fuzz_parser(const char *source, unsigned flags) {
+    DiagEngine diag;
+    if (diag_init(&diag, 256) != 0) {
+        abort();
+    }
+    ParseResult with_diag;
+    ParseResult counted;
+    int failed = parse_source(source, flags, &diag, &with_diag);
+    int failed_counted = parse_source(source, flags, NULL, &counted);
+    if (failed != failed_counted || with_diag.tokens != counted.tokens
+            || with_diag.lexical_errors != counted.lexical_errors
+            || with_diag.syntax_errors != counted.syntax_errors) {
+        fuzz_fail("parse_source depende del motor de diagnósticos", 0, TOKEN_EOF, 0, 0);
+    }
+    for (size_t i = 1; i < diag.count; i++) {
+        const SourceSpan *a = &diag.items[i - 1].span;
+        const SourceSpan *b = &diag.items[i].span;
+        if (b->line < a->line || (b->line == a->line && b->column < a->column)) {
+            fuzz_fail("diagnósticos desordenados", i, TOKEN_EOF, b->line, b->column);
+        }
+    }
+    diag_free(&diag);
+}
+#endif
+
+/**
+ * @brief Punto de entrada de libFuzzer (y de standalone.c).
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+    if (size > FUZZ_MAX_INPUT) {
+        size = FUZZ_MAX_INPUT;
+    }
+    char *source = (char *)malloc(size + 1);
+    if (source == NULL) {
+        return 0;
+    }
+    memcpy(source, data, size);
+    source[size] = '\0';
+    size_t length = strlen(source);
+
+#if FUZZ_TARGET == FUZZ_TARGET_LEXER
+    size_t lookahead = size > 0 ? data[size - 1] : 0;
+    fuzz_lexer(source, length, 0, lookahead);
+    fuzz_lexer(source, length, LEXER_UTF8_COLUMNS, lookahead * 3);
+#elif FUZZ_TARGET == FUZZ_TARGET_TOKENIZE
+    (void)length;
+    fuzz_tokenize(source);
+#elif FUZZ_TARGET == FUZZ_TARGET_PARSER
+    (void)length;
+    fuzz_parser(source, 0);
+    fuzz_parser(source, LEXER_UTF8_COLUMNS);
+#else
+#error "FUZZ_TARGET desconocido"
+#endif
+
+    free(source);
+    return 0;
+}
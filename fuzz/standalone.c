@@ -0,0 +1,396 @@
+/**
+ * @file standalone.c
+ * @brief Ejecutor de LLVMFuzzerTestOneInput() sin libFuzzer.
+ *
+ * Sirve para tres cosas con el mismo binario compilado con gcc o
+ * afl-clang-fast:
+ *
+ *  - Reproducir un corpus o un caso de fallo: cada archivo (o cada archivo de
+ *    cada directorio) indicado se ejecuta una vez.
+ *  - AFL++: `afl-fuzz ... -- bin/fuzz-lexer-asan @@` ejecuta un archivo por
+ *    proceso; sin argumentos se lee la entrada estándar.
+ *  - Fuzzing mutacional sencillo con --mutate, para entornos sin clang: se
+ *    toman entradas del corpus y se les aplican mutaciones de bytes, de corte,
+ *    de empalme y de inserción de palabras del diccionario.
+ *
+ * Antes de ejecutar cada entrada mutada se deja en un archivo de fallo; si el
+ * proceso muere (abort() del oráculo o un error de ASan/UBSan), el archivo
+ * contiene la entrada que lo provocó.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STANDALONE_MAX_PATH 4096
+#define STANDALONE_MAX_INPUT (64 * 1024)
+#define STANDALONE_DEFAULT_CRASH "build/fuzz/crash-input"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+/** Presente cuando se enlaza con ASan/UBSan: se llama antes de terminar por un error. */
+extern void __sanitizer_set_death_callback(void (*callback)(void)) __attribute__((weak));
+
+/**
+ * @brief Una entrada en memoria.
+ */
+typedef struct Input {
+    uint8_t *data;
+    size_t size;
+} Input;
+
+/**
+ * @brief Lista de entradas (corpus o diccionario).
+ */
+typedef struct InputList {
+    Input *items;
+    size_t count;
+    size_t capacity;
+} InputList;
+
+static int crash_fd = -1;
+static const char *crash_path = STANDALONE_DEFAULT_CRASH;
+
+/**
+ * @brief Agrega una copia de @p data a la lista.
+ */
+static int list_add(InputList *list, const uint8_t *data, size_t size) {
+    if (list->count == list->capacity) {
+        size_t grown = list->capacity > 0 ? list->capacity * 2 : 64;
+        Input *larger = (Input *)realloc(list->items, grown * sizeof(Input));
+        if (larger == NULL) {
+            return 1;
+        }
+        list->items = larger;
+        list->capacity = grown;
+    }
+    uint8_t *copy = (uint8_t *)malloc(size > 0 ? size : 1);
+    if (copy == NULL) {
+        return 1;
+    }
+    memcpy(copy, data, size);
+    list->items[list->count].data = copy;
+    list->items[list->count].size = size;
+    list->count++;
+    return 0;
+}
+
+/**
+ * @brief Libera una lista.
+ */
+static void list_free(InputList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->items[i].data);
+    }
+    free(list->items);
+}
+
+/**
+ * @brief Lee un flujo completo (hasta STANDALONE_MAX_INPUT bytes).
+ */
+static int read_stream(FILE *file, InputList *list) {
+    uint8_t *data = (uint8_t *)malloc(STANDALONE_MAX_INPUT);
+    if (data == NULL) {
+        return 1;
+    }
+    size_t size = fread(data, 1, STANDALONE_MAX_INPUT, file);
+    int failed = list_add(list, data, size);
+    free(data);
+    return failed;
+}
+
+/**
+ * @brief Agrega un archivo, o los archivos regulares de un directorio.
+ */
+static int add_path(InputList *list, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(stderr, "Error: No existe '%s'\n", path);
+        return 1;
+    }
+    if (!S_ISDIR(st.st_mode)) {
+        FILE *file = fopen(path, "rb");
+        if (file == NULL) {
+            fprintf(stderr, "Error: No se pudo abrir '%s'\n", path);
+            return 1;
+        }
+        int failed = read_stream(file, list);
+        fclose(file);
+        return failed;
+    }
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        fprintf(stderr, "Error: No se pudo abrir el directorio '%s'\n", path);
+        return 1;
+    }
+    int status = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char child[STANDALONE_MAX_PATH];
+        snprintf(child, sizeof(child), "%s/%s", path, entry->d_name);
+        if (stat(child, &st) == 0 && S_ISREG(st.st_mode)) {
+            status |= add_path(list, child);
+        }
+    }
+    closedir(dir);
+    return status;
+}
+
+/**
+ * @brief Carga un diccionario en formato AFL/libFuzzer (`nombre="valor"`).
+ *
+ * Se admiten los escapes \\, \" y \xNN; las líneas vacías y las que empiezan
+ * con '#' se ignoran.
+ */
+static int load_dictionary(const char *path, InputList *words) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(stderr, "Error: No se pudo abrir el diccionario '%s'\n", path);
+        return 1;
+    }
+    char line[512];
+    while (fgets(line, sizeof(line), file) != NULL) {
+        char *quote = strchr(line, '"');
+        if (line[0] == '#' || quote == NULL) {
+            continue;
+        }
+        uint8_t word[256];
+        size_t n = 0;
+        for (char *p = quote + 1; *p != '\0' && *p != '"' && n < sizeof(word); p++) {
+            if (*p == '\\' && p[1] == 'x' && p[2] != '\0' && p[3] != '\0') {
+                char hex[3] = { p[2], p[3], '\0' };
+                word[n++] = (uint8_t)strtoul(hex, NULL, 16);
+                p += 3;
+            } else if (*p == '\\' && p[1] != '\0') {
+                word[n++] = (uint8_t)*++p;
+            } else {
+                word[n++] = (uint8_t)*p;
+            }
+        }
+        if (n > 0 && list_add(words, word, n) != 0) {
+            fclose(file);
+            return 1;
+        }
+    }
+    fclose(file);
+    return 0;
+}
+
+/* ---- Mutaciones ---- */
+
+/**
+ * @brief Generador xorshift64* (reproducible con --seed).
+ */
+static uint64_t next_random(uint64_t *state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 0x2545F4914F6CDD1DULL;
+}
+
+/**
+ * @brief Número aleatorio en [0, bound).
+ */
+static size_t random_below(uint64_t *state, size_t bound) {
+    return bound > 0 ? (size_t)(next_random(state) % bound) : 0;
+}
+
+/**
+ * @brief Inserta @p size bytes en @p at, si caben.
+ */
+static void insert_bytes(uint8_t *buffer, size_t *length, size_t at, const uint8_t *data, size_t size) {
+    if (*length + size > STANDALONE_MAX_INPUT) {
+        return;
+    }
+    memmove(buffer + at + size, buffer + at, *length - at);
+    memcpy(buffer + at, data, size);
+    *length += size;
+}
+
+/**
+ * @brief Aplica entre una y cuatro mutaciones aleatorias.
+ */
+static void mutate(uint8_t *buffer, size_t *length, const InputList *corpus,
+                   const InputList *words, uint64_t *state) {
+    static const uint8_t interesting[] = { '\0', '"', '\'', '/', '*', '\\', '\n', '.', 0x80, 0xC3, 0xE2, 0xF0, 0xFF };
+    size_t rounds = 1 + random_below(state, 4);
+    for (size_t r = 0; r < rounds; r++) {
+        size_t at = random_below(state, *length + 1);
+        switch (random_below(state, 7)) {
+            case 0:     // Invertir un bit
+                if (*length > 0) {
+                    buffer[random_below(state, *length)] ^= (uint8_t)(1u << random_below(state, 8));
+                }
+                break;
+            case 1: {   // Byte interesante
+                uint8_t byte = interesting[random_below(state, sizeof(interesting))];
+                insert_bytes(buffer, length, at, &byte, 1);
+                break;
+            }
+            case 2:     // Borrar un tramo
+                if (at < *length) {
+                    size_t count = 1 + random_below(state, *length - at < 16 ? *length - at : 16);
+                    memmove(buffer + at, buffer + at + count, *length - at - count);
+                    *length -= count;
+                }
+                break;
+            case 3:     // Cortar
+                *length = at;
+                break;
+            case 4:     // Palabra del diccionario
+                if (words->count > 0) {
+                    const Input *word = &words->items[random_below(state, words->count)];
+                    insert_bytes(buffer, length, at, word->data, word->size);
+                }
+                break;
+            case 5: {   // Duplicar un tramo
+                if (at < *length) {
+                    size_t count = 1 + random_below(state, *length - at < 64 ? *length - at : 64);
+                    uint8_t copy[64];
+                    memcpy(copy, buffer + at, count);
+                    insert_bytes(buffer, length, random_below(state, *length + 1), copy, count);
+                }
+                break;
+            }
+            default: {  // Empalmar con otra entrada del corpus
+                const Input *other = &corpus->items[random_below(state, corpus->count)];
+                if (other->size > 0) {
+                    size_t from = random_below(state, other->size);
+                    size_t count = 1 + random_below(state, other->size - from < 256 ? other->size - from : 256);
+                    insert_bytes(buffer, length, at, other->data + from, count);
+                }
+                break;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Guarda la entrada en curso en el archivo de fallo.
+ */
+static void remember_input(const uint8_t *data, size_t size) {
+    if (crash_fd < 0) {
+        return;
+    }
+    if (lseek(crash_fd, 0, SEEK_SET) == 0 && ftruncate(crash_fd, 0) == 0) {
+        ssize_t written = write(crash_fd, data, size);
+        (void)written;
+    }
+}
+
+/**
+ * @brief Avisa dónde quedó la entrada cuando un sanitizador termina el proceso.
+ */
+static void report_crash(void) {
+    static const char message[] = "fuzz: la entrada que falló quedó en el archivo de fallo\n";
+    ssize_t written = write(STDERR_FILENO, message, sizeof(message) - 1);
+    (void)written;
+}
+
+/**
+ * @brief Imprime la ayuda de uso.
+ */
+static void print_usage(const char *program_name) {
+    printf("Uso: %s [opciones] [archivo|directorio]...\n", program_name);
+    printf("Sin archivos, ejecuta una vez la entrada estándar (compatible con AFL++).\n");
+    printf("Opciones:\n");
+    printf("  --mutate <n>        Ejecutar además n entradas mutadas a partir del corpus\n");
+    printf("  --seed <n>          Semilla de las mutaciones (por defecto 1)\n");
+    printf("  --dict <archivo>    Diccionario AFL/libFuzzer para las mutaciones\n");
+    printf("  --crash-file <ruta> Dónde guardar la entrada que falla (por defecto %s)\n",
+           STANDALONE_DEFAULT_CRASH);
+}
+
+/**
+ * @brief Función principal del ejecutor.
+ */
+int main(int argc, char *argv[]) {
+    InputList corpus = { NULL, 0, 0 };
+    InputList words = { NULL, 0, 0 };
+    unsigned long mutations = 0;
+    uint64_t state = 1;
+    int status = 0;
+
+    for (int i = 1; i < argc && status == 0; i++) {
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--mutate") == 0 && has_value) {
+            mutations = strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && has_value) {
+            state = strtoull(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--dict") == 0 && has_value) {
+            status = load_dictionary(argv[++i], &words);
+        } else if (strcmp(argv[i], "--crash-file") == 0 && has_value) {
+            crash_path = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (strcmp(argv[i], "-") == 0 || argv[i][0] != '-') {
+            status = strcmp(argv[i], "-") == 0 ? read_stream(stdin, &corpus) : add_path(&corpus, argv[i]);
+        } else {
+            fprintf(stderr, "Error: Opción desconocida o sin valor '%s'\n\n", argv[i]);
+            print_usage(argv[0]);
+            status = 1;
+        }
+    }
+    if (status == 0 && corpus.count == 0) {
+        status = read_stream(stdin, &corpus);
+    }
+    if (status != 0) {
+        list_free(&corpus);
+        list_free(&words);
+        return 1;
+    }
+
+    // Con un solo archivo (AFL++, reproducción) el fuzzer ya conoce la entrada.
+    if (mutations > 0 || corpus.count > 1) {
+        crash_fd = open(crash_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (crash_fd < 0) {
+            fprintf(stderr, "Aviso: No se pudo crear '%s'; no se guardarán los fallos\n", crash_path);
+        }
+        if (__sanitizer_set_death_callback != NULL) {
+            __sanitizer_set_death_callback(report_crash);
+        }
+    }
+    for (size_t i = 0; i < corpus.count; i++) {
+        remember_input(corpus.items[i].data, corpus.items[i].size);
+        LLVMFuzzerTestOneInput(corpus.items[i].data, corpus.items[i].size);
+    }
+    if (state == 0) {
+        state = 1;   // xorshift no sale de 0
+    }
+    uint8_t *buffer = (uint8_t *)malloc(STANDALONE_MAX_INPUT);
+    if (buffer == NULL || corpus.count == 0) {
+        free(buffer);
+        list_free(&corpus);
+        list_free(&words);
+        return 1;
+    }
+    for (unsigned long n = 0; n < mutations; n++) {
+        const Input *base = &corpus.items[random_below(&state, corpus.count)];
+        size_t length = base->size;
+        memcpy(buffer, base->data, length);
+        mutate(buffer, &length, &corpus, &words, &state);
+        remember_input(buffer, length);
+        LLVMFuzzerTestOneInput(buffer, length);
+    }
+    if (crash_fd >= 0) {
+        close(crash_fd);
+        unlink(crash_path);
+    }
+    if (mutations > 0 || corpus.count > 1) {
+        printf("✓ %zu entradas del corpus y %lu mutaciones sin fallos\n", corpus.count, mutations);
+    }
+    free(buffer);
+    list_free(&corpus);
+    list_free(&words);
+    return 0;
+}
@@ -0,0 +1,41 @@
+/**
+ * @file arena.h
+ * @brief Asignador por regiones (arena) reutilizable.
+ *
+ * Una arena reserva bloques grandes y entrega memoria avanzando un puntero.
+ * Toda la memoria se libera de una sola vez con arena_reset() o arena_free(),
+ * lo que evita un malloc/free por cada objeto de vida corta.
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/**
+ * @brief Bloque de memoria perteneciente a una arena.
+ */
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;  /**< Siguiente bloque de la cadena */
+    size_t capacity;          /**< Bytes útiles del bloque */
+    size_t used;              /**< Bytes ya entregados */
+} ArenaBlock;
+
+/**
+ * @brief Estado de una arena.
+ */
+typedef struct Arena {
+    ArenaBlock *head;     /**< Primer bloque (se conserva entre reinicios) */
+    ArenaBlock *current;  /**< Bloque desde el que se asigna actualmente */
+    size_t block_size;    /**< Tamaño mínimo de cada bloque nuevo */
+    size_t in_use;        /**< Bytes entregados desde el último reinicio */
+    size_t peak;          /**< Máximo histórico de in_use */
+} Arena;
+
+void arena_init(Arena *arena, size_t block_size);
+void *arena_alloc(Arena *arena, size_t size);
+void arena_reset(Arena *arena);
+void arena_free(Arena *arena);
+void arena_adopt(Arena *arena, Arena *from);
+
+#endif // ARENA_H
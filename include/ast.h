@@ -0,0 +1,119 @@
+/**
+ * @file ast.h
+ * @brief Árbol de sintaxis abstracta construido por parse_source_ast().
+ *
+ * Los nodos viven en una Arena y se liberan todos juntos con ella. Cada nodo
+ * guarda la posición de su token principal (el lexema se obtiene del fuente
+ * con offset y length) y hasta tres hijos; las listas (items, sentencias,
+ * parámetros, argumentos y brazos de match) se encadenan por next. El
+ * análisis semántico completa type, slot, aux y value.
+ *
+ * Solo la raíz y los items de nivel superior (sus hijos directos) guardan
+ * offset y line absolutos; los descendientes de un item los guardan
+ * relativos a él (la columna siempre es absoluta). Así, mover un item en el
+ * fuente (reparse.h) solo cambia su raíz. ast_offset() y ast_line() dan la
+ * posición absoluta.
+ */
+
+#ifndef AST_H
+#define AST_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "lexer.h"
+
+/**
+ * @brief Clases de nodo y uso de sus hijos.
+ */
+typedef enum AstKind {
+    AST_PROGRAM,    /**< a: items */
+    AST_FUNCTION,   /**< token: nombre; a: parámetros; b: tipo de retorno o NULL; c: cuerpo */
+    AST_PARAM,      /**< token: nombre; a: tipo */
+    AST_TYPE,       /**< op: palabra reservada del tipo, o TOKEN_IDENTIFIER */
+    AST_BLOCK,      /**< a: sentencias */
+    AST_LET,        /**< token: nombre; op: TOKEN_KW_MUT o TOKEN_KW_LET; a: tipo; b: valor */
+    AST_IF,         /**< a: condición; b: bloque; c: else (bloque o if) o NULL */
+    AST_WHILE,      /**< a: condición; b: cuerpo */
+    AST_FOR,        /**< token: variable; a: iterable; b: cuerpo */
+    AST_LOOP,       /**< b: cuerpo */
+    AST_MATCH,      /**< a: expresión; b: brazos */
+    AST_MATCH_ARM,  /**< a: patrón (literal o nombre); b: resultado (bloque o expresión) */
+    AST_RETURN,     /**< a: valor o NULL */
+    AST_BREAK,
+    AST_CONTINUE,
+    AST_EXPR_STMT,  /**< a: expresión */
+    AST_NUMBER,
+    AST_STRING,
+    AST_CHAR,
+    AST_BOOL,       /**< op: TOKEN_KW_TRUE o TOKEN_KW_FALSE */
+    AST_NAME,
+    AST_UNARY,      /**< op; a: operando */
+    AST_BINARY,     /**< op; a, b: operandos */
+    AST_ASSIGN,     /**< op: '=' o compuesto; a: destino; b: valor */
+    AST_CALL,       /**< a: función; b: argumentos */
+    AST_FIELD,      /**< token: campo; a: objeto */
+    AST_RANGE,      /**< a: inicio; b: fin (excluido) */
+    AST_ARRAY,      /**< a: elementos */
+    AST_KIND_COUNT
+} AstKind;
+
+/**
+ * @brief Tipos del análisis semántico.
+ */
+typedef enum AstType {
+    AST_TYPE_UNKNOWN,  /**< Sin analizar, o con error */
+    AST_TYPE_UNIT,     /**< Sin valor (funciones sin retorno, asignaciones) */
+    AST_TYPE_I32,
+    AST_TYPE_BOOL,
+    AST_TYPE_CHAR,
+    AST_TYPE_STRING,   /**< Referencia a bytes inmutables (runtime.h) */
+    AST_TYPE_ARRAY     /**< Referencia a un arreglo inmutable de i32 */
+} AstType;
+
+/**
+ * @brief Indica si los valores del tipo son referencias a objetos de runtime.h.
+ */
+static inline int ast_type_is_reference(AstType type) {
+    return type == AST_TYPE_STRING || type == AST_TYPE_ARRAY;
+}
+
+/**
+ * @brief Nodo del AST.
+ */
+typedef struct AstNode {
+    AstKind kind;            /**< Clase de nodo */
+    TokenType op;            /**< Operador o palabra reservada (según kind) */
+    uint32_t offset;         /**< Lexema del token principal en el fuente (relativo al item) */
+    uint32_t length;
+    uint32_t line;           /**< Posición del token principal (línea relativa al item) */
+    uint32_t column;
+    struct AstNode *a;       /**< Hijos (ver AstKind) */
+    struct AstNode *b;
+    struct AstNode *c;
+    struct AstNode *next;    /**< Siguiente elemento de la lista que lo contiene */
+    AstType type;            /**< Tipo del valor (sema) */
+    int32_t slot;            /**< Variable local o función (sema) */
+    int32_t aux;             /**< Dato extra de sema (segunda variable de for y match) */
+    int64_t value;           /**< Valor de los literales (sema) */
+} AstNode;
+
+/**
+ * @brief Desplazamiento absoluto de @p node, que es @p item o uno de sus descendientes.
+ */
+static inline uint32_t ast_offset(const AstNode *item, const AstNode *node) {
+    return node == item ? node->offset : item->offset + node->offset;
+}
+
+/**
+ * @brief Línea absoluta de @p node, que es @p item o uno de sus descendientes.
+ */
+static inline uint32_t ast_line(const AstNode *item, const AstNode *node) {
+    return node == item ? node->line : item->line + node->line;
+}
+
+const char *ast_kind_name(AstKind kind);
+const char *ast_type_name(AstType type);
+void ast_print(const AstNode *node, const char *source, FILE *out);
+
+#endif // AST_H
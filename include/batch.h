@@ -0,0 +1,34 @@
+/**
+ * @file batch.h
+ * @brief Modo de compilación por lotes sobre un pool de hilos.
+ *
+ * Permite procesar muchos archivos en una sola invocación. Las entradas pueden
+ * ser archivos, directorios (se recorren recursivamente) o archivos de
+ * respuesta con el prefijo '@' que listan una ruta por línea.
+ */
+
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "cache.h"
+#include "stats.h"
+
+/**
+ * @brief Opciones del modo por lotes.
+ */
+typedef struct BatchOptions {
+    int generate_tokens;  /**< 1 para generar archivos de tokens (-t) */
+    int syntax_check;     /**< 1 para analizar también la sintaxis (-p) */
+    int threads;          /**< Hilos de trabajo, 0 para usar los núcleos disponibles */
+    unsigned lexer_flags; /**< Opciones del lexer (LEXER_*) */
+    Cache *cache;         /**< Caché de compilación para -t, o NULL */
+    FILE *out;            /**< Destino del resumen */
+    FILE *err;            /**< Destino de los diagnósticos */
+    CompilerStats *stats; /**< Estadísticas a completar (--stats), o NULL */
+} BatchOptions;
+
+int batch_run(char *const *inputs, size_t input_count, const BatchOptions *options);
+
+#endif // BATCH_H
@@ -0,0 +1,260 @@
+/**
+ * @file bytecode.h
+ * @brief Bytecode de pila generado a partir del AST analizado.
+ *
+ * Cada función se traduce a una secuencia de instrucciones de un byte de
+ * código seguido de sus operandos (little-endian, sin alinear). Los valores
+ * son enteros de 32 bits (i32, bool como 0/1, char como punto de código y
+ * String y Array como referencias RtRef, ver runtime.h);
+ * las variables locales ocupan ranuras numeradas por el análisis semántico,
+ * con los parámetros en las primeras. La misma representación la ejecutan
+ * la máquina virtual (vm.h) y el JIT (jit.h).
+ */
+
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "diag.h"
+#include "sema.h"
+
+/** Ranuras locales más profundidad de pila máximas de una función. */
+#define BC_MAX_FRAME_SLOTS 256
+
+/** Opciones de bc_compile(). */
+#define BC_VECTORIZE    0x1u    /**< Traducir los ciclos for de reducciones a núcleos vectoriales */
+#define BC_SIMD_SSE2    0x2u    /**< Con el JIT, usar SSE2 aunque el procesador tenga AVX2 */
+#define BC_HEAP_MALLOC  0x4u    /**< Pedir cada String y Array a malloc, sin regiones ni pool */
+
+/** Operando de las instrucciones sobre referencias. */
+#define BC_REF_POOL     0x1u    /**< El objeto creado puede escapar del marco: va al pool */
+#define BC_REF_ARRAY    0x2u    /**< Array de i32 (si no, String de bytes) */
+
+/** Profundidad máxima de la pila de una expresión vectorial. */
+#define BC_VECTOR_MAX_DEPTH 8
+/** Reducciones máximas de un núcleo. */
+#define BC_VECTOR_MAX_REDUCTIONS 4
+/** Instrucciones máximas de las expresiones de un núcleo. */
+#define BC_VECTOR_MAX_CODE 64
+
+/**
+ * @brief Instrucciones: X(código, bytes de operando, nombre).
+ */
+#define BC_OPS(X) \
+    X(BC_CONST,      4, "const")       /* Apila el i32 del operando */ \
+    X(BC_LOAD,       2, "load")        /* Apila la ranura u16 */ \
+    X(BC_STORE,      2, "store")       /* Desapila en la ranura u16 */ \
+    X(BC_POP,        0, "pop") \
+    X(BC_ADD,        0, "add")         /* Aritmética i32 con desbordamiento circular */ \
+    X(BC_SUB,        0, "sub") \
+    X(BC_MUL,        0, "mul") \
+    X(BC_DIV,        0, "div")         /* Error con divisor 0; INT32_MIN / -1 = INT32_MIN */ \
+    X(BC_MOD,        0, "mod")         /* Error con divisor 0; x % -1 = 0 */ \
+    X(BC_NEG,        0, "neg") \
+    X(BC_NOT,        0, "not")         /* 0 <-> 1 */ \
+    X(BC_EQ,         0, "eq")          /* Comparaciones: apilan 0 o 1 */ \
+    X(BC_NE,         0, "ne") \
+    X(BC_LT,         0, "lt") \
+    X(BC_LE,         0, "le") \
+    X(BC_GT,         0, "gt") \
+    X(BC_GE,         0, "ge") \
+    X(BC_JUMP,       4, "jump")        /* Salta al desplazamiento u32 de la función */ \
+    X(BC_JUMP_FALSE, 4, "jump_false")  /* Desapila y salta si es 0 */ \
+    X(BC_JUMP_TRUE,  4, "jump_true")   /* Desapila y salta si no es 0 */ \
+    X(BC_CALL,       2, "call")        /* Llama a la función u16 con sus argumentos en la pila */ \
+    X(BC_RETURN,     0, "return")      /* Devuelve el valor de la cima */ \
+    X(BC_PRINT,      1, "print")       /* Desapila e imprime según el AstType u8 */ \
+    X(BC_VECTOR,     2, "vector")      /* Adelanta el ciclo for siguiente con el núcleo u16 */ \
+    X(BC_ENTER,      0, "enter")       /* Abre la región del marco (primera instrucción) */ \
+    X(BC_LEAVE,      1, "leave")       /* Cierra el marco; u8 = 1 si la cima es una referencia devuelta */ \
+    X(BC_CONCAT,     1, "concat")      /* Desapila b y a, apila a + b (operando BC_REF_*) */ \
+    X(BC_ARRAY,      4, "array")       /* Desapila n i32 y apila el Array (n | BC_REF_* << 16) */ \
+    X(BC_INDEX,      1, "index")       /* Desapila i y x, apila at(x, i); error fuera de rango */ \
+    X(BC_LENGTH,     0, "length")      /* Reemplaza la cima por su longitud */ \
+    X(BC_EQUAL,      1, "equal")       /* Desapila b y a, apila 1 si su contenido es igual */ \
+    X(BC_LITERAL,    4, "literal")     /* Apila la referencia u32 a un objeto de BcModule.strings */
+
+/**
+ * @brief Código de instrucción.
+ */
+typedef enum BcOp {
+#define BC_ENUM(op, operand, name) op,
+    BC_OPS(BC_ENUM)
+#undef BC_ENUM
+    BC_OP_COUNT
+} BcOp;
+
+/**
+ * @brief Instrucciones de las expresiones de un núcleo vectorial (en postfijo).
+ */
+typedef enum BcVecOp {
+    BC_VEC_INDEX,               /**< Variable del ciclo */
+    BC_VEC_CONST,               /**< value */
+    BC_VEC_LOAD,                /**< Ranura invariante en el ciclo */
+    BC_VEC_ADD,
+    BC_VEC_SUB,
+    BC_VEC_MUL,
+    BC_VEC_NEG
+} BcVecOp;
+
+typedef struct BcVecInstr {
+    uint8_t op;                 /**< BcVecOp */
+    uint16_t slot;              /**< Ranura de BC_VEC_LOAD */
+    int32_t value;              /**< Valor de BC_VEC_CONST */
+} BcVecInstr;
+
+/**
+ * @brief Operación con la que una reducción acumula cada iteración.
+ */
+typedef enum BcReduce {
+    BC_REDUCE_ADD,
+    BC_REDUCE_MUL,
+    BC_REDUCE_MIN,
+    BC_REDUCE_MAX
+} BcReduce;
+
+/**
+ * @brief Acumulador de un núcleo: slot = slot (op) expresión, en cada iteración.
+ */
+typedef struct BcReduction {
+    uint8_t kind;               /**< BcReduce */
+    uint16_t slot;
+    uint32_t start;             /**< Primera instrucción de la expresión en code */
+    uint32_t length;
+} BcReduction;
+
+/**
+ * @brief Ciclo for cuyo cuerpo solo acumula reducciones independientes entre iteraciones.
+ *
+ * BC_VECTOR, antes del for, ejecuta en bloque un prefijo de las iteraciones
+ * pendientes (las que quepan en registros vectoriales, o todas), actualiza
+ * los acumuladores y avanza la variable del ciclo; el ciclo escalar que
+ * sigue ejecuta el resto. Como las reducciones son asociativas y
+ * conmutativas en aritmética circular, el resultado no depende de cuántas
+ * iteraciones se adelanten.
+ */
+typedef struct BcKernel {
+    uint16_t index_slot;        /**< Variable del ciclo: primera iteración pendiente */
+    uint16_t end_slot;          /**< Fin del rango (excluido) */
+    BcReduction reductions[BC_VECTOR_MAX_REDUCTIONS];
+    uint32_t reduction_count;
+    BcVecInstr *code;
+    uint32_t code_length;
+} BcKernel;
+
+/**
+ * @brief Llamada del código fuente, para reportar optimizaciones sobre ella.
+ */
+typedef struct BcCallSite {
+    uint32_t pc;                /**< Posición de la instrucción call */
+    uint32_t line;              /**< Posición del nombre llamado en el fuente */
+    uint32_t column;
+} BcCallSite;
+
+/**
+ * @brief Inicio de un tramo de código que proviene de otra función.
+ *
+ * Tras la expansión en línea, el código de una función mezcla el de sus
+ * llamados; los errores de ejecución se atribuyen a la función de origen
+ * del tramo para que el mensaje no dependa de la optimización. Expandir un
+ * llamado que ya tenía código expandido anida sus tramos un nivel más: la
+ * función que expandió un tramo es la del tramo anterior más cercano con
+ * un nivel menos (ver bc_origin_chain()).
+ */
+typedef struct BcOrigin {
+    uint32_t pc;                /**< Primer byte del tramo */
+    uint32_t function;          /**< Función del fuente a la que pertenece */
+    uint32_t depth;             /**< Expansiones que lo contienen: 0 en el código propio */
+} BcOrigin;
+
+/**
+ * @brief Inicio de un tramo de código generado por una línea del fuente.
+ *
+ * Se registra al comienzo de cada sentencia; las instrucciones que siguen
+ * hasta la próxima entrada se atribuyen a esa línea. Tras la expansión en
+ * línea, los tramos del llamado conservan sus líneas (ver bc_origin() para
+ * saber de qué función son).
+ */
+typedef struct BcLine {
+    uint32_t pc;                /**< Primer byte del tramo */
+    uint32_t line;              /**< Línea en el fuente */
+} BcLine;
+
+/**
+ * @brief Función traducida.
+ */
+typedef struct BcFunction {
+    const char *name;           /**< Nombre (apunta al fuente, sin '\0') */
+    size_t name_length;
+    uint32_t param_count;       /**< Parámetros (ranuras 0 .. param_count - 1) */
+    uint32_t slot_count;        /**< Ranuras locales, incluidos los parámetros */
+    uint32_t max_stack;         /**< Profundidad máxima de la pila de operandos */
+    uint8_t *code;              /**< Instrucciones */
+    size_t length;              /**< Bytes de code */
+    BcCallSite *calls;          /**< Llamadas a funciones, por pc creciente */
+    size_t call_count;
+    BcOrigin *origins;          /**< Tramos por pc creciente; el primero empieza en 0 */
+    size_t origin_count;
+    BcLine *lines;              /**< Tramos por pc creciente; el primero empieza en 0 */
+    size_t line_count;
+    BcKernel *kernels;          /**< Núcleos de las instrucciones vector */
+    size_t kernel_count;
+} BcFunction;
+
+/**
+ * @brief Programa traducido.
+ */
+typedef struct BcModule {
+    BcFunction *functions;      /**< En el orden de SemaProgram */
+    size_t function_count;
+    size_t main_index;          /**< Función de entrada */
+    unsigned flags;             /**< Opciones de bc_compile() (BC_*) */
+    const uint8_t *strings;     /**< Literales internados (solo lectura), o NULL */
+    size_t strings_length;
+} BcModule;
+
+/**
+ * @brief Bytecode de una función guardado con bc_function_save().
+ *
+ * Es independiente de la posición de la función en el fuente y en el
+ * programa: las llamadas se guardan por nombre, los literales por
+ * contenido y las líneas relativas a la declaración, y bc_compile_reusing()
+ * los resuelve en el programa nuevo.
+ */
+typedef struct BcSaved {
+    const uint8_t *data;        /**< NULL para traducir la función desde el AST */
+    size_t length;
+} BcSaved;
+
+size_t bc_operand_size(BcOp op);
+const char *bc_op_name(BcOp op);
+int bc_compile(const SemaProgram *program, unsigned flags, DiagEngine *diag, BcModule *module);
+int bc_compile_parallel(const SemaProgram *program, unsigned flags, int threads, DiagEngine *diag,
+                        BcModule *module);
+int bc_compile_reusing(const SemaProgram *program, unsigned flags, const BcSaved *saved, int threads,
+                       DiagEngine *diag, BcModule *module);
+int bc_function_save(const SemaProgram *program, const BcModule *module, size_t index, FILE *out);
+void bc_free(BcModule *module);
+void bc_disassemble(const BcModule *module, FILE *out);
+uint32_t bc_origin(const BcFunction *function, size_t pc);
+size_t bc_origin_chain(const BcFunction *function, size_t pc, uint32_t *chain, size_t capacity);
+uint32_t bc_line(const BcFunction *function, size_t pc);
+int bc_copy_kernel(BcKernel *copy, const BcKernel *kernel, uint32_t slot_offset);
+
+/**
+ * @brief Lee un operando de 16 bits sin alinear.
+ */
+static inline uint16_t bc_read_u16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+/**
+ * @brief Lee un operando de 32 bits sin alinear.
+ */
+static inline uint32_t bc_read_u32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#endif // BYTECODE_H
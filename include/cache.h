@@ -0,0 +1,66 @@
+/**
+ * @file cache.h
+ * @brief Caché en disco de artefactos de compilación indexada por contenido.
+ *
+ * Cada entrada se identifica con un hash de 64 bits de los bytes del código
+ * fuente combinado con la versión del compilador, las banderas que afectan a
+ * la salida y el nombre del archivo fuente (que aparece en la cabecera de los
+ * archivos de tokens). Las escrituras son atómicas (archivo temporal más
+ * rename) y el tamaño total se acota expulsando las entradas menos usadas.
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/** Versión del compilador; forma parte de toda clave de caché. */
+#define COMPILADOR_VERSION "1.0.0"
+
+/** Carpeta por defecto de la caché, relativa al directorio de trabajo. */
+#define CACHE_DEFAULT_DIR ".compilador-cache"
+
+/** Tamaño máximo por defecto de la caché, en bytes. */
+#define CACHE_DEFAULT_MAX_BYTES (64UL * 1024UL * 1024UL)
+
+/**
+ * @brief Contadores de uso de la caché.
+ */
+typedef struct CacheStats {
+    unsigned long hits;       /**< Entradas servidas desde la caché */
+    unsigned long misses;     /**< Búsquedas sin entrada válida */
+    unsigned long stores;     /**< Entradas nuevas guardadas */
+    unsigned long evictions;  /**< Entradas expulsadas por tamaño */
+} CacheStats;
+
+/**
+ * @brief Caché abierta; puede compartirse entre hilos.
+ */
+typedef struct Cache {
+    char dir[512];                   /**< Carpeta de la caché */
+    size_t max_bytes;                /**< Límite de tamaño total */
+    atomic_ulong hits;               /**< Aciertos en esta ejecución */
+    atomic_ulong misses;             /**< Fallos en esta ejecución */
+    atomic_ulong stores;             /**< Entradas guardadas en esta ejecución */
+    atomic_ulong evictions;          /**< Entradas expulsadas en esta ejecución */
+    CacheStats flushed;              /**< Contadores ya acumulados en disco */
+    pthread_mutex_t lock;            /**< Serializa cache_flush() */
+} Cache;
+
+int cache_open(Cache *cache, const char *dir, size_t max_bytes);
+void cache_flush(Cache *cache);
+void cache_close(Cache *cache);
+uint64_t cache_key(const char *source, size_t length, const char *source_name,
+                   const char *flags);
+int cache_fetch(Cache *cache, uint64_t key, const char *dest_path);
+int cache_store(Cache *cache, uint64_t key, const char *src_path);
+int cache_load(Cache *cache, uint64_t key, const char *suffix, char **data, size_t *length);
+int cache_save(Cache *cache, uint64_t key, const char *suffix, const void *data, size_t length);
+int cache_temp_path(const char *target, char *buffer, size_t size);
+void cache_print_stats(Cache *cache, FILE *out);
+
+#endif // CACHE_H
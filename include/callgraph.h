@@ -0,0 +1,37 @@
+/**
+ * @file callgraph.h
+ * @brief Grafo de llamadas del programa traducido y sus componentes fuertes.
+ *
+ * Las aristas salen de las instrucciones call del bytecode (BcFunction.calls),
+ * sin repetir destinos. Las componentes fuertemente conexas (Tarjan) agrupan
+ * las funciones mutuamente recursivas; se numeran de modo que toda función
+ * llamada desde otra componente tiene un número menor, así recorrer @c order
+ * visita cada función después de todas las que llama fuera de su componente.
+ */
+
+#ifndef CALLGRAPH_H
+#define CALLGRAPH_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bytecode.h"
+
+/**
+ * @brief Grafo de llamadas en formato compacto (CSR).
+ */
+typedef struct CallGraph {
+    size_t function_count;
+    size_t *edge_start;         /**< Llamados de f: callees[edge_start[f] .. edge_start[f + 1]) */
+    uint32_t *callees;
+    uint32_t *component;        /**< Componente de cada función */
+    size_t component_count;
+    uint32_t *order;            /**< Funciones por componente creciente (llamados primero) */
+    uint8_t *recursive;         /**< 1 si la función está en un ciclo de llamadas */
+} CallGraph;
+
+int callgraph_build(const BcModule *module, CallGraph *graph);
+void callgraph_free(CallGraph *graph);
+void callgraph_print(const CallGraph *graph, const BcModule *module, FILE *out);
+
+#endif // CALLGRAPH_H
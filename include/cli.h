@@ -0,0 +1,66 @@
+/**
+ * @file cli.h
+ * @brief Interpretación y ejecución de la línea de comandos del compilador.
+ *
+ * Se separa de main.c para que el modo servidor pueda ejecutar exactamente
+ * las mismas órdenes que una invocación normal, con la salida capturada.
+ */
+
+#ifndef CLI_H
+#define CLI_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "arena.h"
+#include "cache.h"
+#include "inline.h"
+#include "sampler.h"
+
+/** Formatos de --stats y --profile-source. */
+#define CLI_STATS_NONE 0
+#define CLI_STATS_TEXT 1
+#define CLI_STATS_JSON 2
+
+/**
+ * @brief Opciones de línea de comandos ya interpretadas.
+ */
+typedef struct CliOptions {
+    int generate_tokens;       /**< -t */
+    int syntax_check;          /**< -p */
+    int run_mode;              /**< --run o --jit (DRIVER_RUN_*) */
+    int inline_calls;          /**< 0 con --no-inline */
+    InlineOptions inline_options; /**< --inline-threshold, --inline-loop-bonus */
+    int inline_report;         /**< --inline-report */
+    unsigned codegen_flags;    /**< --no-vectorize, --vectorize=sse2, --malloc-heap (BC_*) */
+    int heap_stats;            /**< --heap-stats */
+    unsigned vm_flags;         /**< --no-superinstructions (VM_*) */
+    int vm_profile;            /**< --vm-profile */
+    int prof;                  /**< --prof */
+    SamplerOptions prof_options; /**< --prof-interval, --prof-out, --prof-top */
+    const char *emit_module;   /**< --emit-module <archivo>, o NULL */
+    int load_module;           /**< --module */
+    int incremental;           /**< --incremental */
+    int incremental_report;    /**< --incremental-report */
+    unsigned lexer_flags;      /**< --utf8-columns (LEXER_*) */
+    int threads;               /**< -j <n>, 0 si no se indicó */
+    int parse_threads;         /**< --parse-threads <n>, 1 si no se indicó */
+    int codegen_threads;       /**< --codegen-threads <n>, 1 si no se indicó */
+    int force_batch;           /**< 1 si debe usarse el modo por lotes */
+    int use_cache;             /**< 0 con --no-cache */
+    int cache_stats;           /**< --cache-stats */
+    const char *cache_dir;     /**< --cache-dir <dir>, o NULL */
+    size_t cache_max_bytes;    /**< --cache-size <MB>, o 0 */
+    const char *server_socket; /**< --server <socket>, o NULL */
+    int stats_format;          /**< --stats[=json], uno de CLI_STATS_* */
+    int profile_format;        /**< --profile-source[=json], uno de CLI_STATS_* */
+    size_t profile_top;        /**< --profile-top <n>, o 0 */
+    char **inputs;             /**< Entradas (apuntan a argv) */
+    size_t input_count;        /**< Número de entradas */
+} CliOptions;
+
+void cli_print_usage(const char *program_name, FILE *out);
+int cli_parse(int argc, char *argv[], CliOptions *options, FILE *err);
+void cli_free(CliOptions *options);
+int cli_run(const CliOptions *options, Cache *cache, Arena *arena, FILE *out, FILE *err);
+
+#endif // CLI_H
@@ -0,0 +1,74 @@
+/**
+ * @file diag.h
+ * @brief Motor de diagnósticos con memoria preasignada.
+ *
+ * Los diagnósticos del lexer y del parser se acumulan en un búfer reservado
+ * una sola vez, con su posición en el fuente. Registrar un diagnóstico no
+ * reserva memoria y cuesta un tiempo acotado por la longitud del mensaje;
+ * si el búfer se llena, los siguientes solo se cuentan.
+ */
+
+#ifndef DIAG_H
+#define DIAG_H
+
+#include <stddef.h>
+#include <stdio.h>
+
+/** Diagnósticos que caben en un motor creado con capacidad 0. */
+#define DIAG_DEFAULT_CAPACITY 4096
+/** Bytes de texto reservados por diagnóstico. */
+#define DIAG_TEXT_PER_ITEM 96
+/** Longitud máxima de un mensaje. */
+#define DIAG_MAX_MESSAGE 256
+
+/**
+ * @brief Gravedad de un diagnóstico.
+ */
+typedef enum DiagSeverity {
+    DIAG_ERROR,
+    DIAG_WARNING
+} DiagSeverity;
+
+/**
+ * @brief Región del fuente a la que se refiere un diagnóstico.
+ */
+typedef struct SourceSpan {
+    size_t line;     /**< Línea inicial (desde 1) */
+    size_t column;   /**< Columna inicial (desde 1) */
+    size_t length;   /**< Longitud en bytes (0 si es un punto) */
+} SourceSpan;
+
+/**
+ * @brief Un diagnóstico registrado.
+ */
+typedef struct Diagnostic {
+    DiagSeverity severity;  /**< Gravedad */
+    SourceSpan span;        /**< Posición en el fuente */
+    size_t message;         /**< Desplazamiento del mensaje en el texto del motor */
+} Diagnostic;
+
+/**
+ * @brief Motor de diagnósticos.
+ */
+typedef struct DiagEngine {
+    Diagnostic *items;      /**< Diagnósticos registrados */
+    size_t count;           /**< Diagnósticos almacenados */
+    size_t capacity;        /**< Máximo de diagnósticos almacenables */
+    char *text;             /**< Mensajes, terminados en '\0' */
+    size_t text_used;       /**< Bytes ocupados en text */
+    size_t text_capacity;   /**< Bytes reservados en text */
+    size_t errors;          /**< Errores reportados (incluidos los descartados) */
+    size_t warnings;        /**< Avisos reportados (incluidos los descartados) */
+    size_t dropped;         /**< Diagnósticos que no cupieron */
+} DiagEngine;
+
+int diag_init(DiagEngine *diag, size_t capacity);
+void diag_reset(DiagEngine *diag);
+void diag_free(DiagEngine *diag);
+void diag_report(DiagEngine *diag, DiagSeverity severity, SourceSpan span, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+void diag_print(const DiagEngine *diag, const char *path, FILE *out);
+void diag_sort_from(DiagEngine *diag, size_t first);
+int diag_merge(DiagEngine *dst, const DiagEngine *src);
+
+#endif // DIAG_H
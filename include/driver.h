@@ -0,0 +1,66 @@
+/**
+ * @file driver.h
+ * @brief Operaciones del compilador sobre un único archivo fuente.
+ *
+ * Agrupa las acciones que antes vivían en main.c para que puedan reutilizarse
+ * desde el modo de un solo archivo y desde el modo por lotes. Toda la salida
+ * informativa se escribe en el flujo recibido; los errores van a stderr.
+ */
+
+#ifndef DRIVER_H
+#define DRIVER_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "arena.h"
+#include "cache.h"
+#include "inline.h"
+#include "vm.h"
+
+/** Carpeta donde se depositan los archivos de tokens para el parser. */
+#define DRIVER_TOKENS_DIR "docs/Analizador-sintactico/archivos_parser"
+
+/** Ejecución del programa (--run, --jit). */
+#define DRIVER_RUN_NONE 0
+#define DRIVER_RUN_VM 1
+#define DRIVER_RUN_JIT 2
+
+/**
+ * @brief Recursos con los que se ejecuta una operación del driver.
+ */
+typedef struct DriverContext {
+    FILE *out;      /**< Salida informativa */
+    FILE *err;      /**< Mensajes de error */
+    Cache *cache;   /**< Caché de compilación, o NULL */
+    Arena *arena;   /**< Arena para leer el fuente, o NULL para usar malloc */
+    unsigned lexer_flags; /**< Opciones del lexer (LEXER_*) */
+    int parse_threads;    /**< Hilos del análisis sintáctico (0 = núcleos disponibles) */
+    int run_mode;         /**< Uno de DRIVER_RUN_* */
+    const InlineOptions *inline_options; /**< Expansión en línea al ejecutar, o NULL */
+    int inline_report;    /**< 1 para reportar en err las llamadas expandidas */
+    unsigned codegen_flags; /**< Opciones de bc_compile() (BC_*) */
+    int heap_stats;       /**< 1 para reportar en err las asignaciones de String y Array */
+    int incremental;      /**< 1 para reutilizar de la caché el bytecode de las funciones sin cambios */
+    int incremental_report; /**< 1 para reportar en err las funciones recompiladas */
+    int codegen_threads;  /**< Hilos de la traducción y la expansión en línea (0 = núcleos disponibles) */
+    unsigned vm_flags;    /**< Opciones de vm_execute() (VM_*) */
+    VmProfile *vm_profile; /**< Perfil que acumula la máquina virtual, o NULL */
+    const SamplerOptions *sampler; /**< Perfil por muestreo de la ejecución (--prof), o NULL */
+} DriverContext;
+
+int driver_tokens_output_path(const char *filename, char *buffer, size_t size);
+char *driver_read_source(const char *filename, Arena *arena, size_t *length);
+void driver_release_source(char *source, Arena *arena);
+int driver_run_lexical_analysis(const char *filename, const DriverContext *ctx);
+int driver_run_syntax_analysis(const char *filename, const DriverContext *ctx);
+int driver_write_tokens(const char *filename, const char *source, size_t length,
+                        const char *output_path, unsigned lexer_flags, Cache *cache,
+                        int *from_cache);
+int driver_generate_tokens_file(const char *filename, const DriverContext *ctx);
+int driver_execute_source(const char *filename, const char *source, const DriverContext *ctx,
+                          RunResult *result);
+int driver_run_program(const char *filename, const DriverContext *ctx);
+int driver_emit_module(const char *filename, const char *output, const DriverContext *ctx);
+int driver_run_module(const char *path, const DriverContext *ctx);
+
+#endif // DRIVER_H
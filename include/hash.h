@@ -0,0 +1,17 @@
+/**
+ * @file hash.h
+ * @brief Función hash rápida no criptográfica de 64 bits.
+ *
+ * Implementación del algoritmo XXH64, usada para identificar contenidos
+ * (por ejemplo, las claves de la caché de compilación).
+ */
+
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+uint64_t hash64(const void *data, size_t length, uint64_t seed);
+
+#endif // HASH_H
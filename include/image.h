@@ -0,0 +1,68 @@
+/**
+ * @file image.h
+ * @brief Módulo de bytecode precompilado en disco (--emit-module, --module).
+ *
+ * La imagen guarda un BcModule ya traducido y optimizado en secciones
+ * independientes de la posición: el segmento de literales tal como lo
+ * interna la traducción (las referencias RtRef de literal son
+ * desplazamientos dentro de él), una tabla de nombres de función, la tabla
+ * de funciones y las secciones de código, llamadas, tramos de origen y de
+ * línea y núcleos vectoriales. Todas las referencias entre secciones son
+ * índices o desplazamientos, así que image_open() proyecta el archivo con un
+ * solo mmap de solo lectura y las instrucciones se ejecutan desde ahí sin
+ * corregir ninguna; solo se construye la tabla de BcFunction que apunta a la
+ * proyección.
+ *
+ * La cabecera lleva una versión del formato, la del compilador que la
+ * escribió y un XXH64 del resto del archivo; una imagen de otra versión o
+ * dañada se rechaza. Los números se guardan en el orden de bytes del
+ * procesador, así que una imagen de otro orden no pasa la primera palabra.
+ * La suma detecta archivos corruptos, no modificados a propósito: el
+ * bytecode de una imagen se ejecuta con la misma confianza que el recién
+ * traducido.
+ */
+
+#ifndef IMAGE_H
+#define IMAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bytecode.h"
+
+/** Primera palabra de la imagen ("CBCM"). */
+#define IMAGE_MAGIC 0x4d434243u
+
+/** Versión del formato; cambia con cualquier cambio de sus estructuras. */
+#define IMAGE_FORMAT_VERSION 3u
+
+/** Alineación de cada sección dentro del archivo. */
+#define IMAGE_ALIGN 16u
+
+/**
+ * @brief Resultado de image_open().
+ */
+typedef enum ImageStatus {
+    IMAGE_OK,
+    IMAGE_IO,                   /**< No se pudo abrir o proyectar el archivo */
+    IMAGE_FORMAT,               /**< No es una imagen, o sus tablas salen del archivo */
+    IMAGE_VERSION,              /**< Otra versión del formato o del compilador */
+    IMAGE_CHECKSUM,             /**< El contenido no coincide con su suma */
+    IMAGE_NO_MEMORY
+} ImageStatus;
+
+/**
+ * @brief Imagen abierta: la proyección y la tabla de funciones construida sobre ella.
+ */
+typedef struct BcImage {
+    const uint8_t *map;         /**< Archivo proyectado (solo lectura) */
+    size_t size;
+    BcKernel *kernels;          /**< Núcleos de todas las funciones */
+} BcImage;
+
+const char *image_status_message(ImageStatus status);
+int image_write(const BcModule *module, FILE *out);
+ImageStatus image_open(const char *path, BcImage *image, BcModule *module);
+void image_close(BcImage *image, BcModule *module);
+
+#endif // IMAGE_H
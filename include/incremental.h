@@ -0,0 +1,71 @@
+/**
+ * @file incremental.h
+ * @brief Compilación incremental por función para --run y --jit (--incremental).
+ *
+ * Cada función de nivel superior se identifica por una huella de sus
+ * tokens (tipo, lexema y posición relativa a su 'fn') y por la de su firma.
+ * El grafo de dependencias une cada función con las que llama. Por cada
+ * archivo se guarda en la caché una entrada `.inc` con el grafo y el
+ * bytecode de cada función, junto a una clave que combina su huella, la
+ * firma actual de cada función que llama y las opciones de compilación.
+ * Así, al volver a compilar solo se analizan, comprueban y traducen las
+ * funciones que cambiaron y las que llaman a una función cuya firma
+ * cambió; del resto basta la firma.
+ */
+
+#ifndef INCREMENTAL_H
+#define INCREMENTAL_H
+
+#include <stddef.h>
+#include <stdio.h>
+#include "arena.h"
+#include "bytecode.h"
+#include "cache.h"
+#include "diag.h"
+#include "sema.h"
+
+/** Tipo de entrada de la caché con el grafo y el bytecode de un archivo. */
+#define INCREMENTAL_SUFFIX "inc"
+
+/**
+ * @brief Motivo por el que una función se recompiló (o no).
+ */
+typedef enum IncrementalReason {
+    INCREMENTAL_REUSED,         /**< Su bytecode vino de la caché */
+    INCREMENTAL_NEW,            /**< No estaba en la compilación anterior */
+    INCREMENTAL_CHANGED,        /**< Cambiaron sus tokens */
+    INCREMENTAL_DEPENDENT,      /**< Cambió la firma de una función que llama */
+    INCREMENTAL_UNCACHED        /**< Sin cambios, pero su bytecode no está en la caché */
+} IncrementalReason;
+
+/**
+ * @brief Función recompilada, para el reporte.
+ */
+typedef struct IncrementalRebuild {
+    const char *name;           /**< Nombre (apunta al fuente) */
+    size_t name_length;
+    uint32_t line;              /**< Posición de su 'fn' */
+    uint32_t column;
+    IncrementalReason reason;
+    const char *dependency;     /**< Con INCREMENTAL_DEPENDENT, la función cuya firma cambió */
+    size_t dependency_length;
+} IncrementalRebuild;
+
+/**
+ * @brief Resultado de una compilación incremental.
+ */
+typedef struct IncrementalReport {
+    size_t items;               /**< Funciones del archivo */
+    size_t counts[INCREMENTAL_UNCACHED + 1]; /**< Funciones por IncrementalReason */
+    IncrementalRebuild *rebuilt; /**< Recompiladas, en orden del fuente */
+    size_t rebuilt_count;
+    int full;                   /**< 1 si el archivo no se pudo partir en funciones y se compiló entero */
+} IncrementalReport;
+
+int incremental_compile(const char *filename, const char *source, Cache *cache, unsigned lexer_flags,
+                        unsigned codegen_flags, int codegen_threads, DiagEngine *diag, Arena *arena,
+                        SemaProgram *sema, BcModule *module, IncrementalReport *report);
+void incremental_report_print(const IncrementalReport *report, const char *filename, FILE *out);
+void incremental_report_free(IncrementalReport *report);
+
+#endif // INCREMENTAL_H
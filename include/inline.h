@@ -0,0 +1,73 @@
+/**
+ * @file inline.h
+ * @brief Expansión en línea de llamadas sobre el bytecode.
+ *
+ * Las funciones se procesan de abajo hacia arriba en el grafo de llamadas
+ * (callgraph.h), de modo que al expandir una llamada el cuerpo del llamado
+ * ya tiene expandidas las suyas. Nunca se expanden funciones recursivas.
+ *
+ * Modelo de costo: el costo de una llamada es el crecimiento del llamador en
+ * instrucciones (el cuerpo del llamado más los store de sus argumentos, menos
+ * el call). Se expande si no supera el umbral, al que se suma una
+ * bonificación cuando la llamada está dentro de un ciclo, donde ahorrar la
+ * llamada rinde en cada iteración. Además, el marco resultante debe caber
+ * en BC_MAX_FRAME_SLOTS y ninguna función puede pasar de
+ * INLINE_MAX_FUNCTION_BYTES.
+ */
+
+#ifndef INLINE_H
+#define INLINE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bytecode.h"
+
+/** Umbral de costo por omisión (--inline-threshold). */
+#define INLINE_DEFAULT_THRESHOLD 24
+/** Bonificación por omisión dentro de ciclos (--inline-loop-bonus). */
+#define INLINE_DEFAULT_LOOP_BONUS 48
+/** Tamaño máximo de una función tras las expansiones. */
+#define INLINE_MAX_FUNCTION_BYTES 65536
+
+/**
+ * @brief Parámetros del modelo de costo.
+ */
+typedef struct InlineOptions {
+    uint32_t threshold;         /**< Costo máximo de una llamada fuera de ciclos */
+    uint32_t loop_bonus;        /**< Costo adicional admitido dentro de un ciclo */
+} InlineOptions;
+
+/**
+ * @brief Llamada expandida.
+ */
+typedef struct InlineSite {
+    uint32_t caller;
+    uint32_t callee;
+    uint32_t line;              /**< Posición de la llamada en el fuente */
+    uint32_t column;
+    uint32_t cost;
+    uint32_t limit;             /**< Umbral aplicado (con la bonificación) */
+    int in_loop;
+} InlineSite;
+
+/**
+ * @brief Resultado de inline_module().
+ */
+typedef struct InlineReport {
+    InlineSite *sites;          /**< Llamadas expandidas, en orden de proceso */
+    size_t count;
+    size_t capacity;
+    size_t considered;          /**< Llamadas examinadas */
+    size_t recursive;           /**< Descartadas por ser recursivas */
+} InlineReport;
+
+void inline_options_default(InlineOptions *options);
+int inline_module(BcModule *module, const InlineOptions *options, InlineReport *report);
+int inline_module_parallel(BcModule *module, const InlineOptions *options, int threads,
+                           InlineReport *report);
+void inline_report_print(const InlineReport *report, const BcModule *module, const char *path,
+                         FILE *out);
+void inline_report_free(InlineReport *report);
+
+#endif // INLINE_H
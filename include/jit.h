@@ -0,0 +1,27 @@
+/**
+ * @file jit.h
+ * @brief Compilador JIT de bytecode a código x86-64.
+ *
+ * Cada función se traduce a código máquina la primera vez que se llama (hasta
+ * entonces su entrada en la tabla de funciones apunta a un stub que la
+ * compila y la reemplaza). El código se escribe en páginas propias que
+ * pasan de escribibles a ejecutables antes de usarse (W^X) y se guarda en una
+ * caché del proceso indexada por el bytecode, así que ejecutar otra vez el
+ * mismo programa (por ejemplo en --serve) no vuelve a compilar. Solo está
+ * disponible en Linux x86-64; en otras plataformas jit_run() devuelve
+ * RUN_UNSUPPORTED. jit_run_sampled() toma las muestras de --prof (ver sampler.h)
+ * recorriendo la cadena de rbp del código generado.
+ */
+
+#ifndef JIT_H
+#define JIT_H
+
+#include <stdio.h>
+#include "bytecode.h"
+#include "vm.h"
+
+int jit_available(void);
+int jit_run(const BcModule *module, FILE *out, RunResult *result);
+int jit_run_sampled(const BcModule *module, Sampler *sampler, FILE *out, RunResult *result);
+
+#endif // JIT_H
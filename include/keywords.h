@@ -11,8 +11,10 @@
 #define KEYWORDS_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 bool is_keyword(const char *lexeme);
 int get_keyword_index(const char *lexeme);
+int get_keyword_index_n(const char *lexeme, size_t length);
 
 #endif
\ No newline at end of file
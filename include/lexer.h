@@ -10,73 +10,86 @@
 #define LEXER_H
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include "diag.h"
+
+/**
+ * @brief Tabla de tipos de token: X(enumerador, nombre en los volcados).
+ *
+ * De ella se generan el enum TokenType y token_type_name(), de modo que no
+ * pueden desincronizarse. El orden fija los identificadores numéricos de -t.
+ */
+#define TOKEN_TYPES(X) \
+    X(TOKEN_IDENTIFIER,    "IDENT")         /* Identificador */ \
+    X(TOKEN_NUMBER,        "NUMBER")        /* Literal numérico */ \
+    X(TOKEN_STRING,        "STRING")        /* Literal de cadena */ \
+    X(TOKEN_CHAR,          "CHAR")          /* Literal de carácter */ \
+    /* Palabras reservadas */ \
+    X(TOKEN_KW_FN,         "KW_FN") \
+    X(TOKEN_KW_LET,        "KW_LET") \
+    X(TOKEN_KW_MUT,        "KW_MUT") \
+    X(TOKEN_KW_IF,         "KW_IF") \
+    X(TOKEN_KW_ELSE,       "KW_ELSE") \
+    X(TOKEN_KW_MATCH,      "KW_MATCH") \
+    X(TOKEN_KW_WHILE,      "KW_WHILE") \
+    X(TOKEN_KW_LOOP,       "KW_LOOP") \
+    X(TOKEN_KW_FOR,        "KW_FOR") \
+    X(TOKEN_KW_IN,         "KW_IN") \
+    X(TOKEN_KW_BREAK,      "KW_BREAK") \
+    X(TOKEN_KW_CONTINUE,   "KW_CONTINUE") \
+    X(TOKEN_KW_RETURN,     "KW_RETURN") \
+    X(TOKEN_KW_TRUE,       "KW_TRUE") \
+    X(TOKEN_KW_FALSE,      "KW_FALSE") \
+    X(TOKEN_KW_I32,        "KW_I32") \
+    X(TOKEN_KW_F64,        "KW_F64") \
+    X(TOKEN_KW_BOOL,       "KW_BOOL") \
+    X(TOKEN_KW_CHAR,       "KW_CHAR") \
+    /* Operadores */ \
+    X(TOKEN_PLUS,          "PLUS") \
+    X(TOKEN_MINUS,         "MINUS") \
+    X(TOKEN_STAR,          "STAR") \
+    X(TOKEN_SLASH,         "SLASH") \
+    X(TOKEN_PERCENT,       "PERCENT") \
+    X(TOKEN_EQUAL,         "EQUAL") \
+    X(TOKEN_EQUAL_EQUAL,   "EQUAL_EQUAL") \
+    X(TOKEN_BANG,          "BANG") \
+    X(TOKEN_BANG_EQUAL,    "BANG_EQUAL") \
+    X(TOKEN_LESS,          "LESS") \
+    X(TOKEN_LESS_EQUAL,    "LESS_EQUAL") \
+    X(TOKEN_GREATER,       "GREATER") \
+    X(TOKEN_GREATER_EQUAL, "GREATER_EQUAL") \
+    X(TOKEN_AND_AND,       "AND_AND") \
+    X(TOKEN_OR_OR,         "OR_OR") \
+    X(TOKEN_PLUS_EQUAL,    "PLUS_EQUAL") \
+    X(TOKEN_MINUS_EQUAL,   "MINUS_EQUAL") \
+    X(TOKEN_STAR_EQUAL,    "STAR_EQUAL") \
+    X(TOKEN_SLASH_EQUAL,   "SLASH_EQUAL") \
+    X(TOKEN_PERCENT_EQUAL, "PERCENT_EQUAL") \
+    X(TOKEN_PLUS_PLUS,     "PLUS_PLUS") \
+    X(TOKEN_MINUS_MINUS,   "MINUS_MINUS") \
+    X(TOKEN_ARROW,         "ARROW") \
+    /* Puntuación y delimitadores */ \
+    X(TOKEN_DOT,           "DOT") \
+    X(TOKEN_COMMA,         "COMMA") \
+    X(TOKEN_SEMICOLON,     "SEMICOLON") \
+    X(TOKEN_COLON,         "COLON") \
+    X(TOKEN_LPAREN,        "LPAREN") \
+    X(TOKEN_RPAREN,        "RPAREN") \
+    X(TOKEN_LBRACE,        "LBRACE") \
+    X(TOKEN_RBRACE,        "RBRACE") \
+    X(TOKEN_LBRACKET,      "LBRACKET") \
+    X(TOKEN_RBRACKET,      "RBRACKET") \
+    /* Misceláneos */ \
+    X(TOKEN_UNKNOWN,       "UNKNOWN") \
+    X(TOKEN_EOF,           "EOF")
 
 /*
 * @brief Definición del enum TokenType
 */
 typedef enum TokenType {
-    TOKEN_IDENTIFIER,   /**< Identificador */
-    TOKEN_NUMBER,       /**< Literal numérico */
-    TOKEN_STRING,       /**< Literal de cadena */
-    TOKEN_CHAR,         /**< Literal de carácter */
-    /* Palabras reservadas */
-    TOKEN_KW_FN,
-    TOKEN_KW_LET,
-    TOKEN_KW_MUT,
-    TOKEN_KW_IF,
-    TOKEN_KW_ELSE,
-    TOKEN_KW_MATCH,
-    TOKEN_KW_WHILE,
-    TOKEN_KW_LOOP,
-    TOKEN_KW_FOR,
-    TOKEN_KW_IN,
-    TOKEN_KW_BREAK,
-    TOKEN_KW_CONTINUE,
-    TOKEN_KW_RETURN,
-    TOKEN_KW_TRUE,
-    TOKEN_KW_FALSE,
-    TOKEN_KW_I32,
-    TOKEN_KW_F64,
-    TOKEN_KW_BOOL,
-    TOKEN_KW_CHAR,
-    /* Operadores */
-    TOKEN_PLUS,
-    TOKEN_MINUS,
-    TOKEN_STAR,
-    TOKEN_SLASH,
-    TOKEN_PERCENT,
-    TOKEN_EQUAL,
-    TOKEN_EQUAL_EQUAL,
-    TOKEN_BANG,
-    TOKEN_BANG_EQUAL,
-    TOKEN_LESS,
-    TOKEN_LESS_EQUAL,
-    TOKEN_GREATER,
-    TOKEN_GREATER_EQUAL,
-    TOKEN_AND_AND,
-    TOKEN_OR_OR,
-    TOKEN_PLUS_EQUAL,
-    TOKEN_MINUS_EQUAL,
-    TOKEN_STAR_EQUAL,
-    TOKEN_SLASH_EQUAL,
-    TOKEN_PERCENT_EQUAL,
-    TOKEN_PLUS_PLUS,
-    TOKEN_MINUS_MINUS,
-    TOKEN_ARROW,
-    /* Puntuación y delimitadores */
-    TOKEN_DOT,
-    TOKEN_COMMA,
-    TOKEN_SEMICOLON,
-    TOKEN_COLON,
-    TOKEN_LPAREN,
-    TOKEN_RPAREN,
-    TOKEN_LBRACE,
-    TOKEN_RBRACE,
-    TOKEN_LBRACKET,
-    TOKEN_RBRACKET,
-    /* Misceláneos */
-    TOKEN_UNKNOWN,
-    TOKEN_EOF
+#define TOKEN_ENUM(type, name) type,
+    TOKEN_TYPES(TOKEN_ENUM)
+#undef TOKEN_ENUM
 } TokenType;
 
 /*
@@ -90,25 +103,83 @@ typedef struct token_t{
     struct token_t *next; /**< Puntero al siguiente token (para lista enlazada) */
 } token_t;
 
+/**
+ * @brief Receptor de los errores internos del lexer (memoria, E/S).
+ *
+ * Sustituye a la impresión en stdout: cada llamador decide dónde van los
+ * mensajes. Los errores léxicos del fuente van al DiagEngine.
+ *
+ * @param user_data Dato opaco registrado junto con la función.
+ * @param message Mensaje en una línea, sin salto final.
+ */
+typedef void (*LexerErrorCallback)(void *user_data, const char *message);
+
+/** Columnas en puntos de código en lugar de bytes (--utf8-columns). */
+#define LEXER_UTF8_COLUMNS 0x1u
+/** Con TokenStream, el lexer produce los tokens en su propio hilo (--lexer-thread). */
+#define LEXER_THREADED 0x2u
+/** Líneas y columnas no significativas (pueden valer 0): para contar o validar. */
+#define LEXER_NO_POSITIONS 0x4u
+/** Usar siempre la variante completa del lexer, sin pre-escaneo (pruebas). */
+#define LEXER_GENERIC 0x8u
+
+/**
+ * @brief Token compacto: el lexema es un tramo del código fuente.
+ *
+ * No reserva memoria y ocupa 20 bytes; limita el fuente a 4 GiB.
+ */
+typedef struct LexToken {
+    TokenType type;       /**< Tipo de token */
+    uint32_t offset;      /**< Desplazamiento del lexema en el código fuente */
+    uint32_t length;      /**< Longitud del lexema en bytes (0 para EOF) */
+    uint32_t line;        /**< Línea donde empieza el token */
+    uint32_t column;      /**< Columna donde empieza el token */
+} LexToken;
+
 /*
 * @brief Estructura del lexer
 */
 typedef struct Lexer {
     const char *source;   /**< Código fuente a analizar */
     const char *p;        /**< Puntero actual en el código fuente */
+    const char *end;      /**< Terminador '\0' del código fuente */
     size_t line;          /**< Línea actual */
     size_t col;           /**< Columna actual */
+    unsigned flags;       /**< Combinación de LEXER_* */
+    DiagEngine *diag;     /**< Destino de los errores léxicos, o NULL */
+    LexerErrorCallback on_error; /**< Errores internos, o NULL para ignorarlos */
+    void *error_data;     /**< Dato de on_error */
+    const char *unclosed_string;  /**< Primera comilla sin cierre conocida, o NULL */
+    const char *unclosed_comment; /**< Primer '/' + '*' sin cierre conocido, o NULL */
+    unsigned features;    /**< Construcciones presentes en el fuente (pre-escaneo) */
+    unsigned variant;     /**< Variante especializada en uso (ver lexer_variant_name()) */
 } Lexer;
 
 token_t *create_token(TokenType type, const char *lexeme,size_t line, size_t column);
 void free_token(token_t *token);
 void free_token_list(token_t *head);
 void lexer_init(Lexer *lxr, const char *source);
+Lexer *lexer_create(const char *source);
+void lexer_destroy(Lexer *lxr);
+void lexer_set_diagnostics(Lexer *lxr, DiagEngine *diag);
+void lexer_seek(Lexer *lxr, size_t offset, size_t line, size_t column);
+void lexer_set_flags(Lexer *lxr, unsigned flags);
+void lexer_set_error_callback(Lexer *lxr, LexerErrorCallback on_error, void *user_data);
+void lexer_error_to_stream(void *stream, const char *message);
+int lexer_set_variant(Lexer *lxr, const char *name);
+const char *lexer_variant_name(const Lexer *lxr);
+const char *lexer_variant_at(size_t index);
+int lexer_next_compact(Lexer *lxr, LexToken *token);
+size_t lexer_next_batch(Lexer *lxr, LexToken *tokens, size_t max);
 token_t* lexer_next_token(Lexer *lxr);
-char *read_file(const char *filename);
-token_t *get_next_token(const char *source);
+char *read_file(const char *filename, LexerErrorCallback on_error, void *user_data);
 token_t *tokenize_all(const char *source);
 const char* token_type_name(TokenType t);
-int write_tokens_to_file(const char *source_file, const char *output_file);
+int write_tokens_to_stream(const char *source_name, const char *source, unsigned flags, FILE *output);
+int write_tokens_to_file(const char *source_file, const char *output_file,
+                         LexerErrorCallback on_error, void *user_data);
+#ifdef LEXER_DEBUG
+const char *lexer_char_class_name(int char_class);
+#endif
 
 #endif // LEXER_H
\ No newline at end of file
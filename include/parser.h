@@ -0,0 +1,81 @@
+/**
+ * @file parser.h
+ * @brief Analizador sintáctico descendente recursivo con recuperación en modo pánico.
+ *
+ * Reconoce la gramática de docs/Analizador-sintactico/docs/gramatica.md
+ * consumiendo los tokens compactos de un TokenStream. Ante un error se reporta un
+ * único diagnóstico y se descartan tokens hasta un punto de sincronización
+ * (';', '}' o el inicio de una sentencia, según tabla-pi-pd.md), de modo que
+ * un archivo con miles de errores se analiza en tiempo lineal y todos se
+ * reportan en una sola ejecución.
+ *
+ * Los fuentes grandes pueden analizarse en paralelo partiéndolos en las
+ * funciones de nivel superior (parse_source_parallel()), con el mismo
+ * resultado que en serie. parse_source_ast() construye además el AST (ver
+ * ast.h) para las fases siguientes, también en paralelo con
+ * parse_source_ast_parallel(), y parse_tokens_ast() lo construye a
+ * partir de tokens ya lexeados con parse_lex_tokens(). parse_items()
+ * analiza solo algunos items desde una posición del fuente (reparse.h).
+ */
+
+#ifndef PARSER_H
+#define PARSER_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "ast.h"
+#include "diag.h"
+#include "lexer.h"
+
+/** Profundidad máxima de anidamiento de sentencias y expresiones. */
+#define PARSER_MAX_DEPTH 256
+
+/** Tamaño mínimo del fuente para que parse_source_parallel() use hilos. */
+#define PARSER_PARALLEL_MIN_BYTES (256 * 1024)
+
+/** Tokens mínimos por fragmento de parse_source_parallel(). */
+#define PARSER_CHUNK_TOKENS 8192
+
+/**
+ * @brief Resultado del análisis de un fuente.
+ */
+typedef struct ParseResult {
+    size_t tokens;          /**< Tokens leídos (incluidos EOF y los no reconocidos) */
+    size_t lexical_errors;  /**< Errores reportados por el lexer */
+    size_t syntax_errors;   /**< Errores reportados por el parser */
+} ParseResult;
+
+/**
+ * @brief Item de nivel superior analizado por parse_items().
+ */
+typedef struct ParseItem {
+    uint32_t offset;        /**< Posición de su primer token */
+    uint32_t length;
+    uint32_t line;
+    uint32_t column;
+    AstNode *node;          /**< Función o sentencia, o NULL si no produjo nodo */
+    size_t diagnostics;     /**< Diagnósticos sintácticos registrados al terminarlo */
+} ParseItem;
+
+/**
+ * @brief Decide si parse_items() termina antes del item que empieza en @p token.
+ *
+ * @return Distinto de 0 para terminar.
+ */
+typedef int (*ParseStopFn)(void *context, const LexToken *token);
+
+int parse_source(const char *source, unsigned lexer_flags, DiagEngine *diag, ParseResult *result);
+int parse_source_parallel(const char *source, unsigned lexer_flags, int threads,
+                          DiagEngine *diag, ParseResult *result);
+int parse_source_ast(const char *source, unsigned lexer_flags, DiagEngine *diag, Arena *arena,
+                     AstNode **program, ParseResult *result);
+int parse_source_ast_parallel(const char *source, unsigned lexer_flags, int threads, DiagEngine *diag,
+                              Arena *arena, AstNode **program, ParseResult *result);
+LexToken *parse_lex_tokens(const char *source, unsigned lexer_flags, DiagEngine *diag, size_t *count);
+int parse_tokens_ast(const char *source, const LexToken *tokens, DiagEngine *diag, Arena *arena,
+                     AstNode **program);
+int parse_items(const char *source, const LexToken *start, unsigned lexer_flags, DiagEngine *lexical,
+                DiagEngine *syntax, Arena *arena, ParseStopFn stop, void *context,
+                ParseItem **items, size_t *count, LexToken *end, size_t *unclosed);
+
+#endif // PARSER_H
@@ -0,0 +1,88 @@
+/**
+ * @file profile.h
+ * @brief Perfil estadístico de un corpus de fuentes (--profile-source).
+ *
+ * Recorre los tokens de cada fuente una sola vez y acumula: histograma por
+ * tipo de token, distribución de longitudes de identificador, clases de
+ * literal numérico (las ramas de lex_number), bytes de comentario y tokens
+ * por línea. Las frecuencias de identificadores se estiman con un count-min
+ * sketch de tamaño fijo, así que la memoria no depende del tamaño del corpus
+ * ni del número de identificadores distintos; solo se guardan los
+ * PROFILE_MAX_TOP candidatos más frecuentes.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "lexer.h"
+
+/** Filas del count-min sketch: probabilidad de fallo e^-4 (< 2 %). */
+#define PROFILE_SKETCH_DEPTH 4
+
+/** Contadores por fila (potencia de 2): error relativo e/ancho (< 0.07 %). */
+#define PROFILE_SKETCH_WIDTH 4096
+
+/** Identificadores más frecuentes reportados por defecto y como máximo. */
+#define PROFILE_DEFAULT_TOP 20
+#define PROFILE_MAX_TOP 1000
+
+/** Bytes guardados de cada identificador frecuente (los demás se recortan). */
+#define PROFILE_NAME_MAX 48
+
+/** Las longitudes de identificador mayores o iguales comparten la última casilla. */
+#define PROFILE_LENGTH_BUCKETS 32
+
+/**
+ * @brief Clases de literal numérico, una por rama de lex_number().
+ */
+typedef enum ProfileNumberKind {
+    PROFILE_NUMBER_INTEGER,   /**< Decimal entero */
+    PROFILE_NUMBER_REAL,      /**< Con parte fraccionaria */
+    PROFILE_NUMBER_EXPONENT,  /**< Con exponente (e/E) */
+    PROFILE_NUMBER_HEX,       /**< 0x... */
+    PROFILE_NUMBER_BINARY,    /**< 0b... */
+    PROFILE_NUMBER_KINDS
+} ProfileNumberKind;
+
+/**
+ * @brief Candidato a identificador frecuente.
+ */
+typedef struct ProfileName {
+    uint64_t hash;                /**< hash64() del identificador completo */
+    uint32_t count;               /**< Frecuencia estimada por el sketch */
+    uint32_t length;              /**< Longitud completa en bytes */
+    char text[PROFILE_NAME_MAX];  /**< Prefijo del identificador, terminado en '\0' */
+} ProfileName;
+
+/**
+ * @brief Perfil acumulado de uno o varios fuentes.
+ */
+typedef struct SourceProfile {
+    size_t files;                                /**< Fuentes analizados */
+    size_t bytes;                                /**< Bytes de fuente */
+    size_t comment_bytes;                        /**< Bytes dentro de comentarios */
+    size_t lines;                                /**< Líneas de fuente */
+    size_t code_lines;                           /**< Líneas donde empieza algún token */
+    size_t tokens[TOKEN_EOF];                    /**< Tokens por tipo (sin EOF) */
+    size_t identifier_lengths[PROFILE_LENGTH_BUCKETS + 1]; /**< Casilla = longitud */
+    size_t identifier_bytes;                     /**< Suma de longitudes */
+    size_t identifier_max;                       /**< Identificador más largo */
+    size_t numbers[PROFILE_NUMBER_KINDS];        /**< Literales por clase */
+    uint32_t *sketch;                            /**< DEPTH x WIDTH contadores */
+    ProfileName *top;                            /**< Candidatos (sin orden) */
+    size_t top_capacity;                         /**< Identificadores a reportar */
+    size_t top_count;                            /**< Candidatos en uso */
+    uint32_t top_min;                            /**< Menor frecuencia con la lista llena */
+} SourceProfile;
+
+int profile_init(SourceProfile *profile, size_t top);
+void profile_free(SourceProfile *profile);
+void profile_add_source(SourceProfile *profile, const char *source, size_t length,
+                        unsigned lexer_flags);
+void profile_print(const SourceProfile *profile, FILE *out);
+void profile_print_json(const SourceProfile *profile, FILE *out);
+
+#endif // PROFILE_H
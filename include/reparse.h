@@ -0,0 +1,87 @@
+/**
+ * @file reparse.h
+ * @brief Análisis sintáctico incremental de un documento que se edita.
+ *
+ * El documento guarda su texto, el AST y, por cada item de nivel superior,
+ * la posición de su primer token: los puntos donde el lexer y el parser
+ * pueden retomar el análisis sin estado pendiente. Tras una edición solo se
+ * relexea y se analiza desde el item que la contiene hasta el primer item
+ * posterior que empieza en el mismo token que antes; el resto de los
+ * subárboles se reutiliza sin tocarlos. Como las posiciones de los nodos son
+ * relativas a su item (ver ast.h), mover un item solo cambia su raíz.
+ *
+ * El resultado (AST y diagnósticos) es el mismo que el de parse_source_ast()
+ * sobre el texto editado.
+ */
+
+#ifndef REPARSE_H
+#define REPARSE_H
+
+#include <stddef.h>
+#include "arena.h"
+#include "ast.h"
+#include "diag.h"
+#include "parser.h"
+
+/** Bytes de nodos descartados a partir de los cuales se compacta la arena. */
+#define REPARSE_COMPACT_MIN_BYTES (1024 * 1024)
+
+/**
+ * @brief Diagnóstico léxico o sintáctico del documento.
+ */
+typedef struct ReparseDiag {
+    DiagSeverity severity;
+    SourceSpan span;            /**< Posición absoluta */
+    size_t item;                /**< Con los sintácticos, item que lo produjo */
+    char *message;
+} ReparseDiag;
+
+/**
+ * @brief Documento analizado.
+ */
+typedef struct ReparseDocument {
+    char *source;               /**< Texto actual, terminado en '\0' */
+    size_t length;
+    size_t capacity;
+    unsigned lexer_flags;
+    Arena arena;                /**< Nodos del AST */
+    size_t garbage;             /**< Bytes de la arena ocupados por items reemplazados */
+    AstNode program;            /**< Raíz (AST_PROGRAM) */
+    ParseItem *items;           /**< Items en orden (ParseItem.node puede ser NULL) */
+    size_t item_count;
+    size_t item_capacity;
+    LexToken eof;               /**< Posición del fin del archivo */
+    size_t unclosed;            /**< Comentario o cadena sin cierre más temprano (o SIZE_MAX) */
+    ReparseDiag *lexical;       /**< Errores léxicos, por posición */
+    size_t lexical_count;
+    ReparseDiag *syntax;        /**< Errores sintácticos, por item */
+    size_t syntax_count;
+    int out_of_memory;          /**< 1 si una edición no pudo analizarse */
+} ReparseDocument;
+
+/**
+ * @brief Reemplazo de @p removed bytes en @p offset por @p text.
+ */
+typedef struct ReparseEdit {
+    size_t offset;
+    size_t removed;
+    const char *text;
+    size_t length;
+} ReparseEdit;
+
+/**
+ * @brief Trabajo hecho por una edición.
+ */
+typedef struct ReparseReport {
+    size_t parsed;              /**< Items analizados de nuevo */
+    size_t reused;              /**< Items conservados */
+    size_t relexed;             /**< Bytes relexeados */
+    int full;                   /**< 1 si se analizó todo el documento */
+} ReparseReport;
+
+int reparse_open(ReparseDocument *doc, const char *source, size_t length, unsigned lexer_flags);
+int reparse_edit(ReparseDocument *doc, const ReparseEdit *edit, ReparseReport *report);
+int reparse_diagnostics(const ReparseDocument *doc, DiagEngine *diag);
+void reparse_close(ReparseDocument *doc);
+
+#endif // REPARSE_H
@@ -0,0 +1,145 @@
+/**
+ * @file runtime.h
+ * @brief Memoria de ejecución de los String y Array (máquina virtual y JIT).
+ *
+ * Los valores String y Array son referencias de 32 bits (RtRef) que caben
+ * en una ranura como cualquier i32. Los dos bits altos indican dónde vive
+ * el objeto:
+ *
+ * - RT_TAG_STATIC: literal de cadena internado al compilar en el segmento
+ *   de solo lectura del módulo (BcModule.strings); el resto es su
+ *   desplazamiento. La referencia 0 es la cadena vacía (y el arreglo vacío).
+ * - RT_TAG_REGION: objeto que no escapa de la función que lo crea; vive en
+ *   la región del marco, que se asigna avanzando un puntero y se libera
+ *   entera al volver (rt_leave()).
+ * - RT_TAG_POOL: objeto que puede devolverse; se asigna de listas libres
+ *   por clase de tamaño. Pertenece al marco que lo creó y, si la función lo
+ *   devuelve, pasa al marco que la llamó; se libera al volver el último.
+ *
+ * Qué asignaciones escapan lo decide bytecode.c al compilar (BC_REF_POOL);
+ * con BC_HEAP_MALLOC cada objeto se pide a malloc, para comparar.
+ * Los objetos son inmutables: concatenar crea un objeto nuevo.
+ */
+
+#ifndef RUNTIME_H
+#define RUNTIME_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "ast.h"
+#include "bytecode.h"
+
+/** Referencia a un String o Array. */
+typedef uint32_t RtRef;
+
+#define RT_TAG_SHIFT 30
+#define RT_TAG_STATIC 0u
+#define RT_TAG_REGION 1u
+#define RT_TAG_POOL 2u
+/** Índice o desplazamiento máximo de una referencia. */
+#define RT_INDEX_MASK ((1u << RT_TAG_SHIFT) - 1)
+
+/** Clases de tamaño del pool: bloques de 16 << c bytes, hasta 4 KiB. */
+#define RT_SIZE_CLASSES 9
+/** Objetos del pool mayores que la última clase (se asignan con malloc). */
+#define RT_CLASS_LARGE UINT32_MAX
+/** Bytes de cada bloque de región y de cada lámina del pool. */
+#define RT_CHUNK_BYTES (64u << 10)
+
+/**
+ * @brief Encabezado de un objeto; los datos van a continuación.
+ */
+typedef struct RtObject {
+    uint32_t length;            /**< Bytes de un String o elementos de un Array */
+    uint32_t size_class;        /**< Clase del pool, RT_CLASS_LARGE, o en un literal BC_REF_ARRAY o 0 */
+} RtObject;
+
+/**
+ * @brief Contadores de asignación de una ejecución (--heap-stats).
+ */
+typedef struct RtStats {
+    size_t region_objects;      /**< Objetos asignados en regiones de marco */
+    size_t region_bytes;
+    size_t region_peak;         /**< Máximo de bytes vivos en regiones */
+    size_t pool_objects;        /**< Objetos que escapan, asignados del pool */
+    size_t pool_reused;         /**< Servidos desde una lista libre */
+    size_t pool_freed;
+    size_t large_objects;       /**< Mayores que la última clase */
+    size_t malloc_calls;        /**< Reservas al sistema (bloques, láminas, tablas y objetos) */
+} RtStats;
+
+typedef struct RtChunk RtChunk;
+
+/**
+ * @brief Estado de la región y del pool al entrar a un marco.
+ */
+typedef struct RtMark {
+    RtChunk *chunk;
+    size_t used;
+    size_t region_count;
+    size_t region_live;
+    size_t owned_count;
+} RtMark;
+
+/**
+ * @brief Memoria de una ejecución.
+ */
+typedef struct RtHeap {
+    const uint8_t *strings;     /**< Segmento de literales del módulo */
+    int use_malloc;             /**< 1 para asignar cada objeto con malloc (comparación) */
+    RtChunk *chunks;            /**< Bloques de región, en orden de uso */
+    RtChunk *chunk;             /**< Bloque actual, o NULL */
+    size_t used;                /**< Bytes usados del bloque actual */
+    size_t region_live;
+    RtObject **region;          /**< Objetos de región por índice */
+    size_t region_count;
+    size_t region_capacity;
+    void *free_lists[RT_SIZE_CLASSES];
+    RtChunk *slabs;             /**< Láminas del pool; la primera es la actual */
+    size_t slab_used;
+    RtObject **pool;            /**< Objetos del pool por índice */
+    size_t pool_count;
+    size_t pool_capacity;
+    uint32_t *free_handles;     /**< Índices del pool libres */
+    size_t free_handle_count;
+    uint32_t *owned;            /**< Objetos del pool de los marcos activos */
+    size_t owned_count;
+    size_t owned_capacity;
+    RtMark *marks;              /**< Un marco por BC_ENTER pendiente */
+    size_t mark_count;
+    size_t mark_capacity;
+    RtStats stats;
+} RtHeap;
+
+/**
+ * @brief Objeto de una referencia.
+ */
+static inline const RtObject *rt_object(const RtHeap *heap, RtRef ref) {
+    uint32_t index = ref & RT_INDEX_MASK;
+    switch (ref >> RT_TAG_SHIFT) {
+        case RT_TAG_REGION: return heap->region[index];
+        case RT_TAG_POOL: return heap->pool[index];
+        default: return (const RtObject *)(heap->strings + index);
+    }
+}
+
+/**
+ * @brief Datos de un objeto.
+ */
+static inline uint8_t *rt_data(const RtObject *object) {
+    return (uint8_t *)(object + 1);
+}
+
+void rt_heap_init(RtHeap *heap, const uint8_t *strings, int use_malloc);
+void rt_heap_free(RtHeap *heap);
+int rt_enter(RtHeap *heap);
+void rt_leave(RtHeap *heap, RtRef value, int is_reference);
+int rt_alloc(RtHeap *heap, uint32_t length, unsigned flags, RtRef *ref, RtObject **object);
+int rt_concat(RtHeap *heap, RtRef a, RtRef b, unsigned flags, RtRef *result);
+int rt_index(const RtHeap *heap, RtRef ref, int32_t index, unsigned flags, int32_t *value);
+int rt_equal(const RtHeap *heap, RtRef a, RtRef b, unsigned flags);
+void rt_print(const RtHeap *heap, FILE *out, RtRef ref, AstType type);
+void rt_stats_print(const RtStats *stats, FILE *out);
+
+#endif // RUNTIME_H
@@ -0,0 +1,100 @@
+/**
+ * @file sampler.h
+ * @brief Perfil por muestreo de una ejecución (--prof).
+ *
+ * Un temporizador del tiempo de CPU del hilo que ejecuta le envía SIGPROF
+ * cada intervalo y el manejador toma la muestra en el momento: con la
+ * máquina virtual recorre sus marcos desde la instrucción en curso que
+ * publica el intérprete (ver vm.c); con el JIT, la cadena de rbp del
+ * código generado (ver jit.c). Cada muestra es la pila de
+ * posiciones (función, pc del bytecode), de la más interna a main; al
+ * terminar se traducen a nombres de función, con un marco más por cada
+ * expansión en línea que contiene la posición (bc_origin_chain()), y a
+ * líneas del fuente
+ * (BcFunction.lines).
+ *
+ * sampler_report() escribe las pilas en el formato colapsado de
+ * flamegraph.pl (una línea "main;f;g muestras" por pila distinta) y un
+ * resumen de las funciones y las líneas con más muestras.
+ *
+ * Solo puede haber un perfil activo por proceso. Solo está disponible en
+ * Linux; en otras plataformas sampler_start() falla.
+ */
+
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <signal.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "bytecode.h"
+
+/** Intervalo de muestreo por defecto, en microsegundos de CPU. */
+#define SAMPLER_DEFAULT_INTERVAL_US 1000
+/** Intervalo mínimo aceptado. */
+#define SAMPLER_MIN_INTERVAL_US 50
+/** Archivo de las pilas colapsadas por defecto. */
+#define SAMPLER_DEFAULT_OUTPUT "perfil.folded"
+/** Funciones y líneas del resumen por defecto. */
+#define SAMPLER_DEFAULT_TOP 10
+/** Marcos que se guardan de cada muestra (los más internos). */
+#define SAMPLER_MAX_DEPTH 256
+/** Palabras del búfer de muestras (reservado de una vez: el JIT escribe desde el manejador). */
+#define SAMPLER_BUFFER_WORDS ((size_t)1 << 21)
+/** Marco de una función de C llamada desde el código generado (runtime.c, print(), compilación). */
+#define SAMPLER_RUNTIME UINT64_MAX
+
+/**
+ * @brief Opciones de --prof.
+ */
+typedef struct SamplerOptions {
+    uint32_t interval_us;       /**< --prof-interval */
+    const char *output;         /**< --prof-out: archivo de las pilas colapsadas */
+    size_t top;                 /**< --prof-top */
+} SamplerOptions;
+
+typedef struct Sampler Sampler;
+
+/**
+ * @brief Toma una muestra desde el manejador de la señal.
+ *
+ * @param context El ucontext_t interrumpido.
+ */
+typedef void (*SamplerWalk)(Sampler *sampler, void *context);
+
+/**
+ * @brief Muestras de una ejecución.
+ *
+ * words guarda cada muestra como su cantidad de marcos seguida de los
+ * marcos (sampler_frame()), del más interno al más externo.
+ */
+struct Sampler {
+    uint64_t *words;
+    size_t length;
+    size_t samples;             /**< Muestras guardadas */
+    size_t dropped;             /**< Muestras que no cupieron en words o fuera del código del programa */
+    uint32_t interval_us;
+    uint64_t cpu_ns;            /**< Tiempo de CPU entre sampler_start() y sampler_stop() */
+    SamplerWalk walk;           /**< Toma la muestra en el manejador, o NULL entre ejecuciones */
+    void *walk_data;
+};
+
+/**
+ * @brief Marco de una muestra: el byte @p pc del código de la función @p function.
+ */
+static inline uint64_t sampler_frame(uint32_t function, uint32_t pc) {
+    return ((uint64_t)function << 32) | pc;
+}
+
+int sampler_init(Sampler *sampler, uint32_t interval_us);
+int sampler_start(Sampler *sampler);
+void sampler_attach(Sampler *sampler, SamplerWalk walk, void *walk_data);
+void sampler_stop(Sampler *sampler);
+uint64_t *sampler_begin(Sampler *sampler);
+void sampler_commit(Sampler *sampler, uint64_t *frames, size_t count);
+int sampler_report(const Sampler *sampler, const BcModule *module, const char *filename, FILE *folded,
+                   FILE *table, size_t top);
+void sampler_free(Sampler *sampler);
+
+#endif // SAMPLER_H
@@ -0,0 +1,64 @@
+/**
+ * @file sema.h
+ * @brief Análisis semántico del subconjunto ejecutable del lenguaje.
+ *
+ * Resuelve nombres, comprueba tipos y asigna a cada variable local un
+ * índice de ranura (AstNode.slot) para la generación de bytecode. El
+ * backend ejecuta funciones con valores i32 (aritmética con desbordamiento
+ * circular), bool y char, variables locales, control de flujo, match sobre
+ * literales, recursión y la función incorporada print().
+ *
+ * Las cadenas ("texto", de tipo String) y los arreglos de i32 ([1, 2], de
+ * tipo Array) son valores inmutables: + y += concatenan, == y != comparan
+ * el contenido, len(x) da su longitud (bytes de un String) y at(x, i) un
+ * byte (como char) o un elemento. Como la gramática no tiene indexación ni
+ * tipos de arreglo, el tipo se escribe con los nombres String y Array. Los
+ * tipos f64 y el acceso a campos se reconocen en el parser pero se
+ * reportan aquí como no soportados.
+ */
+
+#ifndef SEMA_H
+#define SEMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "ast.h"
+#include "diag.h"
+
+/** Parámetros máximos de una función. */
+#define SEMA_MAX_PARAMS 32
+
+/** Índices de llamada (AstNode.slot de AST_CALL) de las funciones incorporadas. */
+#define SEMA_BUILTIN_PRINT (-1)
+#define SEMA_BUILTIN_LEN (-2)
+#define SEMA_BUILTIN_AT (-3)
+
+/** Elementos máximos de un literal de arreglo (operando u16 de BC_ARRAY). */
+#define SEMA_MAX_ARRAY_LITERAL 65535
+
+/**
+ * @brief Función del programa ya analizada.
+ */
+typedef struct SemaFunction {
+    const AstNode *decl;        /**< Nodo AST_FUNCTION */
+    size_t param_count;         /**< Parámetros (ranuras 0 .. param_count - 1) */
+    AstType params[SEMA_MAX_PARAMS]; /**< Tipo de cada parámetro */
+    AstType result;             /**< Tipo de retorno (AST_TYPE_UNIT si no tiene) */
+    size_t slot_count;          /**< Ranuras locales, incluidos los parámetros */
+} SemaFunction;
+
+/**
+ * @brief Programa analizado: sus funciones en orden de aparición.
+ */
+typedef struct SemaProgram {
+    const char *source;         /**< Fuente del que se construyó el AST */
+    SemaFunction *functions;    /**< Funciones (liberar con sema_free()) */
+    size_t function_count;
+    size_t main_index;          /**< Índice de main en functions */
+} SemaProgram;
+
+int sema_analyze(AstNode *program, const char *source, DiagEngine *diag, SemaProgram *result);
+void sema_free(SemaProgram *program);
+size_t sema_unescape(const char *text, size_t length, uint8_t *out);
+
+#endif // SEMA_H
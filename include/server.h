@@ -0,0 +1,19 @@
+/**
+ * @file server.h
+ * @brief Servidor de compilación persistente sobre un socket Unix y su cliente.
+ *
+ * El servidor mantiene residentes la caché de compilación y un conjunto de
+ * arenas ya reservadas, y atiende cada petición en su propio hilo. El cliente
+ * reenvía sus argumentos y su directorio de trabajo, y reproduce la salida,
+ * los errores y el código de salida que devuelve el servidor.
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "cli.h"
+
+int server_run(const CliOptions *options);
+int client_run(const char *socket_path, int argc, char *argv[]);
+
+#endif // SERVER_H
@@ -0,0 +1,117 @@
+/**
+ * @file stats.h
+ * @brief Instrumentación por fases del compilador (--stats).
+ *
+ * Cada hilo registra sus contadores en la estructura apuntada por
+ * stats_current; si es NULL (caso normal) cada punto de medición se reduce a
+ * una comprobación de un puntero local al hilo. Compilando con
+ * -DCOMPILADOR_NO_STATS los puntos de medición desaparecen por completo.
+ */
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "lexer.h"
+
+/**
+ * @brief Fases del compilador con temporizador propio.
+ */
+typedef enum StatsPhase {
+    STATS_READ,      /**< Lectura del fuente */
+    STATS_LEX,       /**< Análisis léxico */
+    STATS_WRITE,     /**< Escritura de la salida (tabla o archivo de tokens) */
+    STATS_PARSE,     /**< Análisis sintáctico */
+    STATS_SEMANTIC,  /**< Análisis semántico */
+    STATS_CODEGEN,   /**< Generación de código */
+    STATS_PHASE_COUNT
+} StatsPhase;
+
+/** Número de tipos de token distintos. */
+#define STATS_TOKEN_TYPES (TOKEN_EOF + 1)
+
+/** Máximo de clases de carácter del histograma de LEXER_DEBUG. */
+#define STATS_CHAR_CLASSES 32
+
+/**
+ * @brief Contadores de una ejecución (o de un hilo, antes de combinarse).
+ */
+typedef struct CompilerStats {
+    uint64_t phase_ns[STATS_PHASE_COUNT];      /**< Tiempo acumulado por fase */
+    size_t phase_calls[STATS_PHASE_COUNT];     /**< Veces que se midió cada fase */
+    size_t files;                              /**< Archivos leídos */
+    size_t bytes_read;                         /**< Bytes de fuente leídos */
+    size_t tokens[STATS_TOKEN_TYPES];          /**< Tokens por TokenType */
+    size_t skipped_bytes;                      /**< Bytes omitidos (espacios y comentarios) */
+    size_t comment_bytes;                      /**< De ellos, bytes de comentarios */
+    size_t malloc_count;                       /**< Reservas con malloc */
+    size_t malloc_bytes;                       /**< Bytes reservados con malloc */
+    size_t arena_peak;                         /**< Pico de uso de arena */
+    size_t char_classes[STATS_CHAR_CLASSES];   /**< Caracteres por clase (solo LEXER_DEBUG) */
+} CompilerStats;
+
+extern _Thread_local CompilerStats *stats_current;
+
+uint64_t stats_now_ns(void);
+
+/**
+ * @brief Devuelve el reloj monótono en nanosegundos, o 0 si no se mide.
+ */
+static inline uint64_t stats_clock(void) {
+#ifndef COMPILADOR_NO_STATS
+    if (stats_current != NULL) {
+        return stats_now_ns();
+    }
+#endif
+    return 0;
+}
+
+/**
+ * @brief Suma a una fase el tiempo transcurrido entre dos stats_clock().
+ */
+static inline void stats_phase_add(StatsPhase phase, uint64_t elapsed_ns) {
+#ifndef COMPILADOR_NO_STATS
+    if (stats_current != NULL) {
+        stats_current->phase_ns[phase] += elapsed_ns;
+        stats_current->phase_calls[phase]++;
+    }
+#else
+    (void)phase;
+    (void)elapsed_ns;
+#endif
+}
+
+/**
+ * @brief Registra el uso máximo de una arena.
+ */
+static inline void stats_note_arena_peak(size_t peak) {
+#ifndef COMPILADOR_NO_STATS
+    if (stats_current != NULL && peak > stats_current->arena_peak) {
+        stats_current->arena_peak = peak;
+    }
+#else
+    (void)peak;
+#endif
+}
+
+#ifndef COMPILADOR_NO_STATS
+/** Suma @p n a un campo de las estadísticas del hilo, si se están midiendo. */
+#define STATS_ADD(field, n) \
+    do { if (stats_current != NULL) { stats_current->field += (n); } } while (0)
+/** Registra una reserva de @p size bytes hecha con malloc. */
+#define STATS_ALLOC(size) \
+    do { if (stats_current != NULL) { stats_current->malloc_count++; \
+                                      stats_current->malloc_bytes += (size); } } while (0)
+#else
+#define STATS_ADD(field, n) ((void)(n))
+#define STATS_ALLOC(size) ((void)(size))
+#endif
+
+CompilerStats *stats_begin(CompilerStats *stats);
+void stats_merge(CompilerStats *into, const CompilerStats *from);
+void stats_print(const CompilerStats *stats, double wall_ms, FILE *out);
+void stats_print_json(const CompilerStats *stats, double wall_ms, FILE *out);
+
+#endif // STATS_H
@@ -0,0 +1,70 @@
+/**
+ * @file token_stream.h
+ * @brief Flujo de tokens con anticipación acotada entre el lexer y el parser.
+ *
+ * El lexer llena un búfer circular de LexToken por lotes de
+ * TOKEN_STREAM_BATCH y el consumidor los pide con token_stream_peek() y
+ * token_stream_advance(). La memoria es fija sin importar el tamaño del
+ * archivo. Con LEXER_THREADED el lexer corre en su propio hilo y el búfer
+ * funciona como una cola de un productor y un consumidor sin bloqueos: los
+ * índices se publican con operaciones atómicas una vez por lote, y el
+ * cerrojo solo se toma para dormir cuando el búfer está lleno o vacío.
+ */
+
+#ifndef TOKEN_STREAM_H
+#define TOKEN_STREAM_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "diag.h"
+#include "lexer.h"
+#include "stats.h"
+
+/** Tokens que el lexer produce de una vez. */
+#define TOKEN_STREAM_BATCH 256
+
+/** Capacidad del búfer circular (potencia de dos). */
+#define TOKEN_STREAM_CAPACITY 1024
+
+/** Anticipación máxima admitida por token_stream_peek(). */
+#define TOKEN_STREAM_MAX_PEEK (TOKEN_STREAM_CAPACITY - TOKEN_STREAM_BATCH)
+
+/** Tamaño mínimo del fuente para que LEXER_THREADED use un hilo. */
+#define TOKEN_STREAM_THREAD_MIN_BYTES (256 * 1024)
+
+/**
+ * @brief Flujo de tokens sobre un lexer.
+ */
+typedef struct TokenStream {
+    Lexer *lexer;                       /**< Productor de los tokens */
+    LexToken ring[TOKEN_STREAM_CAPACITY]; /**< Búfer circular */
+    size_t head;                        /**< Índice absoluto del token actual */
+    size_t tail;                        /**< Tokens producidos visibles para el consumidor */
+    int done;                           /**< 1 cuando ya se produjo EOF */
+    uint64_t stall_ns;                  /**< Tiempo del consumidor esperando tokens (--stats) */
+    int threaded;                       /**< 1 si el lexer corre en su propio hilo */
+    size_t diag_first;                  /**< Primer diagnóstico registrado durante el flujo */
+    /* Solo en modo con hilo */
+    pthread_t thread;                   /**< Hilo del lexer */
+    pthread_mutex_t lock;               /**< Protege las esperas */
+    pthread_cond_t wake;                /**< Señala un lote nuevo o espacio libre */
+    atomic_size_t shared_head;          /**< head publicado por el consumidor */
+    atomic_size_t shared_tail;          /**< tail publicado por el productor */
+    atomic_int shared_done;             /**< done publicado por el productor */
+    atomic_int stop;                    /**< Pide al productor que termine */
+    atomic_int producer_waiting;        /**< 1 mientras el productor duerme */
+    atomic_int consumer_waiting;        /**< 1 mientras el consumidor duerme */
+    DiagEngine *diag_target;            /**< Motor del lexer, que recibe lexer_diag al final */
+    DiagEngine lexer_diag;              /**< Diagnósticos del hilo del lexer */
+    CompilerStats *stats_target;        /**< Estadísticas del consumidor, o NULL */
+    CompilerStats lexer_stats;          /**< Estadísticas del hilo del lexer */
+} TokenStream;
+
+int token_stream_init(TokenStream *ts, Lexer *lexer);
+const LexToken *token_stream_peek(TokenStream *ts, size_t k);
+void token_stream_advance(TokenStream *ts);
+void token_stream_destroy(TokenStream *ts);
+
+#endif // TOKEN_STREAM_H
@@ -0,0 +1,20 @@
+/**
+ * @file utf8.h
+ * @brief Validación de UTF-8 y búsqueda rápida sobre tramos ASCII.
+ *
+ * El lexer solo necesita decodificar dentro de cadenas, caracteres y
+ * comentarios; el resto del lenguaje es ASCII. utf8_ascii_run() salta por
+ * bloques (SSE2 o SWAR) los bytes ASCII sin interés, de modo que solo los
+ * bytes >= 0x80 pasan por el validador escalar.
+ */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+size_t utf8_sequence_length(const char *p, uint32_t *codepoint);
+size_t utf8_ascii_run(const char *p, size_t length, char stop1, char stop2, char stop3);
+
+#endif // UTF8_H
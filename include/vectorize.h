@@ -0,0 +1,35 @@
+/**
+ * @file vectorize.h
+ * @brief Reconocimiento y ejecución de núcleos vectoriales (BcKernel).
+ *
+ * Un ciclo for sobre un rango se vectoriza si cada sentencia de su cuerpo
+ * es una reducción sobre una variable i32 distinta:
+ *
+ * - acc += e, acc -= e, acc *= e, o acc = e con acc una sola vez en e,
+ *   como término de una suma (acc + x - y) o factor de un producto;
+ * - if e < acc { acc = e; } (mínimo) o if e > acc { acc = e; } (máximo),
+ *   con <=, >= o los operandos invertidos;
+ *
+ * donde e solo usa la variable del ciclo, literales, variables que el
+ * cuerpo no asigna y los operadores +, - y * (sin división, que puede
+ * fallar, ni llamadas, que pueden tener efectos). El JIT traduce los
+ * núcleos a SSE2 o AVX2 (jit.c); la máquina virtual los ejecuta aquí por
+ * bloques de VEC_BLOCK iteraciones, en ciclos que el compilador de C
+ * vectoriza.
+ */
+
+#ifndef VECTORIZE_H
+#define VECTORIZE_H
+
+#include <stdint.h>
+#include "ast.h"
+#include "bytecode.h"
+
+/** Iteraciones por bloque en la máquina virtual. */
+#define VEC_BLOCK 64
+
+int vec_match_for(const AstNode *loop, BcKernel *kernel);
+void vec_execute(const BcKernel *kernel, int32_t *locals);
+int32_t vec_identity(BcReduce kind);
+
+#endif // VECTORIZE_H
@@ -0,0 +1,88 @@
+/**
+ * @file vm.h
+ * @brief Intérprete del bytecode y resultado común de una ejecución.
+ *
+ * vm_run() y jit_run() (jit.h) ejecutan el mismo BcModule con la misma
+ * semántica y reportan el mismo RunResult: la salida de print(), el valor
+ * devuelto por main, el primer error de ejecución y los contadores de
+ * asignación de String y Array deben coincidir.
+ *
+ * vm_run() no ejecuta el BcModule tal cual: la primera vez que se llama a
+ * cada función copia su código y reescribe las secuencias de instrucciones
+ * más frecuentes como superinstrucciones, que las ejecutan con un solo
+ * despacho, y algunas instrucciones genéricas se reescriben como variantes
+ * especializadas tras su primera ejecución. vm_execute() con un VmProfile
+ * cuenta, sobre el código sin reescribir, los pares y tríos de instrucciones
+ * consecutivas de los que se eligen las superinstrucciones (--vm-profile).
+ * vm_execute_sampled() toma las muestras de --prof (ver sampler.h).
+ */
+
+#ifndef VM_H
+#define VM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "ast.h"
+#include "bytecode.h"
+#include "runtime.h"
+#include "sampler.h"
+
+/** Llamadas anidadas máximas, contando main. */
+#define RUN_MAX_DEPTH 10000
+
+/** Opciones de vm_execute(). */
+#define VM_NO_SUPERINSTRUCTIONS 0x1u /**< Ejecutar el bytecode sin superinstrucciones ni especialización */
+#define VM_COUNT_DISPATCHES     0x2u /**< Contar las instrucciones despachadas (más lento) */
+
+/** Pares y tríos más frecuentes que reporta vm_profile_print(). */
+#define VM_PROFILE_TOP 12
+
+/**
+ * @brief Estado final de una ejecución.
+ */
+typedef enum RunStatus {
+    RUN_OK,
+    RUN_DIVISION_BY_ZERO,
+    RUN_STACK_OVERFLOW,
+    RUN_OUT_OF_MEMORY,
+    RUN_UNSUPPORTED,        /**< El JIT no está disponible en esta plataforma */
+    RUN_INDEX_OUT_OF_RANGE  /**< at(x, i) con i fuera de 0 .. len(x) - 1 */
+} RunStatus;
+
+/**
+ * @brief Resultado de ejecutar un programa.
+ */
+typedef struct RunResult {
+    RunStatus status;
+    int32_t value;          /**< Valor devuelto por main (si status es RUN_OK) */
+    size_t function;        /**< Función en la que ocurrió el error */
+    RtStats heap;           /**< Asignaciones de String y Array */
+    uint64_t dispatches;    /**< Con VM_COUNT_DISPATCHES, instrucciones despachadas por la VM */
+} RunResult;
+
+/**
+ * @brief Frecuencias de instrucciones de una o varias ejecuciones con vm_execute().
+ *
+ * Un par (o trío) cuenta cada vez que una instrucción se ejecuta justo
+ * después de la anterior en el código, sin un salto, llamada o retorno
+ * entre ellas: las secuencias que pueden fusionarse en una superinstrucción.
+ */
+typedef struct VmProfile {
+    uint64_t dispatches;            /**< Instrucciones ejecutadas */
+    uint64_t ops[BC_OP_COUNT];      /**< Ejecuciones por instrucción */
+    uint64_t *pairs;                /**< [a][b]: b tras a (BC_OP_COUNT^2) */
+    uint64_t *triples;              /**< [a][b][c]: c tras b tras a (BC_OP_COUNT^3) */
+} VmProfile;
+
+const char *run_status_message(RunStatus status);
+void run_print_value(FILE *out, const RtHeap *heap, int32_t value, AstType type);
+int vm_run(const BcModule *module, FILE *out, RunResult *result);
+int vm_execute(const BcModule *module, unsigned flags, VmProfile *profile, FILE *out, RunResult *result);
+int vm_execute_sampled(const BcModule *module, unsigned flags, Sampler *sampler, FILE *out,
+                       RunResult *result);
+int vm_profile_init(VmProfile *profile);
+void vm_profile_print(const VmProfile *profile, FILE *out);
+void vm_profile_free(VmProfile *profile);
+
+#endif // VM_H
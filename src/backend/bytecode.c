@@ -0,0 +1,2009 @@
+/**
+ * @file bytecode.c
+ * @brief Generación de bytecode a partir del AST analizado.
+ *
+ * Cada expresión deja exactamente un valor en la pila y cada sentencia la
+ * deja como la encontró, así la profundidad en cada punto se conoce al
+ * generar y max_stack es exacta. Los saltos pendientes de break y continue
+ * se encadenan a través de sus propios operandos (cada uno guarda la
+ * posición del anterior) y se resuelven al conocer el destino.
+ *
+ * Los literales de cadena y los arreglos de constantes se internan en un
+ * segmento de solo lectura del módulo y se cargan con literal. Para el resto
+ * de los String y Array, un análisis de escape por función decide en qué
+ * asignaciones el objeto puede sobrevivir al marco (porque se devuelve,
+ * directamente o a través de variables y de llamadas que devuelven
+ * referencias): esas van al pool (BC_REF_POOL) y las demás a la región del
+ * marco. Las funciones que crean objetos o reciben los que devuelve una
+ * llamada abren y cierran su marco con enter y leave.
+ *
+ * bc_function_save() guarda el bytecode de una función de forma que otro
+ * programa que la contenga sin cambios pueda reutilizarlo con
+ * bc_compile_reusing() en lugar de traducirla (compilación incremental):
+ * como las instrucciones call y literal llevan índices del módulo, se
+ * guardan aparte el nombre del llamado y el contenido del literal.
+ *
+ * bc_compile_parallel() reparte las funciones entre hilos y une el
+ * resultado en el orden del programa, así que el módulo no depende del
+ * número de hilos.
+ */
+#define _GNU_SOURCE
+
+#include "../../include/bytecode.h"
+#include "../../include/arena.h"
+#include "../../include/hash.h"
+#include "../../include/runtime.h"
+#include "../../include/stats.h"
+#include "../../include/vectorize.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/** Fin de una cadena de saltos pendientes. */
+#define BC_NO_PATCH UINT32_MAX
+
+/** Bytes de operando por instrucción. */
+static const uint8_t OPERAND_SIZES[BC_OP_COUNT] = {
+#define BC_SIZE(op, operand, name) operand,
+    BC_OPS(BC_SIZE)
+#undef BC_SIZE
+};
+
+/** Nombres para el desensamblado. */
+static const char *const OP_NAMES[BC_OP_COUNT] = {
+#define BC_NAME(op, operand, name) name,
+    BC_OPS(BC_NAME)
+#undef BC_NAME
+};
+
+/**
+ * @brief Devuelve los bytes de operando de una instrucción.
+ */
+size_t bc_operand_size(BcOp op) {
+    return (unsigned)op < BC_OP_COUNT ? OPERAND_SIZES[op] : 0;
+}
+
+/**
+ * @brief Devuelve el nombre de una instrucción.
+ */
+const char *bc_op_name(BcOp op) {
+    return (unsigned)op < BC_OP_COUNT ? OP_NAMES[op] : "?";
+}
+
+/**
+ * @brief Saltos pendientes del ciclo más interno.
+ */
+typedef struct BcLoop {
+    struct BcLoop *outer;
+    uint32_t breaks;        /**< Cadena de operandos de break */
+    uint32_t continues;     /**< Cadena de operandos de continue */
+} BcLoop;
+
+/**
+ * @brief Segmento de literales en construcción, con su tabla de internado.
+ */
+typedef struct BcStrings {
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+    uint32_t *table;        /**< Desplazamiento + 1 por hash (0 = libre) */
+    size_t mask;
+    size_t count;
+} BcStrings;
+
+/**
+ * @brief Estado de la generación de una función.
+ */
+typedef struct BcBuilder {
+    const SemaProgram *program;
+    const AstNode *decl;    /**< Función en traducción (base de las posiciones, ver ast.h) */
+    BcFunction *function;
+    BcStrings *strings;
+    size_t capacity;
+    size_t call_capacity;
+    size_t line_capacity;
+    size_t kernel_capacity;
+    unsigned flags;         /**< Opciones de bc_compile() */
+    uint32_t depth;         /**< Valores en la pila en el punto actual */
+    BcLoop *loop;
+    const uint8_t *escaping; /**< 1 por ranura cuyo valor puede escapar del marco */
+    int escape;             /**< El valor que se genera puede escapar del marco */
+    int heap;               /**< La función abre un marco con enter */
+    int returns_reference;
+    int out_of_memory;
+    int too_many_literals;
+} BcBuilder;
+
+/**
+ * @brief Añade bytes al código de la función.
+ */
+static void emit_bytes(BcBuilder *b, const uint8_t *bytes, size_t count) {
+    BcFunction *f = b->function;
+    if (f->length + count > b->capacity) {
+        size_t grown = b->capacity > 0 ? b->capacity * 2 : 256;
+        uint8_t *larger = (uint8_t *)realloc(f->code, grown);
+        if (larger == NULL) {
+            b->out_of_memory = 1;
+            return;
+        }
+        f->code = larger;
+        b->capacity = grown;
+    }
+    memcpy(f->code + f->length, bytes, count);
+    f->length += count;
+}
+
+/**
+ * @brief Registra la posición en el fuente de la llamada que se va a emitir.
+ */
+static void add_call_site(BcBuilder *b, const AstNode *callee) {
+    BcFunction *f = b->function;
+    if (f->call_count == b->call_capacity) {
+        size_t grown = b->call_capacity > 0 ? b->call_capacity * 2 : 8;
+        BcCallSite *larger = (BcCallSite *)realloc(f->calls, grown * sizeof(BcCallSite));
+        if (larger == NULL) {
+            b->out_of_memory = 1;
+            return;
+        }
+        f->calls = larger;
+        b->call_capacity = grown;
+    }
+    BcCallSite *site = &f->calls[f->call_count++];
+    site->pc = (uint32_t)f->length;
+    site->line = ast_line(b->decl, callee);
+    site->column = (uint32_t)callee->column;
+}
+
+/**
+ * @brief Atribuye a @p line el código que se emita desde aquí.
+ *
+ * Dos tramos seguidos de la misma línea se fusionan, y uno vacío toma la
+ * línea nueva.
+ */
+static void add_line(BcBuilder *b, uint32_t line) {
+    BcFunction *f = b->function;
+    if (f->line_count > 0) {
+        BcLine *last = &f->lines[f->line_count - 1];
+        if (last->line == line) {
+            return;
+        }
+        if (last->pc == f->length) {
+            last->line = line;
+            if (f->line_count > 1 && f->lines[f->line_count - 2].line == line) {
+                f->line_count--;
+            }
+            return;
+        }
+    }
+    if (f->line_count == b->line_capacity) {
+        size_t grown = b->line_capacity > 0 ? b->line_capacity * 2 : 16;
+        BcLine *larger = (BcLine *)realloc(f->lines, grown * sizeof(BcLine));
+        if (larger == NULL) {
+            b->out_of_memory = 1;
+            return;
+        }
+        f->lines = larger;
+        b->line_capacity = grown;
+    }
+    f->lines[f->line_count].pc = (uint32_t)f->length;
+    f->lines[f->line_count].line = line;
+    f->line_count++;
+}
+
+/**
+ * @brief Ajusta la profundidad de la pila tras una instrucción.
+ */
+static void adjust_depth(BcBuilder *b, int delta) {
+    b->depth = (uint32_t)((int)b->depth + delta);
+    if (b->depth > b->function->max_stack) {
+        b->function->max_stack = b->depth;
+    }
+}
+
+/**
+ * @brief Efecto sobre la pila de las instrucciones de tamaño fijo.
+ */
+static int stack_effect(BcOp op) {
+    switch (op) {
+        case BC_CONST:
+        case BC_LITERAL:
+        case BC_LOAD:
+            return 1;
+        case BC_NEG:
+        case BC_NOT:
+        case BC_JUMP:
+        case BC_CALL:
+        case BC_VECTOR:
+        case BC_ENTER:
+        case BC_LEAVE:
+        case BC_ARRAY:
+        case BC_LENGTH:
+            return 0;
+        default:
+            return -1;
+    }
+}
+
+static void emit(BcBuilder *b, BcOp op) {
+    uint8_t byte = (uint8_t)op;
+    emit_bytes(b, &byte, 1);
+    adjust_depth(b, stack_effect(op));
+}
+
+static void emit_u8(BcBuilder *b, BcOp op, uint8_t operand) {
+    uint8_t bytes[2] = { (uint8_t)op, operand };
+    emit_bytes(b, bytes, sizeof(bytes));
+    adjust_depth(b, stack_effect(op));
+}
+
+static void emit_u16(BcBuilder *b, BcOp op, uint32_t operand) {
+    uint8_t bytes[3] = { (uint8_t)op, (uint8_t)operand, (uint8_t)(operand >> 8) };
+    emit_bytes(b, bytes, sizeof(bytes));
+    adjust_depth(b, stack_effect(op));
+}
+
+/**
+ * @brief Emite una instrucción con operando de 32 bits.
+ *
+ * @return Posición del operando (para completar saltos).
+ */
+static uint32_t emit_u32(BcBuilder *b, BcOp op, uint32_t operand) {
+    uint8_t bytes[5] = { (uint8_t)op, (uint8_t)operand, (uint8_t)(operand >> 8),
+                         (uint8_t)(operand >> 16), (uint8_t)(operand >> 24) };
+    emit_bytes(b, bytes, sizeof(bytes));
+    adjust_depth(b, stack_effect(op));
+    return (uint32_t)b->function->length - 4;
+}
+
+/**
+ * @brief Posición actual, destino de saltos.
+ */
+static uint32_t here(const BcBuilder *b) {
+    return (uint32_t)b->function->length;
+}
+
+static void write_u32(BcBuilder *b, uint32_t at, uint32_t value) {
+    if (b->out_of_memory) {
+        return;
+    }
+    uint8_t *p = b->function->code + at;
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+/**
+ * @brief Resuelve una cadena de saltos pendientes hacia @p target.
+ */
+static void patch_chain(BcBuilder *b, uint32_t chain, uint32_t target) {
+    while (chain != BC_NO_PATCH && !b->out_of_memory) {
+        uint32_t next = bc_read_u32(b->function->code + chain);
+        write_u32(b, chain, target);
+        chain = next;
+    }
+}
+
+/* ---- Segmento de literales ---- */
+
+/**
+ * @brief Añade bytes al segmento, alineados a 8.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int strings_append(BcStrings *strings, const void *bytes, size_t count) {
+    size_t padded = (count + 7) & ~(size_t)7;
+    if (strings->length + padded > strings->capacity) {
+        size_t grown = strings->capacity > 0 ? strings->capacity * 2 : 256;
+        while (grown < strings->length + padded) {
+            grown *= 2;
+        }
+        uint8_t *larger = (uint8_t *)realloc(strings->data, grown);
+        if (larger == NULL) {
+            return 1;
+        }
+        strings->data = larger;
+        strings->capacity = grown;
+    }
+    if (count > 0) {
+        memcpy(strings->data + strings->length, bytes, count);
+    }
+    memset(strings->data + strings->length + count, 0, padded - count);
+    strings->length += padded;
+    return 0;
+}
+
+/**
+ * @brief Duplica la tabla de internado.
+ */
+static int strings_grow_table(BcStrings *strings) {
+    size_t size = strings->mask > 0 ? 2 * (strings->mask + 1) : 64;
+    uint32_t *table = (uint32_t *)calloc(size, sizeof(uint32_t));
+    if (table == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; strings->table != NULL && i <= strings->mask; i++) {
+        if (strings->table[i] == 0) {
+            continue;
+        }
+        const RtObject *object = (const RtObject *)(strings->data + strings->table[i] - 1);
+        size_t bytes = (size_t)object->length * (object->size_class & BC_REF_ARRAY ? 4 : 1);
+        size_t j = hash64(rt_data(object), bytes, object->length) & (size - 1);
+        while (table[j] != 0) {
+            j = (j + 1) & (size - 1);
+        }
+        table[j] = strings->table[i];
+    }
+    free(strings->table);
+    strings->table = table;
+    strings->mask = size - 1;
+    return 0;
+}
+
+/**
+ * @brief Interna un String (o un Array si @p kind es BC_REF_ARRAY) en el segmento.
+ *
+ * @param bytes Datos del objeto.
+ * @param length Bytes de un String o elementos de un Array.
+ * @return Su referencia (el desplazamiento), o UINT32_MAX si falta memoria
+ *         o el segmento excede RT_INDEX_MASK.
+ */
+static uint32_t strings_intern(BcStrings *strings, const void *bytes, uint32_t length, uint8_t kind) {
+    if (2 * (strings->count + 1) > strings->mask && strings_grow_table(strings) != 0) {
+        return UINT32_MAX;
+    }
+    size_t size = (size_t)length * (kind & BC_REF_ARRAY ? 4 : 1);
+    size_t i = hash64(bytes, size, length) & strings->mask;
+    for (; strings->table[i] != 0; i = (i + 1) & strings->mask) {
+        const RtObject *object = (const RtObject *)(strings->data + strings->table[i] - 1);
+        if (object->size_class == kind && object->length == length && memcmp(rt_data(object), bytes, size) == 0) {
+            return strings->table[i] - 1;
+        }
+    }
+    size_t offset = strings->length;
+    RtObject header = { length, kind };
+    if (offset + sizeof(header) + size > RT_INDEX_MASK
+            || strings_append(strings, &header, sizeof(header)) != 0
+            || strings_append(strings, bytes, size) != 0) {
+        return UINT32_MAX;
+    }
+    strings->table[i] = (uint32_t)offset + 1;
+    strings->count++;
+    return (uint32_t)offset;
+}
+
+/* ---- Análisis de escape ---- */
+
+/**
+ * @brief Estado del análisis de escape de una función.
+ */
+typedef struct BcEscape {
+    const SemaProgram *program;
+    uint8_t *escaping;      /**< 1 por ranura cuyo valor puede escapar */
+    int returns_reference;
+    int changed;            /**< Se marcó una ranura en la pasada actual */
+    int heap;               /**< La función crea objetos o recibe los de una llamada */
+} BcEscape;
+
+/**
+ * @brief Indica si la llamada devuelve una referencia (que pudo crear el llamado).
+ */
+static int returns_reference(const SemaProgram *program, const AstNode *call) {
+    return call->slot >= 0 && ast_type_is_reference(program->functions[call->slot].result);
+}
+
+/**
+ * @brief Indica si evaluar @p e crea objetos o recibe los de una llamada.
+ */
+static int allocates(const SemaProgram *program, const AstNode *e) {
+    switch (e->kind) {
+        case AST_ARRAY:
+            return 1;
+        case AST_UNARY:
+            return allocates(program, e->a);
+        case AST_BINARY:
+            return (e->op == TOKEN_PLUS && ast_type_is_reference(e->type))
+                || allocates(program, e->a) || allocates(program, e->b);
+        case AST_ASSIGN:
+            return (e->op == TOKEN_PLUS_EQUAL && ast_type_is_reference(e->a->type))
+                || allocates(program, e->b);
+        case AST_CALL:
+            if (returns_reference(program, e)) {
+                return 1;
+            }
+            for (const AstNode *arg = e->b; arg != NULL; arg = arg->next) {
+                if (allocates(program, arg)) {
+                    return 1;
+                }
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static void escape_slot(BcEscape *x, int32_t slot) {
+    if (slot >= 0 && !x->escaping[slot]) {
+        x->escaping[slot] = 1;
+        x->changed = 1;
+    }
+}
+
+/**
+ * @brief Marca las variables que pueden llegar al valor de @p e, que escapa.
+ *
+ * Una llamada que devuelve una referencia puede devolver uno de sus argumentos.
+ */
+static void escape_value(BcEscape *x, const AstNode *e) {
+    if (!ast_type_is_reference(e->type)) {
+        return;
+    }
+    if (e->kind == AST_NAME) {
+        escape_slot(x, e->slot);
+    } else if (e->kind == AST_CALL && returns_reference(x->program, e)) {
+        for (const AstNode *arg = e->b; arg != NULL; arg = arg->next) {
+            escape_value(x, arg);
+        }
+    }
+}
+
+static void escape_block(BcEscape *x, const AstNode *block);
+
+static void escape_expression_statement(BcEscape *x, const AstNode *e) {
+    if (e->kind == AST_BLOCK) {
+        escape_block(x, e);
+        return;
+    }
+    x->heap |= allocates(x->program, e);
+    if (e->kind == AST_ASSIGN && e->op == TOKEN_EQUAL && e->a->slot >= 0 && x->escaping[e->a->slot]) {
+        escape_value(x, e->b);
+    }
+}
+
+static void escape_statement(BcEscape *x, const AstNode *statement) {
+    switch (statement->kind) {
+        case AST_LET:
+            if (statement->b != NULL) {
+                x->heap |= allocates(x->program, statement->b);
+                if (statement->slot >= 0 && x->escaping[statement->slot]) {
+                    escape_value(x, statement->b);
+                }
+            }
+            break;
+        case AST_IF:
+            x->heap |= allocates(x->program, statement->a);
+            escape_block(x, statement->b);
+            if (statement->c != NULL) {
+                escape_statement(x, statement->c);
+            }
+            break;
+        case AST_WHILE:
+            x->heap |= allocates(x->program, statement->a);
+            escape_block(x, statement->b);
+            break;
+        case AST_FOR:
+            x->heap |= allocates(x->program, statement->a->a) | allocates(x->program, statement->a->b);
+            escape_block(x, statement->b);
+            break;
+        case AST_LOOP:
+        case AST_BLOCK:
+            escape_block(x, statement->kind == AST_LOOP ? statement->b : statement);
+            break;
+        case AST_MATCH:
+            x->heap |= allocates(x->program, statement->a);
+            for (const AstNode *arm = statement->b; arm != NULL; arm = arm->next) {
+                /* Cada nombre del patrón recibe el valor guardado en la ranura oculta */
+                if (arm->a->kind == AST_NAME && arm->a->slot >= 0 && x->escaping[arm->a->slot]) {
+                    escape_slot(x, statement->slot);
+                }
+                escape_expression_statement(x, arm->b);
+            }
+            if (x->escaping[statement->slot]) {
+                escape_value(x, statement->a);
+            }
+            break;
+        case AST_RETURN:
+            if (statement->a != NULL) {
+                x->heap |= allocates(x->program, statement->a);
+                if (x->returns_reference) {
+                    escape_value(x, statement->a);
+                }
+            }
+            break;
+        case AST_EXPR_STMT:
+            escape_expression_statement(x, statement->a);
+            break;
+        default:
+            break;
+    }
+}
+
+static void escape_block(BcEscape *x, const AstNode *block) {
+    for (const AstNode *statement = block->a; statement != NULL; statement = statement->next) {
+        escape_statement(x, statement);
+    }
+}
+
+/**
+ * @brief Calcula las ranuras que pueden escapar, hasta un punto fijo.
+ *
+ * @return 1 si la función necesita enter y leave.
+ */
+static int escape_analyze(const SemaProgram *program, const SemaFunction *function, uint8_t *escaping) {
+    BcEscape x = { program, escaping, ast_type_is_reference(function->result), 1, 0 };
+    while (x.changed) {
+        x.changed = 0;
+        escape_block(&x, function->decl->c);
+    }
+    return x.heap;
+}
+
+/* ---- Expresiones ---- */
+
+static void emit_expression(BcBuilder *b, const AstNode *e);
+static void emit_statement(BcBuilder *b, const AstNode *statement);
+static void emit_block(BcBuilder *b, const AstNode *block);
+
+/**
+ * @brief Instrucción de un operador binario no lógico.
+ */
+static BcOp binary_op(TokenType op) {
+    switch (op) {
+        case TOKEN_PLUS: case TOKEN_PLUS_EQUAL: return BC_ADD;
+        case TOKEN_MINUS: case TOKEN_MINUS_EQUAL: return BC_SUB;
+        case TOKEN_STAR: case TOKEN_STAR_EQUAL: return BC_MUL;
+        case TOKEN_SLASH: case TOKEN_SLASH_EQUAL: return BC_DIV;
+        case TOKEN_PERCENT: case TOKEN_PERCENT_EQUAL: return BC_MOD;
+        case TOKEN_EQUAL_EQUAL: return BC_EQ;
+        case TOKEN_BANG_EQUAL: return BC_NE;
+        case TOKEN_LESS: return BC_LT;
+        case TOKEN_LESS_EQUAL: return BC_LE;
+        case TOKEN_GREATER: return BC_GT;
+        default: return BC_GE;
+    }
+}
+
+/**
+ * @brief a && b y a || b con cortocircuito.
+ */
+static void emit_logical(BcBuilder *b, const AstNode *e) {
+    int is_and = e->op == TOKEN_AND_AND;
+    emit_expression(b, e->a);
+    uint32_t short_circuit = emit_u32(b, is_and ? BC_JUMP_FALSE : BC_JUMP_TRUE, 0);
+    emit_expression(b, e->b);
+    uint32_t done = emit_u32(b, BC_JUMP, 0);
+    write_u32(b, short_circuit, here(b));
+    adjust_depth(b, -1);
+    emit_u32(b, BC_CONST, is_and ? 0 : 1);
+    write_u32(b, done, here(b));
+}
+
+/**
+ * @brief Expresión cuyo valor puede escapar del marco (@p escape = 1) o no.
+ */
+static void emit_value(BcBuilder *b, const AstNode *e, int escape) {
+    int saved = b->escape;
+    b->escape = escape;
+    emit_expression(b, e);
+    b->escape = saved;
+}
+
+/**
+ * @brief Operando BC_REF_* de una instrucción sobre referencias del tipo @p type.
+ */
+static uint8_t ref_flags(AstType type, int escape) {
+    return (uint8_t)((type == AST_TYPE_ARRAY ? BC_REF_ARRAY : 0) | (escape ? BC_REF_POOL : 0));
+}
+
+/**
+ * @brief literal con la referencia de un objeto internado.
+ */
+static void emit_literal(BcBuilder *b, const void *bytes, uint32_t length, uint8_t kind) {
+    uint32_t ref = strings_intern(b->strings, bytes, length, kind);
+    if (ref == UINT32_MAX) {
+        b->too_many_literals = 1;
+        ref = 0;
+    }
+    emit_u32(b, BC_LITERAL, ref);
+}
+
+/**
+ * @brief Valor de un elemento constante de un arreglo (n, -n o +n).
+ *
+ * @return 1 si lo es.
+ */
+static int constant_element(const AstNode *e, int32_t *value) {
+    if (e->kind == AST_NUMBER) {
+        *value = (int32_t)e->value;
+        return 1;
+    }
+    if (e->kind == AST_UNARY && (e->op == TOKEN_MINUS || e->op == TOKEN_PLUS)
+            && constant_element(e->a, value)) {
+        *value = e->op == TOKEN_MINUS ? (int32_t)(0u - (uint32_t)*value) : *value;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief "texto": sus bytes, sin escapes, internados en el segmento.
+ */
+static void emit_string(BcBuilder *b, const AstNode *e) {
+    const char *text = b->program->source + ast_offset(b->decl, e) + 1;
+    uint8_t *bytes = (uint8_t *)malloc(e->length > 2 ? e->length - 2 : 1);
+    if (bytes == NULL) {
+        b->out_of_memory = 1;
+        return;
+    }
+    size_t length = sema_unescape(text, e->length - 2, bytes);
+    emit_literal(b, bytes, (uint32_t)length, 0);
+    free(bytes);
+}
+
+/**
+ * @brief [a, b, ...]: internado si todos los elementos son constantes, o array.
+ */
+static void emit_array(BcBuilder *b, const AstNode *e) {
+    uint32_t count = (uint32_t)e->value;
+    int32_t *values = (int32_t *)malloc((count > 0 ? count : 1) * sizeof(int32_t));
+    if (values == NULL) {
+        b->out_of_memory = 1;
+        return;
+    }
+    uint32_t constants = 0;
+    for (const AstNode *element = e->a; element != NULL; element = element->next) {
+        if (!constant_element(element, &values[constants])) {
+            break;
+        }
+        constants++;
+    }
+    if (constants == count) {
+        emit_literal(b, values, count, BC_REF_ARRAY);
+    } else {
+        for (const AstNode *element = e->a; element != NULL; element = element->next) {
+            emit_value(b, element, 0);
+        }
+        emit_u32(b, BC_ARRAY, count | (uint32_t)ref_flags(AST_TYPE_ARRAY, b->escape) << 16);
+        adjust_depth(b, 1 - (int)count);
+    }
+    free(values);
+}
+
+/**
+ * @brief Llamada a una función del programa, o a len() o at().
+ *
+ * Si el llamado devuelve una referencia, puede ser uno de los argumentos:
+ * estos escapan si escapa el resultado.
+ */
+static void emit_call(BcBuilder *b, const AstNode *e) {
+    int escape = returns_reference(b->program, e) ? b->escape : 0;
+    int argc = 0;
+    for (const AstNode *arg = e->b; arg != NULL; arg = arg->next, argc++) {
+        emit_value(b, arg, escape);
+    }
+    if (e->slot == SEMA_BUILTIN_LEN) {
+        emit(b, BC_LENGTH);
+    } else if (e->slot == SEMA_BUILTIN_AT) {
+        emit_u8(b, BC_INDEX, ref_flags((AstType)e->aux, 0));
+    } else {
+        add_call_site(b, e->a);
+        emit_u16(b, BC_CALL, (uint32_t)e->slot);
+        adjust_depth(b, 1 - argc);
+    }
+}
+
+/**
+ * @brief Operador binario sobre String o Array: concatenación o igualdad.
+ */
+static void emit_reference_binary(BcBuilder *b, const AstNode *e) {
+    emit_value(b, e->a, 0);
+    emit_value(b, e->b, 0);
+    if (e->op == TOKEN_PLUS) {
+        emit_u8(b, BC_CONCAT, ref_flags(e->a->type, b->escape));
+    } else {
+        emit_u8(b, BC_EQUAL, ref_flags(e->a->type, 0));
+        if (e->op == TOKEN_BANG_EQUAL) {
+            emit(b, BC_NOT);
+        }
+    }
+}
+
+/**
+ * @brief Expresión que deja un valor en la pila.
+ *
+ * Las asignaciones de String y Array usan el pool si b->escape.
+ */
+static void emit_expression(BcBuilder *b, const AstNode *e) {
+    switch (e->kind) {
+        case AST_NUMBER:
+        case AST_CHAR:
+        case AST_BOOL:
+            emit_u32(b, BC_CONST, (uint32_t)e->value);
+            break;
+        case AST_STRING:
+            emit_string(b, e);
+            break;
+        case AST_ARRAY:
+            emit_array(b, e);
+            break;
+        case AST_NAME:
+            emit_u16(b, BC_LOAD, (uint32_t)e->slot);
+            break;
+        case AST_UNARY:
+            emit_value(b, e->a, 0);
+            if (e->op == TOKEN_MINUS) {
+                emit(b, BC_NEG);
+            } else if (e->op == TOKEN_BANG) {
+                emit(b, BC_NOT);
+            }
+            break;
+        case AST_BINARY:
+            if (e->op == TOKEN_AND_AND || e->op == TOKEN_OR_OR) {
+                emit_logical(b, e);
+            } else if (ast_type_is_reference(e->a->type)) {
+                emit_reference_binary(b, e);
+            } else {
+                emit_value(b, e->a, 0);
+                emit_value(b, e->b, 0);
+                emit(b, binary_op(e->op));
+            }
+            break;
+        case AST_CALL:
+            emit_call(b, e);
+            break;
+        default:
+            break;
+    }
+}
+
+/**
+ * @brief Expresión cuyo valor se descarta: asignación, print() o cualquier otra.
+ */
+static void emit_expression_statement(BcBuilder *b, const AstNode *e) {
+    if (e->kind == AST_BLOCK) {
+        emit_block(b, e);
+    } else if (e->kind == AST_ASSIGN) {
+        uint32_t slot = (uint32_t)e->a->slot;
+        if (e->op != TOKEN_EQUAL) {
+            emit_u16(b, BC_LOAD, slot);
+            emit_expression(b, e->b);
+            if (ast_type_is_reference(e->a->type)) {
+                emit_u8(b, BC_CONCAT, ref_flags(e->a->type, b->escaping[slot]));
+            } else {
+                emit(b, binary_op(e->op));
+            }
+        } else {
+            emit_value(b, e->b, b->escaping[slot]);
+        }
+        emit_u16(b, BC_STORE, slot);
+    } else if (e->kind == AST_CALL && e->slot == SEMA_BUILTIN_PRINT) {
+        emit_expression(b, e->b);
+        emit_u8(b, BC_PRINT, (uint8_t)e->aux);
+    } else {
+        emit_expression(b, e);
+        emit(b, BC_POP);
+    }
+}
+
+/* ---- Sentencias ---- */
+
+/**
+ * @brief Cuerpo de un ciclo; devuelve sus saltos pendientes en @p loop.
+ */
+static void emit_loop_body(BcBuilder *b, const AstNode *body, BcLoop *loop) {
+    loop->outer = b->loop;
+    loop->breaks = BC_NO_PATCH;
+    loop->continues = BC_NO_PATCH;
+    b->loop = loop;
+    emit_block(b, body);
+    b->loop = loop->outer;
+}
+
+/**
+ * @brief Registra el núcleo de un ciclo vectorizable y emite su instrucción.
+ */
+static void emit_vector(BcBuilder *b, const AstNode *statement) {
+    BcFunction *f = b->function;
+    if (f->kernel_count > UINT16_MAX) {
+        return;
+    }
+    if (f->kernel_count == b->kernel_capacity) {
+        size_t grown = b->kernel_capacity > 0 ? b->kernel_capacity * 2 : 4;
+        BcKernel *larger = (BcKernel *)realloc(f->kernels, grown * sizeof(BcKernel));
+        if (larger == NULL) {
+            b->out_of_memory = 1;
+            return;
+        }
+        f->kernels = larger;
+        b->kernel_capacity = grown;
+    }
+    int matched = vec_match_for(statement, &f->kernels[f->kernel_count]);
+    if (matched < 0) {
+        b->out_of_memory = 1;
+    } else if (matched > 0) {
+        emit_u16(b, BC_VECTOR, (uint32_t)f->kernel_count++);
+    }
+}
+
+/**
+ * @brief for x in a..b { ... } con el fin evaluado una sola vez.
+ *
+ * Con BC_VECTORIZE, si el cuerpo solo acumula reducciones, una instrucción
+ * vector adelanta las iteraciones antes de la comparación del ciclo.
+ */
+static void emit_for(BcBuilder *b, const AstNode *statement) {
+    const AstNode *range = statement->a;
+    uint32_t var = (uint32_t)statement->slot;
+    uint32_t end = (uint32_t)statement->aux;
+    emit_expression(b, range->a);
+    emit_u16(b, BC_STORE, var);
+    emit_expression(b, range->b);
+    emit_u16(b, BC_STORE, end);
+    if (b->flags & BC_VECTORIZE) {
+        emit_vector(b, statement);
+    }
+    uint32_t top = here(b);
+    emit_u16(b, BC_LOAD, var);
+    emit_u16(b, BC_LOAD, end);
+    emit(b, BC_LT);
+    uint32_t exit = emit_u32(b, BC_JUMP_FALSE, 0);
+    BcLoop loop;
+    emit_loop_body(b, statement->b, &loop);
+    add_line(b, ast_line(b->decl, statement));
+    patch_chain(b, loop.continues, here(b));
+    emit_u16(b, BC_LOAD, var);
+    emit_u32(b, BC_CONST, 1);
+    emit(b, BC_ADD);
+    emit_u16(b, BC_STORE, var);
+    emit_u32(b, BC_JUMP, top);
+    write_u32(b, exit, here(b));
+    patch_chain(b, loop.breaks, here(b));
+}
+
+/**
+ * @brief match x { ... }: compara el valor guardado con cada patrón en orden.
+ */
+static void emit_match(BcBuilder *b, const AstNode *statement) {
+    uint32_t subject = (uint32_t)statement->slot;
+    uint32_t done = BC_NO_PATCH;
+    emit_value(b, statement->a, b->escaping[subject]);
+    emit_u16(b, BC_STORE, subject);
+    for (const AstNode *arm = statement->b; arm != NULL; arm = arm->next) {
+        const AstNode *pattern = arm->a;
+        uint32_t next_arm = BC_NO_PATCH;
+        if (pattern->kind == AST_NAME) {
+            if (pattern->slot >= 0) {
+                emit_u16(b, BC_LOAD, subject);
+                emit_u16(b, BC_STORE, (uint32_t)pattern->slot);
+            }
+        } else {
+            emit_u16(b, BC_LOAD, subject);
+            emit_expression(b, pattern);
+            if (ast_type_is_reference(statement->a->type)) {
+                emit_u8(b, BC_EQUAL, ref_flags(statement->a->type, 0));
+            } else {
+                emit(b, BC_EQ);
+            }
+            next_arm = emit_u32(b, BC_JUMP_FALSE, 0);
+        }
+        emit_expression_statement(b, arm->b);
+        done = emit_u32(b, BC_JUMP, done);
+        if (next_arm != BC_NO_PATCH) {
+            write_u32(b, next_arm, here(b));
+        }
+    }
+    patch_chain(b, done, here(b));
+}
+
+/**
+ * @brief return del valor de la cima, cerrando antes el marco si se abrió.
+ */
+static void emit_return(BcBuilder *b) {
+    if (b->heap) {
+        emit_u8(b, BC_LEAVE, (uint8_t)b->returns_reference);
+    }
+    emit(b, BC_RETURN);
+}
+
+/**
+ * @brief Sentencia: deja la pila como la encontró.
+ */
+static void emit_statement(BcBuilder *b, const AstNode *statement) {
+    if (statement->kind != AST_BLOCK) {
+        add_line(b, ast_line(b->decl, statement));
+    }
+    switch (statement->kind) {
+        case AST_LET:
+            if (statement->b != NULL) {
+                emit_value(b, statement->b, b->escaping[statement->slot]);
+            } else {
+                emit_u32(b, BC_CONST, 0);
+            }
+            emit_u16(b, BC_STORE, (uint32_t)statement->slot);
+            break;
+        case AST_IF: {
+            emit_expression(b, statement->a);
+            uint32_t otherwise = emit_u32(b, BC_JUMP_FALSE, 0);
+            emit_block(b, statement->b);
+            if (statement->c != NULL) {
+                uint32_t done = emit_u32(b, BC_JUMP, 0);
+                write_u32(b, otherwise, here(b));
+                emit_statement(b, statement->c);
+                write_u32(b, done, here(b));
+            } else {
+                write_u32(b, otherwise, here(b));
+            }
+            break;
+        }
+        case AST_WHILE: {
+            uint32_t top = here(b);
+            emit_expression(b, statement->a);
+            uint32_t exit = emit_u32(b, BC_JUMP_FALSE, 0);
+            BcLoop loop;
+            emit_loop_body(b, statement->b, &loop);
+            add_line(b, ast_line(b->decl, statement));
+            emit_u32(b, BC_JUMP, top);
+            write_u32(b, exit, here(b));
+            patch_chain(b, loop.continues, top);
+            patch_chain(b, loop.breaks, here(b));
+            break;
+        }
+        case AST_FOR:
+            emit_for(b, statement);
+            break;
+        case AST_LOOP: {
+            uint32_t top = here(b);
+            BcLoop loop;
+            emit_loop_body(b, statement->b, &loop);
+            add_line(b, ast_line(b->decl, statement));
+            emit_u32(b, BC_JUMP, top);
+            patch_chain(b, loop.continues, top);
+            patch_chain(b, loop.breaks, here(b));
+            break;
+        }
+        case AST_MATCH:
+            emit_match(b, statement);
+            break;
+        case AST_BLOCK:
+            emit_block(b, statement);
+            break;
+        case AST_RETURN:
+            if (statement->a != NULL) {
+                emit_value(b, statement->a, b->returns_reference);
+            } else {
+                emit_u32(b, BC_CONST, 0);
+            }
+            emit_return(b);
+            break;
+        case AST_BREAK:
+            b->loop->breaks = emit_u32(b, BC_JUMP, b->loop->breaks);
+            break;
+        case AST_CONTINUE:
+            b->loop->continues = emit_u32(b, BC_JUMP, b->loop->continues);
+            break;
+        case AST_EXPR_STMT:
+            emit_expression_statement(b, statement->a);
+            break;
+        default:
+            break;
+    }
+}
+
+static void emit_block(BcBuilder *b, const AstNode *block) {
+    for (const AstNode *statement = block->a; statement != NULL; statement = statement->next) {
+        emit_statement(b, statement);
+    }
+}
+
+/**
+ * @brief Traduce una función; al final devuelve 0 si el cuerpo no retornó.
+ *
+ * @param scratch Memoria temporal del análisis de escape (se reinicia al terminar).
+ * @return 0 si es exitoso, 1 si falta memoria o el marco es demasiado grande.
+ */
+static int compile_function(const SemaProgram *program, const SemaFunction *source, uint32_t index,
+                            unsigned flags, BcStrings *strings, Arena *scratch, DiagEngine *diag,
+                            BcFunction *function) {
+    const AstNode *decl = source->decl;
+    function->name = program->source + decl->offset;
+    function->name_length = decl->length;
+    function->param_count = (uint32_t)source->param_count;
+    function->slot_count = (uint32_t)source->slot_count;
+
+    uint8_t *escaping = (uint8_t *)arena_alloc(scratch, source->slot_count + 1);
+    if (escaping != NULL) {
+        memset(escaping, 0, source->slot_count + 1);
+    }
+    BcBuilder b;
+    memset(&b, 0, sizeof(b));
+    b.program = program;
+    b.decl = decl;
+    b.function = function;
+    b.strings = strings;
+    b.flags = flags;
+    b.escaping = escaping;
+    b.returns_reference = ast_type_is_reference(source->result);
+    if (escaping == NULL) {
+        b.out_of_memory = 1;
+    } else {
+        b.heap = escape_analyze(program, source, escaping);
+        add_line(&b, decl->line);
+        if (b.heap) {
+            emit(&b, BC_ENTER);
+        }
+        emit_block(&b, decl->c);
+        add_line(&b, decl->line);
+        emit_u32(&b, BC_CONST, 0);
+        emit_return(&b);
+    }
+    arena_reset(scratch);
+
+    function->origins = (BcOrigin *)malloc(sizeof(BcOrigin));
+    if (function->origins != NULL) {
+        function->origins[0].pc = 0;
+        function->origins[0].function = index;
+        function->origins[0].depth = 0;
+        function->origin_count = 1;
+    }
+
+    SourceSpan span = { decl->line, decl->column, decl->length };
+    if (b.out_of_memory || function->origins == NULL || function->lines == NULL) {
+        diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+        return 1;
+    }
+    if (b.too_many_literals) {
+        diag_report(diag, DIAG_ERROR, span, "los literales del programa exceden %u bytes", RT_INDEX_MASK);
+        return 1;
+    }
+    if (function->slot_count + function->max_stack > BC_MAX_FRAME_SLOTS) {
+        diag_report(diag, DIAG_ERROR, span,
+                    "la función '%.*s' es demasiado grande: %u variables y %u valores temporales (máximo %d)",
+                    (int)decl->length, function->name, function->slot_count, function->max_stack,
+                    BC_MAX_FRAME_SLOTS);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Copia el segmento de literales a páginas propias de solo lectura.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int seal_strings(const BcStrings *strings, BcModule *module) {
+    void *memory = mmap(NULL, strings->length, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return 1;
+    }
+    memcpy(memory, strings->data, strings->length);
+    if (mprotect(memory, strings->length, PROT_READ) != 0) {
+        munmap(memory, strings->length);
+        return 1;
+    }
+    module->strings = (const uint8_t *)memory;
+    module->strings_length = strings->length;
+    return 0;
+}
+
+/* ---- Bytecode guardado ---- */
+
+/** Primera palabra de bc_function_save() ("BCF2"); cambia con el formato. */
+#define BC_SAVED_MAGIC 0x32464342u
+
+/**
+ * @brief Nombre de una función del programa, para resolver llamadas guardadas.
+ */
+typedef struct BcName {
+    const char *name;
+    size_t length;
+    uint32_t index;
+} BcName;
+
+/**
+ * @brief Lectura de un bytecode guardado; failed queda en 1 al salir de los datos.
+ */
+typedef struct BcReader {
+    const uint8_t *data;
+    size_t length;
+    size_t position;
+    int failed;
+} BcReader;
+
+static void save_u32(FILE *out, uint32_t value) {
+    uint8_t bytes[4] = { (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16),
+                         (uint8_t)(value >> 24) };
+    fwrite(bytes, 1, sizeof(bytes), out);
+}
+
+static const uint8_t *read_bytes(BcReader *r, size_t count) {
+    if (r->failed || count > r->length - r->position) {
+        r->failed = 1;
+        return NULL;
+    }
+    const uint8_t *bytes = r->data + r->position;
+    r->position += count;
+    return bytes;
+}
+
+static uint32_t read_u32(BcReader *r) {
+    const uint8_t *bytes = read_bytes(r, 4);
+    return bytes != NULL ? bc_read_u32(bytes) : 0;
+}
+
+/**
+ * @brief Guarda el bytecode de una función para bc_compile_reusing().
+ *
+ * Debe llamarse antes de la expansión en línea, cuando el código de la
+ * función es solo suyo. Se escriben el encabezado (BC_SAVED_MAGIC,
+ * parámetros, ranuras, pila y cantidades), el código, las llamadas y los
+ * tramos de línea con su línea relativa a la declaración, los núcleos y, en
+ * el orden del código,
+ * el nombre y los parámetros de cada función llamada y el tipo y los datos
+ * de cada literal.
+ *
+ * @param program Programa del que se tradujo @p module.
+ * @param index Función a guardar.
+ * @param out Destino.
+ * @return 0 si es exitoso, 1 si hay error de escritura.
+ */
+int bc_function_save(const SemaProgram *program, const BcModule *module, size_t index, FILE *out) {
+    const BcFunction *f = &module->functions[index];
+    uint32_t decl_line = program->functions[index].decl->line;
+    save_u32(out, BC_SAVED_MAGIC);
+    save_u32(out, f->param_count);
+    save_u32(out, f->slot_count);
+    save_u32(out, f->max_stack);
+    save_u32(out, (uint32_t)f->length);
+    save_u32(out, (uint32_t)f->call_count);
+    save_u32(out, (uint32_t)f->line_count);
+    save_u32(out, (uint32_t)f->kernel_count);
+    fwrite(f->code, 1, f->length, out);
+    for (size_t i = 0; i < f->call_count; i++) {
+        save_u32(out, f->calls[i].pc);
+        save_u32(out, f->calls[i].line - decl_line);
+        save_u32(out, f->calls[i].column);
+    }
+    for (size_t i = 0; i < f->line_count; i++) {
+        save_u32(out, f->lines[i].pc);
+        save_u32(out, f->lines[i].line - decl_line);
+    }
+    for (size_t k = 0; k < f->kernel_count; k++) {
+        const BcKernel *kernel = &f->kernels[k];
+        save_u32(out, kernel->index_slot);
+        save_u32(out, kernel->end_slot);
+        save_u32(out, kernel->reduction_count);
+        for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+            save_u32(out, kernel->reductions[r].kind);
+            save_u32(out, kernel->reductions[r].slot);
+            save_u32(out, kernel->reductions[r].start);
+            save_u32(out, kernel->reductions[r].length);
+        }
+        save_u32(out, kernel->code_length);
+        for (uint32_t i = 0; i < kernel->code_length; i++) {
+            save_u32(out, kernel->code[i].op);
+            save_u32(out, kernel->code[i].slot);
+            save_u32(out, (uint32_t)kernel->code[i].value);
+        }
+    }
+    for (size_t pc = 0; pc < f->length; pc += 1 + bc_operand_size((BcOp)f->code[pc])) {
+        if (f->code[pc] == BC_CALL) {
+            const BcFunction *callee = &module->functions[bc_read_u16(f->code + pc + 1)];
+            save_u32(out, (uint32_t)callee->name_length);
+            fwrite(callee->name, 1, callee->name_length, out);
+            save_u32(out, callee->param_count);
+        } else if (f->code[pc] == BC_LITERAL) {
+            const RtObject *object = (const RtObject *)(module->strings + bc_read_u32(f->code + pc + 1));
+            save_u32(out, object->size_class);
+            save_u32(out, object->length);
+            fwrite(rt_data(object), 1, (size_t)object->length * (object->size_class & BC_REF_ARRAY ? 4 : 1), out);
+        }
+    }
+    return ferror(out) ? 1 : 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+    const BcName *x = (const BcName *)a;
+    const BcName *y = (const BcName *)b;
+    size_t length = x->length < y->length ? x->length : y->length;
+    int order = memcmp(x->name, y->name, length);
+    return order != 0 ? order : (x->length > y->length) - (x->length < y->length);
+}
+
+/**
+ * @brief Nombres de las funciones del programa ordenados para bsearch().
+ */
+static BcName *sorted_names(const SemaProgram *program) {
+    BcName *names = (BcName *)malloc((program->function_count > 0 ? program->function_count : 1)
+                                     * sizeof(BcName));
+    if (names == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < program->function_count; i++) {
+        const AstNode *decl = program->functions[i].decl;
+        names[i].name = program->source + decl->offset;
+        names[i].length = decl->length;
+        names[i].index = (uint32_t)i;
+    }
+    qsort(names, program->function_count, sizeof(BcName), compare_names);
+    return names;
+}
+
+/**
+ * @brief Lee los núcleos de un bytecode guardado.
+ */
+static void load_kernels(BcReader *r, BcFunction *function, uint32_t count) {
+    function->kernels = (BcKernel *)calloc(count > 0 ? count : 1, sizeof(BcKernel));
+    if (function->kernels == NULL) {
+        r->failed = 1;
+        return;
+    }
+    function->kernel_count = count;
+    for (uint32_t k = 0; k < count && !r->failed; k++) {
+        BcKernel *kernel = &function->kernels[k];
+        kernel->index_slot = (uint16_t)read_u32(r);
+        kernel->end_slot = (uint16_t)read_u32(r);
+        kernel->reduction_count = read_u32(r);
+        if (kernel->reduction_count > BC_VECTOR_MAX_REDUCTIONS) {
+            r->failed = 1;
+            return;
+        }
+        for (uint32_t i = 0; i < kernel->reduction_count; i++) {
+            kernel->reductions[i].kind = (uint8_t)read_u32(r);
+            kernel->reductions[i].slot = (uint16_t)read_u32(r);
+            kernel->reductions[i].start = read_u32(r);
+            kernel->reductions[i].length = read_u32(r);
+        }
+        kernel->code_length = read_u32(r);
+        if (kernel->code_length > BC_VECTOR_MAX_CODE) {
+            r->failed = 1;
+            return;
+        }
+        kernel->code = (BcVecInstr *)malloc((kernel->code_length > 0 ? kernel->code_length : 1)
+                                            * sizeof(BcVecInstr));
+        if (kernel->code == NULL) {
+            r->failed = 1;
+            return;
+        }
+        for (uint32_t i = 0; i < kernel->code_length; i++) {
+            kernel->code[i].op = (uint8_t)read_u32(r);
+            kernel->code[i].slot = (uint16_t)read_u32(r);
+            kernel->code[i].value = (int32_t)read_u32(r);
+        }
+    }
+}
+
+/**
+ * @brief Resuelve las llamadas y los literales del código leído en el programa nuevo.
+ */
+static void relocate(BcReader *r, const BcName *names, size_t name_count, const SemaProgram *program,
+                     BcStrings *strings, BcFunction *function) {
+    uint8_t *code = function->code;
+    for (size_t pc = 0; pc < function->length && !r->failed;) {
+        BcOp op = (BcOp)code[pc];
+        size_t size = 1 + bc_operand_size(op);
+        if ((unsigned)op >= BC_OP_COUNT || size > function->length - pc) {
+            r->failed = 1;
+            break;
+        }
+        uint8_t *operand = code + pc + 1;
+        if (op == BC_CALL) {
+            BcName key = { NULL, read_u32(r), 0 };
+            key.name = (const char *)read_bytes(r, key.length);
+            uint32_t param_count = read_u32(r);
+            const BcName *found = r->failed ? NULL
+                                : (const BcName *)bsearch(&key, names, name_count, sizeof(BcName), compare_names);
+            if (found == NULL || program->functions[found->index].param_count != param_count) {
+                r->failed = 1;
+                break;
+            }
+            operand[0] = (uint8_t)found->index;
+            operand[1] = (uint8_t)(found->index >> 8);
+        } else if (op == BC_LITERAL) {
+            uint32_t kind = read_u32(r);
+            uint32_t length = read_u32(r);
+            const uint8_t *bytes = read_bytes(r, (size_t)length * (kind & BC_REF_ARRAY ? 4 : 1));
+            uint32_t ref = bytes != NULL ? strings_intern(strings, bytes, length, (uint8_t)kind) : UINT32_MAX;
+            if (ref == UINT32_MAX) {
+                r->failed = 1;
+                break;
+            }
+            for (int i = 0; i < 4; i++) {
+                operand[i] = (uint8_t)(ref >> (8 * i));
+            }
+        } else if ((op == BC_LOAD || op == BC_STORE) && bc_read_u16(operand) >= function->slot_count) {
+            r->failed = 1;
+        } else if ((op == BC_JUMP || op == BC_JUMP_FALSE || op == BC_JUMP_TRUE)
+                   && bc_read_u32(operand) >= function->length) {
+            r->failed = 1;
+        } else if (op == BC_VECTOR && bc_read_u16(operand) >= function->kernel_count) {
+            r->failed = 1;
+        }
+        pc += size;
+    }
+}
+
+/**
+ * @brief Valores que @p op desapila y apila (el código ya está reubicado).
+ */
+static void stack_use(const SemaProgram *program, BcOp op, const uint8_t *operand,
+                      uint32_t *pops, uint32_t *pushes) {
+    *pushes = 1;
+    switch (op) {
+        case BC_CONST:
+        case BC_LITERAL:
+        case BC_LOAD:
+            *pops = 0;
+            break;
+        case BC_JUMP:
+        case BC_VECTOR:
+        case BC_ENTER:
+            *pops = 0;
+            *pushes = 0;
+            break;
+        case BC_NEG:
+        case BC_NOT:
+        case BC_LENGTH:
+        case BC_LEAVE:
+            *pops = 1;
+            break;
+        case BC_STORE:
+        case BC_POP:
+        case BC_PRINT:
+        case BC_JUMP_FALSE:
+        case BC_JUMP_TRUE:
+        case BC_RETURN:
+            *pops = 1;
+            *pushes = 0;
+            break;
+        case BC_CALL:
+            *pops = (uint32_t)program->functions[bc_read_u16(operand)].param_count;
+            break;
+        case BC_ARRAY:
+            *pops = bc_read_u32(operand) & 0xFFFFu;
+            break;
+        default:
+            *pops = 2;
+            break;
+    }
+}
+
+/**
+ * @brief Comprueba los núcleos leídos: ranuras de la función y expresiones bien formadas.
+ *
+ * @return 0 si son válidos, 1 si no.
+ */
+static int check_kernels(const BcFunction *function) {
+    for (size_t k = 0; k < function->kernel_count; k++) {
+        const BcKernel *kernel = &function->kernels[k];
+        if (kernel->index_slot >= function->slot_count || kernel->end_slot >= function->slot_count) {
+            return 1;
+        }
+        for (uint32_t i = 0; i < kernel->code_length; i++) {
+            if (kernel->code[i].op > BC_VEC_NEG
+                    || (kernel->code[i].op == BC_VEC_LOAD && kernel->code[i].slot >= function->slot_count)) {
+                return 1;
+            }
+        }
+        for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+            const BcReduction *reduction = &kernel->reductions[r];
+            if (reduction->kind > BC_REDUCE_MAX || reduction->slot >= function->slot_count
+                    || reduction->start > kernel->code_length
+                    || reduction->length > kernel->code_length - reduction->start) {
+                return 1;
+            }
+            uint32_t depth = 0;
+            for (uint32_t i = reduction->start; i < reduction->start + reduction->length; i++) {
+                uint8_t op = kernel->code[i].op;
+                uint32_t pops = op == BC_VEC_NEG ? 1 : op >= BC_VEC_ADD ? 2 : 0;
+                if (depth < pops || depth - pops + 1 > BC_VECTOR_MAX_DEPTH) {
+                    return 1;
+                }
+                depth = depth - pops + 1;
+            }
+            if (depth != 1) {
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Comprueba que el código leído pueda ejecutarse sin salir de su marco.
+ *
+ * Recorre los caminos del código: cada salto debe caer en el inicio de una
+ * instrucción y cada instrucción debe alcanzarse con la misma profundidad de
+ * pila por todos ellos, sin desapilar de más ni pasar de max_stack. Las
+ * llamadas y los tramos de línea deben apuntar al código, y los núcleos a
+ * las ranuras de la función.
+ *
+ * @return 0 si es válido, 1 si no o si falta memoria.
+ */
+static int check_code(const SemaProgram *program, const BcFunction *function) {
+    const uint8_t *code = function->code;
+    size_t length = function->length;
+    if (length == 0 || function->slot_count < function->param_count || check_kernels(function) != 0) {
+        return 1;
+    }
+    /* -2: no es el inicio de una instrucción; -1: aún no alcanzada */
+    int32_t *depth = (int32_t *)malloc(length * sizeof(int32_t));
+    size_t *pending = (size_t *)malloc(length * sizeof(size_t));
+    int failed = depth == NULL || pending == NULL;
+    for (size_t pc = 0; pc < length && !failed; pc++) {
+        depth[pc] = -2;
+    }
+    for (size_t pc = 0; pc < length && !failed; pc += 1 + bc_operand_size((BcOp)code[pc])) {
+        depth[pc] = -1;
+    }
+    for (size_t i = 0; i < function->call_count && !failed; i++) {
+        uint32_t pc = function->calls[i].pc;
+        failed = pc >= length || depth[pc] != -1 || code[pc] != BC_CALL;
+    }
+    for (size_t i = 0; i < function->line_count && !failed; i++) {
+        uint32_t pc = function->lines[i].pc;
+        failed = pc >= length || depth[pc] != -1 || (i == 0 ? pc != 0 : pc <= function->lines[i - 1].pc);
+    }
+
+    size_t pending_count = 0;
+    if (!failed) {
+        depth[0] = 0;
+        pending[pending_count++] = 0;
+    }
+    while (pending_count > 0 && !failed) {
+        size_t pc = pending[--pending_count];
+        BcOp op = (BcOp)code[pc];
+        uint32_t pops;
+        uint32_t pushes;
+        stack_use(program, op, code + pc + 1, &pops, &pushes);
+        if ((uint32_t)depth[pc] < pops || (uint32_t)depth[pc] - pops + pushes > function->max_stack) {
+            failed = 1;
+            break;
+        }
+        int32_t after = depth[pc] - (int32_t)pops + (int32_t)pushes;
+        size_t next[2];
+        size_t next_count = 0;
+        if (op != BC_JUMP && op != BC_RETURN) {
+            next[next_count++] = pc + 1 + bc_operand_size(op);
+        }
+        if (op == BC_JUMP || op == BC_JUMP_FALSE || op == BC_JUMP_TRUE) {
+            next[next_count++] = bc_read_u32(code + pc + 1);
+        }
+        for (size_t n = 0; n < next_count && !failed; n++) {
+            if (next[n] >= length || depth[next[n]] == -2) {
+                failed = 1;
+            } else if (depth[next[n]] == -1) {
+                depth[next[n]] = after;
+                pending[pending_count++] = next[n];
+            } else {
+                failed = depth[next[n]] != after;
+            }
+        }
+    }
+    free(depth);
+    free(pending);
+    return failed;
+}
+
+/**
+ * @brief Reconstruye la función @p index a partir de su bytecode guardado.
+ *
+ * @return 0 si es exitoso, 1 si los datos no corresponden a la función o falta memoria.
+ */
+static int load_function(const SemaProgram *program, const BcName *names, const BcSaved *saved,
+                         uint32_t index, BcStrings *strings, BcFunction *function) {
+    const SemaFunction *source = &program->functions[index];
+    const AstNode *decl = source->decl;
+    function->name = program->source + decl->offset;
+    function->name_length = decl->length;
+    BcReader r = { saved->data, saved->length, 0, 0 };
+    if (read_u32(&r) != BC_SAVED_MAGIC || read_u32(&r) != source->param_count) {
+        return 1;
+    }
+    function->param_count = (uint32_t)source->param_count;
+    function->slot_count = read_u32(&r);
+    function->max_stack = read_u32(&r);
+    uint32_t length = read_u32(&r);
+    uint32_t call_count = read_u32(&r);
+    uint32_t line_count = read_u32(&r);
+    uint32_t kernel_count = read_u32(&r);
+    const uint8_t *code = read_bytes(&r, length);
+    if (r.failed || function->slot_count + function->max_stack > BC_MAX_FRAME_SLOTS
+            || call_count > length || line_count == 0 || line_count > length || kernel_count > length) {
+        return 1;
+    }
+    function->code = (uint8_t *)malloc(length > 0 ? length : 1);
+    function->calls = (BcCallSite *)malloc((call_count > 0 ? call_count : 1) * sizeof(BcCallSite));
+    function->origins = (BcOrigin *)malloc(sizeof(BcOrigin));
+    function->lines = (BcLine *)malloc(line_count * sizeof(BcLine));
+    if (function->code == NULL || function->calls == NULL || function->origins == NULL
+            || function->lines == NULL) {
+        return 1;
+    }
+    memcpy(function->code, code, length);
+    function->length = length;
+    function->origins[0].pc = 0;
+    function->origins[0].function = index;
+    function->origins[0].depth = 0;
+    function->origin_count = 1;
+    for (uint32_t i = 0; i < call_count; i++) {
+        function->calls[i].pc = read_u32(&r);
+        function->calls[i].line = read_u32(&r) + decl->line;
+        function->calls[i].column = read_u32(&r);
+    }
+    function->call_count = call_count;
+    for (uint32_t i = 0; i < line_count; i++) {
+        function->lines[i].pc = read_u32(&r);
+        function->lines[i].line = read_u32(&r) + decl->line;
+    }
+    function->line_count = line_count;
+    load_kernels(&r, function, kernel_count);
+    relocate(&r, names, program->function_count, program, strings, function);
+    return r.failed || r.position != r.length || check_code(program, function) != 0;
+}
+
+/* ---- Traducción en paralelo ---- */
+
+/**
+ * @brief Trabajo compartido por los hilos de la traducción.
+ *
+ * Cada hilo interna los literales en su propio segmento; al unir, en el
+ * orden del programa, se pasan al del módulo, que así queda igual que en la
+ * traducción en serie.
+ */
+typedef struct BcParallel {
+    const SemaProgram *program;
+    unsigned flags;
+    const BcSaved *saved;       /**< Las funciones con bytecode guardado se cargan al unir */
+    BcFunction *functions;      /**< Las del módulo */
+    BcStrings *strings;         /**< Segmento de literales de cada hilo */
+    uint32_t *worker;           /**< Hilo que tradujo cada función */
+    uint8_t *failed;            /**< 1 por función cuya traducción falló en su hilo */
+    atomic_size_t next;         /**< Siguiente función a repartir */
+} BcParallel;
+
+/**
+ * @brief Hilo de la traducción.
+ */
+typedef struct BcWorker {
+    BcParallel *shared;
+    uint32_t index;
+} BcWorker;
+
+/**
+ * @brief Hilos a usar: @p requested, o los núcleos disponibles si es 0.
+ */
+static size_t compile_thread_count(int requested, size_t function_count) {
+    long n = requested > 0 ? requested : sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = n > 1 ? (size_t)n : 1;
+    return threads < function_count ? threads : function_count;
+}
+
+/**
+ * @brief Traduce funciones hasta que no quede ninguna por repartir.
+ *
+ * Los errores solo se cuentan: la función se vuelve a traducir al unir para
+ * reportarlos en orden.
+ */
+static void *compile_worker(void *arg) {
+    BcWorker *worker = (BcWorker *)arg;
+    BcParallel *shared = worker->shared;
+    DiagEngine counter;
+    memset(&counter, 0, sizeof(counter));
+    Arena scratch;
+    arena_init(&scratch, 0);
+    for (;;) {
+        size_t i = atomic_fetch_add(&shared->next, 1);
+        if (i >= shared->program->function_count) {
+            break;
+        }
+        if (shared->saved != NULL && shared->saved[i].data != NULL) {
+            continue;
+        }
+        shared->worker[i] = worker->index;
+        shared->failed[i] = (uint8_t)compile_function(shared->program, &shared->program->functions[i],
+                                                      (uint32_t)i, shared->flags,
+                                                      &shared->strings[worker->index], &scratch, &counter,
+                                                      &shared->functions[i]);
+    }
+    arena_free(&scratch);
+    return NULL;
+}
+
+/**
+ * @brief Traduce las funciones sin bytecode guardado con @p threads hilos (incluido el actual).
+ *
+ * @return 0 si es exitoso, 1 si falta memoria (no se tradujo ninguna).
+ */
+static int compile_parallel(BcParallel *shared, size_t threads) {
+    size_t count = shared->program->function_count;
+    BcWorker *workers = (BcWorker *)calloc(threads, sizeof(BcWorker));
+    pthread_t *ids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    shared->strings = (BcStrings *)calloc(threads, sizeof(BcStrings));
+    shared->worker = (uint32_t *)calloc(count, sizeof(uint32_t));
+    shared->failed = (uint8_t *)calloc(count, 1);
+    int failed = workers == NULL || ids == NULL || shared->strings == NULL
+              || shared->worker == NULL || shared->failed == NULL;
+    for (size_t t = 0; !failed && t < threads; t++) {
+        failed = strings_intern(&shared->strings[t], "", 0, 0) != 0;
+    }
+    atomic_init(&shared->next, 0);
+
+    size_t started = 0;
+    for (size_t t = 1; !failed && t < threads; t++) {
+        workers[t].shared = shared;
+        workers[t].index = (uint32_t)t;
+        if (pthread_create(&ids[t], NULL, compile_worker, &workers[t]) != 0) {
+            break;
+        }
+        started = t;
+    }
+    if (!failed) {
+        workers[0].shared = shared;
+        compile_worker(&workers[0]);
+    }
+    for (size_t t = 1; t <= started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    free(workers);
+    free(ids);
+    return failed;
+}
+
+/**
+ * @brief Libera el estado de compile_parallel().
+ */
+static void free_parallel(BcParallel *shared, size_t threads) {
+    for (size_t t = 0; shared->strings != NULL && t < threads; t++) {
+        free(shared->strings[t].data);
+        free(shared->strings[t].table);
+    }
+    free(shared->strings);
+    free(shared->worker);
+    free(shared->failed);
+}
+
+/**
+ * @brief Pasa los literales de una función del segmento de su hilo a @p to.
+ *
+ * Se internan en el orden del código, que es el de la traducción en serie.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria o el segmento se excede.
+ */
+static int move_literals(BcFunction *function, const BcStrings *from, BcStrings *to) {
+    for (size_t pc = 0; pc < function->length; pc += 1 + bc_operand_size((BcOp)function->code[pc])) {
+        if (function->code[pc] != BC_LITERAL) {
+            continue;
+        }
+        uint8_t *operand = function->code + pc + 1;
+        const RtObject *object = (const RtObject *)(from->data + bc_read_u32(operand));
+        uint32_t ref = strings_intern(to, rt_data(object), object->length, object->size_class);
+        if (ref == UINT32_MAX) {
+            return 1;
+        }
+        for (int i = 0; i < 4; i++) {
+            operand[i] = (uint8_t)(ref >> (8 * i));
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Libera el código de una función.
+ */
+static void free_function(BcFunction *function) {
+    free(function->code);
+    free(function->calls);
+    free(function->origins);
+    free(function->lines);
+    for (size_t k = 0; k < function->kernel_count; k++) {
+        free(function->kernels[k].code);
+    }
+    free(function->kernels);
+}
+
+/**
+ * @brief Traduce a bytecode un programa analizado sin errores.
+ *
+ * @param program Resultado de sema_analyze() (su AST debe seguir vivo).
+ * @param flags Opciones BC_*; 0 para traducir cada ciclo de forma escalar.
+ * @param diag Motor de diagnósticos para los límites del backend.
+ * @param module Destino; liberar con bc_free() aunque falle.
+ * @return 0 si es exitoso, 1 si hubo errores.
+ */
+int bc_compile(const SemaProgram *program, unsigned flags, DiagEngine *diag, BcModule *module) {
+    return bc_compile_reusing(program, flags, NULL, 1, diag, module);
+}
+
+/**
+ * @brief Como bc_compile(), pero reparte las funciones entre @p threads hilos.
+ *
+ * El módulo y los diagnósticos son idénticos a los de bc_compile() con
+ * cualquier número de hilos.
+ *
+ * @param threads Hilos a usar, o 0 para usar los núcleos disponibles.
+ */
+int bc_compile_parallel(const SemaProgram *program, unsigned flags, int threads, DiagEngine *diag,
+                        BcModule *module) {
+    return bc_compile_reusing(program, flags, NULL, threads, diag, module);
+}
+
+/**
+ * @brief Como bc_compile_parallel(), pero toma de @p saved el bytecode de las funciones que lo tienen.
+ *
+ * El AST de esas funciones solo se usa por su firma (su cuerpo puede estar
+ * vacío). @p saved debe haberse guardado con las mismas opciones @p flags.
+ *
+ * Con varios hilos, cada uno traduce las funciones que toma con su propio
+ * segmento de literales y su propia memoria temporal; después, en el orden
+ * del programa, se cargan las funciones guardadas y se pasan los literales
+ * de las traducidas al segmento del módulo. Una función que falló en su
+ * hilo se vuelve a traducir en serie, de modo que los errores se reportan
+ * igual y en el mismo orden.
+ *
+ * @param saved Una entrada por función del programa, o NULL para traducirlas todas.
+ * @param threads Hilos a usar, o 0 para usar los núcleos disponibles.
+ * @return 0 si es exitoso, 1 si hubo errores, -1 si un bytecode guardado no
+ *         corresponde al programa (sin diagnóstico; hay que traducir desde el fuente).
+ */
+int bc_compile_reusing(const SemaProgram *program, unsigned flags, const BcSaved *saved, int threads,
+                       DiagEngine *diag, BcModule *module) {
+    uint64_t start = stats_clock();
+    memset(module, 0, sizeof(*module));
+    module->functions = (BcFunction *)calloc(program->function_count > 0 ? program->function_count : 1,
+                                             sizeof(BcFunction));
+    if (module->functions == NULL) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+        return 1;
+    }
+    module->function_count = program->function_count;
+    module->main_index = program->main_index;
+    module->flags = flags;
+    if (program->function_count > UINT16_MAX + 1u) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "demasiadas funciones (máximo %u)", UINT16_MAX + 1u);
+        return 1;
+    }
+
+    BcStrings strings;
+    memset(&strings, 0, sizeof(strings));
+    BcName *names = saved != NULL ? sorted_names(program) : NULL;
+    int errors = strings_intern(&strings, "", 0, 0) != 0  /* La referencia 0 es el objeto vacío */
+              || (saved != NULL && names == NULL);
+
+    BcParallel shared;
+    memset(&shared, 0, sizeof(shared));
+    shared.program = program;
+    shared.flags = flags;
+    shared.saved = saved;
+    shared.functions = module->functions;
+    size_t workers = compile_thread_count(threads, program->function_count);
+    if (!errors && workers > 1 && compile_parallel(&shared, workers) != 0) {
+        free_parallel(&shared, workers);
+        memset(&shared, 0, sizeof(shared));
+        workers = 1;
+    }
+
+    Arena scratch;
+    arena_init(&scratch, 0);
+    for (size_t i = 0; i < program->function_count && !errors; i++) {
+        BcFunction *function = &module->functions[i];
+        if (saved != NULL && saved[i].data != NULL) {
+            errors = load_function(program, names, &saved[i], (uint32_t)i, &strings, function) != 0 ? -1 : 0;
+        } else if (workers > 1 && !shared.failed[i]
+                   && move_literals(function, &shared.strings[shared.worker[i]], &strings) == 0) {
+            errors = 0;
+        } else {
+            if (workers > 1) {
+                free_function(function);
+                memset(function, 0, sizeof(*function));
+            }
+            errors = compile_function(program, &program->functions[i], (uint32_t)i, flags, &strings,
+                                      &scratch, diag, function);
+        }
+    }
+    arena_free(&scratch);
+    if (workers > 1) {
+        free_parallel(&shared, workers);
+    }
+    free(names);
+    if (!errors && seal_strings(&strings, module) != 0) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+        errors = 1;
+    }
+    free(strings.data);
+    free(strings.table);
+    stats_phase_add(STATS_CODEGEN, stats_clock() - start);
+    return errors;
+}
+
+/**
+ * @brief Libera el código de un módulo.
+ */
+void bc_free(BcModule *module) {
+    for (size_t i = 0; i < module->function_count; i++) {
+        free_function(&module->functions[i]);
+    }
+    free(module->functions);
+    if (module->strings != NULL) {
+        munmap((void *)module->strings, module->strings_length);
+    }
+    module->functions = NULL;
+    module->function_count = 0;
+    module->strings = NULL;
+    module->strings_length = 0;
+}
+
+/**
+ * @brief Copia un núcleo desplazando sus ranuras (para la expansión en línea).
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int bc_copy_kernel(BcKernel *copy, const BcKernel *kernel, uint32_t slot_offset) {
+    *copy = *kernel;
+    copy->index_slot = (uint16_t)(kernel->index_slot + slot_offset);
+    copy->end_slot = (uint16_t)(kernel->end_slot + slot_offset);
+    for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+        copy->reductions[r].slot = (uint16_t)(kernel->reductions[r].slot + slot_offset);
+    }
+    copy->code = (BcVecInstr *)malloc((kernel->code_length > 0 ? kernel->code_length : 1)
+                                      * sizeof(BcVecInstr));
+    if (copy->code == NULL) {
+        return 1;
+    }
+    for (uint32_t i = 0; i < kernel->code_length; i++) {
+        copy->code[i] = kernel->code[i];
+        if (copy->code[i].op == BC_VEC_LOAD) {
+            copy->code[i].slot = (uint16_t)(copy->code[i].slot + slot_offset);
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Escribe un núcleo: una línea por reducción, con su expresión en postfijo.
+ */
+static void disassemble_kernel(const BcKernel *kernel, size_t index, FILE *out) {
+    static const char *const REDUCE_NAMES[] = { "suma", "producto", "minimo", "maximo" };
+    static const char *const VEC_NAMES[] = { "indice", "const", "load", "add", "sub", "mul", "neg" };
+    fprintf(out, "  nucleo %zu (indice %u, fin %u)\n", index, kernel->index_slot, kernel->end_slot);
+    for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+        const BcReduction *reduction = &kernel->reductions[r];
+        fprintf(out, "    %s %u:", REDUCE_NAMES[reduction->kind], reduction->slot);
+        for (uint32_t i = reduction->start; i < reduction->start + reduction->length; i++) {
+            const BcVecInstr *instr = &kernel->code[i];
+            fprintf(out, " %s", VEC_NAMES[instr->op]);
+            if (instr->op == BC_VEC_CONST) {
+                fprintf(out, " %d", instr->value);
+            } else if (instr->op == BC_VEC_LOAD) {
+                fprintf(out, " %u", instr->slot);
+            }
+        }
+        fputc('\n', out);
+    }
+}
+
+/**
+ * @brief Operando de una instrucción sobre referencias: "array 3 pool", "concat string".
+ */
+static void disassemble_ref(BcOp op, const uint8_t *operand, FILE *out) {
+    unsigned flags = operand[0];
+    if (op == BC_ARRAY) {
+        uint32_t value = bc_read_u32(operand);
+        fprintf(out, " %u", value & 0xFFFF);
+        flags = value >> 16;
+    } else {
+        fputs(flags & BC_REF_ARRAY ? " array" : " string", out);
+    }
+    fputs(flags & BC_REF_POOL ? " pool\n" : "\n", out);
+}
+
+/**
+ * @brief Escribe el bytecode de todas las funciones, una instrucción por línea.
+ */
+void bc_disassemble(const BcModule *module, FILE *out) {
+    for (size_t i = 0; i < module->function_count; i++) {
+        const BcFunction *f = &module->functions[i];
+        fprintf(out, "fn %.*s (parametros %u, ranuras %u, pila %u)\n", (int)f->name_length, f->name,
+                f->param_count, f->slot_count, f->max_stack);
+        for (size_t pc = 0; pc < f->length;) {
+            BcOp op = (BcOp)f->code[pc];
+            fprintf(out, "  %04zu %s", pc, bc_op_name(op));
+            if (op == BC_CONCAT || op == BC_INDEX || op == BC_EQUAL || op == BC_ARRAY) {
+                disassemble_ref(op, f->code + pc + 1, out);
+                pc += 1 + bc_operand_size(op);
+                continue;
+            }
+            switch (bc_operand_size(op)) {
+                case 1: fprintf(out, " %u", f->code[pc + 1]); break;
+                case 2: fprintf(out, " %u", bc_read_u16(f->code + pc + 1)); break;
+                case 4:
+                    if (op == BC_CONST) {
+                        fprintf(out, " %d", (int32_t)bc_read_u32(f->code + pc + 1));
+                    } else {
+                        fprintf(out, " %u", bc_read_u32(f->code + pc + 1));
+                    }
+                    break;
+                default: break;
+            }
+            fputc('\n', out);
+            pc += 1 + bc_operand_size(op);
+        }
+        for (size_t k = 0; k < f->kernel_count; k++) {
+            disassemble_kernel(&f->kernels[k], k, out);
+        }
+    }
+    if (module->strings_length > sizeof(RtObject)) {
+        fprintf(out, "literales: %zu bytes\n", module->strings_length);
+    }
+}
+
+/**
+ * @brief Tramo de origen que contiene el byte @p pc (el último, si hay tramos vacíos en él).
+ */
+static size_t origin_index(const BcFunction *function, size_t pc) {
+    size_t low = 0;
+    size_t high = function->origin_count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (function->origins[middle].pc <= pc) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Función del fuente a la que pertenece la instrucción en @p pc.
+ */
+uint32_t bc_origin(const BcFunction *function, size_t pc) {
+    return function->origins[origin_index(function, pc)].function;
+}
+
+/**
+ * @brief Funciones expandidas en línea que contienen el byte @p pc, de la más externa a la más interna.
+ *
+ * No incluye a la función dueña del código: fuera de una expansión, la
+ * cadena está vacía. Con expansiones anidadas (main -> f -> g con ambas
+ * expandidas en main) da f y g.
+ *
+ * @param chain Destino de hasta @p capacity funciones.
+ * @return Funciones de la cadena, aunque sean más que @p capacity.
+ */
+size_t bc_origin_chain(const BcFunction *function, size_t pc, uint32_t *chain, size_t capacity) {
+    size_t at = origin_index(function, pc);
+    size_t count = function->origins[at].depth;
+    size_t level = count;
+    for (size_t i = at + 1; i-- > 0 && level > 0;) {
+        if (function->origins[i].depth == level) {
+            if (level <= capacity) {
+                chain[level - 1] = function->origins[i].function;
+            }
+            level--;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Línea del fuente a la que pertenece el byte @p pc de una función.
+ */
+uint32_t bc_line(const BcFunction *function, size_t pc) {
+    size_t low = 0;
+    size_t high = function->line_count;
+    while (high - low > 1) {
+        size_t middle = low + (high - low) / 2;
+        if (function->lines[middle].pc <= pc) {
+            low = middle;
+        } else {
+            high = middle;
+        }
+    }
+    return function->lines[low].line;
+}
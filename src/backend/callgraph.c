@@ -0,0 +1,224 @@
+/**
+ * @file callgraph.c
+ * @brief Construcción del grafo de llamadas y componentes fuertes (Tarjan).
+ *
+ * El recorrido de Tarjan es iterativo, con su propia pila de marcos, para
+ * que un programa con miles de funciones encadenadas no agote la pila de C.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/callgraph.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Función aún no visitada por Tarjan. */
+#define CALLGRAPH_UNVISITED UINT32_MAX
+
+/**
+ * @brief Marco del recorrido en profundidad.
+ */
+typedef struct TarjanFrame {
+    uint32_t function;
+    size_t next_edge;           /**< Siguiente arista por explorar */
+} TarjanFrame;
+
+/**
+ * @brief Aristas sin repetir a partir de las llamadas del bytecode.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int build_edges(const BcModule *module, CallGraph *graph) {
+    size_t n = module->function_count;
+    size_t total = 0;
+    for (size_t f = 0; f < n; f++) {
+        total += module->functions[f].call_count;
+    }
+    graph->edge_start = (size_t *)malloc((n + 1) * sizeof(size_t));
+    graph->callees = (uint32_t *)malloc((total > 0 ? total : 1) * sizeof(uint32_t));
+    uint32_t *last_caller = (uint32_t *)malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+    if (graph->edge_start == NULL || graph->callees == NULL || last_caller == NULL) {
+        free(last_caller);
+        return 1;
+    }
+    memset(last_caller, 0xFF, n * sizeof(uint32_t));
+
+    size_t count = 0;
+    for (size_t f = 0; f < n; f++) {
+        const BcFunction *function = &module->functions[f];
+        graph->edge_start[f] = count;
+        for (size_t i = 0; i < function->call_count; i++) {
+            uint32_t callee = bc_read_u16(function->code + function->calls[i].pc + 1);
+            if (last_caller[callee] != f) {
+                last_caller[callee] = (uint32_t)f;
+                graph->callees[count++] = callee;
+            }
+        }
+    }
+    graph->edge_start[n] = count;
+    free(last_caller);
+    return 0;
+}
+
+/**
+ * @brief Numera las componentes fuertes en orden topológico inverso.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int find_components(CallGraph *graph) {
+    size_t n = graph->function_count;
+    size_t bytes = (n > 0 ? n : 1) * sizeof(uint32_t);
+    uint32_t *index = (uint32_t *)malloc(bytes);
+    uint32_t *low = (uint32_t *)malloc(bytes);
+    uint32_t *stack = (uint32_t *)malloc(bytes);
+    uint8_t *on_stack = (uint8_t *)calloc(n > 0 ? n : 1, 1);
+    TarjanFrame *frames = (TarjanFrame *)malloc((n > 0 ? n : 1) * sizeof(TarjanFrame));
+    if (index == NULL || low == NULL || stack == NULL || on_stack == NULL || frames == NULL) {
+        free(index);
+        free(low);
+        free(stack);
+        free(on_stack);
+        free(frames);
+        return 1;
+    }
+    memset(index, 0xFF, n * sizeof(uint32_t));
+
+    uint32_t counter = 0;
+    size_t stack_size = 0;
+    for (size_t root = 0; root < n; root++) {
+        if (index[root] != CALLGRAPH_UNVISITED) {
+            continue;
+        }
+        size_t depth = 0;
+        frames[depth].function = (uint32_t)root;
+        frames[depth].next_edge = graph->edge_start[root];
+        depth++;
+        index[root] = low[root] = counter++;
+        stack[stack_size++] = (uint32_t)root;
+        on_stack[root] = 1;
+
+        while (depth > 0) {
+            TarjanFrame *frame = &frames[depth - 1];
+            uint32_t v = frame->function;
+            if (frame->next_edge < graph->edge_start[v + 1]) {
+                uint32_t w = graph->callees[frame->next_edge++];
+                if (index[w] == CALLGRAPH_UNVISITED) {
+                    index[w] = low[w] = counter++;
+                    stack[stack_size++] = w;
+                    on_stack[w] = 1;
+                    frames[depth].function = w;
+                    frames[depth].next_edge = graph->edge_start[w];
+                    depth++;
+                } else if (on_stack[w] && index[w] < low[v]) {
+                    low[v] = index[w];
+                }
+                continue;
+            }
+            depth--;
+            if (low[v] == index[v]) {
+                uint32_t component = (uint32_t)graph->component_count++;
+                size_t size = 0;
+                uint32_t w;
+                do {
+                    w = stack[--stack_size];
+                    on_stack[w] = 0;
+                    graph->component[w] = component;
+                    size++;
+                } while (w != v);
+                if (size > 1) {
+                    for (size_t i = stack_size; i < stack_size + size; i++) {
+                        graph->recursive[stack[i]] = 1;
+                    }
+                }
+            }
+            if (depth > 0) {
+                uint32_t parent = frames[depth - 1].function;
+                if (low[v] < low[parent]) {
+                    low[parent] = low[v];
+                }
+            }
+        }
+    }
+    free(index);
+    free(low);
+    free(stack);
+    free(on_stack);
+    free(frames);
+    return 0;
+}
+
+/**
+ * @brief Construye el grafo de llamadas de un módulo.
+ *
+ * @param module Programa traducido.
+ * @param graph Destino; liberar con callgraph_free() aunque falle.
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int callgraph_build(const BcModule *module, CallGraph *graph) {
+    memset(graph, 0, sizeof(*graph));
+    size_t n = module->function_count;
+    graph->function_count = n;
+    graph->component = (uint32_t *)malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+    graph->order = (uint32_t *)malloc((n > 0 ? n : 1) * sizeof(uint32_t));
+    graph->recursive = (uint8_t *)calloc(n > 0 ? n : 1, 1);
+    if (graph->component == NULL || graph->order == NULL || graph->recursive == NULL
+            || build_edges(module, graph) != 0 || find_components(graph) != 0) {
+        return 1;
+    }
+
+    for (size_t f = 0; f < n; f++) {
+        for (size_t e = graph->edge_start[f]; e < graph->edge_start[f + 1]; e++) {
+            if (graph->callees[e] == f) {
+                graph->recursive[f] = 1;
+            }
+        }
+    }
+
+    // Orden por componente (conteo), estable respecto del orden del fuente.
+    size_t *first = (size_t *)calloc(graph->component_count + 1, sizeof(size_t));
+    if (first == NULL) {
+        return 1;
+    }
+    for (size_t f = 0; f < n; f++) {
+        first[graph->component[f] + 1]++;
+    }
+    for (size_t c = 0; c < graph->component_count; c++) {
+        first[c + 1] += first[c];
+    }
+    for (size_t f = 0; f < n; f++) {
+        graph->order[first[graph->component[f]]++] = (uint32_t)f;
+    }
+    free(first);
+    return 0;
+}
+
+/**
+ * @brief Libera un grafo de llamadas.
+ */
+void callgraph_free(CallGraph *graph) {
+    free(graph->edge_start);
+    free(graph->callees);
+    free(graph->component);
+    free(graph->order);
+    free(graph->recursive);
+    memset(graph, 0, sizeof(*graph));
+}
+
+/**
+ * @brief Escribe el grafo: una función por línea, de los llamados a los llamadores.
+ */
+void callgraph_print(const CallGraph *graph, const BcModule *module, FILE *out) {
+    fprintf(out, "grafo de llamadas: %zu funciones, %zu componentes\n", graph->function_count,
+            graph->component_count);
+    for (size_t i = 0; i < graph->function_count; i++) {
+        uint32_t f = graph->order[i];
+        const BcFunction *function = &module->functions[f];
+        fprintf(out, "  %u %.*s%s", graph->component[f], (int)function->name_length, function->name,
+                graph->recursive[f] ? " (recursiva)" : "");
+        for (size_t e = graph->edge_start[f]; e < graph->edge_start[f + 1]; e++) {
+            const BcFunction *callee = &module->functions[graph->callees[e]];
+            fprintf(out, "%s%.*s", e == graph->edge_start[f] ? " -> " : ", ",
+                    (int)callee->name_length, callee->name);
+        }
+        fputc('\n', out);
+    }
+}
@@ -0,0 +1,465 @@
+/**
+ * @file image.c
+ * @brief Escritura y proyección de módulos de bytecode precompilados.
+ *
+ * El archivo es la cabecera seguida de las secciones, cada una alineada a
+ * IMAGE_ALIGN. Las llamadas, los tramos de origen y de línea y las
+ * instrucciones de los núcleos se guardan con la representación en memoria
+ * de BcCallSite, BcOrigin, BcLine y BcVecInstr (ver las comprobaciones de
+ * tamaño abajo), así que
+ * BcFunction apunta directamente a la proyección. Solo BcKernel, que
+ * contiene un puntero, se reconstruye al abrir.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/image.h"
+#include "../../include/cache.h"
+#include "../../include/hash.h"
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+_Static_assert(sizeof(BcCallSite) == 12 && sizeof(BcOrigin) == 12 && sizeof(BcLine) == 8,
+               "BcCallSite, BcOrigin y BcLine se proyectan tal cual");
+_Static_assert(sizeof(BcVecInstr) == 8 && offsetof(BcVecInstr, slot) == 2 && offsetof(BcVecInstr, value) == 4,
+               "BcVecInstr se proyecta tal cual");
+
+/**
+ * @brief Secciones, en su orden dentro del archivo.
+ */
+typedef enum ImageSectionId {
+    IMAGE_LITERALS,             /* Segmento de literales internados (BcModule.strings) */
+    IMAGE_NAMES,                /* Nombres de las funciones, sin separador */
+    IMAGE_FUNCTIONS,            /* ImageFunction */
+    IMAGE_CODE,
+    IMAGE_CALLS,                /* BcCallSite */
+    IMAGE_ORIGINS,              /* BcOrigin */
+    IMAGE_LINES,                /* BcLine */
+    IMAGE_KERNELS,              /* ImageKernel */
+    IMAGE_VECTOR,               /* BcVecInstr de los núcleos */
+    IMAGE_SECTION_COUNT
+} ImageSectionId;
+
+/** Bytes de cada elemento de una sección (1 para las de bytes). */
+static const size_t SECTION_ELEMENT[IMAGE_SECTION_COUNT] = {
+    1, 1, 0, 1, sizeof(BcCallSite), sizeof(BcOrigin), sizeof(BcLine), 0, sizeof(BcVecInstr)
+};
+
+typedef struct ImageSection {
+    uint64_t offset;            /* Desde el principio del archivo */
+    uint64_t length;            /* Bytes */
+} ImageSection;
+
+typedef struct ImageHeader {
+    uint32_t magic;             /* IMAGE_MAGIC */
+    uint32_t format;            /* IMAGE_FORMAT_VERSION */
+    char version[16];           /* COMPILADOR_VERSION, completado con '\0' */
+    uint64_t checksum;          /* XXH64 de los bytes que siguen a la cabecera */
+    uint64_t size;              /* Bytes del archivo */
+    uint32_t flags;             /* BcModule.flags */
+    uint32_t main_index;
+    uint32_t function_count;
+    uint32_t kernel_count;
+    ImageSection sections[IMAGE_SECTION_COUNT];
+} ImageHeader;
+
+/**
+ * @brief Función: desplazamientos en IMAGE_NAMES e IMAGE_CODE y primer elemento de sus tablas.
+ */
+typedef struct ImageFunction {
+    uint32_t name;
+    uint32_t name_length;
+    uint32_t param_count;
+    uint32_t slot_count;
+    uint32_t max_stack;
+    uint32_t code;
+    uint32_t length;
+    uint32_t calls;
+    uint32_t call_count;
+    uint32_t origins;
+    uint32_t origin_count;
+    uint32_t lines;
+    uint32_t line_count;
+    uint32_t kernels;
+    uint32_t kernel_count;
+} ImageFunction;
+
+typedef struct ImageReduction {
+    uint8_t kind;
+    uint8_t unused;
+    uint16_t slot;
+    uint32_t start;
+    uint32_t length;
+} ImageReduction;
+
+/**
+ * @brief Núcleo: su código es el tramo de IMAGE_VECTOR que empieza en code.
+ */
+typedef struct ImageKernel {
+    uint16_t index_slot;
+    uint16_t end_slot;
+    uint32_t reduction_count;
+    uint32_t code;
+    uint32_t code_length;
+    ImageReduction reductions[BC_VECTOR_MAX_REDUCTIONS];
+} ImageKernel;
+
+/**
+ * @brief Devuelve la descripción de un resultado de image_open().
+ */
+const char *image_status_message(ImageStatus status) {
+    switch (status) {
+        case IMAGE_OK: return "ok";
+        case IMAGE_IO: return "no se pudo leer el archivo";
+        case IMAGE_FORMAT: return "no es un módulo de bytecode válido";
+        case IMAGE_VERSION: return "el módulo es de otra versión del compilador; vuelva a generarlo";
+        case IMAGE_CHECKSUM: return "el módulo está dañado (la suma de comprobación no coincide)";
+        case IMAGE_NO_MEMORY: return "memoria insuficiente";
+        default: return "?";
+    }
+}
+
+static size_t align_up(size_t value) {
+    return (value + IMAGE_ALIGN - 1) & ~(size_t)(IMAGE_ALIGN - 1);
+}
+
+/**
+ * @brief Escribe un módulo traducido como imagen.
+ *
+ * El módulo se guarda tal cual (con la expansión en línea y la
+ * vectorización ya aplicadas), junto con sus opciones BC_*. Los bytes de
+ * relleno son cero, así que el mismo módulo produce siempre el mismo archivo.
+ *
+ * @param module Módulo a guardar.
+ * @param out Destino.
+ * @return 0 si es exitoso, 1 si falta memoria, el módulo no cabe en el
+ *         formato o hay error de escritura.
+ */
+int image_write(const BcModule *module, FILE *out) {
+    uint64_t lengths[IMAGE_SECTION_COUNT] = { 0 };
+    size_t kernel_count = 0;
+    lengths[IMAGE_LITERALS] = module->strings_length;
+    lengths[IMAGE_FUNCTIONS] = module->function_count * sizeof(ImageFunction);
+    for (size_t i = 0; i < module->function_count; i++) {
+        const BcFunction *function = &module->functions[i];
+        lengths[IMAGE_NAMES] += function->name_length;
+        lengths[IMAGE_CODE] += function->length;
+        lengths[IMAGE_CALLS] += function->call_count * sizeof(BcCallSite);
+        lengths[IMAGE_ORIGINS] += function->origin_count * sizeof(BcOrigin);
+        lengths[IMAGE_LINES] += function->line_count * sizeof(BcLine);
+        kernel_count += function->kernel_count;
+        for (size_t k = 0; k < function->kernel_count; k++) {
+            lengths[IMAGE_VECTOR] += function->kernels[k].code_length * sizeof(BcVecInstr);
+        }
+    }
+    lengths[IMAGE_KERNELS] = kernel_count * sizeof(ImageKernel);
+
+    ImageHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = IMAGE_MAGIC;
+    header.format = IMAGE_FORMAT_VERSION;
+    strncpy(header.version, COMPILADOR_VERSION, sizeof(header.version) - 1);
+    header.flags = module->flags;
+    header.main_index = (uint32_t)module->main_index;
+    header.function_count = (uint32_t)module->function_count;
+    header.kernel_count = (uint32_t)kernel_count;
+    size_t size = align_up(sizeof(header));
+    for (int s = 0; s < IMAGE_SECTION_COUNT; s++) {
+        // Los desplazamientos dentro de cada sección se guardan en 32 bits.
+        if (lengths[s] > UINT32_MAX) {
+            return 1;
+        }
+        header.sections[s].offset = size;
+        header.sections[s].length = lengths[s];
+        size = align_up(size + (size_t)lengths[s]);
+    }
+    header.size = size;
+
+    uint8_t *data = (uint8_t *)calloc(1, size);
+    if (data == NULL) {
+        return 1;
+    }
+    if (module->strings_length > 0) {
+        memcpy(data + header.sections[IMAGE_LITERALS].offset, module->strings, module->strings_length);
+    }
+    uint8_t *names = data + header.sections[IMAGE_NAMES].offset;
+    ImageFunction *functions = (ImageFunction *)(data + header.sections[IMAGE_FUNCTIONS].offset);
+    uint8_t *code = data + header.sections[IMAGE_CODE].offset;
+    BcCallSite *calls = (BcCallSite *)(data + header.sections[IMAGE_CALLS].offset);
+    BcOrigin *origins = (BcOrigin *)(data + header.sections[IMAGE_ORIGINS].offset);
+    BcLine *lines = (BcLine *)(data + header.sections[IMAGE_LINES].offset);
+    ImageKernel *kernels = (ImageKernel *)(data + header.sections[IMAGE_KERNELS].offset);
+    BcVecInstr *vector = (BcVecInstr *)(data + header.sections[IMAGE_VECTOR].offset);
+    uint32_t name_at = 0, code_at = 0, call_at = 0, origin_at = 0, line_at = 0, kernel_at = 0, vector_at = 0;
+    for (size_t i = 0; i < module->function_count; i++) {
+        const BcFunction *function = &module->functions[i];
+        ImageFunction *saved = &functions[i];
+        saved->name = name_at;
+        saved->name_length = (uint32_t)function->name_length;
+        saved->param_count = function->param_count;
+        saved->slot_count = function->slot_count;
+        saved->max_stack = function->max_stack;
+        saved->code = code_at;
+        saved->length = (uint32_t)function->length;
+        saved->calls = call_at;
+        saved->call_count = (uint32_t)function->call_count;
+        saved->origins = origin_at;
+        saved->origin_count = (uint32_t)function->origin_count;
+        saved->lines = line_at;
+        saved->line_count = (uint32_t)function->line_count;
+        saved->kernels = kernel_at;
+        saved->kernel_count = (uint32_t)function->kernel_count;
+        memcpy(names + name_at, function->name, function->name_length);
+        memcpy(code + code_at, function->code, function->length);
+        // Campo a campo: el relleno de las estructuras queda en cero.
+        for (size_t c = 0; c < function->call_count; c++) {
+            calls[call_at + c].pc = function->calls[c].pc;
+            calls[call_at + c].line = function->calls[c].line;
+            calls[call_at + c].column = function->calls[c].column;
+        }
+        for (size_t o = 0; o < function->origin_count; o++) {
+            origins[origin_at + o].pc = function->origins[o].pc;
+            origins[origin_at + o].function = function->origins[o].function;
+            origins[origin_at + o].depth = function->origins[o].depth;
+        }
+        for (size_t l = 0; l < function->line_count; l++) {
+            lines[line_at + l].pc = function->lines[l].pc;
+            lines[line_at + l].line = function->lines[l].line;
+        }
+        for (size_t k = 0; k < function->kernel_count; k++) {
+            const BcKernel *kernel = &function->kernels[k];
+            ImageKernel *copy = &kernels[kernel_at + k];
+            copy->index_slot = kernel->index_slot;
+            copy->end_slot = kernel->end_slot;
+            copy->reduction_count = kernel->reduction_count;
+            copy->code = vector_at;
+            copy->code_length = kernel->code_length;
+            for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+                copy->reductions[r].kind = kernel->reductions[r].kind;
+                copy->reductions[r].slot = kernel->reductions[r].slot;
+                copy->reductions[r].start = kernel->reductions[r].start;
+                copy->reductions[r].length = kernel->reductions[r].length;
+            }
+            for (uint32_t v = 0; v < kernel->code_length; v++) {
+                vector[vector_at + v].op = kernel->code[v].op;
+                vector[vector_at + v].slot = kernel->code[v].slot;
+                vector[vector_at + v].value = kernel->code[v].value;
+            }
+            vector_at += kernel->code_length;
+        }
+        name_at += (uint32_t)function->name_length;
+        code_at += (uint32_t)function->length;
+        call_at += (uint32_t)function->call_count;
+        origin_at += (uint32_t)function->origin_count;
+        line_at += (uint32_t)function->line_count;
+        kernel_at += (uint32_t)function->kernel_count;
+    }
+    header.checksum = hash64(data + sizeof(header), size - sizeof(header), 0);
+    memcpy(data, &header, sizeof(header));
+
+    int failed = fwrite(data, 1, size, out) != size;
+    free(data);
+    return failed;
+}
+
+/**
+ * @brief Indica si el tramo [first, first + count) cabe en una tabla de @p total elementos.
+ */
+static int fits(uint64_t first, uint64_t count, uint64_t total) {
+    return first <= total && count <= total - first;
+}
+
+/**
+ * @brief Comprueba la cabecera, la suma y que cada tabla quede dentro del archivo.
+ */
+static ImageStatus check_image(const uint8_t *map, size_t size, const ImageHeader *header) {
+    if (header->magic != IMAGE_MAGIC) {
+        return IMAGE_FORMAT;
+    }
+    if (header->format != IMAGE_FORMAT_VERSION
+            || strncmp(header->version, COMPILADOR_VERSION, sizeof(header->version)) != 0) {
+        return IMAGE_VERSION;
+    }
+    if (header->size != size) {
+        return IMAGE_FORMAT;
+    }
+    if (hash64(map + sizeof(*header), size - sizeof(*header), 0) != header->checksum) {
+        return IMAGE_CHECKSUM;
+    }
+    for (int s = 0; s < IMAGE_SECTION_COUNT; s++) {
+        const ImageSection *section = &header->sections[s];
+        if (section->offset < sizeof(*header) || section->offset % IMAGE_ALIGN != 0
+                || !fits(section->offset, section->length, size)
+                || (SECTION_ELEMENT[s] > 0 && section->length % SECTION_ELEMENT[s] != 0)) {
+            return IMAGE_FORMAT;
+        }
+    }
+    if (header->function_count == 0 || header->main_index >= header->function_count
+            || header->sections[IMAGE_FUNCTIONS].length != header->function_count * sizeof(ImageFunction)
+            || header->sections[IMAGE_KERNELS].length != header->kernel_count * sizeof(ImageKernel)) {
+        return IMAGE_FORMAT;
+    }
+    const ImageFunction *functions = (const ImageFunction *)(map + header->sections[IMAGE_FUNCTIONS].offset);
+    const ImageKernel *kernels = (const ImageKernel *)(map + header->sections[IMAGE_KERNELS].offset);
+    uint64_t vector_count = header->sections[IMAGE_VECTOR].length / sizeof(BcVecInstr);
+    for (uint32_t i = 0; i < header->function_count; i++) {
+        const ImageFunction *function = &functions[i];
+        if (!fits(function->name, function->name_length, header->sections[IMAGE_NAMES].length)
+                || !fits(function->code, function->length, header->sections[IMAGE_CODE].length)
+                || !fits(function->calls, function->call_count,
+                         header->sections[IMAGE_CALLS].length / sizeof(BcCallSite))
+                || !fits(function->origins, function->origin_count,
+                         header->sections[IMAGE_ORIGINS].length / sizeof(BcOrigin))
+                || function->line_count == 0
+                || !fits(function->lines, function->line_count,
+                         header->sections[IMAGE_LINES].length / sizeof(BcLine))
+                || !fits(function->kernels, function->kernel_count, header->kernel_count)) {
+            return IMAGE_FORMAT;
+        }
+    }
+    for (uint32_t k = 0; k < header->kernel_count; k++) {
+        const ImageKernel *kernel = &kernels[k];
+        if (kernel->reduction_count > BC_VECTOR_MAX_REDUCTIONS
+                || !fits(kernel->code, kernel->code_length, vector_count)) {
+            return IMAGE_FORMAT;
+        }
+        for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+            if (!fits(kernel->reductions[r].start, kernel->reductions[r].length, kernel->code_length)) {
+                return IMAGE_FORMAT;
+            }
+        }
+    }
+    return IMAGE_OK;
+}
+
+/**
+ * @brief Construye el módulo sobre una imagen ya comprobada.
+ *
+ * Las funciones y los núcleos se reservan aparte; el código, las llamadas,
+ * los tramos, los nombres y los literales apuntan a la proyección. BcFunction
+ * declara code como modificable porque la traducción lo escribe, pero
+ * ninguna ejecución modifica el código del módulo (la máquina virtual
+ * reescribe una copia propia).
+ */
+static ImageStatus build_module(const BcImage *image, const ImageHeader *header, BcModule *module,
+                                BcKernel **kernels_out) {
+    const uint8_t *map = image->map;
+    const ImageFunction *functions = (const ImageFunction *)(map + header->sections[IMAGE_FUNCTIONS].offset);
+    const ImageKernel *saved_kernels = (const ImageKernel *)(map + header->sections[IMAGE_KERNELS].offset);
+    const char *names = (const char *)(map + header->sections[IMAGE_NAMES].offset);
+    uint8_t *code = (uint8_t *)(uintptr_t)(map + header->sections[IMAGE_CODE].offset);
+    BcCallSite *calls = (BcCallSite *)(uintptr_t)(map + header->sections[IMAGE_CALLS].offset);
+    BcOrigin *origins = (BcOrigin *)(uintptr_t)(map + header->sections[IMAGE_ORIGINS].offset);
+    BcLine *lines = (BcLine *)(uintptr_t)(map + header->sections[IMAGE_LINES].offset);
+    BcVecInstr *vector = (BcVecInstr *)(uintptr_t)(map + header->sections[IMAGE_VECTOR].offset);
+
+    module->functions = (BcFunction *)calloc(header->function_count, sizeof(BcFunction));
+    BcKernel *kernels = (BcKernel *)calloc(header->kernel_count > 0 ? header->kernel_count : 1, sizeof(BcKernel));
+    *kernels_out = kernels;
+    if (module->functions == NULL || kernels == NULL) {
+        return IMAGE_NO_MEMORY;
+    }
+    for (uint32_t k = 0; k < header->kernel_count; k++) {
+        const ImageKernel *saved = &saved_kernels[k];
+        BcKernel *kernel = &kernels[k];
+        kernel->index_slot = saved->index_slot;
+        kernel->end_slot = saved->end_slot;
+        kernel->reduction_count = saved->reduction_count;
+        kernel->code = vector + saved->code;
+        kernel->code_length = saved->code_length;
+        for (uint32_t r = 0; r < saved->reduction_count; r++) {
+            kernel->reductions[r].kind = saved->reductions[r].kind;
+            kernel->reductions[r].slot = saved->reductions[r].slot;
+            kernel->reductions[r].start = saved->reductions[r].start;
+            kernel->reductions[r].length = saved->reductions[r].length;
+        }
+    }
+    for (uint32_t i = 0; i < header->function_count; i++) {
+        const ImageFunction *saved = &functions[i];
+        BcFunction *function = &module->functions[i];
+        function->name = names + saved->name;
+        function->name_length = saved->name_length;
+        function->param_count = saved->param_count;
+        function->slot_count = saved->slot_count;
+        function->max_stack = saved->max_stack;
+        function->code = code + saved->code;
+        function->length = saved->length;
+        function->calls = calls + saved->calls;
+        function->call_count = saved->call_count;
+        function->origins = origins + saved->origins;
+        function->origin_count = saved->origin_count;
+        function->lines = lines + saved->lines;
+        function->line_count = saved->line_count;
+        function->kernels = kernels + saved->kernels;
+        function->kernel_count = saved->kernel_count;
+    }
+    module->function_count = header->function_count;
+    module->main_index = header->main_index;
+    module->flags = header->flags;
+    module->strings_length = header->sections[IMAGE_LITERALS].length;
+    module->strings = module->strings_length > 0 ? map + header->sections[IMAGE_LITERALS].offset : NULL;
+    return IMAGE_OK;
+}
+
+/**
+ * @brief Proyecta una imagen escrita con image_write() y construye su módulo.
+ *
+ * @param path Archivo de la imagen.
+ * @param image Destino de la proyección.
+ * @param module Destino del módulo; vive hasta image_close() y no debe
+ *               liberarse con bc_free() ni modificarse (por ejemplo con
+ *               la expansión en línea).
+ * @return IMAGE_OK, o el motivo por el que no se pudo abrir (en ese caso
+ *         no hay nada que cerrar).
+ */
+ImageStatus image_open(const char *path, BcImage *image, BcModule *module) {
+    memset(image, 0, sizeof(*image));
+    memset(module, 0, sizeof(*module));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return IMAGE_IO;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(fd);
+        return IMAGE_IO;
+    }
+    if ((size_t)st.st_size < sizeof(ImageHeader)) {
+        close(fd);
+        return IMAGE_FORMAT;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        return IMAGE_IO;
+    }
+    image->map = (const uint8_t *)map;
+    image->size = (size_t)st.st_size;
+
+    ImageHeader header;
+    memcpy(&header, image->map, sizeof(header));
+    ImageStatus status = check_image(image->map, image->size, &header);
+    if (status == IMAGE_OK) {
+        status = build_module(image, &header, module, &image->kernels);
+    }
+    if (status != IMAGE_OK) {
+        image_close(image, module);
+    }
+    return status;
+}
+
+/**
+ * @brief Libera el módulo de image_open() y deshace la proyección.
+ */
+void image_close(BcImage *image, BcModule *module) {
+    free(module->functions);
+    free(image->kernels);
+    if (image->map != NULL) {
+        munmap((void *)(uintptr_t)image->map, image->size);
+    }
+    memset(module, 0, sizeof(*module));
+    memset(image, 0, sizeof(*image));
+}
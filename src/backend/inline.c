@@ -0,0 +1,888 @@
+/**
+ * @file inline.c
+ * @brief Expansión en línea sobre el bytecode, guiada por un modelo de costo.
+ *
+ * Expandir una llamada reemplaza su call por:
+ *
+ * - un store por argumento (del último al primero) en ranuras nuevas del
+ *   llamador, a partir de su slot_count original, donde viven las
+ *   variables del llamado; todas las expansiones de un llamador comparten
+ *   esa región porque nunca están activas a la vez;
+ * - el cuerpo del llamado con sus ranuras desplazadas y sus saltos
+ *   reubicados, donde cada return pasa a ser un salto al final (el valor
+ *   queda en la pila, como al volver de call). El return final y el
+ *   "const 0; return" inalcanzable que cierra cada función se omiten.
+ *
+ * Después se recalcula max_stack recorriendo el flujo de control, y los
+ * tramos expandidos se registran en BcFunction.origins un nivel más
+ * adentro que el código que los expandió (los que el llamado ya tenía
+ * expandidos quedan anidados bajo él); conservan sus líneas en
+ * BcFunction.lines. Los núcleos
+ * vectoriales del llamado se copian al llamador con las mismas ranuras
+ * desplazadas y las instrucciones vector se renumeran. Las funciones que
+ * abren un marco de memoria (enter, ver bytecode.c) no se expanden: su
+ * leave liberaría la región del llamador.
+ *
+ * inline_module_parallel() reparte las funciones entre hilos siguiendo el
+ * mismo orden de dependencias: una función se procesa cuando terminaron sus
+ * llamados de otras componentes.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/inline.h"
+#include "../../include/arena.h"
+#include "../../include/callgraph.h"
+#include "../../include/stats.h"
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Profundidad aún no calculada en el recorrido de max_stack. */
+#define INLINE_UNKNOWN_DEPTH (-1)
+
+/**
+ * @brief Código, llamadas y tramos de la función que se reescribe.
+ */
+typedef struct InlineBuffer {
+    uint8_t *code;
+    size_t length;
+    size_t capacity;
+    BcCallSite *calls;
+    size_t call_count;
+    size_t call_capacity;
+    BcOrigin *origins;
+    size_t origin_count;
+    size_t origin_capacity;
+    BcLine *lines;
+    size_t line_count;
+    size_t line_capacity;
+    BcKernel *kernels;
+    size_t kernel_count;
+    size_t kernel_capacity;
+    int out_of_memory;
+} InlineBuffer;
+
+/**
+ * @brief Inicializa los parámetros por omisión del modelo de costo.
+ */
+void inline_options_default(InlineOptions *options) {
+    options->threshold = INLINE_DEFAULT_THRESHOLD;
+    options->loop_bonus = INLINE_DEFAULT_LOOP_BONUS;
+}
+
+/**
+ * @brief Garantiza espacio para @p needed elementos de @p size bytes.
+ */
+static int reserve(void **items, size_t *capacity, size_t needed, size_t size) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    size_t grown = *capacity > 0 ? *capacity * 2 : 64;
+    while (grown < needed) {
+        grown *= 2;
+    }
+    void *larger = realloc(*items, grown * size);
+    if (larger == NULL) {
+        return 1;
+    }
+    *items = larger;
+    *capacity = grown;
+    return 0;
+}
+
+static void put_bytes(InlineBuffer *out, const uint8_t *bytes, size_t count) {
+    if (out->out_of_memory
+            || reserve((void **)&out->code, &out->capacity, out->length + count, 1) != 0) {
+        out->out_of_memory = 1;
+        return;
+    }
+    memcpy(out->code + out->length, bytes, count);
+    out->length += count;
+}
+
+static void put_op_u16(InlineBuffer *out, BcOp op, uint32_t operand) {
+    uint8_t bytes[3] = { (uint8_t)op, (uint8_t)operand, (uint8_t)(operand >> 8) };
+    put_bytes(out, bytes, sizeof(bytes));
+}
+
+static void put_op_u32(InlineBuffer *out, BcOp op, uint32_t operand) {
+    uint8_t bytes[5] = { (uint8_t)op, (uint8_t)operand, (uint8_t)(operand >> 8),
+                         (uint8_t)(operand >> 16), (uint8_t)(operand >> 24) };
+    put_bytes(out, bytes, sizeof(bytes));
+}
+
+static void write_u32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static void put_call_site(InlineBuffer *out, uint32_t pc, const BcCallSite *source) {
+    if (out->out_of_memory || reserve((void **)&out->calls, &out->call_capacity, out->call_count + 1,
+                                      sizeof(BcCallSite)) != 0) {
+        out->out_of_memory = 1;
+        return;
+    }
+    out->calls[out->call_count] = *source;
+    out->calls[out->call_count].pc = pc;
+    out->call_count++;
+}
+
+/**
+ * @brief Abre un tramo de @p function con @p depth expansiones en @p pc, fusionando los contiguos.
+ *
+ * Un tramo anterior que quedó vacío se descarta, salvo que sea menos
+ * profundo: entonces contiene al nuevo y bc_origin_chain() lo necesita.
+ */
+static void put_origin(InlineBuffer *out, uint32_t pc, uint32_t function, uint32_t depth) {
+    while (out->origin_count > 0) {
+        const BcOrigin *last = &out->origins[out->origin_count - 1];
+        if (last->function == function && last->depth == depth) {
+            return;
+        }
+        if (last->pc != pc || last->depth < depth) {
+            break;
+        }
+        out->origin_count--;
+    }
+    if (out->out_of_memory || reserve((void **)&out->origins, &out->origin_capacity,
+                                      out->origin_count + 1, sizeof(BcOrigin)) != 0) {
+        out->out_of_memory = 1;
+        return;
+    }
+    out->origins[out->origin_count].pc = pc;
+    out->origins[out->origin_count].function = function;
+    out->origins[out->origin_count].depth = depth;
+    out->origin_count++;
+}
+
+/**
+ * @brief Abre un tramo de @p line en @p pc, como put_origin().
+ */
+static void put_line(InlineBuffer *out, uint32_t pc, uint32_t line) {
+    if (out->line_count > 0) {
+        BcLine *last = &out->lines[out->line_count - 1];
+        if (last->line == line) {
+            return;
+        }
+        if (last->pc == pc) {
+            if (out->line_count > 1 && out->lines[out->line_count - 2].line == line) {
+                out->line_count--;
+            } else {
+                last->line = line;
+            }
+            return;
+        }
+    }
+    if (out->out_of_memory || reserve((void **)&out->lines, &out->line_capacity,
+                                      out->line_count + 1, sizeof(BcLine)) != 0) {
+        out->out_of_memory = 1;
+        return;
+    }
+    out->lines[out->line_count].pc = pc;
+    out->lines[out->line_count].line = line;
+    out->line_count++;
+}
+
+/**
+ * @brief Copia un núcleo con sus ranuras desplazadas y emite su instrucción vector.
+ */
+static void put_vector(InlineBuffer *out, const BcKernel *kernel, uint32_t base) {
+    if (out->out_of_memory || reserve((void **)&out->kernels, &out->kernel_capacity,
+                                      out->kernel_count + 1, sizeof(BcKernel)) != 0
+            || bc_copy_kernel(&out->kernels[out->kernel_count], kernel, base) != 0) {
+        out->out_of_memory = 1;
+        return;
+    }
+    put_op_u16(out, BC_VECTOR, (uint32_t)out->kernel_count++);
+}
+
+static void free_kernels(BcKernel *kernels, size_t count) {
+    for (size_t k = 0; k < count; k++) {
+        free(kernels[k].code);
+    }
+    free(kernels);
+}
+
+static int is_jump(BcOp op) {
+    return op == BC_JUMP || op == BC_JUMP_FALSE || op == BC_JUMP_TRUE;
+}
+
+/**
+ * @brief Bytes del cuerpo que se copia: sin el "const 0; return" final si es inalcanzable.
+ *
+ * Lo es cuando la instrucción anterior es un return y ningún salto llega a él.
+ */
+static size_t body_length(const BcFunction *function) {
+    const size_t trailer = 1 + 4 + 1;
+    if (function->length <= trailer) {
+        return function->length;
+    }
+    size_t start = function->length - trailer;
+    size_t previous = SIZE_MAX;
+    for (size_t pc = 0; pc < start;) {
+        BcOp op = (BcOp)function->code[pc];
+        if (is_jump(op) && bc_read_u32(function->code + pc + 1) == start) {
+            return function->length;
+        }
+        previous = pc;
+        pc += 1 + bc_operand_size(op);
+    }
+    int unreachable = previous != SIZE_MAX && function->code[previous] == BC_RETURN
+                   && function->code[start] == BC_CONST && bc_read_u32(function->code + start + 1) == 0;
+    return unreachable ? start : function->length;
+}
+
+/**
+ * @brief Instrucciones de los primeros @p length bytes.
+ */
+static uint32_t count_instructions(const BcFunction *function, size_t length) {
+    uint32_t count = 0;
+    for (size_t pc = 0; pc < length; count++) {
+        pc += 1 + bc_operand_size((BcOp)function->code[pc]);
+    }
+    return count;
+}
+
+/**
+ * @brief Bytes que añade expandir @p callee: su cuerpo, los store y los saltos de sus return.
+ */
+static size_t expanded_bytes(const BcFunction *callee, size_t length) {
+    size_t bytes = length + 3 * (size_t)callee->param_count;
+    for (size_t pc = 0; pc < length;) {
+        BcOp op = (BcOp)callee->code[pc];
+        pc += 1 + bc_operand_size(op);
+        if (op == BC_RETURN) {
+            bytes = pc == length ? bytes - 1 : bytes + 4;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * @brief Indica si @p at está dentro de un ciclo (entre un salto hacia atrás y su destino).
+ */
+static int inside_loop(const BcFunction *function, size_t at) {
+    for (size_t pc = at; pc < function->length;) {
+        BcOp op = (BcOp)function->code[pc];
+        if (is_jump(op) && bc_read_u32(function->code + pc + 1) <= at) {
+            return 1;
+        }
+        pc += 1 + bc_operand_size(op);
+    }
+    return 0;
+}
+
+/**
+ * @brief Desplazamiento de cada instrucción del cuerpo una vez copiado.
+ *
+ * Los return ocupan lo que el salto que los reemplaza, salvo el último, que
+ * desaparece. @p map tiene una entrada más, con el tamaño total.
+ */
+static void body_offsets(const BcFunction *function, size_t length, uint32_t *map) {
+    uint32_t offset = 0;
+    for (size_t pc = 0; pc < length;) {
+        BcOp op = (BcOp)function->code[pc];
+        size_t size = 1 + bc_operand_size(op);
+        map[pc] = offset;
+        if (op == BC_RETURN) {
+            offset += pc + size == length ? 0 : 5;
+        } else {
+            offset += (uint32_t)size;
+        }
+        pc += size;
+    }
+    map[length] = offset;
+}
+
+/**
+ * @brief Copia el cuerpo de @p callee con sus ranuras a partir de @p base.
+ *
+ * @param depth Nivel de expansión de los tramos propios de @p callee.
+ */
+static void expand_call(InlineBuffer *out, const BcFunction *callee, uint32_t base, uint32_t depth) {
+    for (uint32_t i = callee->param_count; i-- > 0;) {
+        put_op_u16(out, BC_STORE, base + i);
+    }
+    size_t length = body_length(callee);
+    uint32_t *map = (uint32_t *)malloc((length + 1) * sizeof(uint32_t));
+    if (map == NULL) {
+        out->out_of_memory = 1;
+        return;
+    }
+    body_offsets(callee, length, map);
+    uint32_t start = (uint32_t)out->length;
+    uint32_t end = start + map[length];
+
+    for (size_t i = 0; i < callee->origin_count && callee->origins[i].pc < length; i++) {
+        put_origin(out, start + map[callee->origins[i].pc], callee->origins[i].function,
+                   depth + callee->origins[i].depth);
+    }
+    for (size_t i = 0; i < callee->line_count && callee->lines[i].pc < length; i++) {
+        put_line(out, start + map[callee->lines[i].pc], callee->lines[i].line);
+    }
+    for (size_t i = 0; i < callee->call_count && callee->calls[i].pc < length; i++) {
+        put_call_site(out, start + map[callee->calls[i].pc], &callee->calls[i]);
+    }
+    for (size_t pc = 0; pc < length;) {
+        const uint8_t *code = callee->code + pc;
+        BcOp op = (BcOp)code[0];
+        size_t size = 1 + bc_operand_size(op);
+        if (op == BC_LOAD || op == BC_STORE) {
+            put_op_u16(out, op, base + bc_read_u16(code + 1));
+        } else if (is_jump(op)) {
+            put_op_u32(out, op, start + map[bc_read_u32(code + 1)]);
+        } else if (op == BC_RETURN) {
+            if (pc + size != length) {
+                put_op_u32(out, BC_JUMP, end);
+            }
+        } else if (op == BC_VECTOR) {
+            put_vector(out, &callee->kernels[bc_read_u16(code + 1)], base);
+        } else {
+            put_bytes(out, code, size);
+        }
+        pc += size;
+    }
+    free(map);
+}
+
+/**
+ * @brief Profundidad máxima de la pila de operandos, siguiendo los saltos.
+ *
+ * Cada punto del código tiene una única profundidad; el código inalcanzable
+ * no se visita.
+ *
+ * @return La profundidad, o -1 si falta memoria.
+ */
+static int64_t stack_depth(const BcModule *module, const BcFunction *function) {
+    int32_t *depth = (int32_t *)malloc((function->length + 1) * sizeof(int32_t));
+    uint32_t *pending = (uint32_t *)malloc((function->length + 1) * sizeof(uint32_t));
+    if (depth == NULL || pending == NULL) {
+        free(depth);
+        free(pending);
+        return -1;
+    }
+    for (size_t i = 0; i <= function->length; i++) {
+        depth[i] = INLINE_UNKNOWN_DEPTH;
+    }
+    size_t pending_count = 0;
+    int32_t max = 0;
+    depth[0] = 0;
+    pending[pending_count++] = 0;
+    while (pending_count > 0) {
+        size_t pc = pending[--pending_count];
+        int32_t d = depth[pc];
+        while (pc < function->length) {
+            const uint8_t *code = function->code + pc;
+            BcOp op = (BcOp)code[0];
+            switch (op) {
+                case BC_CONST:
+                case BC_LITERAL:
+                case BC_LOAD:
+                    d++;
+                    break;
+                case BC_NEG:
+                case BC_NOT:
+                case BC_JUMP:
+                case BC_RETURN:
+                case BC_VECTOR:
+                case BC_ENTER:
+                case BC_LEAVE:
+                case BC_LENGTH:
+                    break;
+                case BC_CALL:
+                    d += 1 - (int32_t)module->functions[bc_read_u16(code + 1)].param_count;
+                    break;
+                case BC_ARRAY:
+                    d += 1 - (int32_t)(bc_read_u32(code + 1) & 0xFFFF);
+                    break;
+                default:
+                    d--;
+                    break;
+            }
+            if (d > max) {
+                max = d;
+            }
+            if (is_jump(op)) {
+                uint32_t target = bc_read_u32(code + 1);
+                if (depth[target] == INLINE_UNKNOWN_DEPTH) {
+                    depth[target] = d;
+                    pending[pending_count++] = target;
+                }
+            }
+            if (op == BC_JUMP || op == BC_RETURN) {
+                break;
+            }
+            pc += 1 + bc_operand_size(op);
+            if (pc >= function->length || depth[pc] != INLINE_UNKNOWN_DEPTH) {
+                break;
+            }
+            depth[pc] = d;
+        }
+    }
+    free(depth);
+    free(pending);
+    return max;
+}
+
+/**
+ * @brief Reescribe @p caller expandiendo las llamadas marcadas en @p expand.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria (la función queda intacta).
+ */
+static int rewrite(BcModule *module, BcFunction *caller, const uint8_t *expand, uint32_t base,
+                   Arena *scratch) {
+    uint32_t *map = (uint32_t *)arena_alloc(scratch, (caller->length + 1) * sizeof(uint32_t));
+    uint32_t *jumps = (uint32_t *)arena_alloc(scratch, (caller->length + 1) * sizeof(uint32_t));
+    if (map == NULL || jumps == NULL) {
+        return 1;
+    }
+    InlineBuffer out;
+    memset(&out, 0, sizeof(out));
+    size_t jump_count = 0;
+    size_t site = 0;
+    size_t origin = 0;
+    size_t line = 0;
+    uint32_t current = 0;
+    uint32_t current_depth = 0;
+    uint32_t current_line = 0;
+    uint32_t slot_count = caller->slot_count;
+
+    for (size_t pc = 0; pc < caller->length;) {
+        while (origin < caller->origin_count && caller->origins[origin].pc <= pc) {
+            current = caller->origins[origin].function;
+            current_depth = caller->origins[origin++].depth;
+            put_origin(&out, (uint32_t)out.length, current, current_depth);
+        }
+        while (line < caller->line_count && caller->lines[line].pc <= pc) {
+            current_line = caller->lines[line++].line;
+            put_line(&out, (uint32_t)out.length, current_line);
+        }
+        map[pc] = (uint32_t)out.length;
+        const uint8_t *code = caller->code + pc;
+        BcOp op = (BcOp)code[0];
+        size_t size = 1 + bc_operand_size(op);
+        int is_site = op == BC_CALL && site < caller->call_count && caller->calls[site].pc == pc;
+        if (is_site && expand[site]) {
+            const BcFunction *callee = &module->functions[bc_read_u16(code + 1)];
+            expand_call(&out, callee, base, current_depth + 1);
+            put_origin(&out, (uint32_t)out.length, current, current_depth);
+            put_line(&out, (uint32_t)out.length, current_line);
+            if (base + callee->slot_count > slot_count) {
+                slot_count = base + callee->slot_count;
+            }
+        } else {
+            if (is_site) {
+                put_call_site(&out, (uint32_t)out.length, &caller->calls[site]);
+            }
+            if (is_jump(op)) {
+                jumps[jump_count++] = (uint32_t)out.length + 1;
+            }
+            if (op == BC_VECTOR) {
+                put_vector(&out, &caller->kernels[bc_read_u16(code + 1)], 0);
+            } else {
+                put_bytes(&out, code, size);
+            }
+        }
+        site += is_site;
+        pc += size;
+    }
+    map[caller->length] = (uint32_t)out.length;
+
+    int failed = out.out_of_memory;
+    if (!failed) {
+        for (size_t i = 0; i < jump_count; i++) {
+            write_u32(out.code + jumps[i], map[bc_read_u32(out.code + jumps[i])]);
+        }
+        free(caller->code);
+        free(caller->calls);
+        free(caller->origins);
+        free(caller->lines);
+        free_kernels(caller->kernels, caller->kernel_count);
+        caller->code = out.code;
+        caller->length = out.length;
+        caller->calls = out.calls;
+        caller->call_count = out.call_count;
+        caller->origins = out.origins;
+        caller->origin_count = out.origin_count;
+        caller->lines = out.lines;
+        caller->line_count = out.line_count;
+        caller->kernels = out.kernels;
+        caller->kernel_count = out.kernel_count;
+        caller->slot_count = slot_count;
+        int64_t max_stack = stack_depth(module, caller);
+        failed = max_stack < 0;
+        caller->max_stack = failed ? caller->max_stack : (uint32_t)max_stack;
+    } else {
+        free(out.code);
+        free(out.calls);
+        free(out.origins);
+        free(out.lines);
+        free_kernels(out.kernels, out.kernel_count);
+    }
+    return failed;
+}
+
+static int add_site(InlineReport *report, const InlineSite *site) {
+    if (reserve((void **)&report->sites, &report->capacity, report->count + 1, sizeof(InlineSite)) != 0) {
+        return 1;
+    }
+    report->sites[report->count++] = *site;
+    return 0;
+}
+
+/**
+ * @brief Decide qué llamadas de @p caller se expanden y reescribe la función.
+ *
+ * Solo lee las funciones de otras componentes, así que puede procesarse a la
+ * vez que cualquier otra cuyos llamados fuera de su componente ya terminaron.
+ *
+ * @param scratch Memoria temporal (se reinicia al terminar).
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int inline_function(BcModule *module, const CallGraph *graph, uint32_t index,
+                           const InlineOptions *options, InlineReport *report, Arena *scratch) {
+    BcFunction *caller = &module->functions[index];
+    if (caller->call_count == 0) {
+        return 0;
+    }
+    uint8_t *expand = (uint8_t *)arena_alloc(scratch, caller->call_count);
+    if (expand == NULL) {
+        return 1;
+    }
+    memset(expand, 0, caller->call_count);
+    uint32_t base = caller->slot_count;
+    size_t length = caller->length;
+    int any = 0;
+    int failed = 0;
+    for (size_t i = 0; i < caller->call_count && !failed; i++) {
+        const BcCallSite *call = &caller->calls[i];
+        uint32_t target = bc_read_u16(caller->code + call->pc + 1);
+        const BcFunction *callee = &module->functions[target];
+        report->considered++;
+        if (graph->recursive[target] || graph->component[target] == graph->component[index]) {
+            report->recursive++;
+            continue;
+        }
+        if (callee->length > 0 && callee->code[0] == BC_ENTER) {
+            continue;
+        }
+        size_t body = body_length(callee);
+        int64_t growth = (int64_t)count_instructions(callee, body) + callee->param_count - 1;
+        uint32_t cost = growth > 0 ? (uint32_t)growth : 0;
+        int in_loop = inside_loop(caller, call->pc);
+        uint32_t limit = options->threshold + (in_loop ? options->loop_bonus : 0);
+        // Cota del marco: la pila del llamador más la del llamado, sobre ambas regiones de ranuras.
+        uint32_t frame = base + callee->slot_count + caller->max_stack + callee->max_stack;
+        size_t bytes = expanded_bytes(callee, body);
+        if (cost > limit || frame > BC_MAX_FRAME_SLOTS || length + bytes > INLINE_MAX_FUNCTION_BYTES) {
+            continue;
+        }
+        expand[i] = 1;
+        length += bytes;
+        any = 1;
+        InlineSite site = { index, target, call->line, call->column, cost, limit, in_loop };
+        failed = add_site(report, &site);
+    }
+    if (any && !failed) {
+        failed = rewrite(module, caller, expand, base, scratch);
+    }
+    arena_reset(scratch);
+    return failed;
+}
+
+static int compare_sites(const void *a, const void *b) {
+    const InlineSite *x = (const InlineSite *)a;
+    const InlineSite *y = (const InlineSite *)b;
+    if (x->line != y->line) {
+        return x->line < y->line ? -1 : 1;
+    }
+    if (x->column != y->column) {
+        return x->column < y->column ? -1 : 1;
+    }
+    return x->caller < y->caller ? -1 : x->caller > y->caller;
+}
+
+/* ---- Expansión en paralelo ---- */
+
+/**
+ * @brief Trabajo compartido por los hilos de la expansión.
+ *
+ * Una función queda lista cuando terminaron todos sus llamados de otras
+ * componentes; las de una misma componente no se expanden entre sí, así que
+ * pueden procesarse a la vez.
+ */
+typedef struct InlineParallel {
+    BcModule *module;
+    const CallGraph *graph;
+    const InlineOptions *options;
+    size_t *caller_start;       /**< Llamadores de f desde otra componente: callers[caller_start[f] .. caller_start[f + 1]) */
+    uint32_t *callers;
+    uint32_t *pending;          /**< Llamados de otra componente aún sin procesar */
+    uint32_t *ready;            /**< Cola de funciones listas */
+    size_t ready_head;
+    size_t ready_tail;
+    size_t done;                /**< Funciones procesadas */
+    int failed;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+} InlineParallel;
+
+/**
+ * @brief Hilo de la expansión, con su propio reporte.
+ */
+typedef struct InlineWorker {
+    InlineParallel *shared;
+    InlineReport report;
+} InlineWorker;
+
+/**
+ * @brief Hilos a usar: @p requested, o los núcleos disponibles si es 0.
+ */
+static size_t inline_thread_count(int requested, size_t function_count) {
+    long n = requested > 0 ? requested : sysconf(_SC_NPROCESSORS_ONLN);
+    size_t threads = n > 1 ? (size_t)n : 1;
+    return threads < function_count ? threads : function_count;
+}
+
+/**
+ * @brief Arma los llamadores de cada función y la cola inicial.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int schedule_build(InlineParallel *shared) {
+    const CallGraph *graph = shared->graph;
+    size_t count = graph->function_count;
+    shared->caller_start = (size_t *)calloc(count + 1, sizeof(size_t));
+    shared->callers = (uint32_t *)malloc((graph->edge_start[count] > 0 ? graph->edge_start[count] : 1)
+                                         * sizeof(uint32_t));
+    shared->pending = (uint32_t *)calloc(count > 0 ? count : 1, sizeof(uint32_t));
+    shared->ready = (uint32_t *)malloc((count > 0 ? count : 1) * sizeof(uint32_t));
+    if (shared->caller_start == NULL || shared->callers == NULL || shared->pending == NULL
+            || shared->ready == NULL) {
+        return 1;
+    }
+    for (size_t f = 0; f < count; f++) {
+        for (size_t e = graph->edge_start[f]; e < graph->edge_start[f + 1]; e++) {
+            uint32_t callee = graph->callees[e];
+            if (graph->component[callee] != graph->component[f]) {
+                shared->caller_start[callee + 1]++;
+                shared->pending[f]++;
+            }
+        }
+    }
+    for (size_t f = 0; f < count; f++) {
+        shared->caller_start[f + 1] += shared->caller_start[f];
+    }
+    for (size_t f = 0; f < count; f++) {
+        for (size_t e = graph->edge_start[f]; e < graph->edge_start[f + 1]; e++) {
+            uint32_t callee = graph->callees[e];
+            if (graph->component[callee] != graph->component[f]) {
+                shared->callers[shared->caller_start[callee]++] = (uint32_t)f;
+            }
+        }
+    }
+    for (size_t f = count; f > 0; f--) {
+        shared->caller_start[f] = shared->caller_start[f - 1];
+    }
+    shared->caller_start[0] = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (shared->pending[graph->order[i]] == 0) {
+            shared->ready[shared->ready_tail++] = graph->order[i];
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Procesa funciones listas hasta que no quede ninguna.
+ */
+static void *inline_worker(void *arg) {
+    InlineWorker *worker = (InlineWorker *)arg;
+    InlineParallel *shared = worker->shared;
+    size_t count = shared->graph->function_count;
+    Arena scratch;
+    arena_init(&scratch, 0);
+    pthread_mutex_lock(&shared->lock);
+    for (;;) {
+        while (!shared->failed && shared->ready_head == shared->ready_tail && shared->done < count) {
+            pthread_cond_wait(&shared->wake, &shared->lock);
+        }
+        if (shared->failed || shared->ready_head == shared->ready_tail) {
+            break;
+        }
+        uint32_t f = shared->ready[shared->ready_head++];
+        pthread_mutex_unlock(&shared->lock);
+        int failed = inline_function(shared->module, shared->graph, f, shared->options, &worker->report,
+                                     &scratch);
+        pthread_mutex_lock(&shared->lock);
+        shared->failed |= failed;
+        shared->done++;
+        size_t woken = 0;
+        for (size_t e = shared->caller_start[f]; e < shared->caller_start[f + 1]; e++) {
+            uint32_t caller = shared->callers[e];
+            if (--shared->pending[caller] == 0) {
+                shared->ready[shared->ready_tail++] = caller;
+                woken++;
+            }
+        }
+        // Este hilo toma la siguiente; solo hace falta despertar a otro si sobran.
+        if (shared->failed || shared->done == count || woken > 1) {
+            pthread_cond_broadcast(&shared->wake);
+        }
+    }
+    pthread_mutex_unlock(&shared->lock);
+    arena_free(&scratch);
+    return NULL;
+}
+
+/**
+ * @brief Junta en @p report los reportes de los hilos.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int merge_reports(InlineReport *report, const InlineWorker *workers, size_t threads) {
+    size_t total = 0;
+    for (size_t t = 0; t < threads; t++) {
+        total += workers[t].report.count;
+    }
+    if (reserve((void **)&report->sites, &report->capacity, total, sizeof(InlineSite)) != 0) {
+        return 1;
+    }
+    for (size_t t = 0; t < threads; t++) {
+        const InlineReport *part = &workers[t].report;
+        if (part->count > 0) {
+            memcpy(report->sites + report->count, part->sites, part->count * sizeof(InlineSite));
+        }
+        report->count += part->count;
+        report->considered += part->considered;
+        report->recursive += part->recursive;
+    }
+    return 0;
+}
+
+/**
+ * @brief Procesa las funciones del grafo con @p threads hilos (incluido el actual).
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int inline_parallel(BcModule *module, const CallGraph *graph, const InlineOptions *options,
+                           size_t threads, InlineReport *report) {
+    InlineParallel shared;
+    memset(&shared, 0, sizeof(shared));
+    shared.module = module;
+    shared.graph = graph;
+    shared.options = options;
+    InlineWorker *workers = (InlineWorker *)calloc(threads, sizeof(InlineWorker));
+    pthread_t *ids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    int failed = workers == NULL || ids == NULL || schedule_build(&shared) != 0;
+    pthread_mutex_init(&shared.lock, NULL);
+    pthread_cond_init(&shared.wake, NULL);
+
+    size_t started = 0;
+    for (size_t t = 0; !failed && t < threads; t++) {
+        workers[t].shared = &shared;
+    }
+    for (size_t t = 1; !failed && t < threads; t++) {
+        if (pthread_create(&ids[t], NULL, inline_worker, &workers[t]) != 0) {
+            break;
+        }
+        started = t;
+    }
+    if (!failed) {
+        inline_worker(&workers[0]);
+    }
+    for (size_t t = 1; t <= started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    failed |= shared.failed;
+    if (workers != NULL) {
+        failed |= merge_reports(report, workers, threads);
+        for (size_t t = 0; t < threads; t++) {
+            inline_report_free(&workers[t].report);
+        }
+    }
+    pthread_cond_destroy(&shared.wake);
+    pthread_mutex_destroy(&shared.lock);
+    free(shared.caller_start);
+    free(shared.callers);
+    free(shared.pending);
+    free(shared.ready);
+    free(workers);
+    free(ids);
+    return failed;
+}
+
+/**
+ * @brief Expande en línea las llamadas que el modelo de costo acepta.
+ *
+ * @param module Programa traducido; sus funciones se reescriben en su lugar.
+ * @param options Umbrales del modelo de costo.
+ * @param report Llamadas expandidas; liberar con inline_report_free() aunque falle.
+ * @return 0 si es exitoso, 1 si falta memoria (el módulo sigue siendo válido).
+ */
+int inline_module(BcModule *module, const InlineOptions *options, InlineReport *report) {
+    return inline_module_parallel(module, options, 1, report);
+}
+
+/**
+ * @brief Como inline_module(), pero reparte las funciones entre @p threads hilos.
+ *
+ * Cada hilo toma las funciones cuyos llamados ya se procesaron, con su
+ * propia memoria temporal y su propio reporte; el módulo y el reporte (que
+ * se ordena por posición) son idénticos con cualquier número de hilos.
+ *
+ * @param threads Hilos a usar, o 0 para usar los núcleos disponibles.
+ */
+int inline_module_parallel(BcModule *module, const InlineOptions *options, int threads,
+                           InlineReport *report) {
+    uint64_t start = stats_clock();
+    memset(report, 0, sizeof(*report));
+    CallGraph graph;
+    int failed = callgraph_build(module, &graph);
+    size_t workers = inline_thread_count(threads, graph.function_count);
+    if (!failed && workers > 1) {
+        failed = inline_parallel(module, &graph, options, workers, report);
+    } else {
+        Arena scratch;
+        arena_init(&scratch, 0);
+        for (size_t i = 0; i < graph.function_count && !failed; i++) {
+            failed = inline_function(module, &graph, graph.order[i], options, report, &scratch);
+        }
+        arena_free(&scratch);
+    }
+    callgraph_free(&graph);
+    if (report->count > 1) {
+        qsort(report->sites, report->count, sizeof(InlineSite), compare_sites);
+    }
+    stats_phase_add(STATS_CODEGEN, stats_clock() - start);
+    return failed;
+}
+
+/**
+ * @brief Escribe las llamadas expandidas, una por línea, y un resumen.
+ */
+void inline_report_print(const InlineReport *report, const BcModule *module, const char *path,
+                         FILE *out) {
+    for (size_t i = 0; i < report->count; i++) {
+        const InlineSite *site = &report->sites[i];
+        const BcFunction *caller = &module->functions[site->caller];
+        const BcFunction *callee = &module->functions[site->callee];
+        fprintf(out, "%s:%u:%u: se expandió '%.*s' en '%.*s' (costo %u, límite %u%s)\n", path,
+                site->line, site->column, (int)callee->name_length, callee->name,
+                (int)caller->name_length, caller->name, site->cost, site->limit,
+                site->in_loop ? ", dentro de un ciclo" : "");
+    }
+    fprintf(out, "Expansión en línea: %zu de %zu llamadas (%zu a funciones recursivas)\n",
+            report->count, report->considered, report->recursive);
+}
+
+/**
+ * @brief Libera un reporte de inline_module().
+ */
+void inline_report_free(InlineReport *report) {
+    free(report->sites);
+    memset(report, 0, sizeof(*report));
+}
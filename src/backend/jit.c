@@ -0,0 +1,1335 @@
+/**
+ * @file jit.c
+ * @brief Traducción de bytecode a x86-64 con compilación perezosa.
+ *
+ * Convenciones del código generado:
+ *
+ * - La pila de operandos es la pila nativa: cada valor ocupa 8 bytes y solo
+ *   se usan sus 32 bits bajos.
+ * - r15 apunta al JitRuntime de la ejecución; las llamadas entre funciones
+ *   saltan a través de su tabla (call [r15 + tabla + 8 * i]), de modo que el
+ *   código no contiene direcciones de la ejecución y puede reutilizarse.
+ * - Los argumentos quedan en la pila del llamador; el llamado los descarta
+ *   con ret imm16 y devuelve su valor en eax, que el llamador apila.
+ * - Ranura i < n (parámetros): [rbp + 16 + 8 * (n - 1 - i)]; el resto,
+ *   [rbp - 8 * (i - n + 1)].
+ * - Antes de llamar a C (print(), errores, compilación perezosa) la pila se
+ *   alinea a 16 guardando rsp en rbx, y el retorno y el rbp del código
+ *   generado se anotan en el JitRuntime (native_pc, native_fp) para que el
+ *   perfil por muestreo pueda seguir la pila desde C.
+ *
+ * Los errores de ejecución llaman a jit_fail(), que vuelve a jit_run() con
+ * longjmp; la profundidad de llamadas se cuenta en el JitRuntime con el
+ * mismo límite que la máquina virtual. Las instrucciones sobre String y
+ * Array llaman a runtime.c con el RtHeap del JitRuntime.
+ *
+ * Los núcleos vectoriales (BC_VECTOR) usan AVX2 (8 carriles) si el
+ * procesador lo tiene y el módulo no pide BC_SIMD_SSE2, o SSE2 (4 carriles):
+ * xmm0-7 son la pila de la expresión, xmm8-9 temporales, xmm10-13 los
+ * acumuladores, xmm14 el paso y xmm15 los valores de la variable del ciclo.
+ */
+#define _GNU_SOURCE
+
+#include "../../include/jit.h"
+
+#if defined(__x86_64__) && defined(__linux__)
+
+#include "../../include/hash.h"
+#include "../../include/stats.h"
+#include "../../include/vectorize.h"
+#include <pthread.h>
+#include <setjmp.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+/** Pila nativa de una ejecución (reservada sin respaldo; RUN_MAX_DEPTH marcos caben). */
+#define JIT_STACK_BYTES (32u << 20)
+/** Límite de páginas de código de la caché del proceso. */
+#define JIT_CACHE_MAX_BYTES ((size_t)256 << 20)
+#define JIT_CACHE_BUCKETS 1024
+/** Stubs perezosos por bloque de páginas y bytes de cada uno. */
+#define JIT_STUBS_PER_BLOCK 256
+#define JIT_STUB_SIZE 32
+#define JIT_MAX_FUNCTIONS 65536
+
+/** Destinos especiales de las correcciones de saltos. */
+#define JIT_TARGET_DIVISION_BY_ZERO UINT32_MAX
+#define JIT_TARGET_STACK_OVERFLOW (UINT32_MAX - 1)
+
+/** Conjunto de instrucciones de los núcleos vectoriales. */
+#define JIT_SIMD_SSE2 0
+#define JIT_SIMD_AVX2 1
+
+/** Registros de los núcleos (ver el encabezado). */
+#define JIT_XMM_TEMP 8
+#define JIT_XMM_ACC 10
+#define JIT_XMM_STEP 14
+#define JIT_XMM_INDEX 15
+/** Operando [rsp] en lugar de un registro xmm. */
+#define JIT_XMM_SCRATCH 0xFF
+
+/**
+ * @brief Estado de una ejecución, accesible desde el código por r15.
+ */
+typedef struct JitRuntime {
+    int32_t depth;              /**< Llamadas anidadas en curso */
+    int simd;                   /**< JIT_SIMD_* de los núcleos */
+    const BcModule *module;
+    FILE *out;
+    RunResult *result;
+    jmp_buf escape;             /**< Retorno a jit_run() tras un error */
+    RtHeap heap;                /**< String y Array de la ejecución */
+    uintptr_t native_pc;        /**< Durante una llamada a C, su retorno en el código generado (0 si no) */
+    uintptr_t native_fp;        /**< Durante una llamada a C, el rbp del código generado */
+    uintptr_t stack_low;        /**< Pila propia de la ejecución */
+    uintptr_t stack_high;
+    void *table[];              /**< Entrada de cada función (stub o código) */
+} JitRuntime;
+
+/**
+ * @brief Inicio en el código generado de una instrucción del bytecode.
+ */
+typedef struct JitPc {
+    uint32_t native;            /**< Desplazamiento en el código */
+    uint32_t pc;
+} JitPc;
+
+/**
+ * @brief Función traducida guardada en la caché.
+ *
+ * Se guarda una copia del bytecode para que una colisión del hash no
+ * devuelva código ajeno, y el inicio de cada instrucción para traducir
+ * las direcciones de las muestras de --prof.
+ */
+typedef struct JitEntry {
+    struct JitEntry *next;
+    uint64_t key;
+    uint32_t index;
+    uint32_t param_count;
+    uint32_t slot_count;
+    int simd;
+    uint64_t kernels;           /**< Hash de los núcleos vectoriales */
+    size_t length;
+    uint8_t *bytecode;
+    void *code;
+    size_t code_length;
+    JitPc *pcs;                 /**< Por desplazamiento creciente */
+    size_t pc_count;
+} JitEntry;
+
+/**
+ * @brief Caché de código del proceso (protegida por lock).
+ */
+static struct {
+    pthread_mutex_t lock;
+    JitEntry *buckets[JIT_CACHE_BUCKETS];
+    uint8_t *stub_blocks[JIT_MAX_FUNCTIONS / JIT_STUBS_PER_BLOCK];
+    void *lazy_entry;           /**< Trampolín de compilación perezosa */
+    void *enter;                /**< Trampolín de entrada desde C */
+    size_t code_bytes;          /**< Páginas de código reservadas */
+} jit_cache = { PTHREAD_MUTEX_INITIALIZER, { NULL }, { NULL }, NULL, NULL, 0 };
+
+typedef int32_t (*JitEnter)(JitRuntime *rt, void *entry, void *stack_top);
+
+/* ---- Emisión de código ---- */
+
+/**
+ * @brief Código en construcción.
+ */
+typedef struct JitBuffer {
+    uint8_t *data;
+    size_t length;
+    size_t capacity;
+    int failed;
+} JitBuffer;
+
+static void put(JitBuffer *buffer, const uint8_t *bytes, size_t count) {
+    if (buffer->length + count > buffer->capacity) {
+        size_t grown = buffer->capacity > 0 ? buffer->capacity * 2 : 1024;
+        while (grown < buffer->length + count) {
+            grown *= 2;
+        }
+        uint8_t *larger = (uint8_t *)realloc(buffer->data, grown);
+        if (larger == NULL) {
+            buffer->failed = 1;
+            return;
+        }
+        buffer->data = larger;
+        buffer->capacity = grown;
+    }
+    memcpy(buffer->data + buffer->length, bytes, count);
+    buffer->length += count;
+}
+
+/** Emite los bytes literales indicados. */
+#define EMIT(buffer, ...) \
+    put((buffer), (const uint8_t[]){ __VA_ARGS__ }, sizeof((const uint8_t[]){ __VA_ARGS__ }))
+
+static void put_u16(JitBuffer *buffer, uint32_t value) {
+    EMIT(buffer, (uint8_t)value, (uint8_t)(value >> 8));
+}
+
+static void put_u32(JitBuffer *buffer, uint32_t value) {
+    EMIT(buffer, (uint8_t)value, (uint8_t)(value >> 8), (uint8_t)(value >> 16), (uint8_t)(value >> 24));
+}
+
+static void put_u64(JitBuffer *buffer, uint64_t value) {
+    put_u32(buffer, (uint32_t)value);
+    put_u32(buffer, (uint32_t)(value >> 32));
+}
+
+static void patch_u32(JitBuffer *buffer, size_t at, uint32_t value) {
+    if (!buffer->failed) {
+        memcpy(buffer->data + at, &value, sizeof(value));
+    }
+}
+
+/**
+ * @brief Instrucción con operando de memoria [rbp + disp].
+ */
+static void put_rbp_operand(JitBuffer *buffer, uint8_t opcode, uint8_t reg, int32_t disp) {
+    if (disp >= -128 && disp <= 127) {
+        EMIT(buffer, opcode, (uint8_t)(0x45 | (reg << 3)), (uint8_t)disp);
+    } else {
+        EMIT(buffer, opcode, (uint8_t)(0x85 | (reg << 3)));
+        put_u32(buffer, (uint32_t)disp);
+    }
+}
+
+/**
+ * @brief mov rax, imm64 ; call rax con la pila alineada a 16 (rsp guardado en rbx).
+ *
+ * Mientras dura la llamada, native_pc y native_fp del JitRuntime apuntan a
+ * su retorno y al marco del código generado.
+ */
+static void put_c_call(JitBuffer *buffer, const void *function) {
+    const uint32_t native_pc = (uint32_t)offsetof(JitRuntime, native_pc);
+    const uint32_t native_fp = (uint32_t)offsetof(JitRuntime, native_fp);
+    EMIT(buffer, 0x4C, 0x89, 0xFF);                 /* mov rdi, r15 */
+    EMIT(buffer, 0x49, 0x89, 0xAF);                 /* mov [r15 + native_fp], rbp */
+    put_u32(buffer, native_fp);
+    EMIT(buffer, 0x48, 0x8D, 0x05);                 /* lea rax, [rip + 26] (el retorno de call rax) */
+    put_u32(buffer, 26);
+    EMIT(buffer, 0x49, 0x89, 0x87);                 /* mov [r15 + native_pc], rax */
+    put_u32(buffer, native_pc);
+    EMIT(buffer, 0x48, 0x89, 0xE3);                 /* mov rbx, rsp */
+    EMIT(buffer, 0x48, 0x83, 0xE4, 0xF0);           /* and rsp, -16 */
+    EMIT(buffer, 0x48, 0xB8);                       /* mov rax, imm64 */
+    put_u64(buffer, (uint64_t)(uintptr_t)function);
+    EMIT(buffer, 0xFF, 0xD0);                       /* call rax */
+    EMIT(buffer, 0x48, 0x89, 0xDC);                 /* mov rsp, rbx */
+    EMIT(buffer, 0x49, 0xC7, 0x87);                 /* mov qword [r15 + native_pc], 0 */
+    put_u32(buffer, native_pc);
+    put_u32(buffer, 0);
+}
+
+/* ---- Funciones llamadas desde el código generado ---- */
+
+static void jit_fail(JitRuntime *rt, int32_t status, uint32_t index) __attribute__((noreturn));
+
+static void jit_fail(JitRuntime *rt, int32_t status, uint32_t index) {
+    rt->result->status = (RunStatus)status;
+    rt->result->function = index;
+    longjmp(rt->escape, 1);
+}
+
+/**
+ * @brief División entre cero en la instrucción @p pc de la función @p index.
+ *
+ * La función reportada es la de origen del código (bc_origin()), que se busca
+ * aquí y no al traducir para que el código en caché no dependa de ella.
+ */
+static void jit_fail_division(JitRuntime *rt, uint32_t index, uint32_t pc) __attribute__((noreturn));
+
+static void jit_fail_division(JitRuntime *rt, uint32_t index, uint32_t pc) {
+    jit_fail(rt, RUN_DIVISION_BY_ZERO, bc_origin(&rt->module->functions[index], pc));
+}
+
+static void jit_print(JitRuntime *rt, int32_t value, int32_t type) {
+    run_print_value(rt->out, &rt->heap, value, (AstType)type);
+}
+
+static void jit_heap_enter(JitRuntime *rt, uint32_t index) {
+    if (rt_enter(&rt->heap) != 0) {
+        jit_fail(rt, RUN_OUT_OF_MEMORY, index);
+    }
+}
+
+static void jit_heap_leave(JitRuntime *rt, uint32_t value, uint32_t is_reference) {
+    rt_leave(&rt->heap, value, (int)is_reference);
+}
+
+static uint32_t jit_concat(JitRuntime *rt, uint32_t a, uint32_t b, uint32_t flags, uint32_t index) {
+    RtRef result;
+    if (rt_concat(&rt->heap, a, b, flags, &result) != 0) {
+        jit_fail(rt, RUN_OUT_OF_MEMORY, index);
+    }
+    return result;
+}
+
+/**
+ * @brief Crea un Array con los n valores de la pila nativa (el último en @p values[0]).
+ */
+static uint32_t jit_array(JitRuntime *rt, const uint64_t *values, uint32_t operand, uint32_t index) {
+    uint32_t count = operand & 0xFFFF;
+    RtRef result;
+    RtObject *object;
+    if (rt_alloc(&rt->heap, count, operand >> 16, &result, &object) != 0) {
+        jit_fail(rt, RUN_OUT_OF_MEMORY, index);
+    }
+    int32_t *data = (int32_t *)rt_data(object);
+    for (uint32_t i = 0; i < count; i++) {
+        data[i] = (int32_t)(uint32_t)values[count - 1 - i];
+    }
+    return result;
+}
+
+static int32_t jit_index(JitRuntime *rt, uint32_t ref, int32_t i, uint32_t flags, uint32_t index,
+                         uint32_t pc) {
+    int32_t value;
+    if (rt_index(&rt->heap, ref, i, flags, &value) != 0) {
+        jit_fail(rt, RUN_INDEX_OUT_OF_RANGE, bc_origin(&rt->module->functions[index], pc));
+    }
+    return value;
+}
+
+static uint32_t jit_length(JitRuntime *rt, uint32_t ref) {
+    return rt_object(&rt->heap, ref)->length;
+}
+
+static int32_t jit_equal(JitRuntime *rt, uint32_t a, uint32_t b, uint32_t flags) {
+    return rt_equal(&rt->heap, a, b, flags);
+}
+
+static void *jit_compile(const BcFunction *function, uint32_t index, int simd);
+
+/**
+ * @brief Compila la función @p index en su primera llamada y reemplaza su stub.
+ */
+static void *jit_resolve(JitRuntime *rt, uint32_t index) {
+    uint64_t start = stats_clock();
+    void *code = jit_compile(&rt->module->functions[index], index, rt->simd);
+    stats_phase_add(STATS_CODEGEN, stats_clock() - start);
+    if (code == NULL) {
+        jit_fail(rt, RUN_OUT_OF_MEMORY, index);
+    }
+    rt->table[index] = code;
+    return code;
+}
+
+/* ---- Traducción ---- */
+
+/**
+ * @brief Salto cuyo desplazamiento se conoce al final.
+ */
+typedef struct JitFixup {
+    uint32_t at;            /**< Posición del rel32 */
+    uint32_t target;        /**< Desplazamiento en el bytecode, o JIT_TARGET_* */
+    uint32_t pc;            /**< Instrucción que salta (para los errores) */
+} JitFixup;
+
+/**
+ * @brief Desplazamiento de la ranura @p slot respecto de rbp.
+ */
+static int32_t slot_offset(const BcFunction *function, uint32_t slot) {
+    uint32_t n = function->param_count;
+    return slot < n ? (int32_t)(16 + 8 * (n - 1 - slot)) : -(int32_t)(8 * (slot - n + 1));
+}
+
+/**
+ * @brief Emite un salto de 32 bits (E9 o 0F 8x) hacia @p target.
+ */
+static void put_jump(JitBuffer *buffer, JitFixup *fixups, size_t *fixup_count, uint8_t condition,
+                     uint32_t target, uint32_t pc) {
+    if (condition == 0) {
+        EMIT(buffer, 0xE9);
+    } else {
+        EMIT(buffer, 0x0F, condition);
+    }
+    fixups[*fixup_count].at = (uint32_t)buffer->length;
+    fixups[*fixup_count].target = target;
+    fixups[*fixup_count].pc = pc;
+    (*fixup_count)++;
+    put_u32(buffer, 0);
+}
+
+/**
+ * @brief Salida de error: jit_fail(rt, status, index).
+ */
+static void put_fail_stub(JitBuffer *buffer, int32_t status, uint32_t index) {
+    EMIT(buffer, 0xBE);                             /* mov esi, status */
+    put_u32(buffer, (uint32_t)status);
+    EMIT(buffer, 0xBA);                             /* mov edx, index */
+    put_u32(buffer, index);
+    put_c_call(buffer, (const void *)jit_fail);
+}
+
+/* ---- Núcleos vectoriales ---- */
+
+/**
+ * @brief ModR/M (y SIB) de un operando xmm: registro o [rsp].
+ */
+static void put_xmm_operand(JitBuffer *buffer, uint8_t reg, uint8_t rm) {
+    if (rm == JIT_XMM_SCRATCH) {
+        EMIT(buffer, (uint8_t)(0x04 | (reg & 7) << 3), 0x24);
+    } else {
+        EMIT(buffer, (uint8_t)(0xC0 | (reg & 7) << 3 | (rm & 7)));
+    }
+}
+
+/**
+ * @brief Instrucción SSE: prefijo, REX si hace falta, 0F opcode y operandos.
+ */
+static void put_sse(JitBuffer *buffer, uint8_t prefix, uint8_t opcode, uint8_t reg, uint8_t rm) {
+    uint8_t rex = (uint8_t)((reg & 8) >> 1 | (rm != JIT_XMM_SCRATCH ? (rm & 8) >> 3 : 0));
+    EMIT(buffer, prefix);
+    if (rex != 0) {
+        EMIT(buffer, (uint8_t)(0x40 | rex));
+    }
+    EMIT(buffer, 0x0F, opcode);
+    put_xmm_operand(buffer, reg, rm);
+}
+
+/**
+ * @brief Instrucción AVX de 256 bits con prefijo VEX de tres bytes.
+ *
+ * @param pp 1 para 66, 2 para F3.
+ * @param map 1 para 0F, 2 para 0F38.
+ * @param src Primer operando fuente (vvvv), o 0 si no tiene.
+ */
+static void put_avx(JitBuffer *buffer, uint8_t pp, uint8_t map, uint8_t opcode, uint8_t reg,
+                    uint8_t src, uint8_t rm) {
+    uint8_t b = rm != JIT_XMM_SCRATCH && (rm & 8) ? 0 : 0x20;
+    EMIT(buffer, 0xC4, (uint8_t)((reg & 8 ? 0 : 0x80) | 0x40 | b | map),
+         (uint8_t)((~src & 15) << 3 | 0x04 | pp), opcode);
+    put_xmm_operand(buffer, reg, rm);
+}
+
+/**
+ * @brief reg = reg (op) rm con una instrucción entera empaquetada de 66 0F.
+ */
+static void put_packed(JitBuffer *buffer, int simd, uint8_t opcode, uint8_t reg, uint8_t rm) {
+    if (simd == JIT_SIMD_AVX2) {
+        put_avx(buffer, 1, 1, opcode, reg, reg, rm);
+    } else {
+        put_sse(buffer, 0x66, opcode, reg, rm);
+    }
+}
+
+/**
+ * @brief Copia un vector entre registros.
+ */
+static void put_move(JitBuffer *buffer, int simd, uint8_t reg, uint8_t rm) {
+    if (simd == JIT_SIMD_AVX2) {
+        put_avx(buffer, 1, 1, 0x6F, reg, 0, rm);    /* vmovdqa */
+    } else {
+        put_sse(buffer, 0x66, 0x6F, reg, rm);       /* movdqa */
+    }
+}
+
+/**
+ * @brief Replica en todos los carriles de @p reg el entero de [rsp].
+ */
+static void put_broadcast(JitBuffer *buffer, int simd, uint8_t reg) {
+    if (simd == JIT_SIMD_AVX2) {
+        put_avx(buffer, 1, 2, 0x58, reg, 0, JIT_XMM_SCRATCH);  /* vpbroadcastd */
+    } else {
+        put_sse(buffer, 0x66, 0x6E, reg, JIT_XMM_SCRATCH);     /* movd */
+        put_sse(buffer, 0x66, 0x70, reg, reg);                  /* pshufd reg, reg, 0 */
+        EMIT(buffer, 0x00);
+    }
+}
+
+/**
+ * @brief Replica la constante @p value en @p reg.
+ */
+static void put_splat(JitBuffer *buffer, int simd, uint8_t reg, int32_t value) {
+    EMIT(buffer, 0xC7, 0x04, 0x24);                 /* mov dword [rsp], value */
+    put_u32(buffer, (uint32_t)value);
+    put_broadcast(buffer, simd, reg);
+}
+
+/**
+ * @brief reg *= rm, carril por carril (SSE2 no tiene pmulld: dos pmuludq).
+ */
+static void put_multiply(JitBuffer *buffer, int simd, uint8_t reg, uint8_t rm) {
+    if (simd == JIT_SIMD_AVX2) {
+        put_avx(buffer, 1, 2, 0x40, reg, reg, rm);  /* vpmulld */
+        return;
+    }
+    const uint8_t odd = JIT_XMM_TEMP;
+    const uint8_t other = JIT_XMM_TEMP + 1;
+    put_sse(buffer, 0x66, 0x6F, odd, reg);          /* movdqa odd, reg */
+    put_sse(buffer, 0x66, 0xF4, reg, rm);           /* pmuludq reg, rm: carriles 0 y 2 */
+    put_sse(buffer, 0x66, 0x73, 2, odd);            /* psrlq odd, 32 */
+    EMIT(buffer, 0x20);
+    put_sse(buffer, 0x66, 0x6F, other, rm);         /* movdqa other, rm */
+    put_sse(buffer, 0x66, 0x73, 2, other);          /* psrlq other, 32 */
+    EMIT(buffer, 0x20);
+    put_sse(buffer, 0x66, 0xF4, odd, other);        /* pmuludq odd, other: carriles 1 y 3 */
+    put_sse(buffer, 0x66, 0x70, reg, reg);          /* pshufd reg, reg, 0x08 */
+    EMIT(buffer, 0x08);
+    put_sse(buffer, 0x66, 0x70, odd, odd);          /* pshufd odd, odd, 0x08 */
+    EMIT(buffer, 0x08);
+    put_sse(buffer, 0x66, 0x62, reg, odd);          /* punpckldq reg, odd */
+}
+
+/**
+ * @brief acc = min(acc, value) o max(acc, value) con signo.
+ *
+ * SSE2 no tiene pminsd: se compara con pcmpgtd y se combina con máscaras
+ * (destruye @p value).
+ */
+static void put_select(JitBuffer *buffer, int simd, BcReduce kind, uint8_t acc, uint8_t value) {
+    if (simd == JIT_SIMD_AVX2) {
+        put_avx(buffer, 1, 2, kind == BC_REDUCE_MIN ? 0x39 : 0x3D, acc, acc, value);
+        return;
+    }
+    const uint8_t mask = JIT_XMM_TEMP;
+    if (kind == BC_REDUCE_MIN) {                    /* mask = acc > value */
+        put_sse(buffer, 0x66, 0x6F, mask, acc);
+        put_sse(buffer, 0x66, 0x66, mask, value);
+    } else {                                        /* mask = value > acc */
+        put_sse(buffer, 0x66, 0x6F, mask, value);
+        put_sse(buffer, 0x66, 0x66, mask, acc);
+    }
+    put_sse(buffer, 0x66, 0xDB, value, mask);       /* pand value, mask */
+    put_sse(buffer, 0x66, 0xDF, mask, acc);         /* pandn mask, acc */
+    put_sse(buffer, 0x66, 0xEB, mask, value);       /* por mask, value */
+    put_sse(buffer, 0x66, 0x6F, acc, mask);
+}
+
+/**
+ * @brief Evalúa la expresión de una reducción en xmm0 (pila en xmm0-7).
+ */
+static void put_vector_expression(JitBuffer *buffer, int simd, const BcFunction *function,
+                                  const BcKernel *kernel, const BcReduction *reduction) {
+    uint8_t top = 0;
+    for (uint32_t i = reduction->start; i < reduction->start + reduction->length; i++) {
+        const BcVecInstr *instr = &kernel->code[i];
+        switch ((BcVecOp)instr->op) {
+            case BC_VEC_INDEX:
+                put_move(buffer, simd, top++, JIT_XMM_INDEX);
+                break;
+            case BC_VEC_CONST:
+                put_splat(buffer, simd, top++, instr->value);
+                break;
+            case BC_VEC_LOAD:                       /* mov edx, [rbp + d] ; mov [rsp], edx */
+                put_rbp_operand(buffer, 0x8B, 2, slot_offset(function, instr->slot));
+                EMIT(buffer, 0x89, 0x14, 0x24);
+                put_broadcast(buffer, simd, top++);
+                break;
+            case BC_VEC_ADD:
+                put_packed(buffer, simd, 0xFE, (uint8_t)(top - 2), (uint8_t)(top - 1));  /* paddd */
+                top--;
+                break;
+            case BC_VEC_SUB:
+                put_packed(buffer, simd, 0xFA, (uint8_t)(top - 2), (uint8_t)(top - 1));  /* psubd */
+                top--;
+                break;
+            case BC_VEC_MUL:
+                put_multiply(buffer, simd, (uint8_t)(top - 2), (uint8_t)(top - 1));
+                top--;
+                break;
+            case BC_VEC_NEG:                        /* temp = 0 - x */
+                put_packed(buffer, simd, 0xEF, JIT_XMM_TEMP, JIT_XMM_TEMP);
+                put_packed(buffer, simd, 0xFA, JIT_XMM_TEMP, (uint8_t)(top - 1));
+                put_move(buffer, simd, (uint8_t)(top - 1), JIT_XMM_TEMP);
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Traduce BC_VECTOR: las iteraciones que llenan vectores completos.
+ *
+ * Deja la variable del ciclo en la primera iteración no procesada; el ciclo
+ * escalar que sigue hace el resto (menos de un vector).
+ */
+static void put_kernel(JitBuffer *buffer, int simd, const BcFunction *function, const BcKernel *kernel) {
+    const uint8_t lanes = simd == JIT_SIMD_AVX2 ? 8 : 4;
+    int32_t index = slot_offset(function, kernel->index_slot);
+    EMIT(buffer, 0x48);                             /* movsxd rax, [index] */
+    put_rbp_operand(buffer, 0x63, 0, index);
+    EMIT(buffer, 0x48);                             /* movsxd rcx, [end] */
+    put_rbp_operand(buffer, 0x63, 1, slot_offset(function, kernel->end_slot));
+    EMIT(buffer, 0x48, 0x29, 0xC1);                 /* sub rcx, rax */
+    EMIT(buffer, 0x48, 0x83, 0xF9, lanes);          /* cmp rcx, lanes */
+    EMIT(buffer, 0x0F, 0x8C);                       /* jl skip */
+    size_t skip = buffer->length;
+    put_u32(buffer, 0);
+    EMIT(buffer, 0x48, 0x83, 0xE1, (uint8_t)-lanes);    /* and rcx, -lanes */
+    EMIT(buffer, 0x45, 0x31, 0xC0);                 /* xor r8d, r8d */
+    EMIT(buffer, 0x48, 0x83, 0xEC, 0x20);           /* sub rsp, 32 */
+    for (uint8_t j = 0; j < lanes; j++) {           /* lea edx, [rax + j] ; mov [rsp + 4j], edx */
+        EMIT(buffer, 0x8D, 0x50, j, 0x89, 0x54, 0x24, (uint8_t)(4 * j));
+    }
+    if (simd == JIT_SIMD_AVX2) {
+        put_avx(buffer, 2, 1, 0x6F, JIT_XMM_INDEX, 0, JIT_XMM_SCRATCH);    /* vmovdqu */
+    } else {
+        put_sse(buffer, 0xF3, 0x6F, JIT_XMM_INDEX, JIT_XMM_SCRATCH);       /* movdqu */
+    }
+    put_splat(buffer, simd, JIT_XMM_STEP, lanes);
+    for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+        put_splat(buffer, simd, (uint8_t)(JIT_XMM_ACC + r), vec_identity((BcReduce)kernel->reductions[r].kind));
+    }
+
+    size_t loop = buffer->length;
+    for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+        const BcReduction *reduction = &kernel->reductions[r];
+        uint8_t acc = (uint8_t)(JIT_XMM_ACC + r);
+        put_vector_expression(buffer, simd, function, kernel, reduction);
+        switch ((BcReduce)reduction->kind) {
+            case BC_REDUCE_ADD: put_packed(buffer, simd, 0xFE, acc, 0); break;
+            case BC_REDUCE_MUL: put_multiply(buffer, simd, acc, 0); break;
+            default: put_select(buffer, simd, (BcReduce)reduction->kind, acc, 0); break;
+        }
+    }
+    put_packed(buffer, simd, 0xFE, JIT_XMM_INDEX, JIT_XMM_STEP);
+    EMIT(buffer, 0x49, 0x83, 0xC0, lanes);          /* add r8, lanes */
+    EMIT(buffer, 0x49, 0x39, 0xC8, 0x0F, 0x82);     /* cmp r8, rcx ; jb loop */
+    put_u32(buffer, (uint32_t)(loop - (buffer->length + 4)));
+
+    /* Suma horizontal: cada carril se combina con el valor escalar inicial */
+    for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+        const BcReduction *reduction = &kernel->reductions[r];
+        uint8_t acc = (uint8_t)(JIT_XMM_ACC + r);
+        int32_t slot = slot_offset(function, reduction->slot);
+        if (simd == JIT_SIMD_AVX2) {
+            put_avx(buffer, 2, 1, 0x7F, acc, 0, JIT_XMM_SCRATCH);          /* vmovdqu [rsp], acc */
+        } else {
+            put_sse(buffer, 0xF3, 0x7F, acc, JIT_XMM_SCRATCH);             /* movdqu [rsp], acc */
+        }
+        put_rbp_operand(buffer, 0x8B, 0, slot);     /* mov eax, [slot] */
+        for (uint8_t j = 0; j < lanes; j++) {
+            uint8_t at = (uint8_t)(4 * j);
+            switch ((BcReduce)reduction->kind) {
+                case BC_REDUCE_ADD:                 /* add eax, [rsp + 4j] */
+                    EMIT(buffer, 0x03, 0x44, 0x24, at);
+                    break;
+                case BC_REDUCE_MUL:                 /* imul eax, [rsp + 4j] */
+                    EMIT(buffer, 0x0F, 0xAF, 0x44, 0x24, at);
+                    break;
+                default:                            /* mov edx, [rsp + 4j] ; cmp edx, eax ; cmovl/cmovg eax, edx */
+                    EMIT(buffer, 0x8B, 0x54, 0x24, at, 0x39, 0xC2, 0x0F,
+                         reduction->kind == BC_REDUCE_MIN ? 0x4C : 0x4F, 0xC2);
+                    break;
+            }
+        }
+        put_rbp_operand(buffer, 0x89, 0, slot);     /* mov [slot], eax */
+    }
+    EMIT(buffer, 0x44);                             /* add [index], r8d */
+    put_rbp_operand(buffer, 0x01, 0, index);
+    EMIT(buffer, 0x48, 0x83, 0xC4, 0x20);           /* add rsp, 32 */
+    if (simd == JIT_SIMD_AVX2) {
+        EMIT(buffer, 0xC5, 0xF8, 0x77);             /* vzeroupper */
+    }
+    patch_u32(buffer, skip, (uint32_t)(buffer->length - (skip + 4)));
+}
+
+/**
+ * @brief Traduce una función de bytecode a x86-64.
+ *
+ * @param pcs Destino del inicio de cada instrucción (liberar con free()),
+ *            con *pc_count elementos.
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int translate(const BcFunction *function, uint32_t index, int simd, JitBuffer *buffer, JitPc **pcs,
+                     size_t *pc_count) {
+    uint32_t *native = (uint32_t *)malloc((function->length + 1) * sizeof(uint32_t));
+    JitFixup *fixups = (JitFixup *)malloc((2 * function->length + 2) * sizeof(JitFixup));
+    *pcs = (JitPc *)malloc((function->length + 1) * sizeof(JitPc));
+    *pc_count = 0;
+    if (native == NULL || fixups == NULL || *pcs == NULL) {
+        free(native);
+        free(fixups);
+        free(*pcs);
+        *pcs = NULL;
+        return 1;
+    }
+    size_t fixup_count = 0;
+    const uint32_t depth = (uint32_t)offsetof(JitRuntime, depth);
+    const uint32_t table = (uint32_t)offsetof(JitRuntime, table);
+    uint32_t locals = function->slot_count - function->param_count;
+
+    EMIT(buffer, 0x55);                             /* push rbp */
+    EMIT(buffer, 0x48, 0x89, 0xE5);                 /* mov rbp, rsp */
+    EMIT(buffer, 0x41, 0xFF, 0x87);                 /* inc dword [r15 + depth] */
+    put_u32(buffer, depth);
+    EMIT(buffer, 0x41, 0x81, 0xBF);                 /* cmp dword [r15 + depth], RUN_MAX_DEPTH */
+    put_u32(buffer, depth);
+    put_u32(buffer, RUN_MAX_DEPTH);
+    put_jump(buffer, fixups, &fixup_count, 0x8F, JIT_TARGET_STACK_OVERFLOW, 0);    /* jg */
+    if (locals > 0) {
+        EMIT(buffer, 0x48, 0x81, 0xEC);             /* sub rsp, 8 * locals */
+        put_u32(buffer, 8 * locals);
+    }
+
+    const uint8_t *code = function->code;
+    for (size_t pc = 0; pc < function->length;) {
+        BcOp op = (BcOp)code[pc];
+        uint32_t at = (uint32_t)pc;
+        native[pc] = (uint32_t)buffer->length;
+        (*pcs)[*pc_count].native = native[pc];
+        (*pcs)[(*pc_count)++].pc = at;
+        const uint8_t *operand = code + pc + 1;
+        pc += 1 + bc_operand_size(op);
+        switch (op) {
+            case BC_CONST:
+            case BC_LITERAL: {
+                int32_t value = (int32_t)bc_read_u32(operand);
+                if (value >= -128 && value <= 127) {
+                    EMIT(buffer, 0x6A, (uint8_t)value);     /* push imm8 */
+                } else {
+                    EMIT(buffer, 0x68);                     /* push imm32 */
+                    put_u32(buffer, (uint32_t)value);
+                }
+                break;
+            }
+            case BC_LOAD:                                   /* push [rbp + d] */
+                put_rbp_operand(buffer, 0xFF, 6, slot_offset(function, bc_read_u16(operand)));
+                break;
+            case BC_STORE:                                  /* pop [rbp + d] */
+                put_rbp_operand(buffer, 0x8F, 0, slot_offset(function, bc_read_u16(operand)));
+                break;
+            case BC_POP:
+                EMIT(buffer, 0x58);                         /* pop rax */
+                break;
+            case BC_ADD:
+                EMIT(buffer, 0x59, 0x01, 0x0C, 0x24);       /* pop rcx ; add [rsp], ecx */
+                break;
+            case BC_SUB:
+                EMIT(buffer, 0x59, 0x29, 0x0C, 0x24);       /* pop rcx ; sub [rsp], ecx */
+                break;
+            case BC_MUL:                                    /* pop rcx ; pop rax ; imul eax, ecx ; push rax */
+                EMIT(buffer, 0x59, 0x58, 0x0F, 0xAF, 0xC1, 0x50);
+                break;
+            case BC_DIV:
+            case BC_MOD:
+                EMIT(buffer, 0x59, 0x58, 0x85, 0xC9);       /* pop rcx ; pop rax ; test ecx, ecx */
+                put_jump(buffer, fixups, &fixup_count, 0x84, JIT_TARGET_DIVISION_BY_ZERO, at);  /* je */
+                EMIT(buffer, 0x83, 0xF9, 0xFF, 0x75, 0x04); /* cmp ecx, -1 ; jne normal */
+                if (op == BC_DIV) {                         /* neg eax ; jmp done ; cdq ; idiv ecx */
+                    EMIT(buffer, 0xF7, 0xD8, 0xEB, 0x03, 0x99, 0xF7, 0xF9);
+                } else {                                    /* xor eax, eax ; jmp done ; cdq ; idiv ecx ; mov eax, edx */
+                    EMIT(buffer, 0x31, 0xC0, 0xEB, 0x05, 0x99, 0xF7, 0xF9, 0x89, 0xD0);
+                }
+                EMIT(buffer, 0x50);                         /* done: push rax */
+                break;
+            case BC_NEG:
+                EMIT(buffer, 0xF7, 0x1C, 0x24);             /* neg dword [rsp] */
+                break;
+            case BC_NOT:
+                EMIT(buffer, 0x83, 0x34, 0x24, 0x01);       /* xor dword [rsp], 1 */
+                break;
+            case BC_EQ:
+            case BC_NE:
+            case BC_LT:
+            case BC_LE:
+            case BC_GT:
+            case BC_GE: {
+                static const uint8_t SETCC[] = { 0x94, 0x95, 0x9C, 0x9E, 0x9F, 0x9D };
+                /* pop rcx ; xor eax, eax ; cmp [rsp], ecx ; setcc al ; mov [rsp], rax */
+                EMIT(buffer, 0x59, 0x31, 0xC0, 0x39, 0x0C, 0x24, 0x0F, SETCC[op - BC_EQ], 0xC0,
+                     0x48, 0x89, 0x04, 0x24);
+                break;
+            }
+            case BC_JUMP:
+                put_jump(buffer, fixups, &fixup_count, 0, bc_read_u32(operand), at);
+                break;
+            case BC_JUMP_FALSE:
+            case BC_JUMP_TRUE:
+                EMIT(buffer, 0x58, 0x85, 0xC0);             /* pop rax ; test eax, eax */
+                put_jump(buffer, fixups, &fixup_count, op == BC_JUMP_FALSE ? 0x84 : 0x85,
+                         bc_read_u32(operand), at);
+                break;
+            case BC_CALL:
+                EMIT(buffer, 0x41, 0xFF, 0x97);             /* call [r15 + table + 8 * i] */
+                put_u32(buffer, table + 8 * (uint32_t)bc_read_u16(operand));
+                EMIT(buffer, 0x50);                         /* push rax */
+                break;
+            case BC_RETURN:
+                EMIT(buffer, 0x58, 0x41, 0xFF, 0x8F);       /* pop rax ; dec dword [r15 + depth] */
+                put_u32(buffer, depth);
+                EMIT(buffer, 0xC9);                         /* leave */
+                if (function->param_count > 0) {
+                    EMIT(buffer, 0xC2);                     /* ret 8 * n */
+                    put_u16(buffer, 8 * function->param_count);
+                } else {
+                    EMIT(buffer, 0xC3);                     /* ret */
+                }
+                break;
+            case BC_PRINT:
+                EMIT(buffer, 0x5E, 0xBA);                   /* pop rsi ; mov edx, type */
+                put_u32(buffer, operand[0]);
+                put_c_call(buffer, (const void *)jit_print);
+                break;
+            case BC_VECTOR:
+                put_kernel(buffer, simd, function, &function->kernels[bc_read_u16(operand)]);
+                break;
+            case BC_ENTER:
+                EMIT(buffer, 0xBE);                         /* mov esi, index */
+                put_u32(buffer, index);
+                put_c_call(buffer, (const void *)jit_heap_enter);
+                break;
+            case BC_LEAVE:                                  /* mov esi, [rsp] ; mov edx, is_reference */
+                EMIT(buffer, 0x8B, 0x34, 0x24, 0xBA);
+                put_u32(buffer, operand[0]);
+                put_c_call(buffer, (const void *)jit_heap_leave);
+                break;
+            case BC_CONCAT:                                 /* pop rdx ; pop rsi ; mov ecx, flags */
+                EMIT(buffer, 0x5A, 0x5E, 0xB9);
+                put_u32(buffer, operand[0]);
+                EMIT(buffer, 0x41, 0xB8);                   /* mov r8d, index */
+                put_u32(buffer, index);
+                put_c_call(buffer, (const void *)jit_concat);
+                EMIT(buffer, 0x50);                         /* push rax */
+                break;
+            case BC_ARRAY: {
+                uint32_t value = bc_read_u32(operand);
+                EMIT(buffer, 0x48, 0x89, 0xE6, 0xBA);       /* mov rsi, rsp ; mov edx, operand */
+                put_u32(buffer, value);
+                EMIT(buffer, 0xB9);                         /* mov ecx, index */
+                put_u32(buffer, index);
+                put_c_call(buffer, (const void *)jit_array);
+                if ((value & 0xFFFF) > 0) {
+                    EMIT(buffer, 0x48, 0x81, 0xC4);         /* add rsp, 8 * n */
+                    put_u32(buffer, 8 * (value & 0xFFFF));
+                }
+                EMIT(buffer, 0x50);                         /* push rax */
+                break;
+            }
+            case BC_INDEX:                                  /* pop rdx ; pop rsi ; mov ecx, flags */
+                EMIT(buffer, 0x5A, 0x5E, 0xB9);
+                put_u32(buffer, operand[0]);
+                EMIT(buffer, 0x41, 0xB8);                   /* mov r8d, index */
+                put_u32(buffer, index);
+                EMIT(buffer, 0x41, 0xB9);                   /* mov r9d, pc */
+                put_u32(buffer, at);
+                put_c_call(buffer, (const void *)jit_index);
+                EMIT(buffer, 0x50);                         /* push rax */
+                break;
+            case BC_LENGTH:
+                EMIT(buffer, 0x5E);                         /* pop rsi */
+                put_c_call(buffer, (const void *)jit_length);
+                EMIT(buffer, 0x50);                         /* push rax */
+                break;
+            case BC_EQUAL:                                  /* pop rdx ; pop rsi ; mov ecx, flags */
+                EMIT(buffer, 0x5A, 0x5E, 0xB9);
+                put_u32(buffer, operand[0]);
+                put_c_call(buffer, (const void *)jit_equal);
+                EMIT(buffer, 0x50);                         /* push rax */
+                break;
+            default:
+                break;
+        }
+    }
+
+    native[function->length] = (uint32_t)buffer->length;
+    uint32_t stack_overflow = (uint32_t)buffer->length;
+    put_fail_stub(buffer, RUN_STACK_OVERFLOW, index);
+    /* Cada división deja su pc en ecx antes de ir a la salida común */
+    size_t division_jumps = fixup_count;
+    for (size_t i = 0; i < division_jumps; i++) {
+        if (fixups[i].target == JIT_TARGET_DIVISION_BY_ZERO) {
+            patch_u32(buffer, fixups[i].at, (uint32_t)buffer->length - (fixups[i].at + 4));
+            EMIT(buffer, 0xB9);                     /* mov ecx, pc */
+            put_u32(buffer, fixups[i].pc);
+            put_jump(buffer, fixups, &fixup_count, 0, JIT_TARGET_DIVISION_BY_ZERO, 0);
+        }
+    }
+    uint32_t division_by_zero = (uint32_t)buffer->length;
+    EMIT(buffer, 0xBE);                             /* mov esi, index ; edx = pc */
+    put_u32(buffer, index);
+    EMIT(buffer, 0x89, 0xCA);                       /* mov edx, ecx */
+    put_c_call(buffer, (const void *)jit_fail_division);
+
+    for (size_t i = 0; i < fixup_count; i++) {
+        if (i < division_jumps && fixups[i].target == JIT_TARGET_DIVISION_BY_ZERO) {
+            continue;
+        }
+        uint32_t target = fixups[i].target == JIT_TARGET_DIVISION_BY_ZERO ? division_by_zero
+                        : fixups[i].target == JIT_TARGET_STACK_OVERFLOW ? stack_overflow
+                        : native[fixups[i].target];
+        patch_u32(buffer, fixups[i].at, target - (fixups[i].at + 4));
+    }
+    free(native);
+    free(fixups);
+    return buffer->failed;
+}
+
+/* ---- Caché de código ---- */
+
+/**
+ * @brief Copia código a páginas nuevas y las vuelve ejecutables (sin escritura).
+ *
+ * Cada bloque ocupa sus propias páginas para que ninguna sea escribible
+ * mientras otra ejecución corre código ya publicado. Se llama con el lock
+ * de la caché tomado.
+ */
+static void *install_code(const uint8_t *code, size_t length) {
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t size = (length + page - 1) / page * page;
+    if (jit_cache.code_bytes + size > JIT_CACHE_MAX_BYTES) {
+        return NULL;
+    }
+    void *memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        return NULL;
+    }
+    memcpy(memory, code, length);
+    if (mprotect(memory, size, PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, size);
+        return NULL;
+    }
+    jit_cache.code_bytes += size;
+    return memory;
+}
+
+/**
+ * @brief Crea los trampolines de entrada y de compilación perezosa.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int init_trampolines(void) {
+    if (jit_cache.enter != NULL) {
+        return 0;
+    }
+    JitBuffer buffer = { NULL, 0, 0, 0 };
+    /* jit_enter(rt, entry, stack_top): guarda los registros preservados, cambia a la pila propia y llama a entry */
+    EMIT(&buffer, 0x53, 0x55, 0x41, 0x54, 0x41, 0x55, 0x41, 0x56, 0x41, 0x57);
+    EMIT(&buffer, 0x49, 0x89, 0xFF);                /* mov r15, rdi */
+    EMIT(&buffer, 0x49, 0x89, 0xE4);                /* mov r12, rsp */
+    EMIT(&buffer, 0x48, 0x89, 0xD4);                /* mov rsp, rdx */
+    EMIT(&buffer, 0xFF, 0xD6);                      /* call rsi */
+    EMIT(&buffer, 0x4C, 0x89, 0xE4);                /* mov rsp, r12 */
+    EMIT(&buffer, 0x41, 0x5F, 0x41, 0x5E, 0x41, 0x5D, 0x41, 0x5C, 0x5D, 0x5B, 0xC3);
+    size_t lazy = buffer.length;
+    /* Stub perezoso (esi = índice): compila y salta a la función con los argumentos intactos */
+    EMIT(&buffer, 0x55);                            /* push rbp */
+    EMIT(&buffer, 0x48, 0x89, 0xE5);                /* mov rbp, rsp */
+    EMIT(&buffer, 0x48, 0x8B, 0x45, 0x08);          /* mov rax, [rbp + 8] (retorno al llamador) */
+    EMIT(&buffer, 0x49, 0x89, 0x87);                /* mov [r15 + native_pc], rax */
+    put_u32(&buffer, (uint32_t)offsetof(JitRuntime, native_pc));
+    EMIT(&buffer, 0x48, 0x8B, 0x45, 0x00);          /* mov rax, [rbp] (marco del llamador) */
+    EMIT(&buffer, 0x49, 0x89, 0x87);                /* mov [r15 + native_fp], rax */
+    put_u32(&buffer, (uint32_t)offsetof(JitRuntime, native_fp));
+    EMIT(&buffer, 0x4C, 0x89, 0xFF);                /* mov rdi, r15 */
+    EMIT(&buffer, 0x48, 0x83, 0xE4, 0xF0);          /* and rsp, -16 */
+    EMIT(&buffer, 0x48, 0xB8);                      /* mov rax, jit_resolve */
+    put_u64(&buffer, (uint64_t)(uintptr_t)jit_resolve);
+    EMIT(&buffer, 0xFF, 0xD0);                      /* call rax */
+    EMIT(&buffer, 0x49, 0xC7, 0x87);                /* mov qword [r15 + native_pc], 0 */
+    put_u32(&buffer, (uint32_t)offsetof(JitRuntime, native_pc));
+    put_u32(&buffer, 0);
+    EMIT(&buffer, 0xC9);                            /* leave */
+    EMIT(&buffer, 0xFF, 0xE0);                      /* jmp rax */
+
+    uint8_t *memory = buffer.failed ? NULL : (uint8_t *)install_code(buffer.data, buffer.length);
+    free(buffer.data);
+    if (memory == NULL) {
+        return 1;
+    }
+    jit_cache.lazy_entry = memory + lazy;
+    jit_cache.enter = memory;
+    return 0;
+}
+
+/**
+ * @brief Stub perezoso de la función @p index (se crean de 256 en 256).
+ */
+static void *lazy_stub(uint32_t index) {
+    uint8_t **block = &jit_cache.stub_blocks[index / JIT_STUBS_PER_BLOCK];
+    if (*block == NULL) {
+        uint8_t code[JIT_STUBS_PER_BLOCK * JIT_STUB_SIZE];
+        memset(code, 0xCC, sizeof(code));
+        uint32_t first = index / JIT_STUBS_PER_BLOCK * JIT_STUBS_PER_BLOCK;
+        uint64_t target = (uint64_t)(uintptr_t)jit_cache.lazy_entry;
+        for (uint32_t i = 0; i < JIT_STUBS_PER_BLOCK; i++) {
+            uint8_t *stub = code + i * JIT_STUB_SIZE;
+            uint32_t function = first + i;
+            stub[0] = 0xBE;                         /* mov esi, index */
+            memcpy(stub + 1, &function, 4);
+            stub[5] = 0x48;                         /* mov rax, lazy_entry */
+            stub[6] = 0xB8;
+            memcpy(stub + 7, &target, 8);
+            stub[15] = 0xFF;                        /* jmp rax */
+            stub[16] = 0xE0;
+        }
+        *block = (uint8_t *)install_code(code, sizeof(code));
+        if (*block == NULL) {
+            return NULL;
+        }
+    }
+    return *block + index % JIT_STUBS_PER_BLOCK * JIT_STUB_SIZE;
+}
+
+/**
+ * @brief Hash de los núcleos vectoriales de una función (0 si no tiene).
+ */
+static uint64_t kernels_key(const BcFunction *function) {
+    uint64_t key = 0;
+    for (size_t k = 0; k < function->kernel_count; k++) {
+        const BcKernel *kernel = &function->kernels[k];
+        uint32_t header[3] = { kernel->index_slot, kernel->end_slot, kernel->reduction_count };
+        key = hash64(header, sizeof(header), key);
+        for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+            const BcReduction *reduction = &kernel->reductions[r];
+            uint32_t fields[4] = { reduction->kind, reduction->slot, reduction->start, reduction->length };
+            key = hash64(fields, sizeof(fields), key);
+        }
+        for (uint32_t i = 0; i < kernel->code_length; i++) {
+            uint32_t fields[3] = { kernel->code[i].op, kernel->code[i].slot, (uint32_t)kernel->code[i].value };
+            key = hash64(fields, sizeof(fields), key);
+        }
+    }
+    return key;
+}
+
+/**
+ * @brief Clave de caché: el bytecode y todo lo que cambia su traducción.
+ */
+static uint64_t function_key(const BcFunction *function, uint32_t index, int simd, uint64_t kernels) {
+    uint64_t seed = ((uint64_t)index << 32) ^ ((uint64_t)function->param_count << 16) ^ function->slot_count
+                  ^ ((uint64_t)simd << 62) ^ kernels;
+    return hash64(function->code, function->length, seed);
+}
+
+/**
+ * @brief Devuelve el código de una función: de la caché o recién traducido.
+ */
+static void *jit_compile(const BcFunction *function, uint32_t index, int simd) {
+    uint64_t kernels = kernels_key(function);
+    uint64_t key = function_key(function, index, simd, kernels);
+    JitEntry **bucket = &jit_cache.buckets[key % JIT_CACHE_BUCKETS];
+    void *code = NULL;
+    pthread_mutex_lock(&jit_cache.lock);
+    for (JitEntry *entry = *bucket; entry != NULL; entry = entry->next) {
+        if (entry->key == key && entry->index == index && entry->param_count == function->param_count
+                && entry->slot_count == function->slot_count && entry->simd == simd
+                && entry->kernels == kernels && entry->length == function->length
+                && memcmp(entry->bytecode, function->code, function->length) == 0) {
+            code = entry->code;
+            break;
+        }
+    }
+    if (code == NULL) {
+        JitBuffer buffer = { NULL, 0, 0, 0 };
+        JitEntry *entry = (JitEntry *)malloc(sizeof(JitEntry));
+        uint8_t *bytecode = (uint8_t *)malloc(function->length);
+        JitPc *pcs = NULL;
+        size_t pc_count = 0;
+        if (entry != NULL && bytecode != NULL
+                && translate(function, index, simd, &buffer, &pcs, &pc_count) == 0) {
+            code = install_code(buffer.data, buffer.length);
+        }
+        if (code != NULL) {
+            memcpy(bytecode, function->code, function->length);
+            entry->next = *bucket;
+            entry->key = key;
+            entry->index = index;
+            entry->param_count = function->param_count;
+            entry->slot_count = function->slot_count;
+            entry->simd = simd;
+            entry->kernels = kernels;
+            entry->length = function->length;
+            entry->bytecode = bytecode;
+            entry->code = code;
+            entry->code_length = buffer.length;
+            entry->pcs = pcs;
+            entry->pc_count = pc_count;
+            *bucket = entry;
+        } else {
+            free(entry);
+            free(bytecode);
+            free(pcs);
+        }
+        free(buffer.data);
+    }
+    pthread_mutex_unlock(&jit_cache.lock);
+    return code;
+}
+
+/**
+ * @brief Llama a main en la pila propia; jit_fail() vuelve aquí con longjmp.
+ *
+ * Separado de jit_run() para que ninguna variable viva cruce el setjmp.
+ */
+static void enter_main(JitRuntime *rt, JitEnter enter, uint8_t *stack_top) {
+    if (setjmp(rt->escape) == 0) {
+        rt->result->value = enter(rt, rt->table[rt->module->main_index], stack_top);
+        rt->result->status = RUN_OK;
+    }
+}
+
+/* ---- Perfil por muestreo ---- */
+
+/**
+ * @brief Toma una muestra desde el manejador de SIGPROF.
+ *
+ * Sigue la cadena de rbp de los marcos del código generado (cada uno empieza
+ * con push rbp; mov rbp, rsp) sin salir de la pila propia de la ejecución.
+ * Si la señal llega durante una llamada a C, la muestra empieza en el
+ * retorno anotado en native_pc. Guarda las direcciones tal cual;
+ * resolve_samples() las traduce al terminar. Durante el prólogo de una
+ * función la muestra omite a su llamador.
+ */
+static void walk_native(Sampler *sampler, void *context) {
+    const JitRuntime *rt = (const JitRuntime *)sampler->walk_data;
+    const ucontext_t *uc = (const ucontext_t *)context;
+    uint64_t *frames = sampler_begin(sampler);
+    if (frames == NULL) {
+        return;
+    }
+    size_t count = 0;
+    uintptr_t pc = (uintptr_t)uc->uc_mcontext.gregs[REG_RIP];
+    uintptr_t fp = (uintptr_t)uc->uc_mcontext.gregs[REG_RBP];
+    if (rt->native_pc != 0) {
+        frames[count++] = SAMPLER_RUNTIME;
+        pc = rt->native_pc - 1;
+        fp = rt->native_fp;
+    }
+    frames[count++] = pc;
+    while (count < SAMPLER_MAX_DEPTH && fp % 8 == 0 && fp >= rt->stack_low && fp <= rt->stack_high - 16) {
+        const uintptr_t *frame = (const uintptr_t *)fp;
+        frames[count++] = frame[1] - 1;
+        if (frame[0] <= fp) {
+            break;
+        }
+        fp = frame[0];
+    }
+    sampler_commit(sampler, frames, count);
+}
+
+/**
+ * @brief Código de una función en la ejecución, para traducir direcciones.
+ */
+typedef struct JitRange {
+    uintptr_t start;
+    const JitEntry *entry;
+} JitRange;
+
+static int compare_ranges(const void *a, const void *b) {
+    uintptr_t x = ((const JitRange *)a)->start;
+    uintptr_t y = ((const JitRange *)b)->start;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Traduce una dirección a su posición en el bytecode.
+ *
+ * @return 1 si está en el código de una función de la ejecución.
+ */
+static int resolve_address(const JitRange *ranges, size_t count, uintptr_t address, uint64_t *frame) {
+    size_t low = 0;
+    size_t high = count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (ranges[middle].start <= address) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == 0) {
+        return 0;
+    }
+    const JitEntry *entry = ranges[low - 1].entry;
+    uintptr_t offset = address - ranges[low - 1].start;
+    if (offset >= entry->code_length || entry->pc_count == 0) {
+        return 0;
+    }
+    // Última instrucción que empieza en o antes de offset (las que no emiten código se saltan).
+    size_t first = 0;
+    size_t last = entry->pc_count;
+    while (first < last) {
+        size_t middle = first + (last - first) / 2;
+        if (entry->pcs[middle].native <= offset) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    *frame = sampler_frame(entry->index, entry->pcs[first > 0 ? first - 1 : 0].pc);
+    return 1;
+}
+
+/**
+ * @brief Reemplaza las direcciones de las muestras por posiciones del bytecode.
+ *
+ * Las direcciones fuera del código de las funciones (trampolines, stubs,
+ * retorno a C) se descartan, y las muestras sin ningún marco también.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int resolve_samples(Sampler *sampler, const JitRuntime *rt) {
+    size_t count = 0;
+    JitRange *ranges = (JitRange *)malloc((rt->module->function_count + 1) * sizeof(JitRange));
+    if (ranges == NULL) {
+        return 1;
+    }
+    pthread_mutex_lock(&jit_cache.lock);
+    for (size_t b = 0; b < JIT_CACHE_BUCKETS; b++) {
+        for (const JitEntry *entry = jit_cache.buckets[b]; entry != NULL; entry = entry->next) {
+            if (entry->index < rt->module->function_count && rt->table[entry->index] == entry->code) {
+                ranges[count].start = (uintptr_t)entry->code;
+                ranges[count++].entry = entry;
+            }
+        }
+    }
+    qsort(ranges, count, sizeof(JitRange), compare_ranges);
+
+    size_t read = 0;
+    size_t write = 0;
+    size_t samples = 0;
+    while (read < sampler->length) {
+        size_t frames = (size_t)sampler->words[read];
+        size_t header = write++;
+        size_t kept = 0;
+        for (size_t i = 1; i <= frames; i++) {
+            uint64_t word = sampler->words[read + i];
+            uint64_t frame = SAMPLER_RUNTIME;
+            if (word == SAMPLER_RUNTIME || resolve_address(ranges, count, (uintptr_t)word, &frame)) {
+                sampler->words[write++] = frame;
+                kept++;
+            }
+        }
+        read += frames + 1;
+        if (kept == 0 || (kept == 1 && sampler->words[header + 1] == SAMPLER_RUNTIME)) {
+            write = header;
+        } else {
+            sampler->words[header] = kept;
+            samples++;
+        }
+    }
+    pthread_mutex_unlock(&jit_cache.lock);
+    sampler->dropped += sampler->samples - samples;
+    sampler->samples = samples;
+    sampler->length = write;
+    free(ranges);
+    return 0;
+}
+
+/**
+ * @brief Indica si el JIT puede usarse en esta plataforma.
+ */
+int jit_available(void) {
+    return 1;
+}
+
+/**
+ * @brief Ejecuta main compilando cada función en su primera llamada.
+ *
+ * @param sampler Perfil por muestreo ya iniciado (ver sampler_start()), o NULL.
+ */
+static int execute(const BcModule *module, Sampler *sampler, FILE *out, RunResult *result) {
+    memset(result, 0, sizeof(*result));
+    result->function = module->main_index;
+    if (module->function_count > JIT_MAX_FUNCTIONS) {
+        result->status = RUN_OUT_OF_MEMORY;
+        return 1;
+    }
+    JitRuntime *rt = (JitRuntime *)calloc(1, sizeof(JitRuntime) + module->function_count * sizeof(void *));
+    if (rt == NULL) {
+        result->status = RUN_OUT_OF_MEMORY;
+        return 1;
+    }
+    rt->module = module;
+    rt->simd = (module->flags & BC_SIMD_SSE2) || !__builtin_cpu_supports("avx2") ? JIT_SIMD_SSE2
+                                                                                : JIT_SIMD_AVX2;
+    rt->out = out;
+    rt->result = result;
+    rt_heap_init(&rt->heap, module->strings, (module->flags & BC_HEAP_MALLOC) != 0);
+
+    int ready = 1;
+    JitEnter enter = NULL;
+    pthread_mutex_lock(&jit_cache.lock);
+    if (init_trampolines() != 0) {
+        ready = 0;
+    }
+    for (size_t i = 0; ready && i < module->function_count; i++) {
+        rt->table[i] = lazy_stub((uint32_t)i);
+        ready = rt->table[i] != NULL;
+    }
+    if (ready) {
+        enter = (JitEnter)jit_cache.enter;
+    }
+    pthread_mutex_unlock(&jit_cache.lock);
+
+    uint8_t *stack = ready ? (uint8_t *)mmap(NULL, JIT_STACK_BYTES, PROT_READ | PROT_WRITE,
+                                             MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0)
+                           : (uint8_t *)MAP_FAILED;
+    if (stack == MAP_FAILED) {
+        rt_heap_free(&rt->heap);
+        free(rt);
+        result->status = RUN_OUT_OF_MEMORY;
+        return 1;
+    }
+    /* Página de guarda: un desbordamiento imprevisto falla en lugar de escribir fuera */
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    mprotect(stack, page, PROT_NONE);
+    rt->stack_low = (uintptr_t)stack + page;
+    rt->stack_high = (uintptr_t)stack + JIT_STACK_BYTES;
+
+    if (sampler != NULL) {
+        sampler_attach(sampler, walk_native, rt);
+    }
+    enter_main(rt, enter, stack + JIT_STACK_BYTES);
+    if (sampler != NULL) {
+        sampler_attach(sampler, NULL, NULL);
+        if (resolve_samples(sampler, rt) != 0 && result->status == RUN_OK) {
+            result->status = RUN_OUT_OF_MEMORY;
+        }
+    }
+    munmap(stack, JIT_STACK_BYTES);
+    rt_heap_free(&rt->heap);
+    result->heap = rt->heap.stats;
+    free(rt);
+    return result->status == RUN_OK ? 0 : 1;
+}
+
+/**
+ * @brief Ejecuta main compilando cada función en su primera llamada.
+ *
+ * Misma interfaz y semántica que vm_run().
+ */
+int jit_run(const BcModule *module, FILE *out, RunResult *result) {
+    return execute(module, NULL, out, result);
+}
+
+/**
+ * @brief Igual que jit_run(), tomando las muestras de @p sampler.
+ *
+ * El perfil debe estar iniciado en este hilo (sampler_start()); al
+ * terminar, sus marcos son posiciones del bytecode de @p module.
+ */
+int jit_run_sampled(const BcModule *module, Sampler *sampler, FILE *out, RunResult *result) {
+    return execute(module, sampler, out, result);
+}
+
+#else
+
+#include <string.h>
+
+int jit_available(void) {
+    return 0;
+}
+
+int jit_run(const BcModule *module, FILE *out, RunResult *result) {
+    (void)out;
+    memset(result, 0, sizeof(*result));
+    result->status = RUN_UNSUPPORTED;
+    result->function = module->main_index;
+    return 1;
+}
+
+int jit_run_sampled(const BcModule *module, Sampler *sampler, FILE *out, RunResult *result) {
+    (void)sampler;
+    return jit_run(module, out, result);
+}
+
+#endif
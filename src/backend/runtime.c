@@ -0,0 +1,418 @@
+/**
+ * @file runtime.c
+ * @brief Regiones por marco y pool por clases de tamaño para String y Array.
+ *
+ * Las regiones se asignan avanzando un puntero sobre bloques de
+ * RT_CHUNK_BYTES que se reutilizan de un marco al siguiente: rt_leave()
+ * solo devuelve el puntero a donde estaba en rt_enter(). El pool reparte
+ * bloques de 16 a 4096 bytes tallados de láminas; al liberarse vuelven a
+ * la lista libre de su clase. Las tablas de referencias (region, pool) dan
+ * a cada objeto un índice estable de 30 bits.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/runtime.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Bloque de región o lámina del pool; los datos van a continuación.
+ */
+struct RtChunk {
+    RtChunk *next;
+    size_t capacity;
+};
+
+static uint8_t *chunk_data(RtChunk *chunk) {
+    return (uint8_t *)(chunk + 1);
+}
+
+static void *heap_malloc(RtHeap *heap, size_t size) {
+    heap->stats.malloc_calls++;
+    return malloc(size);
+}
+
+/**
+ * @brief Garantiza espacio para @p needed elementos de @p size bytes.
+ */
+static int reserve(RtHeap *heap, void **items, size_t *capacity, size_t needed, size_t size) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    size_t grown = *capacity > 0 ? *capacity * 2 : 256;
+    while (grown < needed) {
+        grown *= 2;
+    }
+    void *larger = realloc(*items, grown * size);
+    heap->stats.malloc_calls++;
+    if (larger == NULL) {
+        return 1;
+    }
+    *items = larger;
+    *capacity = grown;
+    return 0;
+}
+
+/**
+ * @brief Prepara la memoria de una ejecución.
+ *
+ * @param heap Destino; liberar con rt_heap_free().
+ * @param strings Segmento de literales del módulo (BcModule.strings).
+ * @param use_malloc 1 para pedir cada objeto a malloc (BC_HEAP_MALLOC).
+ */
+void rt_heap_init(RtHeap *heap, const uint8_t *strings, int use_malloc) {
+    memset(heap, 0, sizeof(*heap));
+    heap->strings = strings;
+    heap->use_malloc = use_malloc;
+}
+
+static void free_chunks(RtChunk *chunk) {
+    while (chunk != NULL) {
+        RtChunk *next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+}
+
+/**
+ * @brief Libera toda la memoria, incluidos los objetos de marcos sin cerrar.
+ */
+void rt_heap_free(RtHeap *heap) {
+    if (heap->use_malloc) {
+        for (size_t i = 0; i < heap->region_count; i++) {
+            free(heap->region[i]);
+        }
+    }
+    for (size_t i = 0; i < heap->pool_count; i++) {
+        if (heap->pool[i] != NULL && heap->pool[i]->size_class == RT_CLASS_LARGE) {
+            free(heap->pool[i]);
+        }
+    }
+    free_chunks(heap->chunks);
+    free_chunks(heap->slabs);
+    free(heap->region);
+    free(heap->pool);
+    free(heap->free_handles);
+    free(heap->owned);
+    free(heap->marks);
+    RtStats stats = heap->stats;
+    memset(heap, 0, sizeof(*heap));
+    heap->stats = stats;
+}
+
+/**
+ * @brief Abre el marco de una llamada (BC_ENTER).
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int rt_enter(RtHeap *heap) {
+    if (reserve(heap, (void **)&heap->marks, &heap->mark_capacity, heap->mark_count + 1,
+                sizeof(RtMark)) != 0) {
+        return 1;
+    }
+    RtMark *mark = &heap->marks[heap->mark_count++];
+    mark->chunk = heap->chunk;
+    mark->used = heap->used;
+    mark->region_count = heap->region_count;
+    mark->region_live = heap->region_live;
+    mark->owned_count = heap->owned_count;
+    return 0;
+}
+
+/**
+ * @brief Devuelve un objeto del pool a la lista libre de su clase.
+ */
+static void pool_release(RtHeap *heap, uint32_t index) {
+    RtObject *object = heap->pool[index];
+    uint32_t size_class = object->size_class;
+    if (size_class == RT_CLASS_LARGE) {
+        free(object);
+    } else {
+        /* El enlace de la lista libre ocupa el encabezado */
+        *(void **)object = heap->free_lists[size_class];
+        heap->free_lists[size_class] = object;
+    }
+    heap->pool[index] = NULL;
+    heap->free_handles[heap->free_handle_count++] = index;
+    heap->stats.pool_freed++;
+}
+
+/**
+ * @brief Cierra el marco de la llamada que devuelve @p value (BC_LEAVE).
+ *
+ * Libera la región del marco y los objetos del pool que creó, salvo el
+ * devuelto, que pasa al marco que la llamó.
+ */
+void rt_leave(RtHeap *heap, RtRef value, int is_reference) {
+    if (heap->mark_count == 0) {
+        return;
+    }
+    const RtMark *mark = &heap->marks[--heap->mark_count];
+    int returns_pool = is_reference && value >> RT_TAG_SHIFT == RT_TAG_POOL;
+    int kept = 0;
+    for (size_t i = mark->owned_count; i < heap->owned_count; i++) {
+        if (returns_pool && !kept && heap->owned[i] == value) {
+            kept = 1;
+        } else {
+            pool_release(heap, heap->owned[i] & RT_INDEX_MASK);
+        }
+    }
+    heap->owned_count = mark->owned_count;
+    if (kept) {
+        heap->owned[heap->owned_count++] = value;
+    }
+    if (heap->use_malloc) {
+        for (size_t i = mark->region_count; i < heap->region_count; i++) {
+            free(heap->region[i]);
+        }
+    }
+    heap->region_count = mark->region_count;
+    heap->region_live = mark->region_live;
+    heap->chunk = mark->chunk;
+    heap->used = mark->used;
+}
+
+/**
+ * @brief Pasa al bloque de región siguiente, con al menos @p size bytes libres.
+ *
+ * Los bloques ya reservados se reutilizan; uno nuevo se inserta tras el actual.
+ */
+static int next_chunk(RtHeap *heap, size_t size) {
+    RtChunk *next = heap->chunk != NULL ? heap->chunk->next : heap->chunks;
+    if (next == NULL || next->capacity < size) {
+        size_t capacity = size > RT_CHUNK_BYTES ? size : RT_CHUNK_BYTES;
+        RtChunk *fresh = (RtChunk *)heap_malloc(heap, sizeof(RtChunk) + capacity);
+        if (fresh == NULL) {
+            return 1;
+        }
+        fresh->capacity = capacity;
+        fresh->next = next;
+        if (heap->chunk != NULL) {
+            heap->chunk->next = fresh;
+        } else {
+            heap->chunks = fresh;
+        }
+        next = fresh;
+    }
+    heap->chunk = next;
+    heap->used = 0;
+    return 0;
+}
+
+static RtObject *region_alloc(RtHeap *heap, size_t bytes, RtRef *ref) {
+    if (heap->region_count > RT_INDEX_MASK
+            || reserve(heap, (void **)&heap->region, &heap->region_capacity, heap->region_count + 1,
+                       sizeof(RtObject *)) != 0) {
+        return NULL;
+    }
+    RtObject *object;
+    if (heap->use_malloc) {
+        object = (RtObject *)heap_malloc(heap, bytes);
+    } else {
+        size_t rounded = (bytes + 7) & ~(size_t)7;
+        if ((heap->chunk == NULL || heap->used + rounded > heap->chunk->capacity)
+                && next_chunk(heap, rounded) != 0) {
+            return NULL;
+        }
+        object = (RtObject *)(chunk_data(heap->chunk) + heap->used);
+        heap->used += rounded;
+    }
+    if (object == NULL) {
+        return NULL;
+    }
+    object->size_class = 0;
+    *ref = RT_TAG_REGION << RT_TAG_SHIFT | (uint32_t)heap->region_count;
+    heap->region[heap->region_count++] = object;
+    heap->stats.region_objects++;
+    heap->stats.region_bytes += bytes;
+    heap->region_live += bytes;
+    if (heap->region_live > heap->stats.region_peak) {
+        heap->stats.region_peak = heap->region_live;
+    }
+    return object;
+}
+
+/**
+ * @brief Bloque de la clase @p size_class: de su lista libre o de la lámina actual.
+ */
+static RtObject *class_alloc(RtHeap *heap, uint32_t size_class) {
+    void *block = heap->free_lists[size_class];
+    if (block != NULL) {
+        heap->free_lists[size_class] = *(void **)block;
+        heap->stats.pool_reused++;
+        return (RtObject *)block;
+    }
+    size_t size = (size_t)16 << size_class;
+    if (heap->slabs == NULL || heap->slab_used + size > heap->slabs->capacity) {
+        RtChunk *slab = (RtChunk *)heap_malloc(heap, sizeof(RtChunk) + RT_CHUNK_BYTES);
+        if (slab == NULL) {
+            return NULL;
+        }
+        slab->capacity = RT_CHUNK_BYTES;
+        slab->next = heap->slabs;
+        heap->slabs = slab;
+        heap->slab_used = 0;
+    }
+    block = chunk_data(heap->slabs) + heap->slab_used;
+    heap->slab_used += size;
+    return (RtObject *)block;
+}
+
+static RtObject *pool_alloc(RtHeap *heap, size_t bytes, RtRef *ref) {
+    if (reserve(heap, (void **)&heap->owned, &heap->owned_capacity, heap->owned_count + 1,
+                sizeof(uint32_t)) != 0) {
+        return NULL;
+    }
+    if (heap->free_handle_count == 0) {
+        size_t capacity = heap->pool_capacity;
+        if (heap->pool_count > RT_INDEX_MASK
+                || reserve(heap, (void **)&heap->pool, &heap->pool_capacity, heap->pool_count + 1,
+                           sizeof(RtObject *)) != 0) {
+            return NULL;
+        }
+        if (heap->pool_capacity != capacity) {
+            /* Cada índice libre fue antes un objeto: caben en la misma capacidad */
+            uint32_t *handles = (uint32_t *)realloc(heap->free_handles, heap->pool_capacity * sizeof(uint32_t));
+            heap->stats.malloc_calls++;
+            if (handles == NULL) {
+                return NULL;
+            }
+            heap->free_handles = handles;
+        }
+    }
+    uint32_t size_class = 0;
+    while (size_class < RT_SIZE_CLASSES && ((size_t)16 << size_class) < bytes) {
+        size_class++;
+    }
+    RtObject *object;
+    if (size_class == RT_SIZE_CLASSES || heap->use_malloc) {
+        object = (RtObject *)heap_malloc(heap, bytes);
+        size_class = RT_CLASS_LARGE;
+        heap->stats.large_objects += !heap->use_malloc;
+    } else {
+        object = class_alloc(heap, size_class);
+    }
+    if (object == NULL) {
+        return NULL;
+    }
+    object->size_class = size_class;
+    uint32_t index = heap->free_handle_count > 0 ? heap->free_handles[--heap->free_handle_count]
+                                                 : (uint32_t)heap->pool_count++;
+    heap->pool[index] = object;
+    *ref = RT_TAG_POOL << RT_TAG_SHIFT | index;
+    heap->owned[heap->owned_count++] = *ref;
+    heap->stats.pool_objects++;
+    return object;
+}
+
+/**
+ * @brief Crea un String de @p length bytes o un Array de @p length elementos.
+ *
+ * @param flags BC_REF_ARRAY para un Array; BC_REF_POOL si el objeto escapa del marco.
+ * @param ref Referencia del objeto.
+ * @param object Objeto con length asignado; el llamador escribe los datos.
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int rt_alloc(RtHeap *heap, uint32_t length, unsigned flags, RtRef *ref, RtObject **object) {
+    size_t bytes = sizeof(RtObject) + (size_t)length * (flags & BC_REF_ARRAY ? 4 : 1);
+    *object = flags & BC_REF_POOL ? pool_alloc(heap, bytes, ref) : region_alloc(heap, bytes, ref);
+    if (*object == NULL) {
+        return 1;
+    }
+    (*object)->length = length;
+    return 0;
+}
+
+/**
+ * @brief Concatena dos String o dos Array (BC_CONCAT).
+ *
+ * Si uno está vacío se devuelve el otro sin copiarlo, salvo que el
+ * resultado escape y el otro viva en la región del marco.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int rt_concat(RtHeap *heap, RtRef a, RtRef b, unsigned flags, RtRef *result) {
+    const RtObject *left = rt_object(heap, a);
+    const RtObject *right = rt_object(heap, b);
+    if (left->length == 0 || right->length == 0) {
+        RtRef other = left->length == 0 ? b : a;
+        if (!(flags & BC_REF_POOL) || other >> RT_TAG_SHIFT != RT_TAG_REGION) {
+            *result = other;
+            return 0;
+        }
+    }
+    size_t element = flags & BC_REF_ARRAY ? 4 : 1;
+    if ((uint64_t)left->length + right->length > (UINT32_MAX - sizeof(RtObject)) / element) {
+        return 1;
+    }
+    RtObject *object;
+    if (rt_alloc(heap, left->length + right->length, flags, result, &object) != 0) {
+        return 1;
+    }
+    memcpy(rt_data(object), rt_data(left), left->length * element);
+    memcpy(rt_data(object) + left->length * element, rt_data(right), right->length * element);
+    return 0;
+}
+
+/**
+ * @brief Byte de un String o elemento de un Array (at()).
+ *
+ * @return 0 si es exitoso, 1 si @p index está fuera de rango.
+ */
+int rt_index(const RtHeap *heap, RtRef ref, int32_t index, unsigned flags, int32_t *value) {
+    const RtObject *object = rt_object(heap, ref);
+    if (index < 0 || (uint32_t)index >= object->length) {
+        return 1;
+    }
+    if (flags & BC_REF_ARRAY) {
+        memcpy(value, rt_data(object) + 4 * (size_t)index, sizeof(*value));
+    } else {
+        *value = rt_data(object)[index];
+    }
+    return 0;
+}
+
+/**
+ * @brief Indica si dos String o dos Array tienen el mismo contenido.
+ */
+int rt_equal(const RtHeap *heap, RtRef a, RtRef b, unsigned flags) {
+    if (a == b) {
+        return 1;
+    }
+    const RtObject *left = rt_object(heap, a);
+    const RtObject *right = rt_object(heap, b);
+    size_t element = flags & BC_REF_ARRAY ? 4 : 1;
+    return left->length == right->length
+        && memcmp(rt_data(left), rt_data(right), left->length * element) == 0;
+}
+
+/**
+ * @brief Escribe un String tal cual, o un Array como [1, 2, 3], y un salto de línea.
+ */
+void rt_print(const RtHeap *heap, FILE *out, RtRef ref, AstType type) {
+    const RtObject *object = rt_object(heap, ref);
+    if (type == AST_TYPE_STRING) {
+        fwrite(rt_data(object), 1, object->length, out);
+        fputc('\n', out);
+        return;
+    }
+    fputc('[', out);
+    for (uint32_t i = 0; i < object->length; i++) {
+        int32_t value;
+        memcpy(&value, rt_data(object) + 4 * (size_t)i, sizeof(value));
+        fprintf(out, i > 0 ? ", %d" : "%d", value);
+    }
+    fputs("]\n", out);
+}
+
+/**
+ * @brief Imprime los contadores de asignación (--heap-stats).
+ */
+void rt_stats_print(const RtStats *stats, FILE *out) {
+    fprintf(out, "Memoria de ejecución:\n");
+    fprintf(out, "  Regiones:        %zu objetos, %zu bytes (pico %zu bytes)\n", stats->region_objects,
+            stats->region_bytes, stats->region_peak);
+    fprintf(out, "  Pool:            %zu objetos (%zu reutilizados, %zu grandes), %zu liberados\n",
+            stats->pool_objects, stats->pool_reused, stats->large_objects, stats->pool_freed);
+    fprintf(out, "  Reservas malloc: %zu\n", stats->malloc_calls);
+}
@@ -0,0 +1,515 @@
+/**
+ * @file sampler.c
+ * @brief Temporizador, búfer y reporte del perfil por muestreo.
+ *
+ * El manejador de SIGPROF no reserva memoria ni toma locks: el recorrido de
+ * la pila de la máquina virtual o del JIT (walk) escribe en el búfer
+ * reservado por sampler_init(). La
+ * traducción a nombres y líneas se hace en sampler_report(), con la
+ * ejecución ya terminada.
+ */
+#define _GNU_SOURCE
+
+#include "../../include/sampler.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Perfil activo del proceso, o NULL. */
+static _Atomic(Sampler *) sampler_active = NULL;
+static uint64_t sampler_started;
+static timer_t sampler_timer;
+static struct sigaction sampler_previous;
+
+/**
+ * @brief Tiempo de CPU del hilo actual, en nanosegundos.
+ */
+static uint64_t thread_cpu_ns(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+    return (uint64_t)now.tv_sec * 1000000000u + (uint64_t)now.tv_nsec;
+}
+
+/**
+ * @brief Manejador de SIGPROF: toma la muestra si hay una ejecución en curso.
+ */
+static void on_sigprof(int signo, siginfo_t *info, void *context) {
+    (void)signo;
+    (void)info;
+    Sampler *sampler = atomic_load_explicit(&sampler_active, memory_order_acquire);
+    if (sampler == NULL) {
+        return;
+    }
+    SamplerWalk walk = sampler->walk;
+    if (walk != NULL) {
+        walk(sampler, context);
+    }
+}
+
+/**
+ * @brief Empieza a muestrear el hilo actual cada sampler->interval_us de CPU.
+ *
+ * @return 0 si es exitoso, 1 si ya hay otro perfil activo o no se pudo
+ *         crear el temporizador.
+ */
+int sampler_start(Sampler *sampler) {
+    Sampler *expected = NULL;
+    if (!atomic_compare_exchange_strong(&sampler_active, &expected, sampler)) {
+        return 1;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = on_sigprof;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if (sigaction(SIGPROF, &action, &sampler_previous) != 0) {
+        atomic_store(&sampler_active, NULL);
+        return 1;
+    }
+    struct sigevent event;
+    memset(&event, 0, sizeof(event));
+    event.sigev_notify = SIGEV_THREAD_ID;
+    event.sigev_signo = SIGPROF;
+    event._sigev_un._tid = (pid_t)syscall(SYS_gettid);
+    struct itimerspec spec;
+    spec.it_interval.tv_sec = sampler->interval_us / 1000000;
+    spec.it_interval.tv_nsec = (long)(sampler->interval_us % 1000000) * 1000;
+    spec.it_value = spec.it_interval;
+    if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event, &sampler_timer) != 0) {
+        sigaction(SIGPROF, &sampler_previous, NULL);
+        atomic_store(&sampler_active, NULL);
+        return 1;
+    }
+    sampler_started = thread_cpu_ns();
+    if (timer_settime(sampler_timer, 0, &spec, NULL) != 0) {
+        timer_delete(sampler_timer);
+        sigaction(SIGPROF, &sampler_previous, NULL);
+        atomic_store(&sampler_active, NULL);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Deja de muestrear.
+ *
+ * Una señal ya generada se entrega al volver de timer_delete(), antes de
+ * restaurar el manejador anterior.
+ */
+void sampler_stop(Sampler *sampler) {
+    if (atomic_load(&sampler_active) != sampler) {
+        return;
+    }
+    timer_delete(sampler_timer);
+    sampler->cpu_ns = thread_cpu_ns() - sampler_started;
+    atomic_store(&sampler_active, NULL);
+    sigaction(SIGPROF, &sampler_previous, NULL);
+}
+
+#else
+
+int sampler_start(Sampler *sampler) {
+    (void)sampler;
+    return 1;
+}
+
+void sampler_stop(Sampler *sampler) {
+    (void)sampler;
+}
+
+#endif
+
+/**
+ * @brief Prepara un perfil vacío.
+ *
+ * @param interval_us Intervalo entre muestras, en microsegundos de CPU.
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int sampler_init(Sampler *sampler, uint32_t interval_us) {
+    memset(sampler, 0, sizeof(*sampler));
+    sampler->interval_us = interval_us < SAMPLER_MIN_INTERVAL_US ? SAMPLER_MIN_INTERVAL_US : interval_us;
+    // Sin tocar: el sistema solo respalda las páginas que llegan a escribirse.
+    sampler->words = (uint64_t *)malloc(SAMPLER_BUFFER_WORDS * sizeof(uint64_t));
+    return sampler->words == NULL;
+}
+
+/**
+ * @brief Instala (o con NULL, quita) el recorrido que toma las muestras en el manejador.
+ *
+ * Se llama desde el hilo muestreado; walk_data queda escrito antes que walk.
+ */
+void sampler_attach(Sampler *sampler, SamplerWalk walk, void *walk_data) {
+    if (walk == NULL) {
+        sampler->walk = NULL;
+        atomic_signal_fence(memory_order_seq_cst);
+    }
+    sampler->walk_data = walk_data;
+    atomic_signal_fence(memory_order_seq_cst);
+    sampler->walk = walk;
+}
+
+/**
+ * @brief Espacio para los marcos de una muestra (hasta SAMPLER_MAX_DEPTH).
+ *
+ * Puede llamarse desde el manejador de la señal.
+ *
+ * @return Los marcos a completar con sampler_commit(), o NULL si el búfer
+ *         está lleno (la muestra se cuenta como descartada).
+ */
+uint64_t *sampler_begin(Sampler *sampler) {
+    if (SAMPLER_BUFFER_WORDS - sampler->length < SAMPLER_MAX_DEPTH + 1) {
+        sampler->dropped++;
+        return NULL;
+    }
+    return sampler->words + sampler->length + 1;
+}
+
+/**
+ * @brief Guarda los @p count marcos escritos desde sampler_begin().
+ */
+void sampler_commit(Sampler *sampler, uint64_t *frames, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    frames[-1] = count;
+    sampler->length += count + 1;
+    sampler->samples++;
+}
+
+/**
+ * @brief Libera un perfil (debe estar detenido).
+ */
+void sampler_free(Sampler *sampler) {
+    free(sampler->words);
+    sampler->words = NULL;
+}
+
+/* ---- Reporte ---- */
+
+/**
+ * @brief Muestras traducidas a funciones del fuente.
+ *
+ * Cada pila es una secuencia de funciones de main hacia adentro:
+ * names[starts[s] .. starts[s + 1]). El índice function_count del módulo
+ * representa el marco [runtime].
+ */
+typedef struct SamplerStacks {
+    const BcModule *module;
+    uint32_t *names;
+    size_t *starts;
+    uint32_t *leaf_lines;       /**< Línea de la posición más interna del programa */
+    uint32_t *leaf_functions;   /**< Función del fuente de esa posición */
+    size_t count;
+} SamplerStacks;
+
+/**
+ * @brief Traduce los marcos de cada muestra a funciones y la posición más interna a una línea.
+ *
+ * Un marco en un tramo expandido en línea aporta la función que lo contiene
+ * y, dentro de ella, cada función de la cadena de expansiones del tramo.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int build_stacks(const Sampler *sampler, const BcModule *module, SamplerStacks *stacks) {
+    memset(stacks, 0, sizeof(*stacks));
+    stacks->module = module;
+    size_t capacity = 2 * sampler->length + 1;
+    stacks->names = (uint32_t *)malloc(capacity * sizeof(uint32_t));
+    stacks->starts = (size_t *)malloc((sampler->samples + 1) * sizeof(size_t));
+    stacks->leaf_lines = (uint32_t *)malloc((sampler->samples + 1) * sizeof(uint32_t));
+    stacks->leaf_functions = (uint32_t *)malloc((sampler->samples + 1) * sizeof(uint32_t));
+    if (stacks->names == NULL || stacks->starts == NULL || stacks->leaf_lines == NULL
+            || stacks->leaf_functions == NULL) {
+        return 1;
+    }
+    uint32_t runtime = (uint32_t)module->function_count;
+    size_t length = 0;
+    for (size_t at = 0; at < sampler->length && stacks->count < sampler->samples;) {
+        size_t frames = (size_t)sampler->words[at];
+        const uint64_t *words = sampler->words + at + 1;
+        size_t s = stacks->count++;
+        stacks->starts[s] = length;
+        stacks->leaf_functions[s] = runtime;
+        stacks->leaf_lines[s] = 0;
+        for (size_t i = frames; i-- > 0;) {
+            uint32_t index = (uint32_t)(words[i] >> 32);
+            uint32_t pc = (uint32_t)words[i];
+            size_t depth = 0;
+            if (words[i] != SAMPLER_RUNTIME) {
+                if (index >= module->function_count) {
+                    continue;
+                }
+                depth = bc_origin_chain(&module->functions[index], pc, NULL, 0);
+            }
+            if (length + depth + 1 > capacity) {
+                size_t grown = 2 * capacity + depth + 1;
+                uint32_t *names = (uint32_t *)realloc(stacks->names, grown * sizeof(uint32_t));
+                if (names == NULL) {
+                    return 1;
+                }
+                stacks->names = names;
+                capacity = grown;
+            }
+            if (words[i] == SAMPLER_RUNTIME) {
+                stacks->names[length++] = runtime;
+                continue;
+            }
+            const BcFunction *function = &module->functions[index];
+            stacks->names[length++] = index;
+            length += bc_origin_chain(function, pc, stacks->names + length, depth);
+            stacks->leaf_functions[s] = bc_origin(function, pc);
+            stacks->leaf_lines[s] = bc_line(function, pc);
+        }
+        at += frames + 1;
+    }
+    stacks->starts[stacks->count] = length;
+    return 0;
+}
+
+static void free_stacks(SamplerStacks *stacks) {
+    free(stacks->names);
+    free(stacks->starts);
+    free(stacks->leaf_lines);
+    free(stacks->leaf_functions);
+}
+
+/** Ancho de la columna de nombres del resumen. */
+#define SAMPLER_LABEL_WIDTH 32
+#define SAMPLER_LABEL_BYTES 256
+
+static void name_label(const BcModule *module, uint32_t name, char *label, size_t size) {
+    if (name >= module->function_count) {
+        snprintf(label, size, "[runtime]");
+    } else {
+        snprintf(label, size, "%.*s", (int)module->functions[name].name_length, module->functions[name].name);
+    }
+}
+
+static void print_name(const BcModule *module, uint32_t name, FILE *out) {
+    if (name >= module->function_count) {
+        fputs("[runtime]", out);
+    } else {
+        fwrite(module->functions[name].name, 1, module->functions[name].name_length, out);
+    }
+}
+
+/** Pilas que ordena write_folded() en este hilo (qsort() no recibe contexto). */
+static _Thread_local const SamplerStacks *sort_stacks;
+
+static int compare_stacks(const void *a, const void *b) {
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+    const uint32_t *p = sort_stacks->names + sort_stacks->starts[x];
+    const uint32_t *q = sort_stacks->names + sort_stacks->starts[y];
+    size_t m = sort_stacks->starts[x + 1] - sort_stacks->starts[x];
+    size_t n = sort_stacks->starts[y + 1] - sort_stacks->starts[y];
+    for (size_t i = 0; i < m && i < n; i++) {
+        if (p[i] != q[i]) {
+            return p[i] < q[i] ? -1 : 1;
+        }
+    }
+    return (m > n) - (m < n);
+}
+
+static int same_stack(const SamplerStacks *stacks, size_t x, size_t y) {
+    size_t m = stacks->starts[x + 1] - stacks->starts[x];
+    return m == stacks->starts[y + 1] - stacks->starts[y]
+        && memcmp(stacks->names + stacks->starts[x], stacks->names + stacks->starts[y],
+                  m * sizeof(uint32_t)) == 0;
+}
+
+/**
+ * @brief Escribe una línea "main;f;g muestras" por cada pila distinta.
+ *
+ * El orden de qsort() no depende de la dirección de las pilas, así que
+ * dos perfiles con las mismas muestras dan el mismo archivo.
+ */
+static int write_folded(const SamplerStacks *stacks, FILE *out) {
+    size_t *order = (size_t *)malloc((stacks->count + 1) * sizeof(size_t));
+    if (order == NULL) {
+        return 1;
+    }
+    for (size_t s = 0; s < stacks->count; s++) {
+        order[s] = s;
+    }
+    sort_stacks = stacks;
+    qsort(order, stacks->count, sizeof(size_t), compare_stacks);
+    for (size_t i = 0; i < stacks->count;) {
+        size_t j = i + 1;
+        while (j < stacks->count && same_stack(stacks, order[i], order[j])) {
+            j++;
+        }
+        const uint32_t *names = stacks->names + stacks->starts[order[i]];
+        size_t length = stacks->starts[order[i] + 1] - stacks->starts[order[i]];
+        for (size_t k = 0; k < length; k++) {
+            if (k > 0) {
+                fputc(';', out);
+            }
+            print_name(stacks->module, names[k], out);
+        }
+        fprintf(out, " %zu\n", j - i);
+        i = j;
+    }
+    free(order);
+    return 0;
+}
+
+/**
+ * @brief Cuenta de una función o una línea en el resumen.
+ */
+typedef struct SamplerCount {
+    uint32_t function;
+    uint32_t line;
+    size_t self;                /**< Muestras en las que es la posición más interna */
+    size_t total;               /**< Muestras en las que aparece (solo funciones) */
+} SamplerCount;
+
+static int compare_counts(const void *a, const void *b) {
+    const SamplerCount *x = (const SamplerCount *)a;
+    const SamplerCount *y = (const SamplerCount *)b;
+    if (x->self != y->self) {
+        return x->self > y->self ? -1 : 1;
+    }
+    if (x->total != y->total) {
+        return x->total > y->total ? -1 : 1;
+    }
+    if (x->function != y->function) {
+        return x->function < y->function ? -1 : 1;
+    }
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static int compare_positions(const void *a, const void *b) {
+    const SamplerCount *x = (const SamplerCount *)a;
+    const SamplerCount *y = (const SamplerCount *)b;
+    if (x->function != y->function) {
+        return x->function < y->function ? -1 : 1;
+    }
+    return (x->line > y->line) - (x->line < y->line);
+}
+
+static double percent(size_t part, size_t whole) {
+    return whole > 0 ? 100.0 * (double)part / (double)whole : 0.0;
+}
+
+/**
+ * @brief Escribe las @p top funciones y líneas con más muestras propias.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int write_table(const Sampler *sampler, const SamplerStacks *stacks, const char *filename, size_t top,
+                       FILE *out) {
+    const BcModule *module = stacks->module;
+    size_t names = module->function_count + 1;
+    SamplerCount *functions = (SamplerCount *)calloc(names, sizeof(SamplerCount));
+    size_t *seen = (size_t *)malloc(names * sizeof(size_t));
+    SamplerCount *lines = (SamplerCount *)calloc(stacks->count + 1, sizeof(SamplerCount));
+    if (functions == NULL || seen == NULL || lines == NULL) {
+        free(functions);
+        free(seen);
+        free(lines);
+        return 1;
+    }
+    for (size_t f = 0; f < names; f++) {
+        functions[f].function = (uint32_t)f;
+        seen[f] = SIZE_MAX;
+    }
+    for (size_t s = 0; s < stacks->count; s++) {
+        size_t first = stacks->starts[s];
+        size_t last = stacks->starts[s + 1];
+        for (size_t k = first; k < last; k++) {
+            uint32_t name = stacks->names[k];
+            if (seen[name] != s) {
+                seen[name] = s;
+                functions[name].total++;
+            }
+        }
+        if (last > first) {
+            functions[stacks->names[last - 1]].self++;
+        }
+        lines[s].function = stacks->leaf_functions[s];
+        lines[s].line = stacks->leaf_lines[s];
+    }
+    // Las líneas: una entrada por posición distinta, con sus muestras en self.
+    qsort(lines, stacks->count, sizeof(SamplerCount), compare_positions);
+    size_t line_count = 0;
+    for (size_t i = 0; i < stacks->count; i++) {
+        if (line_count > 0 && compare_positions(&lines[line_count - 1], &lines[i]) == 0) {
+            lines[line_count - 1].self++;
+        } else {
+            lines[line_count] = lines[i];
+            lines[line_count++].self = 1;
+        }
+    }
+    qsort(functions, names, sizeof(SamplerCount), compare_counts);
+    qsort(lines, line_count, sizeof(SamplerCount), compare_counts);
+
+    size_t samples = stacks->count;
+    fprintf(out, "Perfil de la ejecución: %zu muestras en %.1f ms de CPU (intervalo de %u µs)", samples,
+            (double)sampler->cpu_ns / 1e6, sampler->interval_us);
+    if (sampler->dropped > 0) {
+        fprintf(out, " (%zu descartadas)", sampler->dropped);
+    }
+    fputc('\n', out);
+    if (samples == 0) {
+        free(functions);
+        free(seen);
+        free(lines);
+        return 0;
+    }
+    char label[SAMPLER_LABEL_BYTES];
+    // El título lleva un carácter de dos bytes: printf rellena por bytes.
+    fprintf(out, "%-*s %16s%18s\n", SAMPLER_LABEL_WIDTH + 3, "Funciones con más muestras:", "propias", "total");
+    for (size_t i = 0; i < top && i < names && functions[i].total > 0; i++) {
+        const SamplerCount *count = &functions[i];
+        name_label(module, count->function, label, sizeof(label));
+        fprintf(out, "  %-*s %8zu %5.1f %%  %8zu %5.1f %%\n", SAMPLER_LABEL_WIDTH, label, count->self,
+                percent(count->self, samples), count->total, percent(count->total, samples));
+    }
+    fprintf(out, "Líneas con más muestras:\n");
+    const char *base = strrchr(filename, '/');
+    base = base != NULL ? base + 1 : filename;
+    for (size_t i = 0; i < top && i < line_count; i++) {
+        const SamplerCount *count = &lines[i];
+        size_t used = (size_t)snprintf(label, sizeof(label), "%s:%u ", base, count->line);
+        if (used < sizeof(label)) {
+            name_label(module, count->function, label + used, sizeof(label) - used);
+        }
+        fprintf(out, "  %-*s %8zu %5.1f %%\n", SAMPLER_LABEL_WIDTH, label, count->self,
+                percent(count->self, samples));
+    }
+    free(functions);
+    free(seen);
+    free(lines);
+    return 0;
+}
+
+/**
+ * @brief Escribe el perfil de una ejecución ya terminada.
+ *
+ * @param module Programa ejecutado (las muestras son posiciones de su bytecode).
+ * @param filename Fuente del programa, para las líneas del resumen.
+ * @param folded Destino de las pilas colapsadas, o NULL.
+ * @param table Destino del resumen, o NULL.
+ * @param top Funciones y líneas del resumen.
+ * @return 0 si es exitoso, 1 si falta memoria o hay error de escritura.
+ */
+int sampler_report(const Sampler *sampler, const BcModule *module, const char *filename, FILE *folded,
+                   FILE *table, size_t top) {
+    SamplerStacks stacks;
+    int failed = build_stacks(sampler, module, &stacks);
+    if (!failed && folded != NULL) {
+        failed = write_folded(&stacks, folded) != 0 || ferror(folded);
+    }
+    if (!failed && table != NULL) {
+        failed = write_table(sampler, &stacks, filename, top, table);
+    }
+    free_stacks(&stacks);
+    return failed;
+}
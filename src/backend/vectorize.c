@@ -0,0 +1,394 @@
+/**
+ * @file vectorize.c
+ * @brief Reconocimiento de ciclos vectorizables y su ejecución por bloques.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/vectorize.h"
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Núcleo en construcción.
+ */
+typedef struct VecBuilder {
+    const AstNode *loop;
+    BcKernel *kernel;
+    BcVecInstr code[BC_VECTOR_MAX_CODE];
+    uint32_t length;
+    uint32_t depth;         /**< Valores en la pila de la expresión actual */
+    uint32_t max_depth;
+    int32_t hole;           /**< Acumulador que se traduce como la constante hole_value, o -1 */
+    int32_t hole_value;
+} VecBuilder;
+
+/**
+ * @brief Identidad de una reducción (valor inicial de cada carril).
+ */
+int32_t vec_identity(BcReduce kind) {
+    switch (kind) {
+        case BC_REDUCE_MUL: return 1;
+        case BC_REDUCE_MIN: return INT32_MAX;
+        case BC_REDUCE_MAX: return INT32_MIN;
+        default: return 0;
+    }
+}
+
+static int push(VecBuilder *v, BcVecOp op, uint32_t slot, int32_t value, int effect) {
+    if (v->length == BC_VECTOR_MAX_CODE) {
+        return 0;
+    }
+    BcVecInstr *instr = &v->code[v->length++];
+    instr->op = (uint8_t)op;
+    instr->slot = (uint16_t)slot;
+    instr->value = value;
+    v->depth = (uint32_t)((int)v->depth + effect);
+    if (v->depth > v->max_depth) {
+        v->max_depth = v->depth;
+    }
+    return v->max_depth <= BC_VECTOR_MAX_DEPTH;
+}
+
+/**
+ * @brief Traduce una expresión i32 sin efectos a postfijo.
+ *
+ * @return 1 si es exitoso, 0 si la expresión no es vectorizable.
+ */
+static int translate(VecBuilder *v, const AstNode *e) {
+    if (e->type != AST_TYPE_I32) {
+        return 0;
+    }
+    switch (e->kind) {
+        case AST_NUMBER:
+            return push(v, BC_VEC_CONST, 0, (int32_t)e->value, 1);
+        case AST_NAME:
+            if (e->slot == v->hole) {
+                return push(v, BC_VEC_CONST, 0, v->hole_value, 1);
+            }
+            if (e->slot == v->loop->slot) {
+                return push(v, BC_VEC_INDEX, 0, 0, 1);
+            }
+            return push(v, BC_VEC_LOAD, (uint32_t)e->slot, 0, 1);
+        case AST_UNARY:
+            if ((e->op != TOKEN_MINUS && e->op != TOKEN_PLUS) || !translate(v, e->a)) {
+                return 0;
+            }
+            return e->op == TOKEN_MINUS ? push(v, BC_VEC_NEG, 0, 0, 0) : 1;
+        case AST_BINARY: {
+            BcVecOp op;
+            switch (e->op) {
+                case TOKEN_PLUS: op = BC_VEC_ADD; break;
+                case TOKEN_MINUS: op = BC_VEC_SUB; break;
+                case TOKEN_STAR: op = BC_VEC_MUL; break;
+                default: return 0;
+            }
+            return translate(v, e->a) && translate(v, e->b) && push(v, op, 0, 0, -1);
+        }
+        default:
+            return 0;
+    }
+}
+
+static int is_variable(const AstNode *e, int32_t slot) {
+    return e->kind == AST_NAME && e->slot == slot;
+}
+
+static int count_uses(const AstNode *e, int32_t slot) {
+    if (e == NULL) {
+        return 0;
+    }
+    return is_variable(e, slot) + count_uses(e->a, slot) + count_uses(e->b, slot);
+}
+
+/**
+ * @brief Indica si @p slot es un término de la suma @p e (o un factor del producto si @p op es '*').
+ *
+ * Un término no puede estar a la derecha de un '-'.
+ */
+static int is_operand(const AstNode *e, int32_t slot, TokenType op) {
+    if (is_variable(e, slot)) {
+        return 1;
+    }
+    if (e->kind == AST_UNARY && e->op == TOKEN_PLUS) {
+        return is_operand(e->a, slot, op);
+    }
+    if (e->kind != AST_BINARY) {
+        return 0;
+    }
+    if (op == TOKEN_STAR) {
+        return e->op == TOKEN_STAR && (is_operand(e->a, slot, op) || is_operand(e->b, slot, op));
+    }
+    if (e->op == TOKEN_MINUS) {
+        return is_operand(e->a, slot, op);
+    }
+    return e->op == TOKEN_PLUS && (is_operand(e->a, slot, op) || is_operand(e->b, slot, op));
+}
+
+/**
+ * @brief Compara dos expresiones ya analizadas.
+ */
+static int same_expression(const AstNode *x, const AstNode *y) {
+    if (x == NULL || y == NULL) {
+        return x == y;
+    }
+    if (x->kind != y->kind || x->op != y->op || x->slot != y->slot || x->value != y->value) {
+        return 0;
+    }
+    switch (x->kind) {
+        case AST_NUMBER:
+        case AST_NAME:
+            return 1;
+        case AST_UNARY:
+            return same_expression(x->a, y->a);
+        case AST_BINARY:
+            return same_expression(x->a, y->a) && same_expression(x->b, y->b);
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Agrega la reducción slot (kind) e, con e negada si @p negate.
+ */
+static int add_reduction(VecBuilder *v, BcReduce kind, const AstNode *target, const AstNode *e,
+                         int negate) {
+    BcKernel *k = v->kernel;
+    if (k->reduction_count == BC_VECTOR_MAX_REDUCTIONS || target->type != AST_TYPE_I32
+            || target->slot == v->loop->slot) {
+        return 0;
+    }
+    BcReduction *r = &k->reductions[k->reduction_count++];
+    r->kind = (uint8_t)kind;
+    r->slot = (uint16_t)target->slot;
+    r->start = v->length;
+    v->depth = 0;
+    int translated = translate(v, e);
+    v->hole = -1;
+    if (!translated || (negate && !push(v, BC_VEC_NEG, 0, 0, 0))) {
+        return 0;
+    }
+    r->length = v->length - r->start;
+    return 1;
+}
+
+/**
+ * @brief acc op= e, o acc = e donde acc es un término de e (o un factor).
+ *
+ * En el segundo caso cada iteración suma (o multiplica) e con acc en 0 (o en 1).
+ */
+static int match_assign(VecBuilder *v, const AstNode *assign) {
+    const AstNode *target = assign->a;
+    const AstNode *value = assign->b;
+    if (target->kind != AST_NAME) {
+        return 0;
+    }
+    switch (assign->op) {
+        case TOKEN_PLUS_EQUAL: return add_reduction(v, BC_REDUCE_ADD, target, value, 0);
+        case TOKEN_MINUS_EQUAL: return add_reduction(v, BC_REDUCE_ADD, target, value, 1);
+        case TOKEN_STAR_EQUAL: return add_reduction(v, BC_REDUCE_MUL, target, value, 0);
+        case TOKEN_EQUAL: break;
+        default: return 0;
+    }
+    if (count_uses(value, target->slot) != 1) {
+        return 0;
+    }
+    v->hole = target->slot;
+    if (is_operand(value, target->slot, TOKEN_PLUS)) {
+        v->hole_value = 0;
+        return add_reduction(v, BC_REDUCE_ADD, target, value, 0);
+    }
+    if (is_operand(value, target->slot, TOKEN_STAR)) {
+        v->hole_value = 1;
+        return add_reduction(v, BC_REDUCE_MUL, target, value, 0);
+    }
+    v->hole = -1;
+    return 0;
+}
+
+/**
+ * @brief if e < acc { acc = e; } y sus variantes de mínimo y máximo.
+ */
+static int match_if(VecBuilder *v, const AstNode *statement) {
+    const AstNode *condition = statement->a;
+    const AstNode *block = statement->b;
+    if (statement->c != NULL || condition->kind != AST_BINARY || block->a == NULL
+            || block->a->next != NULL || block->a->kind != AST_EXPR_STMT) {
+        return 0;
+    }
+    const AstNode *assign = block->a->a;
+    if (assign->kind != AST_ASSIGN || assign->op != TOKEN_EQUAL || assign->a->kind != AST_NAME) {
+        return 0;
+    }
+    int32_t acc = assign->a->slot;
+    const AstNode *value = assign->b;
+    int less;
+    switch (condition->op) {
+        case TOKEN_LESS: case TOKEN_LESS_EQUAL: less = 1; break;
+        case TOKEN_GREATER: case TOKEN_GREATER_EQUAL: less = 0; break;
+        default: return 0;
+    }
+    // value < acc: mínimo; acc < value: máximo (igual con > invertido).
+    if (same_expression(condition->a, value) && is_variable(condition->b, acc)) {
+        return add_reduction(v, less ? BC_REDUCE_MIN : BC_REDUCE_MAX, assign->a, value, 0);
+    }
+    if (is_variable(condition->a, acc) && same_expression(condition->b, value)) {
+        return add_reduction(v, less ? BC_REDUCE_MAX : BC_REDUCE_MIN, assign->a, value, 0);
+    }
+    return 0;
+}
+
+/**
+ * @brief Reconoce un ciclo for vectorizable y construye su núcleo.
+ *
+ * @param loop Nodo AST_FOR analizado.
+ * @param kernel Destino; su code se reserva con malloc solo si se reconoce.
+ * @return 1 si el ciclo es vectorizable, 0 si no, -1 si falta memoria.
+ */
+int vec_match_for(const AstNode *loop, BcKernel *kernel) {
+    memset(kernel, 0, sizeof(*kernel));
+    VecBuilder v;
+    memset(&v, 0, sizeof(v));
+    v.loop = loop;
+    v.kernel = kernel;
+    v.hole = -1;
+    const AstNode *body = loop->b;
+    if (body->a == NULL) {
+        return 0;
+    }
+    for (const AstNode *statement = body->a; statement != NULL; statement = statement->next) {
+        int matched = 0;
+        if (statement->kind == AST_EXPR_STMT && statement->a->kind == AST_ASSIGN) {
+            matched = match_assign(&v, statement->a);
+        } else if (statement->kind == AST_IF) {
+            matched = match_if(&v, statement);
+        }
+        if (!matched) {
+            return 0;
+        }
+    }
+    // Sin dependencias entre iteraciones: cada acumulador aparece una vez y
+    // ninguna expresión lee un acumulador.
+    for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+        for (uint32_t q = r + 1; q < kernel->reduction_count; q++) {
+            if (kernel->reductions[r].slot == kernel->reductions[q].slot) {
+                return 0;
+            }
+        }
+        for (uint32_t i = 0; i < v.length; i++) {
+            if (v.code[i].op == BC_VEC_LOAD && v.code[i].slot == kernel->reductions[r].slot) {
+                return 0;
+            }
+        }
+    }
+    kernel->index_slot = (uint16_t)loop->slot;
+    kernel->end_slot = (uint16_t)loop->aux;
+    kernel->code_length = v.length;
+    kernel->code = (BcVecInstr *)malloc(v.length * sizeof(BcVecInstr));
+    if (kernel->code == NULL) {
+        return -1;
+    }
+    memcpy(kernel->code, v.code, v.length * sizeof(BcVecInstr));
+    return 1;
+}
+
+/**
+ * @brief Evalúa una expresión sobre @p n iteraciones a partir de @p first.
+ *
+ * @return El bloque con el resultado.
+ */
+static const uint32_t *evaluate(const BcVecInstr *code, uint32_t length, const int32_t *locals,
+                                uint32_t first, size_t n, uint32_t (*stack)[VEC_BLOCK]) {
+    size_t top = 0;
+    for (uint32_t pc = 0; pc < length; pc++) {
+        const BcVecInstr *instr = &code[pc];
+        uint32_t *a = stack[top - (top > 0)];
+        uint32_t *b = stack[top > 0 ? top - 1 : 0];
+        switch ((BcVecOp)instr->op) {
+            case BC_VEC_INDEX:
+                for (size_t j = 0; j < n; j++) {
+                    stack[top][j] = first + (uint32_t)j;
+                }
+                top++;
+                break;
+            case BC_VEC_CONST:
+            case BC_VEC_LOAD: {
+                uint32_t value = (uint32_t)(instr->op == BC_VEC_CONST ? instr->value : locals[instr->slot]);
+                for (size_t j = 0; j < n; j++) {
+                    stack[top][j] = value;
+                }
+                top++;
+                break;
+            }
+            case BC_VEC_NEG:
+                for (size_t j = 0; j < n; j++) {
+                    b[j] = 0u - b[j];
+                }
+                break;
+            default:
+                a = stack[top - 2];
+                if (instr->op == BC_VEC_ADD) {
+                    for (size_t j = 0; j < n; j++) {
+                        a[j] += b[j];
+                    }
+                } else if (instr->op == BC_VEC_SUB) {
+                    for (size_t j = 0; j < n; j++) {
+                        a[j] -= b[j];
+                    }
+                } else {
+                    for (size_t j = 0; j < n; j++) {
+                        a[j] *= b[j];
+                    }
+                }
+                top--;
+                break;
+        }
+    }
+    return stack[0];
+}
+
+/**
+ * @brief Ejecuta todas las iteraciones pendientes del núcleo (máquina virtual).
+ *
+ * Deja la variable del ciclo en el fin, así el ciclo escalar no itera.
+ */
+void vec_execute(const BcKernel *kernel, int32_t *locals) {
+    int32_t first = locals[kernel->index_slot];
+    int32_t end = locals[kernel->end_slot];
+    if (first >= end) {
+        return;
+    }
+    uint32_t stack[BC_VECTOR_MAX_DEPTH][VEC_BLOCK];
+    for (uint32_t r = 0; r < kernel->reduction_count; r++) {
+        const BcReduction *reduction = &kernel->reductions[r];
+        uint32_t acc = (uint32_t)locals[reduction->slot];
+        for (int64_t at = first; at < end; at += VEC_BLOCK) {
+            size_t n = end - at < VEC_BLOCK ? (size_t)(end - at) : VEC_BLOCK;
+            const uint32_t *values = evaluate(kernel->code + reduction->start, reduction->length, locals,
+                                              (uint32_t)at, n, stack);
+            switch ((BcReduce)reduction->kind) {
+                case BC_REDUCE_ADD:
+                    for (size_t j = 0; j < n; j++) {
+                        acc += values[j];
+                    }
+                    break;
+                case BC_REDUCE_MUL:
+                    for (size_t j = 0; j < n; j++) {
+                        acc *= values[j];
+                    }
+                    break;
+                case BC_REDUCE_MIN:
+                    for (size_t j = 0; j < n; j++) {
+                        acc = (int32_t)values[j] < (int32_t)acc ? values[j] : acc;
+                    }
+                    break;
+                case BC_REDUCE_MAX:
+                    for (size_t j = 0; j < n; j++) {
+                        acc = (int32_t)values[j] > (int32_t)acc ? values[j] : acc;
+                    }
+                    break;
+            }
+        }
+        locals[reduction->slot] = (int32_t)acc;
+    }
+    locals[kernel->index_slot] = end;
+}
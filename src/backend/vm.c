@@ -0,0 +1,806 @@
+/**
+ * @file vm.c
+ * @brief Máquina virtual de pila para el bytecode.
+ *
+ * Las ranuras locales de cada llamada y su pila de operandos comparten un
+ * único arreglo: los argumentos que apila el llamador se convierten en las
+ * primeras ranuras del llamado, sin copiarlos. Los String y Array viven en
+ * un RtHeap propio de la ejecución.
+ *
+ * Cada función se ejecuta sobre una copia de su código, preparada en su
+ * primera llamada: el byte de código de cada instrucción que empieza una
+ * secuencia frecuente (VM_SUPER2, VM_SUPER3) se reemplaza por el de una
+ * superinstrucción que ejecuta toda la secuencia con un solo despacho. Los
+ * operandos no cambian, así que los saltos siguen siendo válidos. call e
+ * index se reescriben además tras su primera ejecución (quickening).
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/vm.h"
+#include "../../include/vectorize.h"
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Devuelve la descripción de un estado de ejecución.
+ */
+const char *run_status_message(RunStatus status) {
+    switch (status) {
+        case RUN_OK: return "ok";
+        case RUN_DIVISION_BY_ZERO: return "división entre cero";
+        case RUN_STACK_OVERFLOW: return "desbordamiento de la pila de llamadas";
+        case RUN_OUT_OF_MEMORY: return "memoria insuficiente";
+        case RUN_UNSUPPORTED: return "el JIT no está disponible en esta plataforma";
+        case RUN_INDEX_OUT_OF_RANGE: return "índice fuera de rango";
+        default: return "?";
+    }
+}
+
+/**
+ * @brief Escribe un valor de print() seguido de un salto de línea.
+ *
+ * Los bool se escriben como true/false, los char como su carácter UTF-8 y
+ * los String y Array como en rt_print().
+ */
+void run_print_value(FILE *out, const RtHeap *heap, int32_t value, AstType type) {
+    if (ast_type_is_reference(type)) {
+        rt_print(heap, out, (RtRef)value, type);
+    } else if (type == AST_TYPE_BOOL) {
+        fputs(value ? "true\n" : "false\n", out);
+    } else if (type == AST_TYPE_CHAR) {
+        uint32_t c = (uint32_t)value;
+        char bytes[5];
+        size_t length;
+        if (c < 0x80) {
+            bytes[0] = (char)c;
+            length = 1;
+        } else if (c < 0x800) {
+            bytes[0] = (char)(0xC0 | (c >> 6));
+            bytes[1] = (char)(0x80 | (c & 0x3F));
+            length = 2;
+        } else if (c < 0x10000) {
+            bytes[0] = (char)(0xE0 | (c >> 12));
+            bytes[1] = (char)(0x80 | ((c >> 6) & 0x3F));
+            bytes[2] = (char)(0x80 | (c & 0x3F));
+            length = 3;
+        } else {
+            bytes[0] = (char)(0xF0 | (c >> 18));
+            bytes[1] = (char)(0x80 | ((c >> 12) & 0x3F));
+            bytes[2] = (char)(0x80 | ((c >> 6) & 0x3F));
+            bytes[3] = (char)(0x80 | (c & 0x3F));
+            length = 4;
+        }
+        bytes[length++] = '\n';
+        fwrite(bytes, 1, length, out);
+    } else {
+        fprintf(out, "%d\n", value);
+    }
+}
+
+/**
+ * @brief Llamada en curso.
+ */
+typedef struct VmFrame {
+    size_t function;
+    uint8_t *pc;            /**< Instrucción de retorno (al suspenderse) */
+    size_t base;            /**< Primera ranura en la pila */
+} VmFrame;
+
+/*
+ * Superinstrucciones: X(código, instrucciones que ejecuta en orden). Salen
+ * de las secuencias más frecuentes de vm_profile_print() sobre los
+ * programas de tests/programs/ y bench/programs/; solo la última puede
+ * saltar, llamar o retornar. Se prueban primero los tríos y, en cada lista,
+ * en orden.
+ */
+#define VM_SUPER3(X) \
+    X(VM_LOAD_CONST_ADD,       BC_LOAD, BC_CONST, BC_ADD) \
+    X(VM_LOAD_CONST_LT,        BC_LOAD, BC_CONST, BC_LT) \
+    X(VM_LOAD_CONST_MOD,       BC_LOAD, BC_CONST, BC_MOD) \
+    X(VM_CONST_EQ_JUMP_FALSE,  BC_CONST, BC_EQ, BC_JUMP_FALSE) \
+    X(VM_LOAD_LOAD_LT,         BC_LOAD, BC_LOAD, BC_LT) \
+    X(VM_LOAD_CONST_SUB,       BC_LOAD, BC_CONST, BC_SUB) \
+    X(VM_LOAD_CONST_MUL,       BC_LOAD, BC_CONST, BC_MUL)
+
+#define VM_SUPER2(X) \
+    X(VM_LOAD_LOAD,            BC_LOAD, BC_LOAD) \
+    X(VM_LOAD_CONST,           BC_LOAD, BC_CONST) \
+    X(VM_ADD_STORE,            BC_ADD, BC_STORE) \
+    X(VM_LT_JUMP_FALSE,        BC_LT, BC_JUMP_FALSE) \
+    X(VM_STORE_JUMP,           BC_STORE, BC_JUMP) \
+    X(VM_STORE_LOAD,           BC_STORE, BC_LOAD) \
+    X(VM_STORE_STORE,          BC_STORE, BC_STORE) \
+    X(VM_CONST_STORE,          BC_CONST, BC_STORE) \
+    X(VM_LOAD_ADD,             BC_LOAD, BC_ADD) \
+    X(VM_LOAD_RETURN,          BC_LOAD, BC_RETURN)
+
+/**
+ * @brief Instrucciones propias de la máquina virtual, a continuación de BcOp.
+ */
+typedef enum VmOp {
+    VM_CALL_READY = BC_OP_COUNT, /**< call cuyo llamado ya está preparado */
+    VM_INDEX_ARRAY,             /**< index sobre un Array */
+    VM_INDEX_STRING,            /**< index sobre un String */
+#define VM_ENUM3(op, first, second, third) op,
+#define VM_ENUM2(op, first, second) op,
+    VM_SUPER3(VM_ENUM3)
+    VM_SUPER2(VM_ENUM2)
+#undef VM_ENUM3
+#undef VM_ENUM2
+    VM_OP_COUNT
+} VmOp;
+
+/**
+ * @brief Superinstrucción: código e instrucciones que ejecuta.
+ */
+typedef struct VmSuper {
+    uint8_t op;
+    uint8_t length;
+    uint8_t ops[3];
+} VmSuper;
+
+static const VmSuper SUPERS[] = {
+#define VM_ROW3(op, first, second, third) { op, 3, { first, second, third } },
+#define VM_ROW2(op, first, second) { op, 2, { first, second, 0 } },
+    VM_SUPER3(VM_ROW3)
+    VM_SUPER2(VM_ROW2)
+#undef VM_ROW3
+#undef VM_ROW2
+};
+
+#define VM_SUPER_COUNT (sizeof(SUPERS) / sizeof(SUPERS[0]))
+
+/**
+ * @brief Indica si una instrucción puede no continuar con la siguiente.
+ */
+static int is_control(BcOp op) {
+    return op == BC_JUMP || op == BC_JUMP_FALSE || op == BC_JUMP_TRUE || op == BC_CALL || op == BC_RETURN;
+}
+
+/**
+ * @brief Copia el código de una función con sus superinstrucciones.
+ *
+ * Solo se reescribe el byte de código de la primera instrucción de cada
+ * secuencia; sus operandos y las instrucciones siguientes quedan intactos,
+ * así que los desplazamientos no cambian y un salto a la mitad de una
+ * secuencia sigue ejecutando el código original desde ahí. Por eso cada
+ * instrucción puede empezar su propia superinstrucción: de atrás hacia
+ * adelante, se elige en cada una la que deja menos despachos hasta el
+ * siguiente salto (cost).
+ *
+ * @return La copia (liberar con free()), o NULL si falta memoria.
+ */
+static uint8_t *prepare(const BcFunction *function) {
+    size_t count = 0;
+    for (size_t pc = 0; pc < function->length; pc += 1 + bc_operand_size((BcOp)function->code[pc])) {
+        count++;
+    }
+    uint8_t *code = (uint8_t *)malloc(function->length > 0 ? function->length : 1);
+    size_t *starts = (size_t *)malloc((count + 1) * sizeof(size_t));
+    size_t *cost = (size_t *)malloc((count + 1) * sizeof(size_t));
+    if (code == NULL || starts == NULL || cost == NULL) {
+        free(code);
+        free(starts);
+        free(cost);
+        return NULL;
+    }
+    memcpy(code, function->code, function->length);
+    count = 0;
+    for (size_t pc = 0; pc < function->length; pc += 1 + bc_operand_size((BcOp)function->code[pc])) {
+        starts[count++] = pc;
+    }
+    cost[count] = 0;
+    for (size_t k = count; k-- > 0;) {
+        const uint8_t *op = &function->code[starts[k]];
+        if (is_control((BcOp)*op)) {
+            cost[k] = 1;
+            continue;
+        }
+        cost[k] = 1 + cost[k + 1];
+        for (size_t i = 0; i < VM_SUPER_COUNT; i++) {
+            const VmSuper *super = &SUPERS[i];
+            size_t j = 0;
+            while (j < super->length && k + j < count && function->code[starts[k + j]] == super->ops[j]
+                   && (j + 1 == super->length || !is_control((BcOp)super->ops[j]))) {
+                j++;
+            }
+            if (j < super->length) {
+                continue;
+            }
+            size_t rest = is_control((BcOp)super->ops[j - 1]) ? 0 : cost[k + j];
+            if (1 + rest < cost[k]) {
+                cost[k] = 1 + rest;
+                code[starts[k]] = super->op;
+            }
+        }
+    }
+    free(starts);
+    free(cost);
+    return code;
+}
+
+/**
+ * @brief Libera el código preparado de cada función.
+ */
+static void release_code(uint8_t **codes, size_t count, int copied) {
+    if (codes != NULL && copied) {
+        for (size_t i = 0; i < count; i++) {
+            free(codes[i]);
+        }
+    }
+    free(codes);
+}
+
+/**
+ * @brief Secuencia en curso de vm_execute() con un perfil.
+ */
+typedef struct VmHistory {
+    const uint8_t *next;        /**< Instrucción que sigue sin salto a la anterior, o NULL */
+    int previous;               /**< Anterior */
+    int before;                 /**< Anterior a la anterior, o -1 */
+} VmHistory;
+
+/**
+ * @brief Cuenta la instrucción @p op en @p pc y sus pares y tríos con las anteriores.
+ */
+static void profile_step(VmProfile *profile, VmHistory *history, const uint8_t *pc, BcOp op) {
+    profile->dispatches++;
+    profile->ops[op]++;
+    if (pc == history->next) {
+        profile->pairs[(size_t)history->previous * BC_OP_COUNT + op]++;
+        if (history->before >= 0) {
+            profile->triples[((size_t)history->before * BC_OP_COUNT + history->previous) * BC_OP_COUNT + op]++;
+        }
+        history->before = history->previous;
+    } else {
+        history->before = -1;
+    }
+    history->previous = op;
+    history->next = is_control(op) ? NULL : pc + 1 + bc_operand_size(op);
+}
+
+/**
+ * @brief Amplía la pila para que quepan @p needed valores.
+ */
+static int grow_stack(int32_t **stack, size_t *capacity, size_t needed) {
+    if (needed <= *capacity) {
+        return 0;
+    }
+    size_t grown = *capacity * 2;
+    while (grown < needed) {
+        grown *= 2;
+    }
+    int32_t *larger = (int32_t *)realloc(*stack, grown * sizeof(int32_t));
+    if (larger == NULL) {
+        return 1;
+    }
+    *stack = larger;
+    *capacity = grown;
+    return 0;
+}
+
+/** Operandos de las instrucciones binarias, desapilados. */
+#define POP2() (sp -= 2, a = sp[0], b = sp[1])
+
+/*
+ * Cuerpo de cada instrucción, sin el despacho: pc llega tras su byte de
+ * código y queda tras sus operandos (o en el destino del salto). Con q, la
+ * instrucción se reescribe en el código como su variante especializada.
+ * Una superinstrucción encadena los cuerpos de sus instrucciones saltando
+ * el byte de código de cada una, de modo que pc - 1 es siempre el de la
+ * instrucción en curso, como espera fail_at.
+ */
+#define VM_BINARY(expr) do { POP2(); *sp++ = (expr); } while (0)
+#define VM_JUMP_IF(cond) do { pc = (cond) ? code + bc_read_u32(pc) : pc + 4; } while (0)
+#define VM_DIVIDE(quotient) \
+    do { \
+        POP2(); \
+        if (b == 0) { \
+            result->status = RUN_DIVISION_BY_ZERO; \
+            goto fail_at; \
+        } \
+        *sp++ = b == -1 ? (quotient ? (int32_t)(0u - (uint32_t)a) : 0) : quotient ? a / b : a % b; \
+    } while (0)
+
+#define VM_BC_CONST(q)       do { *sp++ = (int32_t)bc_read_u32(pc); pc += 4; } while (0)
+#define VM_BC_LOAD(q)        do { *sp++ = locals[bc_read_u16(pc)]; pc += 2; } while (0)
+#define VM_BC_STORE(q)       do { locals[bc_read_u16(pc)] = *--sp; pc += 2; } while (0)
+#define VM_BC_POP(q)         do { sp--; } while (0)
+#define VM_BC_ADD(q)         VM_BINARY((int32_t)((uint32_t)a + (uint32_t)b))
+#define VM_BC_SUB(q)         VM_BINARY((int32_t)((uint32_t)a - (uint32_t)b))
+#define VM_BC_MUL(q)         VM_BINARY((int32_t)((uint32_t)a * (uint32_t)b))
+#define VM_BC_DIV(q)         VM_DIVIDE(1)
+#define VM_BC_MOD(q)         VM_DIVIDE(0)
+#define VM_BC_NEG(q)         do { sp[-1] = (int32_t)(0u - (uint32_t)sp[-1]); } while (0)
+#define VM_BC_NOT(q)         do { sp[-1] ^= 1; } while (0)
+#define VM_BC_EQ(q)          VM_BINARY(a == b)
+#define VM_BC_NE(q)          VM_BINARY(a != b)
+#define VM_BC_LT(q)          VM_BINARY(a < b)
+#define VM_BC_LE(q)          VM_BINARY(a <= b)
+#define VM_BC_GT(q)          VM_BINARY(a > b)
+#define VM_BC_GE(q)          VM_BINARY(a >= b)
+#define VM_BC_JUMP(q)        do { pc = code + bc_read_u32(pc); } while (0)
+#define VM_BC_JUMP_FALSE(q)  VM_JUMP_IF(*--sp == 0)
+#define VM_BC_JUMP_TRUE(q)   VM_JUMP_IF(*--sp != 0)
+#define VM_BC_CALL(q) \
+    do { \
+        callee = bc_read_u16(pc); \
+        if (q) { \
+            pc[-1] = VM_CALL_READY; \
+        } \
+        if (codes[callee] == NULL && (codes[callee] = prepare(&module->functions[callee])) == NULL) { \
+            frames[depth - 1].function = callee; \
+            result->status = RUN_OUT_OF_MEMORY; \
+            goto fail; \
+        } \
+        goto call; \
+    } while (0)
+#define VM_BC_RETURN(q)      goto leave
+#define VM_BC_PRINT(q)       do { run_print_value(out, heap, *--sp, (AstType)*pc++); } while (0)
+#define VM_BC_VECTOR(q) \
+    do { \
+        vec_execute(&module->functions[frames[depth - 1].function].kernels[bc_read_u16(pc)], locals); \
+        pc += 2; \
+    } while (0)
+#define VM_BC_ENTER(q) \
+    do { \
+        if (rt_enter(heap) != 0) { \
+            result->status = RUN_OUT_OF_MEMORY; \
+            goto fail; \
+        } \
+    } while (0)
+#define VM_BC_LEAVE(q)       do { rt_leave(heap, (RtRef)sp[-1], *pc++); } while (0)
+#define VM_BC_CONCAT(q) \
+    do { \
+        POP2(); \
+        if (rt_concat(heap, (RtRef)a, (RtRef)b, *pc++, &ref) != 0) { \
+            result->status = RUN_OUT_OF_MEMORY; \
+            goto fail; \
+        } \
+        *sp++ = (int32_t)ref; \
+    } while (0)
+#define VM_BC_ARRAY(q) \
+    do { \
+        uint32_t operand = bc_read_u32(pc); \
+        uint32_t count = operand & 0xFFFF; \
+        RtObject *object; \
+        pc += 4; \
+        if (rt_alloc(heap, count, operand >> 16, &ref, &object) != 0) { \
+            result->status = RUN_OUT_OF_MEMORY; \
+            goto fail; \
+        } \
+        sp -= count; \
+        memcpy(rt_data(object), sp, count * sizeof(int32_t)); \
+        *sp++ = (int32_t)ref; \
+    } while (0)
+#define VM_BC_INDEX(q) \
+    do { \
+        if (q) { \
+            pc[-1] = *pc & BC_REF_ARRAY ? VM_INDEX_ARRAY : VM_INDEX_STRING; \
+        } \
+        POP2(); \
+        if (rt_index(heap, (RtRef)a, b, *pc, sp) != 0) { \
+            result->status = RUN_INDEX_OUT_OF_RANGE; \
+            goto fail_at; \
+        } \
+        sp++; \
+        pc++; \
+    } while (0)
+#define VM_BC_LENGTH(q)      do { sp[-1] = (int32_t)rt_object(heap, (RtRef)sp[-1])->length; } while (0)
+#define VM_BC_EQUAL(q)       VM_BINARY(rt_equal(heap, (RtRef)a, (RtRef)b, *pc++))
+#define VM_BC_LITERAL(q)     VM_BC_CONST(q)
+
+/** index especializado: @p element lee el elemento i de object. */
+#define VM_INDEX(element) \
+    do { \
+        POP2(); \
+        const RtObject *object = rt_object(heap, (RtRef)a); \
+        if (b < 0 || (uint32_t)b >= object->length) { \
+            result->status = RUN_INDEX_OUT_OF_RANGE; \
+            goto fail_at; \
+        } \
+        *sp++ = (element); \
+        pc++; \
+    } while (0)
+
+/**
+ * @brief Elemento i32 de un Array.
+ */
+static inline int32_t array_element(const RtObject *object, int32_t index) {
+    int32_t value;
+    memcpy(&value, rt_data(object) + 4 * (size_t)index, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief Ejecución en curso de vm_execute().
+ */
+typedef struct VmState {
+    const BcModule *module;
+    uint8_t **codes;            /**< Código de cada función, o NULL si aún no se preparó */
+    int quicken;                /**< 1 si codes son copias que se pueden reescribir */
+    int32_t *stack;             /**< Ranuras y operandos de todas las llamadas */
+    size_t capacity;
+    VmFrame *frames;            /**< RUN_MAX_DEPTH llamadas */
+    RtHeap heap;
+    FILE *out;                  /**< Destino de print() */
+} VmState;
+
+/*
+ * Con sampling, instrucción en curso y llamadas en frames del intérprete de
+ * este hilo. Por hilo y no en VmState: el ciclo no necesita otro registro
+ * para escribirlas.
+ */
+static _Thread_local const uint8_t *volatile vm_sample_pc;
+static _Thread_local volatile size_t vm_sample_depth;
+
+/**
+ * @brief Toma una muestra de --prof desde el manejador de SIGPROF.
+ *
+ * La llamada más interna se atribuye a la instrucción en curso que publica
+ * el intérprete y las demás a su call. Entre una llamada o un retorno y el
+ * despacho siguiente, pc y la profundidad publicados pueden no
+ * corresponder: esa muestra se descarta.
+ */
+static void walk_interpreter(Sampler *sampler, void *context) {
+    (void)context;
+    const VmState *vm = (const VmState *)sampler->walk_data;
+    size_t depth = vm_sample_depth;
+    const uint8_t *pc = vm_sample_pc;
+    const VmFrame *frame = &vm->frames[depth - 1];
+    const uint8_t *code = vm->codes[frame->function];
+    if (pc == NULL || pc < code || pc >= code + vm->module->functions[frame->function].length) {
+        sampler->dropped++;
+        return;
+    }
+    uint64_t *words = sampler_begin(sampler);
+    if (words == NULL) {
+        return;
+    }
+    size_t count = depth < SAMPLER_MAX_DEPTH ? depth : SAMPLER_MAX_DEPTH;
+    words[0] = sampler_frame((uint32_t)frame->function, (uint32_t)(pc - code));
+    for (size_t i = 1; i < count; i++) {
+        frame = &vm->frames[depth - 1 - i];
+        words[i] = sampler_frame((uint32_t)frame->function,
+                                 (uint32_t)(frame->pc - vm->codes[frame->function]) - 1);
+    }
+    sampler_commit(sampler, words, count);
+}
+
+/** El intérprete se copia en cada variante, con counting, profiling y sampling constantes. */
+#define VM_TEMPLATE static inline __attribute__((always_inline))
+
+/**
+ * @brief Ejecuta main desde su primera instrucción.
+ *
+ * Contar los despachos cuesta un contador vivo en el ciclo más caliente,
+ * así que solo lo hacen las variantes que lo piden. Con sampling, cada
+ * despacho publica pc en vm_sample_pc y cada llamada y retorno la
+ * profundidad, para que walk_interpreter() tome la muestra en el momento:
+ * es una escritura sin comparación ni salto, y cada instrucción se cobra
+ * su propio tiempo.
+ *
+ * @param counting 1 para contar en result->dispatches las instrucciones despachadas.
+ * @param profiling 1 para acumular en @p profile las frecuencias.
+ * @param sampling 1 para publicar pc y la profundidad a walk_interpreter().
+ * @return 0 si terminó normalmente, 1 si hubo un error de ejecución.
+ */
+VM_TEMPLATE int interpret(VmState *vm, VmProfile *profile, RunResult *result, const int counting,
+                          const int profiling, const int sampling) {
+    const BcModule *module = vm->module;
+    uint8_t **codes = vm->codes;
+    const int quicken = vm->quicken;
+    VmFrame *frames = vm->frames;
+    RtHeap *heap = &vm->heap;
+    FILE *out = vm->out;
+    const BcFunction *function = &module->functions[module->main_index];
+    size_t depth = 1;
+    frames[0].function = module->main_index;
+    frames[0].base = 0;
+    uint8_t *code = codes[module->main_index];
+    uint8_t *pc = code;
+    int32_t *stack = vm->stack;
+    int32_t *locals = stack;
+    int32_t *sp = stack + function->slot_count;
+    int32_t a, b;
+    RtRef ref;
+    size_t callee = 0;
+    uint64_t dispatches = 0;
+    VmHistory history = { NULL, 0, -1 };
+
+    for (;;) {
+        if (counting) {
+            dispatches++;
+        }
+        if (profiling) {
+            profile_step(profile, &history, pc, (BcOp)*pc);
+        }
+        if (sampling) {
+            vm_sample_pc = pc;
+        }
+        switch (*pc++) {
+#define VM_CASE(op, operand, name) case op: VM_##op(quicken); break;
+            BC_OPS(VM_CASE)
+#undef VM_CASE
+#define VM_CASE3(op, first, second, third) \
+            case op: VM_##first(0); pc++; VM_##second(0); pc++; VM_##third(0); break;
+            VM_SUPER3(VM_CASE3)
+#undef VM_CASE3
+#define VM_CASE2(op, first, second) case op: VM_##first(0); pc++; VM_##second(0); break;
+            VM_SUPER2(VM_CASE2)
+#undef VM_CASE2
+            case VM_CALL_READY:
+                callee = bc_read_u16(pc);
+                goto call;
+            case VM_INDEX_ARRAY:
+                VM_INDEX(array_element(object, b));
+                break;
+            case VM_INDEX_STRING:
+                VM_INDEX(rt_data(object)[b]);
+                break;
+            default:
+                result->status = RUN_OUT_OF_MEMORY;
+                goto fail;
+        }
+        continue;
+
+    call: {
+            /* pc apunta al operando de call; el código del llamado ya está preparado */
+            const BcFunction *target = &module->functions[callee];
+            if (depth == RUN_MAX_DEPTH) {
+                frames[depth - 1].function = callee;
+                result->status = RUN_STACK_OVERFLOW;
+                goto fail;
+            }
+            size_t base = (size_t)(sp - stack) - target->param_count;
+            size_t top = (size_t)(sp - stack);
+            if (grow_stack(&vm->stack, &vm->capacity, base + target->slot_count + target->max_stack) != 0) {
+                frames[depth - 1].function = callee;
+                result->status = RUN_OUT_OF_MEMORY;
+                goto fail;
+            }
+            stack = vm->stack;
+            frames[depth - 1].pc = pc + 2;
+            frames[depth].function = callee;
+            frames[depth].base = base;
+            depth++;
+            code = codes[callee];
+            pc = code;
+            locals = stack + base;
+            sp = stack + top + (target->slot_count - target->param_count);
+            if (sampling) {
+                /* Los marcos ya escritos antes de publicar la profundidad */
+                atomic_signal_fence(memory_order_release);
+                vm_sample_depth = depth;
+            }
+            continue;
+        }
+
+    leave: {
+            int32_t value = *--sp;
+            if (--depth == 0) {
+                result->value = value;
+                result->dispatches = dispatches;
+                return 0;
+            }
+            sp = stack + frames[depth].base;
+            *sp++ = value;
+            const VmFrame *caller = &frames[depth - 1];
+            code = codes[caller->function];
+            pc = caller->pc;
+            locals = stack + caller->base;
+            if (sampling) {
+                vm_sample_depth = depth;
+            }
+            continue;
+        }
+    }
+
+fail_at:
+    /* El error es de la función de origen si el código se expandió en línea */
+    frames[depth - 1].function = bc_origin(&module->functions[frames[depth - 1].function],
+                                           (size_t)(pc - 1 - code));
+fail:
+    result->function = frames[depth - 1].function;
+    result->dispatches = dispatches;
+    return 1;
+}
+
+static int interpret_fast(VmState *vm, RunResult *result) {
+    return interpret(vm, NULL, result, 0, 0, 0);
+}
+
+static int interpret_counting(VmState *vm, RunResult *result) {
+    return interpret(vm, NULL, result, 1, 0, 0);
+}
+
+static int interpret_profiling(VmState *vm, VmProfile *profile, RunResult *result) {
+    return interpret(vm, profile, result, 1, 1, 0);
+}
+
+static int interpret_sampling(VmState *vm, Sampler *sampler, RunResult *result) {
+    vm_sample_pc = NULL;
+    vm_sample_depth = 1;
+    sampler_attach(sampler, walk_interpreter, vm);
+    int status = interpret(vm, NULL, result, 0, 0, 1);
+    sampler_attach(sampler, NULL, NULL);
+    return status;
+}
+
+/**
+ * @brief Ejecuta main hasta que termina o hasta el primer error.
+ *
+ * Igual que vm_execute() sin opciones ni perfil.
+ */
+int vm_run(const BcModule *module, FILE *out, RunResult *result) {
+    return vm_execute(module, 0, NULL, out, result);
+}
+
+/**
+ * @brief Ejecuta main con la variante del intérprete que piden las opciones.
+ */
+static int execute(const BcModule *module, unsigned flags, VmProfile *profile, Sampler *sampler, FILE *out,
+                   RunResult *result) {
+    memset(result, 0, sizeof(*result));
+    VmState vm;
+    vm.module = module;
+    vm.quicken = profile == NULL && (flags & VM_NO_SUPERINSTRUCTIONS) == 0;
+    vm.capacity = 4096;
+    vm.stack = (int32_t *)malloc(vm.capacity * sizeof(int32_t));
+    vm.frames = (VmFrame *)malloc(RUN_MAX_DEPTH * sizeof(VmFrame));
+    vm.codes = (uint8_t **)calloc(module->function_count, sizeof(uint8_t *));
+    vm.out = out;
+    rt_heap_init(&vm.heap, module->strings, (module->flags & BC_HEAP_MALLOC) != 0);
+    const BcFunction *function = &module->functions[module->main_index];
+    if (vm.codes != NULL) {
+        for (size_t i = 0; i < module->function_count && !vm.quicken; i++) {
+            vm.codes[i] = module->functions[i].code;
+        }
+        if (vm.quicken) {
+            vm.codes[module->main_index] = prepare(function);
+        }
+    }
+
+    int status;
+    if (vm.stack == NULL || vm.frames == NULL || vm.codes == NULL || vm.codes[module->main_index] == NULL
+            || grow_stack(&vm.stack, &vm.capacity, function->slot_count + function->max_stack) != 0) {
+        result->status = RUN_OUT_OF_MEMORY;
+        result->function = module->main_index;
+        status = 1;
+    } else if (profile != NULL) {
+        status = interpret_profiling(&vm, profile, result);
+    } else if (sampler != NULL) {
+        status = interpret_sampling(&vm, sampler, result);
+    } else if (flags & VM_COUNT_DISPATCHES) {
+        status = interpret_counting(&vm, result);
+    } else {
+        status = interpret_fast(&vm, result);
+    }
+    free(vm.stack);
+    free(vm.frames);
+    release_code(vm.codes, module->function_count, vm.quicken);
+    rt_heap_free(&vm.heap);
+    result->heap = vm.heap.stats;
+    return status;
+}
+
+/**
+ * @brief Ejecuta main hasta que termina o hasta el primer error.
+ *
+ * @param module Programa traducido.
+ * @param flags Opciones (VM_*).
+ * @param profile Con un perfil (ver vm_profile_init()), se ejecuta el
+ *                código sin superinstrucciones y se acumulan en él sus
+ *                frecuencias; o NULL.
+ * @param out Destino de print().
+ * @param result Estado, valor de main, función del error y, con
+ *               VM_COUNT_DISPATCHES o un perfil, instrucciones despachadas.
+ * @return 0 si terminó normalmente, 1 si hubo un error de ejecución.
+ */
+int vm_execute(const BcModule *module, unsigned flags, VmProfile *profile, FILE *out, RunResult *result) {
+    return execute(module, flags, profile, NULL, out, result);
+}
+
+/**
+ * @brief Igual que vm_execute() sin perfil, tomando las muestras de @p sampler.
+ *
+ * El perfil debe estar iniciado en este hilo (sampler_start()). Cada
+ * muestra se toma en el manejador de la señal y se atribuye a la
+ * instrucción en curso. VM_COUNT_DISPATCHES se ignora.
+ */
+int vm_execute_sampled(const BcModule *module, unsigned flags, Sampler *sampler, FILE *out,
+                       RunResult *result) {
+    return execute(module, flags & ~VM_COUNT_DISPATCHES, NULL, sampler, out, result);
+}
+
+/**
+ * @brief Prepara un perfil vacío para vm_execute().
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int vm_profile_init(VmProfile *profile) {
+    memset(profile, 0, sizeof(*profile));
+    profile->pairs = (uint64_t *)calloc((size_t)BC_OP_COUNT * BC_OP_COUNT, sizeof(uint64_t));
+    profile->triples = (uint64_t *)calloc((size_t)BC_OP_COUNT * BC_OP_COUNT * BC_OP_COUNT, sizeof(uint64_t));
+    if (profile->pairs == NULL || profile->triples == NULL) {
+        vm_profile_free(profile);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Escribe el nombre de una instrucción en mayúsculas, tras @p prefix.
+ */
+static void print_op_upper(const char *prefix, int op, FILE *out) {
+    fputs(prefix, out);
+    for (const char *c = bc_op_name((BcOp)op); *c != '\0'; c++) {
+        fputc(*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c, out);
+    }
+}
+
+/**
+ * @brief Reporta las secuencias de @p length instrucciones más frecuentes.
+ *
+ * Cada una se escribe con el porcentaje de despachos que ahorraría como
+ * superinstrucción y la entrada con que se añadiría a VM_SUPER2 o VM_SUPER3.
+ */
+static void print_sequences(const VmProfile *profile, const uint64_t *counts, size_t length, FILE *out) {
+    size_t total = length == 2 ? (size_t)BC_OP_COUNT * BC_OP_COUNT
+                               : (size_t)BC_OP_COUNT * BC_OP_COUNT * BC_OP_COUNT;
+    size_t top[VM_PROFILE_TOP];
+    size_t count = 0;
+    for (size_t i = 0; i < total; i++) {
+        if (counts[i] == 0 || (count == VM_PROFILE_TOP && counts[i] <= counts[top[count - 1]])) {
+            continue;
+        }
+        size_t at = count < VM_PROFILE_TOP ? count++ : count - 1;
+        while (at > 0 && counts[top[at - 1]] < counts[i]) {
+            top[at] = top[at - 1];
+            at--;
+        }
+        top[at] = i;
+    }
+    fprintf(out, "%s más frecuentes:\n", length == 2 ? "Pares" : "Tríos");
+    for (size_t i = 0; i < count; i++) {
+        int ops[3];
+        size_t index = top[i];
+        for (size_t k = length; k-- > 0;) {
+            ops[k] = (int)(index % BC_OP_COUNT);
+            index /= BC_OP_COUNT;
+        }
+        double saved = 100.0 * (double)(counts[top[i]] * (length - 1)) / (double)profile->dispatches;
+        fprintf(out, "  %12llu  %5.1f %%  X(VM", (unsigned long long)counts[top[i]], saved);
+        for (size_t k = 0; k < length; k++) {
+            print_op_upper("_", ops[k], out);
+        }
+        for (size_t k = 0; k < length; k++) {
+            print_op_upper(", BC_", ops[k], out);
+        }
+        fputs(")\n", out);
+    }
+}
+
+/**
+ * @brief Escribe las instrucciones ejecutadas y las secuencias más frecuentes.
+ */
+void vm_profile_print(const VmProfile *profile, FILE *out) {
+    fprintf(out, "Perfil de la máquina virtual (sin superinstrucciones)\n");
+    fprintf(out, "Instrucciones despachadas: %llu\n", (unsigned long long)profile->dispatches);
+    if (profile->dispatches == 0) {
+        return;
+    }
+    print_sequences(profile, profile->pairs, 2, out);
+    print_sequences(profile, profile->triples, 3, out);
+}
+
+/**
+ * @brief Libera un perfil.
+ */
+void vm_profile_free(VmProfile *profile) {
+    free(profile->pairs);
+    free(profile->triples);
+    profile->pairs = NULL;
+    profile->triples = NULL;
+}
@@ -0,0 +1,657 @@
+/**
+ * @file batch.c
+ * @brief Implementación del modo por lotes con un pool de hilos de robo de trabajo.
+ *
+ * Los archivos se ordenan de mayor a menor tamaño y se reparten en turno
+ * rotatorio entre las colas de los hilos. Cada hilo consume su cola desde el
+ * frente (primero los archivos grandes) y, al vaciarla, roba trabajo del final
+ * de la cola de otro hilo. Cada hilo lee los archivos en su propia arena, que
+ * se reinicia entre archivos, y acumula sus diagnósticos en un buffer por
+ * archivo que se imprime al final en el orden original de las entradas.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/batch.h"
+#include "../../include/arena.h"
+#include "../../include/driver.h"
+#include "../../include/lexer.h"
+#include "../../include/parser.h"
+#include <dirent.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define BATCH_MAX_PATH 4096
+
+/**
+ * @brief Extensiones consideradas código fuente al recorrer un directorio.
+ *
+ * Los archivos indicados explícitamente se procesan sin importar su extensión.
+ */
+static const char *source_extensions[] = {
+    ".txt",
+    ".lang",
+    NULL
+};
+
+/**
+ * @brief Trabajo asociado a un archivo de entrada.
+ */
+typedef struct BatchJob {
+    char *path;           /**< Ruta del archivo fuente */
+    size_t size;          /**< Tamaño en bytes (clave de planificación) */
+    int failed;           /**< 1 si el archivo tuvo errores */
+    int token_count;      /**< Tokens producidos */
+    int error_count;      /**< Errores léxicos y sintácticos */
+    char *diag;           /**< Diagnósticos acumulados (puede ser NULL) */
+    size_t diag_len;      /**< Longitud de diag */
+} BatchJob;
+
+/**
+ * @brief Lista dinámica de trabajos.
+ */
+typedef struct JobList {
+    BatchJob *items;
+    size_t count;
+    size_t capacity;
+} JobList;
+
+/**
+ * @brief Cola de trabajos de un hilo; el dueño toma del frente y los ladrones del final.
+ */
+typedef struct WorkQueue {
+    size_t *items;        /**< Índices de trabajos */
+    size_t head;          /**< Siguiente posición a tomar por el dueño */
+    size_t tail;          /**< Una posición después del último elemento */
+    pthread_mutex_t lock;
+} WorkQueue;
+
+/**
+ * @brief Estado compartido por todos los hilos de trabajo.
+ */
+typedef struct BatchPool {
+    JobList *jobs;
+    WorkQueue *queues;
+    size_t worker_count;
+    const BatchOptions *options;
+    pthread_mutex_t stats_lock;  /**< Protege options->stats al combinar */
+} BatchPool;
+
+/**
+ * @brief Argumento de cada hilo de trabajo.
+ */
+typedef struct Worker {
+    BatchPool *pool;
+    size_t id;
+    pthread_t thread;
+} Worker;
+
+/**
+ * @brief Agrega un archivo a la lista de trabajos.
+ *
+ * @return 0 si es exitoso, 1 si no hay memoria.
+ */
+static int job_list_push(JobList *list, const char *path, size_t size) {
+    if (list->count == list->capacity) {
+        size_t capacity = list->capacity ? list->capacity * 2 : 64;
+        BatchJob *items = (BatchJob *)realloc(list->items, capacity * sizeof(BatchJob));
+        if (items == NULL) {
+            return 1;
+        }
+        list->items = items;
+        list->capacity = capacity;
+    }
+    BatchJob *job = &list->items[list->count];
+    memset(job, 0, sizeof(*job));
+    job->path = strdup(path);
+    if (job->path == NULL) {
+        return 1;
+    }
+    job->size = size;
+    list->count++;
+    return 0;
+}
+
+/**
+ * @brief Libera la lista de trabajos y sus buffers.
+ */
+static void job_list_free(JobList *list) {
+    for (size_t i = 0; i < list->count; i++) {
+        free(list->items[i].path);
+        free(list->items[i].diag);
+    }
+    free(list->items);
+    list->items = NULL;
+    list->count = 0;
+    list->capacity = 0;
+}
+
+static int collect_path(JobList *list, const char *path, int depth, FILE *err);
+
+/**
+ * @brief Indica si un nombre de archivo tiene una extensión de código fuente.
+ */
+static int has_source_extension(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (dot == NULL) {
+        return 0;
+    }
+    for (int i = 0; source_extensions[i] != NULL; i++) {
+        if (strcmp(dot, source_extensions[i]) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Orden de las entradas de un directorio: por nombre, byte a byte.
+ *
+ * No depende del locale (alphasort() usa strcoll()).
+ */
+static int compare_entries(const struct dirent **a, const struct dirent **b) {
+    return strcmp((*a)->d_name, (*b)->d_name);
+}
+
+/**
+ * @brief Agrega recursivamente los archivos fuente de un directorio.
+ *
+ * Las entradas se recorren por nombre, así que el orden de los trabajos (y
+ * el de los diagnósticos) no depende del sistema de archivos. Se omiten las
+ * entradas ocultas (las que comienzan con '.') y los archivos regulares sin
+ * una extensión de source_extensions.
+ *
+ * @return 0 si es exitoso, 1 si hubo algún error.
+ */
+static int collect_directory(JobList *list, const char *path, int depth, FILE *err) {
+    struct dirent **entries = NULL;
+    int entry_count = scandir(path, &entries, NULL, compare_entries);
+    if (entry_count < 0) {
+        fprintf(err, "Error: No se pudo abrir el directorio '%s'\n", path);
+        return 1;
+    }
+    int status = 0;
+    size_t len = strlen(path);
+    while (len > 1 && path[len - 1] == '/') {
+        len--;
+    }
+    for (int i = 0; i < entry_count; i++) {
+        const struct dirent *entry = entries[i];
+        if (entry->d_name[0] == '.') {
+            continue;
+        }
+        char child[BATCH_MAX_PATH];
+        int n = snprintf(child, sizeof(child), "%.*s/%s", (int)len, path, entry->d_name);
+        if (n < 0 || (size_t)n >= sizeof(child)) {
+            fprintf(err, "Error: Ruta demasiado larga en '%s'\n", path);
+            status = 1;
+            continue;
+        }
+        struct stat st;
+        if (stat(child, &st) == 0 && S_ISREG(st.st_mode)
+                && !has_source_extension(entry->d_name)) {
+            continue;
+        }
+        status |= collect_path(list, child, depth + 1, err);
+    }
+    for (int i = 0; i < entry_count; i++) {
+        free(entries[i]);
+    }
+    free(entries);
+    return status;
+}
+
+/**
+ * @brief Agrega las rutas listadas en un archivo de respuesta.
+ *
+ * Cada línea contiene una ruta; se ignoran líneas vacías y las que comienzan
+ * con '#'. Una ruta de BATCH_MAX_PATH bytes o más es un error.
+ *
+ * @return 0 si es exitoso, 1 si hubo algún error.
+ */
+static int collect_response_file(JobList *list, const char *path, int depth, FILE *err) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        fprintf(err, "Error: No se pudo abrir el archivo de respuesta '%s'\n", path);
+        return 1;
+    }
+    int status = 0;
+    char *line = NULL;
+    size_t capacity = 0;
+    size_t number = 0;
+    while (getline(&line, &capacity, file) != -1) {
+        number++;
+        size_t len = strcspn(line, "\r\n");
+        line[len] = '\0';
+        if (len == 0 || line[0] == '#') {
+            continue;
+        }
+        if (len >= BATCH_MAX_PATH) {
+            fprintf(err, "Error: Ruta demasiado larga en la línea %zu de '%s'\n", number, path);
+            status = 1;
+            continue;
+        }
+        status |= collect_path(list, line, depth + 1, err);
+    }
+    free(line);
+    fclose(file);
+    return status;
+}
+
+/**
+ * @brief Expande una entrada (archivo, directorio o @respuesta) en trabajos.
+ *
+ * @return 0 si es exitoso, 1 si hubo algún error.
+ */
+static int collect_path(JobList *list, const char *path, int depth, FILE *err) {
+    // Límite de anidamiento para evitar ciclos de enlaces o respuestas recursivas.
+    if (depth > 32) {
+        fprintf(err, "Error: Anidamiento excesivo en '%s'\n", path);
+        return 1;
+    }
+    if (path[0] == '@') {
+        return collect_response_file(list, path + 1, depth, err);
+    }
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        fprintf(err, "Error: No existe el archivo '%s'\n", path);
+        return 1;
+    }
+    if (S_ISDIR(st.st_mode)) {
+        return collect_directory(list, path, depth, err);
+    }
+    if (!S_ISREG(st.st_mode)) {
+        return 0;
+    }
+    if (job_list_push(list, path, (size_t)st.st_size) != 0) {
+        fprintf(err, "Error: Memoria insuficiente\n");
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Analiza un código fuente y registra sus errores en @p diag.
+ *
+ * Con -p se ejecuta el parser completo; si no, solo el lexer.
+ *
+ * @return El número de tokens producidos.
+ */
+static int check_source(const char *source, const BatchOptions *options, DiagEngine *diag) {
+    if (options->syntax_check) {
+        ParseResult result;
+        parse_source(source, options->lexer_flags, diag, &result);
+        return (int)result.tokens;
+    }
+
+    uint64_t start = stats_clock();
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    lexer_set_flags(&lexer, options->lexer_flags);
+    lexer_set_diagnostics(&lexer, diag);
+    int count = 0;
+    LexToken token;
+    while (lexer_next_compact(&lexer, &token)) {
+        count++;
+        if (token.type == TOKEN_EOF) {
+            break;
+        }
+    }
+    stats_phase_add(STATS_LEX, stats_clock() - start);
+    return count;
+}
+
+/**
+ * @brief Procesa un trabajo completo: lectura, análisis y, opcionalmente, salida -t.
+ */
+static void process_job(BatchJob *job, const BatchOptions *options, Arena *arena,
+                        DiagEngine *engine) {
+    FILE *diag = open_memstream(&job->diag, &job->diag_len);
+    if (diag == NULL) {
+        job->failed = 1;
+        return;
+    }
+
+    size_t length = 0;
+    char *source = driver_read_source(job->path, arena, &length);
+    if (source == NULL) {
+        fprintf(diag, "%s: error: no se pudo leer el archivo\n", job->path);
+        job->failed = 1;
+        fclose(diag);
+        return;
+    }
+
+    if (options->generate_tokens) {
+        char output_path[512];
+        int from_cache = 0;
+        int count = -1;
+        if (driver_tokens_output_path(job->path, output_path, sizeof(output_path)) == 0) {
+            count = driver_write_tokens(job->path, source, length, output_path,
+                                        options->lexer_flags, options->cache, &from_cache);
+        }
+        if (count < 0) {
+            fprintf(diag, "%s: error: no se pudo escribir el archivo de tokens\n", job->path);
+            job->failed = 1;
+        } else {
+            job->token_count = count;
+        }
+    } else {
+        diag_reset(engine);
+        job->token_count = check_source(source, options, engine);
+        job->error_count = (int)engine->errors;
+        diag_print(engine, job->path, diag);
+        if (job->error_count > 0) {
+            job->failed = 1;
+        }
+    }
+
+    fclose(diag);
+    arena_reset(arena);
+}
+
+/**
+ * @brief Toma el siguiente trabajo de la cola propia o lo roba de otra.
+ *
+ * @return 1 si se obtuvo un trabajo en @p job_index, 0 si ya no queda trabajo.
+ */
+static int next_job(BatchPool *pool, size_t self, size_t *job_index) {
+    WorkQueue *own = &pool->queues[self];
+    pthread_mutex_lock(&own->lock);
+    if (own->head < own->tail) {
+        *job_index = own->items[own->head++];
+        pthread_mutex_unlock(&own->lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&own->lock);
+
+    for (size_t step = 1; step < pool->worker_count; step++) {
+        WorkQueue *victim = &pool->queues[(self + step) % pool->worker_count];
+        pthread_mutex_lock(&victim->lock);
+        if (victim->head < victim->tail) {
+            *job_index = victim->items[--victim->tail];
+            pthread_mutex_unlock(&victim->lock);
+            return 1;
+        }
+        pthread_mutex_unlock(&victim->lock);
+    }
+    return 0;
+}
+
+/**
+ * @brief Bucle principal de un hilo de trabajo.
+ */
+static void *worker_main(void *arg) {
+    Worker *worker = (Worker *)arg;
+    BatchPool *pool = worker->pool;
+    Arena arena;
+    arena_init(&arena, 0);
+    DiagEngine engine;
+    diag_init(&engine, 0);
+    CompilerStats stats;
+    memset(&stats, 0, sizeof(stats));
+    CompilerStats *previous = stats_begin(pool->options->stats != NULL ? &stats : NULL);
+
+    size_t index;
+    while (next_job(pool, worker->id, &index)) {
+        process_job(&pool->jobs->items[index], pool->options, &arena, &engine);
+    }
+
+    if (pool->options->stats != NULL) {
+        stats_note_arena_peak(arena.peak);
+        pthread_mutex_lock(&pool->stats_lock);
+        stats_merge(pool->options->stats, &stats);
+        pthread_mutex_unlock(&pool->stats_lock);
+    }
+    stats_begin(previous);
+    diag_free(&engine);
+    arena_free(&arena);
+    return NULL;
+}
+
+/**
+ * @brief Clave de ordenación de un trabajo.
+ */
+typedef struct JobKey {
+    size_t size;
+    size_t index;
+} JobKey;
+
+/**
+ * @brief Compara claves por tamaño descendente y, a igual tamaño, por orden de entrada.
+ */
+static int compare_by_size_desc(const void *a, const void *b) {
+    const JobKey *ka = (const JobKey *)a;
+    const JobKey *kb = (const JobKey *)b;
+    if (ka->size != kb->size) {
+        return ka->size < kb->size ? 1 : -1;
+    }
+    return ka->index < kb->index ? -1 : 1;
+}
+
+/**
+ * @brief Determina cuántos hilos usar.
+ */
+static size_t resolve_thread_count(int requested, size_t job_count) {
+    long n = requested > 0 ? requested : sysconf(_SC_NPROCESSORS_ONLN);
+    if (n < 1) {
+        n = 1;
+    }
+    if ((size_t)n > job_count) {
+        n = (long)job_count;
+    }
+    return n > 0 ? (size_t)n : 1;
+}
+
+/**
+ * @brief Ejecuta todos los trabajos sobre el pool de hilos.
+ *
+ * @return 0 si es exitoso, 1 si no se pudieron crear los recursos del pool.
+ */
+static int run_pool(JobList *jobs, const BatchOptions *options, size_t worker_count) {
+    JobKey *order = (JobKey *)malloc(jobs->count * sizeof(JobKey));
+    WorkQueue *queues = (WorkQueue *)calloc(worker_count, sizeof(WorkQueue));
+    Worker *workers = (Worker *)calloc(worker_count, sizeof(Worker));
+    size_t *slots = (size_t *)malloc(jobs->count * sizeof(size_t));
+    if (order == NULL || queues == NULL || workers == NULL || slots == NULL) {
+        free(order);
+        free(queues);
+        free(workers);
+        free(slots);
+        return 1;
+    }
+
+    // Planificación de mayor a menor: el archivo más grande empieza primero.
+    // Los trabajos ya marcados como fallidos no se planifican.
+    size_t pending = 0;
+    for (size_t i = 0; i < jobs->count; i++) {
+        if (jobs->items[i].failed) {
+            continue;
+        }
+        order[pending].size = jobs->items[i].size;
+        order[pending].index = i;
+        pending++;
+    }
+    qsort(order, pending, sizeof(JobKey), compare_by_size_desc);
+
+    // Reparto rotatorio; cada cola queda también ordenada de mayor a menor.
+    size_t per_queue = (pending + worker_count - 1) / worker_count;
+    for (size_t w = 0; w < worker_count; w++) {
+        queues[w].items = slots + w * per_queue;
+        pthread_mutex_init(&queues[w].lock, NULL);
+    }
+    for (size_t i = 0; i < pending; i++) {
+        WorkQueue *queue = &queues[i % worker_count];
+        queue->items[queue->tail++] = order[i].index;
+    }
+
+    BatchPool pool = { jobs, queues, worker_count, options, PTHREAD_MUTEX_INITIALIZER };
+    size_t started = 0;
+    for (size_t w = 0; w < worker_count; w++) {
+        workers[w].pool = &pool;
+        workers[w].id = w;
+        if (w == 0) {
+            continue;
+        }
+        if (pthread_create(&workers[w].thread, NULL, worker_main, &workers[w]) != 0) {
+            break;
+        }
+        started = w;
+    }
+    // El hilo principal actúa como el trabajador 0; si algún hilo no pudo
+    // crearse, su cola se vacía igualmente por robo de trabajo.
+    worker_main(&workers[0]);
+    for (size_t w = 1; w <= started; w++) {
+        pthread_join(workers[w].thread, NULL);
+    }
+
+    for (size_t w = 0; w < worker_count; w++) {
+        pthread_mutex_destroy(&queues[w].lock);
+    }
+    pthread_mutex_destroy(&pool.stats_lock);
+    free(order);
+    free(queues);
+    free(workers);
+    free(slots);
+    return 0;
+}
+
+/**
+ * @brief Compara dos rutas de salida indirectamente a través de sus índices.
+ */
+static int compare_output_paths(const void *a, const void *b) {
+    const char *const *pa = (const char *const *)a;
+    const char *const *pb = (const char *const *)b;
+    int cmp = strcmp(*pa, *pb);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return *pa < *pb ? -1 : 1;
+}
+
+/**
+ * @brief Marca como fallidos los trabajos cuyo archivo de tokens colisiona con otro.
+ *
+ * Dos fuentes con el mismo nombre base en carpetas distintas producirían el
+ * mismo archivo en DRIVER_TOKENS_DIR y se sobrescribirían en paralelo. Las
+ * rutas de salida se ordenan y se comparan sólo las adyacentes.
+ *
+ * @return El número de trabajos rechazados.
+ */
+static size_t reject_output_collisions(JobList *jobs, FILE *err) {
+    enum { OUTPUT_PATH_MAX = 512 };
+    char *paths = (char *)malloc(jobs->count * OUTPUT_PATH_MAX);
+    char **sorted = (char **)malloc(jobs->count * sizeof(char *));
+    if (paths == NULL || sorted == NULL) {
+        free(paths);
+        free(sorted);
+        return 0;
+    }
+    for (size_t i = 0; i < jobs->count; i++) {
+        sorted[i] = paths + i * OUTPUT_PATH_MAX;
+        driver_tokens_output_path(jobs->items[i].path, sorted[i], OUTPUT_PATH_MAX);
+    }
+    // Las rutas viven en un único bloque, así que su dirección preserva el
+    // orden de entrada y desempata de forma estable.
+    qsort(sorted, jobs->count, sizeof(char *), compare_output_paths);
+
+    size_t rejected = 0;
+    for (size_t i = 1; i < jobs->count; i++) {
+        if (strcmp(sorted[i - 1], sorted[i]) != 0) {
+            continue;
+        }
+        size_t first = (size_t)(sorted[i - 1] - paths) / OUTPUT_PATH_MAX;
+        size_t dup = (size_t)(sorted[i] - paths) / OUTPUT_PATH_MAX;
+        fprintf(err, "%s: error: '%s' ya genera el archivo '%s'\n",
+                jobs->items[dup].path, jobs->items[first].path, sorted[i]);
+        jobs->items[dup].failed = 1;
+        rejected++;
+    }
+    free(paths);
+    free(sorted);
+    return rejected;
+}
+
+/**
+ * @brief Ejecuta el modo por lotes sobre un conjunto de entradas.
+ *
+ * Imprime los diagnósticos de cada archivo en options->err, en el orden de las
+ * entradas, y un resumen con el rendimiento total en options->out.
+ *
+ * @param inputs Rutas de entrada (archivos, directorios o @respuesta).
+ * @param input_count Número de entradas.
+ * @param options Opciones del lote.
+ * @return 0 si todos los archivos se procesaron sin errores, 1 en caso contrario.
+ */
+int batch_run(char *const *inputs, size_t input_count, const BatchOptions *options) {
+    JobList jobs = { NULL, 0, 0 };
+    int status = 0;
+    for (size_t i = 0; i < input_count; i++) {
+        status |= collect_path(&jobs, inputs[i], 0, options->err);
+    }
+    if (jobs.count == 0) {
+        fprintf(options->err, "Error: No se encontraron archivos para procesar\n");
+        job_list_free(&jobs);
+        return 1;
+    }
+
+    size_t rejected = 0;
+    if (options->generate_tokens) {
+        rejected = reject_output_collisions(&jobs, options->err);
+    }
+
+    size_t worker_count = resolve_thread_count(options->threads, jobs.count - rejected);
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (run_pool(&jobs, options, worker_count) != 0) {
+        fprintf(options->err, "Error: No se pudo crear el pool de hilos\n");
+        job_list_free(&jobs);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    size_t total_bytes = 0;
+    size_t total_tokens = 0;
+    size_t failed_files = 0;
+    for (size_t i = 0; i < jobs.count; i++) {
+        const BatchJob *job = &jobs.items[i];
+        if (job->diag_len > 0) {
+            fwrite(job->diag, 1, job->diag_len, options->err);
+        }
+        if (job->failed) {
+            failed_files++;
+        }
+        total_bytes += job->size;
+        total_tokens += job->token_count > 0 ? (size_t)job->token_count : 0;
+    }
+
+    double seconds = (double)(end.tv_sec - start.tv_sec)
+                   + (double)(end.tv_nsec - start.tv_nsec) / 1e9;
+    if (seconds <= 0.0) {
+        seconds = 1e-9;
+    }
+
+    fprintf(options->out, "=== RESUMEN DEL LOTE ===\n");
+    fprintf(options->out, "Archivos:        %zu (%zu con errores)\n", jobs.count, failed_files);
+    fprintf(options->out, "Hilos:           %zu\n", worker_count);
+    fprintf(options->out, "Bytes:           %zu\n", total_bytes);
+    fprintf(options->out, "Tokens:          %zu\n", total_tokens);
+    fprintf(options->out, "Tiempo:          %.3f ms\n", seconds * 1e3);
+    fprintf(options->out, "Rendimiento:     %.2f MB/s, %.1f archivos/s\n",
+           (double)total_bytes / (1024.0 * 1024.0) / seconds,
+           (double)(jobs.count - rejected) / seconds);
+    if (options->generate_tokens) {
+        fprintf(options->out, "Salida:          %s/\n", DRIVER_TOKENS_DIR);
+    }
+
+    if (failed_files > 0) {
+        status = 1;
+    }
+    job_list_free(&jobs);
+    return status;
+}
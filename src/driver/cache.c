@@ -0,0 +1,534 @@
+/**
+ * @file cache.c
+ * @brief Implementación de la caché de compilación indexada por contenido.
+ *
+ * Cada entrada es un archivo `<clave>.<tipo>` dentro de la carpeta de la
+ * caché: `.tok` para los archivos de tokens y los que elija cada usuario de
+ * cache_load()/cache_save() (la compilación incremental usa `.inc`).
+ * Cada entrada empieza con el XXH64 de su contenido; una entrada que no lo
+ * cumple se trata como un fallo.
+ * La fecha de modificación de la entrada se actualiza en cada acierto, de modo
+ * que al cerrar la caché basta ordenar por esa fecha para expulsar las
+ * entradas menos usadas recientemente. Los contadores acumulados se guardan
+ * en el archivo `stats` de la misma carpeta.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/cache.h"
+#include "../../include/hash.h"
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define CACHE_ENTRY_SUFFIX ".tok"
+#define CACHE_STATS_FILE "stats"
+
+/** Contador global para nombres de archivos temporales únicos en el proceso. */
+static atomic_ulong temp_counter;
+
+/**
+ * @brief Entrada de la caché considerada durante la expulsión.
+ */
+typedef struct CacheEntry {
+    char name[32];   /**< Nombre del archivo dentro de la carpeta */
+    off_t size;      /**< Tamaño en bytes */
+    time_t mtime;    /**< Último uso */
+} CacheEntry;
+
+/**
+ * @brief Crea una carpeta y sus carpetas padre si no existen.
+ *
+ * @return 0 si la carpeta existe al terminar, 1 en caso contrario.
+ */
+static int make_dirs(const char *path) {
+    char buffer[512];
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(buffer)) {
+        return 1;
+    }
+    memcpy(buffer, path, len + 1);
+    for (size_t i = 1; i < len; i++) {
+        if (buffer[i] == '/') {
+            buffer[i] = '\0';
+            if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+                return 1;
+            }
+            buffer[i] = '/';
+        }
+    }
+    if (mkdir(buffer, 0755) != 0 && errno != EEXIST) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Construye la ruta de la entrada asociada a una clave.
+ */
+static void entry_path(const Cache *cache, uint64_t key, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s/%016llx" CACHE_ENTRY_SUFFIX, cache->dir,
+             (unsigned long long)key);
+}
+
+/**
+ * @brief Indica si un nombre de archivo es una entrada: 16 dígitos hexadecimales y un tipo sin puntos.
+ *
+ * Así se excluyen el archivo de estadísticas y los temporales.
+ */
+static int is_entry_name(const char *name) {
+    for (int i = 0; i < 16; i++) {
+        char c = name[i];
+        if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f'))) {
+            return 0;
+        }
+    }
+    return name[16] == '.' && name[17] != '\0' && strchr(name + 17, '.') == NULL;
+}
+
+/**
+ * @brief Genera un nombre temporal único junto a @p target.
+ *
+ * El archivo temporal vive en la misma carpeta que el destino para que
+ * rename() sea atómico.
+ *
+ * @param target Ruta final del archivo.
+ * @param buffer Destino del nombre temporal.
+ * @param size Tamaño de @p buffer.
+ * @return 0 si es exitoso, 1 si el nombre no cabe en el buffer.
+ */
+int cache_temp_path(const char *target, char *buffer, size_t size) {
+    unsigned long n = atomic_fetch_add(&temp_counter, 1);
+    int written = snprintf(buffer, size, "%s.tmp.%ld.%lu", target, (long)getpid(), n);
+    return (written < 0 || (size_t)written >= size) ? 1 : 0;
+}
+
+/**
+ * @brief Lee completo un archivo.
+ *
+ * @param data Destino de los bytes (liberar con free()).
+ * @param length Destino de su número.
+ * @return 0 si es exitoso, 1 si no existe o no pudo leerse.
+ */
+static int read_file(const char *path, char **data, size_t *length) {
+    *data = NULL;
+    *length = 0;
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return 1;
+    }
+    struct stat st;
+    int failed = fstat(fileno(file), &st) != 0;
+    if (!failed) {
+        *data = (char *)malloc(st.st_size > 0 ? (size_t)st.st_size : 1);
+        failed = *data == NULL || fread(*data, 1, (size_t)st.st_size, file) != (size_t)st.st_size;
+    }
+    fclose(file);
+    if (failed) {
+        free(*data);
+        *data = NULL;
+        return 1;
+    }
+    *length = (size_t)st.st_size;
+    return 0;
+}
+
+/**
+ * @brief Escribe atómicamente @p length bytes en @p path, precedidos de @p checksum si no es NULL.
+ *
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+static int write_file_atomic(const char *path, const uint64_t *checksum, const void *data, size_t length) {
+    char temp[700];
+    if (cache_temp_path(path, temp, sizeof(temp)) != 0) {
+        return 1;
+    }
+    FILE *file = fopen(temp, "wb");
+    if (file == NULL) {
+        return 1;
+    }
+    int failed = checksum != NULL && fwrite(checksum, sizeof(*checksum), 1, file) != 1;
+    failed |= fwrite(data, 1, length, file) != length;
+    failed |= fclose(file) != 0;
+    if (failed || rename(temp, path) != 0) {
+        unlink(temp);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Lee la entrada de @p path y verifica su suma de comprobación.
+ *
+ * Cada entrada empieza con el XXH64 de su contenido sembrado con la clave,
+ * así que una entrada dañada o renombrada a otra clave no se sirve.
+ *
+ * @param data Destino del contenido sin la suma (liberar con free()).
+ * @param length Destino de su número de bytes.
+ * @return 0 si la entrada es válida, 1 si no existe, no pudo leerse o está dañada.
+ */
+static int read_entry(const char *path, uint64_t key, char **data, size_t *length) {
+    char *raw = NULL;
+    size_t raw_length = 0;
+    uint64_t checksum;
+    if (read_file(path, &raw, &raw_length) != 0) {
+        return 1;
+    }
+    if (raw_length < sizeof(checksum)) {
+        free(raw);
+        return 1;
+    }
+    memcpy(&checksum, raw, sizeof(checksum));
+    *length = raw_length - sizeof(checksum);
+    if (hash64(raw + sizeof(checksum), *length, key) != checksum) {
+        free(raw);
+        *length = 0;
+        return 1;
+    }
+    memmove(raw, raw + sizeof(checksum), *length);
+    *data = raw;
+    return 0;
+}
+
+/**
+ * @brief Guarda atómicamente @p length bytes como la entrada de @p path, precedidos de su suma.
+ *
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+static int write_entry(const char *path, uint64_t key, const void *data, size_t length) {
+    uint64_t checksum = hash64(data, length, key);
+    return write_file_atomic(path, &checksum, data, length);
+}
+
+/**
+ * @brief Abre (y crea si hace falta) la caché en una carpeta.
+ *
+ * @param cache La caché a inicializar.
+ * @param dir Carpeta de la caché, o NULL para CACHE_DEFAULT_DIR.
+ * @param max_bytes Tamaño máximo, o 0 para CACHE_DEFAULT_MAX_BYTES.
+ * @return 0 si es exitoso, 1 si la carpeta no pudo crearse.
+ */
+int cache_open(Cache *cache, const char *dir, size_t max_bytes) {
+    const char *path = dir ? dir : CACHE_DEFAULT_DIR;
+    int written = snprintf(cache->dir, sizeof(cache->dir), "%s", path);
+    if (written < 0 || (size_t)written >= sizeof(cache->dir)) {
+        return 1;
+    }
+    cache->max_bytes = max_bytes ? max_bytes : CACHE_DEFAULT_MAX_BYTES;
+    atomic_init(&cache->hits, 0);
+    atomic_init(&cache->misses, 0);
+    atomic_init(&cache->stores, 0);
+    atomic_init(&cache->evictions, 0);
+    memset(&cache->flushed, 0, sizeof(cache->flushed));
+    if (make_dirs(cache->dir) != 0) {
+        return 1;
+    }
+    pthread_mutex_init(&cache->lock, NULL);
+    return 0;
+}
+
+/**
+ * @brief Calcula la clave de caché de un código fuente.
+ *
+ * Cada componente se mezcla encadenando la semilla, sin concatenarlos en
+ * un buffer de tamaño fijo que podría truncar nombres largos.
+ *
+ * @param source Bytes del código fuente.
+ * @param length Número de bytes.
+ * @param source_name Nombre del archivo fuente tal como aparece en la salida.
+ * @param flags Banderas que alteran la salida (por ejemplo "t").
+ * @return La clave de 64 bits.
+ */
+uint64_t cache_key(const char *source, size_t length, const char *source_name,
+                   const char *flags) {
+    uint64_t seed = hash64(COMPILADOR_VERSION, strlen(COMPILADOR_VERSION), 0);
+    seed = hash64(flags ? flags : "", flags ? strlen(flags) : 0, seed);
+    seed = hash64(source_name ? source_name : "", source_name ? strlen(source_name) : 0, seed);
+    return hash64(source, length, seed);
+}
+
+/**
+ * @brief Sirve una entrada de la caché copiándola atómicamente a su destino.
+ *
+ * En un acierto se actualiza la fecha de uso de la entrada. Una entrada
+ * dañada cuenta como fallo.
+ *
+ * @param cache La caché.
+ * @param key Clave de la entrada.
+ * @param dest_path Ruta donde debe quedar el artefacto.
+ * @return 0 si hubo acierto, 1 si la entrada no existe, está dañada o no pudo copiarse.
+ */
+int cache_fetch(Cache *cache, uint64_t key, const char *dest_path) {
+    char path[600];
+    char *data = NULL;
+    size_t length = 0;
+    entry_path(cache, key, path, sizeof(path));
+    int failed = read_entry(path, key, &data, &length) != 0
+                 || write_file_atomic(dest_path, NULL, data, length) != 0;
+    free(data);
+    if (failed) {
+        atomic_fetch_add(&cache->misses, 1);
+        return 1;
+    }
+    utimensat(AT_FDCWD, path, NULL, 0);
+    atomic_fetch_add(&cache->hits, 1);
+    return 0;
+}
+
+/**
+ * @brief Guarda un artefacto recién generado en la caché.
+ *
+ * @param cache La caché.
+ * @param key Clave de la entrada.
+ * @param src_path Artefacto a copiar.
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+int cache_store(Cache *cache, uint64_t key, const char *src_path) {
+    char path[600];
+    char *data = NULL;
+    size_t length = 0;
+    entry_path(cache, key, path, sizeof(path));
+    int failed = read_file(src_path, &data, &length) != 0
+                 || write_entry(path, key, data, length) != 0;
+    free(data);
+    if (failed) {
+        return 1;
+    }
+    atomic_fetch_add(&cache->stores, 1);
+    return 0;
+}
+
+/**
+ * @brief Lee completa la entrada @p key de tipo @p suffix (por ejemplo "fn").
+ *
+ * En un acierto se actualiza la fecha de uso de la entrada. Una entrada
+ * dañada cuenta como fallo.
+ *
+ * @param data Destino de los bytes (liberar con free()).
+ * @param length Destino de su número.
+ * @return 0 si hubo acierto, 1 si la entrada no existe, está dañada o no pudo leerse.
+ */
+int cache_load(Cache *cache, uint64_t key, const char *suffix, char **data, size_t *length) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%016llx.%s", cache->dir, (unsigned long long)key, suffix);
+    *data = NULL;
+    *length = 0;
+    if (read_entry(path, key, data, length) != 0) {
+        atomic_fetch_add(&cache->misses, 1);
+        return 1;
+    }
+    utimensat(AT_FDCWD, path, NULL, 0);
+    atomic_fetch_add(&cache->hits, 1);
+    return 0;
+}
+
+/**
+ * @brief Guarda atómicamente @p length bytes como la entrada @p key de tipo @p suffix.
+ *
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+int cache_save(Cache *cache, uint64_t key, const char *suffix, const void *data, size_t length) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/%016llx.%s", cache->dir, (unsigned long long)key, suffix);
+    if (write_entry(path, key, data, length) != 0) {
+        return 1;
+    }
+    atomic_fetch_add(&cache->stores, 1);
+    return 0;
+}
+
+/**
+ * @brief Ordena entradas de la menos a la más recientemente usada.
+ */
+static int compare_by_mtime(const void *a, const void *b) {
+    const CacheEntry *ea = (const CacheEntry *)a;
+    const CacheEntry *eb = (const CacheEntry *)b;
+    if (ea->mtime != eb->mtime) {
+        return ea->mtime < eb->mtime ? -1 : 1;
+    }
+    return strcmp(ea->name, eb->name);
+}
+
+/**
+ * @brief Expulsa las entradas menos usadas hasta quedar bajo el límite.
+ *
+ * Se libera hasta el 90% del límite para no repetir la expulsión en cada
+ * ejecución que agregue una sola entrada.
+ */
+static void cache_evict(Cache *cache) {
+    DIR *dir = opendir(cache->dir);
+    if (dir == NULL) {
+        return;
+    }
+    CacheEntry *entries = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    size_t total = 0;
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        size_t len = strlen(ent->d_name);
+        if (len >= sizeof(entries[0].name) || !is_entry_name(ent->d_name)) {
+            continue;
+        }
+        struct stat st;
+        if (fstatat(dirfd(dir), ent->d_name, &st, 0) != 0) {
+            continue;
+        }
+        if (count == capacity) {
+            size_t new_capacity = capacity ? capacity * 2 : 128;
+            CacheEntry *grown = (CacheEntry *)realloc(entries, new_capacity * sizeof(CacheEntry));
+            if (grown == NULL) {
+                break;
+            }
+            entries = grown;
+            capacity = new_capacity;
+        }
+        memcpy(entries[count].name, ent->d_name, len + 1);
+        entries[count].size = st.st_size;
+        entries[count].mtime = st.st_mtime;
+        total += (size_t)st.st_size;
+        count++;
+    }
+    closedir(dir);
+
+    if (total > cache->max_bytes) {
+        size_t target = cache->max_bytes / 10 * 9;
+        qsort(entries, count, sizeof(CacheEntry), compare_by_mtime);
+        for (size_t i = 0; i < count && total > target; i++) {
+            char path[600];
+            snprintf(path, sizeof(path), "%s/%s", cache->dir, entries[i].name);
+            if (unlink(path) == 0) {
+                total -= (size_t)entries[i].size;
+                atomic_fetch_add(&cache->evictions, 1);
+            }
+        }
+    }
+    free(entries);
+}
+
+/**
+ * @brief Lee los contadores acumulados del archivo de estadísticas.
+ */
+static void read_persisted_stats(const Cache *cache, CacheStats *stats) {
+    char path[600];
+    snprintf(path, sizeof(path), "%s/" CACHE_STATS_FILE, cache->dir);
+    memset(stats, 0, sizeof(*stats));
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return;
+    }
+    if (fscanf(file, "%lu %lu %lu %lu", &stats->hits, &stats->misses,
+               &stats->stores, &stats->evictions) != 4) {
+        memset(stats, 0, sizeof(*stats));
+    }
+    fclose(file);
+}
+
+/**
+ * @brief Aplica el límite de tamaño y acumula en disco los contadores nuevos.
+ *
+ * Solo se suman al archivo de estadísticas los incrementos ocurridos desde el
+ * último vaciado, por lo que puede llamarse repetidamente (por ejemplo, tras
+ * cada petición del modo servidor). La acumulación no es transaccional entre
+ * procesos: dos procesos que vacíen a la vez pueden perder los incrementos de
+ * uno de ellos.
+ *
+ * @param cache La caché.
+ */
+void cache_flush(Cache *cache) {
+    pthread_mutex_lock(&cache->lock);
+    if (atomic_load(&cache->stores) > cache->flushed.stores) {
+        cache_evict(cache);
+    }
+
+    CacheStats now;
+    now.hits = atomic_load(&cache->hits);
+    now.misses = atomic_load(&cache->misses);
+    now.stores = atomic_load(&cache->stores);
+    now.evictions = atomic_load(&cache->evictions);
+
+    CacheStats stats;
+    read_persisted_stats(cache, &stats);
+    stats.hits += now.hits - cache->flushed.hits;
+    stats.misses += now.misses - cache->flushed.misses;
+    stats.stores += now.stores - cache->flushed.stores;
+    stats.evictions += now.evictions - cache->flushed.evictions;
+    cache->flushed = now;
+
+    char path[600];
+    char temp[700];
+    snprintf(path, sizeof(path), "%s/" CACHE_STATS_FILE, cache->dir);
+    FILE *file = NULL;
+    if (cache_temp_path(path, temp, sizeof(temp)) == 0) {
+        file = fopen(temp, "w");
+    }
+    if (file != NULL) {
+        fprintf(file, "%lu %lu %lu %lu\n", stats.hits, stats.misses, stats.stores,
+                stats.evictions);
+        if (fclose(file) != 0 || rename(temp, path) != 0) {
+            unlink(temp);
+        }
+    }
+    pthread_mutex_unlock(&cache->lock);
+}
+
+/**
+ * @brief Cierra la caché vaciando sus contadores a disco.
+ *
+ * Los contadores de la ejecución siguen disponibles para cache_print_stats().
+ *
+ * @param cache La caché.
+ */
+void cache_close(Cache *cache) {
+    cache_flush(cache);
+    pthread_mutex_destroy(&cache->lock);
+}
+
+/** Ancho de la columna de etiquetas de cache_print_stats(). */
+#define CACHE_LABEL_WIDTH 16
+
+/**
+ * @brief Escribe @p label rellenado hasta @p width columnas contando puntos de código.
+ *
+ * printf rellena por bytes, así que "Esta ejecución" quedaría una columna corta.
+ */
+static void print_label(FILE *out, const char *label, size_t width) {
+    size_t columns = 0;
+    for (const char *c = label; *c != '\0'; c++) {
+        columns += ((unsigned char)*c & 0xC0) != 0x80;
+    }
+    fputs(label, out);
+    for (; columns < width; columns++) {
+        fputc(' ', out);
+    }
+}
+
+/**
+ * @brief Imprime los contadores de esta ejecución y los acumulados.
+ *
+ * @param cache La caché (normalmente ya vaciada con cache_flush() o cache_close()).
+ * @param out Flujo de salida.
+ */
+void cache_print_stats(Cache *cache, FILE *out) {
+    CacheStats total;
+    read_persisted_stats(cache, &total);
+    unsigned long hits = atomic_load(&cache->hits);
+    unsigned long misses = atomic_load(&cache->misses);
+    unsigned long lookups = hits + misses;
+    unsigned long total_lookups = total.hits + total.misses;
+
+    fprintf(out, "=== ESTADÍSTICAS DE CACHÉ (%s) ===\n", cache->dir);
+    print_label(out, "", CACHE_LABEL_WIDTH);
+    fprintf(out, " %10s %10s %10s %10s %9s\n", "Aciertos", "Fallos", "Guardadas", "Expulsadas", "Acierto");
+    print_label(out, "Esta ejecución", CACHE_LABEL_WIDTH);
+    fprintf(out, " %10lu %10lu %10lu %10lu %8.1f%%\n",
+            hits, misses, atomic_load(&cache->stores), atomic_load(&cache->evictions),
+            lookups ? 100.0 * (double)hits / (double)lookups : 0.0);
+    print_label(out, "Acumulado", CACHE_LABEL_WIDTH);
+    fprintf(out, " %10lu %10lu %10lu %10lu %8.1f%%\n",
+            total.hits, total.misses, total.stores, total.evictions,
+            total_lookups ? 100.0 * (double)total.hits / (double)total_lookups : 0.0);
+}
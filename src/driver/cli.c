@@ -0,0 +1,456 @@
+/**
+ * @file cli.c
+ * @brief Implementación de la línea de comandos del compilador.
+ */
+#include "../../include/cli.h"
+#include "../../include/batch.h"
+#include "../../include/driver.h"
+#include "../../include/lexer.h"
+#include "../../include/profile.h"
+#include "../../include/stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Imprime la ayuda de uso del compilador.
+ *
+ * @param program_name Nombre del ejecutable.
+ * @param out Flujo de salida.
+ */
+void cli_print_usage(const char *program_name, FILE *out) {
+    fprintf(out, "Uso: %s [opciones] <archivo>...\n", program_name);
+    fprintf(out, "     %s --server <socket> [opciones de caché]\n", program_name);
+    fprintf(out, "     %s --client <socket> [--latency] [opciones] <archivo>...\n", program_name);
+    fprintf(out, "Opciones:\n");
+    fprintf(out, "  -l                 Análisis léxico (por defecto)\n");
+    fprintf(out, "  -p                 Análisis léxico y sintáctico con todos los errores\n");
+    fprintf(out, "  -t                 Generar archivo de tokens\n");
+    fprintf(out, "  --run              Compilar y ejecutar main con la máquina virtual\n");
+    fprintf(out, "  --jit              Compilar y ejecutar main con el JIT x86-64\n");
+    fprintf(out, "  --no-inline        Con --run o --jit, no expandir llamadas en línea\n");
+    fprintf(out, "  --inline-threshold <n>  Costo máximo de una llamada expandida (por defecto %d)\n",
+            INLINE_DEFAULT_THRESHOLD);
+    fprintf(out, "  --inline-loop-bonus <n> Costo adicional dentro de ciclos (por defecto %d)\n",
+            INLINE_DEFAULT_LOOP_BONUS);
+    fprintf(out, "  --inline-report    Mostrar en stderr las llamadas expandidas\n");
+    fprintf(out, "  --no-vectorize     Con --run o --jit, no vectorizar los ciclos de reducciones\n");
+    fprintf(out, "  --vectorize=sse2   Con --jit, usar SSE2 aunque el procesador tenga AVX2\n");
+    fprintf(out, "  --heap-stats       Con --run o --jit, mostrar en stderr las asignaciones de String y Array\n");
+    fprintf(out, "  --malloc-heap      Con --run o --jit, pedir cada String y Array a malloc (para comparar)\n");
+    fprintf(out, "  --no-superinstructions  Con --run, ejecutar el bytecode sin superinstrucciones ni especializar\n");
+    fprintf(out, "  --vm-profile       Ejecutar cada entrada con la VM y mostrar en stderr los pares y tríos\n"
+                 "                     de instrucciones más frecuentes (candidatos a superinstrucción)\n");
+    fprintf(out, "  --prof             Ejecutar (con --run si no se indica --jit) tomando muestras: pilas\n"
+                 "                     colapsadas para flamegraph.pl y en stderr las funciones y líneas más costosas\n");
+    fprintf(out, "  --prof-interval <µs>  Tiempo de CPU entre muestras (por defecto %d, mínimo %d)\n",
+            SAMPLER_DEFAULT_INTERVAL_US, SAMPLER_MIN_INTERVAL_US);
+    fprintf(out, "  --prof-out <archivo>  Archivo de las pilas colapsadas (por defecto %s)\n", SAMPLER_DEFAULT_OUTPUT);
+    fprintf(out, "  --prof-top <n>     Funciones y líneas del resumen de --prof (por defecto %d)\n",
+            SAMPLER_DEFAULT_TOP);
+    fprintf(out, "  --emit-module <archivo>  Compilar como --run y guardar el bytecode en un módulo, sin ejecutarlo\n");
+    fprintf(out, "  --module           Con --run o --jit, la entrada es un módulo de --emit-module\n");
+    fprintf(out, "  --incremental      Con --run o --jit, recompilar solo las funciones que cambiaron (usa la caché)\n");
+    fprintf(out, "  --incremental-report  Como --incremental, y mostrar en stderr las funciones recompiladas\n");
+    fprintf(out, "  --utf8-columns     Contar columnas en caracteres UTF-8 en lugar de bytes\n");
+    fprintf(out, "  --lexer-thread     Con -p, lexear los archivos grandes en un hilo aparte\n");
+    fprintf(out, "  -j <n>             Hilos del modo por lotes (por defecto, núcleos disponibles)\n");
+    fprintf(out, "  --parse-threads <n>  Con -p, --run o --jit, analizar un archivo grande con n hilos (0 = núcleos)\n");
+    fprintf(out, "  --codegen-threads <n>  Con --run o --jit, traducir y expandir en línea con n hilos (0 = núcleos)\n");
+    fprintf(out, "  --no-cache         No usar la caché de compilación con -t ni con --incremental\n");
+    fprintf(out, "  --cache-dir <dir>  Carpeta de la caché (por defecto %s)\n", CACHE_DEFAULT_DIR);
+    fprintf(out, "  --cache-size <MB>  Tamaño máximo de la caché (por defecto %lu MB)\n",
+            CACHE_DEFAULT_MAX_BYTES / (1024UL * 1024UL));
+    fprintf(out, "  --cache-stats      Mostrar aciertos y fallos de la caché\n");
+    fprintf(out, "  --server <socket>  Atender peticiones en un socket Unix\n");
+    fprintf(out, "  --client <socket>  Enviar el resto de argumentos a un servidor\n");
+    fprintf(out, "  --stats[=json]     Mostrar en stderr el tiempo por fase y los contadores\n");
+    fprintf(out, "  --time-report      Igual que --stats\n");
+    fprintf(out, "  --profile-source[=json]  Perfil de tokens e identificadores de las entradas\n");
+    fprintf(out, "  --profile-top <n>  Identificadores frecuentes del perfil (por defecto %d)\n",
+            PROFILE_DEFAULT_TOP);
+    fprintf(out, "  -h, --help         Mostrar esta ayuda\n");
+    fprintf(out, "\nModo por lotes:\n");
+    fprintf(out, "  Se activa con varios archivos, un directorio, un archivo de respuesta\n");
+    fprintf(out, "  '@lista.txt' (una ruta por línea) o la opción -j. Solo se reportan\n");
+    fprintf(out, "  diagnósticos y un resumen; el código de salida es 1 si algún archivo\n");
+    fprintf(out, "  tuvo errores.\n");
+    fprintf(out, "\nEjemplos:\n");
+    fprintf(out, "  %s programa.lang              # Análisis léxico en terminal\n", program_name);
+    fprintf(out, "  %s -p programa.lang           # Análisis sintáctico\n", program_name);
+    fprintf(out, "  %s -t programa.lang           # Generar archivo de tokens\n", program_name);
+    fprintf(out, "  %s --jit programa.lang        # Ejecutar; el código de salida es el de main\n", program_name);
+    fprintf(out, "  %s --emit-module p.cbc p.lang # Precompilar; luego: %s --run --module p.cbc\n",
+            program_name, program_name);
+    fprintf(out, "  %s -t -j 8 src/ @lista.txt    # Generar tokens por lotes\n", program_name);
+    fprintf(out, "  %s --cache-stats              # Estadísticas acumuladas de la caché\n", program_name);
+    fprintf(out, "  %s --profile-source a.lang b.lang  # Perfil conjunto de un corpus\n", program_name);
+    fprintf(out, "  %s --vm-profile a.lang b.lang      # Secuencias de instrucciones frecuentes\n", program_name);
+    fprintf(out, "  %s --jit --prof programa.lang      # Dónde se va el tiempo; luego: flamegraph.pl %s\n",
+            program_name, SAMPLER_DEFAULT_OUTPUT);
+}
+
+/**
+ * @brief Interpreta los argumentos de línea de comandos.
+ *
+ * @param argc Número de argumentos.
+ * @param argv Argumentos.
+ * @param options Destino de las opciones; se libera con cli_free().
+ * @param err Flujo para los mensajes de error.
+ * @return 0 si es exitoso, 1 si se pidió la ayuda, -1 si hay error.
+ */
+int cli_parse(int argc, char *argv[], CliOptions *options, FILE *err) {
+    memset(options, 0, sizeof(*options));
+    options->use_cache = 1;
+    options->parse_threads = 1;
+    options->codegen_threads = 1;
+    options->inline_calls = 1;
+    options->codegen_flags = BC_VECTORIZE;
+    options->prof_options.interval_us = SAMPLER_DEFAULT_INTERVAL_US;
+    options->prof_options.top = SAMPLER_DEFAULT_TOP;
+    inline_options_default(&options->inline_options);
+    options->inputs = (char **)malloc((size_t)(argc > 0 ? argc : 1) * sizeof(char *));
+    if (options->inputs == NULL) {
+        fprintf(err, "Error: Memoria insuficiente\n");
+        return -1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-t") == 0) {
+            options->generate_tokens = 1;
+        } else if (strcmp(argv[i], "-p") == 0) {
+            options->syntax_check = 1;
+        } else if (strcmp(argv[i], "-l") == 0) {
+            options->syntax_check = 0;
+        } else if (strcmp(argv[i], "--run") == 0) {
+            options->run_mode = DRIVER_RUN_VM;
+        } else if (strcmp(argv[i], "--jit") == 0) {
+            options->run_mode = DRIVER_RUN_JIT;
+        } else if (strcmp(argv[i], "--no-inline") == 0) {
+            options->inline_calls = 0;
+        } else if (strcmp(argv[i], "--inline-threshold") == 0
+                   || strcmp(argv[i], "--inline-loop-bonus") == 0) {
+            if (i + 1 >= argc || argv[i + 1][0] < '0' || argv[i + 1][0] > '9') {
+                fprintf(err, "Error: %s requiere un costo (número no negativo)\n\n", argv[i]);
+                return -1;
+            }
+            unsigned long value = strtoul(argv[i + 1], NULL, 10);
+            uint32_t cost = value < INLINE_MAX_FUNCTION_BYTES ? (uint32_t)value : INLINE_MAX_FUNCTION_BYTES;
+            if (strcmp(argv[i++], "--inline-threshold") == 0) {
+                options->inline_options.threshold = cost;
+            } else {
+                options->inline_options.loop_bonus = cost;
+            }
+        } else if (strcmp(argv[i], "--inline-report") == 0) {
+            options->inline_report = 1;
+        } else if (strcmp(argv[i], "--no-vectorize") == 0) {
+            options->codegen_flags &= ~BC_VECTORIZE;
+        } else if (strcmp(argv[i], "--vectorize=sse2") == 0) {
+            options->codegen_flags |= BC_VECTORIZE | BC_SIMD_SSE2;
+        } else if (strcmp(argv[i], "--heap-stats") == 0) {
+            options->heap_stats = 1;
+        } else if (strcmp(argv[i], "--malloc-heap") == 0) {
+            options->codegen_flags |= BC_HEAP_MALLOC;
+        } else if (strcmp(argv[i], "--no-superinstructions") == 0) {
+            options->vm_flags |= VM_NO_SUPERINSTRUCTIONS;
+        } else if (strcmp(argv[i], "--vm-profile") == 0) {
+            options->vm_profile = 1;
+        } else if (strcmp(argv[i], "--prof") == 0) {
+            options->prof = 1;
+        } else if (strcmp(argv[i], "--prof-interval") == 0) {
+            if (i + 1 >= argc || atol(argv[i + 1]) < SAMPLER_MIN_INTERVAL_US || atol(argv[i + 1]) > 1000000) {
+                fprintf(err, "Error: --prof-interval requiere microsegundos entre %d y 1000000\n\n",
+                        SAMPLER_MIN_INTERVAL_US);
+                return -1;
+            }
+            options->prof = 1;
+            options->prof_options.interval_us = (uint32_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--prof-out") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(err, "Error: --prof-out requiere la ruta del archivo\n\n");
+                return -1;
+            }
+            options->prof = 1;
+            options->prof_options.output = argv[++i];
+        } else if (strcmp(argv[i], "--prof-top") == 0) {
+            if (i + 1 >= argc || atol(argv[i + 1]) <= 0 || atol(argv[i + 1]) > PROFILE_MAX_TOP) {
+                fprintf(err, "Error: --prof-top requiere un número entre 1 y %d\n\n", PROFILE_MAX_TOP);
+                return -1;
+            }
+            options->prof = 1;
+            options->prof_options.top = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "--emit-module") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(err, "Error: --emit-module requiere la ruta del módulo\n\n");
+                return -1;
+            }
+            options->emit_module = argv[++i];
+        } else if (strcmp(argv[i], "--module") == 0) {
+            options->load_module = 1;
+        } else if (strcmp(argv[i], "--incremental") == 0) {
+            options->incremental = 1;
+        } else if (strcmp(argv[i], "--incremental-report") == 0) {
+            options->incremental = 1;
+            options->incremental_report = 1;
+        } else if (strcmp(argv[i], "--utf8-columns") == 0) {
+            options->lexer_flags |= LEXER_UTF8_COLUMNS;
+        } else if (strcmp(argv[i], "--lexer-thread") == 0) {
+            options->lexer_flags |= LEXER_THREADED;
+        } else if (strcmp(argv[i], "-j") == 0) {
+            if (i + 1 >= argc || atoi(argv[i + 1]) <= 0) {
+                fprintf(err, "Error: -j requiere un número de hilos positivo\n\n");
+                return -1;
+            }
+            options->threads = atoi(argv[++i]);
+            options->force_batch = 1;
+        } else if (strcmp(argv[i], "--parse-threads") == 0) {
+            if (i + 1 >= argc || atoi(argv[i + 1]) < 0) {
+                fprintf(err, "Error: --parse-threads requiere un número de hilos (0 = núcleos)\n\n");
+                return -1;
+            }
+            options->parse_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--codegen-threads") == 0) {
+            if (i + 1 >= argc || atoi(argv[i + 1]) < 0) {
+                fprintf(err, "Error: --codegen-threads requiere un número de hilos (0 = núcleos)\n\n");
+                return -1;
+            }
+            options->codegen_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-cache") == 0) {
+            options->use_cache = 0;
+        } else if (strcmp(argv[i], "--cache-stats") == 0) {
+            options->cache_stats = 1;
+        } else if (strcmp(argv[i], "--cache-dir") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(err, "Error: --cache-dir requiere una carpeta\n\n");
+                return -1;
+            }
+            options->cache_dir = argv[++i];
+        } else if (strcmp(argv[i], "--cache-size") == 0) {
+            if (i + 1 >= argc || atol(argv[i + 1]) <= 0) {
+                fprintf(err, "Error: --cache-size requiere un tamaño positivo en MB\n\n");
+                return -1;
+            }
+            options->cache_max_bytes = (size_t)atol(argv[++i]) * 1024UL * 1024UL;
+        } else if (strcmp(argv[i], "--server") == 0) {
+            if (i + 1 >= argc) {
+                fprintf(err, "Error: --server requiere la ruta de un socket\n\n");
+                return -1;
+            }
+            options->server_socket = argv[++i];
+        } else if (strcmp(argv[i], "--stats") == 0 || strcmp(argv[i], "--time-report") == 0) {
+            options->stats_format = CLI_STATS_TEXT;
+        } else if (strcmp(argv[i], "--stats=json") == 0) {
+            options->stats_format = CLI_STATS_JSON;
+        } else if (strcmp(argv[i], "--profile-source") == 0) {
+            options->profile_format = CLI_STATS_TEXT;
+        } else if (strcmp(argv[i], "--profile-source=json") == 0) {
+            options->profile_format = CLI_STATS_JSON;
+        } else if (strcmp(argv[i], "--profile-top") == 0) {
+            if (i + 1 >= argc || atol(argv[i + 1]) <= 0 || atol(argv[i + 1]) > PROFILE_MAX_TOP) {
+                fprintf(err, "Error: --profile-top requiere un número entre 1 y %d\n\n", PROFILE_MAX_TOP);
+                return -1;
+            }
+            options->profile_top = (size_t)atol(argv[++i]);
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            return 1;
+        } else if (argv[i][0] != '-') {
+            options->inputs[options->input_count++] = argv[i];
+            if (argv[i][0] == '@') {
+                options->force_batch = 1;
+            }
+        } else {
+            fprintf(err, "Error: Opción desconocida '%s'\n\n", argv[i]);
+            return -1;
+        }
+    }
+    if (options->prof && options->run_mode == DRIVER_RUN_NONE
+            && (options->syntax_check || options->generate_tokens || options->emit_module != NULL)) {
+        fprintf(err, "Error: --prof ejecuta el programa; no se combina con -p, -t ni --emit-module\n\n");
+        return -1;
+    }
+    if (options->prof && options->run_mode == DRIVER_RUN_NONE) {
+        options->run_mode = DRIVER_RUN_VM;
+    }
+    return 0;
+}
+
+/**
+ * @brief Libera los recursos reservados por cli_parse().
+ *
+ * @param options Las opciones.
+ */
+void cli_free(CliOptions *options) {
+    free(options->inputs);
+    options->inputs = NULL;
+    options->input_count = 0;
+}
+
+/**
+ * @brief Perfil conjunto de todas las entradas (--profile-source).
+ *
+ * Cada fuente se lee con malloc y se libera antes del siguiente, de modo que
+ * la memoria depende del archivo más grande y no del corpus.
+ */
+static int run_profile(const CliOptions *options, FILE *out, FILE *err) {
+    SourceProfile profile;
+    if (profile_init(&profile, options->profile_top) != 0) {
+        fprintf(err, "Error: Memoria insuficiente\n");
+        return 1;
+    }
+    int result = 0;
+    for (size_t i = 0; i < options->input_count; i++) {
+        size_t length = 0;
+        char *source = driver_read_source(options->inputs[i], NULL, &length);
+        if (source == NULL) {
+            fprintf(err, "Error: No se pudo leer el archivo '%s'\n", options->inputs[i]);
+            result = 1;
+            continue;
+        }
+        profile_add_source(&profile, source, length, options->lexer_flags);
+        driver_release_source(source, NULL);
+    }
+    if (options->profile_format == CLI_STATS_JSON) {
+        profile_print_json(&profile, out);
+    } else {
+        profile_print(&profile, out);
+    }
+    profile_free(&profile);
+    return result;
+}
+
+/**
+ * @brief Ejecuta cada entrada con la máquina virtual y reporta su perfil conjunto (--vm-profile).
+ *
+ * Cada programa se compila como con --run; la salida de print() va a @p out
+ * y el perfil, al terminar, a @p err.
+ */
+static int run_vm_profile(const CliOptions *options, Cache *cache, Arena *arena, FILE *out, FILE *err) {
+    VmProfile profile;
+    if (vm_profile_init(&profile) != 0) {
+        fprintf(err, "Error: Memoria insuficiente\n");
+        return 1;
+    }
+    DriverContext ctx = { out, err, cache, arena, options->lexer_flags, options->parse_threads,
+                          DRIVER_RUN_VM, options->inline_calls ? &options->inline_options : NULL,
+                          options->inline_report, options->codegen_flags, options->heap_stats,
+                          options->incremental, options->incremental_report, options->codegen_threads,
+                          options->vm_flags, &profile, NULL };
+    int result = 0;
+    for (size_t i = 0; i < options->input_count; i++) {
+        char *source = driver_read_source(options->inputs[i], arena, NULL);
+        if (source == NULL) {
+            fprintf(err, "Error: No se pudo leer el archivo '%s'\n", options->inputs[i]);
+            result = 1;
+            continue;
+        }
+        RunResult run;
+        if (driver_execute_source(options->inputs[i], source, &ctx, &run) != 0) {
+            result = 1;
+        }
+        driver_release_source(source, arena);
+    }
+    fflush(out);
+    vm_profile_print(&profile, err);
+    vm_profile_free(&profile);
+    return result;
+}
+
+/**
+ * @brief Elige entre el perfil, el modo por lotes y el de un archivo, y lo ejecuta.
+ */
+static int dispatch(const CliOptions *options, Cache *cache, Arena *arena, FILE *out, FILE *err) {
+    if (options->profile_format != CLI_STATS_NONE) {
+        return run_profile(options, out, err);
+    }
+    if (options->vm_profile) {
+        return run_vm_profile(options, cache, arena, out, err);
+    }
+
+    struct stat st;
+    int batch = options->force_batch || options->input_count > 1
+             || (stat(options->inputs[0], &st) == 0 && S_ISDIR(st.st_mode));
+
+    if (options->run_mode != DRIVER_RUN_NONE && batch) {
+        fprintf(err, "Error: --run y --jit ejecutan un solo archivo\n");
+        return 1;
+    }
+    if (options->emit_module != NULL && batch) {
+        fprintf(err, "Error: --emit-module compila un solo archivo\n");
+        return 1;
+    }
+    if (options->emit_module != NULL && options->run_mode != DRIVER_RUN_NONE) {
+        fprintf(err, "Error: --emit-module solo compila; no se combina con --run ni --jit\n");
+        return 1;
+    }
+    if (options->load_module && options->run_mode == DRIVER_RUN_NONE) {
+        fprintf(err, "Error: --module requiere --run o --jit\n");
+        return 1;
+    }
+    if (options->load_module && options->incremental) {
+        fprintf(err, "Error: --module carga bytecode ya compilado; no se combina con --incremental\n");
+        return 1;
+    }
+
+    if (batch) {
+        BatchOptions batch_options = {
+            options->generate_tokens, options->syntax_check, options->threads,
+            options->lexer_flags, cache, out, err, stats_current
+        };
+        return batch_run(options->inputs, options->input_count, &batch_options);
+    }
+
+    DriverContext ctx = { out, err, cache, arena, options->lexer_flags, options->parse_threads,
+                          options->run_mode, options->inline_calls ? &options->inline_options : NULL,
+                          options->inline_report, options->codegen_flags, options->heap_stats,
+                          options->incremental, options->incremental_report, options->codegen_threads,
+                          options->vm_flags, NULL, options->prof ? &options->prof_options : NULL };
+    if (options->emit_module != NULL) {
+        return driver_emit_module(options->inputs[0], options->emit_module, &ctx);
+    }
+    if (options->run_mode != DRIVER_RUN_NONE) {
+        return options->load_module ? driver_run_module(options->inputs[0], &ctx)
+                                    : driver_run_program(options->inputs[0], &ctx);
+    }
+    if (options->generate_tokens) {
+        return driver_generate_tokens_file(options->inputs[0], &ctx);
+    }
+    if (options->syntax_check) {
+        return driver_run_syntax_analysis(options->inputs[0], &ctx);
+    }
+    return driver_run_lexical_analysis(options->inputs[0], &ctx);
+}
+
+/**
+ * @brief Ejecuta la acción solicitada sobre las entradas.
+ *
+ * Con --stats, las estadísticas se imprimen en @p err al terminar.
+ *
+ * @param options Opciones interpretadas (con al menos una entrada).
+ * @param cache Caché abierta, o NULL.
+ * @param arena Arena para leer el fuente en el modo de un archivo, o NULL.
+ * @param out Salida informativa.
+ * @param err Mensajes de error, diagnósticos y estadísticas.
+ * @return 0 si es exitoso, 1 si hay error; con --run o --jit, el valor de main.
+ */
+int cli_run(const CliOptions *options, Cache *cache, Arena *arena, FILE *out, FILE *err) {
+    if (options->stats_format == CLI_STATS_NONE) {
+        return dispatch(options, cache, arena, out, err);
+    }
+
+    CompilerStats stats;
+    memset(&stats, 0, sizeof(stats));
+    CompilerStats *previous = stats_begin(&stats);
+    uint64_t start = stats_now_ns();
+    int result = dispatch(options, cache, arena, out, err);
+    double wall_ms = (double)(stats_now_ns() - start) / 1e6;
+    stats_begin(previous);
+
+    fflush(out);
+    if (options->stats_format == CLI_STATS_JSON) {
+        stats_print_json(&stats, wall_ms, err);
+    } else {
+        fprintf(err, "\n");
+        stats_print(&stats, wall_ms, err);
+    }
+    return result;
+}
@@ -0,0 +1,593 @@
+/**
+ * @file driver.c
+ * @brief Implementación de las operaciones sobre un único archivo fuente.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/driver.h"
+#include "../../include/bytecode.h"
+#include "../../include/image.h"
+#include "../../include/incremental.h"
+#include "../../include/jit.h"
+#include "../../include/lexer.h"
+#include "../../include/parser.h"
+#include "../../include/sema.h"
+#include "../../include/stats.h"
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+/**
+ * @brief Construye la ruta del archivo de tokens asociado a un archivo fuente.
+ *
+ * El nombre se forma con el nombre base del archivo sin extensión y el sufijo
+ * `_tokens.txt`, dentro de DRIVER_TOKENS_DIR.
+ *
+ * @param filename El archivo fuente.
+ * @param buffer Destino de la ruta generada.
+ * @param size Tamaño de @p buffer.
+ * @return 0 si es exitoso, 1 si la ruta no cabe en el buffer.
+ */
+int driver_tokens_output_path(const char *filename, char *buffer, size_t size) {
+    // Crear nombre basado en el archivo fuente
+    const char *base = strrchr(filename, '/');
+    base = base ? base + 1 : filename;
+    
+    // Encontrar el punto de la extensión
+    const char *dot = strrchr(base, '.');
+    int written;
+    if (dot) {
+        size_t len = dot - base;
+        written = snprintf(buffer, size, DRIVER_TOKENS_DIR "/%.*s_tokens.txt", (int)len, base);
+    } else {
+        written = snprintf(buffer, size, DRIVER_TOKENS_DIR "/%s_tokens.txt", base);
+    }
+    return (written < 0 || (size_t)written >= size) ? 1 : 0;
+}
+
+/**
+ * @brief Lee un archivo fuente completo.
+ *
+ * Con arena, el contenido vive hasta el siguiente arena_reset(); sin ella se
+ * reserva con malloc. En ambos casos debe devolverse con driver_release_source().
+ *
+ * @param filename El archivo a leer.
+ * @param arena Arena donde reservar el contenido, o NULL.
+ * @param length Destino de la longitud leída (puede ser NULL).
+ * @return El contenido terminado en '\0', o NULL si hay error.
+ */
+char *driver_read_source(const char *filename, Arena *arena, size_t *length) {
+    uint64_t start = stats_clock();
+    FILE *file = fopen(filename, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fileno(file), &st) != 0 || !S_ISREG(st.st_mode)) {
+        fclose(file);
+        return NULL;
+    }
+    size_t size = (size_t)st.st_size;
+    char *buffer = arena ? (char *)arena_alloc(arena, size + 1) : (char *)malloc(size + 1);
+    if (buffer == NULL) {
+        fclose(file);
+        return NULL;
+    }
+    if (arena == NULL) {
+        STATS_ALLOC(size + 1);
+    }
+    size_t readn = fread(buffer, 1, size, file);
+    buffer[readn] = '\0';
+    fclose(file);
+    if (length != NULL) {
+        *length = readn;
+    }
+    STATS_ADD(files, 1);
+    STATS_ADD(bytes_read, readn);
+    stats_phase_add(STATS_READ, stats_clock() - start);
+    return buffer;
+}
+
+/**
+ * @brief Libera un fuente leído con driver_read_source().
+ *
+ * @param source El contenido leído.
+ * @param arena La arena usada en la lectura, o NULL.
+ */
+void driver_release_source(char *source, Arena *arena) {
+    if (arena == NULL) {
+        free(source);
+    } else {
+        stats_note_arena_peak(arena->peak);
+    }
+}
+
+/**
+ * @brief Ejecuta el análisis léxico y muestra los tokens.
+ * 
+ * @param filename El nombre del archivo a analizar.
+ * @param ctx Flujos y recursos de la operación.
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+int driver_run_lexical_analysis(const char *filename, const DriverContext *ctx) {
+    FILE *out = ctx->out;
+    fprintf(out, "=== ANÁLISIS LÉXICO ===\n");
+    fprintf(out, "Archivo: %s\n\n", filename);
+    
+    char *source = driver_read_source(filename, ctx->arena, NULL);
+    if (source == NULL) {
+        fprintf(ctx->err, "Error: No se pudo leer el archivo '%s'\n", filename);
+        return 1;
+    }
+    
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    lexer_set_flags(&lexer, ctx->lexer_flags);
+    
+    fprintf(out, "%-6s %-8s %-12s %s\n", "Línea", "Columna", "Tipo", "Lexema");
+    fprintf(out, "%-6s %-8s %-12s %s\n", "-----", "-------", "----", "------");
+    
+    uint64_t loop_start = stats_clock();
+    uint64_t lex_ns = 0;
+    int token_count = 0;
+    for (;;) {
+        LexToken token;
+        uint64_t lex_start = stats_clock();
+        int ok = lexer_next_compact(&lexer, &token);
+        lex_ns += stats_clock() - lex_start;
+        if (!ok) {
+            fprintf(ctx->err, "Error al obtener el siguiente token.\n");
+            break;
+        }
+        
+        int length = token.type == TOKEN_EOF ? 3 : (int)token.length;
+        fprintf(out, "%-6u %-8u %-12s %.*s\n", 
+               token.line, 
+               token.column, 
+               token_type_name(token.type), 
+               length, token.type == TOKEN_EOF ? "EOF" : source + token.offset);
+        
+        token_count++;
+        
+        if (token.type == TOKEN_EOF) {
+            break;
+        }
+    }
+    
+    fprintf(out, "\nTotal de tokens: %d\n", token_count);
+    uint64_t loop_ns = stats_clock() - loop_start;
+    stats_phase_add(STATS_LEX, lex_ns);
+    stats_phase_add(STATS_WRITE, loop_ns - lex_ns);
+    
+    driver_release_source(source, ctx->arena);
+    return 0;
+}
+
+/**
+ * @brief Ejecuta el análisis léxico y sintáctico e imprime los diagnósticos.
+ *
+ * Todos los errores del archivo se reportan en una sola ejecución gracias a
+ * la recuperación en modo pánico del parser.
+ *
+ * @param filename El archivo fuente.
+ * @param ctx Recursos de la operación.
+ * @return 0 si no hubo errores, 1 en caso contrario.
+ */
+int driver_run_syntax_analysis(const char *filename, const DriverContext *ctx) {
+    FILE *out = ctx->out;
+    fprintf(out, "=== ANÁLISIS SINTÁCTICO ===\n");
+    fprintf(out, "Archivo: %s\n\n", filename);
+    
+    char *source = driver_read_source(filename, ctx->arena, NULL);
+    if (source == NULL) {
+        fprintf(ctx->err, "Error: No se pudo leer el archivo '%s'\n", filename);
+        return 1;
+    }
+    
+    DiagEngine diag;
+    if (diag_init(&diag, 0) != 0) {
+        fprintf(ctx->err, "Error: Memoria insuficiente\n");
+        driver_release_source(source, ctx->arena);
+        return 1;
+    }
+    
+    ParseResult result;
+    int failed = ctx->parse_threads == 1
+        ? parse_source(source, ctx->lexer_flags, &diag, &result)
+        : parse_source_parallel(source, ctx->lexer_flags, ctx->parse_threads, &diag, &result);
+    fflush(out);
+    diag_print(&diag, filename, ctx->err);
+    
+    if (failed) {
+        fprintf(out, "✗ %zu errores léxicos, %zu errores sintácticos (%zu tokens)\n",
+                result.lexical_errors, result.syntax_errors, result.tokens);
+    } else {
+        fprintf(out, "✓ Sin errores (%zu tokens)\n", result.tokens);
+    }
+    
+    diag_free(&diag);
+    driver_release_source(source, ctx->arena);
+    return failed;
+}
+
+/**
+ * @brief Escribe el archivo de tokens de un código fuente ya cargado.
+ *
+ * Si hay caché y contiene la clave del fuente, el archivo se copia desde ella
+ * sin volver a ejecutar el lexer. En otro caso se genera en un archivo
+ * temporal que se renombra al destino (escritura atómica) y se guarda en la
+ * caché.
+ *
+ * @param filename Nombre del archivo fuente.
+ * @param source Contenido del archivo fuente.
+ * @param length Longitud de @p source en bytes.
+ * @param output_path Ruta del archivo de tokens.
+ * @param lexer_flags Opciones del lexer (LEXER_*); forman parte de la clave.
+ * @param cache Caché a usar, o NULL para desactivarla.
+ * @param from_cache Se pone a 1 si la salida se sirvió desde la caché.
+ * @return El número de tokens escritos (0 en un acierto de caché), o -1 si hay error.
+ */
+int driver_write_tokens(const char *filename, const char *source, size_t length,
+                        const char *output_path, unsigned lexer_flags, Cache *cache,
+                        int *from_cache) {
+    *from_cache = 0;
+    uint64_t key = 0;
+    if (cache != NULL) {
+        uint64_t start = stats_clock();
+        key = cache_key(source, length, filename,
+                        (lexer_flags & LEXER_UTF8_COLUMNS) ? "tu" : "t");
+        if (cache_fetch(cache, key, output_path) == 0) {
+            stats_phase_add(STATS_WRITE, stats_clock() - start);
+            *from_cache = 1;
+            return 0;
+        }
+    }
+
+    char temp[600];
+    if (cache_temp_path(output_path, temp, sizeof(temp)) != 0) {
+        return -1;
+    }
+    FILE *output = fopen(temp, "w");
+    if (output == NULL) {
+        return -1;
+    }
+    int token_count = write_tokens_to_stream(filename, source, lexer_flags, output);
+    if (fclose(output) != 0 || token_count < 0 || rename(temp, output_path) != 0) {
+        remove(temp);
+        return -1;
+    }
+
+    if (cache != NULL) {
+        cache_store(cache, key, output_path);
+    }
+    return token_count;
+}
+
+/**
+ * @brief Genera un archivo de tokens para el parser.
+ * 
+ * @param filename El nombre del archivo a analizar.
+ * @param ctx Flujos y recursos de la operación.
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+int driver_generate_tokens_file(const char *filename, const DriverContext *ctx) {
+    FILE *out = ctx->out;
+    fprintf(out, "=== GENERACIÓN DE ARCHIVO DE TOKENS ===\n");
+    fprintf(out, "Archivo fuente: %s\n", filename);
+    
+    char default_output[512];
+    if (driver_tokens_output_path(filename, default_output, sizeof(default_output)) != 0) {
+        fprintf(ctx->err, "Error: Nombre de archivo demasiado largo '%s'\n", filename);
+        return 1;
+    }
+    
+    fprintf(out, "Archivo de salida: %s\n\n", default_output);
+    
+    size_t length = 0;
+    char *source = driver_read_source(filename, ctx->arena, &length);
+    if (source == NULL) {
+        fprintf(ctx->err, "Error: No se pudo leer el archivo '%s'\n", filename);
+        return 1;
+    }
+    
+    int from_cache = 0;
+    int token_count = driver_write_tokens(filename, source, length, default_output,
+                                          ctx->lexer_flags, ctx->cache, &from_cache);
+    driver_release_source(source, ctx->arena);
+    if (token_count < 0) {
+        fprintf(ctx->err, "Error: No se pudo crear el archivo '%s'\n", default_output);
+        return 1;
+    }
+    
+    if (from_cache) {
+        fprintf(out, "✓ Tokens servidos desde la caché: %s\n", default_output);
+    } else {
+        fprintf(out, "✓ Tokens escritos en: %s (%d tokens)\n", default_output, token_count);
+    }
+    fprintf(out, "\n✓ Archivo de tokens generado exitosamente\n");
+    fprintf(out, "  - Formato: tipo_token lexema linea columna [indice_palabra_clave]\n");
+    fprintf(out, "  - Listo para ser usado por el parser\n");
+    
+    return 0;
+}
+
+/**
+ * @brief Expande en línea las llamadas del módulo si ctx lo pide.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int optimize(const char *filename, BcModule *module, const DriverContext *ctx) {
+    if (ctx->inline_options == NULL) {
+        return 0;
+    }
+    InlineReport report;
+    int failed = inline_module_parallel(module, ctx->inline_options, ctx->codegen_threads, &report);
+    if (failed) {
+        fprintf(ctx->err, "Error: Memoria insuficiente\n");
+    } else if (ctx->inline_report) {
+        inline_report_print(&report, module, filename, ctx->err);
+    }
+    inline_report_free(&report);
+    return failed;
+}
+
+/**
+ * @brief Traduce un fuente ya cargado como --run y --jit, con la expansión en línea de ctx.
+ *
+ * Los diagnósticos quedan en @p diag; @p arena, @p sema y @p module se
+ * liberan aparte aunque falle.
+ *
+ * @return 1 si el módulo quedó listo, 0 si el programa tiene errores o falta memoria.
+ */
+static int compile_source(const char *filename, const char *source, const DriverContext *ctx, DiagEngine *diag,
+                          Arena *arena, SemaProgram *sema, BcModule *module) {
+    AstNode *program = NULL;
+    int compiled;
+    if (ctx->incremental && ctx->cache != NULL) {
+        IncrementalReport report;
+        compiled = incremental_compile(filename, source, ctx->cache, ctx->lexer_flags, ctx->codegen_flags,
+                                       ctx->codegen_threads, diag, arena, sema, module, &report) == 0;
+        if (compiled && ctx->incremental_report) {
+            incremental_report_print(&report, filename, ctx->err);
+        }
+        incremental_report_free(&report);
+    } else {
+        compiled = parse_source_ast_parallel(source, ctx->lexer_flags, ctx->parse_threads, diag, arena,
+                                             &program, NULL) == 0
+                && sema_analyze(program, source, diag, sema) == 0
+                && bc_compile_parallel(sema, ctx->codegen_flags, ctx->codegen_threads, diag, module) == 0;
+    }
+    if (!compiled && program == NULL && diag->count == 0) {
+        fprintf(ctx->err, "Error: Memoria insuficiente\n");
+    }
+    return compiled && optimize(filename, module, ctx) == 0;
+}
+
+/**
+ * @brief Ejecuta main tomando muestras (--prof) y escribe el perfil.
+ *
+ * Las pilas colapsadas van a ctx->sampler->output y el resumen a ctx->err.
+ * Si el muestreo no puede iniciarse, el programa se ejecuta igualmente.
+ *
+ * @param filename Nombre con el que se reportan las líneas.
+ * @return Como vm_execute().
+ */
+static int execute_sampled(const BcModule *module, const char *filename, const DriverContext *ctx,
+                           RunResult *result) {
+    const SamplerOptions *options = ctx->sampler;
+    Sampler sampler;
+    if (sampler_init(&sampler, options->interval_us) != 0) {
+        fprintf(ctx->err, "Error: Memoria insuficiente\n");
+        return vm_execute(module, ctx->vm_flags, NULL, ctx->out, result);
+    }
+    int started = sampler_start(&sampler) == 0;
+    if (!started) {
+        fprintf(ctx->err, "Error: No se pudo iniciar el muestreo; se ejecuta sin perfil\n");
+    }
+    int status = ctx->run_mode == DRIVER_RUN_JIT
+               ? jit_run_sampled(module, started ? &sampler : NULL, ctx->out, result)
+               : vm_execute_sampled(module, ctx->vm_flags, started ? &sampler : NULL, ctx->out, result);
+    if (started) {
+        sampler_stop(&sampler);
+        fflush(ctx->out);
+        const char *output = options->output != NULL ? options->output : SAMPLER_DEFAULT_OUTPUT;
+        FILE *folded = fopen(output, "w");
+        int failed = folded == NULL;
+        if (!failed) {
+            failed = sampler_report(&sampler, module, filename, folded, ctx->err, options->top);
+            failed |= fclose(folded) != 0;
+        }
+        if (failed) {
+            fprintf(ctx->err, "Error: No se pudo escribir el perfil '%s'\n", output);
+        } else {
+            fprintf(ctx->err, "✓ Pilas colapsadas escritas en: %s\n", output);
+        }
+    }
+    sampler_free(&sampler);
+    return status;
+}
+
+/**
+ * @brief Ejecuta main de un módulo con la VM o el JIT según ctx->run_mode.
+ *
+ * @param filename Nombre con el que se reportan las líneas del perfil (ctx->sampler).
+ * @return 0 si main terminó, 1 si hubo un error de ejecución (ya reportado en ctx->err).
+ */
+static int execute_module(const BcModule *module, const char *filename, const DriverContext *ctx,
+                          RunResult *result) {
+    int status;
+    if (ctx->sampler != NULL) {
+        status = execute_sampled(module, filename, ctx, result);
+    } else {
+        status = ctx->run_mode == DRIVER_RUN_JIT
+               ? jit_run(module, ctx->out, result)
+               : vm_execute(module, ctx->vm_flags, ctx->vm_profile, ctx->out, result);
+    }
+    fflush(ctx->out);
+    if (status != 0) {
+        const BcFunction *function = &module->functions[result->function];
+        fprintf(ctx->err, "Error de ejecución en '%.*s': %s\n", (int)function->name_length,
+                function->name, run_status_message(result->status));
+    }
+    if (ctx->heap_stats) {
+        rt_stats_print(&result->heap, ctx->err);
+    }
+    return status;
+}
+
+/**
+ * @brief Compila un fuente ya cargado y ejecuta su main.
+ *
+ * Los diagnósticos y el error de ejecución, si lo hay, se escriben en
+ * ctx->err; la salida de print() va a ctx->out. El AST vive en una arena
+ * propia que se libera al terminar.
+ *
+ * @param filename Nombre con el que se reportan los diagnósticos.
+ * @param source El código fuente terminado en '\0'.
+ * @param ctx Recursos de la operación (run_mode elige la VM o el JIT;
+ *            inline_options, si expandir llamadas en línea antes;
+ *            codegen_flags, si vectorizar; heap_stats, si reportar las
+ *            asignaciones de String y Array; incremental, si reutilizar
+ *            de ctx->cache el bytecode de las funciones sin cambios;
+ *            parse_threads, los hilos del análisis sintáctico;
+ *            codegen_threads, los hilos de la traducción y la expansión;
+ *            vm_flags y vm_profile, las opciones y el perfil de la VM;
+ *            sampler, si tomar muestras con --prof).
+ * @param result Estado y valor de main.
+ * @return 0 si main terminó, 1 si hubo un error de ejecución, -1 si el
+ *         programa tiene errores y no se ejecutó.
+ */
+int driver_execute_source(const char *filename, const char *source, const DriverContext *ctx,
+                          RunResult *result) {
+    memset(result, 0, sizeof(*result));
+    DiagEngine diag;
+    if (diag_init(&diag, 0) != 0) {
+        fprintf(ctx->err, "Error: Memoria insuficiente\n");
+        return -1;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    SemaProgram sema;
+    BcModule module;
+    memset(&sema, 0, sizeof(sema));
+    memset(&module, 0, sizeof(module));
+
+    int status = -1;
+    if (compile_source(filename, source, ctx, &diag, &arena, &sema, &module)) {
+        status = execute_module(&module, filename, ctx, result);
+    }
+    diag_print(&diag, filename, ctx->err);
+
+    bc_free(&module);
+    sema_free(&sema);
+    arena_free(&arena);
+    diag_free(&diag);
+    return status;
+}
+
+/**
+ * @brief Compila un archivo como --run y guarda el módulo en una imagen (--emit-module).
+ *
+ * La imagen se escribe en un archivo temporal que se renombra al destino,
+ * así que nunca queda a medias.
+ *
+ * @param filename El archivo fuente.
+ * @param output Ruta de la imagen.
+ * @param ctx Recursos de la operación (como en driver_execute_source(); run_mode no se usa).
+ * @return 0 si es exitoso, 1 si el programa tiene errores o no se pudo escribir.
+ */
+int driver_emit_module(const char *filename, const char *output, const DriverContext *ctx) {
+    char *source = driver_read_source(filename, ctx->arena, NULL);
+    DiagEngine diag;
+    if (source == NULL) {
+        fprintf(ctx->err, "Error: No se pudo leer el archivo '%s'\n", filename);
+        return 1;
+    }
+    if (diag_init(&diag, 0) != 0) {
+        fprintf(ctx->err, "Error: Memoria insuficiente\n");
+        driver_release_source(source, ctx->arena);
+        return 1;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    SemaProgram sema;
+    BcModule module;
+    memset(&sema, 0, sizeof(sema));
+    memset(&module, 0, sizeof(module));
+
+    int failed = 1;
+    if (compile_source(filename, source, ctx, &diag, &arena, &sema, &module)) {
+        char temp[600];
+        FILE *file = cache_temp_path(output, temp, sizeof(temp)) == 0 ? fopen(temp, "wb") : NULL;
+        long size = -1;
+        if (file != NULL) {
+            failed = image_write(&module, file);
+            size = ftell(file);
+            failed |= fclose(file) != 0;
+            failed = failed || rename(temp, output) != 0;
+            if (failed) {
+                remove(temp);
+            }
+        }
+        if (failed) {
+            fprintf(ctx->err, "Error: No se pudo escribir el módulo '%s'\n", output);
+        } else {
+            fprintf(ctx->out, "✓ Módulo escrito en: %s (%zu funciones, %ld bytes)\n", output,
+                    module.function_count, size);
+        }
+    }
+    diag_print(&diag, filename, ctx->err);
+
+    bc_free(&module);
+    sema_free(&sema);
+    arena_free(&arena);
+    diag_free(&diag);
+    driver_release_source(source, ctx->arena);
+    return failed;
+}
+
+/**
+ * @brief Ejecuta un módulo escrito con --emit-module (--run --module, --jit --module).
+ *
+ * El módulo se ejecuta tal como se guardó: las opciones de traducción y de
+ * expansión en línea de ctx no se aplican.
+ *
+ * @param path La imagen.
+ * @param ctx Recursos de la operación.
+ * @return El valor de main (0 si no devuelve nada), o 1 si hubo errores.
+ */
+int driver_run_module(const char *path, const DriverContext *ctx) {
+    uint64_t start = stats_clock();
+    BcImage image;
+    BcModule module;
+    ImageStatus opened = image_open(path, &image, &module);
+    stats_phase_add(STATS_READ, stats_clock() - start);
+    if (opened != IMAGE_OK) {
+        fprintf(ctx->err, "Error: No se pudo cargar el módulo '%s': %s\n", path, image_status_message(opened));
+        return 1;
+    }
+    RunResult result;
+    memset(&result, 0, sizeof(result));
+    int status = execute_module(&module, path, ctx, &result);
+    image_close(&image, &module);
+    return status == 0 ? result.value : 1;
+}
+
+/**
+ * @brief Compila y ejecuta un archivo (--run con la VM, --jit con el JIT).
+ *
+ * @param filename El archivo fuente.
+ * @param ctx Recursos de la operación.
+ * @return El valor de main (0 si no devuelve nada), o 1 si hubo errores.
+ */
+int driver_run_program(const char *filename, const DriverContext *ctx) {
+    char *source = driver_read_source(filename, ctx->arena, NULL);
+    if (source == NULL) {
+        fprintf(ctx->err, "Error: No se pudo leer el archivo '%s'\n", filename);
+        return 1;
+    }
+    RunResult result;
+    int status = driver_execute_source(filename, source, ctx, &result);
+    driver_release_source(source, ctx->arena);
+    return status == 0 ? result.value : 1;
+}
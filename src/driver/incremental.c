@@ -0,0 +1,707 @@
+/**
+ * @file incremental.c
+ * @brief Compilación incremental por función (--incremental).
+ *
+ * El fuente se lexea entero (las huellas necesitan todos los tokens) y se
+ * parte en funciones de nivel superior contando llaves. Para cada función
+ * se calcula su huella, la de su firma (de 'fn' hasta la llave del cuerpo,
+ * sin los nombres de los parámetros) y sus dependencias: los
+ * identificadores seguidos de '(' de su cuerpo. El lenguaje no tiene tipos
+ * con nombre, así que las llamadas son todas las referencias entre
+ * funciones.
+ *
+ * La clave del bytecode de una función combina su huella, la firma actual
+ * de cada dependencia y las opciones de compilación: si coincide con la
+ * guardada, nada de lo que influye en su traducción cambió. Esas funciones
+ * se pasan al parser solo con su firma y un cuerpo vacío, y
+ * bc_compile_reusing() toma su bytecode de la caché; las demás se
+ * analizan, comprueban y traducen desde el fuente. El grafo, las claves y
+ * el bytecode de todo el archivo van en una sola entrada `.inc` de la
+ * caché: con miles de funciones, un archivo por función costaría más en
+ * llamadas al sistema que lo que ahorra.
+ *
+ * Con diagnósticos del lexer, o si el fuente no se puede partir, se compila
+ * entero como sin --incremental; con errores en las funciones recompiladas
+ * se repite sin reutilizar nada, para que los diagnósticos sean
+ * exactamente los mismos.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/incremental.h"
+#include "../../include/hash.h"
+#include "../../include/lexer.h"
+#include "../../include/parser.h"
+#include "../../include/stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Primera línea de la entrada de un archivo. */
+#define PACK_HEADER "compilador-inc " COMPILADOR_VERSION "\n"
+
+/**
+ * @brief Función de nivel superior del fuente.
+ */
+typedef struct IncItem {
+    size_t first;               /**< Token 'fn' */
+    size_t body;                /**< Llave que abre el cuerpo */
+    size_t last;                /**< Llave que lo cierra */
+    uint64_t fingerprint;       /**< Huella de todos sus tokens */
+    uint64_t interface;         /**< Huella de su firma */
+    size_t dep_first;           /**< Dependencias en IncState.deps */
+    size_t dep_count;
+    uint64_t key;               /**< Clave de su bytecode en la caché */
+    IncrementalReason reason;
+    size_t dependency;          /**< Con INCREMENTAL_DEPENDENT, token de la dependencia */
+} IncItem;
+
+/**
+ * @brief Nombre con un valor, para buscar con bsearch().
+ */
+typedef struct IncName {
+    const char *name;
+    size_t length;
+    uint64_t fingerprint;
+    uint64_t interface;
+    uint64_t key;               /**< En la entrada anterior, clave de su bytecode */
+    const uint8_t *data;        /**< y el bytecode */
+    size_t offset;
+    size_t size;
+} IncName;
+
+/**
+ * @brief Estado de una compilación incremental.
+ */
+typedef struct IncState {
+    const char *source;
+    const LexToken *tokens;
+    IncItem *items;
+    size_t item_count;
+    size_t *deps;               /**< Token del nombre de cada dependencia */
+    size_t dep_count;
+    size_t dep_capacity;
+    IncName *names;             /**< Funciones actuales, ordenadas */
+    IncName *old;               /**< Funciones del grafo anterior, ordenadas */
+    size_t old_count;
+} IncState;
+
+/* ---- Partición en funciones ---- */
+
+/**
+ * @brief Indica si dos tokens tienen el mismo lexema.
+ */
+static int same_lexeme(const char *source, const LexToken *a, const LexToken *b) {
+    return a->length == b->length && memcmp(source + a->offset, source + b->offset, a->length) == 0;
+}
+
+/**
+ * @brief Añade las llamadas del cuerpo de @p item a sus dependencias, sin repetir.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int collect_deps(IncState *st, IncItem *item) {
+    item->dep_first = st->dep_count;
+    for (size_t k = item->body + 1; k < item->last; k++) {
+        if (st->tokens[k].type != TOKEN_IDENTIFIER || st->tokens[k + 1].type != TOKEN_LPAREN) {
+            continue;
+        }
+        int seen = 0;
+        for (size_t d = item->dep_first; d < st->dep_count && !seen; d++) {
+            seen = same_lexeme(st->source, &st->tokens[st->deps[d]], &st->tokens[k]);
+        }
+        if (seen) {
+            continue;
+        }
+        if (st->dep_count == st->dep_capacity) {
+            size_t capacity = st->dep_capacity ? st->dep_capacity * 2 : 256;
+            size_t *grown = (size_t *)realloc(st->deps, capacity * sizeof(size_t));
+            if (grown == NULL) {
+                return 1;
+            }
+            st->deps = grown;
+            st->dep_capacity = capacity;
+        }
+        st->deps[st->dep_count++] = k;
+    }
+    item->dep_count = st->dep_count - item->dep_first;
+    return 0;
+}
+
+/**
+ * @brief Encadena en @p hash el tipo y el lexema de un token.
+ */
+static uint64_t hash_token(const char *source, const LexToken *token, uint64_t hash) {
+    uint32_t type = (uint32_t)token->type;
+    hash = hash64(&type, sizeof(type), hash);
+    return hash64(source + token->offset, token->length, hash);
+}
+
+/**
+ * @brief Calcula las huellas de una función.
+ *
+ * La firma solo depende de los tipos y lexemas, sin los nombres de los
+ * parámetros (no afectan a quien llama); la huella completa también
+ * de la posición de cada token respecto del 'fn', porque el bytecode guarda
+ * las líneas relativas a la declaración y las columnas tal cual.
+ */
+static void fingerprint_item(const IncState *st, IncItem *item) {
+    const LexToken *tokens = st->tokens;
+    uint64_t interface = 0;
+    for (size_t k = item->first; k < item->body; k++) {
+        if (tokens[k].type != TOKEN_IDENTIFIER || tokens[k + 1].type != TOKEN_COLON) {
+            interface = hash_token(st->source, &tokens[k], interface);
+        }
+    }
+    uint64_t fingerprint = 0;
+    for (size_t k = item->first; k <= item->last; k++) {
+        uint32_t position[2] = { tokens[k].line - tokens[item->first].line, tokens[k].column };
+        fingerprint = hash64(position, sizeof(position), fingerprint);
+        fingerprint = hash_token(st->source, &tokens[k], fingerprint);
+    }
+    item->interface = interface;
+    item->fingerprint = fingerprint;
+}
+
+/**
+ * @brief Parte los tokens en funciones de nivel superior.
+ *
+ * @return 0 si es exitoso; 1 si hay algo fuera de una función, las llaves
+ *         no cierran o falta memoria (entonces se compila el fuente entero).
+ */
+static int split_items(IncState *st, size_t count) {
+    const LexToken *tokens = st->tokens;
+    size_t capacity = 64;
+    st->items = (IncItem *)malloc(capacity * sizeof(IncItem));
+    if (st->items == NULL) {
+        return 1;
+    }
+    size_t i = 0;
+    while (tokens[i].type != TOKEN_EOF) {
+        if (tokens[i].type != TOKEN_KW_FN || tokens[i + 1].type != TOKEN_IDENTIFIER) {
+            return 1;
+        }
+        IncItem item;
+        memset(&item, 0, sizeof(item));
+        item.first = i;
+        size_t k = i + 2;
+        while (tokens[k].type != TOKEN_LBRACE) {
+            TokenType type = tokens[k].type;
+            if (type == TOKEN_EOF || type == TOKEN_KW_FN || type == TOKEN_SEMICOLON
+                    || type == TOKEN_RBRACE) {
+                return 1;
+            }
+            k++;
+        }
+        item.body = k;
+        size_t depth = 0;
+        for (; k < count; k++) {
+            if (tokens[k].type == TOKEN_LBRACE) {
+                depth++;
+            } else if (tokens[k].type == TOKEN_RBRACE && --depth == 0) {
+                break;
+            } else if (tokens[k].type == TOKEN_EOF) {
+                return 1;
+            }
+        }
+        item.last = k;
+        if (st->item_count == capacity) {
+            capacity *= 2;
+            IncItem *grown = (IncItem *)realloc(st->items, capacity * sizeof(IncItem));
+            if (grown == NULL) {
+                return 1;
+            }
+            st->items = grown;
+        }
+        fingerprint_item(st, &item);
+        if (collect_deps(st, &item) != 0) {
+            return 1;
+        }
+        st->items[st->item_count++] = item;
+        i = item.last + 1;
+    }
+    return 0;
+}
+
+/* ---- Nombres y grafo ---- */
+
+static int compare_names(const void *a, const void *b) {
+    const IncName *x = (const IncName *)a;
+    const IncName *y = (const IncName *)b;
+    int order = memcmp(x->name, y->name, x->length < y->length ? x->length : y->length);
+    if (order != 0) {
+        return order;
+    }
+    return (x->length > y->length) - (x->length < y->length);
+}
+
+/**
+ * @brief Busca un nombre en una tabla ordenada.
+ */
+static const IncName *find_name(const IncName *table, size_t count, const char *name, size_t length) {
+    if (table == NULL) {
+        return NULL;
+    }
+    IncName probe;
+    memset(&probe, 0, sizeof(probe));
+    probe.name = name;
+    probe.length = length;
+    return (const IncName *)bsearch(&probe, table, count, sizeof(IncName), compare_names);
+}
+
+/**
+ * @brief Tabla ordenada de las funciones actuales.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int build_names(IncState *st) {
+    st->names = (IncName *)malloc((st->item_count > 0 ? st->item_count : 1) * sizeof(IncName));
+    if (st->names == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; i < st->item_count; i++) {
+        const LexToken *name = &st->tokens[st->items[i].first + 1];
+        IncName *entry = &st->names[i];
+        memset(entry, 0, sizeof(*entry));
+        entry->name = st->source + name->offset;
+        entry->length = name->length;
+        entry->fingerprint = st->items[i].fingerprint;
+        entry->interface = st->items[i].interface;
+    }
+    qsort(st->names, st->item_count, sizeof(IncName), compare_names);
+    return 0;
+}
+
+/**
+ * @brief Firma actual de la función llamada en el token @p token (0 si no existe).
+ */
+static uint64_t current_interface(const IncState *st, size_t token) {
+    const LexToken *name = &st->tokens[token];
+    const IncName *entry = find_name(st->names, st->item_count, st->source + name->offset, name->length);
+    return entry != NULL ? entry->interface : 0;
+}
+
+/**
+ * @brief Lee la entrada anterior del archivo.
+ *
+ * Tras PACK_HEADER hay una línea por función con su nombre, su huella, la
+ * de su firma y la clave de su bytecode en hexadecimal, el desplazamiento
+ * y la longitud de ese bytecode y sus dependencias separadas por comas;
+ * luego una línea vacía y los bytecodes seguidos. Las entradas apuntan a
+ * @p text. Una entrada mal formada se trata como vacía. cache_load() ya
+ * descartó las entradas cuya suma de comprobación no coincide, y
+ * bc_compile_reusing() valida cada bytecode antes de usarlo: si alguno no
+ * pasa, las funciones reutilizadas quedan como INCREMENTAL_UNCACHED y se
+ * traducen desde el fuente.
+ */
+static void parse_pack(IncState *st, char *text, size_t length) {
+    size_t header = strlen(PACK_HEADER);
+    char *blobs = NULL;
+    for (size_t i = header; i + 1 < length && blobs == NULL; i++) {
+        if (text[i] == '\n' && text[i + 1] == '\n') {
+            blobs = text + i + 2;
+        }
+    }
+    if (length < header || memcmp(text, PACK_HEADER, header) != 0 || blobs == NULL) {
+        return;
+    }
+    size_t lines = 0;
+    for (char *c = text + header; c < blobs; c++) {
+        lines += *c == '\n';
+    }
+    st->old = (IncName *)malloc(lines * sizeof(IncName));
+    if (st->old == NULL) {
+        return;
+    }
+    size_t blob_bytes = length - (size_t)(blobs - text);
+    char *p = text + header;
+    while (p < blobs - 1) {
+        char *line_end = memchr(p, '\n', (size_t)(blobs - p));
+        *line_end = '\0';
+        char *space = strchr(p, ' ');
+        char *rest = NULL;
+        IncName entry;
+        memset(&entry, 0, sizeof(entry));
+        if (space != NULL) {
+            entry.name = p;
+            entry.length = (size_t)(space - p);
+            entry.fingerprint = strtoull(space + 1, &rest, 16);
+            entry.interface = strtoull(rest, &rest, 16);
+            entry.key = strtoull(rest, &rest, 16);
+            entry.offset = strtoull(rest, &rest, 10);
+            entry.size = strtoull(rest, &rest, 10);
+        }
+        if (space == NULL || rest == NULL || *rest != ' ' || entry.offset > blob_bytes
+                || entry.size > blob_bytes - entry.offset) {
+            free(st->old);
+            st->old = NULL;
+            st->old_count = 0;
+            return;
+        }
+        entry.data = (const uint8_t *)blobs + entry.offset;
+        st->old[st->old_count++] = entry;
+        p = line_end + 1;
+    }
+    qsort(st->old, st->old_count, sizeof(IncName), compare_names);
+}
+
+/**
+ * @brief Guarda en la caché el grafo y el bytecode de todas las funciones.
+ *
+ * El de las recompiladas se toma de @p module (antes de la expansión en
+ * línea, ver bc_function_save()); el de las reutilizadas, de @p saved. Si
+ * no se recompiló nada y las funciones son las mismas, la entrada anterior
+ * sigue valiendo y no se reescribe.
+ */
+static void save_pack(const IncState *st, Cache *cache, uint64_t key, const BcSaved *saved,
+                      const SemaProgram *sema, const BcModule *module) {
+    size_t rebuilt = 0;
+    for (size_t i = 0; i < st->item_count; i++) {
+        rebuilt += st->items[i].reason != INCREMENTAL_REUSED;
+    }
+    if (rebuilt == 0 && st->item_count == st->old_count) {
+        return;
+    }
+    char *blobs = NULL;
+    size_t blobs_length = 0;
+    size_t *offsets = (size_t *)malloc((st->item_count + 1) * sizeof(size_t));
+    FILE *data = open_memstream(&blobs, &blobs_length);
+    int failed = offsets == NULL || data == NULL;
+    for (size_t i = 0; i < st->item_count && !failed; i++) {
+        offsets[i] = (size_t)ftell(data);
+        failed = st->items[i].reason == INCREMENTAL_REUSED
+               ? fwrite(saved[i].data, 1, saved[i].length, data) != saved[i].length
+               : bc_function_save(sema, module, i, data) != 0;
+    }
+    if (!failed) {
+        offsets[st->item_count] = (size_t)ftell(data);
+    }
+    if (data != NULL && fclose(data) != 0) {
+        failed = 1;
+    }
+
+    char *text = NULL;
+    size_t length = 0;
+    FILE *out = failed ? NULL : open_memstream(&text, &length);
+    if (out != NULL) {
+        fputs(PACK_HEADER, out);
+        for (size_t i = 0; i < st->item_count; i++) {
+            const IncItem *item = &st->items[i];
+            const LexToken *name = &st->tokens[item->first + 1];
+            fprintf(out, "%.*s %016llx %016llx %016llx %zu %zu ", (int)name->length, st->source + name->offset,
+                    (unsigned long long)item->fingerprint, (unsigned long long)item->interface,
+                    (unsigned long long)item->key, offsets[i], offsets[i + 1] - offsets[i]);
+            for (size_t d = 0; d < item->dep_count; d++) {
+                const LexToken *dep = &st->tokens[st->deps[item->dep_first + d]];
+                fprintf(out, "%s%.*s", d > 0 ? "," : "", (int)dep->length, st->source + dep->offset);
+            }
+            fputs(item->dep_count == 0 ? "-\n" : "\n", out);
+        }
+        fputc('\n', out);
+        fwrite(blobs, 1, blobs_length, out);
+        if (fclose(out) == 0) {
+            cache_save(cache, key, INCREMENTAL_SUFFIX, text, length);
+        }
+    }
+    free(text);
+    free(blobs);
+    free(offsets);
+}
+
+/* ---- Clasificación ---- */
+
+/**
+ * @brief Calcula la clave del bytecode de cada función y la busca en la entrada anterior.
+ *
+ * Las funciones con la misma clave quedan como INCREMENTAL_REUSED y su
+ * bytecode en @p saved; para las demás el grafo anterior dice si son
+ * nuevas, cambiaron, dependen de una firma que cambió o no tenían bytecode
+ * (la compilación anterior falló o su bytecode no correspondía).
+ */
+static void classify(IncState *st, const char *flags, BcSaved *saved) {
+    uint64_t seed = hash64(flags, strlen(flags), hash64(COMPILADOR_VERSION, strlen(COMPILADOR_VERSION), 0));
+    for (size_t i = 0; i < st->item_count; i++) {
+        IncItem *item = &st->items[i];
+        uint64_t key = hash64(&item->fingerprint, sizeof(item->fingerprint), seed);
+        for (size_t d = 0; d < item->dep_count; d++) {
+            const LexToken *dep = &st->tokens[st->deps[item->dep_first + d]];
+            uint64_t interface = current_interface(st, st->deps[item->dep_first + d]);
+            key = hash64(st->source + dep->offset, dep->length, key);
+            key = hash64(&interface, sizeof(interface), key);
+        }
+        item->key = key;
+        item->dependency = SIZE_MAX;
+
+        const LexToken *name = &st->tokens[item->first + 1];
+        const IncName *old = find_name(st->old, st->old_count, st->source + name->offset, name->length);
+        if (old != NULL && old->key == key) {
+            item->reason = INCREMENTAL_REUSED;
+            saved[i].data = old->data;
+            saved[i].length = old->size;
+        } else if (old == NULL) {
+            item->reason = INCREMENTAL_NEW;
+        } else if (old->fingerprint != item->fingerprint) {
+            item->reason = INCREMENTAL_CHANGED;
+        } else {
+            item->reason = INCREMENTAL_UNCACHED;
+            for (size_t d = 0; d < item->dep_count && item->reason == INCREMENTAL_UNCACHED; d++) {
+                const LexToken *dep = &st->tokens[st->deps[item->dep_first + d]];
+                const IncName *previous = find_name(st->old, st->old_count, st->source + dep->offset,
+                                                    dep->length);
+                if ((previous != NULL ? previous->interface : 0)
+                        != current_interface(st, st->deps[item->dep_first + d])) {
+                    item->reason = INCREMENTAL_DEPENDENT;
+                    item->dependency = st->deps[item->dep_first + d];
+                }
+            }
+        }
+    }
+}
+
+/* ---- Compilación ---- */
+
+/**
+ * @brief Compila el fuente entero, como sin --incremental.
+ *
+ * @return 0 si es exitoso, 1 si hubo errores.
+ */
+static int compile_full(const char *source, unsigned lexer_flags, unsigned codegen_flags, int codegen_threads,
+                        DiagEngine *diag, Arena *arena, SemaProgram *sema, BcModule *module) {
+    AstNode *program = NULL;
+    int failed = parse_source_ast(source, lexer_flags, diag, arena, &program, NULL) != 0
+              || sema_analyze(program, source, diag, sema) != 0
+              || bc_compile_parallel(sema, codegen_flags, codegen_threads, diag, module) != 0;
+    if (program == NULL && diag->count == 0) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+    }
+    return failed;
+}
+
+/**
+ * @brief Compila las funciones: las reutilizadas solo con su firma.
+ *
+ * @param saved Bytecode de las reutilizadas, o NULL para traducirlas todas desde el fuente.
+ * @return 0 si es exitoso, 1 si hubo errores, -1 si un bytecode guardado no
+ *         corresponde (hay que volver a compilar sin @p saved).
+ */
+static int compile_items(const IncState *st, const BcSaved *saved, unsigned codegen_flags, int codegen_threads,
+                         DiagEngine *diag, Arena *arena, SemaProgram *sema, BcModule *module) {
+    size_t count = 1;
+    for (size_t i = 0; i < st->item_count; i++) {
+        const IncItem *item = &st->items[i];
+        count += saved != NULL && saved[i].data != NULL ? item->body - item->first + 2
+                                                        : item->last - item->first + 1;
+    }
+    LexToken *tokens = (LexToken *)malloc(count * sizeof(LexToken));
+    if (tokens == NULL) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+        return 1;
+    }
+    size_t n = 0;
+    for (size_t i = 0; i < st->item_count; i++) {
+        const IncItem *item = &st->items[i];
+        if (saved != NULL && saved[i].data != NULL) {
+            memcpy(tokens + n, st->tokens + item->first, (item->body - item->first + 1) * sizeof(LexToken));
+            n += item->body - item->first + 1;
+            tokens[n++] = st->tokens[item->last];
+        } else {
+            memcpy(tokens + n, st->tokens + item->first, (item->last - item->first + 1) * sizeof(LexToken));
+            n += item->last - item->first + 1;
+        }
+    }
+    tokens[n] = st->tokens[st->items[st->item_count - 1].last + 1];
+
+    AstNode *program = NULL;
+    int status = parse_tokens_ast(st->source, tokens, diag, arena, &program) != 0
+              || sema_analyze(program, st->source, diag, sema) != 0;
+    free(tokens);
+    if (status == 0) {
+        status = bc_compile_reusing(sema, codegen_flags, saved, codegen_threads, diag, module);
+    }
+    if (program == NULL && diag->count == 0) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+    }
+    return status;
+}
+
+/**
+ * @brief Llena el reporte con las funciones recompiladas.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int fill_report(const IncState *st, IncrementalReport *report) {
+    report->items = st->item_count;
+    report->rebuilt = (IncrementalRebuild *)calloc(st->item_count > 0 ? st->item_count : 1,
+                                                   sizeof(IncrementalRebuild));
+    if (report->rebuilt == NULL) {
+        return 1;
+    }
+    for (size_t i = 0; i < st->item_count; i++) {
+        const IncItem *item = &st->items[i];
+        report->counts[item->reason]++;
+        if (item->reason == INCREMENTAL_REUSED) {
+            continue;
+        }
+        const LexToken *name = &st->tokens[item->first + 1];
+        IncrementalRebuild *rebuild = &report->rebuilt[report->rebuilt_count++];
+        rebuild->name = st->source + name->offset;
+        rebuild->name_length = name->length;
+        rebuild->line = st->tokens[item->first].line;
+        rebuild->column = st->tokens[item->first].column;
+        rebuild->reason = item->reason;
+        if (item->dependency != SIZE_MAX) {
+            rebuild->dependency = st->source + st->tokens[item->dependency].offset;
+            rebuild->dependency_length = st->tokens[item->dependency].length;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Compila un fuente reutilizando de la caché el bytecode de las
+ *        funciones que no cambiaron.
+ *
+ * El resultado es el mismo que con parse_source_ast(), sema_analyze() y
+ * bc_compile(): el mismo módulo y, si hay errores, los mismos diagnósticos.
+ *
+ * @param filename Nombre del fuente; identifica su entrada en la caché.
+ * @param source El código fuente terminado en '\0' (debe vivir tanto como @p module).
+ * @param cache La caché.
+ * @param lexer_flags Opciones del lexer (LEXER_*).
+ * @param codegen_flags Opciones de bc_compile() (BC_*).
+ * @param codegen_threads Hilos de la traducción (ver bc_compile_parallel()).
+ * @param diag Destino de los diagnósticos.
+ * @param arena Arena del AST.
+ * @param sema Destino del análisis (liberar con sema_free() aunque falle).
+ * @param module Destino del bytecode (liberar con bc_free() aunque falle).
+ * @param report Funciones recompiladas (liberar con incremental_report_free()).
+ * @return 0 si es exitoso, 1 si hubo errores.
+ */
+int incremental_compile(const char *filename, const char *source, Cache *cache, unsigned lexer_flags,
+                        unsigned codegen_flags, int codegen_threads, DiagEngine *diag, Arena *arena,
+                        SemaProgram *sema, BcModule *module, IncrementalReport *report) {
+    memset(report, 0, sizeof(*report));
+    IncState st;
+    memset(&st, 0, sizeof(st));
+    st.source = source;
+
+    DiagEngine lexical;
+    if (diag_init(&lexical, 0) != 0) {
+        report->full = 1;
+        return compile_full(source, lexer_flags, codegen_flags, codegen_threads, diag, arena, sema, module);
+    }
+    size_t count = 0;
+    LexToken *tokens = parse_lex_tokens(source, lexer_flags, &lexical, &count);
+    st.tokens = tokens;
+    if (tokens == NULL || lexical.errors + lexical.warnings > 0 || split_items(&st, count) != 0
+            || st.item_count == 0 || build_names(&st) != 0) {
+        diag_free(&lexical);
+        free(tokens);
+        free(st.items);
+        free(st.deps);
+        free(st.names);
+        report->full = 1;
+        return compile_full(source, lexer_flags, codegen_flags, codegen_threads, diag, arena, sema, module);
+    }
+
+    char flags[64];
+    snprintf(flags, sizeof(flags), "fn|%x|%x", codegen_flags, lexer_flags & LEXER_UTF8_COLUMNS);
+    uint64_t key = cache_key(filename, strlen(filename), NULL, flags);
+    char *pack = NULL;
+    size_t pack_length = 0;
+    if (cache_load(cache, key, INCREMENTAL_SUFFIX, &pack, &pack_length) == 0) {
+        parse_pack(&st, pack, pack_length);
+    }
+
+    BcSaved *saved = (BcSaved *)calloc(st.item_count, sizeof(BcSaved));
+    int status = 1;
+    if (saved == NULL) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+    } else {
+        classify(&st, flags, saved);
+        status = -1;
+        int reused = 0;
+        for (size_t i = 0; i < st.item_count; i++) {
+            reused |= saved[i].data != NULL;
+        }
+        if (reused) {
+            /* Con errores se repite sin reutilizar para dar los mismos diagnósticos */
+            DiagEngine scratch;
+            if (diag_init(&scratch, 0) == 0) {
+                status = compile_items(&st, saved, codegen_flags, codegen_threads, &scratch, arena, sema, module);
+                diag_free(&scratch);
+            }
+            if (status != 0) {
+                for (size_t i = 0; i < st.item_count; i++) {
+                    if (st.items[i].reason == INCREMENTAL_REUSED) {
+                        st.items[i].reason = INCREMENTAL_UNCACHED;
+                    }
+                }
+                bc_free(module);
+                sema_free(sema);
+                memset(module, 0, sizeof(*module));
+                memset(sema, 0, sizeof(*sema));
+            }
+        }
+        if (status != 0) {
+            status = compile_items(&st, NULL, codegen_flags, codegen_threads, diag, arena, sema, module);
+        }
+        if (status == 0) {
+            save_pack(&st, cache, key, saved, sema, module);
+            if (fill_report(&st, report) != 0) {
+                SourceSpan span = { 1, 1, 0 };
+                diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+                status = 1;
+            }
+        }
+    }
+    free(saved);
+    free(pack);
+    free(st.old);
+    free(st.names);
+    free(st.deps);
+    free(st.items);
+    free(tokens);
+    diag_free(&lexical);
+    return status;
+}
+
+/**
+ * @brief Escribe el reporte de --incremental-report: una línea por función
+ *        recompilada con su motivo y un resumen.
+ */
+void incremental_report_print(const IncrementalReport *report, const char *filename, FILE *out) {
+    if (report->full) {
+        fprintf(out, "Compilación incremental: el fuente no se pudo partir en funciones; se compiló entero\n");
+        return;
+    }
+    for (size_t i = 0; i < report->rebuilt_count; i++) {
+        const IncrementalRebuild *rebuild = &report->rebuilt[i];
+        fprintf(out, "%s:%u:%u: se recompiló '%.*s' (", filename, rebuild->line, rebuild->column,
+                (int)rebuild->name_length, rebuild->name);
+        switch (rebuild->reason) {
+            case INCREMENTAL_NEW: fprintf(out, "nueva"); break;
+            case INCREMENTAL_CHANGED: fprintf(out, "cambió"); break;
+            case INCREMENTAL_DEPENDENT:
+                fprintf(out, "cambió la firma de '%.*s'", (int)rebuild->dependency_length, rebuild->dependency);
+                break;
+            default: fprintf(out, "sin entrada en la caché"); break;
+        }
+        fprintf(out, ")\n");
+    }
+    fprintf(out, "Compilación incremental: %zu de %zu funciones recompiladas (%zu nuevas, %zu cambiadas, "
+                 "%zu dependientes, %zu sin caché), %zu reutilizadas\n",
+            report->rebuilt_count, report->items, report->counts[INCREMENTAL_NEW],
+            report->counts[INCREMENTAL_CHANGED], report->counts[INCREMENTAL_DEPENDENT],
+            report->counts[INCREMENTAL_UNCACHED], report->counts[INCREMENTAL_REUSED]);
+}
+
+/**
+ * @brief Libera un reporte de incremental_compile().
+ */
+void incremental_report_free(IncrementalReport *report) {
+    free(report->rebuilt);
+    memset(report, 0, sizeof(*report));
+}
@@ -0,0 +1,360 @@
+/**
+ * @file profile.c
+ * @brief Implementación del perfil estadístico de fuentes.
+ */
+#include "../../include/profile.h"
+#include "../../include/hash.h"
+#include "../../include/stats.h"
+#include <stdlib.h>
+#include <string.h>
+
+/** Nombres de las clases de literal numérico. */
+static const char *const NUMBER_KIND_NAMES[PROFILE_NUMBER_KINDS] = {
+    [PROFILE_NUMBER_INTEGER]  = "integer",
+    [PROFILE_NUMBER_REAL]     = "real",
+    [PROFILE_NUMBER_EXPONENT] = "exponent",
+    [PROFILE_NUMBER_HEX]      = "hex",
+    [PROFILE_NUMBER_BINARY]   = "binary",
+};
+
+/**
+ * @brief Prepara un perfil vacío.
+ *
+ * @param profile El perfil.
+ * @param top Identificadores frecuentes a conservar (1..PROFILE_MAX_TOP).
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int profile_init(SourceProfile *profile, size_t top) {
+    memset(profile, 0, sizeof(*profile));
+    if (top == 0 || top > PROFILE_MAX_TOP) {
+        top = PROFILE_DEFAULT_TOP;
+    }
+    profile->sketch = (uint32_t *)calloc((size_t)PROFILE_SKETCH_DEPTH * PROFILE_SKETCH_WIDTH,
+                                         sizeof(uint32_t));
+    profile->top = (ProfileName *)calloc(top, sizeof(ProfileName));
+    if (profile->sketch == NULL || profile->top == NULL) {
+        profile_free(profile);
+        return 1;
+    }
+    profile->top_capacity = top;
+    return 0;
+}
+
+/**
+ * @brief Libera la memoria del perfil.
+ */
+void profile_free(SourceProfile *profile) {
+    free(profile->sketch);
+    free(profile->top);
+    profile->sketch = NULL;
+    profile->top = NULL;
+    profile->top_capacity = 0;
+    profile->top_count = 0;
+}
+
+/**
+ * @brief Suma una aparición al sketch y devuelve la frecuencia estimada.
+ *
+ * Usa actualización conservadora: solo crecen los contadores iguales al
+ * mínimo, lo que reduce la sobreestimación y hace que la estimación de cada
+ * clave aumente exactamente en 1 por aparición.
+ */
+static uint32_t sketch_add(uint32_t *sketch, uint64_t hash) {
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1u;
+    uint32_t *cells[PROFILE_SKETCH_DEPTH];
+    uint32_t min = UINT32_MAX;
+    for (uint32_t d = 0; d < PROFILE_SKETCH_DEPTH; d++) {
+        uint32_t column = (h1 + d * h2) & (PROFILE_SKETCH_WIDTH - 1);
+        cells[d] = &sketch[(size_t)d * PROFILE_SKETCH_WIDTH + column];
+        if (*cells[d] < min) {
+            min = *cells[d];
+        }
+    }
+    if (min == UINT32_MAX) {
+        return min;
+    }
+    for (uint32_t d = 0; d < PROFILE_SKETCH_DEPTH; d++) {
+        if (*cells[d] == min) {
+            (*cells[d])++;
+        }
+    }
+    return min + 1;
+}
+
+/**
+ * @brief Recalcula la menor frecuencia de la lista de candidatos llena.
+ */
+static void update_top_min(SourceProfile *profile) {
+    if (profile->top_count < profile->top_capacity) {
+        profile->top_min = 0;
+        return;
+    }
+    uint32_t min = UINT32_MAX;
+    for (size_t i = 0; i < profile->top_count; i++) {
+        if (profile->top[i].count < min) {
+            min = profile->top[i].count;
+        }
+    }
+    profile->top_min = min;
+}
+
+/**
+ * @brief Registra un identificador en el sketch y en la lista de candidatos.
+ */
+static void add_identifier(SourceProfile *profile, const char *text, size_t length) {
+    uint64_t hash = hash64(text, length, 0);
+    uint32_t count = sketch_add(profile->sketch, hash);
+
+    // Con la lista llena, un candidato ya presente tiene una estimación
+    // anterior >= top_min, así que ahora valdría más: si no, no está.
+    if (profile->top_count == profile->top_capacity && count <= profile->top_min) {
+        return;
+    }
+    ProfileName *slot = NULL;
+    for (size_t i = 0; i < profile->top_count; i++) {
+        if (profile->top[i].hash == hash && profile->top[i].length == length) {
+            profile->top[i].count = count;
+            if (profile->top_count == profile->top_capacity && count - 1 == profile->top_min) {
+                update_top_min(profile);
+            }
+            return;
+        }
+    }
+    if (profile->top_count < profile->top_capacity) {
+        slot = &profile->top[profile->top_count++];
+    } else {
+        for (size_t i = 0; i < profile->top_count; i++) {
+            if (profile->top[i].count == profile->top_min) {
+                slot = &profile->top[i];
+                break;
+            }
+        }
+    }
+    size_t kept = length < PROFILE_NAME_MAX ? length : PROFILE_NAME_MAX - 1;
+    // No cortar una secuencia UTF-8 por la mitad.
+    while (kept < length && kept > 0 && ((unsigned char)text[kept] & 0xC0) == 0x80) {
+        kept--;
+    }
+    slot->hash = hash;
+    slot->count = count;
+    slot->length = (uint32_t)length;
+    memcpy(slot->text, text, kept);
+    slot->text[kept] = '\0';
+    update_top_min(profile);
+}
+
+/**
+ * @brief Clasifica un literal numérico según la rama de lex_number() que lo reconoció.
+ */
+static ProfileNumberKind number_kind(const char *text, size_t length) {
+    if (length > 1 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        return PROFILE_NUMBER_HEX;
+    }
+    if (length > 1 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+        return PROFILE_NUMBER_BINARY;
+    }
+    ProfileNumberKind kind = PROFILE_NUMBER_INTEGER;
+    for (size_t i = 0; i < length; i++) {
+        if (text[i] == 'e' || text[i] == 'E') {
+            return PROFILE_NUMBER_EXPONENT;
+        }
+        if (text[i] == '.') {
+            kind = PROFILE_NUMBER_REAL;
+        }
+    }
+    return kind;
+}
+
+/**
+ * @brief Acumula en el perfil los tokens de un fuente, en una sola pasada.
+ *
+ * Los bytes de comentario los cuenta el propio lexer a través de las
+ * estadísticas por fase (ver stats.h); si --stats está activo, también se
+ * suman allí.
+ *
+ * @param profile El perfil.
+ * @param source Fuente terminado en '\0'.
+ * @param length Longitud de @p source.
+ * @param lexer_flags Opciones del lexer (LEXER_*).
+ */
+void profile_add_source(SourceProfile *profile, const char *source, size_t length,
+                        unsigned lexer_flags) {
+    CompilerStats stats;
+    memset(&stats, 0, sizeof(stats));
+    CompilerStats *previous = stats_begin(&stats);
+
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    lexer_set_flags(&lexer, lexer_flags);
+    LexToken token;
+    size_t last_line = 0;
+    while (lexer_next_compact(&lexer, &token) && token.type != TOKEN_EOF) {
+        const char *text = source + token.offset;
+        profile->tokens[token.type]++;
+        if (token.line != last_line) {
+            profile->code_lines++;
+            last_line = token.line;
+        }
+        if (token.type == TOKEN_IDENTIFIER) {
+            size_t bucket = token.length < PROFILE_LENGTH_BUCKETS ? token.length : PROFILE_LENGTH_BUCKETS;
+            profile->identifier_lengths[bucket]++;
+            profile->identifier_bytes += token.length;
+            if (token.length > profile->identifier_max) {
+                profile->identifier_max = token.length;
+            }
+            add_identifier(profile, text, token.length);
+        } else if (token.type == TOKEN_NUMBER) {
+            profile->numbers[number_kind(text, token.length)]++;
+        }
+    }
+    // Tras un '\n' final, EOF queda en la columna 1 de una línea vacía.
+    if (length > 0) {
+        profile->lines += token.column == 1 ? token.line - 1 : token.line;
+    }
+
+    stats_begin(previous);
+    if (previous != NULL) {
+        stats_merge(previous, &stats);
+    }
+    profile->files++;
+    profile->bytes += length;
+    profile->comment_bytes += stats.comment_bytes;
+}
+
+/**
+ * @brief Ordena candidatos por frecuencia descendente y luego por texto.
+ */
+static int compare_names(const void *a, const void *b) {
+    const ProfileName *x = (const ProfileName *)a;
+    const ProfileName *y = (const ProfileName *)b;
+    if (x->count != y->count) {
+        return x->count > y->count ? -1 : 1;
+    }
+    int order = strcmp(x->text, y->text);
+    if (order != 0) {
+        return order;
+    }
+    return x->length < y->length ? -1 : x->length > y->length;
+}
+
+/**
+ * @brief Copia ordenada de los candidatos; NULL si no hay o falta memoria.
+ */
+static ProfileName *sorted_top(const SourceProfile *profile) {
+    if (profile->top_count == 0) {
+        return NULL;
+    }
+    ProfileName *names = (ProfileName *)malloc(profile->top_count * sizeof(ProfileName));
+    if (names != NULL) {
+        memcpy(names, profile->top, profile->top_count * sizeof(ProfileName));
+        qsort(names, profile->top_count, sizeof(ProfileName), compare_names);
+    }
+    return names;
+}
+
+/**
+ * @brief Cota del error aditivo del sketch: e/ancho por el total de identificadores.
+ */
+static double sketch_error_bound(const SourceProfile *profile) {
+    return 2.718281828 / PROFILE_SKETCH_WIDTH * (double)profile->tokens[TOKEN_IDENTIFIER];
+}
+
+/** Cociente que vale 0 si el divisor es 0. */
+static double ratio(double num, size_t den) {
+    return den > 0 ? num / (double)den : 0.0;
+}
+
+/**
+ * @brief Imprime el perfil en texto (--profile-source).
+ *
+ * @param profile El perfil.
+ * @param out Flujo de salida.
+ */
+void profile_print(const SourceProfile *profile, FILE *out) {
+    size_t tokens = 0;
+    for (int t = 0; t < TOKEN_EOF; t++) {
+        tokens += profile->tokens[t];
+    }
+    size_t identifiers = profile->tokens[TOKEN_IDENTIFIER];
+
+    fprintf(out, "=== PERFIL DEL FUENTE ===\n");
+    fprintf(out, "Archivos:          %zu\n", profile->files);
+    fprintf(out, "Bytes:             %zu\n", profile->bytes);
+    fprintf(out, "Comentarios:       %zu bytes (%.1f%%)\n", profile->comment_bytes,
+            100.0 * ratio((double)profile->comment_bytes, profile->bytes));
+    fprintf(out, "Líneas:            %zu (%zu con código)\n", profile->lines, profile->code_lines);
+    fprintf(out, "Tokens:            %zu (%.2f por línea, %.2f por línea con código)\n", tokens,
+            ratio((double)tokens, profile->lines), ratio((double)tokens, profile->code_lines));
+    for (int t = 0; t < TOKEN_EOF; t++) {
+        if (profile->tokens[t] > 0) {
+            fprintf(out, "  %-16s %10zu %6.1f%%\n", token_type_name((TokenType)t),
+                    profile->tokens[t], 100.0 * ratio((double)profile->tokens[t], tokens));
+        }
+    }
+
+    fprintf(out, "Literales numéricos:\n");
+    for (int k = 0; k < PROFILE_NUMBER_KINDS; k++) {
+        fprintf(out, "  %-16s %10zu\n", NUMBER_KIND_NAMES[k], profile->numbers[k]);
+    }
+
+    fprintf(out, "Longitud de identificadores (media %.2f, máxima %zu):\n",
+            ratio((double)profile->identifier_bytes, identifiers), profile->identifier_max);
+    for (size_t n = 1; n <= PROFILE_LENGTH_BUCKETS; n++) {
+        if (profile->identifier_lengths[n] > 0) {
+            fprintf(out, "  %3zu%-13s %10zu %6.1f%%\n", n, n == PROFILE_LENGTH_BUCKETS ? "+" : "",
+                    profile->identifier_lengths[n],
+                    100.0 * ratio((double)profile->identifier_lengths[n], identifiers));
+        }
+    }
+
+    fprintf(out, "Identificadores más frecuentes (estimados; error <= %.1f con prob. 98%%):\n",
+            sketch_error_bound(profile));
+    ProfileName *names = sorted_top(profile);
+    for (size_t i = 0; names != NULL && i < profile->top_count; i++) {
+        fprintf(out, "  %3zu. %-30s%s %10u\n", i + 1, names[i].text,
+                strlen(names[i].text) < names[i].length ? "..." : "", names[i].count);
+    }
+    free(names);
+}
+
+/**
+ * @brief Imprime el perfil en JSON (--profile-source=json).
+ *
+ * @param profile El perfil.
+ * @param out Flujo de salida.
+ */
+void profile_print_json(const SourceProfile *profile, FILE *out) {
+    fprintf(out, "{\n  \"files\": %zu,\n  \"bytes\": %zu,\n  \"comment_bytes\": %zu,\n",
+            profile->files, profile->bytes, profile->comment_bytes);
+    fprintf(out, "  \"lines\": %zu,\n  \"code_lines\": %zu,\n  \"tokens\": {",
+            profile->lines, profile->code_lines);
+    for (int t = 0; t < TOKEN_EOF; t++) {
+        fprintf(out, "%s \"%s\": %zu", t ? "," : "", token_type_name((TokenType)t), profile->tokens[t]);
+    }
+    fprintf(out, " },\n  \"numbers\": {");
+    for (int k = 0; k < PROFILE_NUMBER_KINDS; k++) {
+        fprintf(out, "%s \"%s\": %zu", k ? "," : "", NUMBER_KIND_NAMES[k], profile->numbers[k]);
+    }
+    fprintf(out, " },\n  \"identifier_lengths\": {");
+    int first = 1;
+    for (size_t n = 1; n <= PROFILE_LENGTH_BUCKETS; n++) {
+        if (profile->identifier_lengths[n] > 0) {
+            fprintf(out, "%s \"%zu%s\": %zu", first ? "" : ",", n,
+                    n == PROFILE_LENGTH_BUCKETS ? "+" : "", profile->identifier_lengths[n]);
+            first = 0;
+        }
+    }
+    fprintf(out, " },\n  \"identifier_max_length\": %zu,\n", profile->identifier_max);
+    fprintf(out, "  \"sketch\": { \"depth\": %d, \"width\": %d, \"error_bound\": %.2f },\n",
+            PROFILE_SKETCH_DEPTH, PROFILE_SKETCH_WIDTH, sketch_error_bound(profile));
+    fprintf(out, "  \"top_identifiers\": [");
+    ProfileName *names = sorted_top(profile);
+    for (size_t i = 0; names != NULL && i < profile->top_count; i++) {
+        // Los identificadores no contienen comillas, barras ni controles.
+        fprintf(out, "%s\n    { \"name\": \"%s\", \"length\": %u, \"count\": %u }",
+                i ? "," : "", names[i].text, names[i].length, names[i].count);
+    }
+    free(names);
+    fprintf(out, "\n  ]\n}\n");
+}
@@ -0,0 +1,631 @@
+/**
+ * @file server.c
+ * @brief Implementación del servidor de compilación y del cliente ligero.
+ *
+ * Protocolo (enteros de 32 bits en orden de red):
+ *
+ * - Petición: magia, versión, directorio de trabajo (cadena), argc y argc
+ *   cadenas. Cada cadena se envía como longitud seguida de sus bytes.
+ * - Respuesta: código de salida, salida estándar (cadena) y salida de
+ *   errores (cadena).
+ *
+ * Cada conexión se atiende en un hilo que obtiene su propio directorio de
+ * trabajo con unshare(CLONE_FS), de modo que las rutas relativas del cliente
+ * (incluida la carpeta de archivos de tokens) se resuelven igual que en una
+ * invocación normal sin afectar a las demás peticiones. La petición debe
+ * llegar completa en SERVER_REQUEST_TIMEOUT_MS; al detenerse, el servidor
+ * cierra las conexiones que aún la esperan y solo aguarda a las que ya se
+ * están ejecutando.
+ */
+#define _GNU_SOURCE
+
+#include "../../include/server.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+#define SERVER_MAGIC 0x434D5053u       /* "CMPS" */
+#define SERVER_PROTOCOL_VERSION 1u
+#define SERVER_MAX_ARGS 4096u
+#define SERVER_MAX_STRING (1u << 16)
+#define SERVER_MAX_IDLE_ARENAS 16
+#define SERVER_BACKLOG 64
+#define SERVER_REQUEST_TIMEOUT_MS 10000
+
+/**
+ * @brief Conexión aceptada pendiente de atender.
+ */
+typedef struct Connection {
+    struct ServerState *state;
+    int fd;
+    int waiting;                /**< 1 mientras no ha llegado la petición completa */
+    struct Connection *next;    /**< Conexiones abiertas (ServerState.open) */
+    struct Connection *prev;
+} Connection;
+
+/**
+ * @brief Estado residente del servidor, compartido por todas las peticiones.
+ */
+typedef struct ServerState {
+    Cache cache;                                  /**< Caché residente */
+    int cache_enabled;                            /**< 1 si la caché está abierta */
+    Arena *idle_arenas[SERVER_MAX_IDLE_ARENAS];   /**< Arenas calientes disponibles */
+    size_t idle_count;                            /**< Arenas en idle_arenas */
+    pthread_mutex_t lock;                         /**< Protege arenas, active y open */
+    pthread_cond_t idle;                          /**< Señal de fin de petición */
+    size_t active;                                /**< Peticiones en curso */
+    Connection *open;                             /**< Conexiones sin cerrar */
+    atomic_ulong requests;                        /**< Peticiones atendidas */
+} ServerState;
+
+/** Se activa con SIGINT/SIGTERM para detener el bucle de aceptación. */
+static volatile sig_atomic_t stop_requested = 0;
+
+/**
+ * @brief Manejador de señales de terminación.
+ */
+static void on_stop_signal(int signo) {
+    (void)signo;
+    stop_requested = 1;
+}
+
+/**
+ * @brief Milisegundos de un reloj monótono.
+ */
+static int64_t monotonic_ms(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Lee exactamente @p size bytes de un descriptor.
+ *
+ * @param deadline Instante (monotonic_ms()) en que se deja de esperar, o 0 para esperar siempre.
+ * @return 0 si es exitoso, 1 si la conexión se cerró, se agotó el plazo o hubo error.
+ */
+static int read_full(int fd, void *buffer, size_t size, int64_t deadline) {
+    char *p = (char *)buffer;
+    while (size > 0) {
+        if (deadline > 0) {
+            int64_t left = deadline - monotonic_ms();
+            struct pollfd ready = { fd, POLLIN, 0 };
+            int polled = left > 0 ? poll(&ready, 1, (int)left) : 0;
+            if (polled < 0 && errno == EINTR) {
+                continue;
+            }
+            if (polled <= 0) {
+                return 1;
+            }
+        }
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Escribe exactamente @p size bytes en un descriptor.
+ *
+ * @return 0 si es exitoso, 1 si hubo error.
+ */
+static int write_full(int fd, const void *buffer, size_t size) {
+    const char *p = (const char *)buffer;
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return 1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Envía un entero de 32 bits en orden de red.
+ */
+static int write_u32(int fd, uint32_t value) {
+    uint32_t net = htonl(value);
+    return write_full(fd, &net, sizeof(net));
+}
+
+/**
+ * @brief Recibe un entero de 32 bits en orden de red.
+ */
+static int read_u32(int fd, uint32_t *value, int64_t deadline) {
+    uint32_t net;
+    if (read_full(fd, &net, sizeof(net), deadline) != 0) {
+        return 1;
+    }
+    *value = ntohl(net);
+    return 0;
+}
+
+/**
+ * @brief Envía una cadena como longitud seguida de sus bytes.
+ */
+static int write_string(int fd, const char *data, size_t length) {
+    if (length > UINT32_MAX || write_u32(fd, (uint32_t)length) != 0) {
+        return 1;
+    }
+    return length > 0 ? write_full(fd, data, length) : 0;
+}
+
+/**
+ * @brief Recibe una cadena y la devuelve terminada en '\0'.
+ *
+ * @param limit Longitud máxima aceptada.
+ * @param deadline Como en read_full().
+ * @return La cadena reservada con malloc, o NULL si hay error.
+ */
+static char *read_string(int fd, size_t limit, size_t *length, int64_t deadline) {
+    uint32_t n;
+    if (read_u32(fd, &n, deadline) != 0 || n > limit) {
+        return NULL;
+    }
+    char *s = (char *)malloc((size_t)n + 1);
+    if (s == NULL) {
+        return NULL;
+    }
+    if (n > 0 && read_full(fd, s, n, deadline) != 0) {
+        free(s);
+        return NULL;
+    }
+    s[n] = '\0';
+    if (length != NULL) {
+        *length = n;
+    }
+    return s;
+}
+
+/**
+ * @brief Toma una arena caliente del servidor o crea una nueva.
+ */
+static Arena *borrow_arena(ServerState *state) {
+    pthread_mutex_lock(&state->lock);
+    Arena *arena = state->idle_count > 0 ? state->idle_arenas[--state->idle_count] : NULL;
+    pthread_mutex_unlock(&state->lock);
+    if (arena == NULL) {
+        arena = (Arena *)malloc(sizeof(Arena));
+        if (arena != NULL) {
+            arena_init(arena, 0);
+        }
+    }
+    return arena;
+}
+
+/**
+ * @brief Devuelve una arena al servidor conservando sus bloques.
+ */
+static void return_arena(ServerState *state, Arena *arena) {
+    if (arena == NULL) {
+        return;
+    }
+    arena_reset(arena);
+    pthread_mutex_lock(&state->lock);
+    if (state->idle_count < SERVER_MAX_IDLE_ARENAS) {
+        state->idle_arenas[state->idle_count++] = arena;
+        arena = NULL;
+    }
+    pthread_mutex_unlock(&state->lock);
+    if (arena != NULL) {
+        arena_free(arena);
+        free(arena);
+    }
+}
+
+/**
+ * @brief Ejecuta una petición ya recibida y captura su salida.
+ *
+ * @return El código de salida de la orden.
+ */
+static int execute_request(ServerState *state, int argc, char **argv, FILE *out, FILE *err) {
+    CliOptions options;
+    int parsed = cli_parse(argc, argv, &options, err);
+    if (parsed != 0) {
+        cli_print_usage(argv[0], out);
+        cli_free(&options);
+        return parsed < 0 ? 1 : 0;
+    }
+    if (options.server_socket != NULL) {
+        fprintf(err, "Error: --server no se admite dentro de una petición\n");
+        cli_free(&options);
+        return 1;
+    }
+    if (options.input_count == 0 && !options.cache_stats) {
+        fprintf(err, "Error: Se requiere especificar un archivo\n\n");
+        cli_print_usage(argv[0], out);
+        cli_free(&options);
+        return 1;
+    }
+
+    // La caché residente sustituye a --cache-dir/--cache-size de la petición.
+    Cache *cache = (state->cache_enabled && options.use_cache) ? &state->cache : NULL;
+    int result = 0;
+    if (options.input_count > 0) {
+        Arena *arena = borrow_arena(state);
+        result = cli_run(&options, options.generate_tokens || options.incremental ? cache : NULL, arena,
+                         out, err);
+        return_arena(state, arena);
+    }
+    if (cache != NULL) {
+        cache_flush(cache);
+        if (options.cache_stats) {
+            cache_print_stats(cache, out);
+        }
+    }
+    cli_free(&options);
+    return result;
+}
+
+/**
+ * @brief Atiende una conexión completa: lectura, ejecución y respuesta.
+ */
+static void serve_connection(ServerState *state, Connection *conn) {
+    int fd = conn->fd;
+    int64_t deadline = monotonic_ms() + SERVER_REQUEST_TIMEOUT_MS;
+    uint32_t magic;
+    uint32_t version;
+    uint32_t argc;
+    if (read_u32(fd, &magic, deadline) != 0 || read_u32(fd, &version, deadline) != 0
+            || magic != SERVER_MAGIC || version != SERVER_PROTOCOL_VERSION) {
+        return;
+    }
+    char *cwd = read_string(fd, PATH_MAX, NULL, deadline);
+    if (cwd == NULL || read_u32(fd, &argc, deadline) != 0 || argc == 0 || argc > SERVER_MAX_ARGS) {
+        free(cwd);
+        return;
+    }
+    char **argv = (char **)calloc((size_t)argc + 1, sizeof(char *));
+    int ok = argv != NULL;
+    for (uint32_t i = 0; ok && i < argc; i++) {
+        argv[i] = read_string(fd, SERVER_MAX_STRING, NULL, deadline);
+        ok = argv[i] != NULL;
+    }
+    // Desde aquí la petición se ejecuta aunque el servidor se esté deteniendo.
+    pthread_mutex_lock(&state->lock);
+    conn->waiting = 0;
+    pthread_mutex_unlock(&state->lock);
+
+    char *out_data = NULL;
+    char *err_data = NULL;
+    size_t out_len = 0;
+    size_t err_len = 0;
+    FILE *out = ok ? open_memstream(&out_data, &out_len) : NULL;
+    FILE *err = ok ? open_memstream(&err_data, &err_len) : NULL;
+    int status = 1;
+    if (out != NULL && err != NULL) {
+        if (unshare(CLONE_FS) != 0 || chdir(cwd) != 0) {
+            fprintf(err, "Error: No se pudo usar el directorio '%s'\n", cwd);
+        } else {
+            status = execute_request(state, (int)argc, argv, out, err);
+        }
+    }
+    if (out != NULL) {
+        fclose(out);
+    }
+    if (err != NULL) {
+        fclose(err);
+    }
+
+    if (ok) {
+        write_u32(fd, (uint32_t)status);
+        write_string(fd, out_data, out_len);
+        write_string(fd, err_data, err_len);
+        atomic_fetch_add(&state->requests, 1);
+    }
+
+    free(out_data);
+    free(err_data);
+    for (uint32_t i = 0; argv != NULL && i < argc; i++) {
+        free(argv[i]);
+    }
+    free(argv);
+    free(cwd);
+}
+
+/**
+ * @brief Hilo de una conexión.
+ */
+static void *connection_main(void *arg) {
+    Connection *conn = (Connection *)arg;
+    ServerState *state = conn->state;
+    serve_connection(state, conn);
+
+    pthread_mutex_lock(&state->lock);
+    if (conn->prev != NULL) {
+        conn->prev->next = conn->next;
+    } else {
+        state->open = conn->next;
+    }
+    if (conn->next != NULL) {
+        conn->next->prev = conn->prev;
+    }
+    state->active--;
+    pthread_cond_broadcast(&state->idle);
+    pthread_mutex_unlock(&state->lock);
+    close(conn->fd);
+    free(conn);
+    return NULL;
+}
+
+/**
+ * @brief Rellena la dirección de un socket Unix.
+ *
+ * @return 0 si es exitoso, 1 si la ruta es demasiado larga.
+ */
+static int make_address(const char *path, struct sockaddr_un *addr) {
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr->sun_path)) {
+        return 1;
+    }
+    strcpy(addr->sun_path, path);
+    return 0;
+}
+
+/**
+ * @brief Crea el socket de escucha, eliminando un socket huérfano si lo hay.
+ *
+ * Solo se reemplaza un socket en el que nadie responde; cualquier otro
+ * archivo en la ruta se conserva y el servidor no arranca.
+ *
+ * @return El descriptor, o -1 si hay error.
+ */
+static int open_listener(const char *path) {
+    struct sockaddr_un addr;
+    if (make_address(path, &addr) != 0) {
+        fprintf(stderr, "Error: Ruta de socket demasiado larga '%s'\n", path);
+        return -1;
+    }
+
+    struct stat info;
+    if (lstat(path, &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            fprintf(stderr, "Error: '%s' ya existe y no es un socket\n", path);
+            return -1;
+        }
+        // Si alguien responde en la ruta, ya hay un servidor activo.
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probe >= 0) {
+            if (connect(probe, (struct sockaddr *)&addr, sizeof(addr)) == 0) {
+                close(probe);
+                fprintf(stderr, "Error: Ya hay un servidor escuchando en '%s'\n", path);
+                return -1;
+            }
+            close(probe);
+        }
+        unlink(path);
+    }
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0
+            || listen(fd, SERVER_BACKLOG) != 0) {
+        fprintf(stderr, "Error: No se pudo escuchar en '%s'\n", path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * @brief Ejecuta el servidor hasta recibir SIGINT o SIGTERM.
+ *
+ * @param options Opciones del servidor (socket y configuración de la caché).
+ * @return 0 si es exitoso, 1 si no se pudo iniciar.
+ */
+int server_run(const CliOptions *options) {
+    static ServerState state;
+    memset(&state, 0, sizeof(state));
+    pthread_mutex_init(&state.lock, NULL);
+    pthread_cond_init(&state.idle, NULL);
+    atomic_init(&state.requests, 0);
+
+    if (options->use_cache) {
+        if (cache_open(&state.cache, options->cache_dir, options->cache_max_bytes) == 0) {
+            // Ruta absoluta: cada petición trabaja en el directorio de su cliente.
+            char absolute[PATH_MAX];
+            if (realpath(state.cache.dir, absolute) != NULL
+                    && strlen(absolute) < sizeof(state.cache.dir)) {
+                strcpy(state.cache.dir, absolute);
+            }
+            state.cache_enabled = 1;
+        } else {
+            fprintf(stderr, "Aviso: No se pudo abrir la caché; se continúa sin ella\n");
+        }
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_handler = on_stop_signal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);
+
+    int listener = open_listener(options->server_socket);
+    if (listener < 0) {
+        if (state.cache_enabled) {
+            cache_close(&state.cache);
+        }
+        return 1;
+    }
+    printf("Servidor escuchando en %s (pid %ld)\n", options->server_socket, (long)getpid());
+    fflush(stdout);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    // Los hilos de las conexiones (y los que creen) nacen con las señales de
+    // parada bloqueadas, para que lleguen a este hilo e interrumpan accept().
+    sigset_t stop_signals;
+    sigset_t previous;
+    sigemptyset(&stop_signals);
+    sigaddset(&stop_signals, SIGINT);
+    sigaddset(&stop_signals, SIGTERM);
+    while (!stop_requested) {
+        int fd = accept(listener, NULL, NULL);
+        if (fd < 0) {
+            continue;
+        }
+        Connection *conn = (Connection *)malloc(sizeof(Connection));
+        if (conn == NULL) {
+            close(fd);
+            continue;
+        }
+        conn->state = &state;
+        conn->fd = fd;
+        conn->waiting = 1;
+        conn->prev = NULL;
+        pthread_mutex_lock(&state.lock);
+        conn->next = state.open;
+        if (state.open != NULL) {
+            state.open->prev = conn;
+        }
+        state.open = conn;
+        state.active++;
+        pthread_mutex_unlock(&state.lock);
+        pthread_t thread;
+        pthread_sigmask(SIG_BLOCK, &stop_signals, &previous);
+        int created = pthread_create(&thread, &attr, connection_main, conn) == 0;
+        pthread_sigmask(SIG_SETMASK, &previous, NULL);
+        if (!created) {
+            // Sin hilo disponible se atiende en el hilo de aceptación.
+            connection_main(conn);
+        }
+    }
+    pthread_attr_destroy(&attr);
+
+    close(listener);
+    unlink(options->server_socket);
+    pthread_mutex_lock(&state.lock);
+    // Un cliente que aún no envió su petición no retrasa la parada.
+    for (Connection *conn = state.open; conn != NULL; conn = conn->next) {
+        if (conn->waiting) {
+            shutdown(conn->fd, SHUT_RDWR);
+        }
+    }
+    while (state.active > 0) {
+        pthread_cond_wait(&state.idle, &state.lock);
+    }
+    pthread_mutex_unlock(&state.lock);
+
+    for (size_t i = 0; i < state.idle_count; i++) {
+        arena_free(state.idle_arenas[i]);
+        free(state.idle_arenas[i]);
+    }
+    if (state.cache_enabled) {
+        cache_close(&state.cache);
+    }
+    printf("Servidor detenido: %lu peticiones atendidas\n", atomic_load(&state.requests));
+    return 0;
+}
+
+/**
+ * @brief Reenvía una orden al servidor y reproduce su resultado.
+ *
+ * Si el primer argumento es `--latency`, se informa en stderr el tiempo total
+ * de la petición (conexión, ejecución y respuesta).
+ *
+ * @param socket_path Ruta del socket del servidor.
+ * @param argc Número de argumentos a reenviar (argv[0] incluido).
+ * @param argv Argumentos a reenviar; argv[0] es el nombre del programa.
+ * @return El código de salida devuelto por el servidor, o 1 si hay error.
+ */
+int client_run(const char *socket_path, int argc, char *argv[]) {
+    int report_latency = 0;
+    if (argc > 1 && strcmp(argv[1], "--latency") == 0) {
+        report_latency = 1;
+        argv[1] = argv[0];
+        argv++;
+        argc--;
+    }
+
+    struct timespec start;
+    struct timespec end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct sockaddr_un addr;
+    if (make_address(socket_path, &addr) != 0) {
+        fprintf(stderr, "Error: Ruta de socket demasiado larga '%s'\n", socket_path);
+        return 1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        fprintf(stderr, "Error: No se pudo conectar con el servidor en '%s'\n", socket_path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return 1;
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        fprintf(stderr, "Error: No se pudo obtener el directorio de trabajo\n");
+        close(fd);
+        return 1;
+    }
+
+    int failed = write_u32(fd, SERVER_MAGIC) || write_u32(fd, SERVER_PROTOCOL_VERSION)
+              || write_string(fd, cwd, strlen(cwd)) || write_u32(fd, (uint32_t)argc);
+    for (int i = 0; !failed && i < argc; i++) {
+        failed = write_string(fd, argv[i], strlen(argv[i]));
+    }
+
+    uint32_t status = 1;
+    size_t out_len = 0;
+    size_t err_len = 0;
+    char *out_data = NULL;
+    char *err_data = NULL;
+    if (!failed && read_u32(fd, &status, 0) == 0) {
+        out_data = read_string(fd, UINT32_MAX, &out_len, 0);
+        err_data = out_data ? read_string(fd, UINT32_MAX, &err_len, 0) : NULL;
+    }
+    close(fd);
+    if (err_data == NULL) {
+        fprintf(stderr, "Error: Respuesta incompleta del servidor\n");
+        free(out_data);
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    fwrite(out_data, 1, out_len, stdout);
+    fwrite(err_data, 1, err_len, stderr);
+    free(out_data);
+    free(err_data);
+
+    if (report_latency) {
+        fflush(stdout);
+        double ms = (double)(end.tv_sec - start.tv_sec) * 1e3
+                  + (double)(end.tv_nsec - start.tv_nsec) / 1e6;
+        fprintf(stderr, "Latencia: %.3f ms\n", ms);
+    }
+    return (int)status;
+}
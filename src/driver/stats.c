@@ -0,0 +1,173 @@
+/**
+ * @file stats.c
+ * @brief Implementación de la instrumentación por fases.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/stats.h"
+#include <time.h>
+
+/** Estadísticas del hilo actual, o NULL si no se están midiendo. */
+_Thread_local CompilerStats *stats_current = NULL;
+
+/** Nombres de las fases en el informe. */
+static const char *const PHASE_NAMES[STATS_PHASE_COUNT] = {
+    [STATS_READ]     = "read",
+    [STATS_LEX]      = "lex",
+    [STATS_WRITE]    = "write",
+    [STATS_PARSE]    = "parse",
+    [STATS_SEMANTIC] = "semantic",
+    [STATS_CODEGEN]  = "codegen",
+};
+
+/**
+ * @brief Devuelve el reloj monótono en nanosegundos.
+ */
+uint64_t stats_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/**
+ * @brief Activa la medición en el hilo actual.
+ *
+ * @param stats Destino de los contadores, o NULL para desactivarla.
+ * @return Las estadísticas activas anteriormente (para restaurarlas).
+ */
+CompilerStats *stats_begin(CompilerStats *stats) {
+    CompilerStats *previous = stats_current;
+    stats_current = stats;
+    return previous;
+}
+
+/**
+ * @brief Acumula los contadores de @p from en @p into.
+ *
+ * El pico de arena se combina con el máximo; lo demás se suma.
+ */
+void stats_merge(CompilerStats *into, const CompilerStats *from) {
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        into->phase_ns[p] += from->phase_ns[p];
+        into->phase_calls[p] += from->phase_calls[p];
+    }
+    for (int t = 0; t < STATS_TOKEN_TYPES; t++) {
+        into->tokens[t] += from->tokens[t];
+    }
+    for (int c = 0; c < STATS_CHAR_CLASSES; c++) {
+        into->char_classes[c] += from->char_classes[c];
+    }
+    into->files += from->files;
+    into->bytes_read += from->bytes_read;
+    into->skipped_bytes += from->skipped_bytes;
+    into->comment_bytes += from->comment_bytes;
+    into->malloc_count += from->malloc_count;
+    into->malloc_bytes += from->malloc_bytes;
+    if (from->arena_peak > into->arena_peak) {
+        into->arena_peak = from->arena_peak;
+    }
+}
+
+/**
+ * @brief Devuelve el total de tokens contados.
+ */
+static size_t total_tokens(const CompilerStats *stats) {
+    size_t total = 0;
+    for (int t = 0; t < STATS_TOKEN_TYPES; t++) {
+        total += stats->tokens[t];
+    }
+    return total;
+}
+
+/**
+ * @brief Imprime el informe legible de --stats.
+ *
+ * Solo se listan las fases que se ejecutaron y los tipos de token presentes.
+ * Con varios hilos, el tiempo de las fases es la suma de todos ellos y puede
+ * superar al tiempo total.
+ *
+ * @param stats Estadísticas combinadas.
+ * @param wall_ms Tiempo total de la ejecución en milisegundos.
+ * @param out Flujo de salida.
+ */
+void stats_print(const CompilerStats *stats, double wall_ms, FILE *out) {
+    fprintf(out, "=== ESTADÍSTICAS ===\n");
+    fprintf(out, "%-10s %12s %8s %8s\n", "Fase", "Tiempo (ms)", "%", "Veces");
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        if (stats->phase_calls[p] == 0) {
+            continue;
+        }
+        double ms = (double)stats->phase_ns[p] / 1e6;
+        fprintf(out, "%-10s %12.3f %7.1f%% %8zu\n", PHASE_NAMES[p], ms,
+                wall_ms > 0.0 ? 100.0 * ms / wall_ms : 0.0, stats->phase_calls[p]);
+    }
+    fprintf(out, "%-10s %12.3f\n\n", "total", wall_ms);
+
+    size_t tokens = total_tokens(stats);
+    fprintf(out, "Archivos:          %zu\n", stats->files);
+    fprintf(out, "Bytes leídos:      %zu\n", stats->bytes_read);
+    fprintf(out, "Bytes omitidos:    %zu (espacios %zu, comentarios %zu)\n", stats->skipped_bytes,
+            stats->skipped_bytes - stats->comment_bytes, stats->comment_bytes);
+    fprintf(out, "Reservas malloc:   %zu (%zu bytes)\n", stats->malloc_count, stats->malloc_bytes);
+    fprintf(out, "Pico de arena:     %zu bytes\n", stats->arena_peak);
+    fprintf(out, "Tokens:            %zu\n", tokens);
+    for (int t = 0; t < STATS_TOKEN_TYPES; t++) {
+        if (stats->tokens[t] > 0) {
+            fprintf(out, "  %-16s %10zu %6.1f%%\n", token_type_name((TokenType)t),
+                    stats->tokens[t], 100.0 * (double)stats->tokens[t] / (double)tokens);
+        }
+    }
+#ifdef LEXER_DEBUG
+    fprintf(out, "Caracteres por clase:\n");
+    for (int c = 0; c < STATS_CHAR_CLASSES; c++) {
+        if (stats->char_classes[c] > 0) {
+            fprintf(out, "  %-16s %10zu\n", lexer_char_class_name(c), stats->char_classes[c]);
+        }
+    }
+#endif
+}
+
+/**
+ * @brief Imprime las estadísticas en JSON (--stats=json).
+ *
+ * @param stats Estadísticas combinadas.
+ * @param wall_ms Tiempo total de la ejecución en milisegundos.
+ * @param out Flujo de salida.
+ */
+void stats_print_json(const CompilerStats *stats, double wall_ms, FILE *out) {
+    fprintf(out, "{\n  \"wall_ms\": %.4f,\n  \"phases\": {", wall_ms);
+    for (int p = 0; p < STATS_PHASE_COUNT; p++) {
+        fprintf(out, "%s\n    \"%s\": { \"ms\": %.4f, \"calls\": %zu }", p ? "," : "",
+                PHASE_NAMES[p], (double)stats->phase_ns[p] / 1e6, stats->phase_calls[p]);
+    }
+    fprintf(out, "\n  },\n");
+    fprintf(out, "  \"files\": %zu,\n  \"bytes_read\": %zu,\n", stats->files, stats->bytes_read);
+    fprintf(out, "  \"whitespace_bytes\": %zu,\n  \"comment_bytes\": %zu,\n",
+            stats->skipped_bytes - stats->comment_bytes, stats->comment_bytes);
+    fprintf(out, "  \"malloc_count\": %zu,\n  \"malloc_bytes\": %zu,\n",
+            stats->malloc_count, stats->malloc_bytes);
+    fprintf(out, "  \"arena_peak_bytes\": %zu,\n", stats->arena_peak);
+    fprintf(out, "  \"tokens_total\": %zu,\n  \"tokens\": {", total_tokens(stats));
+    int first = 1;
+    for (int t = 0; t < STATS_TOKEN_TYPES; t++) {
+        if (stats->tokens[t] > 0) {
+            fprintf(out, "%s\n    \"%s\": %zu", first ? "" : ",",
+                    token_type_name((TokenType)t), stats->tokens[t]);
+            first = 0;
+        }
+    }
+    fprintf(out, "\n  }");
+#ifdef LEXER_DEBUG
+    fprintf(out, ",\n  \"char_classes\": {");
+    first = 1;
+    for (int c = 0; c < STATS_CHAR_CLASSES; c++) {
+        if (stats->char_classes[c] > 0) {
+            fprintf(out, "%s\n    \"%s\": %zu", first ? "" : ",",
+                    lexer_char_class_name(c), stats->char_classes[c]);
+            first = 0;
+        }
+    }
+    fprintf(out, "\n  }");
+#endif
+    fprintf(out, "\n}\n");
+}
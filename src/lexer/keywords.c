@@ -58,8 +58,19 @@ bool is_keyword(const char *lexeme) {
  * @return El índice de la palabra clave, o -1 si no es una palabra clave.
  */
 int get_keyword_index(const char *lexeme) {
+    return get_keyword_index_n(lexeme, strlen(lexeme));
+}
+
+/**
+ * @brief Obtiene el índice de una palabra clave dada como tramo sin terminador.
+ * 
+ * @param lexeme Inicio de la palabra.
+ * @param length Longitud de la palabra.
+ * @return El índice de la palabra clave, o -1 si no es una palabra clave.
+ */
+int get_keyword_index_n(const char *lexeme, size_t length) {
     for (int i = 0; keywords[i] != NULL; i++) {
-        if (strcmp(lexeme, keywords[i]) == 0) {
+        if (strncmp(lexeme, keywords[i], length) == 0 && keywords[i][length] == '\0') {
             return i;
         }
     }
@@ -4,12 +4,55 @@
  */
 #include "../../include/lexer.h"
 #include "../../include/keywords.h"
+#include "../../include/stats.h"
+#include "../../include/utf8.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
 
 #define NUM_STATES 31
-#define NUM_CHAR_TYPES 24
+
+/*
+ * Variantes especializadas del lexer.
+ *
+ * El núcleo (lexer_scan() y las funciones lex_*) es una plantilla: recibe en
+ * @p f las construcciones que debe soportar y se expande en línea en cada
+ * variante de LEXER_VARIANTS, donde @p f es constante. El compilador elimina
+ * así las ramas de comentarios, literales en base 16/2, caracteres, UTF-8 o
+ * posiciones que la variante no necesita. lexer_init() pre-escanea el fuente
+ * y lexer_select_variant() elige la primera variante que cubre lo encontrado.
+ */
+
+/** Mantener líneas y columnas. */
+#define LEXF_POSITIONS 0x01u
+/** Validar UTF-8 dentro del texto (hay diagnósticos o --utf8-columns). */
+#define LEXF_VALIDATE 0x02u
+/** El fuente tiene bytes no ASCII. */
+#define LEXF_UNICODE 0x04u
+/** El fuente tiene '//' o '/' + '*'. */
+#define LEXF_COMMENTS 0x08u
+/** El fuente tiene '0x', '0X', '0b' o '0B'. */
+#define LEXF_RADIX 0x10u
+/** El fuente tiene comillas simples. */
+#define LEXF_CHARS 0x20u
+#define LEXF_ALL 0x3Fu
+
+/**
+ * @brief Variantes generadas: X(nombre, construcciones soportadas).
+ *
+ * El orden es el de preferencia: se usa la primera que cubre el fuente, así
+ * que las más especializadas van antes y la completa al final.
+ */
+#define LEXER_VARIANTS(X) \
+    X(basic,        LEXF_POSITIONS | LEXF_VALIDATE) \
+    X(ascii,        LEXF_ALL & ~LEXF_UNICODE) \
+    X(no_comments,  LEXF_ALL & ~LEXF_COMMENTS) \
+    X(no_positions, LEXF_ALL & ~LEXF_POSITIONS) \
+    X(dump,         LEXF_ALL & ~LEXF_VALIDATE) \
+    X(full,         LEXF_ALL)
+
+/** Las funciones de la plantilla se copian en cada variante. */
+#define LEXER_TEMPLATE static inline __attribute__((always_inline))
 
 /**
  * @brief Definición de los estados del autómata
@@ -111,67 +154,64 @@ static TokenType keyword_token_from_index(int index) {
 }
 
 
+/**
+ * @brief Tabla de tipos de caracteres; genera CharType y sus nombres de depuración.
+ */
+#define CHAR_TYPES(X) \
+    X(CHAR_LETTER) \
+    X(CHAR_DIGIT) \
+    X(CHAR_UNDERSCORE) \
+    X(CHAR_QUOTE) \
+    X(CHAR_APOSTROPHE) \
+    X(CHAR_BACKSLASH) \
+    X(CHAR_PLUS) \
+    X(CHAR_MINUS) \
+    X(CHAR_STAR) \
+    X(CHAR_SLASH) \
+    X(CHAR_PERCENT) \
+    X(CHAR_EQUAL) \
+    X(CHAR_EXCLAMATION) \
+    X(CHAR_AMPERSAND) \
+    X(CHAR_PIPE) \
+    X(CHAR_LT) \
+    X(CHAR_GT) \
+    X(CHAR_HEXLETTER) \
+    X(CHAR_DOT) \
+    X(CHAR_DELIMITER) \
+    X(CHAR_WHITESPACE) \
+    X(CHAR_NEWLINE) \
+    X(CHAR_EOF) \
+    X(CHAR_UNKNOWN)
+
 /**
  * @brief Definición de los tipos de caracteres
  */
-typedef enum CharType{
-    CHAR_LETTER,       
-    CHAR_DIGIT,        
-    CHAR_UNDERSCORE,   
-    CHAR_QUOTE,        
-    CHAR_APOSTROPHE,  
-    CHAR_BACKSLASH,    
-    CHAR_PLUS,         
-    CHAR_MINUS,        
-    CHAR_STAR,         
-    CHAR_SLASH,        
-    CHAR_PERCENT,      
-    CHAR_EQUAL,        
-    CHAR_EXCLAMATION,  
-    CHAR_AMPERSAND,    
-    CHAR_PIPE,         
-    CHAR_LT,           
-    CHAR_GT,           
-    CHAR_HEXLETTER,    
-    CHAR_DOT,          
-    CHAR_DELIMITER,    
-    CHAR_WHITESPACE,   
-    CHAR_NEWLINE,       
-    CHAR_EOF,
-    CHAR_UNKNOWN    
+typedef enum CharType {
+#define CHAR_ENUM(type) type,
+    CHAR_TYPES(CHAR_ENUM)
+#undef CHAR_ENUM
 } CharType;
 
 #ifdef LEXER_DEBUG
 static const char* char_type_to_string(CharType type) {
     static const char *names[] = {
-        [CHAR_LETTER]       = "CHAR_LETTER",
-        [CHAR_DIGIT]        = "CHAR_DIGIT",
-        [CHAR_UNDERSCORE]   = "CHAR_UNDERSCORE",
-        [CHAR_QUOTE]        = "CHAR_QUOTE",
-        [CHAR_APOSTROPHE]   = "CHAR_APOSTROPHE",
-        [CHAR_BACKSLASH]    = "CHAR_BACKSLASH",
-        [CHAR_PLUS]         = "CHAR_PLUS",
-        [CHAR_MINUS]        = "CHAR_MINUS",
-        [CHAR_STAR]         = "CHAR_STAR",
-        [CHAR_SLASH]        = "CHAR_SLASH",
-        [CHAR_PERCENT]      = "CHAR_PERCENT",
-        [CHAR_EQUAL]        = "CHAR_EQUAL",
-        [CHAR_EXCLAMATION]  = "CHAR_EXCLAMATION",
-        [CHAR_AMPERSAND]    = "CHAR_AMPERSAND",
-        [CHAR_PIPE]         = "CHAR_PIPE",
-        [CHAR_LT]           = "CHAR_LT",
-        [CHAR_GT]           = "CHAR_GT",
-        [CHAR_HEXLETTER]    = "CHAR_HEXLETTER",
-        [CHAR_DOT]          = "CHAR_DOT",
-        [CHAR_DELIMITER]    = "CHAR_DELIMITER",
-        [CHAR_WHITESPACE]   = "CHAR_WHITESPACE",
-        [CHAR_NEWLINE]      = "CHAR_NEWLINE",
-        [CHAR_EOF]          = "CHAR_EOF",
-        [CHAR_UNKNOWN]      = "CHAR_UNKNOWN"
+#define CHAR_NAME(type) [type] = #type,
+        CHAR_TYPES(CHAR_NAME)
+#undef CHAR_NAME
     };
     if (type >= 0 && type <= CHAR_UNKNOWN) return names[type];
     return "CHAR_INVALID";
 }
+
+/**
+ * @brief Nombre de una clase de carácter para el histograma de --stats.
+ *
+ * @param char_class Índice de la clase (valor de CharType).
+ * @return El nombre de la clase.
+ */
+const char *lexer_char_class_name(int char_class) {
+    return char_type_to_string((CharType)char_class);
+}
 #endif
 
 /**
@@ -213,14 +253,15 @@ static CharType get_char_type(int c) {
  * @param lexeme El lexema del token.
  * @param line El número de línea donde se encontró el token.
  * @param column El número de columna donde se encontró el token.
- * @return Un puntero al nuevo token creado, o NULL si hay error de memoria.
+ * @return Un puntero al nuevo token creado, o NULL si hay error de memoria
+ *         (no imprime nada; el lexer lo notifica por su LexerErrorCallback).
  */
 token_t *create_token(TokenType type, const char *lexeme,size_t line, size_t column) {
     token_t *new_token = (token_t *) malloc(sizeof(token_t));
     if (new_token == NULL) {
-        printf("Error: No se pudo agregar un nuevo elemento por falta de memoria.\n");
         return NULL;
     }
+    STATS_ALLOC(sizeof(token_t));
     new_token->type = type;
     new_token->line = line;
     new_token->column = column;
@@ -228,11 +269,12 @@ token_t *create_token(TokenType type, const char *lexeme,size_t line, size_t col
     if (lexeme != NULL) {
         size_t n = strlen(lexeme);
         new_token->lexeme = (char*)malloc(n + 1);
-        if (new_token->lexeme) {
-            memcpy(new_token->lexeme, lexeme, n + 1);
-        } else {
-            printf("Error: No se pudo reservar memoria para el lexema del token.\n");
+        STATS_ALLOC(n + 1);
+        if (new_token->lexeme == NULL) {
+            free(new_token);
+            return NULL;
         }
+        memcpy(new_token->lexeme, lexeme, n + 1);
     } else {
         new_token->lexeme = NULL;
     }
@@ -265,16 +307,39 @@ void free_token_list(token_t *head) {
     }
 }
 
+/**
+ * @brief Escribe un error interno del lexer en un FILE* (LexerErrorCallback).
+ *
+ * @param stream El flujo de salida (FILE *).
+ * @param message El mensaje.
+ */
+void lexer_error_to_stream(void *stream, const char *message) {
+    fprintf((FILE *)stream, "Error: %s\n", message);
+}
+
+/**
+ * @brief Notifica un error interno si hay una función registrada.
+ */
+static void notify_error(LexerErrorCallback on_error, void *user_data, const char *message) {
+    if (on_error != NULL) {
+        on_error(user_data, message);
+    }
+}
+
 /**
  * @brief Lee el contenido de un archivo y lo devuelve como una cadena.
  * 
  * @param filename El nombre del archivo a leer.
+ * @param on_error Receptor de errores, o NULL.
+ * @param user_data Dato de @p on_error.
  * @return El contenido del archivo como cadena, o NULL si hay error.
  */
-char *read_file(const char *filename){
+char *read_file(const char *filename, LexerErrorCallback on_error, void *user_data){
     FILE *file = fopen(filename, "r");
     if (file == NULL) {
-        printf("Ocurrió un error al abrir el archivo '%s' o no existe.\n", filename);
+        char message[512];
+        snprintf(message, sizeof(message), "no se pudo abrir el archivo '%s' o no existe", filename);
+        notify_error(on_error, user_data, message);
         return NULL;
     }
     fseek(file, 0, SEEK_END);
@@ -283,10 +348,11 @@ char *read_file(const char *filename){
 
     char *buffer = (char*)malloc((size_t)size + 1);
     if (buffer == NULL) {
-        printf("Error al asignar memoria.\n");
+        notify_error(on_error, user_data, "memoria insuficiente para leer el archivo");
         fclose(file);
         return NULL;
     }
+    STATS_ALLOC((size_t)size + 1);
     size_t readn = fread(buffer, 1, (size_t)size, file);
     buffer[readn] = '\0';
     fclose(file);
@@ -320,12 +386,19 @@ static inline char lxr_peek_next(const Lexer *lxr) {
  * @brief Avanza el puntero del lexer al siguiente carácter y actualiza posición.
  * 
  * @param lxr El lexer.
+ * @param f Construcciones de la variante (LEXF_*).
  */
-static inline void lxr_advance(Lexer *lxr) {
+LEXER_TEMPLATE void lxr_advance(Lexer *lxr, unsigned f) {
     char c = *(lxr->p);
     if (c == '\0')
         return;
+#ifdef LEXER_DEBUG
+    STATS_ADD(char_classes[get_char_type(c)], 1);
+#endif
     lxr->p++;
+    if (!(f & LEXF_POSITIONS)) {
+        return;
+    }
     if (c == '\n') {
         lxr->line++;
         lxr->col = 1;
@@ -334,6 +407,87 @@ static inline void lxr_advance(Lexer *lxr) {
     }
 }
 
+/**
+ * @brief Primera secuencia UTF-8 inválida encontrada dentro de un token.
+ */
+typedef struct Utf8Mark {
+    size_t line;          /**< Línea, o 0 si no se encontró ninguna */
+    size_t column;        /**< Columna */
+    unsigned char byte;   /**< Byte que inicia la secuencia inválida */
+} Utf8Mark;
+
+/**
+ * @brief Consume una secuencia no ASCII de @p length bytes (sin '\n').
+ *
+ * Con LEXER_UTF8_COLUMNS cuenta como una sola columna.
+ */
+LEXER_TEMPLATE void lxr_advance_sequence(Lexer *lxr, size_t length, unsigned f) {
+#ifdef LEXER_DEBUG
+    STATS_ADD(char_classes[CHAR_UNKNOWN], length);
+#endif
+    lxr->p += length;
+    if (f & LEXF_POSITIONS) {
+        lxr->col += (lxr->flags & LEXER_UTF8_COLUMNS) ? 1 : length;
+    }
+}
+
+/**
+ * @brief Avanza un carácter dentro de una cadena, un carácter o un comentario.
+ *
+ * Los caracteres no ASCII se validan y se consumen completos; con
+ * LEXER_UTF8_COLUMNS cuentan como una sola columna. Un byte inválido se
+ * consume solo y se anota en @p bad si es el primero.
+ *
+ * Sin LEXF_VALIDATE nadie mira las secuencias ni las columnas en puntos de
+ * código, así que basta avanzar un byte: la columna resultante es la misma.
+ *
+ * @param lxr El lexer.
+ * @param bad Destino de la primera secuencia inválida, o NULL.
+ * @param f Construcciones de la variante (LEXF_*).
+ */
+LEXER_TEMPLATE void lxr_advance_text(Lexer *lxr, Utf8Mark *bad, unsigned f) {
+    unsigned char c = (unsigned char)lxr_peek(lxr);
+    if (!(f & LEXF_UNICODE) || c < 0x80) {
+        lxr_advance(lxr, f);
+        return;
+    }
+    if (!(f & LEXF_VALIDATE)) {
+        lxr_advance_sequence(lxr, 1, f);
+        return;
+    }
+    size_t length = utf8_sequence_length(lxr->p, NULL);
+    if (length == 0) {
+        if (bad != NULL && bad->line == 0) {
+            bad->line = lxr->line;
+            bad->column = lxr->col;
+            bad->byte = c;
+        }
+        length = 1;
+    }
+    lxr_advance_sequence(lxr, length, f);
+}
+
+/**
+ * @brief Salta los bytes ASCII que no son de parada (ver utf8_ascii_run()).
+ *
+ * Los bytes saltados no contienen '\n', así que solo cambia la columna.
+ *
+ * @param lxr El lexer.
+ * @param f Construcciones de la variante (LEXF_*).
+ */
+LEXER_TEMPLATE void lxr_skip_ascii(Lexer *lxr, char stop1, char stop2, char stop3, unsigned f) {
+    size_t run = utf8_ascii_run(lxr->p, (size_t)(lxr->end - lxr->p), stop1, stop2, stop3);
+#ifdef LEXER_DEBUG
+    for (size_t i = 0; i < run; i++) {
+        STATS_ADD(char_classes[get_char_type(lxr->p[i])], 1);
+    }
+#endif
+    lxr->p += run;
+    if (f & LEXF_POSITIONS) {
+        lxr->col += run;
+    }
+}
+
 /**
  * @brief Crea un lexema a partir de un rango de caracteres.
  * 
@@ -345,47 +499,123 @@ static char* make_lexeme(const char *start, const char *end) {
     size_t length = (size_t)(end - start);
     char *s = (char *) malloc(length + 1);
     if (s == NULL) {
-        printf("Error: No se pudo reservar memoria para el lexema.\n");
         return NULL;
     }
+    STATS_ALLOC(length + 1);
     memcpy(s, start, length);
     s[length] = '\0';
     return s;
 }
 
+/**
+ * @brief Registra un error léxico en el motor de diagnósticos del lexer.
+ *
+ * @param lxr El lexer.
+ * @param line Línea del error.
+ * @param column Columna del error.
+ * @param length Longitud del fragmento erróneo.
+ * @param message Mensaje del error.
+ * @param quote Inicio del fragmento a citar (de @p length bytes), o NULL.
+ */
+static void lexer_error(const Lexer *lxr, size_t line, size_t column, size_t length,
+                        const char *message, const char *quote) {
+    if (lxr->diag == NULL) {
+        return;
+    }
+    SourceSpan span = { line, column, length };
+    if (quote != NULL) {
+        diag_report(lxr->diag, DIAG_ERROR, span, "%s '%.*s'", message,
+                    (int)(length < 40 ? length : 40), quote);
+    } else {
+        diag_report(lxr->diag, DIAG_ERROR, span, "%s", message);
+    }
+}
+
+/**
+ * @brief Registra la secuencia UTF-8 inválida anotada en @p bad, si la hay.
+ *
+ * @param lxr El lexer.
+ * @param bad La marca de lxr_advance_text().
+ * @param severity Error en cadenas y caracteres, aviso en comentarios.
+ * @param context Descripción del token ("cadena", "comentario", ...).
+ */
+static void lexer_report_utf8(const Lexer *lxr, const Utf8Mark *bad, DiagSeverity severity,
+                              const char *context) {
+    if (lxr->diag == NULL || bad->line == 0) {
+        return;
+    }
+    SourceSpan span = { bad->line, bad->column, 1 };
+    diag_report(lxr->diag, severity, span, "secuencia UTF-8 inválida en %s (byte 0x%02X)",
+                context, bad->byte);
+}
+
 /**
  * @brief Omite caracteres ignorables como espacios en blanco y comentarios.
  * 
  * @param lxr El lexer.
+ * @param f Construcciones de la variante (LEXF_*).
  */
-static void skip_ignorable(Lexer *lxr){
+LEXER_TEMPLATE void skip_ignorable(Lexer *lxr, unsigned f){
     for (;;) {
         CharType type = get_char_type(lxr_peek(lxr));
         if (type == CHAR_WHITESPACE || type == CHAR_NEWLINE) {
-            lxr_advance(lxr);
+            lxr_advance(lxr, f);
             continue;
         }
-        if (type == CHAR_SLASH) {
+        if ((f & LEXF_COMMENTS) && type == CHAR_SLASH) {
             char next = lxr_peek_next(lxr);
+            const char *comment_start = lxr->p;
             if (next == '/') {
-                
-                lxr_advance(lxr); 
-                lxr_advance(lxr);
-                while (lxr_peek(lxr) != '\0' && lxr_peek(lxr) != '\n') {
-                    lxr_advance(lxr);
+                Utf8Mark bad = { 0, 0, 0 };
+                lxr_advance(lxr, f); 
+                lxr_advance(lxr, f);
+                for (;;) {
+                    lxr_skip_ascii(lxr, '\n', '\n', '\n', f);
+                    if (lxr_peek(lxr) == '\0' || lxr_peek(lxr) == '\n') {
+                        break;
+                    }
+                    lxr_advance_text(lxr, &bad, f);
                 }
+                lexer_report_utf8(lxr, &bad, DIAG_WARNING, "comentario");
+                STATS_ADD(comment_bytes, (size_t)(lxr->p - comment_start));
                 continue;
             } else if (next == '*') {
-                lxr_advance(lxr);
-                lxr_advance(lxr);
-                while (lxr_peek(lxr) != '\0') {
+                size_t start_line = lxr->line;
+                size_t start_col = lxr->col;
+                int closed = 0;
+                Utf8Mark bad = { 0, 0, 0 };
+                lxr_advance(lxr, f);
+                lxr_advance(lxr, f);
+                // Si un comentario anterior ya llegó al final sin cierre, este tampoco lo tiene.
+                while (lxr->unclosed_comment == NULL) {
+                    lxr_skip_ascii(lxr, '*', '*', '\n', f);
+                    if (lxr_peek(lxr) == '\0') {
+                        break;
+                    }
                     if (lxr_peek(lxr) == '*' && lxr_peek_next(lxr) == '/') {
-                        lxr_advance(lxr);
-                        lxr_advance(lxr);
+                        lxr_advance(lxr, f);
+                        lxr_advance(lxr, f);
+                        closed = 1;
                         break;
                     }
-                    lxr_advance(lxr);
+                    lxr_advance_text(lxr, &bad, f);
                 }
+                if (!closed) {
+                    // Recuperación: el comentario sin cerrar termina al final de su línea.
+                    if (lxr->unclosed_comment == NULL) {
+                        lxr->unclosed_comment = comment_start;
+                    }
+                    lxr->p = comment_start;
+                    lxr->line = start_line;
+                    lxr->col = start_col;
+                    while (lxr_peek(lxr) != '\0' && lxr_peek(lxr) != '\n') {
+                        lxr_advance_text(lxr, NULL, f);
+                    }
+                    lexer_error(lxr, start_line, start_col, 2, "comentario de bloque sin cerrar", NULL);
+                } else {
+                    lexer_report_utf8(lxr, &bad, DIAG_WARNING, "comentario");
+                }
+                STATS_ADD(comment_bytes, (size_t)(lxr->p - comment_start));
                 continue;
             }
         }
@@ -406,44 +636,35 @@ static void skip_ignorable(Lexer *lxr){
  * @param lxr El lexer.
  * @param sl Línea de inicio del token.
  * @param sc Columna de inicio del token.
- * @return El token creado (identificador o palabra reservada específica).
+ * @param f Construcciones de la variante (LEXF_*).
+ * @return El tipo del token (identificador o palabra reservada específica).
  */
-static token_t* lex_identifier_or_keyword(Lexer *lxr, size_t sl, size_t sc){
+LEXER_TEMPLATE TokenType lex_identifier_or_keyword(Lexer *lxr, size_t sl, size_t sc, unsigned f){
     const char *start = lxr->p;
     
     // El primer carácter debe ser una letra o guión bajo
     CharType first_type = get_char_type(lxr_peek(lxr));
     if (first_type != CHAR_LETTER && first_type != CHAR_UNDERSCORE) {
-        lxr_advance(lxr);
-        char *lexeme = make_lexeme(start, lxr->p);
-        token_t *token = create_token(TOKEN_UNKNOWN, lexeme, sl, sc);
-        if (lexeme) free(lexeme);
-        return token;
+        lxr_advance(lxr, f);
+        lexer_error(lxr, sl, sc, 1, "carácter no reconocido", start);
+        return TOKEN_UNKNOWN;
     }
     
     // Consumir el primer carácter
-    lxr_advance(lxr);
+    lxr_advance(lxr, f);
     
     // Continuar con letras, dígitos o guiones bajos
     while (1) {
         CharType type = get_char_type(lxr_peek(lxr));
         if (type == CHAR_LETTER || type == CHAR_DIGIT || type == CHAR_UNDERSCORE) {
-            lxr_advance(lxr);
+            lxr_advance(lxr, f);
         } else {
             break;
         }
     }
     
-    char *lexeme = make_lexeme(start, lxr->p);
-    if (lexeme == NULL) {
-        return create_token(TOKEN_UNKNOWN, NULL, sl, sc);
-    }
-    
-    int keyword_index = get_keyword_index(lexeme);
-    TokenType ttype = keyword_token_from_index(keyword_index);
-    token_t *token = create_token(ttype, lexeme, sl, sc);
-    free(lexeme);
-    return token;
+    int keyword_index = get_keyword_index_n(start, (size_t)(lxr->p - start));
+    return keyword_token_from_index(keyword_index);
 }
 
 /**
@@ -479,48 +700,49 @@ static int is_bin_digit(char c) {
  * @param lxr El lexer.
  * @param sl Línea de inicio del token.
  * @param sc Columna de inicio del token.
- * @return El token creado (TOKEN_NUMBER o TOKEN_UNKNOWN).
+ * @param f Construcciones de la variante (LEXF_*).
+ * @return TOKEN_NUMBER o TOKEN_UNKNOWN.
  */
-static token_t* lex_number(Lexer *lxr, size_t sl, size_t sc){
+LEXER_TEMPLATE TokenType lex_number(Lexer *lxr, size_t sl, size_t sc, unsigned f){
     const char  *start  = lxr->p;
 
-    if (lxr_peek(lxr) == '0' && (lxr_peek_next(lxr) == 'x' || lxr_peek_next(lxr) == 'X')) {
-        lxr_advance(lxr); 
-        lxr_advance(lxr); 
+    if ((f & LEXF_RADIX) && lxr_peek(lxr) == '0' && (lxr_peek_next(lxr) == 'x' || lxr_peek_next(lxr) == 'X')) {
+        lxr_advance(lxr, f); 
+        lxr_advance(lxr, f); 
         int have = 0;
         while (is_hex_digit(lxr_peek(lxr))) {
             have = 1;
-            lxr_advance(lxr);
+            lxr_advance(lxr, f);
         }
-        char *lexeme = make_lexeme(start, lxr->p);
-        token_t *tok = create_token(have ? TOKEN_NUMBER : TOKEN_UNKNOWN, lexeme, sl, sc);
-        free(lexeme);
-        return tok;
+        if (!have) {
+            lexer_error(lxr, sl, sc, 2, "literal hexadecimal sin dígitos", start);
+        }
+        return have ? TOKEN_NUMBER : TOKEN_UNKNOWN;
     }
 
     // Números binarios (0b o 0B)
-    if (lxr_peek(lxr) == '0' && (lxr_peek_next(lxr) == 'b' || lxr_peek_next(lxr) == 'B')) {
-        lxr_advance(lxr);
-        lxr_advance(lxr); 
+    if ((f & LEXF_RADIX) && lxr_peek(lxr) == '0' && (lxr_peek_next(lxr) == 'b' || lxr_peek_next(lxr) == 'B')) {
+        lxr_advance(lxr, f);
+        lxr_advance(lxr, f); 
         int have = 0;
         while (is_bin_digit(lxr_peek(lxr))) {
             have = 1;
-            lxr_advance(lxr);
+            lxr_advance(lxr, f);
         }
-        char *lexeme = make_lexeme(start, lxr->p);
-        token_t *tok = create_token(have ? TOKEN_NUMBER : TOKEN_UNKNOWN, lexeme, sl, sc);
-        free(lexeme);
-        return tok;
+        if (!have) {
+            lexer_error(lxr, sl, sc, 2, "literal binario sin dígitos", start);
+        }
+        return have ? TOKEN_NUMBER : TOKEN_UNKNOWN;
     }
 
     while (get_char_type(lxr_peek(lxr)) == CHAR_DIGIT) {
-        lxr_advance(lxr);
+        lxr_advance(lxr, f);
     }
 
     if (get_char_type(lxr_peek(lxr)) == CHAR_DOT && get_char_type(lxr_peek_next(lxr)) == CHAR_DIGIT) {
-        lxr_advance(lxr); // '.'
+        lxr_advance(lxr, f); // '.'
         while (get_char_type(lxr_peek(lxr)) == CHAR_DIGIT) {
-            lxr_advance(lxr);
+            lxr_advance(lxr, f);
         }
     }
 
@@ -529,13 +751,13 @@ static token_t* lex_number(Lexer *lxr, size_t sl, size_t sc){
         size_t save_line = lxr->line;
         size_t save_col  = lxr->col;
 
-        lxr_advance(lxr); //
+        lxr_advance(lxr, f); //
         if (lxr_peek(lxr) == '+' || lxr_peek(lxr) == '-') {
-            lxr_advance(lxr);
+            lxr_advance(lxr, f);
         }
         if (get_char_type(lxr_peek(lxr)) == CHAR_DIGIT) {
             while (get_char_type(lxr_peek(lxr)) == CHAR_DIGIT) {
-                lxr_advance(lxr);
+                lxr_advance(lxr, f);
             }
         } else {
             lxr->p = save_p;
@@ -544,10 +766,7 @@ static token_t* lex_number(Lexer *lxr, size_t sl, size_t sc){
         }
     }
 
-    char *lexeme = make_lexeme(start, lxr->p);
-    token_t *token_num = create_token(TOKEN_NUMBER, lexeme, sl, sc);
-    free(lexeme);
-    return token_num;
+    return TOKEN_NUMBER;
 }
 
 /**
@@ -556,31 +775,51 @@ static token_t* lex_number(Lexer *lxr, size_t sl, size_t sc){
  * @param lxr El lexer.
  * @param sl Línea de inicio del token.
  * @param sc Columna de inicio del token.
- * @return El token creado (TOKEN_STRING o TOKEN_UNKNOWN).
+ * @param f Construcciones de la variante (LEXF_*).
+ * @return TOKEN_STRING o TOKEN_UNKNOWN.
  */
-static token_t* lex_string(Lexer *lxr, size_t sl, size_t sc){
+LEXER_TEMPLATE TokenType lex_string(Lexer *lxr, size_t sl, size_t sc, unsigned f){
     const char *start = lxr->p;
-    lxr_advance(lxr); 
+    lxr_advance(lxr, f); 
     int ok = 0;
-    while (lxr_peek(lxr) != '\0') {
+    Utf8Mark bad = { 0, 0, 0 };
+    // Si una comilla anterior ya llegó al final sin cierre, esta tampoco lo tiene.
+    while (lxr->unclosed_string == NULL) {
+        lxr_skip_ascii(lxr, '"', '\\', '\n', f);
         char c = lxr_peek(lxr);
+        if (c == '\0') {
+            break;
+        }
         if (c == '\\') {
-            lxr_advance(lxr);
+            lxr_advance(lxr, f);
             if (lxr_peek(lxr) != '\0') {
-                lxr_advance(lxr);
+                lxr_advance_text(lxr, &bad, f);
             }
         } else if (c == '"') {
-            lxr_advance(lxr);
+            lxr_advance(lxr, f);
             ok = 1;
             break;
         } else {
-            lxr_advance(lxr);
+            lxr_advance_text(lxr, &bad, f);
         }
     }
-    char *lexeme = make_lexeme(start, lxr->p);
-    token_t *token_str = create_token(ok ? TOKEN_STRING : TOKEN_UNKNOWN, lexeme, sl, sc);
-    free(lexeme);
-    return token_str;
+    if (!ok) {
+        // Recuperación: la cadena sin cerrar termina al final de su línea.
+        if (lxr->unclosed_string == NULL) {
+            lxr->unclosed_string = start;
+        }
+        lxr->p = start;
+        lxr->line = sl;
+        lxr->col = sc;
+        lxr_advance(lxr, f);
+        while (lxr_peek(lxr) != '\0' && lxr_peek(lxr) != '\n') {
+            lxr_advance_text(lxr, NULL, f);
+        }
+        lexer_error(lxr, sl, sc, (size_t)(lxr->p - start), "cadena sin cerrar", NULL);
+    } else {
+        lexer_report_utf8(lxr, &bad, DIAG_ERROR, "cadena");
+    }
+    return ok ? TOKEN_STRING : TOKEN_UNKNOWN;
 }
 
 /**
@@ -611,21 +850,17 @@ static int lxr_match2(const Lexer *lxr, const char *op) {
  * @param lxr El lexer.
  * @param sl Línea de inicio del token.
  * @param sc Columna de inicio del token.
- * @return El token creado para el operador/delimitador, o TOKEN_UNKNOWN en caso contrario.
+ * @param f Construcciones de la variante (LEXF_*).
+ * @return El tipo del operador/delimitador, o TOKEN_UNKNOWN en caso contrario.
  */
-static token_t* lex_operator_or_delimiter(Lexer *lxr, size_t sl, size_t sc){
+LEXER_TEMPLATE TokenType lex_operator_or_delimiter(Lexer *lxr, size_t sl, size_t sc, unsigned f){
     const char *start = lxr->p;
 
     for (const MultiCharToken *op = multi_char_tokens; op->lexeme; ++op) {
         if (lxr_match2(lxr, op->lexeme)) {
-            lxr_advance(lxr);
-            lxr_advance(lxr);
-            char *lex = make_lexeme(start, lxr->p);
-            token_t *tok = create_token(op->type, lex, sl, sc);
-            if (lex) {
-                free(lex);
-            }
-            return tok;
+            lxr_advance(lxr, f);
+            lxr_advance(lxr, f);
+            return op->type;
         }
     }
 
@@ -658,16 +893,31 @@ static token_t* lex_operator_or_delimiter(Lexer *lxr, size_t sl, size_t sc){
             break;
     }
 
-    lxr_advance(lxr);
-    char *lex = make_lexeme(start, lxr->p);
-
-    token_t *tok = create_token(recognized ? ttype : TOKEN_UNKNOWN, lex, sl, sc);
-    if (lex) {
-        free(lex);
+    size_t sequence = 0;
+    if ((f & LEXF_UNICODE) && !recognized && (unsigned char)c >= 0x80
+            && (sequence = utf8_sequence_length(start, NULL)) > 0) {
+        lxr_advance_sequence(lxr, sequence, f); // Carácter no ASCII completo
+    } else {
+        lxr_advance(lxr, f);
     }
-    return tok;
+    if (!recognized) {
+        if (lxr->p - start > 1) {
+            lexer_error(lxr, sl, sc, (size_t)(lxr->p - start), "carácter no reconocido", start);
+        } else if ((unsigned char)c < 0x20 || (unsigned char)c >= 0x7F) {
+            if (lxr->diag != NULL) {
+                SourceSpan span = { sl, sc, 1 };
+                diag_report(lxr->diag, DIAG_ERROR, span, "byte no reconocido 0x%02X", (unsigned char)c);
+            }
+        } else {
+            lexer_error(lxr, sl, sc, 1, "carácter no reconocido", start);
+        }
+    }
+    return recognized ? ttype : TOKEN_UNKNOWN;
 }
 
+static unsigned lexer_prescan(const char *source, size_t length);
+static void lexer_select_variant(Lexer *lxr);
+
 /**
  * @brief Inicializa un lexer con el código fuente dado.
  * 
@@ -677,86 +927,386 @@ static token_t* lex_operator_or_delimiter(Lexer *lxr, size_t sl, size_t sc){
 void lexer_init(Lexer *lxr, const char *source){
     lxr->source = source ? source : "";
     lxr->p = lxr->source;
+    lxr->end = lxr->source + strlen(lxr->source);
+    lxr->flags = 0;
     lxr->line = 1;
     lxr->col = 1;
+    lxr->diag = NULL;
+    lxr->on_error = NULL;
+    lxr->error_data = NULL;
+    lxr->unclosed_string = NULL;
+    lxr->unclosed_comment = NULL;
+    lxr->features = lexer_prescan(lxr->source, (size_t)(lxr->end - lxr->source));
+    lexer_select_variant(lxr);
 }
 
 /**
- * @brief Obtiene el siguiente token del código fuente.
- * 
+ * @brief Continúa el análisis desde otra posición del fuente.
+ *
+ * @p offset debe quedar fuera de tokens y comentarios (por ejemplo, el
+ * inicio de un token de un análisis anterior del mismo texto); @p line y
+ * @p column son su posición. Desde ahí los tokens son los mismos que al
+ * lexear el fuente completo.
+ *
  * @param lxr El lexer.
- * @return El siguiente token encontrado, o NULL si hay error.
+ * @param offset Desplazamiento en el fuente.
+ * @param line Línea de @p offset.
+ * @param column Columna de @p offset.
  */
-token_t* lexer_next_token(Lexer *lxr){
-    if (!lxr || !lxr->p) {
-        return NULL;
+void lexer_seek(Lexer *lxr, size_t offset, size_t line, size_t column) {
+    lxr->p = lxr->source + offset;
+    lxr->line = line;
+    lxr->col = column;
+    lxr->unclosed_string = NULL;
+    lxr->unclosed_comment = NULL;
+}
+
+/**
+ * @brief Asocia un motor de diagnósticos al lexer.
+ *
+ * Sin motor, los errores léxicos solo se reflejan como TOKEN_UNKNOWN.
+ *
+ * @param lxr El lexer.
+ * @param diag El motor de diagnósticos, o NULL.
+ */
+void lexer_set_diagnostics(Lexer *lxr, DiagEngine *diag) {
+    lxr->diag = diag;
+    lexer_select_variant(lxr);
+}
+
+/**
+ * @brief Cambia las opciones del lexer.
+ *
+ * @param lxr El lexer.
+ * @param flags Combinación de LEXER_* (0 para el comportamiento por defecto).
+ */
+void lexer_set_flags(Lexer *lxr, unsigned flags) {
+    lxr->flags = flags;
+    lexer_select_variant(lxr);
+}
+
+/**
+ * @brief Reserva un lexer en el heap.
+ *
+ * Equivale a lexer_init() sobre memoria propia; útil cuando el lexer debe
+ * sobrevivir al marco que lo crea.
+ *
+ * @param source El código fuente (debe vivir mientras se use el lexer).
+ * @return El lexer, o NULL si no hay memoria. Se libera con lexer_destroy().
+ */
+Lexer *lexer_create(const char *source) {
+    Lexer *lxr = (Lexer *)malloc(sizeof(Lexer));
+    if (lxr != NULL) {
+        lexer_init(lxr, source);
     }
-    skip_ignorable(lxr);
+    return lxr;
+}
+
+/**
+ * @brief Libera un lexer creado con lexer_create().
+ *
+ * No libera el código fuente ni los tokens ya devueltos.
+ *
+ * @param lxr El lexer (puede ser NULL).
+ */
+void lexer_destroy(Lexer *lxr) {
+    free(lxr);
+}
+
+/**
+ * @brief Registra el receptor de los errores internos del lexer.
+ *
+ * @param lxr El lexer.
+ * @param on_error La función, o NULL para ignorar los errores.
+ * @param user_data Dato que se pasa a @p on_error.
+ */
+void lexer_set_error_callback(Lexer *lxr, LexerErrorCallback on_error, void *user_data) {
+    lxr->on_error = on_error;
+    lxr->error_data = user_data;
+}
+
+/**
+ * @brief Reconoce el tipo del siguiente token; el lexema es [*start, lxr->p).
+ *
+ * Plantilla de todas las variantes: @p f es constante en cada expansión.
+ */
+LEXER_TEMPLATE TokenType lexer_scan(Lexer *lxr, const char **start_out, size_t *line_out, size_t *col_out,
+                                   unsigned f) {
+    const char *before = lxr->p;
+    skip_ignorable(lxr, f);
+    STATS_ADD(skipped_bytes, (size_t)(lxr->p - before));
 
     size_t start_line = lxr->line;
     size_t start_col = lxr->col;
+    *start_out = lxr->p;
+    *line_out = start_line;
+    *col_out = start_col;
     CharType type = get_char_type(lxr_peek(lxr));
 
     if (type == CHAR_EOF) {
-        return create_token(TOKEN_EOF, "EOF", start_line, start_col);
+        return TOKEN_EOF;
     }
     if (type == CHAR_LETTER || type == CHAR_UNDERSCORE) {
-        return lex_identifier_or_keyword(lxr, start_line, start_col);
+        return lex_identifier_or_keyword(lxr, start_line, start_col, f);
     }
     if (type == CHAR_DIGIT) {
-        return lex_number(lxr, start_line, start_col);
+        return lex_number(lxr, start_line, start_col, f);
     }
     if (type == CHAR_QUOTE) {
-        return lex_string(lxr, start_line, start_col);
+        return lex_string(lxr, start_line, start_col, f);
     }
-    if (type == CHAR_APOSTROPHE) {
+    if ((f & LEXF_CHARS) && type == CHAR_APOSTROPHE) {
         const char *start = lxr->p;
-        lxr_advance(lxr); // '
+        Utf8Mark bad = { 0, 0, 0 };
+        lxr_advance(lxr, f); // '
         
+        // El literal contiene un solo carácter: su secuencia UTF-8 debe
+        // consumirse completa aunque la variante no valide el texto.
+        unsigned text_f = f | LEXF_VALIDATE;
         // Manejar caracter con escape
         if (lxr_peek(lxr) == '\\') {
-            lxr_advance(lxr);
-            if (lxr_peek(lxr) != '\0') lxr_advance(lxr);
+            lxr_advance(lxr, f);
+            if (lxr_peek(lxr) != '\0') lxr_advance_text(lxr, &bad, text_f);
         } else if (lxr_peek(lxr) != '\0' && lxr_peek(lxr) != '\'' && lxr_peek(lxr) != '\n') {
-            // Caracter normal
-            lxr_advance(lxr);
+            // Caracter normal (puede ocupar varios bytes en UTF-8)
+            lxr_advance_text(lxr, &bad, text_f);
         }
         
         // Debe terminar con '
         if (lxr_peek(lxr) == '\'') {
-            lxr_advance(lxr);
-            char *lex = make_lexeme(start, lxr->p);
-            token_t *token = create_token(TOKEN_CHAR, lex, start_line, start_col);
-            free(lex);
-            return token;
-        } else {
-            // Caracter mal formado
-            char *lex = make_lexeme(start, lxr->p);
-            token_t *token = create_token(TOKEN_UNKNOWN, lex, start_line, start_col);
-            free(lex);
-            return token;
+            lxr_advance(lxr, f);
+            lexer_report_utf8(lxr, &bad, DIAG_ERROR, "literal de carácter");
+            return TOKEN_CHAR;
         }
+        // Caracter mal formado
+        lexer_error(lxr, start_line, start_col, (size_t)(lxr->p - start),
+                    "literal de carácter mal formado", start);
+        return TOKEN_UNKNOWN;
     }
 
-    return lex_operator_or_delimiter(lxr, start_line, start_col);
+    return lex_operator_or_delimiter(lxr, start_line, start_col, f);
 }
 
 /**
- * @brief Función de conveniencia para obtener tokens usando un lexer estático.
+ * @brief Escribe en @p token el siguiente token (plantilla de las variantes).
+ */
+LEXER_TEMPLATE void lexer_next_template(Lexer *lxr, LexToken *token, unsigned f) {
+    const char *start;
+    size_t line;
+    size_t column;
+    TokenType type = lexer_scan(lxr, &start, &line, &column, f);
+    STATS_ADD(tokens[type], 1);
+    token->type = type;
+    token->offset = (uint32_t)(start - lxr->source);
+    token->length = (uint32_t)(lxr->p - start);
+    token->line = (f & LEXF_POSITIONS) ? (uint32_t)line : 0;
+    token->column = (f & LEXF_POSITIONS) ? (uint32_t)column : 0;
+}
+
+/** Genera lexer_next_<variante>() y lexer_batch_<variante>(). */
+#define LEXER_DEFINE_VARIANT(name, features) \
+    static void lexer_next_##name(Lexer *lxr, LexToken *token) { \
+        lexer_next_template(lxr, token, (features)); \
+    } \
+    static size_t lexer_batch_##name(Lexer *lxr, LexToken *tokens, size_t max) { \
+        size_t n = 0; \
+        while (n < max) { \
+            lexer_next_template(lxr, &tokens[n], (features)); \
+            if (tokens[n++].type == TOKEN_EOF) { \
+                break; \
+            } \
+        } \
+        return n; \
+    }
+LEXER_VARIANTS(LEXER_DEFINE_VARIANT)
+#undef LEXER_DEFINE_VARIANT
+
+/**
+ * @brief Una variante generada y lo que soporta.
+ */
+typedef struct LexerVariant {
+    const char *name;
+    unsigned features;
+    void (*next)(Lexer *lxr, LexToken *token);
+    size_t (*batch)(Lexer *lxr, LexToken *tokens, size_t max);
+} LexerVariant;
+
+static const LexerVariant LEXER_VARIANT_TABLE[] = {
+#define LEXER_VARIANT_ENTRY(name, features) { #name, (features), lexer_next_##name, lexer_batch_##name },
+    LEXER_VARIANTS(LEXER_VARIANT_ENTRY)
+#undef LEXER_VARIANT_ENTRY
+};
+
+#define LEXER_VARIANT_COUNT (sizeof(LEXER_VARIANT_TABLE) / sizeof(LEXER_VARIANT_TABLE[0]))
+
+/**
+ * @brief Construcciones que la variante debe soportar para este lexer.
+ */
+static unsigned lexer_needed_features(const Lexer *lxr) {
+    if (lxr->flags & LEXER_GENERIC) {
+        return LEXF_ALL;
+    }
+    unsigned needed = lxr->features;
+    if (!(lxr->flags & LEXER_NO_POSITIONS)) {
+        needed |= LEXF_POSITIONS;
+    }
+    if (lxr->diag != NULL || (lxr->flags & LEXER_UTF8_COLUMNS)) {
+        needed |= LEXF_VALIDATE;
+    }
+    return needed;
+}
+
+/**
+ * @brief Elige la primera variante que cubre lo que necesita el lexer.
+ */
+static void lexer_select_variant(Lexer *lxr) {
+    unsigned needed = lexer_needed_features(lxr);
+    for (size_t i = 0; i < LEXER_VARIANT_COUNT; i++) {
+        if ((LEXER_VARIANT_TABLE[i].features & needed) == needed) {
+            lxr->variant = (unsigned)i;
+            return;
+        }
+    }
+    lxr->variant = (unsigned)LEXER_VARIANT_COUNT - 1;
+}
+
+/**
+ * @brief Pre-escaneo: qué construcciones opcionales aparecen en el fuente.
+ *
+ * Es conservador (un '//' dentro de una cadena cuenta como comentario) y
+ * recorre el fuente con utf8_ascii_run(), deteniéndose solo en los bytes
+ * que pueden iniciar algo; cada construcción encontrada deja de buscarse.
+ */
+static unsigned lexer_prescan(const char *source, size_t length) {
+    unsigned found = 0;
+    size_t i = 0;
+    while (i < length && found != (LEXF_UNICODE | LEXF_COMMENTS | LEXF_RADIX | LEXF_CHARS)) {
+        // '\0' no aparece antes del final, así que sirve de relleno.
+        char slash = (found & LEXF_COMMENTS) ? '\0' : '/';
+        char quote = (found & LEXF_CHARS) ? '\0' : '\'';
+        char zero = (found & LEXF_RADIX) ? '\0' : '0';
+        i += utf8_ascii_run(source + i, length - i, slash, quote, zero);
+        if (i >= length) {
+            break;
+        }
+        unsigned char c = (unsigned char)source[i];
+        char next = source[i + 1];
+        if (c >= 0x80) {
+            found |= LEXF_UNICODE;
+        } else if (c == '/') {
+            found |= (next == '/' || next == '*') ? LEXF_COMMENTS : 0;
+        } else if (c == '\'') {
+            found |= LEXF_CHARS;
+        } else if (next == 'x' || next == 'X' || next == 'b' || next == 'B') {
+            found |= LEXF_RADIX;
+        }
+        i++;
+    }
+    return found;
+}
+
+/**
+ * @brief Fuerza una variante concreta del lexer (pruebas y benchmarks).
+ *
+ * Debe llamarse después de configurar las opciones y los diagnósticos, que
+ * vuelven a elegir la variante automáticamente.
+ *
+ * @param lxr El lexer.
+ * @param name Nombre de la variante (ver lexer_variant_at()).
+ * @return 0 si es exitoso, 1 si no existe o no cubre el fuente y las opciones.
+ */
+int lexer_set_variant(Lexer *lxr, const char *name) {
+    unsigned needed = lexer_needed_features(lxr);
+    for (size_t i = 0; i < LEXER_VARIANT_COUNT; i++) {
+        if (strcmp(LEXER_VARIANT_TABLE[i].name, name) == 0) {
+            if ((LEXER_VARIANT_TABLE[i].features & needed) != needed) {
+                return 1;
+            }
+            lxr->variant = (unsigned)i;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Nombre de la variante que usa el lexer.
+ */
+const char *lexer_variant_name(const Lexer *lxr) {
+    return LEXER_VARIANT_TABLE[lxr->variant].name;
+}
+
+/**
+ * @brief Nombre de la variante número @p index, o NULL al pasar la última.
+ */
+const char *lexer_variant_at(size_t index) {
+    return index < LEXER_VARIANT_COUNT ? LEXER_VARIANT_TABLE[index].name : NULL;
+}
+
+/**
+ * @brief Obtiene el siguiente token como tramo del fuente, sin reservar memoria.
+ *
+ * Es la forma preferida de consumir el lexer: lexer_next_token() y
+ * TokenStream se construyen sobre ella. El lexema del token EOF es vacío.
+ * Con LEXER_NO_POSITIONS, línea y columna pueden valer 0.
+ *
+ * @param lxr El lexer.
+ * @param token Destino del token.
+ * @return 1 si se produjo un token, 0 si @p lxr no es válido.
+ */
+int lexer_next_compact(Lexer *lxr, LexToken *token) {
+    if (!lxr || !lxr->p) {
+        return 0;
+    }
+    LEXER_VARIANT_TABLE[lxr->variant].next(lxr, token);
+    return 1;
+}
+
+/**
+ * @brief Obtiene hasta @p max tokens seguidos; se detiene después de EOF.
+ *
+ * Equivale a llamar lexer_next_compact() en un bucle, pero elige la variante
+ * una sola vez por lote.
+ *
+ * @param lxr El lexer.
+ * @param tokens Destino de al menos @p max tokens.
+ * @param max Tokens como máximo.
+ * @return Tokens escritos (el último es EOF si se llegó al final).
+ */
+size_t lexer_next_batch(Lexer *lxr, LexToken *tokens, size_t max) {
+    if (!lxr || !lxr->p) {
+        return 0;
+    }
+    return LEXER_VARIANT_TABLE[lxr->variant].batch(lxr, tokens, max);
+}
+
+/**
+ * @brief Obtiene el siguiente token del código fuente.
+ *
+ * Todo el estado vive en @p lxr, así que varios lexers pueden usarse a la vez
+ * desde hilos distintos. Cada token se reserva en el heap; para recorrer un
+ * archivo completo es preferible lexer_next_compact(). Si falta memoria, se
+ * notifica por el LexerErrorCallback del lexer.
  * 
- * @param source El código fuente a analizar.
- * @return El siguiente token, o NULL si hay error.
+ * @param lxr El lexer.
+ * @return El siguiente token encontrado, o NULL si hay error.
  */
-token_t *get_next_token(const char *source){
-    static Lexer lexer;
-    static int initialized = 0;
-    if (!initialized) {
-        lexer_init(&lexer, source);
-        initialized = 1;
+token_t* lexer_next_token(Lexer *lxr){
+    LexToken compact;
+    if (!lexer_next_compact(lxr, &compact)) {
+        return NULL;
     }
-    token_t *token = lexer_next_token(&lexer);
-    if (token && token->type == TOKEN_EOF) {
-        initialized = 0; 
+    token_t *token;
+    if (compact.type == TOKEN_EOF) {
+        token = create_token(TOKEN_EOF, "EOF", compact.line, compact.column);
+    } else {
+        const char *start = lxr->source + compact.offset;
+        char *lexeme = make_lexeme(start, start + compact.length);
+        token = lexeme != NULL ? create_token(compact.type, lexeme, compact.line, compact.column) : NULL;
+        free(lexeme);
+    }
+    if (token == NULL) {
+        notify_error(lxr->on_error, lxr->error_data, "memoria insuficiente durante el análisis léxico");
     }
     return token;
 }
@@ -769,64 +1319,9 @@ token_t *get_next_token(const char *source){
  */
 const char* token_type_name(TokenType t) {
     static const char *names[] = {
-        [TOKEN_IDENTIFIER]  = "IDENT",
-        [TOKEN_NUMBER]      = "NUMBER",
-        [TOKEN_STRING]      = "STRING",
-        [TOKEN_CHAR]        = "CHAR",
-        [TOKEN_KW_FN]       = "KW_FN",
-        [TOKEN_KW_LET]      = "KW_LET",
-        [TOKEN_KW_MUT]      = "KW_MUT",
-        [TOKEN_KW_IF]       = "KW_IF",
-        [TOKEN_KW_ELSE]     = "KW_ELSE",
-        [TOKEN_KW_MATCH]    = "KW_MATCH",
-        [TOKEN_KW_WHILE]    = "KW_WHILE",
-        [TOKEN_KW_LOOP]     = "KW_LOOP",
-        [TOKEN_KW_FOR]      = "KW_FOR",
-        [TOKEN_KW_IN]       = "KW_IN",
-        [TOKEN_KW_BREAK]    = "KW_BREAK",
-        [TOKEN_KW_CONTINUE] = "KW_CONTINUE",
-        [TOKEN_KW_RETURN]   = "KW_RETURN",
-        [TOKEN_KW_TRUE]     = "KW_TRUE",
-        [TOKEN_KW_FALSE]    = "KW_FALSE",
-        [TOKEN_KW_I32]      = "KW_I32",
-        [TOKEN_KW_F64]      = "KW_F64",
-        [TOKEN_KW_BOOL]     = "KW_BOOL",
-        [TOKEN_KW_CHAR]     = "KW_CHAR",
-        [TOKEN_PLUS]        = "PLUS",
-        [TOKEN_MINUS]       = "MINUS",
-        [TOKEN_STAR]        = "STAR",
-        [TOKEN_SLASH]       = "SLASH",
-        [TOKEN_PERCENT]     = "PERCENT",
-        [TOKEN_EQUAL]       = "EQUAL",
-        [TOKEN_EQUAL_EQUAL] = "EQUAL_EQUAL",
-        [TOKEN_BANG]        = "BANG",
-        [TOKEN_BANG_EQUAL]  = "BANG_EQUAL",
-        [TOKEN_LESS]        = "LESS",
-        [TOKEN_LESS_EQUAL]  = "LESS_EQUAL",
-        [TOKEN_GREATER]     = "GREATER",
-        [TOKEN_GREATER_EQUAL] = "GREATER_EQUAL",
-        [TOKEN_AND_AND]     = "AND_AND",
-        [TOKEN_OR_OR]       = "OR_OR",
-        [TOKEN_PLUS_EQUAL]  = "PLUS_EQUAL",
-        [TOKEN_MINUS_EQUAL] = "MINUS_EQUAL",
-        [TOKEN_STAR_EQUAL]  = "STAR_EQUAL",
-        [TOKEN_SLASH_EQUAL] = "SLASH_EQUAL",
-        [TOKEN_PERCENT_EQUAL] = "PERCENT_EQUAL",
-        [TOKEN_PLUS_PLUS]   = "PLUS_PLUS",
-        [TOKEN_MINUS_MINUS] = "MINUS_MINUS",
-        [TOKEN_ARROW]       = "ARROW",
-        [TOKEN_DOT]         = "DOT",
-        [TOKEN_COMMA]       = "COMMA",
-        [TOKEN_SEMICOLON]   = "SEMICOLON",
-        [TOKEN_COLON]       = "COLON",
-        [TOKEN_LPAREN]      = "LPAREN",
-        [TOKEN_RPAREN]      = "RPAREN",
-        [TOKEN_LBRACE]      = "LBRACE",
-        [TOKEN_RBRACE]      = "RBRACE",
-        [TOKEN_LBRACKET]    = "LBRACKET",
-        [TOKEN_RBRACKET]    = "RBRACKET",
-        [TOKEN_UNKNOWN]     = "UNKNOWN",
-        [TOKEN_EOF]         = "EOF"
+#define TOKEN_NAME(type, name) [type] = name,
+        TOKEN_TYPES(TOKEN_NAME)
+#undef TOKEN_NAME
     };
 
     size_t count = sizeof(names) / sizeof(names[0]);
@@ -869,69 +1364,103 @@ token_t *tokenize_all(const char *source) {
 }
 
 /**
- * @brief Escribe los tokens de un archivo fuente a un archivo de salida con formato legible.
- * 
- * @param source_file El archivo fuente a tokenizar.
- * @param output_file El archivo donde escribir los tokens.
- * @return 0 si es exitoso, 1 si hay error.
+ * @brief Escribe en un flujo abierto los tokens de un código fuente ya cargado.
+ *
+ * Produce exactamente el mismo formato que write_tokens_to_file(), de modo que
+ * el modo por lotes y el modo de un solo archivo generan salidas idénticas.
+ *
+ * @param source_name Nombre del archivo fuente (solo para la cabecera).
+ * @param source El código fuente terminado en '\0'.
+ * @param flags Opciones del lexer (LEXER_*).
+ * @param output El flujo de salida.
+ * @return El número de tokens escritos, o -1 si hay error.
  */
-int write_tokens_to_file(const char *source_file, const char *output_file) {
-    if (!source_file || !output_file) return 1;
-    
-    // Leer el archivo fuente
-    char *source = read_file(source_file);
-    if (!source) {
-        printf("Error: No se pudo leer el archivo '%s'\n", source_file);
-        return 1;
-    }
-    
-    // Abrir archivo de salida
-    FILE *output = fopen(output_file, "w");
-    if (!output) {
-        printf("Error: No se pudo crear el archivo '%s'\n", output_file);
-        free(source);
-        return 1;
-    }
-    
+int write_tokens_to_stream(const char *source_name, const char *source, unsigned flags, FILE *output) {
+    if (!source_name || !source || !output) return -1;
+
     // Escribir header con información del formato
-    fprintf(output, "# Tokens generados desde: %s\n", source_file);
+    fprintf(output, "# Tokens generados desde: %s\n", source_name);
     fprintf(output, "# Formato: id_token nombre_token lexema linea columna\n");
     fprintf(output, "# Consulte token_type_name() para la correspondencia completa de identificadores.\n");
     fprintf(output, "\n");
     
     Lexer lexer;
     lexer_init(&lexer, source);
+    lexer_set_flags(&lexer, flags);
     
+    // Con --stats, el tiempo del lexer se separa del de escritura.
+    uint64_t loop_start = stats_clock();
+    uint64_t lex_ns = 0;
     int token_count = 0;
     for (;;) {
-        token_t *token = lexer_next_token(&lexer);
-        if (!token) {
+        LexToken token;
+        uint64_t lex_start = stats_clock();
+        int ok = lexer_next_compact(&lexer, &token);
+        lex_ns += stats_clock() - lex_start;
+        if (!ok) {
             fprintf(output, "# Error: No se pudo obtener el siguiente token\n");
             break;
         }
     
     // Escribir en formato: id nombre lexema linea columna
-        fprintf(output, "%d %s %s %zu %zu\n", 
-               token->type,
-               token_type_name(token->type),
-               token->lexeme ? token->lexeme : "NULL",
-               token->line, 
-               token->column);
+        if (token.type == TOKEN_EOF) {
+            fprintf(output, "%d %s EOF %u %u\n", token.type, token_type_name(token.type),
+                    token.line, token.column);
+        } else {
+            fprintf(output, "%d %s %.*s %u %u\n", 
+                   token.type,
+                   token_type_name(token.type),
+                   (int)token.length, source + token.offset,
+                   token.line, 
+                   token.column);
+        }
         
         token_count++;
         
-        if (token->type == TOKEN_EOF) {
-            free_token(token);
+        if (token.type == TOKEN_EOF) {
             break;
         }
-        free_token(token);
     }
     
     fprintf(output, "\n# Total de tokens: %d\n", token_count);
+    uint64_t loop_ns = stats_clock() - loop_start;
+    stats_phase_add(STATS_LEX, lex_ns);
+    stats_phase_add(STATS_WRITE, loop_ns - lex_ns);
+    return token_count;
+}
+
+/**
+ * @brief Escribe los tokens de un archivo fuente a un archivo de salida con formato legible.
+ * 
+ * @param source_file El archivo fuente a tokenizar.
+ * @param output_file El archivo donde escribir los tokens.
+ * @param on_error Receptor de errores, o NULL.
+ * @param user_data Dato de @p on_error.
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+int write_tokens_to_file(const char *source_file, const char *output_file,
+                         LexerErrorCallback on_error, void *user_data) {
+    if (!source_file || !output_file) return 1;
     
-    fclose(output);
-    free(source);
+    // Leer el archivo fuente
+    char *source = read_file(source_file, on_error, user_data);
+    if (!source) {
+        return 1;
+    }
     
-    printf("✓ Tokens escritos en: %s (%d tokens)\n", output_file, token_count);
-    return 0;
-}
\ No newline at end of file
+    // Abrir archivo de salida
+    FILE *output = fopen(output_file, "w");
+    if (!output) {
+        char message[512];
+        snprintf(message, sizeof(message), "no se pudo crear el archivo '%s'", output_file);
+        notify_error(on_error, user_data, message);
+        free(source);
+        return 1;
+    }
+    
+    int token_count = write_tokens_to_stream(source_file, source, 0, output);
+    
+    int failed = fclose(output) != 0 || token_count < 0;
+    free(source);
+    return failed;
+}
@@ -0,0 +1,280 @@
+/**
+ * @file token_stream.c
+ * @brief Implementación del flujo de tokens con búfer circular.
+ *
+ * Los índices head y tail son absolutos y solo crecen; la posición en el
+ * búfer es el índice módulo TOKEN_STREAM_CAPACITY. El productor solo escribe
+ * un lote cuando caben TOKEN_STREAM_BATCH tokens por delante del head
+ * publicado, así que un token devuelto por token_stream_peek() no se
+ * sobrescribe hasta que el consumidor publica que lo dejó atrás.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/token_stream.h"
+#include <string.h>
+#include <unistd.h>
+
+#define RING_MASK (TOKEN_STREAM_CAPACITY - 1)
+
+/**
+ * @brief Lexea hasta @p count tokens a partir de @p tail.
+ *
+ * Usa lexer_next_batch(); un lote que cruza el final del búfer se escribe en
+ * dos tramos contiguos.
+ *
+ * @return Tokens producidos; se detiene después de EOF.
+ */
+static size_t produce_batch(TokenStream *ts, size_t tail, size_t count, int *eof) {
+    size_t n = 0;
+    while (n < count) {
+        size_t at = (tail + n) & RING_MASK;
+        size_t room = TOKEN_STREAM_CAPACITY - at;
+        size_t made = lexer_next_batch(ts->lexer, &ts->ring[at], count - n < room ? count - n : room);
+        if (made == 0) {
+            memset(&ts->ring[at], 0, sizeof(LexToken));
+            ts->ring[at].type = TOKEN_EOF;
+            made = 1;
+        }
+        n += made;
+        if (ts->ring[(tail + n - 1) & RING_MASK].type == TOKEN_EOF) {
+            *eof = 1;
+            break;
+        }
+    }
+    return n;
+}
+
+/**
+ * @brief Despierta al otro extremo tras publicar un índice, si está dormido.
+ *
+ * Quien va a dormir marca @p waiting con el cerrojo tomado y vuelve a mirar
+ * el índice antes de esperar; como ambos accesos son secuencialmente
+ * consistentes, o bien ve el índice nuevo o bien aquí se ve la marca.
+ */
+static void wake_other(TokenStream *ts, atomic_int *waiting) {
+    if (!atomic_load(waiting)) {
+        return;
+    }
+    pthread_mutex_lock(&ts->lock);
+    pthread_cond_broadcast(&ts->wake);
+    pthread_mutex_unlock(&ts->lock);
+}
+
+/**
+ * @brief Bucle del hilo del lexer.
+ */
+static void *producer_main(void *arg) {
+    TokenStream *ts = (TokenStream *)arg;
+    CompilerStats *previous = stats_begin(ts->stats_target != NULL ? &ts->lexer_stats : NULL);
+    uint64_t lex_ns = 0;
+    size_t tail = 0;
+    int eof = 0;
+
+    while (!eof) {
+        size_t head = atomic_load(&ts->shared_head);
+        if (TOKEN_STREAM_CAPACITY - (tail - head) < TOKEN_STREAM_BATCH) {
+            pthread_mutex_lock(&ts->lock);
+            atomic_store(&ts->producer_waiting, 1);
+            while (!atomic_load(&ts->stop)
+                    && TOKEN_STREAM_CAPACITY - (tail - atomic_load(&ts->shared_head)) < TOKEN_STREAM_BATCH) {
+                pthread_cond_wait(&ts->wake, &ts->lock);
+            }
+            atomic_store(&ts->producer_waiting, 0);
+            pthread_mutex_unlock(&ts->lock);
+            if (atomic_load(&ts->stop)) {
+                break;
+            }
+            continue;
+        }
+
+        uint64_t start = stats_clock();
+        tail += produce_batch(ts, tail, TOKEN_STREAM_BATCH, &eof);
+        lex_ns += stats_clock() - start;
+        atomic_store(&ts->shared_tail, tail);
+        if (eof) {
+            atomic_store(&ts->shared_done, 1);
+        }
+        wake_other(ts, &ts->consumer_waiting);
+    }
+
+    stats_phase_add(STATS_LEX, lex_ns);
+    stats_begin(previous);
+    return NULL;
+}
+
+/**
+ * @brief Publica el head del consumidor para liberar espacio al productor.
+ */
+static void publish_head(TokenStream *ts) {
+    atomic_store(&ts->shared_head, ts->head);
+    wake_other(ts, &ts->producer_waiting);
+}
+
+/**
+ * @brief Inicializa un flujo sobre un lexer ya configurado.
+ *
+ * Con LEXER_THREADED en las opciones del lexer, un fuente de al menos
+ * TOKEN_STREAM_THREAD_MIN_BYTES y más de un procesador, el lexer pasa a su
+ * propio hilo. Sus
+ * diagnósticos se acumulan aparte y se incorporan, ordenados por posición,
+ * al motor del lexer en token_stream_destroy().
+ *
+ * @param ts El flujo.
+ * @param lexer El lexer (debe vivir hasta token_stream_destroy()).
+ * @return 0 si es exitoso, 1 si no se pudo crear el hilo (el flujo queda
+ *         operativo en modo sin hilo).
+ */
+int token_stream_init(TokenStream *ts, Lexer *lexer) {
+    ts->lexer = lexer;
+    ts->head = 0;
+    ts->tail = 0;
+    ts->done = 0;
+    ts->stall_ns = 0;
+    ts->threaded = 0;
+    ts->diag_first = lexer->diag != NULL ? lexer->diag->count : 0;
+
+    // Con un solo procesador el hilo solo añadiría cambios de contexto.
+    size_t length = (size_t)(lexer->end - lexer->source);
+    if (!(lexer->flags & LEXER_THREADED) || length < TOKEN_STREAM_THREAD_MIN_BYTES
+            || sysconf(_SC_NPROCESSORS_ONLN) < 2) {
+        return 0;
+    }
+
+    ts->diag_target = lexer->diag;
+    memset(&ts->lexer_diag, 0, sizeof(ts->lexer_diag));
+    if (ts->diag_target != NULL) {
+        if (ts->diag_target->capacity > 0
+                && diag_init(&ts->lexer_diag, ts->diag_target->capacity) != 0) {
+            return 1;
+        }
+        lexer_set_diagnostics(lexer, &ts->lexer_diag);
+    }
+    ts->stats_target = stats_current;
+    memset(&ts->lexer_stats, 0, sizeof(ts->lexer_stats));
+    atomic_init(&ts->shared_head, 0);
+    atomic_init(&ts->shared_tail, 0);
+    atomic_init(&ts->shared_done, 0);
+    atomic_init(&ts->stop, 0);
+    atomic_init(&ts->producer_waiting, 0);
+    atomic_init(&ts->consumer_waiting, 0);
+    pthread_mutex_init(&ts->lock, NULL);
+    pthread_cond_init(&ts->wake, NULL);
+    if (pthread_create(&ts->thread, NULL, producer_main, ts) != 0) {
+        pthread_cond_destroy(&ts->wake);
+        pthread_mutex_destroy(&ts->lock);
+        if (ts->diag_target != NULL) {
+            lexer_set_diagnostics(lexer, ts->diag_target);
+            diag_free(&ts->lexer_diag);
+        }
+        return 1;
+    }
+    ts->threaded = 1;
+    return 0;
+}
+
+/**
+ * @brief Obtiene tokens hasta que haya al menos @p needed o se llegue a EOF.
+ */
+static void fill(TokenStream *ts, size_t needed) {
+    uint64_t start = stats_clock();
+    if (!ts->threaded) {
+        while (ts->tail < needed && !ts->done) {
+            size_t room = TOKEN_STREAM_CAPACITY - (ts->tail - ts->head);
+            size_t count = room < TOKEN_STREAM_BATCH ? room : TOKEN_STREAM_BATCH;
+            ts->tail += produce_batch(ts, ts->tail, count, &ts->done);
+        }
+    } else {
+        ts->tail = atomic_load(&ts->shared_tail);
+        if (ts->tail < needed && !ts->done) {
+            publish_head(ts);
+            pthread_mutex_lock(&ts->lock);
+            atomic_store(&ts->consumer_waiting, 1);
+            for (;;) {
+                // done se publica después de tail: leerlo primero garantiza ver el tail final.
+                ts->done = atomic_load(&ts->shared_done);
+                ts->tail = atomic_load(&ts->shared_tail);
+                if (ts->tail >= needed || ts->done) {
+                    break;
+                }
+                pthread_cond_wait(&ts->wake, &ts->lock);
+            }
+            atomic_store(&ts->consumer_waiting, 0);
+            pthread_mutex_unlock(&ts->lock);
+        }
+    }
+    ts->stall_ns += stats_clock() - start;
+}
+
+/**
+ * @brief Devuelve el token @p k posiciones por delante del actual.
+ *
+ * Más allá del fin del archivo devuelve siempre el token EOF. El puntero es
+ * válido hasta la siguiente llamada a token_stream_advance().
+ *
+ * @param ts El flujo.
+ * @param k Anticipación (0 para el token actual), menor que TOKEN_STREAM_MAX_PEEK.
+ * @return El token.
+ */
+const LexToken *token_stream_peek(TokenStream *ts, size_t k) {
+    size_t index = ts->head + (k < TOKEN_STREAM_MAX_PEEK ? k : TOKEN_STREAM_MAX_PEEK - 1);
+    if (index >= ts->tail) {
+        fill(ts, index + 1);
+        if (index >= ts->tail) {
+            index = ts->tail - 1;
+        }
+    }
+    return &ts->ring[index & RING_MASK];
+}
+
+/**
+ * @brief Consume el token actual; en EOF no hace nada.
+ *
+ * @param ts El flujo.
+ */
+void token_stream_advance(TokenStream *ts) {
+    if (token_stream_peek(ts, 0)->type == TOKEN_EOF) {
+        return;
+    }
+    ts->head++;
+    if (ts->threaded && ts->head % TOKEN_STREAM_BATCH == 0) {
+        publish_head(ts);
+    }
+}
+
+/**
+ * @brief Detiene el hilo del lexer, si lo hay, y libera el flujo.
+ *
+ * Deja ordenados por posición los diagnósticos registrados durante el
+ * flujo e incorpora las estadísticas del hilo del lexer a las del llamador.
+ * Sin hilo, el tiempo de lexeo se suma aquí a STATS_LEX.
+ *
+ * @param ts El flujo.
+ */
+void token_stream_destroy(TokenStream *ts) {
+    if (!ts->threaded) {
+        // El lexer se adelanta hasta un lote: sus diagnósticos pueden haber
+        // quedado antes que los del consumidor en posiciones anteriores.
+        if (ts->lexer->diag != NULL) {
+            diag_sort_from(ts->lexer->diag, ts->diag_first);
+        }
+        stats_phase_add(STATS_LEX, ts->stall_ns);
+        return;
+    }
+    atomic_store(&ts->stop, 1);
+    pthread_mutex_lock(&ts->lock);
+    pthread_cond_broadcast(&ts->wake);
+    pthread_mutex_unlock(&ts->lock);
+    pthread_join(ts->thread, NULL);
+    pthread_cond_destroy(&ts->wake);
+    pthread_mutex_destroy(&ts->lock);
+
+    if (ts->stats_target != NULL) {
+        stats_merge(ts->stats_target, &ts->lexer_stats);
+    }
+    if (ts->diag_target != NULL) {
+        diag_merge(ts->diag_target, &ts->lexer_diag);
+        lexer_set_diagnostics(ts->lexer, ts->diag_target);
+        diag_free(&ts->lexer_diag);
+    }
+    ts->threaded = 0;
+}
@@ -0,0 +1,119 @@
+/**
+ * @file ast.c
+ * @brief Nombres y volcado del AST.
+ */
+#include "../../include/ast.h"
+
+/** Nombres de AstKind, en el orden del enum. */
+static const char *const KIND_NAMES[AST_KIND_COUNT] = {
+    "Programa", "Funcion", "Parametro", "Tipo", "Bloque", "Let", "If", "While", "For",
+    "Loop", "Match", "Brazo", "Return", "Break", "Continue", "Expresion", "Numero",
+    "Cadena", "Caracter", "Booleano", "Nombre", "Unario", "Binario", "Asignacion",
+    "Llamada", "Campo", "Rango", "Arreglo"
+};
+
+/**
+ * @brief Devuelve el nombre de una clase de nodo.
+ */
+const char *ast_kind_name(AstKind kind) {
+    return (unsigned)kind < AST_KIND_COUNT ? KIND_NAMES[kind] : "?";
+}
+
+/**
+ * @brief Devuelve el nombre de un tipo del análisis semántico.
+ */
+const char *ast_type_name(AstType type) {
+    switch (type) {
+        case AST_TYPE_UNIT: return "()";
+        case AST_TYPE_I32: return "i32";
+        case AST_TYPE_BOOL: return "bool";
+        case AST_TYPE_CHAR: return "char";
+        case AST_TYPE_STRING: return "String";
+        case AST_TYPE_ARRAY: return "Array";
+        default: return "?";
+    }
+}
+
+/**
+ * @brief Escribe el lexema del token principal de un nodo.
+ */
+static void print_lexeme(const AstNode *item, const AstNode *node, const char *source, FILE *out) {
+    fprintf(out, "%.*s", (int)node->length, source + ast_offset(item, node));
+}
+
+/**
+ * @brief Escribe un nodo, sus hijos y los nodos que le siguen en su lista.
+ *
+ * Los tipos de parámetros, variables y retornos se muestran en la línea de
+ * su dueño en lugar de como hijos. Con @p item NULL, cada nodo de la lista
+ * es su propio item (la raíz y los items de AST_PROGRAM).
+ */
+static void print_chain(const AstNode *node, const AstNode *item, const char *source, int depth,
+                        FILE *out) {
+    for (; node != NULL; node = node->next) {
+        const AstNode *base = item != NULL ? item : node;
+        const AstNode *inner = node->kind == AST_PROGRAM ? NULL : base;
+        fprintf(out, "%*s%s", depth * 2, "", ast_kind_name(node->kind));
+        switch (node->kind) {
+            case AST_PROGRAM:
+            case AST_BLOCK:
+            case AST_IF:
+            case AST_WHILE:
+            case AST_LOOP:
+            case AST_MATCH:
+            case AST_MATCH_ARM:
+            case AST_RETURN:
+            case AST_BREAK:
+            case AST_CONTINUE:
+            case AST_EXPR_STMT:
+            case AST_CALL:
+            case AST_RANGE:
+            case AST_ARRAY:
+                break;
+            case AST_LET:
+                fprintf(out, node->op == TOKEN_KW_MUT ? " mut " : " ");
+                print_lexeme(base, node, source, out);
+                break;
+            default:
+                fprintf(out, " ");
+                print_lexeme(base, node, source, out);
+                break;
+        }
+        const AstNode *type = node->kind == AST_FUNCTION ? node->b
+                            : (node->kind == AST_PARAM || node->kind == AST_LET) ? node->a : NULL;
+        if (type != NULL) {
+            fprintf(out, node->kind == AST_FUNCTION ? " -> " : ": ");
+            print_lexeme(base, type, source, out);
+        }
+        fprintf(out, " @%u:%u\n", ast_line(base, node), node->column);
+
+        switch (node->kind) {
+            case AST_FUNCTION:
+                print_chain(node->a, inner, source, depth + 1, out);
+                print_chain(node->c, inner, source, depth + 1, out);
+                break;
+            case AST_PARAM:
+            case AST_TYPE:
+                break;
+            case AST_LET:
+                print_chain(node->b, inner, source, depth + 1, out);
+                break;
+            default:
+                print_chain(node->a, inner, source, depth + 1, out);
+                print_chain(node->b, inner, source, depth + 1, out);
+                print_chain(node->c, inner, source, depth + 1, out);
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Escribe un árbol indentado, un nodo por línea con su posición.
+ *
+ * @param node La raíz (normalmente AST_PROGRAM).
+ * @param source El fuente del que se construyó.
+ * @param out Flujo de salida.
+ */
+void ast_print(const AstNode *node, const char *source, FILE *out) {
+    print_chain(node, NULL, source, 0, out);
+}
@@ -0,0 +1,1439 @@
+/**
+ * @file parser.c
+ * @brief Implementación del analizador sintáctico.
+ *
+ * Cada función parse_* corresponde a un no terminal de gramatica.md. Tras
+ * un error, el parser entra en modo pánico: no reporta nada más hasta que
+ * synchronize() descarta tokens y la sentencia siguiente empieza limpia.
+ * Como cada token se descarta o consume una sola vez, el coste total es
+ * lineal en el tamaño de la entrada.
+ *
+ * Las funciones parse_* devuelven el nodo del AST que reconocen. Sin arena
+ * (parse_source() y parse_source_parallel()) todos los nodos son el mismo
+ * nodo de descarte del parser: las escrituras no cuestan una reserva y
+ * nadie lee el resultado.
+ *
+ * parse_source_parallel() lexea primero todo el fuente a un arreglo y lo
+ * reparte en fragmentos que empiezan en un 'fn' de nivel superior; cada
+ * hilo analiza fragmentos completos leyendo del arreglo en lugar de un
+ * TokenStream. Con AST (parse_source_ast_parallel()) cada hilo reserva
+ * los nodos en su propia arena; como cada item guarda posiciones
+ * absolutas solo en su raíz, las listas de items de los fragmentos se
+ * encadenan en orden de fuente sin tocar ningún nodo.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/parser.h"
+#include "../../include/stats.h"
+#include "../../include/token_stream.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/**
+ * @brief Estado del parser.
+ */
+typedef struct Parser {
+    Lexer lexer;            /**< Productor de tokens */
+    TokenStream stream;     /**< Tokens pendientes del lexer */
+    const LexToken *buffer; /**< Tokens ya lexeados, o NULL para leer de stream */
+    size_t position;        /**< Índice del token actual en buffer */
+    size_t stop;            /**< Índice en buffer donde termina el fragmento */
+    const char *source;     /**< Código fuente (para los lexemas) */
+    LexToken current;       /**< Token actual */
+    DiagEngine *diag;       /**< Destino de los diagnósticos, o NULL */
+    Arena *arena;           /**< Destino de los nodos, o NULL para no construir el AST */
+    AstNode discard;        /**< Nodo devuelto sin arena */
+    const AstNode *item;    /**< Raíz del item en análisis (base de las posiciones), o NULL */
+    int out_of_memory;      /**< 1 si la arena no pudo reservar un nodo */
+    int panic;              /**< 1 mientras se busca un punto de sincronización */
+    int eof_reported;       /**< 1 si ya se reportó un error en el fin del archivo */
+    size_t depth;           /**< Anidamiento actual */
+    size_t consumed;        /**< Tokens consumidos (para garantizar progreso) */
+    size_t tokens;          /**< Tokens leídos del lexer */
+    size_t errors;          /**< Errores sintácticos */
+} Parser;
+
+static AstNode *parse_statement(Parser *p);
+static AstNode *parse_block(Parser *p);
+static AstNode *parse_expression(Parser *p);
+
+/**
+ * @brief Carga en current el siguiente token útil del flujo.
+ *
+ * Los tokens no reconocidos ya tienen su diagnóstico léxico, así que se
+ * omiten aquí para no provocar errores sintácticos en cascada.
+ */
+static void load_current(Parser *p) {
+    for (;;) {
+        const LexToken *token = p->buffer != NULL ? &p->buffer[p->position]
+                                                  : token_stream_peek(&p->stream, 0);
+        p->tokens++;
+        if (token->type != TOKEN_UNKNOWN) {
+            p->current = *token;
+            return;
+        }
+        if (p->buffer != NULL) {
+            p->position++;
+        } else {
+            token_stream_advance(&p->stream);
+        }
+    }
+}
+
+/**
+ * @brief Avanza al siguiente token útil.
+ */
+static void advance(Parser *p) {
+    if (p->current.type == TOKEN_EOF) {
+        return;
+    }
+    if (p->buffer != NULL) {
+        p->position++;
+    } else {
+        token_stream_advance(&p->stream);
+    }
+    p->consumed++;
+    load_current(p);
+}
+
+/**
+ * @brief Indica si el token actual es del tipo dado.
+ */
+static int check(const Parser *p, TokenType type) {
+    return p->current.type == type;
+}
+
+/**
+ * @brief Consume el token actual si es del tipo dado.
+ *
+ * @return 1 si se consumió, 0 en caso contrario.
+ */
+static int match(Parser *p, TokenType type) {
+    if (!check(p, type)) {
+        return 0;
+    }
+    advance(p);
+    return 1;
+}
+
+/**
+ * @brief Crea un nodo en la posición de @p token.
+ *
+ * Sin arena (o si se agota) devuelve el nodo de descarte, así que el
+ * resultado nunca es NULL y puede escribirse sin comprobarlo. El primer
+ * nodo de cada item es su raíz y guarda la posición absoluta; los demás,
+ * la relativa a ella (ver ast.h).
+ */
+static AstNode *node_new(Parser *p, AstKind kind, const LexToken *token) {
+    if (p->arena == NULL) {
+        return &p->discard;
+    }
+    AstNode *node = (AstNode *)arena_alloc(p->arena, sizeof(AstNode));
+    if (node == NULL) {
+        p->out_of_memory = 1;
+        return &p->discard;
+    }
+    memset(node, 0, sizeof(*node));
+    node->kind = kind;
+    node->op = token->type;
+    node->offset = token->offset;
+    node->length = token->length;
+    node->line = token->line;
+    node->column = token->column;
+    if (p->item == NULL) {
+        p->item = node;
+    } else {
+        node->offset -= p->item->offset;
+        node->line -= p->item->line;
+    }
+    return node;
+}
+
+/**
+ * @brief Crea un nodo en el token actual.
+ */
+static AstNode *node_here(Parser *p, AstKind kind) {
+    return node_new(p, kind, &p->current);
+}
+
+/**
+ * @brief Crea un nodo con dos hijos en la posición de @p at.
+ */
+static AstNode *node_pair(Parser *p, AstKind kind, const LexToken *at, TokenType op,
+                          AstNode *a, AstNode *b) {
+    AstNode *node = node_new(p, kind, at);
+    node->op = op;
+    node->a = a;
+    node->b = b;
+    return node;
+}
+
+/**
+ * @brief Reporta un error en el token actual y entra en modo pánico.
+ *
+ * En modo pánico no se reporta nada: el primer error de la sentencia es el
+ * único significativo. Tampoco se repite el error en el fin del archivo
+ * cuando quedan varios bloques sin cerrar.
+ *
+ * @param p El parser.
+ * @param expected Descripción de lo que se esperaba.
+ */
+static void error_expected(Parser *p, const char *expected) {
+    if (p->panic || (p->current.type == TOKEN_EOF && p->eof_reported)) {
+        p->panic = 1;
+        return;
+    }
+    p->panic = 1;
+    p->eof_reported = p->current.type == TOKEN_EOF;
+    p->errors++;
+    const LexToken *token = &p->current;
+    SourceSpan span = { token->line, token->column, token->length };
+    if (token->type == TOKEN_EOF) {
+        diag_report(p->diag, DIAG_ERROR, span, "se esperaba %s, se encontró el fin del archivo", expected);
+    } else {
+        int shown = token->length < 40 ? (int)token->length : 40;
+        diag_report(p->diag, DIAG_ERROR, span, "se esperaba %s, se encontró '%.*s'",
+                    expected, shown, p->source + token->offset);
+    }
+}
+
+/**
+ * @brief Consume un token obligatorio o reporta su ausencia.
+ *
+ * @return 1 si se consumió, 0 si faltaba.
+ */
+static int expect(Parser *p, TokenType type, const char *expected) {
+    if (match(p, type)) {
+        return 1;
+    }
+    error_expected(p, expected);
+    return 0;
+}
+
+/**
+ * @brief Indica si el token inicia una sentencia con palabra reservada.
+ *
+ * Son los puntos de sincronización además de ';' y '}' (PI de Sentencia e
+ * Item en tabla-pi-pd.md, sin los que también inician expresiones).
+ */
+static int starts_statement_keyword(TokenType type) {
+    switch (type) {
+        case TOKEN_KW_FN:
+        case TOKEN_KW_LET:
+        case TOKEN_KW_IF:
+        case TOKEN_KW_WHILE:
+        case TOKEN_KW_FOR:
+        case TOKEN_KW_LOOP:
+        case TOKEN_KW_MATCH:
+        case TOKEN_KW_RETURN:
+        case TOKEN_KW_BREAK:
+        case TOKEN_KW_CONTINUE:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Indica si el token pertenece a PI(Expresion).
+ */
+static int starts_expression(TokenType type) {
+    switch (type) {
+        case TOKEN_BANG:
+        case TOKEN_MINUS:
+        case TOKEN_PLUS:
+        case TOKEN_NUMBER:
+        case TOKEN_STRING:
+        case TOKEN_CHAR:
+        case TOKEN_KW_TRUE:
+        case TOKEN_KW_FALSE:
+        case TOKEN_IDENTIFIER:
+        case TOKEN_LPAREN:
+        case TOKEN_LBRACKET:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/**
+ * @brief Sale del modo pánico descartando tokens hasta un punto seguro.
+ *
+ * Se detiene después de un ';', o antes de un '}', del inicio de una
+ * sentencia con palabra reservada o del fin del archivo.
+ */
+static void synchronize(Parser *p) {
+    p->panic = 0;
+    while (!check(p, TOKEN_EOF)) {
+        if (match(p, TOKEN_SEMICOLON)) {
+            return;
+        }
+        if (check(p, TOKEN_RBRACE) || starts_statement_keyword(p->current.type)) {
+            return;
+        }
+        advance(p);
+    }
+}
+
+/**
+ * @brief Sincroniza si hubo un error y garantiza que se consumió algún token.
+ *
+ * @param p El parser.
+ * @param consumed_before Valor de p->consumed antes de la sentencia.
+ */
+static void recover(Parser *p, size_t consumed_before) {
+    if (p->panic) {
+        synchronize(p);
+    }
+    if (p->consumed == consumed_before && !check(p, TOKEN_EOF) && !check(p, TOKEN_RBRACE)) {
+        advance(p);
+    }
+}
+
+/**
+ * @brief Entra en un nivel de anidamiento.
+ *
+ * @return 1 si se puede continuar, 0 si se superó PARSER_MAX_DEPTH.
+ */
+static int enter(Parser *p) {
+    if (p->depth >= PARSER_MAX_DEPTH) {
+        error_expected(p, "una construcción menos anidada");
+        return 0;
+    }
+    p->depth++;
+    return 1;
+}
+
+/* ---- Tipos y funciones ---- */
+
+/**
+ * @brief Tipo -> 'i32' | 'f64' | 'bool' | 'char' | IDENT
+ */
+static AstNode *parse_type(Parser *p) {
+    switch (p->current.type) {
+        case TOKEN_KW_I32:
+        case TOKEN_KW_F64:
+        case TOKEN_KW_BOOL:
+        case TOKEN_KW_CHAR:
+        case TOKEN_IDENTIFIER: {
+            AstNode *type = node_here(p, AST_TYPE);
+            advance(p);
+            return type;
+        }
+        default:
+            error_expected(p, "un tipo");
+            return NULL;
+    }
+}
+
+/**
+ * @brief Parametro -> IDENT ':' Tipo
+ */
+static AstNode *parse_parameter(Parser *p) {
+    AstNode *param = node_here(p, AST_PARAM);
+    if (expect(p, TOKEN_IDENTIFIER, "el nombre del parámetro")
+            && expect(p, TOKEN_COLON, "':' después del parámetro")) {
+        param->a = parse_type(p);
+    }
+    return param;
+}
+
+/**
+ * @brief Funcion -> 'fn' IDENT '(' ListaParametrosOpt ')' RetornoOpt Bloque
+ *
+ * RetornoOpt -> '-' '>' Tipo | epsilon. El lexer no tiene un token '->', así
+ * que la flecha llega como dos tokens (los ejemplos de éxito la usan aunque
+ * gramatica.md no la incluye).
+ *
+ * Si la cabecera tiene errores, se descarta hasta el '{' del cuerpo para
+ * analizarlo igualmente.
+ */
+static AstNode *parse_function(Parser *p) {
+    advance(p); // fn
+    AstNode *function = node_here(p, AST_FUNCTION);
+    if (expect(p, TOKEN_IDENTIFIER, "el nombre de la función")
+            && expect(p, TOKEN_LPAREN, "'(' después del nombre de la función")) {
+        if (check(p, TOKEN_IDENTIFIER)) {
+            AstNode **tail = &function->a;
+            *tail = parse_parameter(p);
+            tail = &(*tail)->next;
+            while (!p->panic && match(p, TOKEN_COMMA)) {
+                *tail = parse_parameter(p);
+                tail = &(*tail)->next;
+            }
+        }
+        if (!p->panic) {
+            expect(p, TOKEN_RPAREN, "')' al final de los parámetros");
+        }
+        if (!p->panic && match(p, TOKEN_MINUS)
+                && expect(p, TOKEN_GREATER, "'>' en el tipo de retorno")) {
+            function->b = parse_type(p);
+        }
+    }
+    if (p->panic) {
+        while (!check(p, TOKEN_EOF) && !check(p, TOKEN_LBRACE) && !check(p, TOKEN_SEMICOLON)
+                && !check(p, TOKEN_RBRACE) && !starts_statement_keyword(p->current.type)) {
+            advance(p);
+        }
+        if (!check(p, TOKEN_LBRACE)) {
+            return function;
+        }
+        p->panic = 0;
+    }
+    function->c = parse_block(p);
+    return function;
+}
+
+/* ---- Expresiones ---- */
+
+/**
+ * @brief Analiza una lista de expresiones separadas por ',' hasta @p close.
+ *
+ * @return La primera expresión de la lista (encadenadas por next), o NULL.
+ */
+static AstNode *parse_expression_list(Parser *p, TokenType close, const char *expected) {
+    AstNode *first = NULL;
+    if (!check(p, close)) {
+        AstNode **tail = &first;
+        *tail = parse_expression(p);
+        while (!p->panic && *tail != NULL && match(p, TOKEN_COMMA)) {
+            tail = &(*tail)->next;
+            *tail = parse_expression(p);
+        }
+    }
+    if (!p->panic) {
+        expect(p, close, expected);
+    }
+    return first;
+}
+
+/**
+ * @brief Primario -> Literal | IDENT | '(' Expresion ')' | ArregloLiteral
+ */
+static AstNode *parse_primary(Parser *p) {
+    AstNode *node = NULL;
+    switch (p->current.type) {
+        case TOKEN_NUMBER:
+            node = node_here(p, AST_NUMBER);
+            advance(p);
+            break;
+        case TOKEN_STRING:
+            node = node_here(p, AST_STRING);
+            advance(p);
+            break;
+        case TOKEN_CHAR:
+            node = node_here(p, AST_CHAR);
+            advance(p);
+            break;
+        case TOKEN_KW_TRUE:
+        case TOKEN_KW_FALSE:
+            node = node_here(p, AST_BOOL);
+            advance(p);
+            break;
+        case TOKEN_IDENTIFIER:
+            node = node_here(p, AST_NAME);
+            advance(p);
+            break;
+        case TOKEN_LPAREN:
+            advance(p);
+            node = parse_expression(p);
+            if (!p->panic) {
+                expect(p, TOKEN_RPAREN, "')'");
+            }
+            break;
+        case TOKEN_LBRACKET:
+            node = node_here(p, AST_ARRAY);
+            advance(p);
+            node->a = parse_expression_list(p, TOKEN_RBRACKET, "']' al final del arreglo");
+            break;
+        default:
+            error_expected(p, "una expresión");
+            break;
+    }
+    return node;
+}
+
+static AstNode *parse_binary(Parser *p, int level);
+
+/** Nivel de Term en parse_binary(). */
+#define BINARY_LEVEL_TERM 4
+
+/**
+ * @brief Postfijo -> Primario ( '.' IDENT | Llamada )* ( '.' '.' Term )?
+ *
+ * El rango '..' (usado por los for de los ejemplos) llega como dos DOT.
+ */
+static AstNode *parse_postfix(Parser *p) {
+    AstNode *node = parse_primary(p);
+    while (!p->panic) {
+        LexToken at = p->current;
+        if (match(p, TOKEN_DOT)) {
+            if (match(p, TOKEN_DOT)) {
+                node = node_pair(p, AST_RANGE, &at, TOKEN_DOT, node, parse_binary(p, BINARY_LEVEL_TERM));
+                break;
+            }
+            AstNode *field = node_here(p, AST_FIELD);
+            field->a = node;
+            node = field;
+            expect(p, TOKEN_IDENTIFIER, "un nombre después de '.'");
+        } else if (match(p, TOKEN_LPAREN)) {
+            node = node_pair(p, AST_CALL, &at, TOKEN_LPAREN, node, NULL);
+            node->b = parse_expression_list(p, TOKEN_RPAREN, "')' al final de los argumentos");
+        } else {
+            break;
+        }
+    }
+    return node;
+}
+
+/**
+ * @brief Unario -> ('!' | '-' | '+') Unario | Postfijo
+ */
+static AstNode *parse_unary(Parser *p) {
+    if (!enter(p)) {
+        return NULL;
+    }
+    AstNode *node;
+    LexToken at = p->current;
+    if (match(p, TOKEN_BANG) || match(p, TOKEN_MINUS) || match(p, TOKEN_PLUS)) {
+        node = node_pair(p, AST_UNARY, &at, at.type, parse_unary(p), NULL);
+    } else {
+        node = parse_postfix(p);
+    }
+    p->depth--;
+    return node;
+}
+
+/** Número de niveles de operadores binarios. */
+#define BINARY_LEVELS 6
+
+/**
+ * @brief Indica si el token es un operador binario del nivel @p level.
+ *
+ * Niveles de menor a mayor precedencia: '||', '&&', igualdad,
+ * comparación, suma y producto.
+ */
+static int is_binary_operator(TokenType type, int level) {
+    switch (level) {
+        case 0: return type == TOKEN_OR_OR;
+        case 1: return type == TOKEN_AND_AND;
+        case 2: return type == TOKEN_EQUAL_EQUAL || type == TOKEN_BANG_EQUAL;
+        case 3: return type == TOKEN_LESS || type == TOKEN_GREATER
+                    || type == TOKEN_LESS_EQUAL || type == TOKEN_GREATER_EQUAL;
+        case 4: return type == TOKEN_PLUS || type == TOKEN_MINUS;
+        default: return type == TOKEN_STAR || type == TOKEN_SLASH || type == TOKEN_PERCENT;
+    }
+}
+
+/**
+ * @brief LogicoOR, LogicoAND, Igualdad, Comparacion, Term y Factor.
+ *
+ * Todos comparten la forma X -> Y (op Y)*, con Y el nivel siguiente; los
+ * nodos se asocian a la izquierda.
+ */
+static AstNode *parse_binary(Parser *p, int level) {
+    if (level == BINARY_LEVELS) {
+        return parse_unary(p);
+    }
+    AstNode *node = parse_binary(p, level + 1);
+    while (!p->panic && is_binary_operator(p->current.type, level)) {
+        LexToken at = p->current;
+        advance(p);
+        node = node_pair(p, AST_BINARY, &at, at.type, node, parse_binary(p, level + 1));
+    }
+    return node;
+}
+
+/**
+ * @brief Indica si el token es un OperadorAsignacion.
+ */
+static int is_assignment_operator(TokenType type) {
+    return type == TOKEN_EQUAL || type == TOKEN_PLUS_EQUAL || type == TOKEN_MINUS_EQUAL
+        || type == TOKEN_STAR_EQUAL || type == TOKEN_SLASH_EQUAL || type == TOKEN_PERCENT_EQUAL;
+}
+
+/**
+ * @brief Expresion -> Asignacion; Asignacion -> LogicoOR (OperadorAsignacion Asignacion)?
+ *
+ * La asignación es asociativa a la derecha; para reconocerla basta iterar:
+ * cada asignación nueva reemplaza el valor de la anterior.
+ */
+static AstNode *parse_expression(Parser *p) {
+    AstNode *node = parse_binary(p, 0);
+    AstNode *last = NULL;
+    while (!p->panic && is_assignment_operator(p->current.type)) {
+        LexToken at = p->current;
+        advance(p);
+        AstNode *target = last != NULL ? last->b : node;
+        AstNode *assign = node_pair(p, AST_ASSIGN, &at, at.type, target, parse_binary(p, 0));
+        if (last != NULL) {
+            last->b = assign;
+        } else {
+            node = assign;
+        }
+        last = assign;
+    }
+    return node;
+}
+
+/* ---- Sentencias ---- */
+
+/**
+ * @brief LetSentencia -> 'let' MutOpt IDENT AnotacionTipoOpt InicializacionOpt
+ */
+static AstNode *parse_let(Parser *p) {
+    advance(p); // let
+    TokenType mutability = match(p, TOKEN_KW_MUT) ? TOKEN_KW_MUT : TOKEN_KW_LET;
+    AstNode *let = node_here(p, AST_LET);
+    let->op = mutability;
+    if (!expect(p, TOKEN_IDENTIFIER, "el nombre de la variable")) {
+        return let;
+    }
+    if (match(p, TOKEN_COLON)) {
+        let->a = parse_type(p);
+    }
+    if (!p->panic && match(p, TOKEN_EQUAL)) {
+        let->b = parse_expression(p);
+    }
+    return let;
+}
+
+/**
+ * @brief IfSentencia -> 'if' Expresion Bloque ElseOpt
+ */
+static AstNode *parse_if(Parser *p) {
+    AstNode *node = node_here(p, AST_IF);
+    advance(p); // if
+    node->a = parse_expression(p);
+    if (p->panic) {
+        return node;
+    }
+    node->b = parse_block(p);
+    if (!p->panic && match(p, TOKEN_KW_ELSE)) {
+        if (check(p, TOKEN_KW_IF)) {
+            node->c = parse_statement(p);
+        } else {
+            node->c = parse_block(p);
+        }
+    }
+    return node;
+}
+
+/**
+ * @brief MatchBrazo -> MatchPatron '=>' MatchResultado ';'
+ */
+static AstNode *parse_match_arm(Parser *p) {
+    AstNode *arm = node_here(p, AST_MATCH_ARM);
+    switch (p->current.type) {
+        case TOKEN_NUMBER:
+        case TOKEN_STRING:
+        case TOKEN_CHAR:
+        case TOKEN_KW_TRUE:
+        case TOKEN_KW_FALSE:
+        case TOKEN_IDENTIFIER:
+            arm->a = parse_primary(p);
+            break;
+        default:
+            error_expected(p, "un patrón (literal o identificador)");
+            return arm;
+    }
+    if (!expect(p, TOKEN_ARROW, "'=>' después del patrón")) {
+        return arm;
+    }
+    if (check(p, TOKEN_LBRACE)) {
+        arm->b = parse_block(p);
+    } else {
+        arm->b = parse_expression(p);
+    }
+    if (!p->panic) {
+        expect(p, TOKEN_SEMICOLON, "';' al final del brazo");
+    }
+    return arm;
+}
+
+/**
+ * @brief MatchSentencia -> 'match' Expresion '{' ListaMatchBrazos '}'
+ */
+static AstNode *parse_match(Parser *p) {
+    AstNode *node = node_here(p, AST_MATCH);
+    advance(p); // match
+    node->a = parse_expression(p);
+    if (p->panic || !expect(p, TOKEN_LBRACE, "'{' después de la expresión de match")) {
+        return node;
+    }
+    if (check(p, TOKEN_RBRACE)) {
+        error_expected(p, "al menos un brazo en match");
+        p->panic = 0;
+    }
+    AstNode **tail = &node->b;
+    while (!check(p, TOKEN_RBRACE) && !check(p, TOKEN_EOF)) {
+        size_t before = p->consumed;
+        *tail = parse_match_arm(p);
+        tail = &(*tail)->next;
+        recover(p, before);
+    }
+    expect(p, TOKEN_RBRACE, "'}' al final de match");
+    return node;
+}
+
+/**
+ * @brief Consume el ';' que cierra una sentencia simple.
+ */
+static void end_statement(Parser *p) {
+    if (!p->panic) {
+        expect(p, TOKEN_SEMICOLON, "';' al final de la sentencia");
+    }
+}
+
+/**
+ * @brief Sentencia (ver gramatica.md).
+ */
+static AstNode *parse_statement(Parser *p) {
+    if (!enter(p)) {
+        return NULL;
+    }
+    AstNode *node = NULL;
+    switch (p->current.type) {
+        case TOKEN_KW_LET:
+            node = parse_let(p);
+            end_statement(p);
+            break;
+        case TOKEN_KW_IF:
+            node = parse_if(p);
+            break;
+        case TOKEN_KW_WHILE:
+            node = node_here(p, AST_WHILE);
+            advance(p);
+            node->a = parse_expression(p);
+            if (!p->panic) {
+                node->b = parse_block(p);
+            }
+            break;
+        case TOKEN_KW_FOR:
+            advance(p);
+            node = node_here(p, AST_FOR);
+            if (expect(p, TOKEN_IDENTIFIER, "la variable del for")
+                    && expect(p, TOKEN_KW_IN, "'in' después de la variable del for")) {
+                node->a = parse_expression(p);
+                if (!p->panic) {
+                    node->b = parse_block(p);
+                }
+            }
+            break;
+        case TOKEN_KW_LOOP:
+            node = node_here(p, AST_LOOP);
+            advance(p);
+            node->b = parse_block(p);
+            break;
+        case TOKEN_KW_MATCH:
+            node = parse_match(p);
+            break;
+        case TOKEN_LBRACE:
+            node = parse_block(p);
+            break;
+        case TOKEN_KW_RETURN:
+            node = node_here(p, AST_RETURN);
+            advance(p);
+            if (starts_expression(p->current.type)) {
+                node->a = parse_expression(p);
+            }
+            end_statement(p);
+            break;
+        case TOKEN_KW_BREAK:
+        case TOKEN_KW_CONTINUE:
+            node = node_here(p, check(p, TOKEN_KW_BREAK) ? AST_BREAK : AST_CONTINUE);
+            advance(p);
+            end_statement(p);
+            break;
+        default:
+            if (starts_expression(p->current.type)) {
+                node = node_here(p, AST_EXPR_STMT);
+                node->a = parse_expression(p);
+                end_statement(p);
+            } else {
+                error_expected(p, "una sentencia");
+            }
+            break;
+    }
+    p->depth--;
+    return node;
+}
+
+/**
+ * @brief Bloque -> '{' ListaSentencias '}'
+ *
+ * Los errores dentro del bloque se recuperan aquí, de modo que un error en
+ * una sentencia no afecta a las siguientes.
+ */
+static AstNode *parse_block(Parser *p) {
+    AstNode *block = node_here(p, AST_BLOCK);
+    if (!expect(p, TOKEN_LBRACE, "'{'")) {
+        return block;
+    }
+    AstNode **tail = &block->a;
+    while (!check(p, TOKEN_RBRACE) && !check(p, TOKEN_EOF)) {
+        size_t before = p->consumed;
+        AstNode *statement = parse_statement(p);
+        if (statement != NULL) {
+            *tail = statement;
+            tail = &statement->next;
+        }
+        recover(p, before);
+    }
+    expect(p, TOKEN_RBRACE, "'}' al final del bloque");
+    return block;
+}
+
+/**
+ * @brief Item -> Funcion | Sentencia
+ *
+ * Al volver, el parser queda sin estado pendiente (ni modo pánico ni
+ * anidamiento), listo para el item siguiente.
+ *
+ * @return El item, o NULL si no produjo nodo (por ejemplo, un '}' sobrante).
+ */
+static AstNode *parse_item(Parser *p) {
+    size_t before = p->consumed;
+    if (check(p, TOKEN_RBRACE)) {
+        error_expected(p, "una función o sentencia ('}' sin '{' correspondiente)");
+        p->panic = 0;
+        advance(p);
+        return NULL;
+    }
+    p->item = NULL;
+    AstNode *item = check(p, TOKEN_KW_FN) ? parse_function(p) : parse_statement(p);
+    recover(p, before);
+    return item;
+}
+
+/**
+ * @brief Programa -> ListaItems EOF
+ *
+ * Al analizar un fragmento de buffer, se detiene además al empezar un item
+ * en p->stop o después.
+ */
+static AstNode *parse_program(Parser *p) {
+    AstNode *program = node_here(p, AST_PROGRAM);
+    AstNode **tail = &program->a;
+    while (!check(p, TOKEN_EOF) && p->position < p->stop) {
+        AstNode *item = parse_item(p);
+        if (item != NULL) {
+            *tail = item;
+            tail = &item->next;
+        }
+    }
+    return program;
+}
+
+/**
+ * @brief Análisis en serie desde un TokenStream, con o sin AST.
+ */
+static int parse_serial(const char *source, unsigned lexer_flags, DiagEngine *diag, Arena *arena,
+                        AstNode **program, ParseResult *result) {
+    // Sin motor, uno de capacidad 0 cuenta los errores léxicos sin guardarlos;
+    // como nadie verá sus posiciones, el lexer puede omitirlas.
+    DiagEngine counter;
+    memset(&counter, 0, sizeof(counter));
+    if (diag == NULL) {
+        diag = &counter;
+        if (arena == NULL) {
+            lexer_flags |= LEXER_NO_POSITIONS;
+        }
+    }
+    Parser p;
+    memset(&p, 0, sizeof(p));
+    p.stop = SIZE_MAX;
+    lexer_init(&p.lexer, source);
+    lexer_set_flags(&p.lexer, lexer_flags);
+    lexer_set_diagnostics(&p.lexer, diag);
+    p.source = source;
+    p.diag = diag;
+    p.arena = arena;
+    size_t diag_errors = diag->errors;
+
+    uint64_t start = stats_clock();
+    token_stream_init(&p.stream, &p.lexer);
+    load_current(&p);
+    AstNode *root = parse_program(&p);
+    uint64_t stall_ns = p.stream.stall_ns;
+    token_stream_destroy(&p.stream);
+    stats_phase_add(STATS_PARSE, stats_clock() - start - stall_ns);
+
+    size_t lexical = diag->errors - diag_errors - p.errors;
+    if (result != NULL) {
+        result->tokens = p.tokens;
+        result->lexical_errors = lexical;
+        result->syntax_errors = p.errors;
+    }
+    if (program != NULL) {
+        *program = p.out_of_memory ? NULL : root;
+    }
+    return (lexical > 0 || p.errors > 0 || p.out_of_memory) ? 1 : 0;
+}
+
+/**
+ * @brief Analiza sintácticamente un código fuente completo.
+ *
+ * Los errores léxicos y sintácticos se registran en @p diag ordenados por
+ * posición. Con LEXER_THREADED en @p lexer_flags, los fuentes grandes se
+ * lexean en un hilo aparte mientras se analizan.
+ *
+ * @param source El código fuente terminado en '\0'.
+ * @param lexer_flags Opciones del lexer (LEXER_*).
+ * @param diag Motor de diagnósticos, o NULL para solo contarlos.
+ * @param result Destino de los contadores (puede ser NULL).
+ * @return 0 si no hubo errores, 1 en caso contrario.
+ */
+int parse_source(const char *source, unsigned lexer_flags, DiagEngine *diag, ParseResult *result) {
+    return parse_serial(source, lexer_flags, diag, NULL, NULL, result);
+}
+
+/**
+ * @brief Analiza un código fuente y construye su AST.
+ *
+ * Igual que parse_source(), pero los nodos se reservan en @p arena. Con
+ * errores el árbol queda incompleto (hijos NULL donde faltaba algo) y no
+ * debe pasarse a las fases siguientes.
+ *
+ * @param source El código fuente terminado en '\0'.
+ * @param lexer_flags Opciones del lexer (LEXER_*).
+ * @param diag Motor de diagnósticos, o NULL para solo contarlos.
+ * @param arena Arena donde reservar los nodos; vive tanto como el AST.
+ * @param program Destino de la raíz (AST_PROGRAM), o NULL si faltó memoria.
+ * @param result Destino de los contadores (puede ser NULL).
+ * @return 0 si no hubo errores, 1 en caso contrario (o si faltó memoria).
+ */
+int parse_source_ast(const char *source, unsigned lexer_flags, DiagEngine *diag, Arena *arena,
+                     AstNode **program, ParseResult *result) {
+    return parse_serial(source, lexer_flags, diag, arena, program, result);
+}
+
+/**
+ * @brief Construye el AST a partir de tokens ya lexeados.
+ *
+ * Sirve para analizar una secuencia armada con tokens del fuente (por
+ * ejemplo, solo las firmas de algunas funciones en la compilación
+ * incremental): las posiciones y los lexemas siguen siendo los de
+ * @p source. Los tokens no reconocidos se omiten, como en el análisis en
+ * serie, pero sus errores léxicos no se cuentan.
+ *
+ * @param source El código fuente de los tokens.
+ * @param tokens Tokens terminados en TOKEN_EOF.
+ * @param diag Motor de diagnósticos, o NULL para solo contarlos.
+ * @param arena Arena donde reservar los nodos.
+ * @param program Destino de la raíz (AST_PROGRAM), o NULL si faltó memoria.
+ * @return 0 si no hubo errores sintácticos, 1 en caso contrario (o si faltó memoria).
+ */
+int parse_tokens_ast(const char *source, const LexToken *tokens, DiagEngine *diag, Arena *arena,
+                     AstNode **program) {
+    Parser p;
+    memset(&p, 0, sizeof(p));
+    p.stop = SIZE_MAX;
+    p.source = source;
+    p.diag = diag;
+    p.arena = arena;
+    p.buffer = tokens;
+    uint64_t start = stats_clock();
+    load_current(&p);
+    AstNode *root = parse_program(&p);
+    stats_phase_add(STATS_PARSE, stats_clock() - start);
+    *program = p.out_of_memory ? NULL : root;
+    return (p.errors > 0 || p.out_of_memory) ? 1 : 0;
+}
+
+/**
+ * @brief Analiza items de nivel superior desde una posición del fuente.
+ *
+ * Lexea desde @p start (el inicio de un token, o el del fuente) y analiza
+ * un item tras otro como parse_source_ast(), sin crear el nodo AST_PROGRAM.
+ * Antes de cada item, @p stop decide si terminar en su primer token; el
+ * análisis termina también en el fin del archivo. Lo usa el análisis
+ * incremental (reparse.h) para analizar solo los items tocados por una
+ * edición: al empezar un item el parser no arrastra estado, así que el
+ * resultado es el mismo que en un análisis completo.
+ *
+ * @param source El código fuente terminado en '\0'.
+ * @param start Posición donde empezar a lexear (offset, line y column).
+ * @param lexer_flags Opciones del lexer (LEXER_*; LEXER_THREADED se ignora).
+ * @param lexical Destino de los errores léxicos, que pueden llegar un poco
+ *                más allá de @p end porque el lexer se adelanta al parser.
+ * @param syntax Destino de los errores sintácticos (ver ParseItem.diagnostics).
+ * @param arena Arena donde reservar los nodos.
+ * @param stop Criterio de parada, o NULL para llegar al fin del archivo.
+ * @param context Dato de @p stop.
+ * @param items Destino de los items en orden (liberar con free()).
+ * @param count Destino del número de items.
+ * @param end Destino del token donde se detuvo (TOKEN_EOF o el elegido por @p stop).
+ * @param unclosed Destino del desplazamiento del primer comentario o cadena
+ *                 sin cierre que vio el lexer, o SIZE_MAX. Su recuperación
+ *                 depende del resto del archivo (ver lexer.c).
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int parse_items(const char *source, const LexToken *start, unsigned lexer_flags, DiagEngine *lexical,
+                DiagEngine *syntax, Arena *arena, ParseStopFn stop, void *context,
+                ParseItem **items, size_t *count, LexToken *end, size_t *unclosed) {
+    Parser p;
+    memset(&p, 0, sizeof(p));
+    p.stop = SIZE_MAX;
+    lexer_init(&p.lexer, source);
+    lexer_set_flags(&p.lexer, lexer_flags & ~LEXER_THREADED);
+    lexer_set_diagnostics(&p.lexer, lexical);
+    lexer_seek(&p.lexer, start->offset, start->line, start->column);
+    p.source = source;
+    p.diag = syntax;
+    p.arena = arena;
+
+    uint64_t start_ns = stats_clock();
+    size_t capacity = 16;
+    size_t n = 0;
+    ParseItem *list = (ParseItem *)malloc(capacity * sizeof(ParseItem));
+    token_stream_init(&p.stream, &p.lexer);
+    load_current(&p);
+    while (list != NULL && !check(&p, TOKEN_EOF) && (stop == NULL || !stop(context, &p.current))) {
+        if (n == capacity) {
+            capacity *= 2;
+            ParseItem *grown = (ParseItem *)realloc(list, capacity * sizeof(ParseItem));
+            if (grown == NULL) {
+                free(list);
+                list = NULL;
+                break;
+            }
+            list = grown;
+        }
+        ParseItem *item = &list[n++];
+        item->offset = p.current.offset;
+        item->length = p.current.length;
+        item->line = p.current.line;
+        item->column = p.current.column;
+        item->node = parse_item(&p);
+        item->diagnostics = syntax->count;
+    }
+    *end = p.current;
+    *unclosed = SIZE_MAX;
+    if (p.lexer.unclosed_string != NULL) {
+        *unclosed = (size_t)(p.lexer.unclosed_string - source);
+    }
+    if (p.lexer.unclosed_comment != NULL && (size_t)(p.lexer.unclosed_comment - source) < *unclosed) {
+        *unclosed = (size_t)(p.lexer.unclosed_comment - source);
+    }
+    uint64_t stall_ns = p.stream.stall_ns;
+    token_stream_destroy(&p.stream);
+    stats_phase_add(STATS_PARSE, stats_clock() - start_ns - stall_ns);
+
+    if (list == NULL || p.out_of_memory) {
+        free(list);
+        return 1;
+    }
+    *items = list;
+    *count = n;
+    return 0;
+}
+
+/* ---- Análisis en paralelo ---- */
+
+/**
+ * @brief Fragmento de items de nivel superior consecutivos.
+ */
+typedef struct ParseChunk {
+    size_t start;           /**< Índice del primer token */
+    size_t stop;            /**< Índice del primer token del fragmento siguiente */
+    size_t worker;          /**< Hilo que lo analizó */
+    size_t diag_first;      /**< Sus diagnósticos en el motor del hilo */
+    size_t diag_count;
+    size_t errors;          /**< Errores sintácticos */
+    int overran;            /**< 1 si un item cruzó el límite del fragmento */
+    int out_of_memory;      /**< 1 si la arena del hilo no pudo reservar un nodo */
+    AstNode *program;       /**< Nodo AST_PROGRAM del fragmento, con sus items (solo con AST) */
+    AstNode *last;          /**< Su último item, o NULL si no tiene */
+} ParseChunk;
+
+/**
+ * @brief Estado compartido por los hilos del análisis en paralelo.
+ */
+typedef struct ParallelParse {
+    const char *source;
+    const LexToken *tokens;
+    size_t token_count;
+    ParseChunk *chunks;
+    size_t chunk_count;
+    atomic_size_t next;     /**< Siguiente fragmento sin asignar */
+    DiagEngine *diags;      /**< Un motor por hilo */
+    Arena *arenas;          /**< Una arena por hilo, o NULL para no construir el AST */
+    size_t block_size;      /**< Bloque de las arenas (el de la arena de destino) */
+} ParallelParse;
+
+/**
+ * @brief Argumento de cada hilo.
+ */
+typedef struct ParseWorker {
+    ParallelParse *shared;
+    size_t index;
+} ParseWorker;
+
+/**
+ * @brief Lexea todo el fuente a un arreglo terminado en EOF.
+ *
+ * @return El arreglo (liberar con free()), o NULL si falta memoria.
+ */
+static LexToken *lex_all(Lexer *lexer, size_t *count) {
+    size_t capacity = 4096;
+    size_t n = 0;
+    LexToken *tokens = (LexToken *)malloc(capacity * sizeof(LexToken));
+    while (tokens != NULL) {
+        if (capacity - n < TOKEN_STREAM_BATCH) {
+            capacity *= 2;
+            LexToken *grown = (LexToken *)realloc(tokens, capacity * sizeof(LexToken));
+            if (grown == NULL) {
+                free(tokens);
+                return NULL;
+            }
+            tokens = grown;
+        }
+        size_t made = lexer_next_batch(lexer, &tokens[n], TOKEN_STREAM_BATCH);
+        if (made == 0) {
+            memset(&tokens[n], 0, sizeof(LexToken));
+            tokens[n].type = TOKEN_EOF;
+            made = 1;
+        }
+        n += made;
+        if (tokens[n - 1].type == TOKEN_EOF) {
+            *count = n;
+            return tokens;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Lexea un fuente completo a un arreglo de tokens terminado en TOKEN_EOF.
+ *
+ * @param source El código fuente terminado en '\0'.
+ * @param lexer_flags Opciones del lexer (LEXER_*; LEXER_THREADED se ignora).
+ * @param diag Destino de los errores léxicos, o NULL.
+ * @param count Destino del número de tokens, incluido el EOF.
+ * @return El arreglo (liberar con free()), o NULL si falta memoria.
+ */
+LexToken *parse_lex_tokens(const char *source, unsigned lexer_flags, DiagEngine *diag, size_t *count) {
+    uint64_t start = stats_clock();
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    lexer_set_flags(&lexer, lexer_flags & ~LEXER_THREADED);
+    lexer_set_diagnostics(&lexer, diag);
+    LexToken *tokens = lex_all(&lexer, count);
+    stats_phase_add(STATS_LEX, stats_clock() - start);
+    return tokens;
+}
+
+/**
+ * @brief Reparte los tokens en fragmentos de al menos PARSER_CHUNK_TOKENS.
+ *
+ * Un fragmento solo puede empezar en un 'fn' con todas las llaves anteriores
+ * cerradas: ahí el parser serie empieza un item nuevo sin estado pendiente
+ * (ni modo pánico ni anidamiento). Las llaves se cuentan como el parser, sin
+ * bajar de 0 con un '}' sobrante; si el parser ve menos llaves abiertas (por
+ * ejemplo, al descartar un '{' en modo pánico) no hay corte, y el caso
+ * contrario lo detecta ParseChunk.overran.
+ *
+ * @return Número de fragmentos, o 0 si falta memoria.
+ */
+static size_t split_chunks(const LexToken *tokens, size_t count, ParseChunk **chunks) {
+    size_t capacity = count / PARSER_CHUNK_TOKENS + 1;
+    ParseChunk *list = (ParseChunk *)calloc(capacity, sizeof(ParseChunk));
+    if (list == NULL) {
+        return 0;
+    }
+    size_t n = 1;
+    size_t depth = 0;
+    for (size_t i = 0; i < count; i++) {
+        switch (tokens[i].type) {
+            case TOKEN_LBRACE:
+                depth++;
+                break;
+            case TOKEN_RBRACE:
+                depth -= depth > 0;
+                break;
+            case TOKEN_KW_FN:
+                if (depth == 0 && i - list[n - 1].start >= PARSER_CHUNK_TOKENS && n < capacity) {
+                    list[n - 1].stop = i;
+                    list[n++].start = i;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    list[n - 1].stop = count;
+    *chunks = list;
+    return n;
+}
+
+/**
+ * @brief Analiza un fragmento con el motor de diagnósticos y la arena de su hilo.
+ */
+static void parse_chunk(ParallelParse *shared, ParseChunk *chunk, DiagEngine *diag, Arena *arena) {
+    Parser p;
+    memset(&p, 0, sizeof(p));
+    p.source = shared->source;
+    p.diag = diag;
+    p.arena = arena;
+    p.buffer = shared->tokens;
+    p.position = chunk->start;
+    p.stop = chunk->stop;
+    chunk->diag_first = diag->count;
+    load_current(&p);
+    AstNode *program = parse_program(&p);
+    if (arena != NULL) {
+        chunk->program = program;
+        for (AstNode *item = program->a; item != NULL; item = item->next) {
+            chunk->last = item;
+        }
+    }
+    chunk->diag_count = diag->count - chunk->diag_first;
+    chunk->errors = p.errors;
+    chunk->out_of_memory = p.out_of_memory;
+    // Salvo el último, cada fragmento debe acabar justo antes del 'fn' siguiente.
+    chunk->overran = chunk->stop < shared->token_count && p.position != chunk->stop;
+}
+
+/**
+ * @brief Toma fragmentos hasta que no quede ninguno.
+ */
+static void *parse_worker(void *arg) {
+    ParseWorker *worker = (ParseWorker *)arg;
+    ParallelParse *shared = worker->shared;
+    for (;;) {
+        size_t index = atomic_fetch_add(&shared->next, 1);
+        if (index >= shared->chunk_count) {
+            return NULL;
+        }
+        shared->chunks[index].worker = worker->index;
+        parse_chunk(shared, &shared->chunks[index], &shared->diags[worker->index],
+                    shared->arenas != NULL ? &shared->arenas[worker->index] : NULL);
+    }
+}
+
+/**
+ * @brief Resuelve el número de hilos: el pedido, o los núcleos disponibles.
+ */
+static size_t parse_thread_count(int requested) {
+    long n = requested > 0 ? requested : sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 1 ? (size_t)n : 1;
+}
+
+/**
+ * @brief Analiza los fragmentos con @p threads hilos (incluido el actual).
+ *
+ * @param build 1 para construir el AST en una arena por hilo.
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int run_chunks(ParallelParse *shared, size_t threads, size_t diag_capacity, int build) {
+    ParseWorker *workers = (ParseWorker *)calloc(threads, sizeof(ParseWorker));
+    pthread_t *ids = (pthread_t *)calloc(threads, sizeof(pthread_t));
+    shared->diags = (DiagEngine *)calloc(threads, sizeof(DiagEngine));
+    shared->arenas = build ? (Arena *)calloc(threads, sizeof(Arena)) : NULL;
+    int failed = workers == NULL || ids == NULL || shared->diags == NULL || (build && shared->arenas == NULL);
+    for (size_t t = 0; !failed && t < threads; t++) {
+        // Con un motor que solo cuenta, los de los hilos también solo cuentan.
+        failed = diag_capacity > 0 && diag_init(&shared->diags[t], diag_capacity) != 0;
+        if (build) {
+            arena_init(&shared->arenas[t], shared->block_size);
+        }
+    }
+    atomic_init(&shared->next, 0);
+
+    size_t started = 0;
+    for (size_t t = 1; !failed && t < threads; t++) {
+        workers[t].shared = shared;
+        workers[t].index = t;
+        if (pthread_create(&ids[t], NULL, parse_worker, &workers[t]) != 0) {
+            break;
+        }
+        started = t;
+    }
+    if (!failed) {
+        workers[0].shared = shared;
+        parse_worker(&workers[0]);
+    }
+    for (size_t t = 1; t <= started; t++) {
+        pthread_join(ids[t], NULL);
+    }
+    free(workers);
+    free(ids);
+    return failed;
+}
+
+/**
+ * @brief Libera los motores y las arenas de los hilos.
+ */
+static void free_workers(ParallelParse *shared, size_t threads) {
+    if (shared->diags != NULL) {
+        for (size_t t = 0; t < threads; t++) {
+            diag_free(&shared->diags[t]);
+        }
+        free(shared->diags);
+    }
+    if (shared->arenas != NULL) {
+        for (size_t t = 0; t < threads; t++) {
+            arena_free(&shared->arenas[t]);
+        }
+        free(shared->arenas);
+    }
+}
+
+/**
+ * @brief Pasa los nodos de los hilos a @p arena y encadena los items de los fragmentos.
+ *
+ * @return La raíz (AST_PROGRAM) del primer fragmento, con todos los items.
+ */
+static AstNode *splice_chunks(ParallelParse *shared, size_t threads, Arena *arena) {
+    for (size_t t = 0; t < threads; t++) {
+        arena_adopt(arena, &shared->arenas[t]);
+    }
+    AstNode *program = shared->chunks[0].program;
+    AstNode **tail = shared->chunks[0].last != NULL ? &shared->chunks[0].last->next : &program->a;
+    for (size_t c = 1; c < shared->chunk_count; c++) {
+        const ParseChunk *chunk = &shared->chunks[c];
+        if (chunk->last != NULL) {
+            *tail = chunk->program->a;
+            tail = &chunk->last->next;
+        }
+    }
+    return program;
+}
+
+/**
+ * @brief Análisis en paralelo, con o sin AST; en serie si no conviene.
+ */
+static int parse_parallel(const char *source, unsigned lexer_flags, int threads, DiagEngine *diag,
+                          Arena *arena, AstNode **program, ParseResult *result) {
+    size_t wanted = parse_thread_count(threads);
+    if (wanted < 2 || strlen(source) < PARSER_PARALLEL_MIN_BYTES) {
+        return parse_serial(source, lexer_flags, diag, arena, program, result);
+    }
+    DiagEngine counter;
+    memset(&counter, 0, sizeof(counter));
+    DiagEngine *target = diag;
+    if (target == NULL) {
+        target = &counter;
+        if (arena == NULL) {
+            lexer_flags |= LEXER_NO_POSITIONS;
+        }
+    }
+    DiagEngine lexer_diag;
+    memset(&lexer_diag, 0, sizeof(lexer_diag));
+    if (target->capacity > 0 && diag_init(&lexer_diag, target->capacity) != 0) {
+        return parse_serial(source, lexer_flags, diag, arena, program, result);
+    }
+
+    uint64_t start = stats_clock();
+    Lexer lexer;
+    lexer_init(&lexer, source);
+    lexer_set_flags(&lexer, lexer_flags & ~LEXER_THREADED);
+    lexer_set_diagnostics(&lexer, &lexer_diag);
+    size_t count = 0;
+    LexToken *tokens = lex_all(&lexer, &count);
+    uint64_t lex_ns = stats_clock() - start;
+
+    start = stats_clock();
+    ParallelParse shared;
+    memset(&shared, 0, sizeof(shared));
+    shared.source = source;
+    shared.tokens = tokens;
+    shared.token_count = count;
+    shared.block_size = arena != NULL ? arena->block_size : 0;
+    shared.chunk_count = tokens != NULL ? split_chunks(tokens, count, &shared.chunks) : 0;
+    size_t workers = wanted < shared.chunk_count ? wanted : shared.chunk_count;
+    int serial = shared.chunk_count < 2 || run_chunks(&shared, workers, target->capacity, arena != NULL) != 0;
+    for (size_t c = 0; !serial && c < shared.chunk_count; c++) {
+        const ParseChunk *chunk = &shared.chunks[c];
+        serial = chunk->overran || chunk->out_of_memory
+              || (target->capacity > 0 && shared.diags[chunk->worker].dropped > 0);
+    }
+
+    size_t syntax = 0;
+    if (!serial) {
+        // Los fragmentos están en orden de fuente, y sus diagnósticos también.
+        for (size_t c = 0; c < shared.chunk_count; c++) {
+            const ParseChunk *chunk = &shared.chunks[c];
+            const DiagEngine *from = &shared.diags[chunk->worker];
+            for (size_t i = chunk->diag_first; i < chunk->diag_first + chunk->diag_count; i++) {
+                const Diagnostic *item = &from->items[i];
+                diag_report(target, item->severity, item->span, "%s", from->text + item->message);
+            }
+            if (target->capacity == 0) {
+                target->errors += chunk->errors;
+                target->dropped += chunk->errors;
+            }
+            syntax += chunk->errors;
+        }
+        diag_merge(target, &lexer_diag);
+        if (arena != NULL) {
+            *program = splice_chunks(&shared, workers, arena);
+        }
+        stats_phase_add(STATS_LEX, lex_ns);
+        stats_phase_add(STATS_PARSE, stats_clock() - start);
+    }
+    free_workers(&shared, workers);
+    free(shared.chunks);
+    free(tokens);
+    size_t lexical = lexer_diag.errors;
+    diag_free(&lexer_diag);
+    if (serial) {
+        return parse_serial(source, lexer_flags, diag, arena, program, result);
+    }
+
+    if (result != NULL) {
+        result->tokens = count;
+        result->lexical_errors = lexical;
+        result->syntax_errors = syntax;
+    }
+    return (lexical > 0 || syntax > 0) ? 1 : 0;
+}
+
+/**
+ * @brief Analiza sintácticamente un fuente repartiendo sus funciones entre hilos.
+ *
+ * El resultado (contadores y diagnósticos, en el mismo orden) es idéntico al
+ * de parse_source(). Los fuentes menores que PARSER_PARALLEL_MIN_BYTES, los
+ * que no se pueden partir y aquellos en los que un fragmento cruza su límite
+ * (solo ocurre con errores que desequilibran las llaves) se analizan en serie.
+ * Si algún motor se llena se conservan, como con LEXER_THREADED, los primeros
+ * diagnósticos por posición.
+ *
+ * @param source El código fuente terminado en '\0'.
+ * @param lexer_flags Opciones del lexer (LEXER_*; LEXER_THREADED se ignora).
+ * @param threads Hilos a usar, o 0 para usar los núcleos disponibles.
+ * @param diag Motor de diagnósticos, o NULL para solo contarlos.
+ * @param result Destino de los contadores (puede ser NULL).
+ * @return 0 si no hubo errores, 1 en caso contrario.
+ */
+int parse_source_parallel(const char *source, unsigned lexer_flags, int threads,
+                          DiagEngine *diag, ParseResult *result) {
+    return parse_parallel(source, lexer_flags, threads, diag, NULL, NULL, result);
+}
+
+/**
+ * @brief Analiza un fuente repartiendo sus funciones entre hilos y construye su AST.
+ *
+ * Igual que parse_source_parallel(), y el árbol es el mismo que el de
+ * parse_source_ast(): cada hilo reserva sus nodos en una arena propia que
+ * al terminar pasa a @p arena (arena_adopt()), y las listas de items de
+ * los fragmentos se encadenan en orden de fuente.
+ *
+ * @param source El código fuente terminado en '\0'.
+ * @param lexer_flags Opciones del lexer (LEXER_*; LEXER_THREADED se ignora).
+ * @param threads Hilos a usar, o 0 para usar los núcleos disponibles.
+ * @param diag Motor de diagnósticos, o NULL para solo contarlos.
+ * @param arena Arena donde quedan los nodos; vive tanto como el AST.
+ * @param program Destino de la raíz (AST_PROGRAM), o NULL si faltó memoria.
+ * @param result Destino de los contadores (puede ser NULL).
+ * @return 0 si no hubo errores, 1 en caso contrario (o si faltó memoria).
+ */
+int parse_source_ast_parallel(const char *source, unsigned lexer_flags, int threads, DiagEngine *diag,
+                              Arena *arena, AstNode **program, ParseResult *result) {
+    return parse_parallel(source, lexer_flags, threads, diag, arena, program, result);
+}
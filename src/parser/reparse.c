@@ -0,0 +1,490 @@
+/**
+ * @file reparse.c
+ * @brief Análisis sintáctico incremental por items de nivel superior.
+ *
+ * Una edición se traduce en un tramo de items: desde el último item que
+ * empieza antes de ella hasta el primero posterior cuyo primer token cae
+ * en la misma posición que antes (desplazada) y en la misma columna. Ese
+ * token es un punto de resincronización: el lexer produce desde ahí los
+ * mismos tokens y el parser empieza el item sin estado pendiente, así que
+ * el resto del documento no cambia. El tramo se analiza con parse_items();
+ * los items siguientes solo desplazan su raíz.
+ *
+ * La excepción son los comentarios y cadenas sin cierre: su recuperación
+ * depende del resto del archivo, de modo que una edición posterior a uno
+ * de ellos analiza el documento completo.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/reparse.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Criterio de parada de parse_items(): el primer item reutilizable.
+ */
+typedef struct ReparseStop {
+    const ParseItem *items;     /**< Items antes de la edición */
+    size_t count;
+    size_t next;                /**< Primer item que aún puede reutilizarse */
+    uint32_t edited_end;        /**< Fin del texto insertado */
+    int64_t shift;              /**< Bytes que se desplazan los items posteriores */
+    int64_t lines;              /**< Líneas que se desplazan los items posteriores */
+} ReparseStop;
+
+/**
+ * @brief Indica si @p token empieza un item anterior a la edición con sus mismos tokens.
+ */
+static int stop_at_reused(void *context, const LexToken *token) {
+    ReparseStop *stop = (ReparseStop *)context;
+    if (token->offset < stop->edited_end) {
+        return 0;
+    }
+    while (stop->next < stop->count
+            && (int64_t)stop->items[stop->next].offset + stop->shift < (int64_t)token->offset) {
+        stop->next++;
+    }
+    if (stop->next == stop->count) {
+        return 0;
+    }
+    const ParseItem *old = &stop->items[stop->next];
+    return (int64_t)old->offset + stop->shift == (int64_t)token->offset
+        && (int64_t)old->line + stop->lines == (int64_t)token->line
+        && old->column == token->column;
+}
+
+/**
+ * @brief Indica si la posición (@p line, @p column) va antes que @p token.
+ */
+static int before(size_t line, size_t column, const LexToken *token) {
+    return line < token->line || (line == token->line && column < token->column);
+}
+
+/**
+ * @brief Nodos de un item (sin contar los items que le siguen).
+ */
+static size_t count_nodes(const AstNode *node) {
+    size_t count = 1;
+    const AstNode *children[3] = { node->a, node->b, node->c };
+    for (size_t i = 0; i < 3; i++) {
+        for (const AstNode *child = children[i]; child != NULL; child = child->next) {
+            count += count_nodes(child);
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Libera los mensajes de @p count diagnósticos.
+ */
+static void free_messages(ReparseDiag *diags, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        free(diags[i].message);
+    }
+}
+
+/**
+ * @brief Copia un diagnóstico de @p engine.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int copy_diag(ReparseDiag *to, const DiagEngine *engine, size_t index, size_t item) {
+    const Diagnostic *from = &engine->items[index];
+    to->severity = from->severity;
+    to->span = from->span;
+    to->item = item;
+    to->message = strdup(engine->text + from->message);
+    return to->message == NULL;
+}
+
+/**
+ * @brief Ajusta el nodo raíz a la posición del primer item (o del fin del archivo).
+ */
+static void link_program(ReparseDocument *doc, size_t first, size_t last) {
+    AstNode **tail = &doc->program.a;
+    for (size_t i = first; i-- > 0;) {
+        if (doc->items[i].node != NULL) {
+            tail = &doc->items[i].node->next;
+            break;
+        }
+    }
+    *tail = NULL;
+    for (size_t i = first; i < doc->item_count; i++) {
+        AstNode *node = doc->items[i].node;
+        if (node != NULL) {
+            *tail = node;
+            tail = &node->next;
+            if (i >= last) {
+                break;
+            }
+        }
+    }
+    const LexToken *eof = &doc->eof;
+    doc->program.offset = doc->item_count > 0 ? doc->items[0].offset : eof->offset;
+    doc->program.length = doc->item_count > 0 ? doc->items[0].length : eof->length;
+    doc->program.line = doc->item_count > 0 ? doc->items[0].line : eof->line;
+    doc->program.column = doc->item_count > 0 ? doc->items[0].column : eof->column;
+}
+
+/**
+ * @brief Analiza un tramo desde @p start y reemplaza con él los items desde
+ *        @p first hasta el primero reutilizable según @p stop.
+ *
+ * Los items reutilizados, sus diagnósticos y el fin del archivo se
+ * desplazan @p shift bytes y @p lines líneas.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int replace_items(ReparseDocument *doc, const LexToken *start, size_t first, ReparseStop *stop,
+                         int64_t shift, int64_t lines, ReparseReport *report) {
+    DiagEngine lexical;
+    DiagEngine syntax;
+    if (diag_init(&lexical, 0) != 0) {
+        return 1;
+    }
+    if (diag_init(&syntax, 0) != 0) {
+        diag_free(&lexical);
+        return 1;
+    }
+    ParseItem *region = NULL;
+    size_t count = 0;
+    LexToken end;
+    size_t unclosed = SIZE_MAX;
+    int failed = parse_items(doc->source, start, doc->lexer_flags, &lexical, &syntax, &doc->arena,
+                             stop_at_reused, stop, &region, &count, &end, &unclosed);
+    size_t last = end.type == TOKEN_EOF ? doc->item_count : stop->next;
+    size_t total = doc->item_count - (last - first) + count;
+    ReparseDiag *lexical_list = NULL;
+    ReparseDiag *syntax_list = NULL;
+    if (!failed && total > doc->item_capacity) {
+        size_t capacity = doc->item_capacity > 0 ? doc->item_capacity : 16;
+        while (capacity < total) {
+            capacity *= 2;
+        }
+        ParseItem *grown = (ParseItem *)realloc(doc->items, capacity * sizeof(ParseItem));
+        failed = grown == NULL;
+        if (grown != NULL) {
+            doc->items = grown;
+            doc->item_capacity = capacity;
+        }
+    }
+    if (!failed) {
+        lexical_list = (ReparseDiag *)malloc((doc->lexical_count + lexical.count + 1) * sizeof(ReparseDiag));
+        syntax_list = (ReparseDiag *)malloc((doc->syntax_count + syntax.count + 1) * sizeof(ReparseDiag));
+        failed = lexical_list == NULL || syntax_list == NULL;
+    }
+    if (failed) {
+        free(lexical_list);
+        free(syntax_list);
+        free(region);
+        diag_free(&lexical);
+        diag_free(&syntax);
+        return 1;
+    }
+
+    // Diagnósticos: los del tramo reemplazan a los de sus items y a los
+    // léxicos entre su inicio y el primer item reutilizado.
+    LexToken resume = { TOKEN_EOF, 0, 0, UINT32_MAX, UINT32_MAX };
+    if (last < doc->item_count) {
+        resume.offset = doc->items[last].offset;
+        resume.line = doc->items[last].line;
+        resume.column = doc->items[last].column;
+    }
+    size_t n = 0;
+    size_t kept = 0;
+    for (; kept < doc->lexical_count && before(doc->lexical[kept].span.line, doc->lexical[kept].span.column,
+                                               start); kept++) {
+        lexical_list[n++] = doc->lexical[kept];
+    }
+    for (size_t i = 0; i < lexical.count && !failed; i++) {
+        const Diagnostic *d = &lexical.items[i];
+        if (end.type != TOKEN_EOF && !before(d->span.line, d->span.column, &end)) {
+            break;
+        }
+        failed = copy_diag(&lexical_list[n], &lexical, i, 0);
+        n += !failed;
+    }
+    for (size_t i = kept; i < doc->lexical_count; i++) {
+        ReparseDiag *d = &doc->lexical[i];
+        if (before(d->span.line, d->span.column, &resume)) {
+            free(d->message);
+        } else {
+            lexical_list[n] = *d;
+            lexical_list[n++].span.line = (size_t)((int64_t)d->span.line + lines);
+        }
+    }
+    free(doc->lexical);
+    doc->lexical = lexical_list;
+    doc->lexical_count = n;
+
+    n = 0;
+    for (size_t i = 0; i < doc->syntax_count; i++) {
+        ReparseDiag *d = &doc->syntax[i];
+        if (d->item < first) {
+            syntax_list[n++] = *d;
+        }
+    }
+    size_t index = 0;
+    for (size_t i = 0; i < count && !failed; i++) {
+        for (; index < region[i].diagnostics && !failed; index++) {
+            failed = copy_diag(&syntax_list[n], &syntax, index, first + i);
+            n += !failed;
+        }
+    }
+    for (size_t i = 0; i < doc->syntax_count; i++) {
+        ReparseDiag *d = &doc->syntax[i];
+        if (d->item >= last) {
+            syntax_list[n] = *d;
+            syntax_list[n].item = d->item - (last - first) + count;
+            syntax_list[n++].span.line = (size_t)((int64_t)d->span.line + lines);
+        } else if (d->item >= first) {
+            free(d->message);
+        }
+    }
+    free(doc->syntax);
+    doc->syntax = syntax_list;
+    doc->syntax_count = n;
+
+    // Items: los reemplazados quedan en la arena hasta la próxima compactación.
+    for (size_t i = first; i < last; i++) {
+        if (doc->items[i].node != NULL) {
+            doc->garbage += count_nodes(doc->items[i].node) * sizeof(AstNode);
+        }
+    }
+    for (size_t i = last; i < doc->item_count; i++) {
+        ParseItem *item = &doc->items[i];
+        item->offset = (uint32_t)((int64_t)item->offset + shift);
+        item->line = (uint32_t)((int64_t)item->line + lines);
+        if (item->node != NULL) {
+            item->node->offset = (uint32_t)((int64_t)item->node->offset + shift);
+            item->node->line = (uint32_t)((int64_t)item->node->line + lines);
+        }
+    }
+    if (doc->item_count > last) {
+        memmove(&doc->items[first + count], &doc->items[last], (doc->item_count - last) * sizeof(ParseItem));
+    }
+    if (count > 0) {
+        memcpy(&doc->items[first], region, count * sizeof(ParseItem));
+    }
+    if (end.type == TOKEN_EOF) {
+        doc->eof = end;
+    } else {
+        doc->eof.offset = (uint32_t)((int64_t)doc->eof.offset + shift);
+        doc->eof.line = (uint32_t)((int64_t)doc->eof.line + lines);
+    }
+    if (doc->unclosed != SIZE_MAX && end.type != TOKEN_EOF) {
+        // Uno que estaba en el tramo pudo ocultar otros posteriores: se
+        // supone el peor caso hasta el próximo análisis completo.
+        size_t old = doc->unclosed >= resume.offset ? (size_t)((int64_t)doc->unclosed + shift) : end.offset;
+        unclosed = old < unclosed ? old : unclosed;
+    }
+    doc->unclosed = unclosed;
+    doc->item_count = total;
+    link_program(doc, first, first + count);
+
+    if (report != NULL) {
+        report->parsed += count;
+        report->reused += total - count;
+        report->relexed += end.offset - start->offset;
+    }
+    free(region);
+    diag_free(&lexical);
+    diag_free(&syntax);
+    return failed;
+}
+
+/**
+ * @brief Vacía el documento y lo analiza completo en una arena limpia.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int reparse_all(ReparseDocument *doc, ReparseReport *report) {
+    free_messages(doc->lexical, doc->lexical_count);
+    free_messages(doc->syntax, doc->syntax_count);
+    doc->lexical_count = 0;
+    doc->syntax_count = 0;
+    doc->item_count = 0;
+    doc->unclosed = SIZE_MAX;
+    doc->garbage = 0;
+    doc->out_of_memory = 0;
+    arena_reset(&doc->arena);
+    memset(&doc->program, 0, sizeof(doc->program));
+    doc->program.kind = AST_PROGRAM;
+
+    LexToken start = { TOKEN_EOF, 0, 0, 1, 1 };
+    ReparseStop stop = { NULL, 0, 0, UINT32_MAX, 0, 0 };
+    if (report != NULL) {
+        memset(report, 0, sizeof(*report));
+        report->full = 1;
+    }
+    if (replace_items(doc, &start, 0, &stop, 0, 0, report) != 0) {
+        doc->out_of_memory = 1;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Abre un documento y lo analiza completo.
+ *
+ * @param doc Documento a inicializar (liberar con reparse_close() aunque falle).
+ * @param source Texto inicial (sin '\0' intermedios).
+ * @param length Bytes de @p source.
+ * @param lexer_flags Opciones del lexer (LEXER_*; LEXER_THREADED y
+ *                    LEXER_NO_POSITIONS se ignoran).
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+int reparse_open(ReparseDocument *doc, const char *source, size_t length, unsigned lexer_flags) {
+    memset(doc, 0, sizeof(*doc));
+    arena_init(&doc->arena, 0);
+    doc->lexer_flags = lexer_flags & ~(LEXER_THREADED | LEXER_NO_POSITIONS);
+    doc->capacity = length + 1;
+    doc->source = (char *)malloc(doc->capacity);
+    if (doc->source == NULL) {
+        doc->out_of_memory = 1;
+        return 1;
+    }
+    memcpy(doc->source, source, length);
+    doc->source[length] = '\0';
+    doc->length = length;
+    return reparse_all(doc, NULL);
+}
+
+/**
+ * @brief Aplica una edición y vuelve a analizar solo los items afectados.
+ *
+ * Los subárboles de los demás items se conservan (los punteros siguen
+ * siendo válidos); los reemplazados quedan en la arena hasta que ocupan
+ * más que los vivos y REPARSE_COMPACT_MIN_BYTES, y entonces se analiza el
+ * documento completo en una arena limpia.
+ *
+ * @param doc El documento.
+ * @param edit La edición; su texto no debe contener '\0'.
+ * @param report Destino del trabajo hecho (puede ser NULL).
+ * @return 0 si es exitoso, 1 si la edición no es válida o falta memoria.
+ */
+int reparse_edit(ReparseDocument *doc, const ReparseEdit *edit, ReparseReport *report) {
+    if (report != NULL) {
+        memset(report, 0, sizeof(*report));
+    }
+    if (edit->offset > doc->length || edit->removed > doc->length - edit->offset
+            || memchr(edit->text, '\0', edit->length) != NULL
+            || doc->length - edit->removed + edit->length >= UINT32_MAX) {
+        return 1;
+    }
+    size_t length = doc->length - edit->removed + edit->length;
+    if (length + 1 > doc->capacity) {
+        size_t capacity = doc->capacity * 2 > length + 1 ? doc->capacity * 2 : length + 1;
+        char *grown = (char *)realloc(doc->source, capacity);
+        if (grown == NULL) {
+            return 1;
+        }
+        doc->source = grown;
+        doc->capacity = capacity;
+    }
+    int64_t lines = 0;
+    for (size_t i = 0; i < edit->removed; i++) {
+        lines -= doc->source[edit->offset + i] == '\n';
+    }
+    for (size_t i = 0; i < edit->length; i++) {
+        lines += edit->text[i] == '\n';
+    }
+    memmove(doc->source + edit->offset + edit->length, doc->source + edit->offset + edit->removed,
+            doc->length - edit->offset - edit->removed + 1);
+    if (edit->length > 0) {
+        memcpy(doc->source + edit->offset, edit->text, edit->length);
+    }
+    doc->length = length;
+
+    // Último item que empieza antes de la edición: su último token puede
+    // extenderse con el texto insertado. Si la edición toca su primer token,
+    // también el anterior, que lo miró para decidir dónde terminaba.
+    size_t low = 0;
+    size_t high = doc->item_count;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        if (doc->items[middle].offset < edit->offset) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    size_t first = low > 0 ? low - 1 : 0;
+    if (first > 0 && edit->offset <= (size_t)doc->items[first].offset + doc->items[first].length) {
+        first--;
+    }
+    LexToken start = { TOKEN_EOF, 0, 0, 1, 1 };
+    if (low > 0) {
+        start.offset = doc->items[first].offset;
+        start.line = doc->items[first].line;
+        start.column = doc->items[first].column;
+    }
+    if (doc->out_of_memory || (doc->unclosed != SIZE_MAX && doc->unclosed < start.offset)) {
+        return reparse_all(doc, report);
+    }
+    int64_t shift = (int64_t)edit->length - (int64_t)edit->removed;
+    ReparseStop stop = { doc->items, doc->item_count, first, (uint32_t)(edit->offset + edit->length),
+                         shift, lines };
+    if (replace_items(doc, &start, first, &stop, shift, lines, report) != 0) {
+        return reparse_all(doc, report);
+    }
+    if (doc->garbage >= REPARSE_COMPACT_MIN_BYTES && doc->garbage > doc->arena.in_use - doc->garbage) {
+        return reparse_all(doc, report);
+    }
+    return 0;
+}
+
+/**
+ * @brief Registra en @p diag los diagnósticos del documento.
+ *
+ * Quedan en el orden de parse_source_ast(): por posición y, en la misma
+ * posición, los léxicos antes que los sintácticos.
+ *
+ * @param doc El documento.
+ * @param diag Motor de diagnósticos.
+ * @return 0 si no hubo errores, 1 en caso contrario (o si faltó memoria).
+ */
+int reparse_diagnostics(const ReparseDocument *doc, DiagEngine *diag) {
+    DiagEngine merged;
+    DiagEngine lexical;
+    // Capacidad para que quepan aun con mensajes de DIAG_MAX_MESSAGE bytes.
+    size_t per_item = DIAG_MAX_MESSAGE / DIAG_TEXT_PER_ITEM + 1;
+    if (diag_init(&merged, (doc->lexical_count + doc->syntax_count + 1) * per_item) != 0) {
+        return 1;
+    }
+    if (diag_init(&lexical, (doc->lexical_count + 1) * per_item) != 0) {
+        diag_free(&merged);
+        return 1;
+    }
+    for (size_t i = 0; i < doc->syntax_count; i++) {
+        diag_report(&merged, doc->syntax[i].severity, doc->syntax[i].span, "%s", doc->syntax[i].message);
+    }
+    diag_sort_from(&merged, 0);
+    for (size_t i = 0; i < doc->lexical_count; i++) {
+        diag_report(&lexical, doc->lexical[i].severity, doc->lexical[i].span, "%s", doc->lexical[i].message);
+    }
+    int failed = diag_merge(&merged, &lexical) != 0 || doc->out_of_memory;
+    for (size_t i = 0; i < merged.count; i++) {
+        const Diagnostic *d = &merged.items[i];
+        diag_report(diag, d->severity, d->span, "%s", merged.text + d->message);
+    }
+    failed |= merged.errors > 0;
+    diag_free(&lexical);
+    diag_free(&merged);
+    return failed;
+}
+
+/**
+ * @brief Libera el documento, su AST y sus diagnósticos.
+ */
+void reparse_close(ReparseDocument *doc) {
+    free_messages(doc->lexical, doc->lexical_count);
+    free_messages(doc->syntax, doc->syntax_count);
+    free(doc->lexical);
+    free(doc->syntax);
+    free(doc->items);
+    free(doc->source);
+    arena_free(&doc->arena);
+    memset(doc, 0, sizeof(*doc));
+}
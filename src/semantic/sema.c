@@ -0,0 +1,922 @@
+/**
+ * @file sema.c
+ * @brief Implementación del análisis semántico.
+ *
+ * Una primera pasada registra las funciones de nivel superior (así pueden
+ * llamarse antes de su definición y entre sí); la segunda recorre cada
+ * cuerpo con una pila de variables visibles. Las ranuras se reutilizan al
+ * cerrar cada bloque, de modo que slot_count es la profundidad máxima de
+ * variables vivas y no el total declarado. Tras un error en una expresión
+ * su tipo queda AST_TYPE_UNKNOWN, que es compatible con todo para no
+ * reportar errores en cascada.
+ */
+#define _POSIX_C_SOURCE 200809L
+
+#include "../../include/sema.h"
+#include "../../include/hash.h"
+#include "../../include/stats.h"
+#include "../../include/utf8.h"
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Variable visible en el punto actual del análisis.
+ */
+typedef struct SemaLocal {
+    const AstNode *decl;    /**< Nodo con el nombre (let, parámetro, for o patrón) */
+    AstType type;
+    int mutable;
+    int32_t slot;
+} SemaLocal;
+
+/**
+ * @brief Estado del análisis.
+ */
+typedef struct Sema {
+    const char *source;
+    DiagEngine *diag;
+    size_t errors;              /**< Errores semánticos reportados */
+    SemaFunction *functions;
+    size_t function_count;
+    int32_t *function_table;    /**< Índice + 1 por hash del nombre (0 = libre) */
+    size_t table_mask;
+    SemaLocal *locals;          /**< Pila de variables visibles */
+    size_t local_count;
+    size_t local_capacity;
+    size_t next_slot;           /**< Primera ranura libre */
+    SemaFunction *current;      /**< Función en análisis */
+    const AstNode *item;        /**< Item en análisis (base de las posiciones, ver ast.h) */
+    size_t loops;               /**< Ciclos que rodean la sentencia actual */
+} Sema;
+
+/**
+ * @brief Reporta un error semántico en la posición de @p at.
+ */
+static void sema_error(Sema *s, const AstNode *at, const char *format, ...)
+    __attribute__((format(printf, 3, 4)));
+
+static void sema_error(Sema *s, const AstNode *at, const char *format, ...) {
+    const AstNode *item = at->kind == AST_FUNCTION ? at : s->item;
+    char message[DIAG_MAX_MESSAGE];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    SourceSpan span = { ast_line(item, at), at->column, at->length };
+    diag_report(s->diag, DIAG_ERROR, span, "%s", message);
+    s->errors++;
+}
+
+/**
+ * @brief Lexema del token principal de un nodo.
+ *
+ * Las funciones son items, así que su posición es absoluta aunque no sean
+ * el item en análisis (al buscar la llamada en la tabla).
+ */
+static const char *lexeme(const Sema *s, const AstNode *node) {
+    return s->source + ast_offset(node->kind == AST_FUNCTION ? node : s->item, node);
+}
+
+/**
+ * @brief Compara el lexema de un nodo con un texto.
+ */
+static int lexeme_is(const Sema *s, const AstNode *node, const char *text) {
+    size_t length = strlen(text);
+    return node->length == length && memcmp(lexeme(s, node), text, length) == 0;
+}
+
+/**
+ * @brief Indica si dos nodos tienen el mismo lexema.
+ */
+static int same_name(const Sema *s, const AstNode *a, const AstNode *b) {
+    return a->length == b->length && memcmp(lexeme(s, a), lexeme(s, b), a->length) == 0;
+}
+
+/**
+ * @brief Indica si dos tipos son compatibles (AST_TYPE_UNKNOWN lo es con todos).
+ */
+static int compatible(AstType a, AstType b) {
+    return a == b || a == AST_TYPE_UNKNOWN || b == AST_TYPE_UNKNOWN;
+}
+
+/**
+ * @brief Reporta un tipo distinto del esperado.
+ *
+ * @return 1 si los tipos son compatibles, 0 si se reportó el error.
+ */
+static int expect_type(Sema *s, const AstNode *at, AstType expected, AstType actual) {
+    if (compatible(expected, actual)) {
+        return 1;
+    }
+    sema_error(s, at, "tipos incompatibles: se esperaba %s, se encontró %s",
+               ast_type_name(expected), ast_type_name(actual));
+    return 0;
+}
+
+/**
+ * @brief Traduce un nodo AST_TYPE a un AstType.
+ */
+static AstType resolve_type(Sema *s, const AstNode *type) {
+    switch (type->op) {
+        case TOKEN_KW_I32: return AST_TYPE_I32;
+        case TOKEN_KW_BOOL: return AST_TYPE_BOOL;
+        case TOKEN_KW_CHAR: return AST_TYPE_CHAR;
+        case TOKEN_KW_F64:
+            sema_error(s, type, "el tipo f64 no está soportado por el backend");
+            return AST_TYPE_UNKNOWN;
+        default:
+            if (lexeme_is(s, type, "String")) {
+                return AST_TYPE_STRING;
+            }
+            if (lexeme_is(s, type, "Array")) {
+                return AST_TYPE_ARRAY;
+            }
+            sema_error(s, type, "tipo desconocido '%.*s'", (int)type->length, lexeme(s, type));
+            return AST_TYPE_UNKNOWN;
+    }
+}
+
+/* ---- Funciones ---- */
+
+/**
+ * @brief Busca una función por el nombre de @p name.
+ *
+ * @return Su índice, o -1 si no existe.
+ */
+static int32_t find_function(const Sema *s, const AstNode *name) {
+    if (s->function_table == NULL) {
+        return -1;
+    }
+    size_t i = hash64(lexeme(s, name), name->length, 0) & s->table_mask;
+    for (; s->function_table[i] != 0; i = (i + 1) & s->table_mask) {
+        int32_t index = s->function_table[i] - 1;
+        if (same_name(s, s->functions[index].decl, name)) {
+            return index;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Registra las funciones de nivel superior y sus firmas.
+ *
+ * @return 0 si es exitoso, 1 si falta memoria.
+ */
+static int collect_functions(Sema *s, const AstNode *program) {
+    size_t count = 0;
+    for (const AstNode *item = program->a; item != NULL; item = item->next) {
+        s->item = item;
+        if (item->kind == AST_FUNCTION) {
+            count++;
+        } else {
+            sema_error(s, item, "sentencia fuera de una función: solo se ejecutan funciones");
+        }
+    }
+    size_t table_size = 16;
+    while (table_size < count * 2) {
+        table_size *= 2;
+    }
+    s->functions = (SemaFunction *)calloc(count > 0 ? count : 1, sizeof(SemaFunction));
+    s->function_table = (int32_t *)calloc(table_size, sizeof(int32_t));
+    if (s->functions == NULL || s->function_table == NULL) {
+        return 1;
+    }
+    s->table_mask = table_size - 1;
+
+    for (const AstNode *item = program->a; item != NULL; item = item->next) {
+        if (item->kind != AST_FUNCTION) {
+            continue;
+        }
+        s->item = item;
+        if (find_function(s, item) >= 0) {
+            sema_error(s, item, "la función '%.*s' ya está definida", (int)item->length, lexeme(s, item));
+            continue;
+        }
+        SemaFunction *function = &s->functions[s->function_count];
+        function->decl = item;
+        function->result = item->b != NULL ? resolve_type(s, item->b) : AST_TYPE_UNIT;
+        for (const AstNode *param = item->a; param != NULL; param = param->next) {
+            if (function->param_count == SEMA_MAX_PARAMS) {
+                sema_error(s, param, "demasiados parámetros (máximo %d)", SEMA_MAX_PARAMS);
+                break;
+            }
+            function->params[function->param_count++] = resolve_type(s, param->a);
+        }
+        size_t i = hash64(lexeme(s, item), item->length, 0) & s->table_mask;
+        while (s->function_table[i] != 0) {
+            i = (i + 1) & s->table_mask;
+        }
+        s->function_table[i] = (int32_t)++s->function_count;
+    }
+    return 0;
+}
+
+/* ---- Variables ---- */
+
+/**
+ * @brief Declara una variable en el bloque actual y le asigna una ranura.
+ *
+ * @return La ranura, o -1 si falta memoria.
+ */
+static int32_t declare(Sema *s, const AstNode *decl, AstType type, int mutable) {
+    if (s->local_count == s->local_capacity) {
+        size_t grown = s->local_capacity > 0 ? s->local_capacity * 2 : 64;
+        SemaLocal *larger = (SemaLocal *)realloc(s->locals, grown * sizeof(SemaLocal));
+        if (larger == NULL) {
+            sema_error(s, decl, "memoria insuficiente");
+            return -1;
+        }
+        s->locals = larger;
+        s->local_capacity = grown;
+    }
+    int32_t slot = (int32_t)s->next_slot++;
+    if (s->next_slot > s->current->slot_count) {
+        s->current->slot_count = s->next_slot;
+    }
+    SemaLocal *local = &s->locals[s->local_count++];
+    local->decl = decl;
+    local->type = type;
+    local->mutable = mutable;
+    local->slot = slot;
+    return slot;
+}
+
+/**
+ * @brief Ranura oculta (fin de un for, valor de un match) sin nombre visible.
+ */
+static int32_t hidden_slot(Sema *s) {
+    int32_t slot = (int32_t)s->next_slot++;
+    if (s->next_slot > s->current->slot_count) {
+        s->current->slot_count = s->next_slot;
+    }
+    return slot;
+}
+
+/**
+ * @brief Busca la declaración visible más reciente de un nombre.
+ */
+static const SemaLocal *lookup(const Sema *s, const AstNode *name) {
+    for (size_t i = s->local_count; i > 0; i--) {
+        if (same_name(s, s->locals[i - 1].decl, name)) {
+            return &s->locals[i - 1];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Marca de ámbito: lo necesario para cerrarlo.
+ */
+typedef struct SemaScope {
+    size_t local_count;
+    size_t next_slot;
+} SemaScope;
+
+static SemaScope scope_open(const Sema *s) {
+    SemaScope scope = { s->local_count, s->next_slot };
+    return scope;
+}
+
+static void scope_close(Sema *s, SemaScope scope) {
+    s->local_count = scope.local_count;
+    s->next_slot = scope.next_slot;
+}
+
+/* ---- Expresiones ---- */
+
+static AstType check_expression(Sema *s, AstNode *e);
+static void check_statement(Sema *s, AstNode *statement);
+static void check_block(Sema *s, AstNode *block);
+
+/**
+ * @brief Analiza una expresión cuyo valor se usa: no puede ser de tipo ().
+ */
+static AstType check_value(Sema *s, AstNode *e) {
+    AstType type = check_expression(s, e);
+    if (type == AST_TYPE_UNIT) {
+        sema_error(s, e, "la expresión no produce un valor");
+        return AST_TYPE_UNKNOWN;
+    }
+    return type;
+}
+
+/**
+ * @brief Valor de un literal numérico entero (decimal, 0x o 0b).
+ */
+static AstType check_number(Sema *s, AstNode *e) {
+    const char *text = lexeme(s, e);
+    size_t i = 0;
+    unsigned base = 10;
+    if (e->length > 2 && text[0] == '0' && (text[1] == 'x' || text[1] == 'X')) {
+        base = 16;
+        i = 2;
+    } else if (e->length > 2 && text[0] == '0' && (text[1] == 'b' || text[1] == 'B')) {
+        base = 2;
+        i = 2;
+    }
+    uint64_t value = 0;
+    for (; i < e->length; i++) {
+        char c = text[i];
+        unsigned digit;
+        if (c >= '0' && c <= '9') {
+            digit = (unsigned)(c - '0');
+        } else if (base == 16 && c >= 'a' && c <= 'f') {
+            digit = (unsigned)(c - 'a' + 10);
+        } else if (base == 16 && c >= 'A' && c <= 'F') {
+            digit = (unsigned)(c - 'A' + 10);
+        } else {
+            sema_error(s, e, "los literales reales no están soportados por el backend");
+            return AST_TYPE_UNKNOWN;
+        }
+        value = value * base + digit;
+        if (value > INT32_MAX) {
+            sema_error(s, e, "el literal '%.*s' no cabe en i32", (int)e->length, text);
+            return AST_TYPE_UNKNOWN;
+        }
+    }
+    e->value = (int64_t)value;
+    return AST_TYPE_I32;
+}
+
+/**
+ * @brief Código del carácter de un literal ('a', '\n' o una secuencia UTF-8).
+ */
+static AstType check_char(Sema *s, AstNode *e) {
+    const char *text = lexeme(s, e) + 1;
+    size_t inner = e->length - 2;
+    if (inner == 0) {
+        sema_error(s, e, "literal de carácter vacío");
+        return AST_TYPE_UNKNOWN;
+    }
+    if (text[0] == '\\') {
+        switch (inner == 2 ? text[1] : '\0') {
+            case 'n': e->value = '\n'; break;
+            case 't': e->value = '\t'; break;
+            case 'r': e->value = '\r'; break;
+            case '0': e->value = 0; break;
+            case '\\': e->value = '\\'; break;
+            case '\'': e->value = '\''; break;
+            case '"': e->value = '"'; break;
+            default:
+                sema_error(s, e, "secuencia de escape desconocida en '%.*s'", (int)e->length, lexeme(s, e));
+                return AST_TYPE_UNKNOWN;
+        }
+        return AST_TYPE_CHAR;
+    }
+    uint32_t codepoint = 0;
+    size_t length = utf8_sequence_length(text, &codepoint);
+    if (length == 0 || length != inner) {
+        sema_error(s, e, "el literal '%.*s' debe contener un solo carácter", (int)e->length, lexeme(s, e));
+        return AST_TYPE_UNKNOWN;
+    }
+    e->value = codepoint;
+    return AST_TYPE_CHAR;
+}
+
+/**
+ * @brief Decodifica las secuencias de escape de un literal de cadena.
+ *
+ * Admite las mismas que los caracteres: \n \t \r \0 \\ \' \".
+ *
+ * @param text Contenido del literal, sin las comillas.
+ * @param length Bytes de @p text.
+ * @param out Destino de los bytes (al menos @p length), o NULL para solo contarlos.
+ * @return Bytes decodificados, o SIZE_MAX si hay una secuencia desconocida.
+ */
+size_t sema_unescape(const char *text, size_t length, uint8_t *out) {
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = (uint8_t)text[i];
+        if (c == '\\') {
+            switch (++i < length ? text[i] : '\0') {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case '0': c = 0; break;
+                case '\\': c = '\\'; break;
+                case '\'': c = '\''; break;
+                case '"': c = '"'; break;
+                default: return SIZE_MAX;
+            }
+        }
+        if (out != NULL) {
+            out[count] = c;
+        }
+        count++;
+    }
+    return count;
+}
+
+/**
+ * @brief Literal de cadena: solo se validan sus escapes (bytecode.c lo interna).
+ */
+static AstType check_string(Sema *s, AstNode *e) {
+    size_t length = sema_unescape(lexeme(s, e) + 1, e->length - 2, NULL);
+    if (length == SIZE_MAX) {
+        sema_error(s, e, "secuencia de escape desconocida en %.*s", (int)e->length, lexeme(s, e));
+        return AST_TYPE_UNKNOWN;
+    }
+    e->value = (int64_t)length;
+    return AST_TYPE_STRING;
+}
+
+/**
+ * @brief [a, b, ...]: Array de elementos i32.
+ */
+static AstType check_array(Sema *s, AstNode *e) {
+    size_t count = 0;
+    for (AstNode *element = e->a; element != NULL; element = element->next, count++) {
+        expect_type(s, element, AST_TYPE_I32, check_value(s, element));
+    }
+    if (count > SEMA_MAX_ARRAY_LITERAL) {
+        sema_error(s, e, "el arreglo tiene %zu elementos (máximo %d en un literal)", count,
+                   SEMA_MAX_ARRAY_LITERAL);
+    }
+    e->value = (int64_t)count;
+    return AST_TYPE_ARRAY;
+}
+
+/**
+ * @brief Operador unario: '-' y '+' sobre i32, '!' sobre bool.
+ */
+static AstType check_unary(Sema *s, AstNode *e) {
+    AstType operand = check_value(s, e->a);
+    AstType expected = e->op == TOKEN_BANG ? AST_TYPE_BOOL : AST_TYPE_I32;
+    expect_type(s, e->a, expected, operand);
+    return expected;
+}
+
+/**
+ * @brief Operadores binarios: aritméticos, de comparación y lógicos.
+ */
+static AstType check_binary(Sema *s, AstNode *e) {
+    AstType left = check_value(s, e->a);
+    AstType right = check_value(s, e->b);
+    switch (e->op) {
+        case TOKEN_AND_AND:
+        case TOKEN_OR_OR:
+            expect_type(s, e->a, AST_TYPE_BOOL, left);
+            expect_type(s, e->b, AST_TYPE_BOOL, right);
+            return AST_TYPE_BOOL;
+        case TOKEN_EQUAL_EQUAL:
+        case TOKEN_BANG_EQUAL:
+            expect_type(s, e->b, left, right);
+            return AST_TYPE_BOOL;
+        case TOKEN_LESS:
+        case TOKEN_LESS_EQUAL:
+        case TOKEN_GREATER:
+        case TOKEN_GREATER_EQUAL:
+            if (left == AST_TYPE_BOOL || ast_type_is_reference(left)) {
+                sema_error(s, e, "los valores %s no se pueden ordenar", ast_type_name(left));
+            } else {
+                expect_type(s, e->b, left, right);
+            }
+            return AST_TYPE_BOOL;
+        case TOKEN_PLUS:
+            if (ast_type_is_reference(left)) {
+                expect_type(s, e->b, left, right);
+                return left;
+            }
+            /* fall through */
+        default:
+            expect_type(s, e->a, AST_TYPE_I32, left);
+            expect_type(s, e->b, AST_TYPE_I32, right);
+            return AST_TYPE_I32;
+    }
+}
+
+/**
+ * @brief Asignación simple o compuesta a una variable mutable.
+ */
+static void check_assign(Sema *s, AstNode *e) {
+    AstType value = check_value(s, e->b);
+    AstNode *target = e->a;
+    if (target->kind != AST_NAME) {
+        sema_error(s, target, "el destino de la asignación debe ser una variable");
+        return;
+    }
+    const SemaLocal *local = lookup(s, target);
+    if (local == NULL) {
+        sema_error(s, target, "variable '%.*s' no declarada", (int)target->length, lexeme(s, target));
+        return;
+    }
+    if (!local->mutable) {
+        sema_error(s, target, "la variable '%.*s' no es mutable", (int)target->length, lexeme(s, target));
+    }
+    target->slot = local->slot;
+    target->type = local->type;
+    if (e->op == TOKEN_PLUS_EQUAL && ast_type_is_reference(local->type)) {
+        /* Concatenación */
+    } else if (e->op != TOKEN_EQUAL) {
+        expect_type(s, target, AST_TYPE_I32, local->type);
+    }
+    expect_type(s, e->b, local->type, value);
+}
+
+/**
+ * @brief Funciones incorporadas sobre String y Array: len(x) y at(x, i).
+ *
+ * e->aux guarda el tipo de x, del que depende la instrucción.
+ */
+static AstType check_reference_builtin(Sema *s, AstNode *e, size_t argc) {
+    AstNode *callee = e->a;
+    int is_len = e->slot == SEMA_BUILTIN_LEN;
+    size_t expected = is_len ? 1 : 2;
+    if (argc != expected) {
+        sema_error(s, callee, "'%.*s' espera %zu argumentos, recibió %zu", (int)callee->length,
+                   lexeme(s, callee), expected, argc);
+    }
+    AstType container = AST_TYPE_UNKNOWN;
+    size_t i = 0;
+    for (AstNode *arg = e->b; arg != NULL; arg = arg->next, i++) {
+        AstType type = check_value(s, arg);
+        if (i == 0) {
+            container = type;
+            if (!ast_type_is_reference(type) && type != AST_TYPE_UNKNOWN) {
+                sema_error(s, arg, "'%.*s' espera un String o un Array, se encontró %s",
+                           (int)callee->length, lexeme(s, callee), ast_type_name(type));
+                container = AST_TYPE_UNKNOWN;
+            }
+        } else {
+            expect_type(s, arg, AST_TYPE_I32, type);
+        }
+    }
+    e->aux = container;
+    if (is_len) {
+        return AST_TYPE_I32;
+    }
+    return container == AST_TYPE_STRING ? AST_TYPE_CHAR
+         : container == AST_TYPE_ARRAY ? AST_TYPE_I32 : AST_TYPE_UNKNOWN;
+}
+
+/**
+ * @brief Llamada a una función del programa o a una incorporada.
+ */
+static AstType check_call(Sema *s, AstNode *e) {
+    AstNode *callee = e->a;
+    size_t argc = 0;
+    for (AstNode *arg = e->b; arg != NULL; arg = arg->next) {
+        argc++;
+    }
+    if (callee->kind != AST_NAME) {
+        sema_error(s, callee, "solo se pueden llamar funciones por su nombre");
+        for (AstNode *arg = e->b; arg != NULL; arg = arg->next) {
+            check_value(s, arg);
+        }
+        return AST_TYPE_UNKNOWN;
+    }
+    int32_t index = find_function(s, callee);
+    if (index < 0 && lexeme_is(s, callee, "print")) {
+        e->slot = SEMA_BUILTIN_PRINT;
+        if (argc != 1) {
+            sema_error(s, callee, "'print' espera 1 argumento, recibió %zu", argc);
+        }
+        for (AstNode *arg = e->b; arg != NULL; arg = arg->next) {
+            e->aux = check_value(s, arg);
+        }
+        return AST_TYPE_UNIT;
+    }
+    if (index < 0 && (lexeme_is(s, callee, "len") || lexeme_is(s, callee, "at"))) {
+        e->slot = lexeme_is(s, callee, "len") ? SEMA_BUILTIN_LEN : SEMA_BUILTIN_AT;
+        return check_reference_builtin(s, e, argc);
+    }
+    if (index < 0) {
+        sema_error(s, callee, "función '%.*s' no declarada", (int)callee->length, lexeme(s, callee));
+        for (AstNode *arg = e->b; arg != NULL; arg = arg->next) {
+            check_value(s, arg);
+        }
+        return AST_TYPE_UNKNOWN;
+    }
+    const SemaFunction *function = &s->functions[index];
+    e->slot = index;
+    if (argc != function->param_count) {
+        sema_error(s, callee, "'%.*s' espera %zu argumentos, recibió %zu",
+                   (int)callee->length, lexeme(s, callee), function->param_count, argc);
+    }
+    size_t i = 0;
+    for (AstNode *arg = e->b; arg != NULL; arg = arg->next, i++) {
+        AstType type = check_value(s, arg);
+        if (i < function->param_count) {
+            expect_type(s, arg, function->params[i], type);
+        }
+    }
+    return function->result;
+}
+
+/**
+ * @brief Analiza una expresión y guarda su tipo en e->type.
+ *
+ * @return El tipo (AST_TYPE_UNIT para llamadas sin valor y asignaciones).
+ */
+static AstType check_expression(Sema *s, AstNode *e) {
+    AstType type = AST_TYPE_UNKNOWN;
+    switch (e->kind) {
+        case AST_NUMBER:
+            type = check_number(s, e);
+            break;
+        case AST_CHAR:
+            type = check_char(s, e);
+            break;
+        case AST_BOOL:
+            e->value = e->op == TOKEN_KW_TRUE;
+            type = AST_TYPE_BOOL;
+            break;
+        case AST_NAME: {
+            const SemaLocal *local = lookup(s, e);
+            if (local != NULL) {
+                e->slot = local->slot;
+                type = local->type;
+            } else if (find_function(s, e) >= 0) {
+                sema_error(s, e, "la función '%.*s' solo puede llamarse", (int)e->length, lexeme(s, e));
+            } else {
+                sema_error(s, e, "variable '%.*s' no declarada", (int)e->length, lexeme(s, e));
+            }
+            break;
+        }
+        case AST_UNARY:
+            type = check_unary(s, e);
+            break;
+        case AST_BINARY:
+            type = check_binary(s, e);
+            break;
+        case AST_ASSIGN:
+            check_assign(s, e);
+            type = AST_TYPE_UNIT;
+            break;
+        case AST_CALL:
+            type = check_call(s, e);
+            break;
+        case AST_STRING:
+            type = check_string(s, e);
+            break;
+        case AST_ARRAY:
+            type = check_array(s, e);
+            break;
+        case AST_FIELD:
+            sema_error(s, e, "el acceso a campos no está soportado por el backend");
+            break;
+        case AST_RANGE:
+            sema_error(s, e, "un rango solo puede usarse en un for");
+            break;
+        default:
+            sema_error(s, e, "se esperaba una expresión");
+            break;
+    }
+    e->type = type;
+    return type;
+}
+
+/* ---- Sentencias ---- */
+
+/**
+ * @brief let [mut] x [: T] [= valor]
+ */
+static void check_let(Sema *s, AstNode *let) {
+    AstType declared = let->a != NULL ? resolve_type(s, let->a) : AST_TYPE_UNKNOWN;
+    AstType type = declared;
+    if (let->b != NULL) {
+        AstType value = check_value(s, let->b);
+        if (let->a != NULL) {
+            expect_type(s, let->b, declared, value);
+        } else {
+            type = value;
+        }
+    } else if (let->a == NULL) {
+        sema_error(s, let, "la variable '%.*s' necesita un tipo o un valor inicial",
+                   (int)let->length, lexeme(s, let));
+    }
+    let->type = type;
+    let->slot = declare(s, let, type, let->op == TOKEN_KW_MUT);
+}
+
+/**
+ * @brief for x in a..b: x es i32 inmutable; el fin va en una ranura oculta.
+ */
+static void check_for(Sema *s, AstNode *loop) {
+    AstNode *range = loop->a;
+    SemaScope scope = scope_open(s);
+    if (range->kind != AST_RANGE) {
+        sema_error(s, range, "el for solo admite rangos a..b");
+        check_expression(s, range);
+    } else {
+        expect_type(s, range->a, AST_TYPE_I32, check_value(s, range->a));
+        expect_type(s, range->b, AST_TYPE_I32, check_value(s, range->b));
+    }
+    loop->aux = hidden_slot(s);
+    loop->slot = declare(s, loop, AST_TYPE_I32, 0);
+    s->loops++;
+    check_block(s, loop->b);
+    s->loops--;
+    scope_close(s, scope);
+}
+
+/**
+ * @brief Resultado de un brazo de match o sentencia de expresión.
+ *
+ * Su valor, si lo tiene, se descarta.
+ */
+static void check_expression_statement(Sema *s, AstNode *e) {
+    if (e->kind == AST_BLOCK) {
+        check_block(s, e);
+    } else {
+        check_expression(s, e);
+    }
+}
+
+/**
+ * @brief match x { patrón => resultado; ... }
+ *
+ * Los patrones literales deben ser del tipo de x; un nombre captura el
+ * valor (y '_' lo descarta). El valor se guarda en una ranura oculta.
+ */
+static void check_match(Sema *s, AstNode *match) {
+    SemaScope outer = scope_open(s);
+    AstType subject = check_value(s, match->a);
+    match->slot = hidden_slot(s);
+    for (AstNode *arm = match->b; arm != NULL; arm = arm->next) {
+        SemaScope scope = scope_open(s);
+        AstNode *pattern = arm->a;
+        if (pattern->kind == AST_NAME) {
+            pattern->type = subject;
+            pattern->slot = lexeme_is(s, pattern, "_") ? -1 : declare(s, pattern, subject, 0);
+        } else {
+            expect_type(s, pattern, subject, check_expression(s, pattern));
+        }
+        check_expression_statement(s, arm->b);
+        scope_close(s, scope);
+    }
+    scope_close(s, outer);
+}
+
+/**
+ * @brief return [valor], comparado con el tipo de retorno de la función.
+ */
+static void check_return(Sema *s, AstNode *ret) {
+    AstType result = s->current->result;
+    if (ret->a == NULL) {
+        if (result != AST_TYPE_UNIT && result != AST_TYPE_UNKNOWN) {
+            sema_error(s, ret, "return sin valor en una función que devuelve %s", ast_type_name(result));
+        }
+        return;
+    }
+    AstType value = check_value(s, ret->a);
+    if (result == AST_TYPE_UNIT) {
+        sema_error(s, ret->a, "return con valor en una función sin tipo de retorno");
+    } else {
+        expect_type(s, ret->a, result, value);
+    }
+}
+
+/**
+ * @brief Analiza una sentencia.
+ */
+static void check_statement(Sema *s, AstNode *statement) {
+    switch (statement->kind) {
+        case AST_LET:
+            check_let(s, statement);
+            break;
+        case AST_IF:
+            expect_type(s, statement->a, AST_TYPE_BOOL, check_value(s, statement->a));
+            check_block(s, statement->b);
+            if (statement->c != NULL) {
+                check_statement(s, statement->c);
+            }
+            break;
+        case AST_WHILE:
+            expect_type(s, statement->a, AST_TYPE_BOOL, check_value(s, statement->a));
+            s->loops++;
+            check_block(s, statement->b);
+            s->loops--;
+            break;
+        case AST_FOR:
+            check_for(s, statement);
+            break;
+        case AST_LOOP:
+            s->loops++;
+            check_block(s, statement->b);
+            s->loops--;
+            break;
+        case AST_MATCH:
+            check_match(s, statement);
+            break;
+        case AST_BLOCK:
+            check_block(s, statement);
+            break;
+        case AST_RETURN:
+            check_return(s, statement);
+            break;
+        case AST_BREAK:
+        case AST_CONTINUE:
+            if (s->loops == 0) {
+                sema_error(s, statement, "'%s' fuera de un ciclo",
+                           statement->kind == AST_BREAK ? "break" : "continue");
+            }
+            break;
+        case AST_EXPR_STMT:
+            check_expression(s, statement->a);
+            break;
+        default:
+            sema_error(s, statement, "se esperaba una sentencia");
+            break;
+    }
+}
+
+/**
+ * @brief Analiza un bloque en su propio ámbito.
+ */
+static void check_block(Sema *s, AstNode *block) {
+    SemaScope scope = scope_open(s);
+    for (AstNode *statement = block->a; statement != NULL; statement = statement->next) {
+        check_statement(s, statement);
+    }
+    scope_close(s, scope);
+}
+
+/**
+ * @brief Analiza el cuerpo de una función con sus parámetros en las primeras ranuras.
+ */
+static void check_function(Sema *s, SemaFunction *function) {
+    s->current = function;
+    s->item = function->decl;
+    s->local_count = 0;
+    s->next_slot = 0;
+    s->loops = 0;
+    size_t i = 0;
+    for (AstNode *param = function->decl->a; param != NULL && i < function->param_count;
+         param = param->next, i++) {
+        param->type = function->params[i];
+        param->slot = declare(s, param, function->params[i], 0);
+    }
+    check_block(s, function->decl->c);
+}
+
+/**
+ * @brief Analiza semánticamente un programa sin errores sintácticos.
+ *
+ * Los errores se registran en @p diag en el orden en que se encuentran
+ * (función por función, en orden de fuente).
+ *
+ * @param program Raíz del AST (de parse_source_ast()); se anotan sus nodos.
+ * @param source El fuente del que se construyó.
+ * @param diag Motor de diagnósticos.
+ * @param result Destino del programa analizado; liberar con sema_free().
+ * @return 0 si no hubo errores, 1 en caso contrario.
+ */
+int sema_analyze(AstNode *program, const char *source, DiagEngine *diag, SemaProgram *result) {
+    uint64_t start = stats_clock();
+    Sema s;
+    memset(&s, 0, sizeof(s));
+    s.source = source;
+    s.diag = diag;
+    memset(result, 0, sizeof(*result));
+
+    if (collect_functions(&s, program) != 0) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "memoria insuficiente");
+        s.errors++;
+    }
+    for (size_t i = 0; i < s.function_count; i++) {
+        check_function(&s, &s.functions[i]);
+    }
+
+    int32_t main_index = -1;
+    for (size_t i = 0; i < s.function_count && main_index < 0; i++) {
+        if (lexeme_is(&s, s.functions[i].decl, "main")) {
+            main_index = (int32_t)i;
+        }
+    }
+    if (main_index < 0) {
+        SourceSpan span = { 1, 1, 0 };
+        diag_report(diag, DIAG_ERROR, span, "no se encontró la función 'main'");
+        s.errors++;
+    } else {
+        const SemaFunction *main_function = &s.functions[main_index];
+        if (main_function->param_count > 0) {
+            sema_error(&s, main_function->decl, "'main' no debe tener parámetros");
+        }
+        if (main_function->result != AST_TYPE_UNIT && main_function->result != AST_TYPE_I32
+                && main_function->result != AST_TYPE_UNKNOWN) {
+            sema_error(&s, main_function->decl, "'main' debe devolver i32 o nada");
+        }
+    }
+
+    free(s.locals);
+    free(s.function_table);
+    result->source = source;
+    result->functions = s.functions;
+    result->function_count = s.function_count;
+    result->main_index = main_index >= 0 ? (size_t)main_index : 0;
+    stats_phase_add(STATS_SEMANTIC, stats_clock() - start);
+    return s.errors > 0 ? 1 : 0;
+}
+
+/**
+ * @brief Libera el programa analizado (el AST sigue en su arena).
+ */
+void sema_free(SemaProgram *program) {
+    free(program->functions);
+    program->functions = NULL;
+    program->function_count = 0;
+}
@@ -0,0 +1,167 @@
+/**
+ * @file arena.c
+ * @brief Implementación del asignador por regiones.
+ */
+#include "../../include/arena.h"
+#include <stdlib.h>
+
+#define ARENA_ALIGN 16
+#define ARENA_DEFAULT_BLOCK (64 * 1024)
+
+/**
+ * @brief Redondea un tamaño al múltiplo de alineación de la arena.
+ */
+static size_t align_up(size_t n) {
+    return (n + (ARENA_ALIGN - 1)) & ~(size_t)(ARENA_ALIGN - 1);
+}
+
+/**
+ * @brief Devuelve el inicio de la zona útil de un bloque.
+ */
+static char *block_data(ArenaBlock *block) {
+    return (char *)block + align_up(sizeof(ArenaBlock));
+}
+
+/**
+ * @brief Reserva un bloque nuevo con al menos @p min_size bytes útiles.
+ *
+ * @return El bloque creado, o NULL si no hay memoria.
+ */
+static ArenaBlock *block_new(size_t min_size, size_t block_size) {
+    size_t capacity = min_size > block_size ? min_size : block_size;
+    ArenaBlock *block = (ArenaBlock *)malloc(align_up(sizeof(ArenaBlock)) + capacity);
+    if (block == NULL) {
+        return NULL;
+    }
+    block->next = NULL;
+    block->capacity = capacity;
+    block->used = 0;
+    return block;
+}
+
+/**
+ * @brief Inicializa una arena vacía.
+ *
+ * @param arena La arena a inicializar.
+ * @param block_size Tamaño mínimo de bloque, 0 para usar el valor por defecto.
+ */
+void arena_init(Arena *arena, size_t block_size) {
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->block_size = block_size ? align_up(block_size) : ARENA_DEFAULT_BLOCK;
+    arena->in_use = 0;
+    arena->peak = 0;
+}
+
+/**
+ * @brief Reserva @p size bytes alineados dentro de la arena.
+ *
+ * Si el bloque actual no tiene espacio se reutiliza el siguiente bloque de la
+ * cadena (conservado por un reinicio previo) o se reserva uno nuevo.
+ *
+ * @param arena La arena.
+ * @param size Número de bytes solicitados.
+ * @return Puntero a la memoria, o NULL si no hay memoria.
+ */
+void *arena_alloc(Arena *arena, size_t size) {
+    size = align_up(size ? size : 1);
+
+    ArenaBlock *block = arena->current;
+    while (block != NULL && block->capacity - block->used < size) {
+        block = block->next;
+        if (block != NULL) {
+            block->used = 0;
+        }
+    }
+
+    if (block == NULL) {
+        block = block_new(size, arena->block_size);
+        if (block == NULL) {
+            return NULL;
+        }
+        if (arena->current == NULL) {
+            arena->head = block;
+        } else {
+            // Se inserta tras el bloque actual para no perder los siguientes.
+            block->next = arena->current->next;
+            arena->current->next = block;
+        }
+    }
+
+    arena->current = block;
+    void *ptr = block_data(block) + block->used;
+    block->used += size;
+    arena->in_use += size;
+    if (arena->in_use > arena->peak) {
+        arena->peak = arena->in_use;
+    }
+    return ptr;
+}
+
+/**
+ * @brief Libera lógicamente toda la memoria entregada conservando los bloques.
+ *
+ * @param arena La arena.
+ */
+void arena_reset(Arena *arena) {
+    if (arena->head != NULL) {
+        arena->head->used = 0;
+    }
+    arena->current = arena->head;
+    arena->in_use = 0;
+}
+
+/**
+ * @brief Pasa a @p arena los bloques de @p from con la memoria que ya entregó.
+ *
+ * Lo reservado en @p from sigue siendo válido y vive tanto como @p arena
+ * (hasta su próximo reinicio); los bloques que @p from no había usado se
+ * liberan. @p from queda vacía y puede seguir usándose.
+ *
+ * @param arena La arena que se queda con los bloques.
+ * @param from La arena de la que salen.
+ */
+void arena_adopt(Arena *arena, Arena *from) {
+    if (from->head == NULL) {
+        return;
+    }
+    ArenaBlock *spare = from->current->next;
+    while (spare != NULL) {
+        ArenaBlock *next = spare->next;
+        free(spare);
+        spare = next;
+    }
+    if (arena->current == NULL) {
+        from->current->next = NULL;
+        arena->head = from->head;
+        arena->current = from->current;
+    } else {
+        // Delante de los bloques en uso, para no reutilizarlos antes de un reinicio.
+        from->current->next = arena->head;
+        arena->head = from->head;
+    }
+    arena->in_use += from->in_use;
+    if (arena->in_use > arena->peak) {
+        arena->peak = arena->in_use;
+    }
+    from->head = NULL;
+    from->current = NULL;
+    from->in_use = 0;
+}
+
+/**
+ * @brief Devuelve al sistema todos los bloques de la arena.
+ *
+ * @param arena La arena.
+ */
+void arena_free(Arena *arena) {
+    ArenaBlock *block = arena->head;
+    while (block != NULL) {
+        ArenaBlock *next = block->next;
+        free(block);
+        block = next;
+    }
+    arena->head = NULL;
+    arena->current = NULL;
+    arena->in_use = 0;
+}
@@ -0,0 +1,209 @@
+/**
+ * @file diag.c
+ * @brief Implementación del motor de diagnósticos.
+ */
+#include "../../include/diag.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Reserva el búfer de un motor de diagnósticos.
+ *
+ * @param diag El motor.
+ * @param capacity Máximo de diagnósticos almacenados (0 para DIAG_DEFAULT_CAPACITY).
+ * @return 0 si es exitoso, 1 si no hay memoria.
+ */
+int diag_init(DiagEngine *diag, size_t capacity) {
+    if (capacity == 0) {
+        capacity = DIAG_DEFAULT_CAPACITY;
+    }
+    diag->items = (Diagnostic *)malloc(capacity * sizeof(Diagnostic));
+    diag->text_capacity = capacity * DIAG_TEXT_PER_ITEM;
+    diag->text = (char *)malloc(diag->text_capacity);
+    diag->capacity = capacity;
+    if (diag->items == NULL || diag->text == NULL) {
+        diag_free(diag);
+        return 1;
+    }
+    diag_reset(diag);
+    return 0;
+}
+
+/**
+ * @brief Descarta los diagnósticos registrados conservando el búfer.
+ *
+ * @param diag El motor.
+ */
+void diag_reset(DiagEngine *diag) {
+    diag->count = 0;
+    diag->text_used = 0;
+    diag->errors = 0;
+    diag->warnings = 0;
+    diag->dropped = 0;
+}
+
+/**
+ * @brief Libera el búfer de un motor de diagnósticos.
+ *
+ * @param diag El motor.
+ */
+void diag_free(DiagEngine *diag) {
+    free(diag->items);
+    free(diag->text);
+    diag->items = NULL;
+    diag->text = NULL;
+    diag->capacity = 0;
+    diag->text_capacity = 0;
+    diag_reset(diag);
+}
+
+/**
+ * @brief Registra un diagnóstico.
+ *
+ * No reserva memoria: si no queda espacio, el diagnóstico solo se cuenta.
+ *
+ * @param diag El motor (si es NULL, no se hace nada).
+ * @param severity Gravedad.
+ * @param span Posición en el fuente.
+ * @param format Mensaje con formato printf.
+ */
+void diag_report(DiagEngine *diag, DiagSeverity severity, SourceSpan span, const char *format, ...) {
+    if (diag == NULL) {
+        return;
+    }
+    if (severity == DIAG_ERROR) {
+        diag->errors++;
+    } else {
+        diag->warnings++;
+    }
+
+    size_t room = diag->text_capacity - diag->text_used;
+    if (diag->count == diag->capacity || room < DIAG_MAX_MESSAGE) {
+        diag->dropped++;
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(diag->text + diag->text_used, DIAG_MAX_MESSAGE, format, args);
+    va_end(args);
+    if (n < 0) {
+        diag->dropped++;
+        return;
+    }
+    size_t written = (size_t)n < DIAG_MAX_MESSAGE ? (size_t)n : DIAG_MAX_MESSAGE - 1;
+
+    Diagnostic *item = &diag->items[diag->count++];
+    item->severity = severity;
+    item->span = span;
+    item->message = diag->text_used;
+    diag->text_used += written + 1;
+}
+
+/**
+ * @brief Imprime los diagnósticos con el formato `archivo:línea:columna: gravedad: mensaje`.
+ *
+ * @param diag El motor.
+ * @param path Nombre del archivo para el prefijo.
+ * @param out Flujo de salida.
+ */
+void diag_print(const DiagEngine *diag, const char *path, FILE *out) {
+    for (size_t i = 0; i < diag->count; i++) {
+        const Diagnostic *item = &diag->items[i];
+        fprintf(out, "%s:%zu:%zu: %s: %s\n", path, item->span.line, item->span.column,
+                item->severity == DIAG_ERROR ? "error" : "aviso", diag->text + item->message);
+    }
+    if (diag->dropped > 0) {
+        fprintf(out, "%s: nota: se omitieron %zu diagnósticos más\n", path, diag->dropped);
+    }
+}
+
+/**
+ * @brief Indica si @p a va estrictamente antes que @p b en el fuente.
+ */
+static int diag_before(const Diagnostic *a, const Diagnostic *b) {
+    return a->span.line < b->span.line
+        || (a->span.line == b->span.line && a->span.column < b->span.column);
+}
+
+/**
+ * @brief Ordena por posición los diagnósticos a partir de @p first.
+ *
+ * El orden es estable: los diagnósticos de una misma posición conservan el
+ * orden en que se registraron. Se usa cuando el lexer se adelanta al parser
+ * y reporta antes errores que están más adelante en el fuente; como la
+ * entrada ya está casi ordenada, basta una ordenación por inserción.
+ *
+ * @param diag El motor.
+ * @param first Primer diagnóstico afectado.
+ */
+void diag_sort_from(DiagEngine *diag, size_t first) {
+    for (size_t i = first + 1; i < diag->count; i++) {
+        Diagnostic item = diag->items[i];
+        size_t j = i;
+        while (j > first && diag_before(&item, &diag->items[j - 1])) {
+            diag->items[j] = diag->items[j - 1];
+            j--;
+        }
+        diag->items[j] = item;
+    }
+}
+
+/**
+ * @brief Incorpora a @p dst los diagnósticos de @p src, ordenados por posición.
+ *
+ * Ambos motores deben estar ordenados; en una misma posición, los de @p src
+ * van primero (son los del lexer, que precede al parser). Los contadores se
+ * suman siempre; si no caben todos, se conservan los primeros en el fuente y
+ * el resto cuenta como descartado, igual que al registrarlos en un solo motor.
+ *
+ * @param dst Motor destino.
+ * @param src Motor origen (no se modifica).
+ * @return 0 si es exitoso, 1 si no hubo memoria para ordenarlos.
+ */
+int diag_merge(DiagEngine *dst, const DiagEngine *src) {
+    dst->errors += src->errors;
+    dst->warnings += src->warnings;
+    dst->dropped += src->dropped;
+    if (dst->capacity == 0) {
+        dst->dropped += src->count;   // Motor que solo cuenta
+        return 0;
+    }
+    if (src->count == 0) {
+        return 0;
+    }
+
+    // Como en diag_report(), se conservan los primeros que caben: aquí, por posición.
+    Diagnostic *merged = (Diagnostic *)malloc(dst->capacity * sizeof(Diagnostic));
+    if (merged == NULL) {
+        dst->dropped += src->count;
+        return 1;
+    }
+
+    size_t i = 0;
+    size_t j = 0;
+    size_t n = 0;
+    while (n < dst->capacity && (i < dst->count || j < src->count)) {
+        if (j == src->count || (i < dst->count && diag_before(&dst->items[i], &src->items[j]))) {
+            merged[n++] = dst->items[i++];
+            continue;
+        }
+        const Diagnostic *item = &src->items[j++];
+        const char *message = src->text + item->message;
+        size_t length = strlen(message) + 1;
+        if (dst->text_capacity - dst->text_used < DIAG_MAX_MESSAGE) {
+            dst->dropped++;
+            continue;
+        }
+        memcpy(dst->text + dst->text_used, message, length);
+        merged[n] = *item;
+        merged[n].message = dst->text_used;
+        dst->text_used += length;
+        n++;
+    }
+    dst->dropped += (dst->count - i) + (src->count - j);
+    free(dst->items);
+    dst->items = merged;
+    dst->count = n;
+    return 0;
+}
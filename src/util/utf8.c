@@ -0,0 +1,127 @@
+/**
+ * @file utf8.c
+ * @brief Implementación de la validación de UTF-8.
+ *
+ * La validación sigue la tabla 3-7 de Unicode (sin formas sobrelargas, sin
+ * sustitutos y sin valores mayores que U+10FFFF). La búsqueda de tramos ASCII
+ * procesa 16 bytes por iteración con SSE2 y 8 con SWAR en otras plataformas.
+ */
+#include "../../include/utf8.h"
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/**
+ * @brief Valida y decodifica una secuencia UTF-8.
+ *
+ * La entrada debe estar terminada en '\0': una secuencia truncada falla al
+ * encontrar el terminador, que nunca es un byte de continuación.
+ *
+ * @param p Inicio de la secuencia (primer byte >= 0x80 o ASCII).
+ * @param codepoint Destino del punto de código (puede ser NULL).
+ * @return Longitud de la secuencia (1 a 4), o 0 si no es UTF-8 válido.
+ */
+size_t utf8_sequence_length(const char *p, uint32_t *codepoint) {
+    const unsigned char *s = (const unsigned char *)p;
+    uint32_t cp;
+    size_t length;
+    unsigned char low = 0x80;
+    unsigned char high = 0xBF;
+
+    if (s[0] < 0x80) {
+        cp = s[0];
+        length = 1;
+    } else if (s[0] >= 0xC2 && s[0] <= 0xDF) {
+        cp = s[0] & 0x1F;
+        length = 2;
+    } else if (s[0] >= 0xE0 && s[0] <= 0xEF) {
+        cp = s[0] & 0x0F;
+        length = 3;
+        if (s[0] == 0xE0) {
+            low = 0xA0;     // Sin formas sobrelargas
+        } else if (s[0] == 0xED) {
+            high = 0x9F;    // Sin sustitutos U+D800..U+DFFF
+        }
+    } else if (s[0] >= 0xF0 && s[0] <= 0xF4) {
+        cp = s[0] & 0x07;
+        length = 4;
+        if (s[0] == 0xF0) {
+            low = 0x90;     // Sin formas sobrelargas
+        } else if (s[0] == 0xF4) {
+            high = 0x8F;    // Hasta U+10FFFF
+        }
+    } else {
+        return 0;
+    }
+
+    for (size_t i = 1; i < length; i++) {
+        unsigned char c = s[i];
+        if (c < low || c > high) {
+            return 0;
+        }
+        low = 0x80;
+        high = 0xBF;
+        cp = (cp << 6) | (c & 0x3F);
+    }
+    if (codepoint != NULL) {
+        *codepoint = cp;
+    }
+    return length;
+}
+
+/**
+ * @brief Cuenta los bytes iniciales que son ASCII y distintos de los de parada.
+ *
+ * Se usa para saltar el cuerpo de comentarios y cadenas: el llamador solo
+ * examina byte a byte lo que sigue al tramo. Para menos de tres bytes de
+ * parada, se repite alguno.
+ *
+ * @param p Inicio del tramo.
+ * @param length Bytes legibles desde @p p.
+ * @return Longitud del tramo (como mucho @p length).
+ */
+size_t utf8_ascii_run(const char *p, size_t length, char stop1, char stop2, char stop3) {
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i v1 = _mm_set1_epi8(stop1);
+    const __m128i v2 = _mm_set1_epi8(stop2);
+    const __m128i v3 = _mm_set1_epi8(stop3);
+    for (; i + 16 <= length; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(const void *)(p + i));
+        __m128i hit = _mm_or_si128(_mm_cmpeq_epi8(v, v1),
+                                   _mm_or_si128(_mm_cmpeq_epi8(v, v2), _mm_cmpeq_epi8(v, v3)));
+        // El bit alto de cada byte de v marca los bytes no ASCII.
+        int mask = _mm_movemask_epi8(_mm_or_si128(hit, v));
+        if (mask != 0) {
+            return i + (size_t)__builtin_ctz((unsigned)mask);
+        }
+    }
+#else
+    const uint64_t ones = 0x0101010101010101ULL;
+    const uint64_t highs = 0x8080808080808080ULL;
+    const uint64_t m1 = ones * (unsigned char)stop1;
+    const uint64_t m2 = ones * (unsigned char)stop2;
+    const uint64_t m3 = ones * (unsigned char)stop3;
+    for (; i + 8 <= length; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, sizeof(w));
+        uint64_t x1 = w ^ m1;
+        uint64_t x2 = w ^ m2;
+        uint64_t x3 = w ^ m3;
+        // Detecta bytes cero en x1..x3 (coincidencias) y bytes con el bit alto.
+        uint64_t special = ((x1 - ones) & ~x1) | ((x2 - ones) & ~x2) | ((x3 - ones) & ~x3) | w;
+        if ((special & highs) != 0) {
+            break;
+        }
+    }
+#endif
+    for (; i < length; i++) {
+        char c = p[i];
+        if ((unsigned char)c >= 0x80 || c == stop1 || c == stop2 || c == stop3) {
+            break;
+        }
+    }
+    return i;
+}
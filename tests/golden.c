@@ -0,0 +1,1517 @@
+/**
+ * @file golden.c
+ * @brief Pruebas de regresión contra archivos de salida esperada (golden).
+ *
+ * Para cada fuente de prueba se generan en memoria sus volcados (la salida
+ * de -t, los diagnósticos de -p, el perfil de --profile-source, el AST, la
+ * salida de --run y el grafo de llamadas con el bytecode tras la expansión
+ * en línea) y se comparan byte a byte con los archivos
+ * de tests/golden/. Ante una diferencia se reporta la primera línea distinta
+ * y se guarda la salida obtenida en build/golden/ para revisarla con
+ * `diff -u`; con --update se reescriben los archivos esperados.
+ *
+ * Con --differential se comprueba además que las rutas rápidas del lexer
+ * (lexer_next_compact() y TokenStream) producen exactamente el mismo flujo
+ * que la de referencia (lexer_next_token()), sobre cada fuente completo y
+ * sobre prefijos suyos cortados en puntos arbitrarios, donde aparecen
+ * cadenas y comentarios sin cerrar y secuencias UTF-8 truncadas. También se
+ * compara cada variante especializada del lexer que admite el fuente con la
+ * variante completa (LEXER_GENERIC), y parse_source_parallel() con
+ * parse_source() sobre copias del fuente y de sus prefijos concatenadas
+ * hasta superar PARSER_PARALLEL_MIN_BYTES, y la ejecución con el JIT y con
+ * expansión en línea con la de la máquina virtual sin ella (salida, valor
+ * de main y errores de ejecución), la traducción y la expansión en línea
+ * con varios hilos con las de uno (bytecode, literales y diagnósticos), la
+ * compilación incremental con la completa, y un módulo guardado y proyectado
+ * de nuevo (image.h) con el traducido.
+ *
+ * Los casos se ejecutan en paralelo; los resultados se imprimen en orden.
+ */
+#define _GNU_SOURCE
+
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "../include/arena.h"
+#include "../include/batch.h"
+#include "../include/cache.h"
+#include "../include/callgraph.h"
+#include "../include/diag.h"
+#include "../include/driver.h"
+#include "../include/image.h"
+#include "../include/jit.h"
+#include "../include/lexer.h"
+#include "../include/parser.h"
+#include "../include/profile.h"
+#include "../include/reparse.h"
+#include "../include/sema.h"
+#include "../include/token_stream.h"
+
+#define GOLDEN_DEFAULT_DIR "tests/golden"
+#define GOLDEN_DEFAULT_ACTUAL_DIR "build/golden"
+#define GOLDEN_MAX_PATH 4096
+/** Prefijos de cada fuente probados en modo diferencial. */
+#define GOLDEN_PREFIX_CUTS 64
+/** Caracteres de una línea mostrados al reportar una diferencia. */
+#define GOLDEN_SHOWN_LINE 120
+
+/** Ediciones aleatorias por caso al comparar el análisis incremental. */
+#define GOLDEN_REPARSE_EDITS 48
+
+/* ---- Volcados ---- */
+
+/**
+ * @brief Volcado comparable; escribe la salida de una fase para un fuente.
+ *
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+typedef struct Dump {
+    const char *extension;
+    int (*write)(const char *name, const char *source, FILE *out);
+} Dump;
+
+/**
+ * @brief Archivo de tokens (-t).
+ */
+static int dump_tokens(const char *name, const char *source, FILE *out) {
+    return write_tokens_to_stream(name, source, 0, out) < 0;
+}
+
+/**
+ * @brief Diagnósticos y resumen del análisis sintáctico (-p).
+ */
+static int dump_syntax(const char *name, const char *source, FILE *out) {
+    DiagEngine diag;
+    if (diag_init(&diag, 0) != 0) {
+        return 1;
+    }
+    ParseResult result;
+    parse_source(source, 0, &diag, &result);
+    diag_print(&diag, name, out);
+    fprintf(out, "%zu errores léxicos, %zu errores sintácticos (%zu tokens)\n",
+            result.lexical_errors, result.syntax_errors, result.tokens);
+    diag_free(&diag);
+    return 0;
+}
+
+/**
+ * @brief Perfil del fuente (--profile-source) con los 10 identificadores más frecuentes.
+ */
+static int dump_profile(const char *name, const char *source, FILE *out) {
+    (void)name;
+    SourceProfile profile;
+    if (profile_init(&profile, 10) != 0) {
+        return 1;
+    }
+    profile_add_source(&profile, source, strlen(source), 0);
+    profile_print(&profile, out);
+    profile_free(&profile);
+    return 0;
+}
+
+/**
+ * @brief Árbol de parse_source_ast(), si el fuente no tiene errores.
+ */
+static int dump_ast(const char *name, const char *source, FILE *out) {
+    (void)name;
+    Arena arena;
+    arena_init(&arena, 0);
+    AstNode *program = NULL;
+    if (parse_source_ast(source, 0, NULL, &arena, &program, NULL) == 0) {
+        ast_print(program, source, out);
+    } else if (program != NULL) {
+        fprintf(out, "sin AST: el fuente tiene errores léxicos o sintácticos\n");
+    }
+    arena_free(&arena);
+    return program == NULL;
+}
+
+/**
+ * @brief Ejecuta main con run_mode y escribe su salida, los errores y el resultado.
+ */
+static int write_run(const char *name, const char *source, int run_mode, const InlineOptions *inline_options,
+                     unsigned codegen_flags, unsigned vm_flags, Cache *cache, FILE *out) {
+    DriverContext ctx = { out, out, cache, NULL, 0, 1, run_mode, inline_options, 0, codegen_flags, 0,
+                          cache != NULL, 0, 1, vm_flags, NULL, NULL };
+    RunResult result;
+    int status = driver_execute_source(name, source, &ctx, &result);
+    if (status == 0) {
+        fprintf(out, "=> main devolvió %d\n", result.value);
+    } else if (status > 0) {
+        fprintf(out, "=> error de ejecución\n");
+    } else {
+        fprintf(out, "=> no se ejecutó\n");
+    }
+    return 0;
+}
+
+/**
+ * @brief Salida de --run (máquina virtual).
+ */
+static int dump_run(const char *name, const char *source, FILE *out) {
+    return write_run(name, source, DRIVER_RUN_VM, NULL, 0, 0, NULL, out);
+}
+
+/**
+ * @brief Grafo de llamadas, llamadas expandidas y bytecode resultante (con sus núcleos vectoriales).
+ */
+static int dump_inline(const char *name, const char *source, FILE *out) {
+    DiagEngine diag;
+    if (diag_init(&diag, 0) != 0) {
+        return 1;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    AstNode *program = NULL;
+    SemaProgram sema;
+    BcModule module;
+    memset(&sema, 0, sizeof(sema));
+    memset(&module, 0, sizeof(module));
+    int failed = 0;
+    if (parse_source_ast(source, 0, &diag, &arena, &program, NULL) == 0
+            && sema_analyze(program, source, &diag, &sema) == 0
+            && bc_compile(&sema, BC_VECTORIZE, &diag, &module) == 0) {
+        CallGraph graph;
+        InlineOptions options;
+        InlineReport report;
+        inline_options_default(&options);
+        failed = callgraph_build(&module, &graph);
+        if (!failed) {
+            callgraph_print(&graph, &module, out);
+        }
+        callgraph_free(&graph);
+        failed |= inline_module(&module, &options, &report);
+        if (!failed) {
+            inline_report_print(&report, &module, name, out);
+            bc_disassemble(&module, out);
+        }
+        inline_report_free(&report);
+    } else {
+        fprintf(out, "sin bytecode: el fuente tiene errores\n");
+    }
+    bc_free(&module);
+    sema_free(&sema);
+    arena_free(&arena);
+    diag_free(&diag);
+    return failed;
+}
+
+/**
+ * @brief Diagnósticos de -p en el modo por lotes sobre el directorio @p path, con dos hilos.
+ *
+ * El resumen lleva tiempos y no se compara.
+ */
+static int dump_batch(const char *name, const char *path, FILE *out) {
+    (void)name;
+    char *summary = NULL;
+    size_t summary_len = 0;
+    FILE *sink = open_memstream(&summary, &summary_len);
+    if (sink == NULL) {
+        return 1;
+    }
+    char *inputs[] = { (char *)path };
+    BatchOptions options = { 0, 1, 2, 0, NULL, sink, out, NULL };
+    int status = batch_run(inputs, 1, &options);
+    fclose(sink);
+    free(summary);
+    fprintf(out, "=> %d\n", status);
+    return 0;
+}
+
+/** Volcado de los casos de --batch. */
+static const Dump BATCH_DUMP = { "batch", dump_batch };
+
+/** Volcados en el orden del pipeline. */
+static const Dump DUMPS[] = {
+    { "tokens", dump_tokens },
+    { "syntax", dump_syntax },
+    { "profile", dump_profile },
+    { "ast", dump_ast },
+    { "run", dump_run },
+    { "inline", dump_inline },
+};
+
+#define DUMP_COUNT (sizeof(DUMPS) / sizeof(DUMPS[0]))
+
+/* ---- Opciones y casos ---- */
+
+/**
+ * @brief Opciones de la ejecución.
+ */
+typedef struct GoldenOptions {
+    const char *golden_dir;   /**< Archivos esperados */
+    const char *actual_dir;   /**< Salidas que no coinciden */
+    int update;               /**< 1 para reescribir los esperados */
+    int differential;         /**< 1 para comparar las rutas del lexer */
+    int threads;              /**< Hilos de trabajo */
+} GoldenOptions;
+
+/**
+ * @brief Un fuente de prueba y su resultado.
+ */
+typedef struct GoldenCase {
+    char *path;               /**< Ruta del fuente */
+    char *name;               /**< Nombre base sin extensión */
+    char *report;             /**< Mensajes del caso (vacío si pasó) */
+    size_t report_len;
+    int failed;               /**< 1 si alguna comprobación falló */
+    int updated;              /**< Archivos esperados reescritos */
+    int batch;                /**< 1 si path es un directorio de --batch */
+} GoldenCase;
+
+/**
+ * @brief Estado compartido por los hilos de trabajo.
+ */
+typedef struct GoldenRun {
+    GoldenCase *cases;
+    size_t count;
+    atomic_size_t next;       /**< Siguiente caso sin asignar */
+    const GoldenOptions *options;
+} GoldenRun;
+
+/**
+ * @brief Lee un archivo completo; devuelve NULL si no existe.
+ */
+static char *read_whole(const char *path, size_t *length) {
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        return NULL;
+    }
+    char *data = NULL;
+    size_t size = 0;
+    FILE *buffer = open_memstream(&data, &size);
+    char chunk[8192];
+    size_t n;
+    while (buffer != NULL && (n = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        fwrite(chunk, 1, n, buffer);
+    }
+    fclose(file);
+    if (buffer == NULL || fclose(buffer) != 0) {
+        free(data);
+        return NULL;
+    }
+    *length = size;
+    return data;
+}
+
+/**
+ * @brief Escribe un archivo completo.
+ *
+ * @return 0 si es exitoso, 1 si hay error.
+ */
+static int write_whole(const char *path, const char *data, size_t length) {
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return 1;
+    }
+    int failed = fwrite(data, 1, length, file) != length;
+    failed |= fclose(file) != 0;
+    return failed;
+}
+
+/**
+ * @brief Crea un directorio y sus padres (como mkdir -p).
+ */
+static int make_directories(const char *path) {
+    char partial[GOLDEN_MAX_PATH];
+    size_t length = strlen(path);
+    if (length >= sizeof(partial)) {
+        return 1;
+    }
+    memcpy(partial, path, length + 1);
+    for (size_t i = 1; i <= length; i++) {
+        if (partial[i] == '/' || partial[i] == '\0') {
+            char saved = partial[i];
+            partial[i] = '\0';
+            if (mkdir(partial, 0755) != 0 && errno != EEXIST) {
+                return 1;
+            }
+            partial[i] = saved;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Devuelve la línea @p number (desde 1) de un texto, sin el salto.
+ */
+static const char *nth_line(const char *text, size_t length, size_t number, int *shown) {
+    const char *p = text;
+    const char *end = text + length;
+    for (size_t i = 1; i < number && p < end; i++) {
+        const char *newline = memchr(p, '\n', (size_t)(end - p));
+        p = newline != NULL ? newline + 1 : end;
+    }
+    const char *newline = memchr(p, '\n', (size_t)(end - p));
+    size_t line_length = (size_t)((newline != NULL ? newline : end) - p);
+    *shown = line_length < GOLDEN_SHOWN_LINE ? (int)line_length : GOLDEN_SHOWN_LINE;
+    return p;
+}
+
+/**
+ * @brief Compara un volcado con su archivo esperado, o lo reescribe con --update.
+ */
+static void check_dump(GoldenCase *gc, const Dump *dump, const char *actual, size_t actual_len,
+                       const GoldenOptions *options, FILE *report) {
+    char expected_path[GOLDEN_MAX_PATH];
+    snprintf(expected_path, sizeof(expected_path), "%s/%s.%s",
+             options->golden_dir, gc->name, dump->extension);
+    size_t expected_len = 0;
+    char *expected = read_whole(expected_path, &expected_len);
+    int same = expected != NULL && expected_len == actual_len
+               && memcmp(expected, actual, actual_len) == 0;
+
+    if (options->update) {
+        if (!same) {
+            if (write_whole(expected_path, actual, actual_len) != 0) {
+                fprintf(report, "  %s: no se pudo escribir\n", expected_path);
+                gc->failed = 1;
+            } else {
+                gc->updated++;
+            }
+        }
+        free(expected);
+        return;
+    }
+    if (same) {
+        free(expected);
+        return;
+    }
+
+    gc->failed = 1;
+    if (expected == NULL) {
+        fprintf(report, "  %s: no existe (genérelo con --update)\n", expected_path);
+        return;
+    }
+
+    // Primera línea distinta.
+    size_t line = 1;
+    size_t i = 0;
+    while (i < expected_len && i < actual_len && expected[i] == actual[i]) {
+        if (expected[i] == '\n') {
+            line++;
+        }
+        i++;
+    }
+    int expected_shown;
+    int actual_shown;
+    const char *expected_line = nth_line(expected, expected_len, line, &expected_shown);
+    const char *actual_line = nth_line(actual, actual_len, line, &actual_shown);
+    fprintf(report, "  %s: difiere en la línea %zu\n", expected_path, line);
+    fprintf(report, "    esperado: %.*s\n", expected_shown, expected_line);
+    fprintf(report, "    obtenido: %.*s\n", actual_shown, actual_line);
+
+    char actual_path[GOLDEN_MAX_PATH];
+    snprintf(actual_path, sizeof(actual_path), "%s/%s.%s",
+             options->actual_dir, gc->name, dump->extension);
+    if (write_whole(actual_path, actual, actual_len) == 0) {
+        fprintf(report, "    diff -u %s %s\n", expected_path, actual_path);
+    }
+    free(expected);
+}
+
+/* ---- Modo diferencial ---- */
+
+/**
+ * @brief Compara los tres caminos del lexer sobre un fuente.
+ *
+ * @return 0 si coinciden, 1 si no (con el detalle en @p report).
+ */
+static int differential_source(const char *label, const char *source, unsigned flags, FILE *report) {
+    DiagEngine diag_ref;
+    DiagEngine diag_compact;
+    DiagEngine diag_stream;
+    if (diag_init(&diag_ref, 0) != 0 || diag_init(&diag_compact, 0) != 0
+            || diag_init(&diag_stream, 0) != 0) {
+        fprintf(report, "  %s: memoria insuficiente\n", label);
+        return 1;
+    }
+
+    Lexer ref;
+    Lexer compact;
+    Lexer streamed;
+    lexer_init(&ref, source);
+    lexer_init(&compact, source);
+    lexer_init(&streamed, source);
+    lexer_set_flags(&ref, flags | LEXER_GENERIC);
+    lexer_set_flags(&compact, flags);
+    lexer_set_flags(&streamed, flags);
+    lexer_set_diagnostics(&ref, &diag_ref);
+    lexer_set_diagnostics(&compact, &diag_compact);
+    lexer_set_diagnostics(&streamed, &diag_stream);
+    TokenStream *stream = (TokenStream *)malloc(sizeof(TokenStream));
+    if (stream == NULL) {
+        fprintf(report, "  %s: memoria insuficiente\n", label);
+        diag_free(&diag_ref);
+        diag_free(&diag_compact);
+        diag_free(&diag_stream);
+        return 1;
+    }
+    token_stream_init(stream, &streamed);
+
+    int failed = 0;
+    for (size_t index = 0; !failed; index++) {
+        token_t *expected = lexer_next_token(&ref);
+        LexToken fast;
+        int ok = lexer_next_compact(&compact, &fast);
+        const LexToken *queued = token_stream_peek(stream, 0);
+        if (expected == NULL || !ok) {
+            fprintf(report, "  %s: no se pudo obtener el token %zu\n", label, index);
+            free_token(expected);
+            failed = 1;
+            break;
+        }
+
+        const char *lexeme = fast.type == TOKEN_EOF ? "EOF" : source + fast.offset;
+        size_t length = fast.type == TOKEN_EOF ? 3 : fast.length;
+        int same = expected->type == fast.type && expected->line == fast.line
+                   && expected->column == fast.column && strlen(expected->lexeme) == length
+                   && memcmp(expected->lexeme, lexeme, length) == 0
+                   && memcmp(&fast, queued, sizeof(fast)) == 0;
+        if (!same) {
+            int shown = length < 40 ? (int)length : 40;
+            fprintf(report, "  %s: el token %zu difiere\n", label, index);
+            fprintf(report, "    lexer_next_token:   %s '%.40s' %zu:%zu\n",
+                    token_type_name(expected->type), expected->lexeme, expected->line, expected->column);
+            fprintf(report, "    lexer_next_compact: %s '%.*s' %u:%u\n",
+                    token_type_name(fast.type), shown, lexeme, fast.line, fast.column);
+            fprintf(report, "    token_stream_peek:  %s %u:%u (%u bytes en %u)\n",
+                    token_type_name(queued->type), queued->line, queued->column,
+                    queued->length, queued->offset);
+            failed = 1;
+        }
+        int done = expected->type == TOKEN_EOF;
+        free_token(expected);
+        if (done) {
+            break;
+        }
+        token_stream_advance(stream);
+    }
+    token_stream_destroy(stream);
+    free(stream);
+
+    if (!failed && (diag_ref.errors != diag_compact.errors || diag_ref.errors != diag_stream.errors
+                    || diag_ref.warnings != diag_compact.warnings
+                    || diag_ref.warnings != diag_stream.warnings)) {
+        fprintf(report, "  %s: los diagnósticos difieren (errores %zu/%zu/%zu, avisos %zu/%zu/%zu)\n",
+                label, diag_ref.errors, diag_compact.errors, diag_stream.errors,
+                diag_ref.warnings, diag_compact.warnings, diag_stream.warnings);
+        failed = 1;
+    }
+    diag_free(&diag_ref);
+    diag_free(&diag_compact);
+    diag_free(&diag_stream);
+    return failed;
+}
+
+/**
+ * @brief Compara cada variante que admite el fuente con la variante completa.
+ *
+ * Sin diagnósticos y con y sin LEXER_NO_POSITIONS, para que entren también
+ * las variantes que no validan UTF-8 o no llevan posiciones.
+ *
+ * @return 0 si coinciden, 1 si no (con el detalle en @p report).
+ */
+static int differential_variants(const char *label, const char *source, unsigned flags, FILE *report) {
+    static const unsigned EXTRA_FLAGS[] = { 0, LEXER_NO_POSITIONS };
+    for (size_t e = 0; e < sizeof(EXTRA_FLAGS) / sizeof(EXTRA_FLAGS[0]); e++) {
+        for (size_t v = 0; lexer_variant_at(v) != NULL; v++) {
+            Lexer ref;
+            Lexer variant;
+            lexer_init(&ref, source);
+            lexer_init(&variant, source);
+            lexer_set_flags(&ref, flags | LEXER_GENERIC);
+            lexer_set_flags(&variant, flags | EXTRA_FLAGS[e]);
+            if (lexer_set_variant(&variant, lexer_variant_at(v)) != 0) {
+                continue;
+            }
+            for (size_t index = 0;; index++) {
+                LexToken expected;
+                LexToken actual;
+                lexer_next_compact(&ref, &expected);
+                lexer_next_compact(&variant, &actual);
+                if (EXTRA_FLAGS[e] & LEXER_NO_POSITIONS) {
+                    expected.line = actual.line = 0;
+                    expected.column = actual.column = 0;
+                }
+                if (memcmp(&expected, &actual, sizeof(expected)) != 0) {
+                    fprintf(report, "  %s: la variante '%s' difiere en el token %zu\n",
+                            label, lexer_variant_at(v), index);
+                    fprintf(report, "    full: %s %u:%u (%u bytes en %u)\n",
+                            token_type_name(expected.type), expected.line, expected.column,
+                            expected.length, expected.offset);
+                    fprintf(report, "    %s: %s %u:%u (%u bytes en %u)\n", lexer_variant_at(v),
+                            token_type_name(actual.type), actual.line, actual.column,
+                            actual.length, actual.offset);
+                    return 1;
+                }
+                if (expected.type == TOKEN_EOF) {
+                    break;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Volcado de un análisis: AST (con @p with_ast), diagnósticos y contadores.
+ *
+ * @return El texto (liberar con free()), o NULL si falta memoria.
+ */
+static char *parse_report(const char *source, int threads, int with_diag, int with_ast) {
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *out = open_memstream(&text, &text_len);
+    DiagEngine diag;
+    if (out == NULL || diag_init(&diag, 0) != 0) {
+        if (out != NULL) {
+            fclose(out);
+        }
+        free(text);
+        return NULL;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    AstNode *program = NULL;
+    ParseResult result;
+    int failed;
+    if (with_ast) {
+        failed = threads > 0
+            ? parse_source_ast_parallel(source, 0, threads, with_diag ? &diag : NULL, &arena, &program, &result)
+            : parse_source_ast(source, 0, with_diag ? &diag : NULL, &arena, &program, &result);
+        if (program != NULL) {
+            ast_print(program, source, out);
+        }
+    } else {
+        failed = threads > 0 ? parse_source_parallel(source, 0, threads, with_diag ? &diag : NULL, &result)
+                             : parse_source(source, 0, with_diag ? &diag : NULL, &result);
+    }
+    arena_free(&arena);
+    diag_print(&diag, "fuente", out);
+    fprintf(out, "%d: %zu errores léxicos, %zu errores sintácticos (%zu tokens)\n",
+            failed, result.lexical_errors, result.syntax_errors, result.tokens);
+    diag_free(&diag);
+    fclose(out);
+    return text;
+}
+
+/**
+ * @brief Compara el análisis en paralelo con el serie sobre un fuente grande.
+ *
+ * El fuente concatena copias completas del ejemplo y, a mitad de camino,
+ * un prefijo suyo, de modo que la segunda mitad puede tener llaves sin
+ * cerrar o un comentario que no termina. Se compara también el AST de
+ * parse_source_ast_parallel() con el de parse_source_ast().
+ */
+static int differential_parallel(const GoldenCase *gc, const char *source, size_t length, FILE *report) {
+    size_t capacity = PARSER_PARALLEL_MIN_BYTES + 2 * (length + 1);
+    char *big = (char *)malloc(capacity + 1);
+    if (big == NULL) {
+        fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+        return 1;
+    }
+    size_t used = 0;
+    int cut = 0;
+    while (used <= PARSER_PARALLEL_MIN_BYTES && length > 0) {
+        size_t take = length;
+        if (!cut && used >= PARSER_PARALLEL_MIN_BYTES / 2) {
+            take = (length * 5) / 8;
+            cut = 1;
+        }
+        memcpy(big + used, source, take);
+        used += take;
+        big[used++] = '\n';
+    }
+    big[used] = '\0';
+
+    int failed = 0;
+    for (int mode = 3; mode >= 0 && !failed; mode--) {
+        int with_diag = mode & 1;
+        int with_ast = mode >> 1;
+        char *expected = parse_report(big, 0, with_diag, with_ast);
+        char *actual = parse_report(big, 4, with_diag, with_ast);
+        if (expected == NULL || actual == NULL) {
+            fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+            failed = 1;
+        } else if (strcmp(expected, actual) != 0) {
+            fprintf(report, "  %s (diferencial, %zu bytes%s): %s difiere de %s\n", gc->name, used,
+                    with_diag ? "" : ", sin motor",
+                    with_ast ? "parse_source_ast_parallel" : "parse_source_parallel",
+                    with_ast ? "parse_source_ast" : "parse_source");
+            failed = 1;
+        }
+        free(expected);
+        free(actual);
+    }
+    free(big);
+    return failed;
+}
+
+/**
+ * @brief AST y diagnósticos de un análisis, como texto.
+ *
+ * Con @p doc NULL se analiza @p source completo con parse_source_ast().
+ *
+ * @return El texto (liberar con free()), o NULL si falta memoria.
+ */
+static char *reparse_output(const char *source, const ReparseDocument *doc) {
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *out = open_memstream(&text, &text_len);
+    DiagEngine diag;
+    if (out == NULL || diag_init(&diag, 0) != 0) {
+        if (out != NULL) {
+            fclose(out);
+        }
+        free(text);
+        return NULL;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    AstNode *program = NULL;
+    int failed;
+    if (doc == NULL) {
+        failed = parse_source_ast(source, 0, &diag, &arena, &program, NULL);
+    } else {
+        failed = reparse_diagnostics(doc, &diag);
+        program = (AstNode *)&doc->program;
+    }
+    if (program != NULL) {
+        ast_print(program, source, out);
+    }
+    diag_print(&diag, "fuente", out);
+    fprintf(out, "%d\n", failed);
+    arena_free(&arena);
+    diag_free(&diag);
+    if (fclose(out) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Compara el análisis incremental con el completo tras ediciones aleatorias.
+ *
+ * Las ediciones (reproducibles) borran unos bytes e insertan fragmentos que
+ * abren o cierran llaves, comentarios y cadenas, o parten y unen funciones.
+ */
+static int differential_reparse(const GoldenCase *gc, const char *source, size_t length, FILE *report) {
+    static const char *const SNIPPETS[] = {
+        "", "{", "}", ";", "\n", " x", "fn g() {\n", "\n}\n", "let a = 1;\n", "/*", "*/", "\"",
+        "// c\n", "(", "return 0;", "'a'", "\xc3\xa9", "fn main() -> i32 { return 1; }\n",
+    };
+    ReparseDocument doc;
+    if (reparse_open(&doc, source, length, 0) != 0) {
+        reparse_close(&doc);
+        fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+        return 1;
+    }
+    uint64_t seed = length * 2654435761u + 1;
+    int failed = 0;
+    for (size_t e = 0; e <= GOLDEN_REPARSE_EDITS && !failed; e++) {
+        if (e > 0) {
+            seed = seed * 6364136223846793005u + 1442695040888963407u;
+            const char *text = SNIPPETS[(seed >> 33) % (sizeof(SNIPPETS) / sizeof(SNIPPETS[0]))];
+            ReparseEdit edit = { (size_t)(seed >> 40) % (doc.length + 1), 0, text, strlen(text) };
+            size_t room = doc.length - edit.offset;
+            edit.removed = (size_t)(seed >> 20) % 5 < room ? (size_t)(seed >> 20) % 5 : room;
+            if (reparse_edit(&doc, &edit, NULL) != 0) {
+                fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+                failed = 1;
+                break;
+            }
+        }
+        char *expected = reparse_output(doc.source, NULL);
+        char *actual = reparse_output(doc.source, &doc);
+        if (expected == NULL || actual == NULL) {
+            fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+            failed = 1;
+        } else if (strcmp(expected, actual) != 0) {
+            fprintf(report, "  %s (diferencial): el análisis incremental difiere del completo tras %zu ediciones\n",
+                    gc->name, e);
+            failed = 1;
+        }
+        free(expected);
+        free(actual);
+    }
+    reparse_close(&doc);
+    return failed;
+}
+
+/**
+ * @brief Variante de ejecución comparada con la máquina virtual sin optimizaciones.
+ */
+typedef struct RunVariant {
+    const char *label;
+    int run_mode;
+    int inline_calls;           /**< 0 sin expansión, 1 por omisión, 2 sin límite de costo */
+    unsigned codegen_flags;     /**< Opciones de bc_compile() */
+    unsigned vm_flags;          /**< Opciones de vm_execute() */
+} RunVariant;
+
+static const RunVariant RUN_VARIANTS[] = {
+    { "--run", DRIVER_RUN_VM, 0, 0, VM_NO_SUPERINSTRUCTIONS },
+    { "--jit --no-inline", DRIVER_RUN_JIT, 0, 0, 0 },
+    { "--run con superinstrucciones", DRIVER_RUN_VM, 0, 0, 0 },
+    { "--run con expansión en línea", DRIVER_RUN_VM, 1, 0, 0 },
+    { "--jit con expansión en línea", DRIVER_RUN_JIT, 1, 0, 0 },
+    { "--run con expansión sin límite de costo", DRIVER_RUN_VM, 2, 0, 0 },
+    { "--run con vectorización", DRIVER_RUN_VM, 0, BC_VECTORIZE, 0 },
+    { "--jit con vectorización", DRIVER_RUN_JIT, 0, BC_VECTORIZE, 0 },
+    { "--jit --vectorize=sse2", DRIVER_RUN_JIT, 0, BC_VECTORIZE | BC_SIMD_SSE2, 0 },
+    { "--jit con expansión en línea y vectorización", DRIVER_RUN_JIT, 1, BC_VECTORIZE, 0 },
+    { "--run --malloc-heap", DRIVER_RUN_VM, 0, BC_HEAP_MALLOC, 0 },
+    { "--jit --malloc-heap con expansión en línea", DRIVER_RUN_JIT, 1, BC_HEAP_MALLOC, 0 },
+};
+
+#define RUN_VARIANT_COUNT (sizeof(RUN_VARIANTS) / sizeof(RUN_VARIANTS[0]))
+
+/**
+ * @brief Compara cada variante de ejecución (JIT, superinstrucciones, expansión en línea, vectorización, memoria con malloc) con la primera.
+ */
+static int differential_run(const GoldenCase *gc, const char *source, FILE *report) {
+    char *outputs[RUN_VARIANT_COUNT] = { NULL };
+    size_t lengths[RUN_VARIANT_COUNT] = { 0 };
+    InlineOptions options[3];
+    inline_options_default(&options[1]);
+    options[2].threshold = INLINE_MAX_FUNCTION_BYTES;
+    options[2].loop_bonus = 0;
+    int failed = 0;
+    for (size_t v = 0; v < RUN_VARIANT_COUNT && !failed; v++) {
+        const RunVariant *variant = &RUN_VARIANTS[v];
+        if (variant->run_mode == DRIVER_RUN_JIT && !jit_available()) {
+            continue;
+        }
+        FILE *out = open_memstream(&outputs[v], &lengths[v]);
+        if (out == NULL) {
+            failed = 1;
+            fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+            break;
+        }
+        write_run(gc->name, source, variant->run_mode,
+                  variant->inline_calls ? &options[variant->inline_calls] : NULL, variant->codegen_flags,
+                  variant->vm_flags, NULL, out);
+        if (fclose(out) != 0) {
+            failed = 1;
+            fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+        } else if (v > 0 && (lengths[v] != lengths[0] || memcmp(outputs[v], outputs[0], lengths[0]) != 0)) {
+            fprintf(report, "  %s (diferencial): la ejecución con %s difiere de --run\n", gc->name,
+                    variant->label);
+            failed = 1;
+        }
+    }
+    for (size_t v = 0; v < RUN_VARIANT_COUNT; v++) {
+        free(outputs[v]);
+    }
+    return failed;
+}
+
+/**
+ * @brief Ejecución con --run, con o sin --incremental, como texto.
+ *
+ * @return El texto (liberar con free()), o NULL si falta memoria.
+ */
+static char *run_output(const GoldenCase *gc, const char *source, Cache *cache) {
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *out = open_memstream(&text, &text_len);
+    if (out == NULL) {
+        return NULL;
+    }
+    InlineOptions options;
+    inline_options_default(&options);
+    write_run(gc->name, source, DRIVER_RUN_VM, &options, BC_VECTORIZE, 0, cache, out);
+    if (fclose(out) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Borra una carpeta de caché temporal y sus entradas.
+ */
+static void remove_cache_dir(const char *dir) {
+    DIR *d = opendir(dir);
+    if (d != NULL) {
+        struct dirent *entry;
+        while ((entry = readdir(d)) != NULL) {
+            char path[GOLDEN_MAX_PATH];
+            if (strcmp(entry->d_name, ".") != 0 && strcmp(entry->d_name, "..") != 0
+                    && snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name) < (int)sizeof(path)) {
+                remove(path);
+            }
+        }
+        closedir(d);
+    }
+    rmdir(dir);
+}
+
+/**
+ * @brief Compara --incremental con la compilación completa.
+ *
+ * Con una caché temporal se compila el fuente en frío, otra vez (todo debe
+ * venir de la caché: sin fallos nuevos si la primera guardó algo) y con una
+ * función nueva al principio, que desplaza las líneas de todas las demás.
+ * Cada salida debe ser idéntica a la de la compilación completa del mismo fuente.
+ */
+static int differential_incremental(const GoldenCase *gc, const char *source, size_t length, FILE *report) {
+    static const char EXTRA[] = "fn golden_extra(n: i32) -> i32 {\n    return n + 1;\n}\n\n";
+    char dir[] = "/tmp/golden-cache-XXXXXX";
+    char *edited = (char *)malloc(sizeof(EXTRA) + length);
+    Cache cache;
+    if (edited == NULL || mkdtemp(dir) == NULL || cache_open(&cache, dir, 0) != 0) {
+        fprintf(report, "  %s: no se pudo crear la caché temporal\n", gc->name);
+        free(edited);
+        return 1;
+    }
+    memcpy(edited, EXTRA, sizeof(EXTRA) - 1);
+    memcpy(edited + sizeof(EXTRA) - 1, source, length + 1);
+
+    static const char *const LABELS[] = { "en frío", "con la caché llena", "tras añadir una función" };
+    int failed = 0;
+    unsigned long stored = 0;
+    for (size_t run = 0; run < 3 && !failed; run++) {
+        const char *text = run < 2 ? source : edited;
+        unsigned long misses = atomic_load(&cache.misses);
+        char *expected = run_output(gc, text, NULL);
+        char *actual = run_output(gc, text, &cache);
+        if (expected == NULL || actual == NULL) {
+            fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+            failed = 1;
+        } else if (strcmp(expected, actual) != 0) {
+            fprintf(report, "  %s (diferencial): --incremental %s difiere de la compilación completa\n",
+                    gc->name, LABELS[run]);
+            failed = 1;
+        } else if (run == 1 && stored > 0 && atomic_load(&cache.misses) != misses) {
+            fprintf(report, "  %s (diferencial): --incremental con la caché llena volvió a compilar\n",
+                    gc->name);
+            failed = 1;
+        }
+        stored = atomic_load(&cache.stores);
+        free(expected);
+        free(actual);
+    }
+    cache_close(&cache);
+    remove_cache_dir(dir);
+    free(edited);
+    return failed;
+}
+
+/**
+ * @brief Diagnósticos, llamadas expandidas, bytecode y segmento de literales
+ *        traduciendo y expandiendo con @p threads hilos, como texto.
+ *
+ * @return El texto (liberar con free()), o NULL si falta memoria.
+ */
+static char *codegen_output(const char *name, const char *source, int threads) {
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *out = open_memstream(&text, &text_len);
+    DiagEngine diag;
+    if (out == NULL || diag_init(&diag, 0) != 0) {
+        if (out != NULL) {
+            fclose(out);
+        }
+        free(text);
+        return NULL;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    AstNode *program = NULL;
+    SemaProgram sema;
+    BcModule module;
+    memset(&sema, 0, sizeof(sema));
+    memset(&module, 0, sizeof(module));
+    if (parse_source_ast(source, 0, &diag, &arena, &program, NULL) == 0
+            && sema_analyze(program, source, &diag, &sema) == 0
+            && bc_compile_parallel(&sema, BC_VECTORIZE, threads, &diag, &module) == 0) {
+        InlineOptions options;
+        InlineReport report;
+        inline_options_default(&options);
+        if (inline_module_parallel(&module, &options, threads, &report) == 0) {
+            inline_report_print(&report, &module, name, out);
+            bc_disassemble(&module, out);
+            fwrite(module.strings, 1, module.strings_length, out);
+        }
+        inline_report_free(&report);
+    }
+    diag_print(&diag, name, out);
+    bc_free(&module);
+    sema_free(&sema);
+    arena_free(&arena);
+    diag_free(&diag);
+    if (fclose(out) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Compara la traducción y la expansión en línea con varios hilos con las de un hilo.
+ */
+static int differential_codegen(const GoldenCase *gc, const char *source, FILE *report) {
+    static const int THREADS[] = { 2, 3, 8 };
+    char *expected = codegen_output(gc->name, source, 1);
+    int failed = expected == NULL;
+    for (size_t t = 0; t < sizeof(THREADS) / sizeof(THREADS[0]) && !failed; t++) {
+        char *actual = codegen_output(gc->name, source, THREADS[t]);
+        if (actual == NULL) {
+            failed = 1;
+        } else if (strcmp(expected, actual) != 0) {
+            fprintf(report, "  %s (diferencial): la traducción con %d hilos difiere de la de un hilo\n",
+                    gc->name, THREADS[t]);
+            failed = 2;
+        }
+        free(actual);
+    }
+    if (failed == 1) {
+        fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+    }
+    free(expected);
+    return failed != 0;
+}
+
+/**
+ * @brief Bytecode, literales y resultado de ejecutar un módulo con la VM y el JIT, como texto.
+ *
+ * @return El texto (liberar con free()), o NULL si falta memoria.
+ */
+static char *module_output(const BcModule *module) {
+    char *text = NULL;
+    size_t text_len = 0;
+    FILE *out = open_memstream(&text, &text_len);
+    if (out == NULL) {
+        return NULL;
+    }
+    bc_disassemble(module, out);
+    for (size_t f = 0; f < module->function_count; f++) {
+        const BcFunction *function = &module->functions[f];
+        fprintf(out, "%.*s:", (int)function->name_length, function->name);
+        for (size_t i = 0; i < function->line_count; i++) {
+            fprintf(out, " %u@%u", function->lines[i].line, function->lines[i].pc);
+        }
+        fputc('\n', out);
+    }
+    fwrite(module->strings, 1, module->strings_length, out);
+    RunResult result;
+    int status = vm_execute(module, 0, NULL, out, &result);
+    fprintf(out, "=> %d %d %d\n", status, (int)result.status, result.value);
+    if (jit_available()) {
+        status = jit_run(module, out, &result);
+        fprintf(out, "=> %d %d %d\n", status, (int)result.status, result.value);
+    }
+    if (fclose(out) != 0) {
+        free(text);
+        return NULL;
+    }
+    return text;
+}
+
+/**
+ * @brief Escritura de print() en check_sample(): toma una muestra como lo haría SIGPROF.
+ */
+static ssize_t sample_on_write(void *cookie, const char *data, size_t size) {
+    (void)data;
+    Sampler *sampler = (Sampler *)cookie;
+    if (sampler->walk != NULL) {
+        sampler->walk(sampler, NULL);
+    }
+    return (ssize_t)size;
+}
+
+/**
+ * @brief Indica si el código de @p function tiene una llamada a @p callee.
+ */
+static int calls_function(const BcFunction *function, uint32_t callee) {
+    for (size_t pc = 0; pc < function->length; pc += 1 + bc_operand_size((BcOp)function->code[pc])) {
+        if (function->code[pc] == BC_CALL && bc_read_u16(function->code + pc + 1) == callee) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Toma muestras de --prof con la máquina virtual, sin temporizador.
+ *
+ * Cada print() toma una muestra desde dentro de la instrucción, como si la
+ * señal llegara en ese momento: cada pila debe terminar en main y su
+ * posición más interna caer en una línea del fuente. La cadena de
+ * expansiones de esa posición debe acabar en su función de origen, y cada
+ * nivel debe ser una llamada del anterior en @p plain, el mismo programa
+ * traducido sin expandir.
+ */
+static int check_sample(const GoldenCase *gc, const BcModule *module, const BcModule *plain, const char *source,
+                        FILE *report) {
+    Sampler sampler;
+    if (sampler_init(&sampler, SAMPLER_DEFAULT_INTERVAL_US) != 0) {
+        fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+        return 1;
+    }
+    cookie_io_functions_t io = { NULL, sample_on_write, NULL, NULL };
+    FILE *out = fopencookie(&sampler, "w", io);
+    if (out == NULL) {
+        fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+        sampler_free(&sampler);
+        return 1;
+    }
+    setvbuf(out, NULL, _IONBF, 0);
+    RunResult result;
+    vm_execute_sampled(module, 0, &sampler, out, &result);
+    fclose(out);
+    uint32_t lines = 1;
+    for (const char *c = source; *c != '\0'; c++) {
+        lines += *c == '\n';
+    }
+    int failed = 0;
+    for (size_t w = 0; w < sampler.length && !failed; w += 1 + (size_t)sampler.words[w]) {
+        size_t count = (size_t)sampler.words[w];
+        uint64_t inner = sampler.words[w + 1];
+        uint64_t outer = sampler.words[w + count];
+        uint32_t line = bc_line(&module->functions[inner >> 32], (uint32_t)inner);
+        if ((outer >> 32) != module->main_index || line == 0 || line > lines) {
+            fprintf(report, "  %s (diferencial): la muestra de --prof no empieza en main o cae en la línea %u\n",
+                    gc->name, line);
+            failed = 1;
+        }
+        const BcFunction *function = &module->functions[inner >> 32];
+        uint32_t chain[16];
+        size_t depth = bc_origin_chain(function, (uint32_t)inner, chain, 16);
+        uint32_t caller = (uint32_t)(inner >> 32);
+        int nested = depth <= 16 && bc_origin(function, (uint32_t)inner) == (depth > 0 ? chain[depth - 1] : caller);
+        for (size_t d = 0; d < depth && nested; d++) {
+            nested = calls_function(&plain->functions[caller], chain[d]);
+            caller = chain[d];
+        }
+        if (!failed && !nested) {
+            fprintf(report, "  %s (diferencial): la cadena de expansiones de la línea %u no coincide con los tramos\n",
+                    gc->name, line);
+            failed = 1;
+        }
+    }
+    sampler_free(&sampler);
+    return failed;
+}
+
+/**
+ * @brief Compara un módulo guardado con image_write() y abierto con image_open() con el traducido.
+ *
+ * El bytecode, las líneas, los literales y la ejecución deben coincidir, y
+ * la misma imagen con un byte cambiado debe rechazarse por su suma. Los
+ * programas con errores no producen módulo y no se comparan; los demás
+ * también se muestrean (check_sample()) frente a su traducción sin
+ * expansión en línea.
+ */
+static int differential_module(const GoldenCase *gc, const char *source, FILE *report) {
+    DiagEngine diag;
+    if (diag_init(&diag, 0) != 0) {
+        fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+        return 1;
+    }
+    Arena arena;
+    arena_init(&arena, 0);
+    AstNode *program = NULL;
+    SemaProgram sema;
+    BcModule module;
+    BcModule plain;
+    InlineOptions options;
+    InlineReport inlined;
+    memset(&sema, 0, sizeof(sema));
+    memset(&module, 0, sizeof(module));
+    memset(&plain, 0, sizeof(plain));
+    memset(&inlined, 0, sizeof(inlined));
+    inline_options_default(&options);
+    int compiled = parse_source_ast(source, 0, &diag, &arena, &program, NULL) == 0
+                && sema_analyze(program, source, &diag, &sema) == 0
+                && bc_compile(&sema, BC_VECTORIZE, &diag, &module) == 0
+                && bc_compile(&sema, BC_VECTORIZE, &diag, &plain) == 0
+                && inline_module(&module, &options, &inlined) == 0;
+    int failed = compiled && check_sample(gc, &module, &plain, source, report);
+    char path[] = "/tmp/golden-module-XXXXXX";
+    int fd = compiled ? mkstemp(path) : -1;
+    if (compiled) {
+        FILE *file = fd >= 0 ? fdopen(fd, "wb") : NULL;
+        int written = file != NULL && image_write(&module, file) == 0;
+        long size = file != NULL ? ftell(file) : -1;
+        written &= file != NULL && fclose(file) == 0;
+        if (file == NULL && fd >= 0) {
+            close(fd);
+        }
+        BcImage image;
+        BcModule loaded;
+        ImageStatus status = written ? image_open(path, &image, &loaded) : IMAGE_IO;
+        char *expected = module_output(&module);
+        char *actual = status == IMAGE_OK ? module_output(&loaded) : NULL;
+        if (status != IMAGE_OK) {
+            fprintf(report, "  %s (diferencial): no se pudo cargar el módulo: %s\n", gc->name,
+                    image_status_message(status));
+            failed = 1;
+        } else if (expected == NULL || actual == NULL) {
+            fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+            failed = 1;
+        } else if (strcmp(expected, actual) != 0) {
+            fprintf(report, "  %s (diferencial): el módulo cargado difiere del traducido\n", gc->name);
+            failed = 1;
+        }
+        if (status == IMAGE_OK) {
+            image_close(&image, &loaded);
+        }
+        free(expected);
+        free(actual);
+
+        // Un byte cambiado al final (en el código o en el relleno) debe rechazarse.
+        FILE *corrupt = !failed ? fopen(path, "r+b") : NULL;
+        if (corrupt != NULL) {
+            int c = fseek(corrupt, size - 1, SEEK_SET) == 0 ? fgetc(corrupt) : EOF;
+            int changed = c != EOF && fseek(corrupt, size - 1, SEEK_SET) == 0 && fputc(c ^ 0x5a, corrupt) != EOF;
+            changed &= fclose(corrupt) == 0;
+            status = changed ? image_open(path, &image, &loaded) : IMAGE_IO;
+            if (status == IMAGE_OK) {
+                image_close(&image, &loaded);
+            }
+            if (status != IMAGE_CHECKSUM) {
+                fprintf(report, "  %s (diferencial): un módulo dañado no se rechazó por su suma (%s)\n",
+                        gc->name, image_status_message(status));
+                failed = 1;
+            }
+        }
+        remove(path);
+    }
+    inline_report_free(&inlined);
+    bc_free(&module);
+    bc_free(&plain);
+    sema_free(&sema);
+    arena_free(&arena);
+    diag_free(&diag);
+    return failed;
+}
+
+/**
+ * @brief Modo diferencial sobre el fuente completo y sus prefijos.
+ *
+ * Se detiene en la primera diferencia para no inundar el reporte.
+ */
+static int differential_case(const GoldenCase *gc, const char *source, size_t length, FILE *report) {
+    static const unsigned FLAG_SETS[] = { 0, LEXER_UTF8_COLUMNS };
+    char *prefix = (char *)malloc(length + 1);
+    if (prefix == NULL) {
+        fprintf(report, "  %s: memoria insuficiente\n", gc->name);
+        return 1;
+    }
+    size_t previous_cut = (size_t)-1;
+    for (size_t cut = 0; cut <= GOLDEN_PREFIX_CUTS; cut++) {
+        // Cortes repartidos uniformemente, desplazados para no caer siempre en el mismo byte.
+        size_t at = cut == GOLDEN_PREFIX_CUTS ? length : (length * cut + cut * 7) / GOLDEN_PREFIX_CUTS;
+        if (at > length || at == previous_cut) {
+            continue;
+        }
+        previous_cut = at;
+        memcpy(prefix, source, at);
+        prefix[at] = '\0';
+        for (size_t f = 0; f < sizeof(FLAG_SETS) / sizeof(FLAG_SETS[0]); f++) {
+            char label[GOLDEN_MAX_PATH];
+            snprintf(label, sizeof(label), "%s (diferencial, %zu de %zu bytes%s)", gc->name, at,
+                     length, FLAG_SETS[f] & LEXER_UTF8_COLUMNS ? ", --utf8-columns" : "");
+            if (differential_source(label, prefix, FLAG_SETS[f], report) != 0
+                    || differential_variants(label, prefix, FLAG_SETS[f], report) != 0) {
+                free(prefix);
+                return 1;
+            }
+        }
+    }
+    free(prefix);
+    return differential_parallel(gc, source, length, report) || differential_reparse(gc, source, length, report)
+        || differential_run(gc, source, report)
+        || differential_codegen(gc, source, report) || differential_incremental(gc, source, length, report)
+        || differential_module(gc, source, report);
+}
+
+/* ---- Ejecución ---- */
+
+/**
+ * @brief Ejecuta todas las comprobaciones de un caso.
+ */
+static void run_case(GoldenCase *gc, const GoldenOptions *options) {
+    FILE *report = open_memstream(&gc->report, &gc->report_len);
+    if (report == NULL) {
+        gc->failed = 1;
+        return;
+    }
+    if (gc->batch) {
+        char *actual = NULL;
+        size_t actual_len = 0;
+        FILE *out = open_memstream(&actual, &actual_len);
+        int dump_failed = out == NULL || BATCH_DUMP.write(gc->name, gc->path, out) != 0;
+        if (out != NULL) {
+            dump_failed |= fclose(out) != 0;
+        }
+        if (dump_failed) {
+            fprintf(report, "  %s: falló el volcado %s\n", gc->name, BATCH_DUMP.extension);
+            gc->failed = 1;
+        } else {
+            check_dump(gc, &BATCH_DUMP, actual, actual_len, options, report);
+        }
+        free(actual);
+        fclose(report);
+        return;
+    }
+    size_t length = 0;
+    char *source = read_whole(gc->path, &length);
+    if (source == NULL) {
+        fprintf(report, "  %s: no se pudo leer\n", gc->path);
+        gc->failed = 1;
+        fclose(report);
+        return;
+    }
+    // Los volcados esperan un fuente terminado en '\0'.
+    char *terminated = (char *)realloc(source, length + 1);
+    if (terminated == NULL) {
+        free(source);
+        gc->failed = 1;
+        fclose(report);
+        return;
+    }
+    source = terminated;
+    source[length] = '\0';
+
+    for (size_t d = 0; d < DUMP_COUNT; d++) {
+        char *actual = NULL;
+        size_t actual_len = 0;
+        FILE *out = open_memstream(&actual, &actual_len);
+        int dump_failed = out == NULL || DUMPS[d].write(gc->name, source, out) != 0;
+        if (out != NULL) {
+            dump_failed |= fclose(out) != 0;
+        }
+        if (dump_failed) {
+            fprintf(report, "  %s: falló el volcado %s\n", gc->name, DUMPS[d].extension);
+            gc->failed = 1;
+        } else {
+            check_dump(gc, &DUMPS[d], actual, actual_len, options, report);
+        }
+        free(actual);
+    }
+    if (options->differential && differential_case(gc, source, length, report) != 0) {
+        gc->failed = 1;
+    }
+    free(source);
+    fclose(report);
+}
+
+/**
+ * @brief Bucle de un hilo de trabajo: toma casos hasta agotarlos.
+ */
+static void *worker_main(void *arg) {
+    GoldenRun *run = (GoldenRun *)arg;
+    for (;;) {
+        size_t index = atomic_fetch_add(&run->next, 1);
+        if (index >= run->count) {
+            return NULL;
+        }
+        run_case(&run->cases[index], run->options);
+    }
+}
+
+/**
+ * @brief Indica si un archivo es un fuente de prueba (*.txt).
+ */
+static int is_test_source(const char *name) {
+    size_t length = strlen(name);
+    return name[0] != '.' && length > 4 && strcmp(name + length - 4, ".txt") == 0;
+}
+
+/**
+ * @brief Agrega un caso para @p path.
+ */
+static int add_case(GoldenCase **cases, size_t *count, size_t *capacity, const char *path) {
+    if (*count == *capacity) {
+        size_t grown = *capacity > 0 ? *capacity * 2 : 16;
+        GoldenCase *larger = (GoldenCase *)realloc(*cases, grown * sizeof(GoldenCase));
+        if (larger == NULL) {
+            return 1;
+        }
+        *cases = larger;
+        *capacity = grown;
+    }
+    const char *base = strrchr(path, '/');
+    base = base != NULL ? base + 1 : path;
+    size_t base_len = strlen(base);
+    if (base_len > 4 && strcmp(base + base_len - 4, ".txt") == 0) {
+        base_len -= 4;
+    }
+    GoldenCase *gc = &(*cases)[*count];
+    memset(gc, 0, sizeof(*gc));
+    gc->path = strdup(path);
+    gc->name = strndup(base, base_len);
+    if (gc->path == NULL || gc->name == NULL) {
+        free(gc->path);
+        free(gc->name);
+        return 1;
+    }
+    (*count)++;
+    return 0;
+}
+
+/**
+ * @brief Agrega los *.txt de un directorio (sin recursión).
+ */
+static int add_directory(GoldenCase **cases, size_t *count, size_t *capacity, const char *dir_path) {
+    DIR *dir = opendir(dir_path);
+    if (dir == NULL) {
+        fprintf(stderr, "Error: No se pudo abrir el directorio '%s'\n", dir_path);
+        return 1;
+    }
+    int status = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (!is_test_source(entry->d_name)) {
+            continue;
+        }
+        char child[GOLDEN_MAX_PATH];
+        snprintf(child, sizeof(child), "%s/%s", dir_path, entry->d_name);
+        status |= add_case(cases, count, capacity, child);
+    }
+    closedir(dir);
+    return status;
+}
+
+/**
+ * @brief Comparador para ejecutar y reportar los casos por nombre.
+ */
+static int compare_cases(const void *a, const void *b) {
+    return strcmp(((const GoldenCase *)a)->name, ((const GoldenCase *)b)->name);
+}
+
+/**
+ * @brief Imprime la ayuda de uso.
+ */
+static void print_usage(const char *program_name) {
+    printf("Uso: %s [opciones] <archivo.txt|directorio>...\n", program_name);
+    printf("Opciones:\n");
+    printf("  --update            Reescribir los archivos esperados con la salida actual\n");
+    printf("  --differential      Comparar lexer_next_token, lexer_next_compact y TokenStream,\n");
+    printf("                      el parser en paralelo y el JIT con la máquina virtual\n");
+    printf("  --batch <dir>       Comparar los diagnósticos de -p por lotes sobre el directorio (.batch)\n");
+    printf("  -j <n>              Hilos de trabajo (por defecto, núcleos disponibles)\n");
+    printf("  --golden-dir <dir>  Archivos esperados (por defecto %s)\n", GOLDEN_DEFAULT_DIR);
+    printf("  --actual-dir <dir>  Salidas que no coinciden (por defecto %s)\n", GOLDEN_DEFAULT_ACTUAL_DIR);
+    printf("Volcados:");
+    for (size_t d = 0; d < DUMP_COUNT; d++) {
+        printf(" .%s", DUMPS[d].extension);
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Función principal de las pruebas golden.
+ */
+int main(int argc, char *argv[]) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    GoldenOptions options = {
+        GOLDEN_DEFAULT_DIR, GOLDEN_DEFAULT_ACTUAL_DIR, 0, 0, cpus > 0 ? (int)cpus : 1
+    };
+    GoldenCase *cases = NULL;
+    size_t count = 0;
+    size_t capacity = 0;
+    int status = 0;
+
+    for (int i = 1; i < argc; i++) {
+        int has_value = i + 1 < argc;
+        if (strcmp(argv[i], "--update") == 0) {
+            options.update = 1;
+        } else if (strcmp(argv[i], "--differential") == 0) {
+            options.differential = 1;
+        } else if (strcmp(argv[i], "--batch") == 0 && has_value) {
+            if (add_case(&cases, &count, &capacity, argv[++i]) != 0) {
+                status = 1;
+            } else {
+                cases[count - 1].batch = 1;
+            }
+        } else if (strcmp(argv[i], "-j") == 0 && has_value && atoi(argv[i + 1]) > 0) {
+            options.threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--golden-dir") == 0 && has_value) {
+            options.golden_dir = argv[++i];
+        } else if (strcmp(argv[i], "--actual-dir") == 0 && has_value) {
+            options.actual_dir = argv[++i];
+        } else if (strcmp(argv[i], "-h") == 0 || strcmp(argv[i], "--help") == 0) {
+            print_usage(argv[0]);
+            return 0;
+        } else if (argv[i][0] != '-') {
+            struct stat st;
+            if (stat(argv[i], &st) == 0 && S_ISDIR(st.st_mode)) {
+                status |= add_directory(&cases, &count, &capacity, argv[i]);
+            } else {
+                status |= add_case(&cases, &count, &capacity, argv[i]);
+            }
+        } else {
+            fprintf(stderr, "Error: Opción desconocida o sin valor '%s'\n\n", argv[i]);
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (count == 0) {
+        fprintf(stderr, "Error: No se indicaron fuentes de prueba\n\n");
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (make_directories(options.update ? options.golden_dir : options.actual_dir) != 0) {
+        fprintf(stderr, "Error: No se pudo crear el directorio de salida\n");
+        return 1;
+    }
+    qsort(cases, count, sizeof(GoldenCase), compare_cases);
+
+    GoldenRun run;
+    run.cases = cases;
+    run.count = count;
+    atomic_init(&run.next, 0);
+    run.options = &options;
+    int threads = (size_t)options.threads < count ? options.threads : (int)count;
+    pthread_t *workers = (pthread_t *)malloc((size_t)threads * sizeof(pthread_t));
+    int started = 0;
+    while (workers != NULL && started < threads
+           && pthread_create(&workers[started], NULL, worker_main, &run) == 0) {
+        started++;
+    }
+    if (started == 0) {
+        worker_main(&run);
+    }
+    for (int t = 0; t < started; t++) {
+        pthread_join(workers[t], NULL);
+    }
+    free(workers);
+
+    size_t failed = 0;
+    size_t updated = 0;
+    for (size_t i = 0; i < count; i++) {
+        GoldenCase *gc = &cases[i];
+        printf("%s %s\n", gc->failed ? "✗" : "✓", gc->name);
+        if (gc->report != NULL) {
+            fwrite(gc->report, 1, gc->report_len, stdout);
+        }
+        failed += gc->failed != 0;
+        updated += (size_t)gc->updated;
+        free(gc->report);
+        free(gc->path);
+        free(gc->name);
+    }
+    free(cases);
+
+    if (options.update) {
+        printf("\n%zu archivos esperados actualizados en %s\n", updated, options.golden_dir);
+    }
+    if (failed > 0) {
+        printf("\n✗ %zu de %zu casos fallaron\n", failed, count);
+        return 1;
+    }
+    printf("\n✓ %zu casos correctos%s\n", count, options.differential ? " (con modo diferencial)" : "");
+    return status;
+}
@@ -0,0 +1,65 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             1568
+Comentarios:       146 bytes (9.3%)
+Líneas:            77 (69 con código)
+Tokens:            458 (5.95 por línea, 6.64 por línea con código)
+  IDENT                   116   25.3%
+  NUMBER                   28    6.1%
+  STRING                   17    3.7%
+  KW_FN                     7    1.5%
+  KW_LET                   10    2.2%
+  KW_MUT                    4    0.9%
+  KW_IF                     1    0.2%
+  KW_MATCH                  1    0.2%
+  KW_FOR                    4    0.9%
+  KW_IN                     4    0.9%
+  KW_RETURN                 7    1.5%
+  KW_I32                    6    1.3%
+  PLUS                      5    1.1%
+  MINUS                     8    1.7%
+  STAR                      2    0.4%
+  PERCENT                   1    0.2%
+  EQUAL                     9    2.0%
+  EQUAL_EQUAL               4    0.9%
+  BANG_EQUAL                1    0.2%
+  GREATER                   7    1.5%
+  PLUS_EQUAL                5    1.1%
+  ARROW                     3    0.7%
+  DOT                       8    1.7%
+  COMMA                    13    2.8%
+  SEMICOLON                43    9.4%
+  COLON                     8    1.7%
+  LPAREN                   48   10.5%
+  RPAREN                   48   10.5%
+  LBRACE                   13    2.8%
+  RBRACE                   13    2.8%
+  LBRACKET                  7    1.5%
+  RBRACKET                  7    1.5%
+Literales numéricos:
+  integer                  28
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 3.37, máxima 10):
+    1                      53   45.7%
+    2                       4    3.4%
+    3                       6    5.2%
+    4                       4    3.4%
+    5                      27   23.3%
+    6                      11    9.5%
+    7                       3    2.6%
+    9                       6    5.2%
+   10                       2    1.7%
+Identificadores más frecuentes (estimados; error <= 0.1 con prob. 98%):
+    1. print                                  21
+    2. s                                      10
+    3. a                                       9
+    4. i                                       8
+    5. String                                  7
+    6. len                                     6
+    7. n                                       6
+    8. t                                       6
+    9. at                                      4
+   10. total                                   4
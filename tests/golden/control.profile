@@ -0,0 +1,75 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             1158
+Comentarios:       41 bytes (3.5%)
+Líneas:            67 (61 con código)
+Tokens:            297 (4.43 por línea, 4.87 por línea con código)
+  IDENT                    58   19.5%
+  NUMBER                   37   12.5%
+  CHAR                      6    2.0%
+  KW_FN                     3    1.0%
+  KW_LET                    5    1.7%
+  KW_MUT                    4    1.3%
+  KW_IF                     5    1.7%
+  KW_MATCH                  1    0.3%
+  KW_WHILE                  1    0.3%
+  KW_LOOP                   1    0.3%
+  KW_FOR                    2    0.7%
+  KW_IN                     2    0.7%
+  KW_BREAK                  2    0.7%
+  KW_CONTINUE               1    0.3%
+  KW_RETURN                 4    1.3%
+  KW_TRUE                   1    0.3%
+  KW_FALSE                  2    0.7%
+  KW_I32                    4    1.3%
+  KW_BOOL                   1    0.3%
+  PLUS                      2    0.7%
+  MINUS                     6    2.0%
+  STAR                      4    1.3%
+  SLASH                     1    0.3%
+  PERCENT                   2    0.7%
+  EQUAL                     5    1.7%
+  EQUAL_EQUAL               3    1.0%
+  BANG                      1    0.3%
+  LESS                      1    0.3%
+  LESS_EQUAL                1    0.3%
+  GREATER                   4    1.3%
+  GREATER_EQUAL             1    0.3%
+  OR_OR                     1    0.3%
+  PLUS_EQUAL                3    1.0%
+  MINUS_EQUAL               1    0.3%
+  STAR_EQUAL                1    0.3%
+  SLASH_EQUAL               1    0.3%
+  PERCENT_EQUAL             1    0.3%
+  ARROW                     4    1.3%
+  DOT                       4    1.3%
+  SEMICOLON                37   12.5%
+  COLON                     3    1.0%
+  LPAREN                   21    7.1%
+  RPAREN                   21    7.1%
+  LBRACE                   14    4.7%
+  RBRACE                   14    4.7%
+Literales numéricos:
+  integer                  33
+  real                      0
+  exponent                  0
+  hex                       3
+  binary                    1
+Longitud de identificadores (media 3.19, máxima 8):
+    1                      26   44.8%
+    3                       5    8.6%
+    4                       3    5.2%
+    5                      16   27.6%
+    6                       6   10.3%
+    8                       2    3.4%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. print                                  16
+    2. n                                       8
+    3. x                                       6
+    4. d                                       5
+    5. dia                                     5
+    6. k                                       4
+    7. primos                                  4
+    8. c                                       3
+    9. nombre                                  2
+   10. otro                                    2
@@ -0,0 +1,36 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             179
+Comentarios:       69 bytes (38.5%)
+Líneas:            9 (7 con código)
+Tokens:            38 (4.22 por línea, 5.43 por línea con código)
+  IDENT                     7   18.4%
+  NUMBER                    4   10.5%
+  KW_FN                     2    5.3%
+  KW_RETURN                 1    2.6%
+  KW_I32                    2    5.3%
+  PLUS                      2    5.3%
+  MINUS                     1    2.6%
+  GREATER                   1    2.6%
+  SEMICOLON                 3    7.9%
+  COLON                     1    2.6%
+  LPAREN                    5   13.2%
+  RPAREN                    5   13.2%
+  LBRACE                    2    5.3%
+  RBRACE                    2    5.3%
+Literales numéricos:
+  integer                   4
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 5.00, máxima 8):
+    1                       2   28.6%
+    4                       1   14.3%
+    5                       1   14.3%
+    8                       3   42.9%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. infinita                                3
+    2. n                                       2
+    3. main                                    1
+    4. print                                   1
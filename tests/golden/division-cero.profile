@@ -0,0 +1,43 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             282
+Comentarios:       54 bytes (19.1%)
+Líneas:            13 (11 con código)
+Tokens:            77 (5.92 por línea, 7.00 por línea con código)
+  IDENT                    15   19.5%
+  NUMBER                    9   11.7%
+  KW_FN                     2    2.6%
+  KW_LET                    1    1.3%
+  KW_RETURN                 2    2.6%
+  KW_I32                    4    5.2%
+  MINUS                     6    7.8%
+  SLASH                     2    2.6%
+  PERCENT                   1    1.3%
+  EQUAL                     1    1.3%
+  GREATER                   2    2.6%
+  COMMA                     3    3.9%
+  SEMICOLON                 7    9.1%
+  COLON                     2    2.6%
+  LPAREN                    8   10.4%
+  RPAREN                    8   10.4%
+  LBRACE                    2    2.6%
+  RBRACE                    2    2.6%
+Literales numéricos:
+  integer                   9
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 4.47, máxima 7):
+    1                       4   26.7%
+    4                       1    6.7%
+    5                       4   26.7%
+    6                       3   20.0%
+    7                       3   20.0%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. print                                   4
+    2. dividir                                 3
+    3. minimo                                  3
+    4. a                                       2
+    5. b                                       2
+    6. main                                    1
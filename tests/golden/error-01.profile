@@ -0,0 +1,24 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             50
+Comentarios:       0 bytes (0.0%)
+Líneas:            2 (2 con código)
+Tokens:            12 (6.00 por línea, 6.00 por línea con código)
+  IDENT                     2   16.7%
+  NUMBER                    2   16.7%
+  KW_LET                    2   16.7%
+  EQUAL                     2   16.7%
+  SEMICOLON                 2   16.7%
+  UNKNOWN                   2   16.7%
+Literales numéricos:
+  integer                   2
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 12.00, máxima 13):
+   11                       1   50.0%
+   13                       1   50.0%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. mi_variable                             1
+    2. otra_variable                           1
@@ -0,0 +1,23 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             40
+Comentarios:       0 bytes (0.0%)
+Líneas:            2 (2 con código)
+Tokens:            11 (5.50 por línea, 5.50 por línea con código)
+  IDENT                     2   18.2%
+  NUMBER                    3   27.3%
+  KW_LET                    2   18.2%
+  EQUAL                     2   18.2%
+  SEMICOLON                 2   18.2%
+Literales numéricos:
+  integer                   3
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 9.00, máxima 12):
+    6                       1   50.0%
+   12                       1   50.0%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. mi__variable                            1
+    2. numero                                  1
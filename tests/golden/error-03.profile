@@ -0,0 +1,28 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             87
+Comentarios:       0 bytes (0.0%)
+Líneas:            3 (3 con código)
+Tokens:            19 (6.33 por línea, 6.33 por línea con código)
+  IDENT                     4   21.1%
+  NUMBER                    5   26.3%
+  KW_LET                    3   15.8%
+  EQUAL                     3   15.8%
+  DOT                       1    5.3%
+  SEMICOLON                 3   15.8%
+Literales numéricos:
+  integer                   2
+  real                      1
+  exponent                  0
+  hex                       1
+  binary                    1
+Longitud de identificadores (media 11.00, máxima 16):
+    1                       1   25.0%
+   12                       1   25.0%
+   15                       1   25.0%
+   16                       1   25.0%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. G                                       1
+    2. binario_malo                            1
+    3. hexadecimal_malo                        1
+    4. numero_invalido                         1
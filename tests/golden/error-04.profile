@@ -0,0 +1,31 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             111
+Comentarios:       24 bytes (21.6%)
+Líneas:            5 (3 con código)
+Tokens:            11 (2.20 por línea, 3.67 por línea con código)
+  IDENT                     7   63.6%
+  KW_LET                    1    9.1%
+  EQUAL                     1    9.1%
+  DOT                       1    9.1%
+  UNKNOWN                   1    9.1%
+Literales numéricos:
+  integer                   0
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 4.86, máxima 10):
+    2                       2   28.6%
+    3                       1   14.3%
+    5                       1   14.3%
+    6                       2   28.6%
+   10                       1   14.3%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. bloque                                  1
+    2. cierra                                  1
+    3. de                                      1
+    4. nunca                                   1
+    5. que                                     1
+    6. se                                      1
+    7. texto_malo                              1
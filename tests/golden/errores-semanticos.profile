@@ -0,0 +1,52 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             400
+Comentarios:       57 bytes (14.2%)
+Líneas:            24 (21 con código)
+Tokens:            105 (4.38 por línea, 5.00 por línea con código)
+  IDENT                    20   19.0%
+  NUMBER                    9    8.6%
+  STRING                    2    1.9%
+  KW_FN                     3    2.9%
+  KW_LET                    6    5.7%
+  KW_IF                     1    1.0%
+  KW_BREAK                  1    1.0%
+  KW_RETURN                 3    2.9%
+  KW_TRUE                   1    1.0%
+  KW_I32                    4    3.8%
+  KW_BOOL                   2    1.9%
+  PLUS                      1    1.0%
+  MINUS                     3    2.9%
+  STAR                      1    1.0%
+  EQUAL                     7    6.7%
+  LESS                      1    1.0%
+  GREATER                   3    2.9%
+  COMMA                     1    1.0%
+  SEMICOLON                13   12.4%
+  COLON                     3    2.9%
+  LPAREN                    6    5.7%
+  RPAREN                    6    5.7%
+  LBRACE                    4    3.8%
+  RBRACE                    4    3.8%
+Literales numéricos:
+  integer                   8
+  real                      1
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 2.90, máxima 11):
+    1                      13   65.0%
+    5                       5   25.0%
+    9                       1    5.0%
+   11                       1    5.0%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. a                                       4
+    2. x                                       4
+    3. doble                                   3
+    4. print                                   2
+    5. b                                       1
+    6. c                                       1
+    7. desconocida                             1
+    8. principal                               1
+    9. r                                       1
+   10. s                                       1
@@ -0,0 +1,45 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             273
+Comentarios:       19 bytes (7.0%)
+Líneas:            13 (9 con código)
+Tokens:            63 (4.85 por línea, 7.00 por línea con código)
+  IDENT                    13   20.6%
+  NUMBER                    8   12.7%
+  KW_FN                     1    1.6%
+  KW_LET                    6    9.5%
+  KW_MUT                    1    1.6%
+  KW_I32                    2    3.2%
+  KW_F64                    1    1.6%
+  PLUS                      2    3.2%
+  STAR                      1    1.6%
+  PERCENT                   1    1.6%
+  EQUAL                     7   11.1%
+  EQUAL_EQUAL               1    1.6%
+  GREATER                   1    1.6%
+  SEMICOLON                 7   11.1%
+  COLON                     3    4.8%
+  LPAREN                    3    4.8%
+  RPAREN                    3    4.8%
+  LBRACE                    1    1.6%
+  RBRACE                    1    1.6%
+Literales numéricos:
+  integer                   8
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 7.00, máxima 9):
+    2                       1    7.7%
+    4                       1    7.7%
+    5                       2   15.4%
+    8                       6   46.2%
+    9                       3   23.1%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. contador                                4
+    2. resultado                               3
+    3. cinco                                   2
+    4. es_igual                                1
+    5. es_mayor                                1
+    6. main                                    1
+    7. pi                                      1
@@ -0,0 +1,40 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             194
+Comentarios:       0 bytes (0.0%)
+Líneas:            10 (9 con código)
+Tokens:            33 (3.30 por línea, 3.67 por línea con código)
+  IDENT                     5   15.2%
+  NUMBER                    1    3.0%
+  STRING                    2    6.1%
+  KW_FN                     1    3.0%
+  KW_LET                    2    6.1%
+  KW_IF                     2    6.1%
+  KW_ELSE                   1    3.0%
+  KW_TRUE                   1    3.0%
+  KW_I32                    1    3.0%
+  EQUAL                     2    6.1%
+  BANG                      1    3.0%
+  GREATER_EQUAL             1    3.0%
+  SEMICOLON                 2    6.1%
+  COLON                     1    3.0%
+  LPAREN                    1    3.0%
+  RPAREN                    1    3.0%
+  LBRACE                    4   12.1%
+  RBRACE                    4   12.1%
+Literales numéricos:
+  integer                   1
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 9.60, máxima 19):
+    4                       2   40.0%
+    7                       1   20.0%
+   14                       1   20.0%
+   19                       1   20.0%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. edad                                    2
+    2. mensaje                                 1
+    3. mensaje_alternativo                     1
+    4. verificar_edad                          1
@@ -0,0 +1,43 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             255
+Comentarios:       0 bytes (0.0%)
+Líneas:            19 (17 con código)
+Tokens:            56 (2.95 por línea, 3.29 por línea con código)
+  IDENT                     8   14.3%
+  NUMBER                    7   12.5%
+  KW_FN                     1    1.8%
+  KW_LET                    1    1.8%
+  KW_MUT                    1    1.8%
+  KW_IF                     2    3.6%
+  KW_WHILE                  1    1.8%
+  KW_LOOP                   1    1.8%
+  KW_FOR                    1    1.8%
+  KW_IN                     1    1.8%
+  KW_BREAK                  2    3.6%
+  KW_CONTINUE               1    1.8%
+  KW_I32                    1    1.8%
+  PLUS                      1    1.8%
+  EQUAL                     2    3.6%
+  EQUAL_EQUAL               2    3.6%
+  LESS                      1    1.8%
+  DOT                       2    3.6%
+  SEMICOLON                 5    8.9%
+  COLON                     1    1.8%
+  LPAREN                    1    1.8%
+  RPAREN                    1    1.8%
+  LBRACE                    6   10.7%
+  RBRACE                    6   10.7%
+Literales numéricos:
+  integer                   7
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 2.62, máxima 14):
+    1                       7   87.5%
+   14                       1   12.5%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. i                                       5
+    2. j                                       2
+    3. ciclos_ejemplo                          1
@@ -0,0 +1,40 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             113
+Comentarios:       0 bytes (0.0%)
+Líneas:            7 (6 con código)
+Tokens:            37 (5.29 por línea, 6.17 por línea con código)
+  IDENT                     8   21.6%
+  NUMBER                    2    5.4%
+  KW_FN                     2    5.4%
+  KW_LET                    1    2.7%
+  KW_RETURN                 1    2.7%
+  KW_I32                    3    8.1%
+  PLUS                      1    2.7%
+  MINUS                     1    2.7%
+  EQUAL                     1    2.7%
+  GREATER                   1    2.7%
+  COMMA                     2    5.4%
+  SEMICOLON                 2    5.4%
+  COLON                     2    5.4%
+  LPAREN                    3    8.1%
+  RPAREN                    3    8.1%
+  LBRACE                    2    5.4%
+  RBRACE                    2    5.4%
+Literales numéricos:
+  integer                   2
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 4.62, máxima 14):
+    1                       4   50.0%
+    5                       2   25.0%
+    9                       1   12.5%
+   14                       1   12.5%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. a                                       2
+    2. b                                       2
+    3. sumar                                   2
+    4. principal                               1
+    5. resultado_suma                          1
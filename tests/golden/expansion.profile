@@ -0,0 +1,72 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             1561
+Comentarios:       148 bytes (9.5%)
+Líneas:            84 (71 con código)
+Tokens:            429 (5.11 por línea, 6.04 por línea con código)
+  IDENT                    93   21.7%
+  NUMBER                   28    6.5%
+  CHAR                      2    0.5%
+  KW_FN                    12    2.8%
+  KW_LET                    4    0.9%
+  KW_MUT                    3    0.7%
+  KW_IF                     4    0.9%
+  KW_MATCH                  1    0.2%
+  KW_WHILE                  1    0.2%
+  KW_FOR                    1    0.2%
+  KW_IN                     1    0.2%
+  KW_RETURN                15    3.5%
+  KW_TRUE                   1    0.2%
+  KW_FALSE                  1    0.2%
+  KW_I32                   22    5.1%
+  KW_BOOL                   2    0.5%
+  KW_CHAR                   1    0.2%
+  PLUS                      3    0.7%
+  MINUS                    18    4.2%
+  STAR                      2    0.5%
+  SLASH                     2    0.5%
+  EQUAL                     4    0.9%
+  EQUAL_EQUAL               2    0.5%
+  BANG                      1    0.2%
+  LESS                      1    0.2%
+  LESS_EQUAL                1    0.2%
+  GREATER                  11    2.6%
+  AND_AND                   1    0.2%
+  PLUS_EQUAL                3    0.7%
+  ARROW                     2    0.5%
+  DOT                       2    0.5%
+  COMMA                    14    3.3%
+  SEMICOLON                33    7.7%
+  COLON                    15    3.5%
+  LPAREN                   40    9.3%
+  RPAREN                   40    9.3%
+  LBRACE                   21    4.9%
+  RBRACE                   21    4.9%
+Literales numéricos:
+  integer                  28
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 4.18, máxima 14):
+    1                      38   40.9%
+    3                       3    3.2%
+    4                      10   10.8%
+    5                      11   11.8%
+    6                       8    8.6%
+    7                       5    5.4%
+    8                      10   10.8%
+    9                       4    4.3%
+   10                       2    2.2%
+   14                       2    2.2%
+Identificadores más frecuentes (estimados; error <= 0.1 con prob. 98%):
+    1. n                                      12
+    2. i                                       7
+    3. x                                       7
+    4. print                                   6
+    5. a                                       5
+    6. b                                       5
+    7. acumulado                               4
+    8. cuadrado                                4
+    9. es_par                                  4
+   10. maximo                                  4
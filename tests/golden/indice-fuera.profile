@@ -0,0 +1,46 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             253
+Comentarios:       65 bytes (25.7%)
+Líneas:            12 (10 con código)
+Tokens:            74 (6.17 por línea, 7.40 por línea con código)
+  IDENT                    17   23.0%
+  NUMBER                    6    8.1%
+  STRING                    1    1.4%
+  KW_FN                     2    2.7%
+  KW_LET                    1    1.4%
+  KW_RETURN                 2    2.7%
+  KW_I32                    2    2.7%
+  MINUS                     2    2.7%
+  EQUAL                     1    1.4%
+  GREATER                   2    2.7%
+  COMMA                     5    6.8%
+  SEMICOLON                 6    8.1%
+  COLON                     1    1.4%
+  LPAREN                   10   13.5%
+  RPAREN                   10   13.5%
+  LBRACE                    2    2.7%
+  RBRACE                    2    2.7%
+  LBRACKET                  1    1.4%
+  RBRACKET                  1    1.4%
+Literales numéricos:
+  integer                   6
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 3.00, máxima 6):
+    1                       6   35.3%
+    2                       3   17.6%
+    3                       1    5.9%
+    4                       1    5.9%
+    5                       4   23.5%
+    6                       2   11.8%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. a                                       6
+    2. at                                      3
+    3. print                                   3
+    4. ultimo                                  2
+    5. Array                                   1
+    6. len                                     1
+    7. main                                    1
@@ -0,0 +1,14 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             0
+Comentarios:       0 bytes (0.0%)
+Líneas:            0 (0 con código)
+Tokens:            0 (0.00 por línea, 0.00 por línea con código)
+Literales numéricos:
+  integer                   0
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 0.00, máxima 0):
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
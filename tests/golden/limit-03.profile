@@ -0,0 +1,28 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             50
+Comentarios:       0 bytes (0.0%)
+Líneas:            1 (1 con código)
+Tokens:            25 (25.00 por línea, 25.00 por línea con código)
+  IDENT                     6   24.0%
+  NUMBER                    2    8.0%
+  KW_LET                    2    8.0%
+  KW_IF                     1    4.0%
+  KW_ELSE                   1    4.0%
+  KW_RETURN                 2    8.0%
+  EQUAL                     2    8.0%
+  GREATER                   1    4.0%
+  SEMICOLON                 4   16.0%
+  LBRACE                    2    8.0%
+  RBRACE                    2    8.0%
+Literales numéricos:
+  integer                   2
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 1.00, máxima 1):
+    1                       6  100.0%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. a                                       3
+    2. b                                       3
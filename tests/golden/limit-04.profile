@@ -0,0 +1,83 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             22936
+Comentarios:       2895 bytes (12.6%)
+Líneas:            1000 (721 con código)
+Tokens:            4148 (4.15 por línea, 5.75 por línea con código)
+  IDENT                   927   22.3%
+  NUMBER                  470   11.3%
+  STRING                   15    0.4%
+  KW_FN                    25    0.6%
+  KW_LET                  254    6.1%
+  KW_MUT                   75    1.8%
+  KW_IF                    65    1.6%
+  KW_ELSE                  10    0.2%
+  KW_MATCH                  5    0.1%
+  KW_WHILE                 20    0.5%
+  KW_LOOP                   5    0.1%
+  KW_FOR                   45    1.1%
+  KW_IN                    45    1.1%
+  KW_BREAK                 15    0.4%
+  KW_CONTINUE              10    0.2%
+  KW_RETURN                30    0.7%
+  KW_TRUE                  25    0.6%
+  KW_I32                  120    2.9%
+  KW_F64                   20    0.5%
+  KW_BOOL                   5    0.1%
+  PLUS                     70    1.7%
+  MINUS                    50    1.2%
+  STAR                     55    1.3%
+  SLASH                    25    0.6%
+  PERCENT                  20    0.5%
+  EQUAL                   335    8.1%
+  EQUAL_EQUAL              20    0.5%
+  LESS                     20    0.5%
+  LESS_EQUAL               25    0.6%
+  GREATER                  40    1.0%
+  ARROW                    20    0.5%
+  DOT                      90    2.2%
+  COMMA                   105    2.5%
+  SEMICOLON               370    8.9%
+  COLON                   140    3.4%
+  LPAREN                   65    1.6%
+  RPAREN                   65    1.6%
+  LBRACE                  175    4.2%
+  RBRACE                  165    4.0%
+  LBRACKET                 50    1.2%
+  RBRACKET                 50    1.2%
+  UNKNOWN                   7    0.2%
+Literales numéricos:
+  integer                 435
+  real                     35
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 5.69, máxima 19):
+    1                     231   24.9%
+    2                      11    1.2%
+    3                      90    9.7%
+    4                      90    9.7%
+    5                      30    3.2%
+    6                      90    9.7%
+    7                      35    3.8%
+    8                     150   16.2%
+    9                      80    8.6%
+   10                      35    3.8%
+   11                      10    1.1%
+   12                      10    1.1%
+   13                      15    1.6%
+   14                      35    3.8%
+   17                       5    0.5%
+   18                       5    0.5%
+   19                       5    0.5%
+Identificadores más frecuentes (estimados; error <= 0.6 con prob. 98%):
+    1. i                                      70
+    2. contador                               65
+    3. n                                      50
+    4. arr                                    45
+    5. j                                      45
+    6. indice                                 30
+    7. resultado                              30
+    8. acumulador                             25
+    9. b                                      25
+   10. multiplicacion                         25
@@ -0,0 +1,47 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             643
+Comentarios:       30 bytes (4.7%)
+Líneas:            39 (34 con código)
+Tokens:            195 (5.00 por línea, 5.74 por línea con código)
+  IDENT                    38   19.5%
+  NUMBER                   20   10.3%
+  KW_FN                     5    2.6%
+  KW_IF                     5    2.6%
+  KW_RETURN                10    5.1%
+  KW_TRUE                   1    0.5%
+  KW_FALSE                  1    0.5%
+  KW_I32                    8    4.1%
+  KW_BOOL                   2    1.0%
+  PLUS                      2    1.0%
+  MINUS                    11    5.6%
+  EQUAL_EQUAL               5    2.6%
+  GREATER                   5    2.6%
+  COMMA                     5    2.6%
+  SEMICOLON                14    7.2%
+  COLON                     5    2.6%
+  LPAREN                   19    9.7%
+  RPAREN                   19    9.7%
+  LBRACE                   10    5.1%
+  RBRACE                   10    5.1%
+Literales numéricos:
+  integer                  20
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 3.26, máxima 9):
+    1                      19   50.0%
+    3                       3    7.9%
+    4                       4   10.5%
+    5                       7   18.4%
+    9                       5   13.2%
+Identificadores más frecuentes (estimados; error <= 0.0 con prob. 98%):
+    1. n                                      14
+    2. ackermann                               5
+    3. m                                       5
+    4. print                                   4
+    5. impar                                   3
+    6. par                                     3
+    7. suma                                    3
+    8. main                                    1
@@ -0,0 +1,59 @@
+=== PERFIL DEL FUENTE ===
+Archivos:          1
+Bytes:             1600
+Comentarios:       170 bytes (10.6%)
+Líneas:            75 (67 con código)
+Tokens:            408 (5.44 por línea, 6.09 por línea con código)
+  IDENT                   100   24.5%
+  NUMBER                   42   10.3%
+  KW_FN                     6    1.5%
+  KW_LET                    8    2.0%
+  KW_MUT                    8    2.0%
+  KW_IF                     3    0.7%
+  KW_FOR                    6    1.5%
+  KW_IN                     6    1.5%
+  KW_RETURN                 5    1.2%
+  KW_I32                   12    2.9%
+  PLUS                      6    1.5%
+  MINUS                    14    3.4%
+  STAR                     10    2.5%
+  PERCENT                   1    0.2%
+  EQUAL                    14    3.4%
+  LESS                      1    0.2%
+  LESS_EQUAL                1    0.2%
+  GREATER                   6    1.5%
+  PLUS_EQUAL                1    0.2%
+  MINUS_EQUAL               1    0.2%
+  STAR_EQUAL                1    0.2%
+  DOT                      12    2.9%
+  COMMA                     8    2.0%
+  SEMICOLON                37    9.1%
+  COLON                     7    1.7%
+  LPAREN                   31    7.6%
+  RPAREN                   31    7.6%
+  LBRACE                   15    3.7%
+  RBRACE                   15    3.7%
+Literales numéricos:
+  integer                  42
+  real                      0
+  exponent                  0
+  hex                       0
+  binary                    0
+Longitud de identificadores (media 4.20, máxima 15):
+    1                      34   34.0%
+    4                       6    6.0%
+    5                      46   46.0%
+    8                       6    6.0%
+    9                       6    6.0%
+   15                       2    2.0%
+Identificadores más frecuentes (estimados; error <= 0.1 con prob. 98%):
+    1. i                                      20
+    2. total                                  14
+    3. print                                  13
+    4. n                                      12
+    5. suma                                    5
+    6. doble                                   4
+    7. mayor                                   4
+    8. menor                                   4
+    9. producto                                3
+   10. resta                                   3